@@ -108,6 +108,21 @@ const DirectX::XMFLOAT4X4& Camera::GetWorldToViewTransform( )
     return mViewTransform;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const DirectX::XMFLOAT4& Camera::GetPosition( ) const
+{
+    return mPos;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float Camera::GetTheta( ) const
+{
+    return mTheta;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float Camera::GetPhi( ) const
+{
+    return mPhi;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Camera::UpdateRightUp()
 {
     if ( abs( mViewVec.y ) > 0.99f )
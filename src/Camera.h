@@ -20,6 +20,9 @@ public:
     void SetDirection( const DirectX::XMFLOAT4 &vec );
 
     const DirectX::XMFLOAT4X4& GetWorldToViewTransform( );
+    const DirectX::XMFLOAT4& GetPosition( ) const;
+    float GetTheta( ) const;
+    float GetPhi( ) const;
 
 private:
     float mPhi, mTheta;
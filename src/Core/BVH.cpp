@@ -0,0 +1,730 @@
+#include <Core/BVH.h>
+#include <GlobalUtils.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <thread>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define BVH_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const size_t BVH_BINS = 16;
+    const size_t BVH_MAX_LEAF_SIZE = 8;
+    const size_t BVH_PARALLEL_MIN_REFS = 4096; // don't spawn tasks for small subtrees
+    const float BVH_TRAVERSAL_COST = 1.0f;
+    const float BVH_INTERSECTION_COST = 1.0f;
+
+    struct PrimRef
+    {
+        AABB mBox;
+        float mCentroid[3];
+        uint32_t mTriangle;
+    };
+
+    struct BinaryNode
+    {
+        AABB mBox;
+        std::unique_ptr<BinaryNode> mChildren[2];
+        size_t mFirst = 0;
+        size_t mCount = 0;
+
+        bool IsLeaf( ) const { return !mChildren[0]; }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    float SurfaceArea( const AABB &box )
+    {
+        if ( box.IsEmpty( ) )
+            return 0.0f;
+
+        float dx = box.mMax[0] - box.mMin[0];
+        float dy = box.mMax[1] - box.mMin[1];
+        float dz = box.mMax[2] - box.mMin[2];
+        return 2.0f * ( dx * dy + dy * dz + dz * dx );
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void Merge( AABB &dst, const AABB &src )
+    {
+        dst.Extend( src.mMin );
+        dst.Extend( src.mMax );
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class BinaryBuilder
+    {
+    public:
+        BinaryBuilder( std::vector<PrimRef> &refs ) : mRefs( refs ) {}
+
+        std::unique_ptr<BinaryNode> Build( size_t first, size_t count, size_t taskBudget )
+        {
+            std::unique_ptr<BinaryNode> node( new BinaryNode );
+            node->mFirst = first;
+            node->mCount = count;
+
+            AABB centroidBox;
+            for ( size_t i = first; i < first + count; i++ )
+            {
+                Merge( node->mBox, mRefs[i].mBox );
+                centroidBox.Extend( mRefs[i].mCentroid );
+            }
+
+            if ( count <= 2 )
+                return node;
+
+            size_t mid = 0;
+            if ( !FindSplit( first, count, node->mBox, centroidBox, mid ) )
+                return node;
+
+            // left subtree in a separate task while enough budget and work left
+            size_t leftCount = mid - first;
+            size_t rightCount = first + count - mid;
+            if ( taskBudget > 1 && count >= BVH_PARALLEL_MIN_REFS )
+            {
+                size_t leftBudget = taskBudget / 2;
+                std::future<std::unique_ptr<BinaryNode>> left = std::async( std::launch::async,
+                    [this, first, leftCount, leftBudget]( ) { return Build( first, leftCount, leftBudget ); } );
+                node->mChildren[1] = Build( mid, rightCount, taskBudget - leftBudget );
+                node->mChildren[0] = left.get( );
+            }
+            else
+            {
+                node->mChildren[0] = Build( first, leftCount, 1 );
+                node->mChildren[1] = Build( mid, rightCount, 1 );
+            }
+
+            return node;
+        }
+
+    private:
+        std::vector<PrimRef> &mRefs;
+
+        // binned sah split, returns false if leaf is cheaper
+        bool FindSplit( size_t first, size_t count, const AABB &box, const AABB &centroidBox, size_t &mid )
+        {
+            float bestCost = 1e30f;
+            int bestAxis = -1;
+            size_t bestBin = 0;
+
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                float cmin = centroidBox.mMin[axis];
+                float extent = centroidBox.mMax[axis] - cmin;
+                if ( extent <= 0.0f )
+                    continue;
+
+                AABB bins[BVH_BINS];
+                size_t binCount[BVH_BINS] = { 0 };
+                float scale = BVH_BINS / extent;
+                for ( size_t i = first; i < first + count; i++ )
+                {
+                    size_t b = std::min( BVH_BINS - 1, static_cast< size_t >( ( mRefs[i].mCentroid[axis] - cmin ) * scale ) );
+                    binCount[b]++;
+                    Merge( bins[b], mRefs[i].mBox );
+                }
+
+                // sweep from the right to get suffix areas
+                float rightArea[BVH_BINS];
+                size_t rightCount[BVH_BINS];
+                AABB acc;
+                size_t accCount = 0;
+                for ( size_t b = BVH_BINS - 1; b > 0; b-- )
+                {
+                    Merge( acc, bins[b] );
+                    accCount += binCount[b];
+                    rightArea[b] = SurfaceArea( acc );
+                    rightCount[b] = accCount;
+                }
+
+                acc = AABB( );
+                accCount = 0;
+                for ( size_t b = 0; b < BVH_BINS - 1; b++ )
+                {
+                    Merge( acc, bins[b] );
+                    accCount += binCount[b];
+                    if ( accCount == 0 || rightCount[b + 1] == 0 )
+                        continue;
+
+                    float cost = SurfaceArea( acc ) * accCount + rightArea[b + 1] * rightCount[b + 1];
+                    if ( cost < bestCost )
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestBin = b;
+                    }
+                }
+            }
+
+            float area = SurfaceArea( box );
+            float leafCost = BVH_INTERSECTION_COST * count;
+            float splitCost = BVH_TRAVERSAL_COST + ( area > 0.0f ? BVH_INTERSECTION_COST * bestCost / area : leafCost );
+
+            if ( bestAxis < 0 )
+            {
+                // all centroids in one point - split by order if leaf is too big
+                if ( count <= BVH_MAX_LEAF_SIZE )
+                    return false;
+
+                mid = first + count / 2;
+                return true;
+            }
+
+            if ( count <= BVH_MAX_LEAF_SIZE && leafCost <= splitCost )
+                return false;
+
+            float cmin = centroidBox.mMin[bestAxis];
+            float scale = BVH_BINS / ( centroidBox.mMax[bestAxis] - cmin );
+            auto it = std::partition( mRefs.begin( ) + first, mRefs.begin( ) + first + count, [&]( const PrimRef &ref )
+            {
+                size_t b = std::min( BVH_BINS - 1, static_cast< size_t >( ( ref.mCentroid[bestAxis] - cmin ) * scale ) );
+                return b <= bestBin;
+            } );
+
+            mid = static_cast< size_t >( it - mRefs.begin( ) );
+            if ( mid == first || mid == first + count )
+                mid = first + count / 2;
+
+            return true;
+        }
+    };
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void SetEmptySlot( BVH::Node &node, int slot )
+    {
+        node.mMinX[slot] = node.mMinY[slot] = node.mMinZ[slot] = 1e30f;
+        node.mMaxX[slot] = node.mMaxY[slot] = node.mMaxZ[slot] = -1e30f;
+        node.mChild[slot] = BVH::INVALID_NODE;
+        node.mCount[slot] = 0;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void SetSlotBox( BVH::Node &node, int slot, const AABB &box )
+    {
+        node.mMinX[slot] = box.mMin[0]; node.mMinY[slot] = box.mMin[1]; node.mMinZ[slot] = box.mMin[2];
+        node.mMaxX[slot] = box.mMax[0]; node.mMaxY[slot] = box.mMax[1]; node.mMaxZ[slot] = box.mMax[2];
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // converts binary subtree into 4-wide nodes, returns node index
+    uint32_t Collapse( const BinaryNode *binary, std::vector<BVH::Node> &nodes, BVHStats &stats, size_t depth )
+    {
+        stats.mMaxDepth = std::max( stats.mMaxDepth, depth );
+
+        // open inner children with the largest area until there are 4 of them
+        const BinaryNode *children[4] = { binary->mChildren[0].get( ), binary->mChildren[1].get( ), nullptr, nullptr };
+        int childCount = 2;
+        while ( childCount < 4 )
+        {
+            int best = -1;
+            float bestArea = -1.0f;
+            for ( int i = 0; i < childCount; i++ )
+            {
+                if ( !children[i]->IsLeaf( ) && SurfaceArea( children[i]->mBox ) > bestArea )
+                {
+                    bestArea = SurfaceArea( children[i]->mBox );
+                    best = i;
+                }
+            }
+
+            if ( best < 0 )
+                break;
+
+            const BinaryNode *opened = children[best];
+            children[best] = opened->mChildren[0].get( );
+            children[childCount++] = opened->mChildren[1].get( );
+        }
+
+        uint32_t nodeIndex = static_cast< uint32_t >( nodes.size( ) );
+        nodes.push_back( BVH::Node( ) );
+        stats.mNodes++;
+
+        for ( int slot = 0; slot < 4; slot++ )
+        {
+            if ( slot >= childCount )
+            {
+                SetEmptySlot( nodes[nodeIndex], slot );
+                continue;
+            }
+
+            const BinaryNode *child = children[slot];
+            uint32_t childIndex = 0;
+            uint32_t childTriangles = 0;
+            if ( child->IsLeaf( ) )
+            {
+                childIndex = static_cast< uint32_t >( child->mFirst );
+                childTriangles = static_cast< uint32_t >( child->mCount );
+                stats.mLeaves++;
+            }
+            else
+            {
+                childIndex = Collapse( child, nodes, stats, depth + 1 ); // invalidates references into nodes
+            }
+
+            BVH::Node &node = nodes[nodeIndex];
+            SetSlotBox( node, slot, child->mBox );
+            node.mChild[slot] = childIndex;
+            node.mCount[slot] = childTriangles;
+        }
+
+        return nodeIndex;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool IntersectTriangle( const BVH::Triangle &tri, const float o[3], const float d[3], float tMin, float tMax, float &t, float &u, float &v )
+    {
+        const float eps = 1e-9f;
+
+        // p = d x e2
+        float p[3] = { d[1] * tri.mE2[2] - d[2] * tri.mE2[1], d[2] * tri.mE2[0] - d[0] * tri.mE2[2], d[0] * tri.mE2[1] - d[1] * tri.mE2[0] };
+        float det = tri.mE1[0] * p[0] + tri.mE1[1] * p[1] + tri.mE1[2] * p[2];
+        if ( std::fabs( det ) < eps )
+            return false;
+
+        float invDet = 1.0f / det;
+        float s[3] = { o[0] - tri.mV0[0], o[1] - tri.mV0[1], o[2] - tri.mV0[2] };
+        u = ( s[0] * p[0] + s[1] * p[1] + s[2] * p[2] ) * invDet;
+        if ( u < 0.0f || u > 1.0f )
+            return false;
+
+        // q = s x e1
+        float q[3] = { s[1] * tri.mE1[2] - s[2] * tri.mE1[1], s[2] * tri.mE1[0] - s[0] * tri.mE1[2], s[0] * tri.mE1[1] - s[1] * tri.mE1[0] };
+        v = ( d[0] * q[0] + d[1] * q[1] + d[2] * q[2] ) * invDet;
+        if ( v < 0.0f || u + v > 1.0f )
+            return false;
+
+        t = ( tri.mE2[0] * q[0] + tri.mE2[1] * q[1] + tri.mE2[2] * q[2] ) * invDet;
+        return t >= tMin && t <= tMax;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void HashWords( uint64_t &hash, const uint32_t *words, size_t count )
+    {
+        // fnv-1a over 32 bit words
+        for ( size_t i = 0; i < count; i++ )
+        {
+            hash ^= words[i];
+            hash *= 1099511628211ull;
+        }
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void BVHBuildInput::AddMesh( const void *vertices, size_t stride, size_t vertexCount, const uint32_t *indices, size_t indexCount, uint32_t object )
+{
+    uint32_t base = static_cast< uint32_t >( mPositions.size( ) / 3 );
+
+    const uint8_t *v = static_cast< const uint8_t* >( vertices );
+    for ( size_t i = 0; i < vertexCount; i++ )
+    {
+        const float *p = reinterpret_cast< const float* >( v + i * stride );
+        mPositions.insert( mPositions.end( ), p, p + 3 );
+    }
+
+    for ( size_t i = 0; i + 2 < indexCount; i += 3 )
+    {
+        mIndices.push_back( base + indices[i] );
+        mIndices.push_back( base + indices[i + 1] );
+        mIndices.push_back( base + indices[i + 2] );
+        mTriangleObject.push_back( object );
+        mTrianglePrimitive.push_back( static_cast< uint32_t >( i / 3 ) );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t BVHBuildInput::GetTriangleCount( ) const
+{
+    return mIndices.size( ) / 3;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t BVHBuildInput::GetChecksum( ) const
+{
+    // same streams as BVHChecksum, floats by their bits
+    static_assert( sizeof( float ) == sizeof( uint32_t ), "positions are hashed as 32 bit words" );
+    BVHChecksum checksum;
+    if ( !mPositions.empty( ) )
+        HashWords( checksum.mPositions, reinterpret_cast< const uint32_t* >( &mPositions[0] ), mPositions.size( ) );
+    if ( !mIndices.empty( ) )
+    {
+        HashWords( checksum.mIndices, &mIndices[0], mIndices.size( ) );
+        HashWords( checksum.mObjects, &mTriangleObject[0], mTriangleObject.size( ) );
+        HashWords( checksum.mPrimitives, &mTrianglePrimitive[0], mTrianglePrimitive.size( ) );
+    }
+    return checksum.Get( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void BVHBuildInput::Clear( )
+{
+    // release memory, input is usually big and used once
+    std::vector<float>( ).swap( mPositions );
+    std::vector<uint32_t>( ).swap( mIndices );
+    std::vector<uint32_t>( ).swap( mTriangleObject );
+    std::vector<uint32_t>( ).swap( mTrianglePrimitive );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void BVHChecksum::AddMesh( const void *vertices, size_t stride, size_t vertexCount, const uint32_t *indices, size_t indexCount, uint32_t object )
+{
+    const uint8_t *v = static_cast< const uint8_t* >( vertices );
+    for ( size_t i = 0; i < vertexCount; i++ )
+        HashWords( mPositions, reinterpret_cast< const uint32_t* >( v + i * stride ), 3 );
+
+    for ( size_t i = 0; i + 2 < indexCount; i += 3 )
+    {
+        uint32_t triangle[3] = { mVertexCount + indices[i], mVertexCount + indices[i + 1], mVertexCount + indices[i + 2] };
+        uint32_t primitive = static_cast< uint32_t >( i / 3 );
+        HashWords( mIndices, triangle, 3 );
+        HashWords( mObjects, &object, 1 );
+        HashWords( mPrimitives, &primitive, 1 );
+        mTriangleCount++;
+    }
+    mVertexCount += static_cast< uint32_t >( vertexCount );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t BVHChecksum::GetTriangleCount( ) const
+{
+    return mTriangleCount;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t BVHChecksum::Get( ) const
+{
+    uint64_t streams[4] = { mPositions, mIndices, mObjects, mPrimitives };
+    uint32_t words[8];
+    for ( int i = 0; i < 4; i++ )
+    {
+        words[2 * i] = static_cast< uint32_t >( streams[i] );
+        words[2 * i + 1] = static_cast< uint32_t >( streams[i] >> 32 );
+    }
+    uint64_t hash = 14695981039346656037ull;
+    HashWords( hash, words, 8 );
+    return hash;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BVH::Build( const BVHBuildInput &input, size_t threads )
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now( );
+
+    Clear( );
+
+    size_t triCount = input.GetTriangleCount( );
+    if ( triCount == 0 )
+        return false;
+
+    std::vector<PrimRef> refs( triCount );
+    for ( size_t t = 0; t < triCount; t++ )
+    {
+        PrimRef &ref = refs[t];
+        for ( int k = 0; k < 3; k++ )
+            ref.mBox.Extend( &input.mPositions[input.mIndices[t * 3 + k] * 3] );
+
+        for ( int a = 0; a < 3; a++ )
+            ref.mCentroid[a] = ( ref.mBox.mMin[a] + ref.mBox.mMax[a] ) * 0.5f;
+
+        ref.mTriangle = static_cast< uint32_t >( t );
+        Merge( mBounds, ref.mBox );
+    }
+
+    if ( threads == 0 )
+        threads = std::max( 1u, std::thread::hardware_concurrency( ) );
+
+    BinaryBuilder builder( refs );
+    std::unique_ptr<BinaryNode> root = builder.Build( 0, triCount, threads );
+
+    // leaves point into refs order, so store triangles in that order
+    mTriangles.resize( triCount );
+    for ( size_t i = 0; i < triCount; i++ )
+    {
+        uint32_t t = refs[i].mTriangle;
+        const float *v0 = &input.mPositions[input.mIndices[t * 3 + 0] * 3];
+        const float *v1 = &input.mPositions[input.mIndices[t * 3 + 1] * 3];
+        const float *v2 = &input.mPositions[input.mIndices[t * 3 + 2] * 3];
+
+        Triangle &tri = mTriangles[i];
+        for ( int a = 0; a < 3; a++ )
+        {
+            tri.mV0[a] = v0[a];
+            tri.mE1[a] = v1[a] - v0[a];
+            tri.mE2[a] = v2[a] - v0[a];
+        }
+        tri.mObject = input.mTriangleObject[t];
+        tri.mPrimitive = input.mTrianglePrimitive[t];
+    }
+
+    if ( root->IsLeaf( ) )
+    {
+        // single leaf - root node with one slot
+        Node node;
+        for ( int slot = 1; slot < 4; slot++ )
+            SetEmptySlot( node, slot );
+
+        SetSlotBox( node, 0, root->mBox );
+        node.mChild[0] = 0;
+        node.mCount[0] = static_cast< uint32_t >( triCount );
+        mNodes.push_back( node );
+        mStats.mNodes = 1;
+        mStats.mLeaves = 1;
+    }
+    else
+    {
+        mNodes.reserve( triCount / 4 + 1 );
+        Collapse( root.get( ), mNodes, mStats, 1 );
+    }
+
+    mStats.mTriangles = triCount;
+    mChecksum = input.GetChecksum( );
+    mStats.mBuildTime = std::chrono::duration< double >( Clock::now( ) - start ).count( );
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void BVH::Clear( )
+{
+    mNodes.clear( );
+    mTriangles.clear( );
+    mBounds = AABB( );
+    mStats = BVHStats( );
+    mChecksum = 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BVH::IsEmpty( ) const
+{
+    return mNodes.empty( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template< bool anyHit >
+bool BVH::Traverse( const BVHRay &ray, BVHHit &hit ) const
+{
+    if ( mNodes.empty( ) )
+        return false;
+
+    // avoid inf * 0 in slab test
+    float invDir[3];
+    for ( int a = 0; a < 3; a++ )
+    {
+        float d = std::fabs( ray.mDir[a] ) > 1e-20f ? ray.mDir[a] : ( ray.mDir[a] < 0.0f ? -1e-20f : 1e-20f );
+        invDir[a] = 1.0f / d;
+    }
+
+    float tMax = ray.mTMax;
+    bool found = false;
+
+    // a popped node leaves at most 3 siblings on every level above it and pushes at most 4 children, so the stack
+    // never holds more than 3 entries per level; deep trees of degenerate geometry go to the heap
+    const size_t LOCAL_STACK_SIZE = 64;
+    size_t stackCapacity = 3 * mStats.mMaxDepth + 1;
+    uint32_t localStack[LOCAL_STACK_SIZE];
+    std::vector<uint32_t> heapStack;
+    uint32_t *stack = localStack;
+    if ( stackCapacity > LOCAL_STACK_SIZE )
+    {
+        heapStack.resize( stackCapacity );
+        stack = heapStack.data( );
+    }
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while ( stackSize > 0 )
+    {
+        const Node &node = mNodes[stack[--stackSize]];
+
+        float tNear[4];
+        int hitMask = 0;
+#ifdef BVH_SSE
+        {
+            __m128 ox = _mm_set1_ps( ray.mOrigin[0] ), oy = _mm_set1_ps( ray.mOrigin[1] ), oz = _mm_set1_ps( ray.mOrigin[2] );
+            __m128 ix = _mm_set1_ps( invDir[0] ), iy = _mm_set1_ps( invDir[1] ), iz = _mm_set1_ps( invDir[2] );
+
+            __m128 t1x = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( node.mMinX ), ox ), ix );
+            __m128 t2x = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( node.mMaxX ), ox ), ix );
+            __m128 t1y = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( node.mMinY ), oy ), iy );
+            __m128 t2y = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( node.mMaxY ), oy ), iy );
+            __m128 t1z = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( node.mMinZ ), oz ), iz );
+            __m128 t2z = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( node.mMaxZ ), oz ), iz );
+
+            __m128 nearV = _mm_max_ps( _mm_max_ps( _mm_min_ps( t1x, t2x ), _mm_min_ps( t1y, t2y ) ),
+                _mm_max_ps( _mm_min_ps( t1z, t2z ), _mm_set1_ps( ray.mTMin ) ) );
+            __m128 farV = _mm_min_ps( _mm_min_ps( _mm_max_ps( t1x, t2x ), _mm_max_ps( t1y, t2y ) ),
+                _mm_min_ps( _mm_max_ps( t1z, t2z ), _mm_set1_ps( tMax ) ) );
+
+            hitMask = _mm_movemask_ps( _mm_cmple_ps( nearV, farV ) );
+            _mm_storeu_ps( tNear, nearV );
+        }
+#else
+        for ( int slot = 0; slot < 4; slot++ )
+        {
+            float t1x = ( node.mMinX[slot] - ray.mOrigin[0] ) * invDir[0], t2x = ( node.mMaxX[slot] - ray.mOrigin[0] ) * invDir[0];
+            float t1y = ( node.mMinY[slot] - ray.mOrigin[1] ) * invDir[1], t2y = ( node.mMaxY[slot] - ray.mOrigin[1] ) * invDir[1];
+            float t1z = ( node.mMinZ[slot] - ray.mOrigin[2] ) * invDir[2], t2z = ( node.mMaxZ[slot] - ray.mOrigin[2] ) * invDir[2];
+
+            float tn = std::max( std::max( std::min( t1x, t2x ), std::min( t1y, t2y ) ), std::max( std::min( t1z, t2z ), ray.mTMin ) );
+            float tf = std::min( std::min( std::max( t1x, t2x ), std::max( t1y, t2y ) ), std::min( std::max( t1z, t2z ), tMax ) );
+            tNear[slot] = tn;
+            hitMask |= ( tn <= tf ) << slot;
+        }
+#endif
+
+        // leaves are tested right away, inner nodes are pushed far to near
+        int inner[4];
+        int innerCount = 0;
+        for ( int slot = 0; slot < 4; slot++ )
+        {
+            if ( !( hitMask & ( 1 << slot ) ) || node.mChild[slot] == INVALID_NODE )
+                continue;
+
+            if ( node.mCount[slot] == 0 )
+            {
+                inner[innerCount++] = slot;
+                continue;
+            }
+
+            for ( uint32_t t = node.mChild[slot]; t < node.mChild[slot] + node.mCount[slot]; t++ )
+            {
+                float tt, u, v;
+                if ( IntersectTriangle( mTriangles[t], ray.mOrigin, ray.mDir, ray.mTMin, tMax, tt, u, v ) )
+                {
+                    found = true;
+                    if ( anyHit )
+                        return true;
+
+                    tMax = tt;
+                    hit.mT = tt;
+                    hit.mU = u;
+                    hit.mV = v;
+                    hit.mObject = mTriangles[t].mObject;
+                    hit.mPrimitive = mTriangles[t].mPrimitive;
+                }
+            }
+        }
+
+        for ( int i = 1; i < innerCount; i++ )
+        {
+            int slot = inner[i];
+            int j = i - 1;
+            for ( ; j >= 0 && tNear[inner[j]] < tNear[slot]; j-- )
+                inner[j + 1] = inner[j];
+            inner[j + 1] = slot;
+        }
+
+        ASSERT( stackSize + innerCount <= stackCapacity, "BVH traversal stack overflow" );
+        for ( int i = 0; i < innerCount; i++ )
+            stack[stackSize++] = node.mChild[inner[i]];
+    }
+
+    return found;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BVH::Intersect( const BVHRay &ray, BVHHit &hit ) const
+{
+    hit = BVHHit( );
+    return Traverse<false>( ray, hit );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BVH::Occluded( const BVHRay &ray ) const
+{
+    BVHHit hit;
+    return Traverse<true>( ray, hit );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BVH::Save( std::ostream &stream ) const
+{
+    uint32_t header[4] = { FILE_MAGIC, FILE_VERSION, static_cast< uint32_t >( mNodes.size( ) ), static_cast< uint32_t >( mTriangles.size( ) ) };
+    stream.write( reinterpret_cast< const char* >( header ), sizeof( header ) );
+    stream.write( reinterpret_cast< const char* >( &mBounds ), sizeof( mBounds ) );
+    stream.write( reinterpret_cast< const char* >( &mStats.mMaxDepth ), sizeof( uint32_t ) );
+    stream.write( reinterpret_cast< const char* >( &mChecksum ), sizeof( mChecksum ) );
+    if ( !mNodes.empty( ) )
+        stream.write( reinterpret_cast< const char* >( &mNodes[0] ), mNodes.size( ) * sizeof( Node ) );
+    if ( !mTriangles.empty( ) )
+        stream.write( reinterpret_cast< const char* >( &mTriangles[0] ), mTriangles.size( ) * sizeof( Triangle ) );
+
+    return stream.good( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BVH::Load( std::istream &stream )
+{
+    Clear( );
+
+    uint32_t header[4] = { 0 };
+    stream.read( reinterpret_cast< char* >( header ), sizeof( header ) );
+    if ( !stream.good( ) || header[0] != FILE_MAGIC || header[1] != FILE_VERSION )
+        return false;
+
+    uint32_t maxDepth = 0;
+    stream.read( reinterpret_cast< char* >( &mBounds ), sizeof( mBounds ) );
+    stream.read( reinterpret_cast< char* >( &maxDepth ), sizeof( uint32_t ) );
+    stream.read( reinterpret_cast< char* >( &mChecksum ), sizeof( mChecksum ) );
+
+    mNodes.resize( header[2] );
+    mTriangles.resize( header[3] );
+    if ( !mNodes.empty( ) )
+        stream.read( reinterpret_cast< char* >( &mNodes[0] ), mNodes.size( ) * sizeof( Node ) );
+    if ( !mTriangles.empty( ) )
+        stream.read( reinterpret_cast< char* >( &mTriangles[0] ), mTriangles.size( ) * sizeof( Triangle ) );
+
+    if ( !stream.good( ) )
+    {
+        Clear( );
+        return false;
+    }
+
+    mStats.mNodes = mNodes.size( );
+    mStats.mTriangles = mTriangles.size( );
+    mStats.mMaxDepth = maxDepth;
+    for ( auto &node : mNodes )
+    {
+        for ( int slot = 0; slot < 4; slot++ )
+            mStats.mLeaves += node.mCount[slot] > 0;
+    }
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const BVHStats& BVH::GetStats( ) const
+{
+    return mStats;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const AABB& BVH::GetBounds( ) const
+{
+    return mBounds;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t BVH::GetChecksum( ) const
+{
+    return mChecksum;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+double BVH::RunRayBenchmark( size_t rays, size_t &hits ) const
+{
+    typedef std::chrono::steady_clock Clock;
+
+    hits = 0;
+    if ( IsEmpty( ) || rays == 0 )
+        return 0.0;
+
+    std::mt19937 rng( 777 );
+    std::uniform_real_distribution<float> unit( 0.0f, 1.0f );
+
+    // generate rays up front so generation isn't measured
+    std::vector<BVHRay> rayList( rays );
+    for ( auto &ray : rayList )
+    {
+        for ( int a = 0; a < 3; a++ )
+            ray.mOrigin[a] = mBounds.mMin[a] + unit( rng ) * ( mBounds.mMax[a] - mBounds.mMin[a] );
+
+        float z = unit( rng ) * 2.0f - 1.0f;
+        float phi = unit( rng ) * 2.0f * PI;
+        float r = std::sqrt( std::max( 0.0f, 1.0f - z * z ) );
+        ray.mDir[0] = r * std::cos( phi );
+        ray.mDir[1] = r * std::sin( phi );
+        ray.mDir[2] = z;
+        ray.mTMin = 0.0f;
+        ray.mTMax = 1e30f;
+    }
+
+    Clock::time_point start = Clock::now( );
+    BVHHit hit;
+    for ( auto &ray : rayList )
+        hits += Intersect( ray, hit ) ? 1 : 0;
+    double seconds = std::chrono::duration< double >( Clock::now( ) - start ).count( );
+
+    return seconds > 0.0 ? rays / seconds : 0.0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
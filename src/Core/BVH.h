@@ -0,0 +1,129 @@
+#ifndef __BVH_H
+#define __BVH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <iosfwd>
+#include <Core/Culling.h>
+
+struct BVHRay
+{
+    float mOrigin[3];
+    float mDir[3];
+    float mTMin;
+    float mTMax;
+};
+
+struct BVHHit
+{
+    static const uint32_t INVALID = ~0u;
+
+    float mT = 0.0f;
+    float mU = 0.0f; // barycentrics of v1, v2
+    float mV = 0.0f;
+    uint32_t mObject = INVALID;
+    uint32_t mPrimitive = INVALID; // triangle index inside of object
+
+    bool IsHit( ) const { return mObject != INVALID; }
+};
+
+// triangle soup collected from scene meshes
+struct BVHBuildInput
+{
+    std::vector<float> mPositions; // xyz
+    std::vector<uint32_t> mIndices; // 3 per triangle, point to mPositions
+    std::vector<uint32_t> mTriangleObject; // object id per triangle
+    std::vector<uint32_t> mTrianglePrimitive; // triangle index inside of object
+
+    // stride in bytes between positions, position is 3 floats at the beginning of vertex
+    void AddMesh( const void *vertices, size_t stride, size_t vertexCount, const uint32_t *indices, size_t indexCount, uint32_t object );
+    size_t GetTriangleCount( ) const;
+    // hash of positions, indices and triangle ids, ties a saved bvh to the geometry it was built from
+    uint64_t GetChecksum( ) const;
+    void Clear( );
+};
+
+// running checksum of meshes in AddMesh order without their geometry, equals BVHBuildInput::GetChecksum of the
+// same meshes. validates a cached bvh while a scene is streamed
+struct BVHChecksum
+{
+    // fnv-1a of positions, indices, object and primitive ids, each of them continues from mesh to mesh
+    uint64_t mPositions = 14695981039346656037ull;
+    uint64_t mIndices = 14695981039346656037ull;
+    uint64_t mObjects = 14695981039346656037ull;
+    uint64_t mPrimitives = 14695981039346656037ull;
+    uint32_t mVertexCount = 0;
+    size_t mTriangleCount = 0;
+
+    void AddMesh( const void *vertices, size_t stride, size_t vertexCount, const uint32_t *indices, size_t indexCount, uint32_t object );
+    size_t GetTriangleCount( ) const;
+    uint64_t Get( ) const;
+};
+
+struct BVHStats
+{
+    size_t mTriangles = 0;
+    size_t mNodes = 0;
+    size_t mLeaves = 0;
+    size_t mMaxDepth = 0;
+    double mBuildTime = 0.0; // seconds
+};
+
+// 4-wide bounding volume hierarchy over triangles
+// built with binned SAH as binary tree and collapsed to 4 children per node
+class BVH
+{
+public:
+    static const uint32_t INVALID_NODE = ~0u;
+    static const uint32_t FILE_MAGIC = 0x34485642; // "BVH4"
+    static const uint32_t FILE_VERSION = 2;
+
+    // children bounds in SoA form, 128 bytes
+    struct Node
+    {
+        float mMinX[4], mMinY[4], mMinZ[4];
+        float mMaxX[4], mMaxY[4], mMaxZ[4];
+        uint32_t mChild[4]; // node index, first triangle for leaves or INVALID_NODE for empty slot
+        uint32_t mCount[4]; // triangles count for leaves, 0 for inner nodes
+    };
+
+    // precomputed edges for Moller-Trumbore test
+    struct Triangle
+    {
+        float mV0[3];
+        float mE1[3];
+        float mE2[3];
+        uint32_t mObject;
+        uint32_t mPrimitive;
+    };
+
+    bool Build( const BVHBuildInput &input, size_t threads = 0 ); // 0 - hardware concurrency
+    void Clear( );
+    bool IsEmpty( ) const;
+
+    bool Intersect( const BVHRay &ray, BVHHit &hit ) const; // closest hit
+    bool Occluded( const BVHRay &ray ) const; // any hit
+
+    bool Save( std::ostream &stream ) const;
+    bool Load( std::istream &stream ); // false if stream doesn't contain bvh (magic/version mismatch)
+
+    const BVHStats& GetStats( ) const;
+    const AABB& GetBounds( ) const;
+    uint64_t GetChecksum( ) const; // BVHBuildInput::GetChecksum of the build input
+
+    // random rays starting inside of bounds, returns rays per second
+    double RunRayBenchmark( size_t rays, size_t &hits ) const;
+
+private:
+    std::vector<Node> mNodes;
+    std::vector<Triangle> mTriangles;
+    AABB mBounds;
+    BVHStats mStats;
+    uint64_t mChecksum = 0;
+
+    template< bool anyHit >
+    bool Traverse( const BVHRay &ray, BVHHit &hit ) const;
+};
+
+#endif
@@ -0,0 +1,488 @@
+#include <Core/BilateralUpsample.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define UPSAMPLE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const float LOG2E = 1.44269504f;
+
+    // low res color and guide values at low res texel centers, planar for simd gathers
+    struct UpsampleGuide
+    {
+        int mWidth = 0;
+        int mHeight = 0;
+        std::vector<float> mPlanes[8]; // r, g, b, a, depth, nx, ny, nz
+    };
+
+    // range weight terms, sharpness premultiplied by log2( e ) to use exp2
+    struct RangeParams
+    {
+        float mDepthK;
+        float mNormalK;
+    };
+
+    int Clamp( int v, int lo, int hi )
+    {
+        return v < lo ? lo : ( v > hi ? hi : v );
+    }
+
+    // point sampling of a texture with size dst at texel center of a texture with size src
+    int PointSample( int texel, int src, int dst )
+    {
+        return Clamp( static_cast< int >( ( texel + 0.5f ) * dst / src ), 0, dst - 1 );
+    }
+
+    // 2^x with 5th order polynomial, relative error below 1e-4, plenty for filter weights
+    float FastExp2( float x )
+    {
+        x = std::max( -126.0f, std::min( 126.0f, x ) );
+        float xi = std::floor( x );
+        float f = x - xi;
+        float p = 1.0f + f * ( 0.693147182f + f * ( 0.240226507f + f * ( 0.0555041087f + f * ( 0.00961812911f + f * 0.00133335581f ) ) ) );
+
+        int bits = ( static_cast< int >( xi ) + 127 ) << 23;
+        float scale;
+        memcpy( &scale, &bits, sizeof( scale ) );
+        return p * scale;
+    }
+
+#ifdef UPSAMPLE_SSE
+    __m128 FastExp2SSE( __m128 x )
+    {
+        x = _mm_max_ps( _mm_set1_ps( -126.0f ), _mm_min_ps( _mm_set1_ps( 126.0f ), x ) );
+
+        // floor without sse4.1
+        __m128 xi = _mm_cvtepi32_ps( _mm_cvttps_epi32( x ) );
+        xi = _mm_sub_ps( xi, _mm_and_ps( _mm_cmpgt_ps( xi, x ), _mm_set1_ps( 1.0f ) ) );
+        __m128 f = _mm_sub_ps( x, xi );
+
+        __m128 p = _mm_set1_ps( 0.00133335581f );
+        p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 0.00961812911f ) );
+        p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 0.0555041087f ) );
+        p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 0.240226507f ) );
+        p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 0.693147182f ) );
+        p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 1.0f ) );
+
+        __m128i bits = _mm_slli_epi32( _mm_add_epi32( _mm_cvttps_epi32( xi ), _mm_set1_epi32( 127 ) ), 23 );
+        return _mm_mul_ps( p, _mm_castsi128_ps( bits ) );
+    }
+#endif
+
+    void BuildGuide( const FloatImage &lowColor, const FloatImage &depth, const FloatImage &normal, UpsampleGuide &guide )
+    {
+        guide.mWidth = lowColor.mWidth;
+        guide.mHeight = lowColor.mHeight;
+
+        size_t count = static_cast< size_t >( guide.mWidth ) * guide.mHeight;
+        for ( int p = 0; p < 8; p++ )
+            guide.mPlanes[p].resize( count );
+
+        for ( int y = 0; y < guide.mHeight; y++ )
+        {
+            int dy = PointSample( y, guide.mHeight, depth.mHeight );
+            for ( int x = 0; x < guide.mWidth; x++ )
+            {
+                int dx = PointSample( x, guide.mWidth, depth.mWidth );
+                size_t i = static_cast< size_t >( y ) * guide.mWidth + x;
+
+                const float *col = lowColor.GetPixel( x, y );
+                for ( int c = 0; c < 4; c++ )
+                    guide.mPlanes[c][i] = c < lowColor.mChannels ? col[c] : 0.0f;
+
+                guide.mPlanes[4][i] = depth.GetPixel( dx, dy )[0];
+
+                const float *n = normal.GetPixel( dx, dy );
+                guide.mPlanes[5][i] = n[0];
+                guide.mPlanes[6][i] = n[1];
+                guide.mPlanes[7][i] = n[2];
+            }
+        }
+    }
+
+    // low res base texel and quantized phase of full res pixel center
+    void GetBaseAndPhase( int pixel, float scale, int &base, int &phase )
+    {
+        float p = ( pixel + 0.5f ) * scale - 0.5f;
+        float b = std::floor( p );
+        base = static_cast< int >( b );
+        phase = std::min( static_cast< int >( ( p - b ) * UPSAMPLE_PHASES ), UPSAMPLE_PHASES - 1 );
+    }
+
+    void UpsamplePixel( const UpsampleGuide &guide, const FloatImage &depth, const FloatImage &normal,
+        const UpsampleWeights &weights, const RangeParams &range, int x, int y, int baseY, const float *weightsY, float *out )
+    {
+        int baseX, phaseX;
+        GetBaseAndPhase( x, static_cast< float >( guide.mWidth ) / depth.mWidth, baseX, phaseX );
+        const float *weightsX = &weights.mWeights[0][phaseX * UPSAMPLE_TAPS];
+
+        float centerDepth = depth.GetPixel( x, y )[0];
+        const float *centerNormal = normal.GetPixel( x, y );
+
+        float colSum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float weightSum = 0.0f;
+
+        int taps = 2 * weights.mRadius + 2;
+        for ( int ty = 0; ty < taps; ty++ )
+        {
+            int sy = Clamp( baseY + ty - weights.mRadius, 0, guide.mHeight - 1 );
+            size_t row = static_cast< size_t >( sy ) * guide.mWidth;
+
+            for ( int tx = 0; tx < taps; tx++ )
+            {
+                size_t i = row + Clamp( baseX + tx - weights.mRadius, 0, guide.mWidth - 1 );
+
+                float ddiff = guide.mPlanes[4][i] - centerDepth;
+                float ndot = guide.mPlanes[5][i] * centerNormal[0] + guide.mPlanes[6][i] * centerNormal[1] + guide.mPlanes[7][i] * centerNormal[2];
+                float r = FastExp2( -ddiff * ddiff * range.mDepthK - ( 1.0f - ndot ) * range.mNormalK );
+                float w = weightsX[tx] * weightsY[ty] * ( r + UPSAMPLE_EPSILON );
+
+                for ( int c = 0; c < 4; c++ )
+                    colSum[c] += guide.mPlanes[c][i] * w;
+                weightSum += w;
+            }
+        }
+
+        float inv = weightSum > 0.0f ? 1.0f / weightSum : 0.0f;
+        for ( int c = 0; c < 4; c++ )
+            out[c] = colSum[c] * inv;
+    }
+
+#ifdef UPSAMPLE_SSE
+    // 4 horizontally adjacent output pixels, one per lane
+    void UpsamplePixelsSSE( const UpsampleGuide &guide, const FloatImage &depth, const FloatImage &normal,
+        const UpsampleWeights &weights, const RangeParams &range, int x, int y, int baseY, const float *weightsY, float *out )
+    {
+        float scaleX = static_cast< float >( guide.mWidth ) / depth.mWidth;
+
+        int baseX[4];
+        const float *weightsX[4];
+        for ( int l = 0; l < 4; l++ )
+        {
+            int phaseX;
+            GetBaseAndPhase( x + l, scaleX, baseX[l], phaseX );
+            weightsX[l] = &weights.mWeights[0][phaseX * UPSAMPLE_TAPS];
+        }
+
+        const float *cd = depth.GetPixel( x, y );
+        const float *cn = normal.GetPixel( x, y );
+        int nc = normal.mChannels;
+        __m128 centerDepth = _mm_setr_ps( cd[0], cd[depth.mChannels], cd[2 * depth.mChannels], cd[3 * depth.mChannels] );
+        __m128 centerNX = _mm_setr_ps( cn[0], cn[nc], cn[2 * nc], cn[3 * nc] );
+        __m128 centerNY = _mm_setr_ps( cn[1], cn[nc + 1], cn[2 * nc + 1], cn[3 * nc + 1] );
+        __m128 centerNZ = _mm_setr_ps( cn[2], cn[nc + 2], cn[2 * nc + 2], cn[3 * nc + 2] );
+
+        __m128 depthK = _mm_set1_ps( range.mDepthK );
+        __m128 normalK = _mm_set1_ps( range.mNormalK );
+        __m128 one = _mm_set1_ps( 1.0f );
+        __m128 eps = _mm_set1_ps( UPSAMPLE_EPSILON );
+
+        __m128 colSum[4] = { _mm_setzero_ps( ), _mm_setzero_ps( ), _mm_setzero_ps( ), _mm_setzero_ps( ) };
+        __m128 weightSum = _mm_setzero_ps( );
+
+        const std::vector<float> *planes = guide.mPlanes;
+        int taps = 2 * weights.mRadius + 2;
+        for ( int ty = 0; ty < taps; ty++ )
+        {
+            int sy = Clamp( baseY + ty - weights.mRadius, 0, guide.mHeight - 1 );
+            size_t row = static_cast< size_t >( sy ) * guide.mWidth;
+            __m128 wy = _mm_set1_ps( weightsY[ty] );
+
+            for ( int tx = 0; tx < taps; tx++ )
+            {
+                size_t i[4];
+                for ( int l = 0; l < 4; l++ )
+                    i[l] = row + Clamp( baseX[l] + tx - weights.mRadius, 0, guide.mWidth - 1 );
+
+                #define GATHER( p ) _mm_setr_ps( planes[p][i[0]], planes[p][i[1]], planes[p][i[2]], planes[p][i[3]] )
+
+                __m128 ddiff = _mm_sub_ps( GATHER( 4 ), centerDepth );
+                __m128 ndot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( GATHER( 5 ), centerNX ), _mm_mul_ps( GATHER( 6 ), centerNY ) ),
+                    _mm_mul_ps( GATHER( 7 ), centerNZ ) );
+                __m128 e = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( ddiff, ddiff ), depthK ), _mm_mul_ps( _mm_sub_ps( one, ndot ), normalK ) );
+                __m128 r = FastExp2SSE( _mm_sub_ps( _mm_setzero_ps( ), e ) );
+
+                __m128 wx = _mm_setr_ps( weightsX[0][tx], weightsX[1][tx], weightsX[2][tx], weightsX[3][tx] );
+                __m128 w = _mm_mul_ps( _mm_mul_ps( wx, wy ), _mm_add_ps( r, eps ) );
+
+                for ( int c = 0; c < 4; c++ )
+                    colSum[c] = _mm_add_ps( colSum[c], _mm_mul_ps( GATHER( c ), w ) );
+                weightSum = _mm_add_ps( weightSum, w );
+
+                #undef GATHER
+            }
+        }
+
+        // back to interleaved rgba
+        __m128 inv = _mm_and_ps( _mm_div_ps( one, weightSum ), _mm_cmpgt_ps( weightSum, _mm_setzero_ps( ) ) );
+        for ( int c = 0; c < 4; c++ )
+            colSum[c] = _mm_mul_ps( colSum[c], inv );
+        _MM_TRANSPOSE4_PS( colSum[0], colSum[1], colSum[2], colSum[3] );
+        for ( int l = 0; l < 4; l++ )
+            _mm_storeu_ps( out + l * 4, colSum[l] );
+    }
+#endif
+
+    // one pass of the legacy blur, point samples at full res offsets
+    void LegacyBlurPass( const FloatImage &lowColor, const FloatImage &depth, const UpsampleParams &params,
+        int x, int y, int dirX, int dirY, float *out )
+    {
+        float sigma = ( params.mRadius + 1.0f ) * 0.5f;
+        float falloff = 1.0f / ( 2.0f * sigma * sigma );
+        float centerDepth = depth.GetPixel( x, y )[0];
+
+        float colSum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float weightSum = 0.0f;
+
+        for ( float r = -params.mRadius; r <= params.mRadius; ++r )
+        {
+            // uv = ( pixel + 0.5 + r ) / size, point sampling takes floor( uv * size )
+            int sx = Clamp( static_cast< int >( std::floor( x + 0.5f + r * dirX ) ), 0, depth.mWidth - 1 );
+            int sy = Clamp( static_cast< int >( std::floor( y + 0.5f + r * dirY ) ), 0, depth.mHeight - 1 );
+
+            float ddiff = depth.GetPixel( sx, sy )[0] - centerDepth;
+            float weight = std::exp( -r * r * falloff - ddiff * ddiff * params.mDepthSharpness );
+
+            const float *col = lowColor.GetPixel( PointSample( sx, depth.mWidth, lowColor.mWidth ), PointSample( sy, depth.mHeight, lowColor.mHeight ) );
+            for ( int c = 0; c < 4; c++ )
+                colSum[c] += ( c < lowColor.mChannels ? col[c] : 0.0f ) * weight;
+            weightSum += weight;
+        }
+
+        for ( int c = 0; c < 4; c++ )
+            out[c] = colSum[c] / weightSum;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FloatImage::Resize( int width, int height, int channels )
+{
+    mWidth = width;
+    mHeight = height;
+    mChannels = channels;
+    mData.assign( static_cast< size_t >( width ) * height * channels, 0.0f );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float* FloatImage::GetPixel( int x, int y )
+{
+    return &mData[( static_cast< size_t >( y ) * mWidth + x ) * mChannels];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const float* FloatImage::GetPixel( int x, int y ) const
+{
+    return &mData[( static_cast< size_t >( y ) * mWidth + x ) * mChannels];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UpsampleWeights::Build( float radius, float scaleX, float scaleY )
+{
+    float sigma = ( radius + 1.0f ) * 0.5f;
+    float falloff = 1.0f / ( 2.0f * sigma * sigma );
+
+    // taps reach floor( p ) - mRadius .. floor( p ) + mRadius + 1, enough for texel centers within the cutoff
+    float maxScale = std::max( scaleX, scaleY );
+    mRadius = Clamp( static_cast< int >( std::ceil( radius * maxScale + 0.5f ) ) - 1, 1, UPSAMPLE_MAX_RADIUS );
+
+    const float scales[2] = { scaleX, scaleY };
+    for ( int axis = 0; axis < 2; axis++ )
+    {
+        // texel centers up to half a low res texel outside the radius still cover pixels inside it
+        float cutoff = radius + 0.5f / scales[axis];
+
+        for ( int phase = 0; phase < UPSAMPLE_PHASES; phase++ )
+        {
+            float offset = ( phase + 0.5f ) / UPSAMPLE_PHASES;
+            float *w = &mWeights[axis][phase * UPSAMPLE_TAPS];
+
+            for ( int t = 0; t < UPSAMPLE_TAPS; t++ )
+            {
+                float d = ( t - mRadius - offset ) / scales[axis]; // full res pixels
+                bool used = t < 2 * mRadius + 2 && std::fabs( d ) <= cutoff;
+                w[t] = used ? std::exp( -d * d * falloff ) : 0.0f;
+            }
+        }
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool IsUpsampleSimdSupported( )
+{
+#ifdef UPSAMPLE_SSE
+    return true;
+#else
+    return false;
+#endif
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void JointBilateralUpsample( const FloatImage &lowColor, const FloatImage &depth, const FloatImage &normal,
+    const UpsampleWeights &weights, const UpsampleParams &params, FloatImage &out, bool useSimd )
+{
+    out.Resize( depth.mWidth, depth.mHeight, 4 );
+    if ( lowColor.mWidth == 0 || lowColor.mHeight == 0 || depth.mWidth == 0 || depth.mHeight == 0 )
+        return;
+
+    UpsampleGuide guide;
+    BuildGuide( lowColor, depth, normal, guide );
+
+    RangeParams range;
+    range.mDepthK = params.mDepthSharpness * LOG2E;
+    range.mNormalK = params.mNormalSharpness * LOG2E;
+
+    float scaleY = static_cast< float >( lowColor.mHeight ) / depth.mHeight;
+
+    for ( int y = 0; y < depth.mHeight; y++ )
+    {
+        int baseY, phaseY;
+        GetBaseAndPhase( y, scaleY, baseY, phaseY );
+        const float *weightsY = &weights.mWeights[1][phaseY * UPSAMPLE_TAPS];
+
+        int x = 0;
+#ifdef UPSAMPLE_SSE
+        if ( useSimd )
+        {
+            for ( ; x + 4 <= depth.mWidth; x += 4 )
+                UpsamplePixelsSSE( guide, depth, normal, weights, range, x, y, baseY, weightsY, out.GetPixel( x, y ) );
+        }
+#endif
+        for ( ; x < depth.mWidth; x++ )
+            UpsamplePixel( guide, depth, normal, weights, range, x, y, baseY, weightsY, out.GetPixel( x, y ) );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LegacyUpscaleBlur( const FloatImage &lowColor, const FloatImage &depth, const UpsampleParams &params, FloatImage &out )
+{
+    out.Resize( depth.mWidth, depth.mHeight, 4 );
+
+    for ( int y = 0; y < depth.mHeight; y++ )
+    {
+        for ( int x = 0; x < depth.mWidth; x++ )
+        {
+            float blurX[4], blurY[4];
+            LegacyBlurPass( lowColor, depth, params, x, y, 1, 0, blurX );
+            LegacyBlurPass( lowColor, depth, params, x, y, 0, 1, blurY );
+
+            float *o = out.GetPixel( x, y );
+            for ( int c = 0; c < 4; c++ )
+                o[c] = ( blurX[c] + blurY[c] ) * 0.5f;
+        }
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+UpsampleBenchmarkResult RunUpsampleBenchmark( int lowWidth, int lowHeight, int highWidth, int highHeight, int iterations )
+{
+    typedef std::chrono::steady_clock Clock;
+
+    UpsampleBenchmarkResult result;
+    result.mLowWidth = lowWidth;
+    result.mLowHeight = lowHeight;
+    result.mHighWidth = highWidth;
+    result.mHighHeight = highHeight;
+    iterations = std::max( iterations, 1 );
+
+    // floor plane with a closer box in the middle facing the camera, box side faces have another normal
+    FloatImage depth, normal;
+    depth.Resize( highWidth, highHeight, 1 );
+    normal.Resize( highWidth, highHeight, 3 );
+    for ( int y = 0; y < highHeight; y++ )
+    {
+        for ( int x = 0; x < highWidth; x++ )
+        {
+            float u = ( x + 0.5f ) / highWidth, v = ( y + 0.5f ) / highHeight;
+            bool box = u > 0.3f && u < 0.6f && v > 0.25f && v < 0.7f;
+            bool side = box && u > 0.55f;
+
+            depth.GetPixel( x, y )[0] = box ? 0.95f + 0.01f * u : 0.99f + 0.005f * v;
+
+            float *n = normal.GetPixel( x, y );
+            n[0] = side ? 1.0f : 0.0f;
+            n[1] = box ? 0.0f : 1.0f;
+            n[2] = box && !side ? 1.0f : 0.0f;
+        }
+    }
+
+    // noisy low res irradiance, as cone tracing with few cones would give
+    std::mt19937 rng( 1234 );
+    std::uniform_real_distribution<float> noise( -0.1f, 0.1f );
+    FloatImage lowColor;
+    lowColor.Resize( lowWidth, lowHeight, 4 );
+    for ( int y = 0; y < lowHeight; y++ )
+    {
+        for ( int x = 0; x < lowWidth; x++ )
+        {
+            int dx = PointSample( x, lowWidth, highWidth ), dy = PointSample( y, lowHeight, highHeight );
+            float d = depth.GetPixel( dx, dy )[0];
+            const float *n = normal.GetPixel( dx, dy );
+
+            float *c = lowColor.GetPixel( x, y );
+            c[0] = 0.3f + 0.5f * n[0] + noise( rng );
+            c[1] = 0.2f + 0.4f * n[1] + noise( rng );
+            c[2] = 0.1f + 0.6f * n[2] + ( 1.0f - d ) * 5.0f + noise( rng );
+            c[3] = 1.0f;
+        }
+    }
+
+    UpsampleParams params;
+    UpsampleWeights weights;
+    weights.Build( params.mRadius, static_cast< float >( lowWidth ) / highWidth, static_cast< float >( lowHeight ) / highHeight );
+    result.mTaps = ( 2 * weights.mRadius + 2 ) * ( 2 * weights.mRadius + 2 );
+
+    double pixels = static_cast< double >( highWidth ) * highHeight * iterations;
+    auto measure = [&]( FloatImage &out, int path ) -> double
+    {
+        Clock::time_point start = Clock::now( );
+        for ( int it = 0; it < iterations; it++ )
+        {
+            if ( path == 0 )
+                LegacyUpscaleBlur( lowColor, depth, params, out );
+            else
+                JointBilateralUpsample( lowColor, depth, normal, weights, params, out, path == 2 );
+        }
+        double seconds = std::chrono::duration< double >( Clock::now( ) - start ).count( );
+        return seconds > 0.0 ? pixels / seconds * 1e-6 : 0.0;
+    };
+
+    FloatImage legacy, scalar, simd;
+    result.mLegacyMPixels = measure( legacy, 0 );
+    result.mScalarMPixels = measure( scalar, 1 );
+    if ( IsUpsampleSimdSupported( ) )
+        result.mSimdMPixels = measure( simd, 2 );
+
+    // rgb error against the legacy output
+    double errorSum = 0.0, squaredSum = 0.0;
+    size_t count = 0;
+    for ( int y = 0; y < highHeight; y++ )
+    {
+        for ( int x = 0; x < highWidth; x++ )
+        {
+            const float *a = legacy.GetPixel( x, y );
+            const float *b = scalar.GetPixel( x, y );
+            for ( int c = 0; c < 3; c++ )
+            {
+                double e = std::fabs( static_cast< double >( a[c] ) - b[c] );
+                errorSum += e;
+                squaredSum += e * e;
+                result.mMaxError = std::max( result.mMaxError, e );
+                count++;
+            }
+
+            if ( IsUpsampleSimdSupported( ) )
+            {
+                const float *s = simd.GetPixel( x, y );
+                for ( int c = 0; c < 4; c++ )
+                    result.mSimdMaxError = std::max( result.mSimdMaxError, std::fabs( static_cast< double >( s[c] ) - b[c] ) );
+            }
+        }
+    }
+
+    result.mMeanError = count ? errorSum / count : 0.0;
+    double mse = count ? squaredSum / count : 0.0;
+    result.mPSNR = mse > 0.0 ? 10.0 * std::log10( 1.0 / mse ) : 0.0;
+
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
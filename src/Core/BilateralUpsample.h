@@ -0,0 +1,75 @@
+#ifndef __BILATERAL_UPSAMPLE_H
+#define __BILATERAL_UPSAMPLE_H
+
+#include <stddef.h>
+#include <vector>
+
+// must match defines in blur.fx
+#define UPSAMPLE_MAX_RADIUS 8 // low res taps on each side of the base texel
+#define UPSAMPLE_PHASES 8 // subpixel phase quantization of the weight lut
+#define UPSAMPLE_TAPS ( 2 * UPSAMPLE_MAX_RADIUS + 2 )
+#define UPSAMPLE_EPSILON 1e-4f // keeps spatial weight alive when all range weights vanish
+
+// interleaved float image
+struct FloatImage
+{
+    void Resize( int width, int height, int channels );
+
+    float* GetPixel( int x, int y );
+    const float* GetPixel( int x, int y ) const;
+
+    int mWidth = 0;
+    int mHeight = 0;
+    int mChannels = 0;
+    std::vector<float> mData;
+};
+
+// separable gaussian spatial weights, indexed by [axis][phase * UPSAMPLE_TAPS + tap]
+// tap t is the low res texel floor( p ) + t - mRadius, p - low res position of full res pixel center
+struct UpsampleWeights
+{
+    // radius in full res pixels, scale - low res size / full res size per axis
+    void Build( float radius, float scaleX, float scaleY );
+
+    int mRadius = 0;
+    float mWeights[2][UPSAMPLE_PHASES * UPSAMPLE_TAPS];
+};
+
+struct UpsampleParams
+{
+    float mRadius = 6.0f; // full res pixels
+    float mDepthSharpness = 100000.0f;
+    float mNormalSharpness = 16.0f;
+};
+
+struct UpsampleBenchmarkResult
+{
+    int mLowWidth = 0, mLowHeight = 0;
+    int mHighWidth = 0, mHighHeight = 0;
+    int mTaps = 0; // per output pixel
+
+    // joint bilateral upsample against legacy BlurX/BlurY output
+    double mMeanError = 0.0;
+    double mMaxError = 0.0;
+    double mPSNR = 0.0;
+    double mSimdMaxError = 0.0; // simd against scalar path
+
+    double mLegacyMPixels = 0.0; // per second
+    double mScalarMPixels = 0.0;
+    double mSimdMPixels = 0.0; // 0 when simd isn't compiled in
+};
+
+// joint bilateral upsample of lowColor (rgba) guided by full res depth (1 channel) and signed normal (3 channels)
+// range weight is exp( -ddepth^2 * depthSharpness - ( 1 - dot( n, nCenter ) ) * normalSharpness )
+void JointBilateralUpsample( const FloatImage &lowColor, const FloatImage &depth, const FloatImage &normal,
+    const UpsampleWeights &weights, const UpsampleParams &params, FloatImage &out, bool useSimd = true );
+
+// cpu copy of the former two pass blur.fx (BlurX into tmp, BlurY averaged with it) for comparison
+void LegacyUpscaleBlur( const FloatImage &lowColor, const FloatImage &depth, const UpsampleParams &params, FloatImage &out );
+
+bool IsUpsampleSimdSupported( );
+
+// synthetic scene with depth/normal discontinuities
+UpsampleBenchmarkResult RunUpsampleBenchmark( int lowWidth, int lowHeight, int highWidth, int highHeight, int iterations );
+
+#endif
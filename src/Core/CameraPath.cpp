@@ -0,0 +1,248 @@
+#include <Core/CameraPath.h>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    const float kPi = 3.14159265f;
+
+    float CatmullRom( float p0, float p1, float p2, float p3, float t )
+    {
+        float t2 = t * t;
+        float t3 = t2 * t;
+        return 0.5f * ( 2.0f * p1 + ( p2 - p0 ) * t + ( 2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3 ) * t2 +
+            ( 3.0f * p1 - p0 - 3.0f * p2 + p3 ) * t3 );
+    }
+
+    // angle + 2pi*k closest to reference
+    float Unwrap( float angle, float reference )
+    {
+        while ( angle - reference > kPi )
+            angle -= 2.0f * kPi;
+        while ( angle - reference < -kPi )
+            angle += 2.0f * kPi;
+        return angle;
+    }
+
+    float Wrap( float angle )
+    {
+        return Unwrap( angle, 0.0f );
+    }
+
+    // values of a key in interpolation order
+    const int kChannels = 7;
+
+    void ToChannels( const CameraKey &key, float c[kChannels] )
+    {
+        c[0] = key.mPosition[0];
+        c[1] = key.mPosition[1];
+        c[2] = key.mPosition[2];
+        c[3] = key.mTheta;
+        c[4] = key.mPhi;
+        c[5] = key.mSunYaw;
+        c[6] = key.mSunPitch;
+    }
+
+    bool IsAngleChannel( int c )
+    {
+        return c == 3 || c == 5;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CameraKey::CameraKey( )
+{
+    mPosition[0] = mPosition[1] = mPosition[2] = 0.0f;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CameraPath::Clear( )
+{
+    mKeys.clear( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CameraPath::AddKey( const CameraKey &key )
+{
+    mKeys.push_back( key );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t CameraPath::GetKeyCount( ) const
+{
+    return mKeys.size( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const CameraKey& CameraPath::GetKey( size_t i ) const
+{
+    return mKeys[i];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float CameraPath::GetDuration( ) const
+{
+    return mKeys.empty( ) ? 0.0f : mKeys.back( ).mTime - mKeys.front( ).mTime;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CameraKey CameraPath::Evaluate( float time ) const
+{
+    if ( mKeys.empty( ) )
+        return CameraKey( );
+
+    float start = mKeys.front( ).mTime;
+    float t = start + time;
+    if ( t <= start || mKeys.size( ) == 1 )
+        return mKeys.front( );
+    if ( t >= mKeys.back( ).mTime )
+        return mKeys.back( );
+
+    // segment i, i + 1 holds t, missing neighbours at path ends are mirrored
+    size_t i = 0;
+    while ( i + 2 < mKeys.size( ) && mKeys[i + 1].mTime <= t )
+        i++;
+
+    const CameraKey &k1 = mKeys[i];
+    const CameraKey &k2 = mKeys[i + 1];
+    const CameraKey &k0 = i > 0 ? mKeys[i - 1] : k1;
+    const CameraKey &k3 = i + 2 < mKeys.size( ) ? mKeys[i + 2] : k2;
+    bool hasPrev = i > 0;
+    bool hasNext = i + 2 < mKeys.size( );
+
+    float span = k2.mTime - k1.mTime;
+    float u = span > 0.0f ? ( t - k1.mTime ) / span : 1.0f;
+
+    float c0[kChannels], c1[kChannels], c2[kChannels], c3[kChannels], out[kChannels];
+    ToChannels( k0, c0 );
+    ToChannels( k1, c1 );
+    ToChannels( k2, c2 );
+    ToChannels( k3, c3 );
+
+    for ( int c = 0; c < kChannels; c++ )
+    {
+        if ( IsAngleChannel( c ) )
+        {
+            c0[c] = Unwrap( c0[c], c1[c] );
+            c2[c] = Unwrap( c2[c], c1[c] );
+            c3[c] = Unwrap( c3[c], c2[c] );
+        }
+        if ( !hasPrev )
+            c0[c] = 2.0f * c1[c] - c2[c];
+        if ( !hasNext )
+            c3[c] = 2.0f * c2[c] - c1[c];
+        out[c] = CatmullRom( c0[c], c1[c], c2[c], c3[c], u );
+    }
+
+    CameraKey key;
+    key.mTime = time;
+    key.mPosition[0] = out[0];
+    key.mPosition[1] = out[1];
+    key.mPosition[2] = out[2];
+    key.mTheta = Wrap( out[3] );
+    key.mPhi = out[4];
+    key.mSunYaw = out[5];
+    key.mSunPitch = out[6];
+    return key;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string CameraPath::Write( ) const
+{
+    std::ostringstream out;
+    out.precision( 9 );
+    out << "# time x y z theta phi sun_yaw sun_pitch\n";
+    for ( auto &key : mKeys )
+    {
+        out << key.mTime << " " << key.mPosition[0] << " " << key.mPosition[1] << " " << key.mPosition[2] << " "
+            << key.mTheta << " " << key.mPhi << " " << key.mSunYaw << " " << key.mSunPitch << "\n";
+    }
+    return out.str( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CameraPath::Parse( const std::string &text, std::string &error )
+{
+    std::vector<CameraKey> keys;
+    std::istringstream in( text );
+    std::string line;
+    int lineNumber = 0;
+
+    while ( std::getline( in, line ) )
+    {
+        lineNumber++;
+        size_t first = line.find_first_not_of( " \t\r" );
+        if ( first == std::string::npos || line[first] == '#' )
+            continue;
+
+        CameraKey key;
+        std::istringstream values( line );
+        values >> key.mTime >> key.mPosition[0] >> key.mPosition[1] >> key.mPosition[2]
+            >> key.mTheta >> key.mPhi >> key.mSunYaw >> key.mSunPitch;
+
+        std::string rest;
+        if ( values.fail( ) || ( values >> rest ) )
+        {
+            std::ostringstream out;
+            out << "line " << lineNumber << ": expected 8 numbers";
+            error = out.str( );
+            return false;
+        }
+        if ( !keys.empty( ) && key.mTime < keys.back( ).mTime )
+        {
+            std::ostringstream out;
+            out << "line " << lineNumber << ": time goes back";
+            error = out.str( );
+            return false;
+        }
+        keys.push_back( key );
+    }
+
+    mKeys.swap( keys );
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CameraPath::Save( const char *fn ) const
+{
+    std::ofstream file( fn );
+    file << Write( );
+    return file.good( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CameraPath::Load( const char *fn, std::string &error )
+{
+    std::ifstream file( fn );
+    if ( !file.is_open( ) )
+    {
+        error = std::string( "can't open " ) + fn;
+        return false;
+    }
+
+    std::ostringstream text;
+    text << file.rdbuf( );
+    return Parse( text.str( ), error );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CameraPathRecorder::CameraPathRecorder( float interval ):
+    mInterval( interval )
+{
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CameraPathRecorder::Record( float time, const CameraKey &state )
+{
+    if ( !mStarted )
+    {
+        mStarted = true;
+        mStartTime = time;
+        mPath.Clear( );
+    }
+
+    mLast = state;
+    mLast.mTime = time - mStartTime;
+
+    size_t count = mPath.GetKeyCount( );
+    if ( count == 0 || mLast.mTime - mPath.GetKey( count - 1 ).mTime >= mInterval )
+        mPath.AddKey( mLast );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const CameraPath& CameraPathRecorder::Finish( )
+{
+    size_t count = mPath.GetKeyCount( );
+    if ( count > 0 && mPath.GetKey( count - 1 ).mTime < mLast.mTime )
+        mPath.AddKey( mLast );
+    mStarted = false;
+    return mPath;
+}
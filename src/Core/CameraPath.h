@@ -0,0 +1,64 @@
+#ifndef __CAMERA_PATH_H
+#define __CAMERA_PATH_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// camera and sun at a moment of a path, angles are the ones of Camera::SetDegrees and Settings sun
+struct CameraKey
+{
+    float mTime = 0.0f; // seconds from path start
+    float mPosition[3];
+    float mTheta = 0.0f; // yaw, wraps at +-pi
+    float mPhi = 0.0f; // pitch
+    float mSunYaw = 0.0f;
+    float mSunPitch = 0.0f;
+
+    CameraKey( );
+};
+
+// keyframed camera path, played back with catmull-rom interpolation
+class CameraPath
+{
+public:
+    void Clear( );
+    void AddKey( const CameraKey &key ); // keys go in time order
+
+    size_t GetKeyCount( ) const;
+    const CameraKey& GetKey( size_t i ) const;
+    float GetDuration( ) const;
+
+    // angles take the shorter way around, time is clamped to the path
+    CameraKey Evaluate( float time ) const;
+
+    // text, one key per line: time x y z theta phi sun_yaw sun_pitch
+    std::string Write( ) const;
+    bool Parse( const std::string &text, std::string &error );
+    bool Save( const char *fn ) const;
+    bool Load( const char *fn, std::string &error );
+
+private:
+    std::vector<CameraKey> mKeys;
+};
+
+// samples a live camera into a sparse path
+class CameraPathRecorder
+{
+public:
+    explicit CameraPathRecorder( float interval = 0.25f );
+
+    // time is any monotonic clock, path starts at the first call
+    void Record( float time, const CameraKey &state );
+    // adds the last sample, so the path ends where recording ended
+    const CameraPath& Finish( );
+
+private:
+    CameraPath mPath;
+    CameraKey mLast;
+    float mInterval;
+    float mStartTime = 0.0f;
+    bool mStarted = false;
+};
+
+#endif
@@ -0,0 +1,443 @@
+#include <Core/CompactVertex.h>
+#include <GlobalUtils.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <float.h>
+#include <random>
+#include <string.h>
+#include <vector>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define COMPACT_VERTEX_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const float kSnormScale = 127.0f;
+    const float kUnormMax = 65535.0f;
+
+    // half conversion constants (Giesen, "float->half variants"), shared by scalar and simd so they round identically
+    const uint32_t kHalfMaxBits = ( 127 + 16 ) << 23; // first float that is inf in half
+    const uint32_t kFloatInfBits = 255 << 23;
+    const uint32_t kHalfDenormLimit = 113 << 23; // below this half is denormal
+    const uint32_t kDenormMagicBits = ( ( 127 - 15 ) + ( 23 - 10 ) + 1 ) << 23;
+    const uint32_t kRebiasBits = ( uint32_t( 15 - 127 ) << 23 ) + 0xfff;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    uint32_t FloatBits( float value )
+    {
+        uint32_t bits;
+        memcpy( &bits, &value, sizeof( bits ) );
+        return bits;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    float BitsFloat( uint32_t bits )
+    {
+        float value;
+        memcpy( &value, &bits, sizeof( value ) );
+        return value;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void GetEncodeScale( const CompactVertexBounds &bounds, float scale[3] )
+    {
+        for ( int a = 0; a < 3; a++ )
+            scale[a] = bounds.mStep[a] > 0.0f ? 1.0f / bounds.mStep[a] : 0.0f;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    int8_t ToSnorm8( float value )
+    {
+        value = ( std::min )( ( std::max )( value, -1.0f ), 1.0f );
+        return static_cast< int8_t >( static_cast< int >( value * kSnormScale + ( value >= 0.0f ? 0.5f : -0.5f ) ) );
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void EncodeScalar( const SceneVertex *vertices, size_t begin, size_t end, const CompactVertexBounds &bounds, uint16_t boundsSlot,
+        CompactVertex *out )
+    {
+        float scale[3];
+        GetEncodeScale( bounds, scale );
+
+        for ( size_t i = begin; i < end; i++ )
+        {
+            const SceneVertex &v = vertices[i];
+            CompactVertex &c = out[i];
+            for ( int a = 0; a < 3; a++ )
+            {
+                float q = ( v.mPosition[a] - bounds.mMin[a] ) * scale[a] + 0.5f;
+                q = ( std::min )( ( std::max )( q, 0.0f ), kUnormMax );
+                c.mPosition[a] = static_cast< uint16_t >( static_cast< int >( q ) );
+            }
+            c.mBoundsSlot = boundsSlot;
+            EncodeOctahedral( v.mNormal, c.mNormal );
+            EncodeOctahedral( v.mBinormal, c.mBinormal );
+            c.mUV[0] = FloatToHalf( v.mUV[0] );
+            c.mUV[1] = FloatToHalf( v.mUV[1] );
+        }
+    }
+
+#ifdef COMPACT_VERTEX_SSE
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    __m128 Select( __m128 mask, __m128 a, __m128 b )
+    {
+        return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    __m128i Select( __m128i mask, __m128i a, __m128i b )
+    {
+        return _mm_or_si128( _mm_and_si128( mask, a ), _mm_andnot_si128( mask, b ) );
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    __m128i ToSnorm8SSE( __m128 value )
+    {
+        const __m128 one = _mm_set1_ps( 1.0f );
+        value = _mm_min_ps( _mm_max_ps( value, _mm_set1_ps( -1.0f ) ), one );
+        __m128 half = Select( _mm_cmpge_ps( value, _mm_setzero_ps( ) ), _mm_set1_ps( 0.5f ), _mm_set1_ps( -0.5f ) );
+        return _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( value, _mm_set1_ps( kSnormScale ) ), half ) );
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // same operations as EncodeOctahedral for 4 directions
+    void EncodeOctahedralSSE( __m128 x, __m128 y, __m128 z, __m128i &u, __m128i &v )
+    {
+        const __m128 absMask = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+        const __m128 zero = _mm_setzero_ps( );
+        const __m128 one = _mm_set1_ps( 1.0f );
+        const __m128 minusOne = _mm_set1_ps( -1.0f );
+
+        __m128 l1 = _mm_add_ps( _mm_add_ps( _mm_and_ps( x, absMask ), _mm_and_ps( y, absMask ) ), _mm_and_ps( z, absMask ) );
+        __m128 inv = _mm_div_ps( one, _mm_max_ps( l1, _mm_set1_ps( FLT_MIN ) ) );
+        __m128 px = _mm_mul_ps( x, inv );
+        __m128 py = _mm_mul_ps( y, inv );
+
+        __m128 signX = Select( _mm_cmpge_ps( px, zero ), one, minusOne );
+        __m128 signY = Select( _mm_cmpge_ps( py, zero ), one, minusOne );
+        __m128 foldX = _mm_mul_ps( _mm_sub_ps( one, _mm_and_ps( py, absMask ) ), signX );
+        __m128 foldY = _mm_mul_ps( _mm_sub_ps( one, _mm_and_ps( px, absMask ) ), signY );
+        __m128 lower = _mm_cmplt_ps( z, zero );
+
+        u = ToSnorm8SSE( Select( lower, foldX, px ) );
+        v = ToSnorm8SSE( Select( lower, foldY, py ) );
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // same operations as FloatToHalf for 4 values, result is in the low 16 bits
+    __m128i FloatToHalfSSE( __m128 value )
+    {
+        __m128i bits = _mm_castps_si128( value );
+        __m128i sign = _mm_and_si128( bits, _mm_set1_epi32( int( 0x80000000u ) ) );
+        __m128i abs = _mm_xor_si128( bits, sign );
+
+        // abs has no sign bit, so signed compares work
+        __m128i infOrNan = _mm_cmpgt_epi32( abs, _mm_set1_epi32( int( kHalfMaxBits - 1 ) ) );
+        __m128i nan = _mm_cmpgt_epi32( abs, _mm_set1_epi32( int( kFloatInfBits ) ) );
+        __m128i special = Select( nan, _mm_set1_epi32( 0x7e00 ), _mm_set1_epi32( 0x7c00 ) );
+
+        __m128i denormal = _mm_cmplt_epi32( abs, _mm_set1_epi32( int( kHalfDenormLimit ) ) );
+        __m128 magic = _mm_castsi128_ps( _mm_set1_epi32( int( kDenormMagicBits ) ) );
+        __m128i denormalBits = _mm_sub_epi32( _mm_castps_si128( _mm_add_ps( _mm_castsi128_ps( abs ), magic ) ),
+            _mm_set1_epi32( int( kDenormMagicBits ) ) );
+
+        __m128i mantOdd = _mm_and_si128( _mm_srli_epi32( abs, 13 ), _mm_set1_epi32( 1 ) );
+        __m128i normalBits = _mm_srli_epi32( _mm_add_epi32( _mm_add_epi32( abs, _mm_set1_epi32( int( kRebiasBits ) ) ), mantOdd ), 13 );
+
+        __m128i result = Select( infOrNan, special, Select( denormal, denormalBits, normalBits ) );
+        return _mm_or_si128( result, _mm_srli_epi32( sign, 16 ) );
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void EncodeSSE( const SceneVertex *vertices, size_t count, const CompactVertexBounds &bounds, uint16_t boundsSlot,
+        CompactVertex *out )
+    {
+        float scale[3];
+        GetEncodeScale( bounds, scale );
+        __m128 minimum[3], scaleV[3];
+        for ( int a = 0; a < 3; a++ )
+        {
+            minimum[a] = _mm_set1_ps( bounds.mMin[a] );
+            scaleV[a] = _mm_set1_ps( scale[a] );
+        }
+        const __m128 zero = _mm_setzero_ps( );
+        const __m128 half = _mm_set1_ps( 0.5f );
+        const __m128 unormMax = _mm_set1_ps( kUnormMax );
+
+        size_t end = count & ~size_t( 3 );
+        for ( size_t i = 0; i < end; i += 4 )
+        {
+            const SceneVertex *v = vertices + i;
+
+            // vertices are interleaved, gather each component of 4 of them
+            int32_t position[3][4];
+            for ( int a = 0; a < 3; a++ )
+            {
+                __m128 p = _mm_set_ps( v[3].mPosition[a], v[2].mPosition[a], v[1].mPosition[a], v[0].mPosition[a] );
+                __m128 q = _mm_add_ps( _mm_mul_ps( _mm_sub_ps( p, minimum[a] ), scaleV[a] ), half );
+                q = _mm_min_ps( _mm_max_ps( q, zero ), unormMax );
+                _mm_storeu_si128( reinterpret_cast< __m128i* >( position[a] ), _mm_cvttps_epi32( q ) );
+            }
+
+            __m128i u, w;
+            int32_t normal[2][4], binormal[2][4];
+            EncodeOctahedralSSE( _mm_set_ps( v[3].mNormal[0], v[2].mNormal[0], v[1].mNormal[0], v[0].mNormal[0] ),
+                _mm_set_ps( v[3].mNormal[1], v[2].mNormal[1], v[1].mNormal[1], v[0].mNormal[1] ),
+                _mm_set_ps( v[3].mNormal[2], v[2].mNormal[2], v[1].mNormal[2], v[0].mNormal[2] ), u, w );
+            _mm_storeu_si128( reinterpret_cast< __m128i* >( normal[0] ), u );
+            _mm_storeu_si128( reinterpret_cast< __m128i* >( normal[1] ), w );
+            EncodeOctahedralSSE( _mm_set_ps( v[3].mBinormal[0], v[2].mBinormal[0], v[1].mBinormal[0], v[0].mBinormal[0] ),
+                _mm_set_ps( v[3].mBinormal[1], v[2].mBinormal[1], v[1].mBinormal[1], v[0].mBinormal[1] ),
+                _mm_set_ps( v[3].mBinormal[2], v[2].mBinormal[2], v[1].mBinormal[2], v[0].mBinormal[2] ), u, w );
+            _mm_storeu_si128( reinterpret_cast< __m128i* >( binormal[0] ), u );
+            _mm_storeu_si128( reinterpret_cast< __m128i* >( binormal[1] ), w );
+
+            int32_t uv[2][4];
+            for ( int a = 0; a < 2; a++ )
+            {
+                __m128 t = _mm_set_ps( v[3].mUV[a], v[2].mUV[a], v[1].mUV[a], v[0].mUV[a] );
+                _mm_storeu_si128( reinterpret_cast< __m128i* >( uv[a] ), FloatToHalfSSE( t ) );
+            }
+
+            for ( int k = 0; k < 4; k++ )
+            {
+                CompactVertex &c = out[i + k];
+                for ( int a = 0; a < 3; a++ )
+                    c.mPosition[a] = static_cast< uint16_t >( position[a][k] );
+                c.mBoundsSlot = boundsSlot;
+                for ( int a = 0; a < 2; a++ )
+                {
+                    c.mNormal[a] = static_cast< int8_t >( normal[a][k] );
+                    c.mBinormal[a] = static_cast< int8_t >( binormal[a][k] );
+                    c.mUV[a] = static_cast< uint16_t >( uv[a][k] );
+                }
+            }
+        }
+        EncodeScalar( vertices, end, count, bounds, boundsSlot, out );
+    }
+#endif
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    MathPath GetWidestPath( )
+    {
+#ifdef COMPACT_VERTEX_SSE
+        return IsMathPathSupported( MP_AVX ) ? MP_AVX : MP_SSE;
+#else
+        return MP_SCALAR;
+#endif
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    float AngleDegrees( const float a[3], const float b[3] )
+    {
+        float la = Length( Vec3( a[0], a[1], a[2] ) );
+        float lb = Length( Vec3( b[0], b[1], b[2] ) );
+        double cosine = ( double( a[0] ) * b[0] + double( a[1] ) * b[1] + double( a[2] ) * b[2] ) / ( double( la ) * lb );
+        return static_cast< float >( std::acos( ( std::min )( ( std::max )( cosine, -1.0 ), 1.0 ) ) * 180.0 / 3.14159265358979 );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void MeasureCompactVertexError( const std::vector<SceneVertex> &vertices, const std::vector<CompactVertex> &compact,
+    const CompactVertexBounds &bounds, CompactVertexBenchmarkResult &result )
+{
+    for ( size_t i = 0; i < vertices.size( ); i++ )
+    {
+        const SceneVertex &v = vertices[i];
+        SceneVertex d;
+        DecodeCompactVertex( compact[i], bounds, d );
+        for ( int a = 0; a < 3; a++ )
+        {
+            if ( bounds.mStep[a] > 0.0f )
+            {
+                float error = std::fabs( d.mPosition[a] - v.mPosition[a] ) / bounds.mStep[a];
+                result.mMaxPositionError = ( std::max )( result.mMaxPositionError, error );
+            }
+        }
+        result.mMaxNormalErrorDegrees = ( std::max )( result.mMaxNormalErrorDegrees, AngleDegrees( v.mNormal, d.mNormal ) );
+        result.mMaxNormalErrorDegrees = ( std::max )( result.mMaxNormalErrorDegrees, AngleDegrees( v.mBinormal, d.mBinormal ) );
+        for ( int a = 0; a < 2; a++ )
+        {
+            float error = std::fabs( d.mUV[a] - v.mUV[a] ) / ( std::max )( std::fabs( v.mUV[a] ), 1.0f / 16384.0f );
+            result.mMaxUVError = ( std::max )( result.mMaxUVError, error );
+        }
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// scattered triangle soup of a few meters with random frames and tiled uvs
+std::vector<SceneVertex> GenerateVertexSoup( size_t count, uint32_t seed )
+{
+    std::mt19937 rng( seed );
+    std::uniform_real_distribution<float> posDist( -1200.0f, 1200.0f );
+    std::uniform_real_distribution<float> uvDist( -4.0f, 4.0f );
+    std::normal_distribution<float> dirDist;
+
+    std::vector<SceneVertex> vertices( count );
+    for ( size_t i = 0; i < count; i++ )
+    {
+        SceneVertex &v = vertices[i];
+        for ( int a = 0; a < 3; a++ )
+        {
+            v.mPosition[a] = posDist( rng ) * ( a == 1 ? 0.25f : 1.0f );
+            v.mNormal[a] = dirDist( rng );
+            v.mBinormal[a] = dirDist( rng );
+        }
+        v.mUV[0] = uvDist( rng );
+        v.mUV[1] = uvDist( rng );
+    }
+    return vertices;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CompactVertexBounds ComputeCompactVertexBounds( const SceneVertex *vertices, size_t count )
+{
+    CompactVertexBounds bounds;
+    float maximum[3];
+    for ( int a = 0; a < 3; a++ )
+    {
+        bounds.mMin[a] = count ? FLT_MAX : 0.0f;
+        maximum[a] = count ? -FLT_MAX : 0.0f;
+    }
+
+    for ( size_t i = 0; i < count; i++ )
+    {
+        for ( int a = 0; a < 3; a++ )
+        {
+            bounds.mMin[a] = ( std::min )( bounds.mMin[a], vertices[i].mPosition[a] );
+            maximum[a] = ( std::max )( maximum[a], vertices[i].mPosition[a] );
+        }
+    }
+
+    for ( int a = 0; a < 3; a++ )
+        bounds.mStep[a] = ( maximum[a] - bounds.mMin[a] ) / kUnormMax;
+    return bounds;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EncodeCompactVertices( const SceneVertex *vertices, size_t count, const CompactVertexBounds &bounds, uint16_t boundsSlot,
+    CompactVertex *out )
+{
+    EncodeCompactVertices( vertices, count, bounds, boundsSlot, out, GetWidestPath( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EncodeCompactVertices( const SceneVertex *vertices, size_t count, const CompactVertexBounds &bounds, uint16_t boundsSlot,
+    CompactVertex *out, MathPath path )
+{
+    ASSERT( IsMathPathSupported( path ), "Math path isn't compiled in: ", path );
+
+#ifdef COMPACT_VERTEX_SSE
+    if ( path == MP_SSE || path == MP_AVX )
+    {
+        EncodeSSE( vertices, count, bounds, boundsSlot, out );
+        return;
+    }
+#endif
+    // neon builds take the scalar code, arm compilers vectorize the loop well enough
+    EncodeScalar( vertices, 0, count, bounds, boundsSlot, out );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void DecodeCompactVertex( const CompactVertex &vertex, const CompactVertexBounds &bounds, SceneVertex &out )
+{
+    for ( int a = 0; a < 3; a++ )
+        out.mPosition[a] = bounds.mMin[a] + float( vertex.mPosition[a] ) * bounds.mStep[a];
+    DecodeOctahedral( vertex.mNormal, out.mNormal );
+    DecodeOctahedral( vertex.mBinormal, out.mBinormal );
+    out.mUV[0] = HalfToFloat( vertex.mUV[0] );
+    out.mUV[1] = HalfToFloat( vertex.mUV[1] );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EncodeOctahedral( const float dir[3], int8_t out[2] )
+{
+    // project to the l1 sphere, fold the lower half over the diagonals (Meyer et al. 2010)
+    float l1 = std::fabs( dir[0] ) + std::fabs( dir[1] ) + std::fabs( dir[2] );
+    float inv = 1.0f / ( std::max )( l1, FLT_MIN );
+    float u = dir[0] * inv;
+    float v = dir[1] * inv;
+    if ( dir[2] < 0.0f )
+    {
+        float foldU = ( 1.0f - std::fabs( v ) ) * ( u >= 0.0f ? 1.0f : -1.0f );
+        float foldV = ( 1.0f - std::fabs( u ) ) * ( v >= 0.0f ? 1.0f : -1.0f );
+        u = foldU;
+        v = foldV;
+    }
+    out[0] = ToSnorm8( u );
+    out[1] = ToSnorm8( v );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void DecodeOctahedral( const int8_t oct[2], float out[3] )
+{
+    // snorm8 to float like the input assembler does, -128 is -1 as well
+    float u = ( std::max )( float( oct[0] ) / kSnormScale, -1.0f );
+    float v = ( std::max )( float( oct[1] ) / kSnormScale, -1.0f );
+    float z = 1.0f - std::fabs( u ) - std::fabs( v );
+    float t = ( std::max )( -z, 0.0f );
+    u += u >= 0.0f ? -t : t;
+    v += v >= 0.0f ? -t : t;
+
+    Vec3 n = Normalize( Vec3( u, v, z ) );
+    out[0] = n.x;
+    out[1] = n.y;
+    out[2] = n.z;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint16_t FloatToHalf( float value )
+{
+    uint32_t bits = FloatBits( value );
+    uint32_t sign = bits & 0x80000000u;
+    uint32_t abs = bits ^ sign;
+
+    uint32_t result;
+    if ( abs >= kHalfMaxBits )
+        result = abs > kFloatInfBits ? 0x7e00 : 0x7c00; // nan stays quiet nan
+    else if ( abs < kHalfDenormLimit )
+        result = FloatBits( BitsFloat( abs ) + BitsFloat( kDenormMagicBits ) ) - kDenormMagicBits; // fp add rounds the mantissa
+    else
+        result = ( abs + kRebiasBits + ( ( abs >> 13 ) & 1 ) ) >> 13;
+
+    return static_cast< uint16_t >( result | ( sign >> 16 ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float HalfToFloat( uint16_t value )
+{
+    uint32_t sign = uint32_t( value & 0x8000 ) << 16;
+    uint32_t exponent = ( value >> 10 ) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+
+    if ( exponent == 0 )
+    {
+        float denormal = float( mantissa ) * ( 1.0f / 16777216.0f );
+        return sign ? -denormal : denormal;
+    }
+    if ( exponent == 31 )
+        return BitsFloat( sign | 0x7f800000u | ( mantissa << 13 ) );
+    return BitsFloat( sign | ( ( exponent + 112 ) << 23 ) | ( mantissa << 13 ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CompactVertexBenchmarkResult RunCompactVertexBenchmark( size_t vertices, size_t iterations )
+{
+    typedef std::chrono::steady_clock Clock;
+
+    CompactVertexBenchmarkResult result;
+    result.mVertices = vertices;
+    for ( int path = 0; path < MP_COUNT; path++ )
+        result.mVerticesPerSecond[path] = 0.0;
+    if ( vertices == 0 )
+        return result;
+
+    std::vector<SceneVertex> input = GenerateVertexSoup( vertices, 2024 );
+    CompactVertexBounds bounds = ComputeCompactVertexBounds( input.data( ), input.size( ) );
+
+    std::vector<CompactVertex> reference( vertices );
+    EncodeCompactVertices( input.data( ), vertices, bounds, 7, reference.data( ), MP_SCALAR );
+    MeasureCompactVertexError( input, reference, bounds, result );
+
+    std::vector<CompactVertex> output( vertices );
+    size_t runs = ( std::max )( iterations, size_t( 1 ) );
+    for ( int path = 0; path < MP_COUNT; path++ )
+    {
+        if ( !IsMathPathSupported( static_cast< MathPath >( path ) ) )
+            continue;
+
+        Clock::time_point start = Clock::now( );
+        for ( size_t it = 0; it < runs; it++ )
+            EncodeCompactVertices( input.data( ), vertices, bounds, 7, output.data( ), static_cast< MathPath >( path ) );
+        double seconds = std::chrono::duration< double >( Clock::now( ) - start ).count( );
+        result.mVerticesPerSecond[path] = seconds > 0.0 ? vertices * runs / seconds : 0.0;
+
+        result.mPathsMatch &= memcmp( output.data( ), reference.data( ), vertices * sizeof( CompactVertex ) ) == 0;
+    }
+
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,68 @@
+#ifndef __COMPACT_VERTEX_H
+#define __COMPACT_VERTEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <Core/SceneStream.h>
+#include <Core/VMath.h>
+
+// quantized scene vertex, 16 instead of 44 bytes of SceneVertex
+// position is unorm16 inside of the object bounds, frame is octahedral snorm8, uv is half float
+struct CompactVertex
+{
+    uint16_t mPosition[3];
+    uint16_t mBoundsSlot; // object bounds in the renderer table, the vertex shader decodes position with it
+    int8_t mNormal[2];
+    int8_t mBinormal[2];
+    uint16_t mUV[2];
+};
+
+static_assert( sizeof( CompactVertex ) == 16, "compact vertex must stay 16 bytes, input layout depends on it" );
+
+// position = mMin + quantized * mStep
+struct CompactVertexBounds
+{
+    float mMin[3];
+    float mStep[3]; // 0 for a flat axis
+};
+
+// quantization error of one axis is at most mStep / 2
+CompactVertexBounds ComputeCompactVertexBounds( const SceneVertex *vertices, size_t count );
+
+// uses the widest path compiled in, AVX runs the SSE code since the encoder is bound by the vertex gathers
+void EncodeCompactVertices( const SceneVertex *vertices, size_t count, const CompactVertexBounds &bounds, uint16_t boundsSlot,
+    CompactVertex *out );
+void EncodeCompactVertices( const SceneVertex *vertices, size_t count, const CompactVertexBounds &bounds, uint16_t boundsSlot,
+    CompactVertex *out, MathPath path );
+
+// reference decoder, same math as DecodeCompactVertex of utils.fx; normal and binormal come out normalized
+void DecodeCompactVertex( const CompactVertex &vertex, const CompactVertexBounds &bounds, SceneVertex &out );
+
+// octahedral mapping of a direction of any length, zero vector gives (0, 0) that decodes to +z
+void EncodeOctahedral( const float dir[3], int8_t out[2] );
+void DecodeOctahedral( const int8_t oct[2], float out[3] );
+
+uint16_t FloatToHalf( float value ); // round to nearest even, overflow goes to infinity
+float HalfToFloat( uint16_t value );
+
+struct CompactVertexBenchmarkResult
+{
+    size_t mVertices = 0;
+    double mVerticesPerSecond[MP_COUNT]; // 0 when path isn't compiled in
+    bool mPathsMatch = true; // every compiled path gives the scalar bytes
+    float mMaxPositionError = 0.0f; // in quantization steps
+    float mMaxNormalErrorDegrees = 0.0f;
+    float mMaxUVError = 0.0f; // relative to uv magnitude
+};
+
+// scattered triangle soup of a few meters with random frames and tiled uvs
+std::vector<SceneVertex> GenerateVertexSoup( size_t count, uint32_t seed );
+// max position, frame and uv errors of compact against vertices into result
+void MeasureCompactVertexError( const std::vector<SceneVertex> &vertices, const std::vector<CompactVertex> &compact,
+    const CompactVertexBounds &bounds, CompactVertexBenchmarkResult &result );
+
+// random mesh vertices encoded with every path, then decoded against the input
+CompactVertexBenchmarkResult RunCompactVertexBenchmark( size_t vertices, size_t iterations );
+
+#endif
@@ -0,0 +1,463 @@
+#include <Core/ConeTracer.h>
+#include <Core/DenseMipVolume.h>
+#include <Core/DistanceField.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const uint32_t CONES_NUM = 5;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    float Dot( const float a[3], const float b[3] )
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void Cross( const float a[3], const float b[3], float out[3] )
+    {
+        float x = a[1] * b[2] - a[2] * b[1];
+        float y = a[2] * b[0] - a[0] * b[2];
+        float z = a[0] * b[1] - a[1] * b[0];
+        out[0] = x;
+        out[1] = y;
+        out[2] = z;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void Normalize( float v[3] )
+    {
+        float length = std::sqrt( Dot( v, v ) );
+        for ( int a = 0; a < 3; a++ )
+            v[a] /= length;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void RotateConesDir( const float normal[3], float coneDir[CONES_NUM][3] )
+    {
+        // RotateConesDir of coneTracing.fx, half-sphere around +y turned to the normal
+        float cosRotAngle = Dot( normal, coneDir[0] );
+        if ( cosRotAngle >= 0.995f )
+            return;
+
+        float rotVec[3] = { 1.0f, 0.0f, 0.0f };
+        float sinRotAngle = 0.01f;
+        if ( cosRotAngle > -0.995f )
+        {
+            Cross( coneDir[0], normal, rotVec );
+            sinRotAngle = std::sqrt( Dot( rotVec, rotVec ) );
+            Normalize( rotVec );
+        }
+
+        for ( uint32_t i = 0; i < CONES_NUM; i++ )
+        {
+            float *a = coneDir[i];
+            float cosAV = Dot( a, rotVec );
+            if ( cosAV >= 0.995f )
+                continue;
+
+            float aParrV[3], aPerpV[3], aPerpVNorm[3], w[3];
+            for ( int c = 0; c < 3; c++ )
+            {
+                aParrV[c] = rotVec[c] * cosAV;
+                aPerpV[c] = a[c] - aParrV[c];
+                aPerpVNorm[c] = aPerpV[c];
+            }
+            Normalize( aPerpVNorm );
+            Cross( rotVec, aPerpVNorm, w );
+            Normalize( w );
+
+            float perpLength = std::sqrt( Dot( aPerpV, aPerpV ) );
+            for ( int c = 0; c < 3; c++ )
+                a[c] = aParrV[c] + ( aPerpVNorm[c] * cosRotAngle + w[c] * sinRotAngle ) * perpLength;
+        }
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool WorldToOctreeCoords( const CpuOctree &octree, const ConeTraceParams &params, const float pos[3], uint32_t coords[3] )
+    {
+        // box test of WorldToBrickPosition and WorlPosToOctreePos
+        for ( int a = 0; a < 3; a++ )
+        {
+            if ( pos[a] > params.mMax[a] || pos[a] < params.mMin[a] )
+                return false;
+            coords[a] = static_cast< uint32_t >( ( pos[a] - params.mMin[a] ) / ( params.mMax[a] - params.mMin[a] ) * octree.GetResolution( ) );
+        }
+        return true;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    float GetNodeWidth( const CpuOctree &octree, const ConeTraceParams &params, uint32_t level )
+    {
+        return ( params.mMax[0] - params.mMin[0] ) / ( octree.GetResolution( ) >> ( octree.GetHeight( ) - level ) );
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool InEmptyCells( const uint32_t coords[3], uint32_t height, uint32_t level, int ring, uint32_t fieldLevel,
+        const int emptyMin[3], const int emptyMax[3] )
+    {
+        // field cells of the node of the sample and the ring of neighbors the lookup reads
+        int last = ( 1 << level ) - 1;
+        for ( int a = 0; a < 3; a++ )
+        {
+            int cell = static_cast< int >( coords[a] >> ( height - level ) );
+            int first = ( std::max )( cell - ring, 0 ), end = ( std::min )( cell + ring, last );
+            if ( level <= fieldLevel )
+            {
+                first <<= fieldLevel - level;
+                end = ( ( end + 1 ) << ( fieldLevel - level ) ) - 1;
+            }
+            else
+            {
+                first >>= level - fieldLevel;
+                end >>= level - fieldLevel;
+            }
+            if ( first < emptyMin[a] || end > emptyMax[a] )
+                return false;
+        }
+        return true;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void AddSurfaceVoxel( uint32_t x, uint32_t y, uint32_t z, uint32_t color, const float normal[3], std::vector<OctreeVoxel> &voxels,
+        std::vector<ConeTracePoint> &points )
+    {
+        uint32_t packedNormal = PackColor( normal[0] * 0.5f + 0.5f, normal[1] * 0.5f + 0.5f, normal[2] * 0.5f + 0.5f, 0.0f );
+        voxels.push_back( { PackOctreePosition( x, y, z ), color, packedNormal, 0 } );
+        ConeTracePoint point;
+        point.mPosition[0] = x + 0.5f;
+        point.mPosition[1] = y + 0.5f;
+        point.mPosition[2] = z + 0.5f;
+        for ( int a = 0; a < 3; a++ )
+            point.mNormal[a] = normal[a];
+        points.push_back( point );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void GenerateConeTestRoom( uint32_t height, std::vector<OctreeVoxel> &voxels, std::vector<ConeTracePoint> &points )
+{
+    // cornell box open at +z with three spheres, points are in voxels
+    const int r = 1 << height;
+    const uint32_t white = PackColor( 0.8f, 0.8f, 0.8f, 1.0f ), red = PackColor( 0.8f, 0.1f, 0.1f, 1.0f );
+    const uint32_t green = PackColor( 0.1f, 0.8f, 0.1f, 1.0f ), blue = PackColor( 0.2f, 0.3f, 0.9f, 1.0f );
+    const float up[3] = { 0.0f, 1.0f, 0.0f }, down[3] = { 0.0f, -1.0f, 0.0f };
+    const float right[3] = { 1.0f, 0.0f, 0.0f }, left[3] = { -1.0f, 0.0f, 0.0f }, front[3] = { 0.0f, 0.0f, 1.0f };
+
+    for ( int a = 0; a < r; a++ )
+    {
+        for ( int b = 0; b < r; b++ )
+        {
+            AddSurfaceVoxel( a, 0, b, white, up, voxels, points );
+            AddSurfaceVoxel( a, r - 1, b, white, down, voxels, points );
+            AddSurfaceVoxel( 0, a, b, red, right, voxels, points );
+            AddSurfaceVoxel( r - 1, a, b, green, left, voxels, points );
+            AddSurfaceVoxel( a, b, 0, white, front, voxels, points );
+        }
+    }
+
+    const float spheres[3][4] = { { 0.3f, 0.25f, 0.5f, 0.15f }, { 0.7f, 0.3f, 0.4f, 0.12f }, { 0.5f, 0.6f, 0.6f, 0.1f } };
+    for ( const float *sphere : spheres )
+    {
+        float c[3] = { sphere[0] * r, sphere[1] * r, sphere[2] * r }, radius = sphere[3] * r;
+        int from[3], to[3];
+        for ( int a = 0; a < 3; a++ )
+        {
+            from[a] = ( std::max )( 1, static_cast< int >( c[a] - radius - 1.0f ) );
+            to[a] = ( std::min )( r - 2, static_cast< int >( c[a] + radius + 1.0f ) );
+        }
+        for ( int z = from[2]; z <= to[2]; z++ )
+        for ( int y = from[1]; y <= to[1]; y++ )
+        for ( int x = from[0]; x <= to[0]; x++ )
+        {
+            float n[3] = { x + 0.5f - c[0], y + 0.5f - c[1], z + 0.5f - c[2] };
+            float distance = std::sqrt( Dot( n, n ) );
+            if ( std::fabs( distance - radius ) > 0.5f )
+                continue;
+            Normalize( n );
+            AddSurfaceVoxel( x, y, z, blue, n, voxels, points );
+        }
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ConeTraceParams::ConeTraceParams( ) :
+    mFirstLevel( 6 ),
+    mLastLevel( 2 ),
+    mLambdaFalloff( 0.06f ),
+    mLocalConeOffset( 0.02f ),
+    mWorldConeOffset( 12.2f ),
+    mStepCorrection( 0.76f )
+{
+    // vct.* defaults of Settings
+    for ( int a = 0; a < 3; a++ )
+    {
+        mMin[a] = 0.0f;
+        mMax[a] = 2048.0f;
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MarchOctree( const CpuOctree &octree, OctreeMarchState &state, uint32_t x, uint32_t y, uint32_t z, uint32_t level,
+    uint32_t &nodeIndex, uint32_t nodeCoords[3], OctreeMarchStats &stats )
+{
+    stats.mLookups++;
+
+    // leaf level gives the place of a voxel pointer, there are no links to continue from
+    if ( level >= octree.GetHeight( ) )
+    {
+        stats.mRootTraversals++;
+        return octree.Traverse( x, y, z, level, nodeIndex, nodeCoords, stats.mFetches );
+    }
+
+    uint32_t shift = octree.GetHeight( ) - level;
+    uint32_t target[3] = { x >> shift, y >> shift, z >> shift };
+
+    // ropes only pay off while the climb is shorter than a traversal from the root
+    if ( state.mNodeIndex != NODE_UNDEFINED && state.mLevel >= level && state.mLevel - level < level )
+    {
+        for ( ; state.mLevel > level; state.mLevel-- )
+        {
+            state.mNodeIndex = octree.Fetch( state.mNodeIndex + ONS_PARENT );
+            for ( int a = 0; a < 3; a++ )
+                state.mCell[a] >>= 1;
+            stats.mFetches++;
+            stats.mParentSteps++;
+        }
+
+        int lastAxis = -1;
+        bool adjacent = true;
+        for ( int a = 0; a < 3; a++ )
+        {
+            int64_t d = static_cast< int64_t >( target[a] ) - state.mCell[a];
+            adjacent = adjacent && d >= -1 && d <= 1;
+            lastAxis = d != 0 ? a : lastAxis;
+        }
+
+        if ( adjacent )
+        {
+            uint32_t node = state.mNodeIndex;
+            for ( int a = 0; a <= lastAxis && node != NODE_UNDEFINED; a++ )
+            {
+                if ( target[a] == state.mCell[a] )
+                    continue;
+                uint32_t next = octree.Fetch( node + GetNeighborSlot( a, target[a] > state.mCell[a] ) );
+                stats.mFetches++;
+                stats.mNeighborSteps++;
+
+                // the last link is the target cell itself, an earlier one only a cell on the way
+                if ( next == NODE_UNDEFINED && a == lastAxis )
+                    return false;
+                node = next;
+            }
+
+            if ( node != NODE_UNDEFINED )
+            {
+                state.mNodeIndex = nodeIndex = node;
+                for ( int a = 0; a < 3; a++ )
+                {
+                    state.mCell[a] = target[a];
+                    nodeCoords[a] = target[a] << shift;
+                }
+                return true;
+            }
+        }
+    }
+
+    stats.mRootTraversals++;
+    if ( !octree.Traverse( x, y, z, level, nodeIndex, nodeCoords, stats.mFetches ) )
+        return false;
+
+    state.mNodeIndex = nodeIndex;
+    state.mLevel = level;
+    for ( int a = 0; a < 3; a++ )
+        state.mCell[a] = target[a];
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TraceCones( const CpuOctree &octree, const ConeTraceParams &params, const float position[3], const float normal[3],
+    ConeLookup lookup, float result[4], OctreeMarchStats &stats, const ConeTraceVolumes &volumes )
+{
+    // half-sphere direction distribution, each cone has 60 degree
+    float coneDir[CONES_NUM][3] = {
+        {  0.0f,      1.0f,  0.0f      },
+        {  0.374999f, 0.5f,  0.374999f },
+        {  0.374999f, 0.5f, -0.374999f },
+        { -0.374999f, 0.5f,  0.374999f },
+        { -0.374999f, 0.5f, -0.374999f }
+    };
+    RotateConesDir( normal, coneDir );
+
+    const float coneStep = 1.4142f * params.mStepCorrection;
+    float coneAO[CONES_NUM] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    float coneCol[CONES_NUM][4] = { };
+
+    const DenseMipVolume *coarse = volumes.mDense;
+    const OctreeDistanceField *field = volumes.mEmptySpace;
+
+    // field cells known to be empty from the last field read, shared by the cones: samples whose footprint is in them
+    // are stepped over, they would only find transparent nodes. starts empty, so the first sample is always looked up
+    int emptyMin[3] = { 0, 0, 0 }, emptyMax[3] = { -1, -1, -1 };
+
+    // every cone starts from the node of the first sample of the first one, it is at most a cell away
+    OctreeMarchState firstState;
+
+    for ( uint32_t i = 0; i < CONES_NUM; i++ )
+    {
+        OctreeMarchState state = firstState;
+
+        for ( uint32_t octreeLevel = params.mFirstLevel; octreeLevel > params.mLastLevel; octreeLevel-- )
+        {
+            float nodeWidth = GetNodeWidth( octree, params, octreeLevel + 1 );
+            float sampleOffset = params.mLocalConeOffset + nodeWidth * coneStep;
+            float aoFalloff = 1.0f / ( 1.0f + sampleOffset * params.mLambdaFalloff );
+
+            float samplePos[3];
+            for ( int a = 0; a < 3; a++ )
+                samplePos[a] = position[a] + params.mWorldConeOffset * normal[a] + coneDir[i][a] * sampleOffset;
+
+            uint32_t coords[3], nodeIndex, nodeCoords[3];
+            float sample[4];
+            bool found = false;
+            bool inside = WorldToOctreeCoords( octree, params, samplePos, coords );
+
+            // node values are the sample of a sparse level, a trilinear dense fetch reads the neighbors too
+            bool dense = coarse != nullptr && octreeLevel <= coarse->GetCutoff( );
+            bool skip = inside && field != nullptr &&
+                InEmptyCells( coords, octree.GetHeight( ), octreeLevel, dense ? 1 : 0, field->GetLevel( ), emptyMin, emptyMax );
+            if ( skip )
+                stats.mSkippedSamples++;
+            else if ( inside && dense )
+            {
+                // dense levels are one trilinear fetch without octree reads
+                float uvw[3];
+                for ( int a = 0; a < 3; a++ )
+                    uvw[a] = ( samplePos[a] - params.mMin[a] ) / ( params.mMax[a] - params.mMin[a] );
+                coarse->Sample( uvw, octreeLevel, sample );
+                stats.mDenseSamples++;
+                found = true;
+            }
+            else if ( inside && lookup == CL_ROPES )
+            {
+                found = MarchOctree( octree, state, coords[0], coords[1], coords[2], octreeLevel, nodeIndex, nodeCoords, stats );
+                if ( i == 0 && octreeLevel == params.mFirstLevel )
+                    firstState = state;
+            }
+            else if ( inside )
+            {
+                stats.mLookups++;
+                stats.mRootTraversals++;
+                found = octree.Traverse( coords[0], coords[1], coords[2], octreeLevel, nodeIndex, nodeCoords, stats.mFetches );
+            }
+
+            if ( found && ( coarse == nullptr || octreeLevel > coarse->GetCutoff( ) ) )
+            {
+                const OctreeNodeValue &value = octree.GetValue( nodeIndex );
+                for ( int c = 0; c < 3; c++ )
+                    sample[c] = value.mColor[c];
+                sample[3] = value.mOpacity;
+            }
+
+            if ( inside && !skip && field != nullptr && ( !found || sample[3] == 0.0f ) )
+            {
+                // empty sample: every cell closer to its field cell than the distance has no voxels either
+                uint32_t cell[3];
+                for ( int a = 0; a < 3; a++ )
+                    cell[a] = coords[a] >> ( octree.GetHeight( ) - field->GetLevel( ) );
+                int distance = field->GetDistance( cell[0], cell[1], cell[2] );
+                stats.mFieldFetches++;
+                if ( distance > 0 )
+                {
+                    for ( int a = 0; a < 3; a++ )
+                    {
+                        emptyMin[a] = static_cast< int >( cell[a] ) - ( distance - 1 );
+                        emptyMax[a] = static_cast< int >( cell[a] ) + ( distance - 1 );
+                    }
+                }
+            }
+
+            float *col = coneCol[i];
+            if ( found )
+            {
+                float opacity = sample[3];
+                coneAO[i] += opacity * aoFalloff;
+
+                // front to back
+                for ( int c = 0; c < 3; c++ )
+                    col[c] += sample[c] * opacity * ( 1.0f - col[3] );
+                col[3] += ( 1.0f - col[3] ) * opacity;
+            }
+            else if ( !inside )
+            {
+                coneAO[i] += aoFalloff;
+                col[3] = 1.0f;
+            }
+
+            if ( col[3] >= 1.0f )
+                break;
+        }
+    }
+
+    float weight = 1.0f / CONES_NUM, ao = 0.0f;
+    for ( int c = 0; c < 3; c++ )
+        result[c] = 0.0f;
+    for ( uint32_t i = 0; i < CONES_NUM; i++ )
+    {
+        for ( int c = 0; c < 3; c++ )
+            result[c] += coneCol[i][c] * weight;
+        ao += ( std::min )( coneAO[i], 1.0f ) * weight;
+    }
+    result[3] = 1.0f - ao;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ConeMarchBenchmarkResult RunConeMarchBenchmark( uint32_t height, size_t points, int iterations )
+{
+    typedef std::chrono::steady_clock Clock;
+    auto ms = []( Clock::time_point start ) { return std::chrono::duration< double, std::milli >( Clock::now( ) - start ).count( ); };
+
+    iterations = ( std::max )( iterations, 1 );
+    height = ( std::max )( 3u, ( std::min )( height, static_cast< uint32_t >( MAX_OCTREE_HEIGHT ) ) );
+
+    std::vector<OctreeVoxel> voxels;
+    std::vector<ConeTracePoint> surface;
+    GenerateConeTestRoom( height, voxels, surface );
+    CpuOctree octree;
+    octree.Build( voxels, height );
+
+    ConeMarchBenchmarkResult result;
+    result.mHeight = height;
+    result.mVoxels = voxels.size( );
+    result.mNodes = octree.GetNodeCount( );
+
+    // renderer defaults are for height 8, keep the same distance to the leaves
+    ConeTraceParams params;
+    params.mFirstLevel = height - 2;
+    params.mLastLevel = params.mFirstLevel > 4 ? params.mFirstLevel - 4 : 0;
+    float voxelSize = ( params.mMax[0] - params.mMin[0] ) / octree.GetResolution( );
+
+    std::mt19937 rng( 11 );
+    std::uniform_int_distribution<size_t> pick( 0, surface.size( ) - 1 );
+    std::vector<ConeTracePoint> traced( points );
+    for ( ConeTracePoint &point : traced )
+    {
+        point = surface[pick( rng )];
+        for ( int a = 0; a < 3; a++ )
+            point.mPosition[a] = params.mMin[a] + point.mPosition[a] * voxelSize;
+    }
+    result.mPoints = traced.size( );
+
+    std::vector<float> rootColors( traced.size( ) * 4 ), ropeColors( traced.size( ) * 4 );
+    result.mRootMs = result.mRopesMs = 1e30;
+    for ( int it = 0; it < iterations; it++ )
+    {
+        result.mRoot = OctreeMarchStats( );
+        Clock::time_point start = Clock::now( );
+        for ( size_t i = 0; i < traced.size( ); i++ )
+            TraceCones( octree, params, traced[i].mPosition, traced[i].mNormal, CL_ROOT, &rootColors[i * 4], result.mRoot );
+        result.mRootMs = ( std::min )( result.mRootMs, ms( start ) );
+
+        result.mRopes = OctreeMarchStats( );
+        start = Clock::now( );
+        for ( size_t i = 0; i < traced.size( ); i++ )
+            TraceCones( octree, params, traced[i].mPosition, traced[i].mNormal, CL_ROPES, &ropeColors[i * 4], result.mRopes );
+        result.mRopesMs = ( std::min )( result.mRopesMs, ms( start ) );
+    }
+
+    result.mResultsMatch = rootColors == ropeColors && result.mRoot.mLookups == result.mRopes.mLookups;
+    return result;
+}
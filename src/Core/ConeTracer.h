@@ -0,0 +1,99 @@
+#ifndef __CONE_TRACER_H
+#define __CONE_TRACER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <Core/CpuOctree.h>
+
+class DenseMipVolume;
+class OctreeDistanceField;
+
+// surface point of a test scene
+struct ConeTracePoint
+{
+    float mPosition[3];
+    float mNormal[3];
+};
+
+// node of the previous sample of a cone, must match OctreeMarcher in coneTracing.fx
+struct OctreeMarchState
+{
+    uint32_t mNodeIndex;
+    uint32_t mLevel;
+    uint32_t mCell[3]; // node coords in nodes of its level
+
+    OctreeMarchState( ) : mNodeIndex( NODE_UNDEFINED ), mLevel( 0 ) { mCell[0] = mCell[1] = mCell[2] = 0; }
+};
+
+struct OctreeMarchStats
+{
+    size_t mLookups = 0;
+    size_t mFetches = 0; // octree texels read
+    size_t mParentSteps = 0;
+    size_t mNeighborSteps = 0;
+    size_t mRootTraversals = 0; // first sample of a pixel and rope misses
+    size_t mDenseSamples = 0; // samples of levels in a DenseMipVolume, they don't read the octree
+    size_t mSkippedSamples = 0; // samples in empty space of an OctreeDistanceField, no lookup at all
+    size_t mFieldFetches = 0; // distance field texels read
+};
+
+// node of ( x, y, z ) at level, continues from the node of the previous sample: parent links up to the level and
+// neighbor links into the adjacent cell, root traversal for anything farther; same node as CpuOctree::Traverse.
+// a missing neighbor link means the cell has no node, the state keeps the last node it reached
+bool MarchOctree( const CpuOctree &octree, OctreeMarchState &state, uint32_t x, uint32_t y, uint32_t z, uint32_t level,
+    uint32_t &nodeIndex, uint32_t nodeCoords[3], OctreeMarchStats &stats );
+
+enum ConeLookup
+{
+    CL_ROOT, // TraverseOctreeR per sample
+    CL_ROPES, // MarchOctree per cone
+};
+
+// uniforms of coneTracing.fx
+struct ConeTraceParams
+{
+    float mMin[3]; // cbSceneBB
+    float mMax[3];
+    uint32_t mFirstLevel;
+    uint32_t mLastLevel;
+    float mLambdaFalloff;
+    float mLocalConeOffset;
+    float mWorldConeOffset;
+    float mStepCorrection;
+
+    ConeTraceParams( );
+};
+
+// optional volumes next to the octree
+struct ConeTraceVolumes
+{
+    const DenseMipVolume *mDense = nullptr; // levels up to its cutoff are sampled from it
+    const OctreeDistanceField *mEmptySpace = nullptr; // samples whose footprint is in known empty cells are stepped over
+};
+
+// ConeTracingPS for one surface point without opacity buffer; nodes give their average instead of the trilinear brick
+// sample, so both lookups have to return the same color; rgb and 1 - ao like the shader output before amplification
+void TraceCones( const CpuOctree &octree, const ConeTraceParams &params, const float position[3], const float normal[3],
+    ConeLookup lookup, float result[4], OctreeMarchStats &stats, const ConeTraceVolumes &volumes = ConeTraceVolumes( ) );
+
+struct ConeMarchBenchmarkResult
+{
+    uint32_t mHeight = 0;
+    size_t mVoxels = 0;
+    size_t mNodes = 0;
+    size_t mPoints = 0; // traced surface points
+    OctreeMarchStats mRoot;
+    OctreeMarchStats mRopes;
+    double mRootMs = 0.0;
+    double mRopesMs = 0.0;
+    bool mResultsMatch = false; // every point gives the same color with both lookups
+};
+
+// cornell box open at +z with three spheres, a voxel ( with packed normal ) and a point per surface voxel, points are in voxels
+void GenerateConeTestRoom( uint32_t height, std::vector<OctreeVoxel> &voxels, std::vector<ConeTracePoint> &points );
+
+// random points of GenerateConeTestRoom, default cone settings of the renderer
+ConeMarchBenchmarkResult RunConeMarchBenchmark( uint32_t height, size_t points, int iterations );
+
+#endif
@@ -0,0 +1,519 @@
+#include <Core/Config.h>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace
+{
+    std::string Trim( const std::string &s )
+    {
+        size_t first = s.find_first_not_of( " \t\r\n" );
+        if ( first == std::string::npos )
+            return std::string( );
+        size_t last = s.find_last_not_of( " \t\r\n" );
+        return s.substr( first, last - first + 1 );
+    }
+
+    std::string ToLower( std::string s )
+    {
+        for ( auto &c : s )
+        {
+            if ( c >= 'A' && c <= 'Z' )
+                c = static_cast< char >( c - 'A' + 'a' );
+        }
+        return s;
+    }
+
+    bool IsNameChar( char c )
+    {
+        return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' ) || c == '_' || c == '-';
+    }
+
+    bool IsName( const std::string &s )
+    {
+        if ( s.empty( ) )
+            return false;
+        for ( char c : s )
+        {
+            if ( !IsNameChar( c ) )
+                return false;
+        }
+        return true;
+    }
+
+    // cuts comment that isn't inside quotes
+    std::string StripComment( const std::string &line )
+    {
+        bool quoted = false;
+        for ( size_t i = 0; i < line.size( ); i++ )
+        {
+            if ( line[i] == '"' )
+                quoted = !quoted;
+            else if ( !quoted && ( line[i] == '#' || line[i] == ';' ) )
+                return line.substr( 0, i );
+        }
+        return line;
+    }
+
+    bool ParseDouble( const std::string &text, double &value )
+    {
+        if ( text.empty( ) )
+            return false;
+        char *end = nullptr;
+        value = strtod( text.c_str( ), &end );
+        return end == text.c_str( ) + text.size( ) && value == value && std::fabs( value ) <= 3.4e38;
+    }
+
+    void LineError( std::vector<std::string> &errors, int line, const std::string &message )
+    {
+        std::ostringstream out;
+        out << "line " << line << ": " << message;
+        errors.push_back( out.str( ) );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ParseConfig( const std::string &text, ConfigDocument &doc, std::vector<std::string> &errors )
+{
+    size_t errorCount = errors.size( );
+    std::string section;
+    std::istringstream in( text );
+    std::string rawLine;
+    int lineNumber = 0;
+
+    while ( std::getline( in, rawLine ) )
+    {
+        lineNumber++;
+        std::string line = Trim( StripComment( rawLine ) );
+        if ( line.empty( ) )
+            continue;
+
+        if ( line[0] == '[' )
+        {
+            std::string name = Trim( line.substr( 1, line.size( ) - 1 - ( line.back( ) == ']' ? 1 : 0 ) ) );
+            if ( line.back( ) != ']' || !IsName( name ) )
+            {
+                LineError( errors, lineNumber, "bad section header '" + line + "'" );
+                continue;
+            }
+            section = name;
+            continue;
+        }
+
+        size_t eq = line.find( '=' );
+        if ( eq == std::string::npos )
+        {
+            LineError( errors, lineNumber, "expected key = value" );
+            continue;
+        }
+
+        std::string key = Trim( line.substr( 0, eq ) );
+        std::string value = Trim( line.substr( eq + 1 ) );
+        if ( !IsName( key ) )
+        {
+            LineError( errors, lineNumber, "bad key '" + key + "'" );
+            continue;
+        }
+
+        if ( !value.empty( ) && value[0] == '"' )
+        {
+            if ( value.size( ) < 2 || value.back( ) != '"' )
+            {
+                LineError( errors, lineNumber, "unterminated string" );
+                continue;
+            }
+            value = value.substr( 1, value.size( ) - 2 );
+        }
+
+        ConfigEntry &entry = doc[section.empty( ) ? key : section + "." + key];
+        entry.mValue = value;
+        entry.mLine = lineNumber;
+    }
+
+    return errors.size( ) == errorCount;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LoadConfigFile( const char *fn, ConfigDocument &doc, std::vector<std::string> &errors )
+{
+    std::ifstream file( fn, std::ios::in | std::ios::binary );
+    if ( !file.is_open( ) )
+    {
+        errors.push_back( std::string( "can't open " ) + fn );
+        return false;
+    }
+
+    std::ostringstream text;
+    text << file.rdbuf( );
+    return ParseConfig( text.str( ), doc, errors );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ConfigSchema::AddBool( const char *key, bool *value, uint32_t reload )
+{
+    AddField( key, CVT_BOOL, value, 0.0, 0.0, reload );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ConfigSchema::AddInt( const char *key, int *value, int minValue, int maxValue, uint32_t reload )
+{
+    AddField( key, CVT_INT, value, minValue, maxValue, reload );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ConfigSchema::AddFloat( const char *key, float *value, float minValue, float maxValue, uint32_t reload )
+{
+    AddField( key, CVT_FLOAT, value, minValue, maxValue, reload );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ConfigSchema::AddFloat3( const char *key, float *value, uint32_t reload )
+{
+    AddField( key, CVT_FLOAT3, value, -3.4e38, 3.4e38, reload );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ConfigSchema::AddString( const char *key, std::string *value, uint32_t reload )
+{
+    AddField( key, CVT_STRING, value, 0.0, 0.0, reload );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ConfigSchema::AddEnum( const char *key, int *value, const char *const *names, int count, uint32_t reload )
+{
+    AddField( key, CVT_ENUM, value, 0.0, count - 1, reload );
+    mFields.back( ).mNames = names;
+    mFields.back( ).mNameCount = count;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ConfigSchema::AddField( const char *key, ConfigValueType type, void *value, double minValue, double maxValue, uint32_t reload )
+{
+    Field field;
+    field.mKey = key;
+    field.mType = type;
+    field.mValue = value;
+    field.mMin = minValue;
+    field.mMax = maxValue;
+    field.mReload = reload;
+    mFields.push_back( field );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t ConfigSchema::Apply( const ConfigDocument &doc, std::vector<ConfigChange> &changes, std::vector<std::string> &errors )
+{
+    uint32_t reload = 0;
+    for ( auto &entry : doc )
+    {
+        const Field *field = nullptr;
+        for ( auto &f : mFields )
+        {
+            if ( f.mKey == entry.first )
+            {
+                field = &f;
+                break;
+            }
+        }
+
+        if ( !field )
+        {
+            LineError( errors, entry.second.mLine, "unknown key '" + entry.first + "'" );
+            continue;
+        }
+
+        Value value;
+        std::string error;
+        if ( !ParseValue( *field, entry.second.mValue, value, error ) )
+        {
+            LineError( errors, entry.second.mLine, entry.first + ": " + error );
+            continue;
+        }
+
+        Value current = ReadValue( *field );
+        if ( IsEqual( *field, current, value ) )
+            continue;
+
+        ConfigChange change;
+        change.mKey = field->mKey;
+        change.mOldValue = Format( *field, current );
+        change.mNewValue = Format( *field, value );
+        change.mReload = field->mReload;
+        changes.push_back( change );
+
+        WriteValue( *field, value );
+        reload |= field->mReload;
+    }
+
+    return reload;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string ConfigSchema::Write( ) const
+{
+    // sections in order of their first field
+    std::vector<std::string> sections;
+    for ( auto &field : mFields )
+    {
+        size_t dot = field.mKey.find( '.' );
+        std::string section = dot == std::string::npos ? std::string( ) : field.mKey.substr( 0, dot );
+        bool found = false;
+        for ( auto &s : sections )
+            found |= s == section;
+        if ( !found )
+            sections.push_back( section );
+    }
+
+    std::ostringstream out;
+    for ( auto &section : sections )
+    {
+        if ( !section.empty( ) )
+            out << ( out.tellp( ) > 0 ? "\n" : "" ) << "[" << section << "]\n";
+
+        for ( auto &field : mFields )
+        {
+            size_t dot = field.mKey.find( '.' );
+            std::string fieldSection = dot == std::string::npos ? std::string( ) : field.mKey.substr( 0, dot );
+            if ( fieldSection != section )
+                continue;
+
+            std::string key = dot == std::string::npos ? field.mKey : field.mKey.substr( dot + 1 );
+            out << key << " = " << Format( field, ReadValue( field ) ) << "\n";
+        }
+    }
+
+    return out.str( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t ConfigSchema::GetFieldCount( ) const
+{
+    return mFields.size( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ConfigSchema::ParseValue( const Field &field, const std::string &text, Value &value, std::string &error ) const
+{
+    value.mFloat[0] = value.mFloat[1] = value.mFloat[2] = 0.0f;
+
+    switch ( field.mType )
+    {
+    case CVT_BOOL:
+        {
+            std::string lower = ToLower( text );
+            if ( lower == "true" || lower == "on" || lower == "yes" || lower == "1" )
+                value.mBool = true;
+            else if ( lower == "false" || lower == "off" || lower == "no" || lower == "0" )
+                value.mBool = false;
+            else
+            {
+                error = "expected bool, got '" + text + "'";
+                return false;
+            }
+        }
+        return true;
+    case CVT_INT:
+    case CVT_FLOAT:
+        {
+            double number;
+            if ( !ParseDouble( text, number ) || ( field.mType == CVT_INT && number != std::floor( number ) ) )
+            {
+                error = std::string( field.mType == CVT_INT ? "expected integer" : "expected number" ) + ", got '" + text + "'";
+                return false;
+            }
+            if ( number < field.mMin || number > field.mMax )
+            {
+                std::ostringstream out;
+                out << text << " is out of range [" << field.mMin << ", " << field.mMax << "]";
+                error = out.str( );
+                return false;
+            }
+            value.mInt = static_cast< int >( number );
+            value.mFloat[0] = static_cast< float >( number );
+        }
+        return true;
+    case CVT_FLOAT3:
+        {
+            std::string list = text;
+            if ( list.size( ) >= 2 && list[0] == '[' && list.back( ) == ']' )
+                list = list.substr( 1, list.size( ) - 2 );
+
+            std::istringstream in( list );
+            std::string item;
+            int count = 0;
+            while ( std::getline( in, item, ',' ) )
+            {
+                double number;
+                if ( count >= 3 || !ParseDouble( Trim( item ), number ) )
+                {
+                    count = -1;
+                    break;
+                }
+                value.mFloat[count++] = static_cast< float >( number );
+            }
+            if ( count != 3 )
+            {
+                error = "expected three numbers, got '" + text + "'";
+                return false;
+            }
+        }
+        return true;
+    case CVT_STRING:
+        value.mString = text;
+        return true;
+    case CVT_ENUM:
+        {
+            std::string names;
+            for ( int i = 0; i < field.mNameCount; i++ )
+            {
+                if ( ToLower( text ) == ToLower( field.mNames[i] ) )
+                {
+                    value.mInt = i;
+                    return true;
+                }
+                names += ( i > 0 ? ", " : "" ) + std::string( field.mNames[i] );
+            }
+            error = "expected one of " + names + ", got '" + text + "'";
+        }
+        return false;
+    }
+
+    return false;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ConfigSchema::Value ConfigSchema::ReadValue( const Field &field ) const
+{
+    Value value;
+    value.mFloat[0] = value.mFloat[1] = value.mFloat[2] = 0.0f;
+
+    switch ( field.mType )
+    {
+    case CVT_BOOL:
+        value.mBool = *static_cast< const bool* >( field.mValue );
+        break;
+    case CVT_INT:
+    case CVT_ENUM:
+        value.mInt = *static_cast< const int* >( field.mValue );
+        break;
+    case CVT_FLOAT:
+        value.mFloat[0] = *static_cast< const float* >( field.mValue );
+        break;
+    case CVT_FLOAT3:
+        for ( int i = 0; i < 3; i++ )
+            value.mFloat[i] = static_cast< const float* >( field.mValue )[i];
+        break;
+    case CVT_STRING:
+        value.mString = *static_cast< const std::string* >( field.mValue );
+        break;
+    }
+
+    return value;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ConfigSchema::WriteValue( const Field &field, const Value &value )
+{
+    switch ( field.mType )
+    {
+    case CVT_BOOL:
+        *static_cast< bool* >( field.mValue ) = value.mBool;
+        break;
+    case CVT_INT:
+    case CVT_ENUM:
+        *static_cast< int* >( field.mValue ) = value.mInt;
+        break;
+    case CVT_FLOAT:
+        *static_cast< float* >( field.mValue ) = value.mFloat[0];
+        break;
+    case CVT_FLOAT3:
+        for ( int i = 0; i < 3; i++ )
+            static_cast< float* >( field.mValue )[i] = value.mFloat[i];
+        break;
+    case CVT_STRING:
+        *static_cast< std::string* >( field.mValue ) = value.mString;
+        break;
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ConfigSchema::IsEqual( const Field &field, const Value &a, const Value &b ) const
+{
+    switch ( field.mType )
+    {
+    case CVT_BOOL:
+        return a.mBool == b.mBool;
+    case CVT_INT:
+    case CVT_ENUM:
+        return a.mInt == b.mInt;
+    case CVT_FLOAT:
+        return a.mFloat[0] == b.mFloat[0];
+    case CVT_FLOAT3:
+        return a.mFloat[0] == b.mFloat[0] && a.mFloat[1] == b.mFloat[1] && a.mFloat[2] == b.mFloat[2];
+    case CVT_STRING:
+        return a.mString == b.mString;
+    }
+
+    return false;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string ConfigSchema::Format( const Field &field, const Value &value ) const
+{
+    // 9 digits make floats survive write and parse unchanged
+    std::ostringstream out;
+    out.precision( 9 );
+
+    switch ( field.mType )
+    {
+    case CVT_BOOL:
+        out << ( value.mBool ? "true" : "false" );
+        break;
+    case CVT_INT:
+        out << value.mInt;
+        break;
+    case CVT_FLOAT:
+        out << value.mFloat[0];
+        break;
+    case CVT_FLOAT3:
+        out << value.mFloat[0] << ", " << value.mFloat[1] << ", " << value.mFloat[2];
+        break;
+    case CVT_STRING:
+        out << "\"" << value.mString << "\"";
+        break;
+    case CVT_ENUM:
+        if ( value.mInt >= 0 && value.mInt < field.mNameCount )
+            out << field.mNames[value.mInt];
+        else
+            out << value.mInt;
+        break;
+    }
+
+    return out.str( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ConfigFileWatcher::SetPath( const char *fn )
+{
+    mPath = fn;
+    if ( !GetStamp( mTime, mSize ) )
+        mTime = mSize = -1;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ConfigFileWatcher::Poll( )
+{
+    int64_t time, size;
+    if ( !GetStamp( time, size ) )
+        return false; // editors may delete and recreate the file on save
+
+    if ( time == mTime && size == mSize )
+        return false;
+
+    mTime = time;
+    mSize = size;
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ConfigFileWatcher::GetStamp( int64_t &time, int64_t &size ) const
+{
+    if ( mPath.empty( ) )
+        return false;
+
+#ifdef _WIN32
+    struct _stat64 st;
+    if ( _stat64( mPath.c_str( ), &st ) != 0 )
+        return false;
+#else
+    struct stat st;
+    if ( stat( mPath.c_str( ), &st ) != 0 )
+        return false;
+#endif
+
+    time = static_cast< int64_t >( st.st_mtime );
+    size = static_cast< int64_t >( st.st_size );
+    return true;
+}
@@ -0,0 +1,114 @@
+#ifndef __CONFIG_H
+#define __CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// ini-like text config:
+//   # comment, ; comment
+//   [section]
+//   key = value          # bool ( true/false/on/off/1/0 ), int, float, "string", enum name, float3 as 1.0, 2.0, 3.0
+// keys are addressed as "section.key"
+
+struct ConfigEntry
+{
+    std::string mValue; // unquoted, trimmed
+    int mLine = 0;
+};
+
+typedef std::map<std::string, ConfigEntry> ConfigDocument;
+
+// false if some lines were malformed, the rest is still parsed; duplicate keys keep the last value
+bool ParseConfig( const std::string &text, ConfigDocument &doc, std::vector<std::string> &errors );
+bool LoadConfigFile( const char *fn, ConfigDocument &doc, std::vector<std::string> &errors );
+
+enum ConfigValueType
+{
+    CVT_BOOL,
+    CVT_INT,
+    CVT_FLOAT,
+    CVT_FLOAT3,
+    CVT_STRING,
+    CVT_ENUM,
+};
+
+// value that differs from what the bound variable held
+struct ConfigChange
+{
+    std::string mKey;
+    std::string mOldValue;
+    std::string mNewValue;
+    uint32_t mReload = 0;
+};
+
+// binds config keys to variables with their type, valid range and reload mask ( meaning is up to the caller )
+class ConfigSchema
+{
+public:
+    void AddBool( const char *key, bool *value, uint32_t reload = 0 );
+    void AddInt( const char *key, int *value, int minValue, int maxValue, uint32_t reload = 0 );
+    void AddFloat( const char *key, float *value, float minValue, float maxValue, uint32_t reload = 0 );
+    void AddFloat3( const char *key, float *value, uint32_t reload = 0 );
+    void AddString( const char *key, std::string *value, uint32_t reload = 0 );
+    // names[i] is written for value i
+    void AddEnum( const char *key, int *value, const char *const *names, int count, uint32_t reload = 0 );
+
+    // writes valid values that differ from current ones and returns or'ed reload mask of changes
+    // invalid values and unknown keys are reported and don't touch variables, missing keys keep current values
+    uint32_t Apply( const ConfigDocument &doc, std::vector<ConfigChange> &changes, std::vector<std::string> &errors );
+
+    // current values as config text, grouped by section in registration order
+    std::string Write( ) const;
+
+    size_t GetFieldCount( ) const;
+
+private:
+    struct Field
+    {
+        std::string mKey;
+        ConfigValueType mType = CVT_INT;
+        void *mValue = nullptr;
+        double mMin = 0.0;
+        double mMax = 0.0;
+        const char *const *mNames = nullptr;
+        int mNameCount = 0;
+        uint32_t mReload = 0;
+    };
+
+    struct Value
+    {
+        bool mBool = false;
+        int mInt = 0;
+        float mFloat[3];
+        std::string mString;
+    };
+
+    void AddField( const char *key, ConfigValueType type, void *value, double minValue, double maxValue, uint32_t reload );
+    bool ParseValue( const Field &field, const std::string &text, Value &value, std::string &error ) const;
+    Value ReadValue( const Field &field ) const;
+    void WriteValue( const Field &field, const Value &value );
+    bool IsEqual( const Field &field, const Value &a, const Value &b ) const;
+    std::string Format( const Field &field, const Value &value ) const;
+
+    std::vector<Field> mFields;
+};
+
+// polls size and modification time of a file
+class ConfigFileWatcher
+{
+public:
+    void SetPath( const char *fn ); // current state is taken as seen
+    bool Poll( ); // true once after each change
+
+private:
+    bool GetStamp( int64_t &time, int64_t &size ) const;
+
+    std::string mPath;
+    int64_t mTime = -1;
+    int64_t mSize = -1;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#include <Core/CpuFeatures.h>
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    bool DetectAVX( )
+    {
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+        // cpuid 1: ecx bit 27 osxsave, bit 28 avx; xcr0 bits 1 and 2 - the os saves xmm and ymm state
+        int info[4];
+        __cpuid( info, 1 );
+        bool osxsave = ( info[2] & ( 1 << 27 ) ) != 0, avx = ( info[2] & ( 1 << 28 ) ) != 0;
+        return osxsave && avx && ( _xgetbv( 0 ) & 6 ) == 6;
+#elif ( defined( __GNUC__ ) || defined( __clang__ ) ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+        // checks the os support of ymm registers too
+        __builtin_cpu_init( );
+        return __builtin_cpu_supports( "avx" ) != 0;
+#else
+        return false;
+#endif
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool IsAVXSupported( )
+{
+    // no cached static, vs2013 has no thread safe local statics; cpuid is cheap next to a batch of boxes or points
+    return DetectAVX( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,8 @@
+#ifndef __CPU_FEATURES_H
+#define __CPU_FEATURES_H
+
+// instruction sets checked at run time; kernels of sets wider than the build target live in their own translation
+// units built with that set ( VCT_AVX_KERNELS when the compiler can target avx ) and are only called after this check
+bool IsAVXSupported( ); // cpu has avx and the os saves ymm registers
+
+#endif
@@ -0,0 +1,254 @@
+#include <Core/CpuOctree.h>
+#include <algorithm>
+#include <cmath>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CpuOctree::Build( const std::vector<OctreeVoxel> &voxels, uint32_t height )
+{
+    mHeight = ( std::max )( 1u, ( std::min )( height, static_cast< uint32_t >( MAX_OCTREE_HEIGHT ) ) );
+    mSlots.assign( SIZE_OF_NODE_STRUCT, NODE_UNDEFINED ); // preallocated root
+    mLevelOffsets.assign( 1, 0 );
+    mLevelOffsets.push_back( 1 );
+
+    uint32_t x, y, z, nodeCoords[3], nodeIndex;
+    size_t fetches = 0;
+
+    // level by level like the GenerateOctree passes, so node ids of a level are consecutive
+    for ( uint32_t level = 0; level + 1 < mHeight; level++ )
+    {
+        // FlagNodes
+        for ( const OctreeVoxel &voxel : voxels )
+        {
+            UnpackOctreePosition( voxel.mPosition, x, y, z );
+            if ( Traverse( x, y, z, level, nodeIndex, nodeCoords, fetches ) && mSlots[nodeIndex + ONS_FLAGS] != NODE_ALLOCATED )
+                mSlots[nodeIndex + ONS_FLAGS] = NODE_SUBDIVIDE;
+        }
+
+        // SubdivideNodes
+        size_t begin = mLevelOffsets[level], end = mLevelOffsets[level + 1];
+        for ( size_t id = begin; id < end; id++ )
+        {
+            uint32_t index = NodeIDToIndex( static_cast< uint32_t >( id ) );
+            if ( mSlots[index + ONS_FLAGS] == NODE_SUBDIVIDE )
+            {
+                AllocateNodes( index );
+                mSlots[index + ONS_FLAGS] = NODE_ALLOCATED;
+            }
+        }
+        mLevelOffsets.push_back( GetNodeCount( ) );
+
+        // ConnectNeighbors
+        for ( size_t id = begin; id < end; id++ )
+        {
+            uint32_t index = NodeIDToIndex( static_cast< uint32_t >( id ) );
+            if ( mSlots[index + ONS_FLAGS] == NODE_ALLOCATED )
+                ConnectNeighbors( index );
+        }
+    }
+
+    // ConnectNodesToVoxels
+    for ( size_t i = 0; i < voxels.size( ); i++ )
+    {
+        UnpackOctreePosition( voxels[i].mPosition, x, y, z );
+        if ( Traverse( x, y, z, mHeight, nodeIndex, nodeCoords, fetches ) )
+        {
+            mSlots[nodeIndex] = static_cast< uint32_t >( i );
+            mSlots[nodeIndex - nodeIndex % SIZE_OF_NODE_STRUCT + ONS_FLAGS] = NODE_ALLOCATED;
+        }
+    }
+
+    ComputeValues( voxels );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CpuOctree::Assemble( std::vector<uint32_t> &slots, const std::vector<size_t> &levelOffsets, const std::vector<OctreeVoxel> &voxels )
+{
+    mHeight = static_cast< uint32_t >( levelOffsets.size( ) - 1 );
+    mSlots.swap( slots );
+    mLevelOffsets = levelOffsets;
+
+    for ( size_t index = 0; index < mSlots.size( ); index += SIZE_OF_NODE_STRUCT )
+        std::fill( &mSlots[index + ONS_NEIGHBORS], &mSlots[index + ONS_PARENT], NODE_UNDEFINED );
+
+    // ConnectNeighbors of Build, a level needs the links of the one above
+    for ( uint32_t level = 0; level + 1 < mHeight; level++ )
+    {
+        for ( size_t id = mLevelOffsets[level]; id < mLevelOffsets[level + 1]; id++ )
+        {
+            uint32_t index = NodeIDToIndex( static_cast< uint32_t >( id ) );
+            if ( mSlots[index + ONS_FLAGS] == NODE_ALLOCATED )
+                ConnectNeighbors( index );
+        }
+    }
+
+    ComputeValues( voxels );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t CpuOctree::AllocateNodes( uint32_t nodeIndex )
+{
+    uint32_t firstChild = static_cast< uint32_t >( mSlots.size( ) );
+    mSlots.resize( mSlots.size( ) + CHILDS_COUNT * SIZE_OF_NODE_STRUCT, NODE_UNDEFINED );
+
+    for ( uint32_t i = 0; i < CHILDS_COUNT; i++ )
+    {
+        uint32_t childIndex = firstChild + i * SIZE_OF_NODE_STRUCT;
+        mSlots[nodeIndex + ONS_CHILDREN + i] = childIndex;
+        mSlots[childIndex + ONS_PARENT] = nodeIndex;
+    }
+
+    return firstChild;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CpuOctree::ConnectNeighbors( uint32_t nodeIndex )
+{
+    for ( uint32_t i = 0; i < CHILDS_COUNT; i++ )
+    {
+        uint32_t childIndex = mSlots[nodeIndex + ONS_CHILDREN + i];
+
+        for ( int axis = 0; axis < 3; axis++ )
+        {
+            bool positive = ( ( i >> axis ) & 1 ) != 0;
+            uint32_t across = i ^ ( 1u << axis ); // child on the other side of the axis
+
+            // neighbor outside of the parent is a child of the parent neighbor
+            uint32_t parentNeighbor = mSlots[nodeIndex + GetNeighborSlot( axis, positive )];
+            if ( parentNeighbor != NODE_UNDEFINED && mSlots[parentNeighbor + ONS_FLAGS] == NODE_ALLOCATED )
+                mSlots[childIndex + GetNeighborSlot( axis, positive )] = mSlots[parentNeighbor + ONS_CHILDREN + across];
+
+            // neighbor inside of the parent is a sibling
+            mSlots[childIndex + GetNeighborSlot( axis, !positive )] = mSlots[nodeIndex + ONS_CHILDREN + across];
+        }
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CpuOctree::ComputeValues( const std::vector<OctreeVoxel> &voxels )
+{
+    struct Sum
+    {
+        double mColor[3];
+        double mCount;
+    };
+    std::vector<Sum> sums( GetNodeCount( ) );
+    for ( Sum &sum : sums )
+        sum.mColor[0] = sum.mColor[1] = sum.mColor[2] = sum.mCount = 0.0;
+
+    // leaves of the last level nodes, then bottom up through parent links
+    for ( size_t id = mLevelOffsets[mHeight - 1]; id < GetNodeCount( ); id++ )
+    {
+        uint32_t index = NodeIDToIndex( static_cast< uint32_t >( id ) );
+        for ( uint32_t i = 0; i < CHILDS_COUNT; i++ )
+        {
+            uint32_t voxelID = mSlots[index + ONS_CHILDREN + i];
+            if ( voxelID == NODE_UNDEFINED )
+                continue;
+            for ( int c = 0; c < 3; c++ )
+                sums[id].mColor[c] += ( ( voxels[voxelID].mColor >> ( c * 8 ) ) & 0xff ) / 255.0;
+            sums[id].mCount += 1.0;
+        }
+    }
+    for ( size_t id = GetNodeCount( ) - 1; id > 0; id-- )
+    {
+        Sum &parent = sums[mSlots[NodeIDToIndex( static_cast< uint32_t >( id ) ) + ONS_PARENT] / SIZE_OF_NODE_STRUCT];
+        for ( int c = 0; c < 3; c++ )
+            parent.mColor[c] += sums[id].mColor[c];
+        parent.mCount += sums[id].mCount;
+    }
+
+    mValues.resize( GetNodeCount( ) );
+    for ( uint32_t level = 0; level < mHeight; level++ )
+    {
+        double leaves = std::pow( 8.0, static_cast< double >( mHeight - level ) );
+        for ( size_t id = mLevelOffsets[level]; id < mLevelOffsets[level + 1]; id++ )
+        {
+            const Sum &sum = sums[id];
+            OctreeNodeValue &value = mValues[id];
+            for ( int c = 0; c < 3; c++ )
+                value.mColor[c] = sum.mCount > 0.0 ? static_cast< float >( sum.mColor[c] / sum.mCount ) : 0.0f;
+            value.mOpacity = static_cast< float >( sum.mCount / leaves );
+        }
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t CpuOctree::GetHeight( ) const
+{
+    return mHeight;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t CpuOctree::GetResolution( ) const
+{
+    return 1u << mHeight;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t CpuOctree::GetNodeCount( ) const
+{
+    return mSlots.size( ) / SIZE_OF_NODE_STRUCT;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t CpuOctree::GetLevelOffset( uint32_t level ) const
+{
+    return mLevelOffsets[( std::min )( static_cast< size_t >( level ), mLevelOffsets.size( ) - 1 )];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const OctreeNodeValue& CpuOctree::GetValue( uint32_t nodeIndex ) const
+{
+    return mValues[nodeIndex / SIZE_OF_NODE_STRUCT];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const std::vector<uint32_t>& CpuOctree::GetSlots( ) const
+{
+    return mSlots;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CpuOctree::WriteBricks( uint32_t brickBufferSize, std::vector<uint32_t> &texels ) const
+{
+    texels.assign( static_cast< size_t >( brickBufferSize ) * brickBufferSize * brickBufferSize, 0 );
+    size_t count = ( std::min )( GetNodeCount( ), GetBrickCapacity( brickBufferSize ) );
+
+    for ( size_t id = 0; id < count; id++ )
+    {
+        const OctreeNodeValue &value = mValues[id];
+        uint32_t texel = PackColor( value.mColor[0], value.mColor[1], value.mColor[2], value.mOpacity );
+        uint32_t x, y, z;
+        BrickIDToTextureCoords( static_cast< uint32_t >( id ), brickBufferSize, x, y, z );
+        for ( uint32_t k = 0; k < BRICK_SIZE; k++ )
+        for ( uint32_t j = 0; j < BRICK_SIZE; j++ )
+        for ( uint32_t i = 0; i < BRICK_SIZE; i++ )
+            texels[( static_cast< size_t >( z + k ) * brickBufferSize + y + j ) * brickBufferSize + x + i] = texel;
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CpuOctree::Traverse( uint32_t x, uint32_t y, uint32_t z, uint32_t level, uint32_t &nodeIndex, uint32_t nodeCoords[3],
+    size_t &fetches ) const
+{
+    nodeIndex = 0;
+    nodeCoords[0] = nodeCoords[1] = nodeCoords[2] = 0;
+
+    uint32_t resolution = GetResolution( );
+    if ( level > mHeight || x >= resolution || y >= resolution || z >= resolution )
+        return false;
+
+    uint32_t pos[3] = { x, y, z };
+    uint32_t halfSize = resolution;
+    for ( uint32_t treeLevel = 0; treeLevel < level; treeLevel++ )
+    {
+        // SelectNode
+        halfSize >>= 1;
+        uint32_t mask[3];
+        for ( int a = 0; a < 3; a++ )
+        {
+            mask[a] = pos[a] >= nodeCoords[a] + halfSize ? 1 : 0;
+            nodeCoords[a] += halfSize * mask[a];
+        }
+        nodeIndex += GetChildSlot( mask[0], mask[1], mask[2] );
+
+        // the last level returns the place of the voxel pointer
+        if ( treeLevel != mHeight - 1 )
+        {
+            nodeIndex = mSlots[nodeIndex];
+            fetches++;
+            if ( nodeIndex == NODE_UNDEFINED )
+                return false;
+        }
+    }
+
+    return true;
+}
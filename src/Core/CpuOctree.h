@@ -0,0 +1,56 @@
+#ifndef __CPU_OCTREE_H
+#define __CPU_OCTREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <Core/OctreeLayout.h>
+
+// averaged leaves of a node, what its brick holds at the node center
+struct OctreeNodeValue
+{
+    float mColor[3]; // mean color of the voxels under the node
+    float mOpacity; // occupied part of the node leaves
+};
+
+// cpu mirror of the gpu octree for reference tracers: same node structs, same node order per level and the same
+// neighbor links as FlagNodes, SubdivideNodes, ConnectNeighbors and ConnectNodesToVoxels build
+class CpuOctree
+{
+public:
+    // positions are PackOctreePosition in [0, 1 << height), duplicates are allowed, the last voxel of a leaf wins
+    void Build( const std::vector<OctreeVoxel> &voxels, uint32_t height );
+
+    // nodes put together elsewhere ( MergeOctreeShards ) in Build order, with children, parents and flags set;
+    // slots are taken over, neighbor links are rebuilt top down and values computed from the voxels
+    void Assemble( std::vector<uint32_t> &slots, const std::vector<size_t> &levelOffsets, const std::vector<OctreeVoxel> &voxels );
+
+    uint32_t GetHeight( ) const;
+    uint32_t GetResolution( ) const;
+    size_t GetNodeCount( ) const;
+    size_t GetLevelOffset( uint32_t level ) const; // id of the first node of a level, LevelOffset
+
+    // octreeR texel
+    uint32_t Fetch( uint32_t index ) const { return mSlots[index]; }
+    const OctreeNodeValue& GetValue( uint32_t nodeIndex ) const;
+    const std::vector<uint32_t>& GetSlots( ) const;
+
+    // irradiance brick buffer in the gpu layout, brick of a node id is filled with its value (rgb, opacity in alpha);
+    // brickBufferSize has to hold GetNodeCount bricks
+    void WriteBricks( uint32_t brickBufferSize, std::vector<uint32_t> &texels ) const;
+
+    // TraverseOctreeR: node index of the level and its start coords in voxels, octree reads are added to fetches
+    bool Traverse( uint32_t x, uint32_t y, uint32_t z, uint32_t level, uint32_t &nodeIndex, uint32_t nodeCoords[3], size_t &fetches ) const;
+
+private:
+    uint32_t mHeight = 0;
+    std::vector<uint32_t> mSlots; // SIZE_OF_NODE_STRUCT per node
+    std::vector<size_t> mLevelOffsets;
+    std::vector<OctreeNodeValue> mValues; // per node id
+
+    uint32_t AllocateNodes( uint32_t nodeIndex );
+    void ConnectNeighbors( uint32_t nodeIndex );
+    void ComputeValues( const std::vector<OctreeVoxel> &voxels );
+};
+
+#endif
@@ -0,0 +1,285 @@
+#include <Core/Culling.h>
+#include <GlobalUtils.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include <Core/CpuFeatures.h>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define CULLING_SSE
+#include <emmintrin.h>
+#endif
+
+#ifdef VCT_AVX_KERNELS
+// CullingAVX.cpp, boxes are the center and extent arrays padded to 8
+size_t CullBoxesAVX( const Frustum &frustum, const float *const boxes[6], size_t count, uint8_t *visible );
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+AABB::AABB( )
+{
+    mMin[0] = mMin[1] = mMin[2] = 1e30f;
+    mMax[0] = mMax[1] = mMax[2] = -1e30f;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void AABB::Extend( const float p[3] )
+{
+    for ( int i = 0; i < 3; i++ )
+    {
+        mMin[i] = std::min( mMin[i], p[i] );
+        mMax[i] = std::max( mMax[i], p[i] );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AABB::IsEmpty( ) const
+{
+    return mMin[0] > mMax[0] || mMin[1] > mMax[1] || mMin[2] > mMax[2];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Frustum Frustum::FromViewProj( const float m[16] )
+{
+    // Gribb/Hartmann: planes are combinations of matrix columns
+    auto column = [m]( int c, int r ) { return m[r * 4 + c]; };
+
+    Frustum f;
+    for ( int r = 0; r < 4; r++ )
+    {
+        f.mPlanes[FP_LEFT][r] = column( 3, r ) + column( 0, r );
+        f.mPlanes[FP_RIGHT][r] = column( 3, r ) - column( 0, r );
+        f.mPlanes[FP_BOTTOM][r] = column( 3, r ) + column( 1, r );
+        f.mPlanes[FP_TOP][r] = column( 3, r ) - column( 1, r );
+        f.mPlanes[FP_NEAR][r] = column( 2, r );
+        f.mPlanes[FP_FAR][r] = column( 3, r ) - column( 2, r );
+    }
+
+    for ( int p = 0; p < FP_COUNT; p++ )
+    {
+        float *plane = f.mPlanes[p];
+        float len = std::sqrt( plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2] );
+        if ( len > 0.0f )
+        {
+            for ( int i = 0; i < 4; i++ )
+                plane[i] /= len;
+        }
+    }
+
+    return f;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CullingBoxes::Clear( )
+{
+    mCenterX.clear( ); mCenterY.clear( ); mCenterZ.clear( );
+    mExtentX.clear( ); mExtentY.clear( ); mExtentZ.clear( );
+    mCount = 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CullingBoxes::Reserve( size_t count )
+{
+    size_t padded = ( count + 7 ) & ~size_t( 7 );
+    mCenterX.reserve( padded ); mCenterY.reserve( padded ); mCenterZ.reserve( padded );
+    mExtentX.reserve( padded ); mExtentY.reserve( padded ); mExtentZ.reserve( padded );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CullingBoxes::Push( const AABB &box )
+{
+    // replace padding if any
+    mCenterX.resize( mCount ); mCenterY.resize( mCount ); mCenterZ.resize( mCount );
+    mExtentX.resize( mCount ); mExtentY.resize( mCount ); mExtentZ.resize( mCount );
+
+    if ( box.IsEmpty( ) )
+    {
+        // never visible: far away and zero sized
+        mCenterX.push_back( 1e30f ); mCenterY.push_back( 1e30f ); mCenterZ.push_back( 1e30f );
+        mExtentX.push_back( 0.0f ); mExtentY.push_back( 0.0f ); mExtentZ.push_back( 0.0f );
+    }
+    else
+    {
+        mCenterX.push_back( ( box.mMin[0] + box.mMax[0] ) * 0.5f );
+        mCenterY.push_back( ( box.mMin[1] + box.mMax[1] ) * 0.5f );
+        mCenterZ.push_back( ( box.mMin[2] + box.mMax[2] ) * 0.5f );
+        mExtentX.push_back( ( box.mMax[0] - box.mMin[0] ) * 0.5f );
+        mExtentY.push_back( ( box.mMax[1] - box.mMin[1] ) * 0.5f );
+        mExtentZ.push_back( ( box.mMax[2] - box.mMin[2] ) * 0.5f );
+    }
+    mCount++;
+
+    // pad with copies of the last box, so simd loops can read full lanes
+    size_t padded = ( mCount + 7 ) & ~size_t( 7 );
+    mCenterX.resize( padded, mCenterX.back( ) ); mCenterY.resize( padded, mCenterY.back( ) ); mCenterZ.resize( padded, mCenterZ.back( ) );
+    mExtentX.resize( padded, mExtentX.back( ) ); mExtentY.resize( padded, mExtentY.back( ) ); mExtentZ.resize( padded, mExtentZ.back( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t CullingBoxes::GetCount( ) const
+{
+    return mCount;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static size_t CullBoxesScalar( const Frustum &frustum, const CullingBoxes &boxes, uint8_t *visible )
+{
+    size_t visibleCount = 0;
+    for ( size_t i = 0; i < boxes.GetCount( ); i++ )
+    {
+        bool inside = true;
+        for ( int p = 0; p < Frustum::FP_COUNT && inside; p++ )
+        {
+            // distance of the box corner that is most in direction of the plane normal
+            const float *plane = frustum.mPlanes[p];
+            float d = plane[0] * boxes.mCenterX[i] + plane[1] * boxes.mCenterY[i] + plane[2] * boxes.mCenterZ[i] + plane[3];
+            float r = std::fabs( plane[0] ) * boxes.mExtentX[i] + std::fabs( plane[1] ) * boxes.mExtentY[i] + std::fabs( plane[2] ) * boxes.mExtentZ[i];
+            inside = d + r >= 0.0f;
+        }
+
+        visible[i] = inside ? 1 : 0;
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef CULLING_SSE
+static size_t CullBoxesSSE( const Frustum &frustum, const CullingBoxes &boxes, uint8_t *visible )
+{
+    size_t count = boxes.GetCount( );
+    size_t visibleCount = 0;
+    for ( size_t i = 0; i < count; i += 4 )
+    {
+        __m128 cx = _mm_loadu_ps( &boxes.mCenterX[i] );
+        __m128 cy = _mm_loadu_ps( &boxes.mCenterY[i] );
+        __m128 cz = _mm_loadu_ps( &boxes.mCenterZ[i] );
+        __m128 ex = _mm_loadu_ps( &boxes.mExtentX[i] );
+        __m128 ey = _mm_loadu_ps( &boxes.mExtentY[i] );
+        __m128 ez = _mm_loadu_ps( &boxes.mExtentZ[i] );
+
+        __m128 inside = _mm_castsi128_ps( _mm_set1_epi32( -1 ) );
+        for ( int p = 0; p < Frustum::FP_COUNT; p++ )
+        {
+            const float *plane = frustum.mPlanes[p];
+            __m128 d = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( plane[0] ), cx ), _mm_mul_ps( _mm_set1_ps( plane[1] ), cy ) ),
+                _mm_add_ps( _mm_mul_ps( _mm_set1_ps( plane[2] ), cz ), _mm_set1_ps( plane[3] ) ) );
+            __m128 r = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( std::fabs( plane[0] ) ), ex ), _mm_mul_ps( _mm_set1_ps( std::fabs( plane[1] ) ), ey ) ),
+                _mm_mul_ps( _mm_set1_ps( std::fabs( plane[2] ) ), ez ) );
+            inside = _mm_and_ps( inside, _mm_cmpge_ps( _mm_add_ps( d, r ), _mm_setzero_ps( ) ) );
+        }
+
+        int mask = _mm_movemask_ps( inside );
+        size_t lanes = std::min( size_t( 4 ), count - i );
+        for ( size_t l = 0; l < lanes; l++ )
+        {
+            visible[i + l] = ( mask >> l ) & 1;
+            visibleCount += visible[i + l];
+        }
+    }
+    return visibleCount;
+}
+#endif
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool IsCullingPathSupported( CullingPath path )
+{
+    switch ( path )
+    {
+    case CP_SCALAR:
+        return true;
+#ifdef CULLING_SSE
+    case CP_SSE:
+        return true;
+#endif
+#ifdef VCT_AVX_KERNELS
+    case CP_AVX:
+        return IsAVXSupported( );
+#endif
+    default:
+        return false;
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t CullBoxes( const Frustum &frustum, const CullingBoxes &boxes, std::vector<uint8_t> &visible, CullingPath path )
+{
+    visible.resize( boxes.GetCount( ) );
+    if ( boxes.GetCount( ) == 0 )
+        return 0;
+
+    ASSERT( IsCullingPathSupported( path ), "Culling path isn't supported: ", path );
+    switch ( path )
+    {
+#ifdef VCT_AVX_KERNELS
+    case CP_AVX:
+    {
+        const float *soa[6] = { &boxes.mCenterX[0], &boxes.mCenterY[0], &boxes.mCenterZ[0],
+            &boxes.mExtentX[0], &boxes.mExtentY[0], &boxes.mExtentZ[0] };
+        return CullBoxesAVX( frustum, soa, boxes.GetCount( ), &visible[0] );
+    }
+#endif
+#ifdef CULLING_SSE
+    case CP_SSE:
+        return CullBoxesSSE( frustum, boxes, &visible[0] );
+#endif
+    default:
+        return CullBoxesScalar( frustum, boxes, &visible[0] );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t CullBoxes( const Frustum &frustum, const CullingBoxes &boxes, std::vector<uint8_t> &visible )
+{
+    if ( IsCullingPathSupported( CP_AVX ) )
+        return CullBoxes( frustum, boxes, visible, CP_AVX );
+    return CullBoxes( frustum, boxes, visible, IsCullingPathSupported( CP_SSE ) ? CP_SSE : CP_SCALAR );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CullingBenchmarkResult RunCullingBenchmark( size_t boxCount, size_t iterations )
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // perspective camera at origin looking down -z (right handed), fov 90, near 1, far 1000
+    const float n = 1.0f, f = 1000.0f;
+    const float viewProj[16] = {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, f / ( n - f ), -1.0f,
+        0.0f, 0.0f, n * f / ( n - f ), 0.0f
+    };
+    Frustum frustum = Frustum::FromViewProj( viewProj );
+
+    std::mt19937 rng( 4321 );
+    std::uniform_real_distribution<float> posDist( -1200.0f, 1200.0f );
+    std::uniform_real_distribution<float> sizeDist( 0.1f, 20.0f );
+
+    CullingBoxes boxes;
+    boxes.Reserve( boxCount );
+    for ( size_t i = 0; i < boxCount; i++ )
+    {
+        AABB box;
+        float c[3] = { posDist( rng ), posDist( rng ), posDist( rng ) };
+        float s = sizeDist( rng );
+        float pMin[3] = { c[0] - s, c[1] - s, c[2] - s };
+        float pMax[3] = { c[0] + s, c[1] + s, c[2] + s };
+        box.Extend( pMin );
+        box.Extend( pMax );
+        boxes.Push( box );
+    }
+
+    CullingBenchmarkResult result;
+    result.mBoxes = boxCount;
+
+    std::vector<uint8_t> reference;
+    result.mVisible = CullBoxes( frustum, boxes, reference, CP_SCALAR );
+
+    for ( int path = 0; path < CP_COUNT; path++ )
+    {
+        result.mBoxesPerSecond[path] = 0.0;
+        if ( !IsCullingPathSupported( static_cast< CullingPath >( path ) ) )
+            continue;
+
+        std::vector<uint8_t> visible;
+        Clock::time_point start = Clock::now( );
+        for ( size_t it = 0; it < std::max( iterations, size_t( 1 ) ); it++ )
+            CullBoxes( frustum, boxes, visible, static_cast< CullingPath >( path ) );
+        double seconds = std::chrono::duration< double >( Clock::now( ) - start ).count( );
+
+        result.mBoxesPerSecond[path] = seconds > 0.0 ? boxCount * std::max( iterations, size_t( 1 ) ) / seconds : 0.0;
+        result.mPathsMatch &= visible == reference;
+    }
+
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
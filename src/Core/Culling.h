@@ -0,0 +1,86 @@
+#ifndef __CULLING_H
+#define __CULLING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// axis aligned bounding box
+struct AABB
+{
+    float mMin[3];
+    float mMax[3];
+
+    AABB( );
+
+    void Extend( const float p[3] );
+    bool IsEmpty( ) const;
+};
+
+// 6 planes (a, b, c, d), inside when a*x + b*y + c*z + d >= 0
+struct Frustum
+{
+    enum
+    {
+        FP_LEFT,
+        FP_RIGHT,
+        FP_BOTTOM,
+        FP_TOP,
+        FP_NEAR,
+        FP_FAR,
+
+        FP_COUNT
+    };
+
+    float mPlanes[FP_COUNT][4];
+
+    // viewProj is row-major and uses row vectors (DirectXMath convention), clip z in [0, w]
+    // works for perspective and orthographic projections
+    static Frustum FromViewProj( const float viewProj[16] );
+};
+
+// structure of arrays storage for boxes, padded to a multiple of 8 for simd
+class CullingBoxes
+{
+public:
+    void Clear( );
+    void Reserve( size_t count );
+    void Push( const AABB &box );
+
+    size_t GetCount( ) const;
+
+    // center / half extent form
+    std::vector<float> mCenterX, mCenterY, mCenterZ;
+    std::vector<float> mExtentX, mExtentY, mExtentZ;
+
+private:
+    size_t mCount = 0;
+};
+
+enum CullingPath
+{
+    CP_SCALAR,
+    CP_SSE,
+    CP_AVX,
+
+    CP_COUNT
+};
+
+struct CullingBenchmarkResult
+{
+    size_t mBoxes = 0;
+    size_t mVisible = 0;
+    double mBoxesPerSecond[CP_COUNT]; // 0 when path isn't supported
+    bool mPathsMatch = true; // all supported paths agree with scalar reference
+};
+
+// writes 1 to visible[i] if box i intersects the frustum, 0 otherwise; returns visible count
+// uses the widest path the cpu supports (AVX - 8 boxes per iteration, SSE - 4)
+size_t CullBoxes( const Frustum &frustum, const CullingBoxes &boxes, std::vector<uint8_t> &visible );
+size_t CullBoxes( const Frustum &frustum, const CullingBoxes &boxes, std::vector<uint8_t> &visible, CullingPath path );
+bool IsCullingPathSupported( CullingPath path ); // compiled in and, for AVX, supported by the cpu
+
+// random boxes against a perspective frustum
+CullingBenchmarkResult RunCullingBenchmark( size_t boxes, size_t iterations );
+
+#endif
@@ -0,0 +1,54 @@
+#include <Core/Culling.h>
+
+// the only culling code built with avx code generation, CullBoxes calls it after IsAVXSupported. no std templates or
+// other inline functions here: the linker keeps one copy of those, and an avx copy would run on cpus without avx
+#ifdef VCT_AVX_KERNELS
+#include <immintrin.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t CullBoxesAVX( const Frustum &frustum, const float *const boxes[6], size_t count, uint8_t *visible )
+{
+    const float *centerX = boxes[0], *centerY = boxes[1], *centerZ = boxes[2];
+    const float *extentX = boxes[3], *extentY = boxes[4], *extentZ = boxes[5];
+
+    __m256 planes[Frustum::FP_COUNT][4], absMask = _mm256_castsi256_ps( _mm256_set1_epi32( 0x7fffffff ) );
+    for ( int p = 0; p < Frustum::FP_COUNT; p++ )
+    {
+        for ( int c = 0; c < 4; c++ )
+            planes[p][c] = _mm256_set1_ps( frustum.mPlanes[p][c] );
+    }
+
+    size_t visibleCount = 0;
+    for ( size_t i = 0; i < count; i += 8 )
+    {
+        __m256 cx = _mm256_loadu_ps( centerX + i );
+        __m256 cy = _mm256_loadu_ps( centerY + i );
+        __m256 cz = _mm256_loadu_ps( centerZ + i );
+        __m256 ex = _mm256_loadu_ps( extentX + i );
+        __m256 ey = _mm256_loadu_ps( extentY + i );
+        __m256 ez = _mm256_loadu_ps( extentZ + i );
+
+        __m256 inside = _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) );
+        for ( int p = 0; p < Frustum::FP_COUNT; p++ )
+        {
+            const __m256 *plane = planes[p];
+            __m256 d = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( plane[0], cx ), _mm256_mul_ps( plane[1], cy ) ),
+                _mm256_add_ps( _mm256_mul_ps( plane[2], cz ), plane[3] ) );
+            __m256 r = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_and_ps( plane[0], absMask ), ex ),
+                _mm256_mul_ps( _mm256_and_ps( plane[1], absMask ), ey ) ), _mm256_mul_ps( _mm256_and_ps( plane[2], absMask ), ez ) );
+            inside = _mm256_and_ps( inside, _mm256_cmp_ps( _mm256_add_ps( d, r ), _mm256_setzero_ps( ), _CMP_GE_OQ ) );
+        }
+
+        // boxes are padded to 8, lanes past the count aren't written
+        int mask = _mm256_movemask_ps( inside );
+        size_t lanes = count - i < 8 ? count - i : 8;
+        for ( size_t l = 0; l < lanes; l++ )
+        {
+            visible[i + l] = static_cast< uint8_t >( ( mask >> l ) & 1 );
+            visibleCount += visible[i + l];
+        }
+    }
+    return visibleCount;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
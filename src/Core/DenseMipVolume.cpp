@@ -0,0 +1,258 @@
+#include <Core/DenseMipVolume.h>
+#include <Core/ConeTracer.h>
+#include <Core/CpuOctree.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    struct DenseCell
+    {
+        uint32_t mNodeIndex;
+        uint32_t mCell[3];
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    size_t TexelIndex( uint32_t x, uint32_t y, uint32_t z, uint32_t size )
+    {
+        return ( static_cast< size_t >( z ) * size + y ) * size + x;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t GetBrickBufferSizeFor( size_t nodes )
+{
+    // smallest cube of bricks that holds every node
+    uint32_t blocks = 1;
+    while ( static_cast< size_t >( blocks ) * blocks * blocks < nodes )
+        blocks++;
+    return blocks * BRICK_SIZE;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void DenseMipVolume::Build( const std::vector<uint32_t> &octreeSlots, uint32_t height, const BrickBufferView &bricks, uint32_t cutoff )
+{
+    // last level children are voxel pointers, so the deepest dense level is the last node level
+    mCutoff = ( std::min )( cutoff, height > 0 ? height - 1 : 0 );
+    mMips.assign( mCutoff + 1, std::vector<uint32_t>( ) );
+    size_t brickCapacity = GetBrickCapacity( bricks.mSize );
+
+    // top down through child pointers, every node writes its brick center to the texel of its cell
+    std::vector<DenseCell> cells( 1 ), next;
+    cells[0].mNodeIndex = 0;
+    cells[0].mCell[0] = cells[0].mCell[1] = cells[0].mCell[2] = 0;
+
+    for ( uint32_t level = 0; level <= mCutoff; level++ )
+    {
+        uint32_t size = 1u << level;
+        std::vector<uint32_t> &mip = mMips[mCutoff - level];
+        mip.assign( static_cast< size_t >( size ) * size * size, 0 );
+
+        next.clear( );
+        for ( const DenseCell &cell : cells )
+        {
+            uint32_t nodeID = cell.mNodeIndex / SIZE_OF_NODE_STRUCT;
+            if ( nodeID < brickCapacity )
+            {
+                uint32_t x, y, z;
+                BrickIDToTextureCoords( nodeID, bricks.mSize, x, y, z );
+                mip[TexelIndex( cell.mCell[0], cell.mCell[1], cell.mCell[2], size )] = bricks.mTexels[TexelIndex( x + 1, y + 1, z + 1, bricks.mSize )];
+            }
+
+            if ( level == mCutoff || octreeSlots[cell.mNodeIndex + ONS_FLAGS] != NODE_ALLOCATED )
+                continue;
+
+            for ( uint32_t i = 0; i < CHILDS_COUNT; i++ )
+            {
+                DenseCell child;
+                child.mNodeIndex = octreeSlots[cell.mNodeIndex + ONS_CHILDREN + i];
+                for ( int a = 0; a < 3; a++ )
+                    child.mCell[a] = cell.mCell[a] * 2 + ( ( i >> a ) & 1 );
+                next.push_back( child );
+            }
+        }
+        cells.swap( next );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t DenseMipVolume::GetCutoff( ) const
+{
+    return mCutoff;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t DenseMipVolume::GetMipCount( ) const
+{
+    return static_cast< uint32_t >( mMips.size( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t DenseMipVolume::GetMipSize( uint32_t mip ) const
+{
+    return 1u << ( mCutoff - mip );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const std::vector<uint32_t>& DenseMipVolume::GetMip( uint32_t mip ) const
+{
+    return mMips[mip];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t DenseMipVolume::GetByteSize( ) const
+{
+    size_t bytes = 0;
+    for ( const std::vector<uint32_t> &mip : mMips )
+        bytes += mip.size( ) * sizeof( uint32_t );
+    return bytes;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void DenseMipVolume::Sample( const float uvw[3], uint32_t level, float rgba[4] ) const
+{
+    level = ( std::min )( level, mCutoff );
+    const std::vector<uint32_t> &mip = mMips[mCutoff - level];
+    int size = 1 << level;
+
+    // texel centers are at ( i + 0.5 ) / size, clamp addressing
+    int i0[3], i1[3];
+    float f[3];
+    for ( int a = 0; a < 3; a++ )
+    {
+        float t = uvw[a] * size - 0.5f;
+        float base = std::floor( t );
+        f[a] = t - base;
+        int i = static_cast< int >( base );
+        i0[a] = ( std::max )( 0, ( std::min )( size - 1, i ) );
+        i1[a] = ( std::max )( 0, ( std::min )( size - 1, i + 1 ) );
+    }
+
+    for ( int c = 0; c < 4; c++ )
+        rgba[c] = 0.0f;
+    for ( int corner = 0; corner < 8; corner++ )
+    {
+        float weight = 1.0f;
+        uint32_t p[3];
+        for ( int a = 0; a < 3; a++ )
+        {
+            bool upper = ( ( corner >> a ) & 1 ) != 0;
+            weight *= upper ? f[a] : 1.0f - f[a];
+            p[a] = static_cast< uint32_t >( upper ? i1[a] : i0[a] );
+        }
+        uint32_t texel = mip[TexelIndex( p[0], p[1], p[2], size )];
+        for ( int c = 0; c < 4; c++ )
+            rgba[c] += weight * ( ( texel >> ( c * 8 ) ) & 0xff ) * ( 1.0f / 255.0f );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t GetSparseLevelsByteSize( const CpuOctree &octree, uint32_t lastLevel )
+{
+    // node struct and a 3x3x3 brick per node
+    size_t nodes = octree.GetLevelOffset( lastLevel + 1 );
+    return nodes * ( SIZE_OF_NODE_STRUCT + BRICK_SIZE * BRICK_SIZE * BRICK_SIZE ) * sizeof( uint32_t );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t GetDenseMipByteSize( uint32_t cutoff )
+{
+    size_t texels = 0;
+    for ( uint32_t level = 0; level <= cutoff; level++ )
+        texels += static_cast< size_t >( 1 ) << ( 3 * level );
+    return texels * sizeof( uint32_t );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t SuggestDenseCutoff( const CpuOctree &octree )
+{
+    uint32_t cutoff = 0;
+    for ( uint32_t level = 0; level < octree.GetHeight( ); level++ )
+    {
+        if ( GetDenseMipByteSize( level ) <= GetSparseLevelsByteSize( octree, level ) )
+            cutoff = level;
+    }
+    return cutoff;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HybridVolumeBenchmarkResult RunHybridVolumeBenchmark( uint32_t height, uint32_t cutoff, size_t points, int iterations )
+{
+    typedef std::chrono::steady_clock Clock;
+    auto ms = []( Clock::time_point start ) { return std::chrono::duration< double, std::milli >( Clock::now( ) - start ).count( ); };
+
+    iterations = ( std::max )( iterations, 1 );
+    height = ( std::max )( 3u, ( std::min )( height, static_cast< uint32_t >( MAX_OCTREE_HEIGHT ) ) );
+
+    std::vector<OctreeVoxel> voxels;
+    std::vector<ConeTracePoint> surface;
+    GenerateConeTestRoom( height, voxels, surface );
+    CpuOctree octree;
+    octree.Build( voxels, height );
+
+    std::vector<uint32_t> texels;
+    BrickBufferView bricks;
+    bricks.mSize = GetBrickBufferSizeFor( octree.GetNodeCount( ) );
+    octree.WriteBricks( bricks.mSize, texels );
+    bricks.mTexels = texels.data( );
+
+    HybridVolumeBenchmarkResult result;
+    result.mHeight = height;
+    result.mCutoff = cutoff == 0 ? SuggestDenseCutoff( octree ) : ( std::min )( cutoff, height - 1 );
+    for ( uint32_t level = 0; level < height; level++ )
+    {
+        double nodes = static_cast< double >( octree.GetLevelOffset( level + 1 ) - octree.GetLevelOffset( level ) );
+        result.mOccupancy.push_back( nodes / std::pow( 8.0, static_cast< double >( level ) ) );
+    }
+
+    DenseMipVolume dense;
+    result.mBuildMs = 1e30;
+    for ( int it = 0; it < iterations; it++ )
+    {
+        Clock::time_point start = Clock::now( );
+        dense.Build( octree.GetSlots( ), height, bricks, result.mCutoff );
+        result.mBuildMs = ( std::min )( result.mBuildMs, ms( start ) );
+    }
+    result.mDenseBytes = dense.GetByteSize( );
+    result.mSparseBytes = GetSparseLevelsByteSize( octree, result.mCutoff );
+
+    // cone march benchmark settings
+    ConeTraceParams params;
+    params.mFirstLevel = height - 2;
+    params.mLastLevel = params.mFirstLevel > 4 ? params.mFirstLevel - 4 : 0;
+    float voxelSize = ( params.mMax[0] - params.mMin[0] ) / octree.GetResolution( );
+
+    std::mt19937 rng( 11 );
+    std::uniform_int_distribution<size_t> pick( 0, surface.size( ) - 1 );
+    std::vector<ConeTracePoint> traced( points );
+    for ( ConeTracePoint &point : traced )
+    {
+        point = surface[pick( rng )];
+        for ( int a = 0; a < 3; a++ )
+            point.mPosition[a] = params.mMin[a] + point.mPosition[a] * voxelSize;
+    }
+    result.mPoints = traced.size( );
+
+    ConeTraceVolumes volumes;
+    volumes.mDense = &dense;
+    std::vector<float> sparseColors( traced.size( ) * 4 ), hybridColors( traced.size( ) * 4 );
+    OctreeMarchStats sparseStats, hybridStats;
+    result.mSparseMs = result.mHybridMs = 1e30;
+    for ( int it = 0; it < iterations; it++ )
+    {
+        sparseStats = OctreeMarchStats( );
+        Clock::time_point start = Clock::now( );
+        for ( size_t i = 0; i < traced.size( ); i++ )
+            TraceCones( octree, params, traced[i].mPosition, traced[i].mNormal, CL_ROPES, &sparseColors[i * 4], sparseStats );
+        result.mSparseMs = ( std::min )( result.mSparseMs, ms( start ) );
+
+        hybridStats = OctreeMarchStats( );
+        start = Clock::now( );
+        for ( size_t i = 0; i < traced.size( ); i++ )
+            TraceCones( octree, params, traced[i].mPosition, traced[i].mNormal, CL_ROPES, &hybridColors[i * 4], hybridStats, volumes );
+        result.mHybridMs = ( std::min )( result.mHybridMs, ms( start ) );
+    }
+
+    result.mSamples = sparseStats.mLookups;
+    result.mDenseSamples = hybridStats.mDenseSamples;
+    double samples = static_cast< double >( ( std::max )( result.mSamples, size_t( 1 ) ) );
+    result.mSparseFetches = sparseStats.mFetches / samples;
+    result.mHybridFetches = hybridStats.mFetches / static_cast< double >( ( std::max )( hybridStats.mLookups + hybridStats.mDenseSamples, size_t( 1 ) ) );
+
+    double difference = 0.0;
+    for ( size_t i = 0; i < sparseColors.size( ); i++ )
+        difference += std::fabs( sparseColors[i] - hybridColors[i] );
+    result.mMeanDifference = sparseColors.empty( ) ? 0.0 : difference / sparseColors.size( );
+    return result;
+}
@@ -0,0 +1,70 @@
+#ifndef __DENSE_MIP_VOLUME_H
+#define __DENSE_MIP_VOLUME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class CpuOctree;
+
+// rgba8 texels of a cubic 3d brick buffer like irradianceBrickBufferR, x fastest
+struct BrickBufferView
+{
+    const uint32_t *mTexels = nullptr;
+    uint32_t mSize = 0; // brickBufferSize
+};
+
+// coarse octree levels as a dense mip chain: mip 0 is level cutoff with 1 << cutoff texels per axis, the last mip is the root.
+// texels are brick centers, so a trilinear fetch between node centers replaces traversal and brick sample of these levels
+class DenseMipVolume
+{
+public:
+    // octree and bricks in the gpu layout (CpuOctree or a readback); cells without a node are transparent black
+    void Build( const std::vector<uint32_t> &octreeSlots, uint32_t height, const BrickBufferView &bricks, uint32_t cutoff );
+
+    uint32_t GetCutoff( ) const;
+    uint32_t GetMipCount( ) const;
+    uint32_t GetMipSize( uint32_t mip ) const;
+    const std::vector<uint32_t>& GetMip( uint32_t mip ) const;
+    size_t GetByteSize( ) const;
+
+    // SampleLevel of a linear clamp sampler: uvw in [0, 1] of the scene box, level <= cutoff
+    void Sample( const float uvw[3], uint32_t level, float rgba[4] ) const;
+
+private:
+    uint32_t mCutoff = 0;
+    std::vector<std::vector<uint32_t>> mMips;
+};
+
+// smallest brickBufferSize of a cube of bricks that holds every node
+uint32_t GetBrickBufferSizeFor( size_t nodes );
+
+// node structs and one brick buffer of levels 0..lastLevel
+size_t GetSparseLevelsByteSize( const CpuOctree &octree, uint32_t lastLevel );
+// full mip chain of one rgba8 volume with 1 << cutoff texels per axis
+size_t GetDenseMipByteSize( uint32_t cutoff );
+// deepest level that is cheaper dense than sparse, 0 for sparse scenes
+uint32_t SuggestDenseCutoff( const CpuOctree &octree );
+
+struct HybridVolumeBenchmarkResult
+{
+    uint32_t mHeight = 0;
+    uint32_t mCutoff = 0;
+    size_t mPoints = 0;
+    std::vector<double> mOccupancy; // nodes of a level against 8^level
+    size_t mSparseBytes = 0; // levels 0..cutoff
+    size_t mDenseBytes = 0;
+    double mBuildMs = 0.0; // conversion from octree and brick buffer
+    size_t mSamples = 0; // cone samples inside the scene box
+    size_t mDenseSamples = 0;
+    double mSparseFetches = 0.0; // octree texels per sample, neighbor ropes
+    double mHybridFetches = 0.0;
+    double mSparseMs = 0.0;
+    double mHybridMs = 0.0;
+    double mMeanDifference = 0.0; // mean abs difference of cone results, trilinear against nearest node
+};
+
+// synthetic room of the cone march benchmark, cutoff 0 - SuggestDenseCutoff
+HybridVolumeBenchmarkResult RunHybridVolumeBenchmark( uint32_t height, uint32_t cutoff, size_t points, int iterations );
+
+#endif
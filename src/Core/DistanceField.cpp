@@ -0,0 +1,237 @@
+#include <Core/DistanceField.h>
+#include <Core/ConeTracer.h>
+#include <Core/CpuOctree.h>
+#include <Core/TaskScheduler.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace
+{
+    const uint8_t MAX_DISTANCE = 255;
+
+    struct FieldCell
+    {
+        uint32_t mNodeIndex;
+        uint32_t mCell[3];
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    size_t CellIndex( uint32_t x, uint32_t y, uint32_t z, uint32_t size )
+    {
+        return ( static_cast< size_t >( z ) * size + y ) * size + x;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void TransformLine( const uint8_t *in, uint32_t size, std::vector<uint32_t> &queue, uint8_t *out )
+    {
+        // out[i] = min over j of max( |i - j|, in[j] ), one sweep per side. candidates of a sweep are kept with rising
+        // values: a newer cell with a value not above an older one is better for every later cell, and once the oldest
+        // one loses to the next it never wins again
+        queue.resize( size );
+        for ( int side = 0; side < 2; side++ )
+        {
+            size_t head = 0, tail = 0;
+            for ( uint32_t step = 0; step < size; step++ )
+            {
+                uint32_t i = side == 0 ? step : size - 1 - step;
+                while ( tail > head && in[queue[tail - 1]] >= in[i] )
+                    tail--;
+                queue[tail++] = i;
+
+                auto cost = [&]( uint32_t j ) { return ( std::max )( i > j ? i - j : j - i, static_cast< uint32_t >( in[j] ) ); };
+                while ( tail - head > 1 && cost( queue[head] ) >= cost( queue[head + 1] ) )
+                    head++;
+
+                uint8_t distance = static_cast< uint8_t >( ( std::min )( cost( queue[head] ), static_cast< uint32_t >( MAX_DISTANCE ) ) );
+                out[i] = side == 0 ? distance : ( std::min )( out[i], distance );
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ChebyshevDistanceTransform( std::vector<uint8_t> &cells, uint32_t size, TaskScheduler &scheduler )
+{
+    // max( |dx|, |dy|, |dz| ) is a max of per axis terms, so the min over cells splits into one pass per axis
+    const uint32_t tileLines = 32;
+    size_t plane = static_cast< size_t >( size ) * size;
+    uint32_t tilesPerRow = ( size + tileLines - 1 ) / tileLines;
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        // lines of a tile are neighbors along the fastest other axis, so gathers read whole cache lines
+        size_t stride = axis == 0 ? 1 : axis == 1 ? size : plane;
+        size_t lineStep = axis == 0 ? size : 1;
+        scheduler.ParallelFor( 0, static_cast< size_t >( tilesPerRow ) * size, 1, [&]( size_t first, size_t last )
+        {
+            std::vector<uint8_t> in( static_cast< size_t >( tileLines ) * size ), out( in.size( ) );
+            std::vector<uint32_t> queue;
+            for ( size_t tile = first; tile < last; tile++ )
+            {
+                size_t v = tile / tilesPerRow, u = ( tile % tilesPerRow ) * tileLines;
+                size_t base = ( axis == 2 ? v * size : v * plane ) + u * lineStep;
+                uint32_t lines = ( std::min )( tileLines, static_cast< uint32_t >( size - u ) );
+                for ( uint32_t i = 0; i < size; i++ )
+                for ( uint32_t line = 0; line < lines; line++ )
+                    in[line * size + i] = cells[base + i * stride + line * lineStep];
+
+                for ( uint32_t line = 0; line < lines; line++ )
+                    TransformLine( &in[line * size], size, queue, &out[line * size] );
+
+                for ( uint32_t i = 0; i < size; i++ )
+                for ( uint32_t line = 0; line < lines; line++ )
+                    cells[base + i * stride + line * lineStep] = out[line * size + i];
+            }
+        } );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void OctreeDistanceField::Build( const CpuOctree &octree, uint32_t level, TaskScheduler &scheduler )
+{
+    const std::vector<uint32_t> &slots = octree.GetSlots( );
+    uint32_t height = octree.GetHeight( );
+    mLevel = ( std::min )( level, height > 0 ? height - 1 : 0 );
+    mSize = 1u << mLevel;
+    mDistances.assign( static_cast< size_t >( mSize ) * mSize * mSize, MAX_DISTANCE );
+
+    // top down through nodes with voxels, their nodes of the field level are the occupied cells
+    std::vector<FieldCell> cells( 1 ), next;
+    cells[0].mNodeIndex = 0;
+    cells[0].mCell[0] = cells[0].mCell[1] = cells[0].mCell[2] = 0;
+
+    for ( uint32_t depth = 0; depth <= mLevel; depth++ )
+    {
+        next.clear( );
+        for ( const FieldCell &cell : cells )
+        {
+            if ( slots[cell.mNodeIndex + ONS_FLAGS] != NODE_ALLOCATED )
+                continue;
+
+            if ( depth == mLevel )
+            {
+                mDistances[CellIndex( cell.mCell[0], cell.mCell[1], cell.mCell[2], mSize )] = 0;
+                continue;
+            }
+
+            for ( uint32_t i = 0; i < CHILDS_COUNT; i++ )
+            {
+                FieldCell child;
+                child.mNodeIndex = slots[cell.mNodeIndex + ONS_CHILDREN + i];
+                for ( int a = 0; a < 3; a++ )
+                    child.mCell[a] = cell.mCell[a] * 2 + ( ( i >> a ) & 1 );
+                next.push_back( child );
+            }
+        }
+        cells.swap( next );
+    }
+
+    ChebyshevDistanceTransform( mDistances, mSize, scheduler );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t OctreeDistanceField::GetLevel( ) const
+{
+    return mLevel;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t OctreeDistanceField::GetSize( ) const
+{
+    return mSize;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint8_t OctreeDistanceField::GetDistance( uint32_t x, uint32_t y, uint32_t z ) const
+{
+    return mDistances[CellIndex( x, y, z, mSize )];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const std::vector<uint8_t>& OctreeDistanceField::GetDistances( ) const
+{
+    return mDistances;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t OctreeDistanceField::GetByteSize( ) const
+{
+    return mDistances.size( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+EmptySpaceBenchmarkResult RunEmptySpaceBenchmark( uint32_t height, uint32_t level, size_t points, int iterations )
+{
+    typedef std::chrono::steady_clock Clock;
+    auto ms = []( Clock::time_point start ) { return std::chrono::duration< double, std::milli >( Clock::now( ) - start ).count( ); };
+
+    iterations = ( std::max )( iterations, 1 );
+    height = ( std::max )( 3u, ( std::min )( height, static_cast< uint32_t >( MAX_OCTREE_HEIGHT ) ) );
+
+    std::vector<OctreeVoxel> voxels;
+    std::vector<ConeTracePoint> surface;
+    GenerateConeTestRoom( height, voxels, surface );
+    CpuOctree octree;
+    octree.Build( voxels, height );
+
+    EmptySpaceBenchmarkResult result;
+    result.mHeight = height;
+    result.mLevel = level == 0 ? height - 2 : ( std::min )( level, height - 1 );
+
+    OctreeDistanceField field;
+    TaskScheduler serial( 0 );
+    TaskScheduler &parallel = TaskScheduler::Get( );
+    result.mThreads = parallel.GetThreadCount( );
+    result.mSerialBuildMs = result.mParallelBuildMs = 1e30;
+    for ( int it = 0; it < iterations; it++ )
+    {
+        Clock::time_point start = Clock::now( );
+        field.Build( octree, result.mLevel, serial );
+        result.mSerialBuildMs = ( std::min )( result.mSerialBuildMs, ms( start ) );
+
+        start = Clock::now( );
+        field.Build( octree, result.mLevel, parallel );
+        result.mParallelBuildMs = ( std::min )( result.mParallelBuildMs, ms( start ) );
+    }
+    result.mFieldBytes = field.GetByteSize( );
+    const std::vector<uint8_t> &distances = field.GetDistances( );
+    result.mEmptyCells = distances.size( ) - static_cast< size_t >( std::count( distances.begin( ), distances.end( ), 0 ) );
+
+    // cone march benchmark settings
+    ConeTraceParams params;
+    params.mFirstLevel = height - 2;
+    params.mLastLevel = params.mFirstLevel > 4 ? params.mFirstLevel - 4 : 0;
+    float voxelSize = ( params.mMax[0] - params.mMin[0] ) / octree.GetResolution( );
+
+    std::mt19937 rng( 13 );
+    std::uniform_int_distribution<size_t> pick( 0, surface.size( ) - 1 );
+    std::vector<ConeTracePoint> traced( points );
+    for ( ConeTracePoint &point : traced )
+    {
+        point = surface[pick( rng )];
+        for ( int a = 0; a < 3; a++ )
+            point.mPosition[a] = params.mMin[a] + point.mPosition[a] * voxelSize;
+    }
+    result.mPoints = traced.size( );
+
+    ConeTraceVolumes volumes;
+    volumes.mEmptySpace = &field;
+    std::vector<float> baseColors( traced.size( ) * 4 ), skipColors( traced.size( ) * 4 );
+    OctreeMarchStats baseStats, skipStats;
+    result.mBaseMs = result.mSkipMs = 1e30;
+    for ( int it = 0; it < iterations; it++ )
+    {
+        baseStats = OctreeMarchStats( );
+        Clock::time_point start = Clock::now( );
+        for ( size_t i = 0; i < traced.size( ); i++ )
+            TraceCones( octree, params, traced[i].mPosition, traced[i].mNormal, CL_ROPES, &baseColors[i * 4], baseStats );
+        result.mBaseMs = ( std::min )( result.mBaseMs, ms( start ) );
+
+        skipStats = OctreeMarchStats( );
+        start = Clock::now( );
+        for ( size_t i = 0; i < traced.size( ); i++ )
+            TraceCones( octree, params, traced[i].mPosition, traced[i].mNormal, CL_ROPES, &skipColors[i * 4], skipStats, volumes );
+        result.mSkipMs = ( std::min )( result.mSkipMs, ms( start ) );
+    }
+
+    result.mSamples = baseStats.mLookups;
+    result.mSkippedSamples = skipStats.mSkippedSamples;
+    double samples = static_cast< double >( ( std::max )( result.mSamples, size_t( 1 ) ) );
+    result.mBaseFetches = baseStats.mFetches / samples;
+    result.mSkipFetches = skipStats.mFetches / samples;
+    result.mFieldFetches = skipStats.mFieldFetches / samples;
+    result.mResultsMatch = baseColors == skipColors;
+    return result;
+}
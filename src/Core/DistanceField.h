@@ -0,0 +1,58 @@
+#ifndef __DISTANCE_FIELD_H
+#define __DISTANCE_FIELD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class CpuOctree;
+class TaskScheduler;
+
+// chebyshev distance in cells to the nearest occupied cell of a cubic grid, x fastest: occupied cells are 0 and empty ones 255
+// on input; separable min of max passes along x, y and z with lines in parallel, distances saturate at 255
+void ChebyshevDistanceTransform( std::vector<uint8_t> &cells, uint32_t size, TaskScheduler &scheduler );
+
+// distance to the nearest cell with voxels per cell of one octree level, a byte per cell; cells closer than that
+// distance have no voxels, so TraceCones steps over samples whose nodes lie there
+class OctreeDistanceField
+{
+public:
+    // cells of nodes with voxels are occupied, level is clamped to the last node level
+    void Build( const CpuOctree &octree, uint32_t level, TaskScheduler &scheduler );
+
+    uint32_t GetLevel( ) const;
+    uint32_t GetSize( ) const; // cells per axis, 1 << level
+    uint8_t GetDistance( uint32_t x, uint32_t y, uint32_t z ) const;
+    const std::vector<uint8_t>& GetDistances( ) const;
+    size_t GetByteSize( ) const;
+
+private:
+    uint32_t mLevel = 0;
+    uint32_t mSize = 0;
+    std::vector<uint8_t> mDistances;
+};
+
+struct EmptySpaceBenchmarkResult
+{
+    uint32_t mHeight = 0;
+    uint32_t mLevel = 0; // field level
+    size_t mPoints = 0;
+    size_t mFieldBytes = 0;
+    size_t mEmptyCells = 0; // cells without voxels
+    size_t mThreads = 0; // of the parallel build
+    double mSerialBuildMs = 0.0;
+    double mParallelBuildMs = 0.0;
+    size_t mSamples = 0; // cone samples inside the scene box
+    size_t mSkippedSamples = 0;
+    double mBaseFetches = 0.0; // octree texels per sample, neighbor ropes
+    double mSkipFetches = 0.0;
+    double mFieldFetches = 0.0; // field texels per sample
+    double mBaseMs = 0.0;
+    double mSkipMs = 0.0;
+    bool mResultsMatch = false; // skipping gives the same colors
+};
+
+// field and cones of the cone march benchmark room, field level 0 - one above the last node level
+EmptySpaceBenchmarkResult RunEmptySpaceBenchmark( uint32_t height, uint32_t level, size_t points, int iterations );
+
+#endif
@@ -0,0 +1,171 @@
+#include <Core/FramePacer.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static FramePacer::Clock::duration SecondsToDuration( float seconds )
+{
+    return std::chrono::duration_cast< FramePacer::Clock::duration >( std::chrono::duration< float >( seconds ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static float DurationToSeconds( FramePacer::Clock::duration d )
+{
+    return std::chrono::duration_cast< std::chrono::duration< float > >( d ).count( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FramePacer::FramePacer( size_t historySize ) :
+    mTargetFrameTime( 0.0f ),
+    mSpinThreshold( 0.002f ),
+    mSleepOvershoot( 0.0f ),
+    mMode( FPM_AFTER_PRESENT ),
+    mFirstFrame( true ),
+    mHistory( std::max( historySize, size_t( 1 ) ), 0.0f ),
+    mHistoryPos( 0 ),
+    mHistoryCount( 0 )
+{
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FramePacer::SetTargetFrameTime( float seconds )
+{
+    if ( seconds != mTargetFrameTime )
+        mFirstFrame = true; // restart deadline chain
+
+    mTargetFrameTime = seconds;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FramePacer::SetSpinThreshold( float seconds )
+{
+    mSpinThreshold = std::max( 0.0f, seconds );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FramePacer::SetMode( FramePacingMode mode )
+{
+    mMode = mode;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float FramePacer::GetTargetFrameTime( ) const
+{
+    return mTargetFrameTime;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FramePacingMode FramePacer::GetMode( ) const
+{
+    return mMode;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FramePacer::Reset( )
+{
+    mFirstFrame = true;
+    mHistoryPos = 0;
+    mHistoryCount = 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FramePacer::Wait( )
+{
+    Clock::time_point now = Clock::now( );
+    if ( mFirstFrame )
+    {
+        mFirstFrame = false;
+        mDeadline = now;
+        mLastFrameStart = now;
+        return;
+    }
+
+    if ( mTargetFrameTime > 0.0f )
+    {
+        Clock::duration frame = SecondsToDuration( mTargetFrameTime );
+        mDeadline += frame;
+
+        // we are more than one frame late, don't try to catch up with a burst of short frames
+        if ( now > mDeadline + frame )
+            mDeadline = now;
+
+        WaitUntil( mDeadline );
+    }
+
+    Clock::time_point frameStart = Clock::now( );
+    AddFrameTime( DurationToSeconds( frameStart - mLastFrameStart ) );
+    mLastFrameStart = frameStart;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FramePacer::WaitUntil( Clock::time_point deadline )
+{
+    // coarse part: sleep while there is enough time left
+    Clock::duration margin = SecondsToDuration( mSpinThreshold + mSleepOvershoot );
+    Clock::time_point now = Clock::now( );
+    if ( deadline - now > margin )
+    {
+        Clock::duration sleepFor = deadline - now - margin;
+        std::this_thread::sleep_for( sleepFor );
+
+        // track how much the scheduler oversleeps, slowly forget old peaks
+        float overshoot = DurationToSeconds( Clock::now( ) - now - sleepFor );
+        mSleepOvershoot = std::max( overshoot, mSleepOvershoot * 0.99f );
+    }
+
+    // fine part: spin until deadline
+    while ( Clock::now( ) < deadline )
+        std::this_thread::yield( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FramePacer::AddFrameTime( float seconds )
+{
+    mHistory[mHistoryPos] = seconds;
+    mHistoryPos = ( mHistoryPos + 1 ) % mHistory.size( );
+    mHistoryCount = std::min( mHistoryCount + 1, mHistory.size( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FrameStats FramePacer::GetStats( ) const
+{
+    FrameStats stats;
+    if ( mHistoryCount == 0 )
+        return stats;
+
+    double sum = 0.0;
+    stats.mMin = mHistory[0];
+    stats.mMax = mHistory[0];
+    for ( size_t i = 0; i < mHistoryCount; i++ )
+    {
+        sum += mHistory[i];
+        stats.mMin = std::min( stats.mMin, mHistory[i] );
+        stats.mMax = std::max( stats.mMax, mHistory[i] );
+    }
+
+    double mean = sum / mHistoryCount;
+    double variance = 0.0;
+    for ( size_t i = 0; i < mHistoryCount; i++ )
+        variance += ( mHistory[i] - mean ) * ( mHistory[i] - mean );
+    variance /= mHistoryCount;
+
+    stats.mMean = static_cast< float >( mean );
+    stats.mStdDev = static_cast< float >( std::sqrt( variance ) );
+    stats.mCount = mHistoryCount;
+    return stats;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float FramePacer::GetSleepOvershoot( ) const
+{
+    return mSleepOvershoot;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FrameStats FramePacer::RunJitterBenchmark( float targetFrameTime, float spinThreshold, float workTime, size_t frames )
+{
+    FramePacer pacer( frames );
+    pacer.SetTargetFrameTime( targetFrameTime );
+    pacer.SetSpinThreshold( spinThreshold );
+
+    Clock::duration work = SecondsToDuration( workTime );
+    pacer.Wait( ); // first call only sets up deadline
+    for ( size_t i = 0; i < frames; i++ )
+    {
+        // busy work instead of sleep, sleep would add its own jitter
+        Clock::time_point workEnd = Clock::now( ) + work;
+        while ( Clock::now( ) < workEnd );
+
+        pacer.Wait( );
+    }
+
+    return pacer.GetStats( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,71 @@
+#ifndef __FRAME_PACER_H
+#define __FRAME_PACER_H
+
+#include <chrono>
+#include <vector>
+
+// where the frame wait happens
+enum FramePacingMode
+{
+    FPM_AFTER_PRESENT, // wait after the frame is presented (classic cap)
+    FPM_BEFORE_INPUT,  // wait before input sampling, so input is as fresh as possible when the frame starts
+
+    FPM_COUNT
+};
+
+// frame time statistics in seconds
+struct FrameStats
+{
+    float mMean = 0.0f;
+    float mStdDev = 0.0f; // jitter
+    float mMin = 0.0f;
+    float mMax = 0.0f;
+    size_t mCount = 0;
+};
+
+// portable frame limiter
+// waits until a fixed deadline using sleep for the coarse part and spin for the rest,
+// so scheduler quantum doesn't leak into the frame time
+class FramePacer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit FramePacer( size_t historySize = 120 );
+
+    void SetTargetFrameTime( float seconds ); // <= 0 disables waiting
+    void SetSpinThreshold( float seconds );
+    void SetMode( FramePacingMode mode );
+
+    float GetTargetFrameTime( ) const;
+    FramePacingMode GetMode( ) const;
+
+    void Wait( ); // blocks until the next frame deadline and records frame interval
+    void Reset( );
+
+    // records a frame interval measured elsewhere, Wait records its own
+    void AddFrameTime( float seconds );
+    FrameStats GetStats( ) const; // of the last historySize frames
+    float GetSleepOvershoot( ) const; // seconds the scheduler oversleeps, kept on top of the spin threshold
+
+    // runs paced loop without window and gpu, simulating workTime seconds of work per frame
+    static FrameStats RunJitterBenchmark( float targetFrameTime, float spinThreshold, float workTime, size_t frames );
+
+private:
+    float mTargetFrameTime;
+    float mSpinThreshold;
+    float mSleepOvershoot; // measured sleep inaccuracy, added to spin threshold
+    FramePacingMode mMode;
+
+    bool mFirstFrame;
+    Clock::time_point mDeadline;
+    Clock::time_point mLastFrameStart;
+
+    std::vector<float> mHistory; // ring buffer of frame intervals
+    size_t mHistoryPos;
+    size_t mHistoryCount;
+
+    void WaitUntil( Clock::time_point deadline );
+};
+
+#endif
@@ -0,0 +1,344 @@
+#include <Core/IrradianceCache.h>
+#include <Core/DistanceField.h>
+#include <Core/TaskScheduler.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    size_t RegionIndex( uint32_t x, uint32_t y, uint32_t z, uint32_t size )
+    {
+        return ( static_cast< size_t >( z ) * size + y ) * size + x;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UnpackVoxelNormal( uint32_t packed, float normal[3] )
+{
+    float length = 0.0f;
+    for ( int a = 0; a < 3; a++ )
+    {
+        normal[a] = ( ( packed >> ( a * 8 ) ) & 0xff ) / 255.0f * 2.0f - 1.0f;
+        length += normal[a] * normal[a];
+    }
+    length = std::sqrt( length );
+    for ( int a = 0; a < 3; a++ )
+        normal[a] = length > 0.0f ? normal[a] / length : ( a == 1 ? 1.0f : 0.0f );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void GetLeafCenter( const ConeTraceParams &params, uint32_t resolution, uint32_t packedPosition, float center[3] )
+{
+    uint32_t coords[3];
+    UnpackOctreePosition( packedPosition, coords[0], coords[1], coords[2] );
+    for ( int a = 0; a < 3; a++ )
+        center[a] = params.mMin[a] + ( coords[a] + 0.5f ) * ( params.mMax[a] - params.mMin[a] ) / resolution;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float GetConeReach( const CpuOctree &octree, const ConeTraceParams &params )
+{
+    if ( params.mFirstLevel <= params.mLastLevel )
+        return 0.0f;
+
+    // the last sample of TraceCones is the farthest one and reads the biggest nodes
+    float extent = params.mMax[0] - params.mMin[0];
+    uint32_t level = params.mLastLevel + 1;
+    float offset = params.mLocalConeOffset + extent / static_cast< float >( 1u << ( level + 1 ) ) * 1.4142f * params.mStepCorrection;
+    float footprint = 1.5f * extent / static_cast< float >( 1u << level );
+    return ( params.mWorldConeOffset + offset + footprint ) / ( extent / octree.GetResolution( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void IrradianceCache::Reset( const std::vector<OctreeVoxel> &voxels, uint32_t height, uint32_t regionLevel )
+{
+    mHeight = height;
+    mRegionLevel = ( std::min )( regionLevel, height );
+    uint32_t size = 1u << mRegionLevel, shift = mHeight - mRegionLevel;
+    mRegionStamps.assign( static_cast< size_t >( size ) * size * size, 1 );
+
+    mEntries.resize( voxels.size( ) );
+    for ( size_t i = 0; i < voxels.size( ); i++ )
+    {
+        Entry &entry = mEntries[i];
+        uint32_t x, y, z;
+        UnpackOctreePosition( voxels[i].mPosition, x, y, z );
+        entry.mPosition = voxels[i].mPosition;
+        entry.mNormal = voxels[i].mNormal;
+        entry.mStamp = 0;
+        entry.mRegion = static_cast< uint32_t >( RegionIndex( x >> shift, y >> shift, z >> shift, size ) );
+    }
+    ResetStats( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void IrradianceCache::InvalidateAll( )
+{
+    for ( uint32_t &stamp : mRegionStamps )
+        stamp++;
+    mStats.mInvalidatedRegions += mRegionStamps.size( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IrradianceCache::Invalidate( const std::vector<PhotonLeaf> &lit, float reach, TaskScheduler &scheduler )
+{
+    uint32_t size = 1u << mRegionLevel, shift = mHeight - mRegionLevel, resolution = 1u << mHeight;
+
+    // regions of lit leaves, then every region close enough to one of them
+    mRegionDistances.assign( mRegionStamps.size( ), 255 );
+    for ( const PhotonLeaf &leaf : lit )
+    {
+        uint32_t x, y, z;
+        MortonDecode( leaf.mKey, x, y, z );
+        if ( x < resolution && y < resolution && z < resolution )
+            mRegionDistances[RegionIndex( x >> shift, y >> shift, z >> shift, size )] = 0;
+    }
+    ChebyshevDistanceTransform( mRegionDistances, size, scheduler );
+
+    // a leaf within reach of a lit leaf is at most ceil( reach / region width ) regions away from it
+    uint32_t radius = static_cast< uint32_t >( std::ceil( ( std::max )( reach, 0.0f ) / ( 1u << shift ) ) );
+    size_t invalidated = 0;
+    for ( size_t i = 0; i < mRegionStamps.size( ); i++ )
+    {
+        if ( mRegionDistances[i] <= radius )
+        {
+            mRegionStamps[i]++;
+            invalidated++;
+        }
+    }
+    mStats.mInvalidatedRegions += invalidated;
+    return invalidated;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool IrradianceCache::IsValid( uint32_t voxel ) const
+{
+    const Entry &entry = mEntries[voxel];
+    return entry.mStamp == mRegionStamps[entry.mRegion];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const float* IrradianceCache::Find( uint32_t voxel )
+{
+    mStats.mLookups++;
+    if ( !IsValid( voxel ) )
+        return nullptr;
+    mStats.mHits++;
+    return mEntries[voxel].mValue;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void IrradianceCache::Store( uint32_t voxel, const float value[4] )
+{
+    Entry &entry = mEntries[voxel];
+    for ( int c = 0; c < 4; c++ )
+        entry.mValue[c] = value[c];
+    entry.mStamp = mRegionStamps[entry.mRegion];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void IrradianceCache::Shade( const CpuOctree &octree, const ConeTraceParams &params, const float position[3], const float normal[3],
+    float result[4] )
+{
+    // leaf centers around the point with the weights of a trilinear filter
+    int resolution = static_cast< int >( octree.GetResolution( ) );
+    int base[3];
+    float f[3];
+    for ( int a = 0; a < 3; a++ )
+    {
+        float t = ( position[a] - params.mMin[a] ) / ( params.mMax[a] - params.mMin[a] ) * resolution - 0.5f;
+        float cell = std::floor( t );
+        f[a] = t - cell;
+        base[a] = static_cast< int >( cell );
+    }
+
+    // the corners are in at most 2x2x2 last level nodes, the marcher walks between them over neighbor links
+    OctreeMarchState state;
+    float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, weightSum = 0.0f;
+    for ( int corner = 0; corner < 8; corner++ )
+    {
+        float weight = 1.0f;
+        int coords[3];
+        for ( int a = 0; a < 3; a++ )
+        {
+            bool upper = ( ( corner >> a ) & 1 ) != 0;
+            weight *= upper ? f[a] : 1.0f - f[a];
+            coords[a] = base[a] + ( upper ? 1 : 0 );
+        }
+        if ( weight <= 0.0f || ( std::min )( coords[0], ( std::min )( coords[1], coords[2] ) ) < 0
+            || ( std::max )( coords[0], ( std::max )( coords[1], coords[2] ) ) >= resolution )
+            continue;
+
+        uint32_t nodeIndex, nodeCoords[3];
+        if ( !MarchOctree( octree, state, coords[0], coords[1], coords[2], mHeight - 1, nodeIndex, nodeCoords, mStats.mLeafLookups ) )
+            continue;
+        uint32_t voxel = octree.Fetch( nodeIndex + GetChildSlot( coords[0], coords[1], coords[2] ) );
+        mStats.mLeafLookups.mFetches++;
+        if ( voxel == NODE_UNDEFINED || voxel >= mEntries.size( ) )
+            continue;
+
+        // leaves of the other side of a thin wall or around a sharp edge don't see the same light
+        float leafNormal[3];
+        UnpackVoxelNormal( mEntries[voxel].mNormal, leafNormal );
+        if ( leafNormal[0] * normal[0] + leafNormal[1] * normal[1] + leafNormal[2] * normal[2] < 0.5f )
+            continue;
+
+        const float *value = Find( voxel );
+        if ( value == nullptr )
+        {
+            float center[3], traced[4];
+            GetLeafCenter( params, octree.GetResolution( ), mEntries[voxel].mPosition, center );
+            TraceCones( octree, params, center, leafNormal, CL_ROPES, traced, mStats.mTraces );
+            Store( voxel, traced );
+            mStats.mFills++;
+            value = mEntries[voxel].mValue;
+        }
+
+        for ( int c = 0; c < 4; c++ )
+            sum[c] += value[c] * weight;
+        weightSum += weight;
+    }
+
+    if ( weightSum > 0.0f )
+    {
+        for ( int c = 0; c < 4; c++ )
+            result[c] = sum[c] / weightSum;
+        return;
+    }
+
+    mStats.mFallbacks++;
+    TraceCones( octree, params, position, normal, CL_ROPES, result, mStats.mTraces );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IrradianceCache::GetEntryCount( ) const
+{
+    return mEntries.size( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IrradianceCache::GetValidCount( ) const
+{
+    size_t valid = 0;
+    for ( size_t i = 0; i < mEntries.size( ); i++ )
+        valid += IsValid( static_cast< uint32_t >( i ) ) ? 1 : 0;
+    return valid;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IrradianceCache::GetRegionCount( ) const
+{
+    return mRegionStamps.size( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t IrradianceCache::GetByteSize( ) const
+{
+    return mEntries.size( ) * sizeof( Entry ) + mRegionStamps.size( ) * sizeof( uint32_t );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const IrradianceCacheStats& IrradianceCache::GetStats( ) const
+{
+    return mStats;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void IrradianceCache::ResetStats( )
+{
+    mStats = IrradianceCacheStats( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+IrradianceCacheBenchmarkResult RunIrradianceCacheBenchmark( uint32_t height, size_t pixels, uint32_t frames )
+{
+    typedef std::chrono::steady_clock Clock;
+    auto ms = []( Clock::time_point start ) { return std::chrono::duration< double, std::milli >( Clock::now( ) - start ).count( ); };
+
+    height = ( std::max )( 4u, ( std::min )( height, static_cast< uint32_t >( MAX_OCTREE_HEIGHT ) ) );
+    frames = ( std::max )( frames, 2u );
+
+    std::vector<OctreeVoxel> voxels;
+    std::vector<ConeTracePoint> surface;
+    GenerateConeTestRoom( height, voxels, surface );
+    CpuOctree octree;
+    octree.Build( voxels, height );
+
+    // cone march benchmark settings
+    ConeTraceParams params;
+    params.mFirstLevel = height - 2;
+    params.mLastLevel = params.mFirstLevel > 4 ? params.mFirstLevel - 4 : 0;
+    float resolution = static_cast< float >( octree.GetResolution( ) );
+    float voxelSize = ( params.mMax[0] - params.mMin[0] ) / resolution;
+
+    IrradianceCacheBenchmarkResult result;
+    result.mHeight = height;
+    result.mPixels = pixels;
+    result.mReach = GetConeReach( octree, params );
+
+    IrradianceCache cache;
+    cache.Reset( voxels, height, height - 3 );
+    result.mEntries = cache.GetEntryCount( );
+    result.mBytes = cache.GetByteSize( );
+    result.mRegions = cache.GetRegionCount( );
+
+    std::mt19937 rng( 17 );
+    std::uniform_int_distribution<size_t> pick( 0, surface.size( ) - 1 );
+    std::uniform_real_distribution<float> jitter( -0.45f, 0.45f );
+    std::vector<ConeTracePoint> visible( pixels );
+    std::vector<float> cached( pixels * 4 ), traced( pixels * 4 );
+    double difference = 0.0;
+
+    for ( uint32_t frame = 0; frame < frames; frame++ )
+    {
+        // the camera looks at a point orbiting the room center, pixels are jittered surface points around it
+        float angle = frame * 0.05f, target[3] = { 0.5f + 0.2f * std::cos( angle ), 0.35f, 0.5f + 0.2f * std::sin( angle ) };
+        for ( ConeTracePoint &point : visible )
+        {
+            for ( int tries = 0; tries < 64; tries++ )
+            {
+                point = surface[pick( rng )];
+                float d = 0.0f;
+                for ( int a = 0; a < 3; a++ )
+                    d = ( std::max )( d, std::fabs( point.mPosition[a] / resolution - target[a] ) );
+                if ( d < 0.3f )
+                    break;
+            }
+            for ( int a = 0; a < 3; a++ )
+                point.mPosition[a] = params.mMin[a] + ( point.mPosition[a] + jitter( rng ) * ( 1.0f - std::fabs( point.mNormal[a] ) ) ) * voxelSize;
+        }
+
+        // a local light on the floor changes halfway
+        if ( frame == frames / 2 )
+        {
+            std::vector<PhotonLeaf> lit;
+            uint32_t r = octree.GetResolution( ), radius = ( std::max )( r / 16, 1u );
+            for ( const OctreeVoxel &voxel : voxels )
+            {
+                uint32_t x, y, z;
+                UnpackOctreePosition( voxel.mPosition, x, y, z );
+                if ( y == 0 && std::abs( static_cast< int >( x ) - static_cast< int >( r / 4 ) ) <= static_cast< int >( radius )
+                    && std::abs( static_cast< int >( z ) - static_cast< int >( r / 4 ) ) <= static_cast< int >( radius ) )
+                {
+                    PhotonLeaf leaf = { MortonEncode( x, y, z ), 1, { 1.0f, 1.0f, 1.0f } };
+                    lit.push_back( leaf );
+                }
+            }
+            size_t validBefore = cache.GetValidCount( );
+            result.mRelitLeaves = lit.size( );
+            result.mInvalidatedRegions = cache.Invalidate( lit, result.mReach, TaskScheduler::Get( ) );
+            result.mInvalidatedEntries = validBefore - cache.GetValidCount( );
+        }
+
+        size_t lookups = cache.GetStats( ).mLookups, hits = cache.GetStats( ).mHits;
+        Clock::time_point start = Clock::now( );
+        for ( size_t i = 0; i < visible.size( ); i++ )
+            cache.Shade( octree, params, visible[i].mPosition, visible[i].mNormal, &cached[i * 4] );
+        if ( frame == 0 )
+            result.mColdMs = ms( start );
+        else
+            result.mCachedMs += ms( start ) / ( frames - 1 );
+        size_t frameLookups = cache.GetStats( ).mLookups - lookups;
+        result.mHitRates.push_back( frameLookups > 0 ? ( cache.GetStats( ).mHits - hits ) / static_cast< double >( frameLookups ) : 0.0 );
+
+        OctreeMarchStats stats;
+        start = Clock::now( );
+        for ( size_t i = 0; i < visible.size( ); i++ )
+            TraceCones( octree, params, visible[i].mPosition, visible[i].mNormal, CL_ROPES, &traced[i * 4], stats );
+        result.mTracedMs += ms( start );
+
+        for ( size_t i = 0; i < cached.size( ); i++ )
+            difference += std::fabs( cached[i] - traced[i] );
+    }
+
+    result.mTracedMs /= frames;
+    result.mMeanDifference = pixels > 0 ? difference / ( static_cast< double >( pixels ) * 4 * frames ) : 0.0;
+    return result;
+}
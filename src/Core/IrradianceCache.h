@@ -0,0 +1,99 @@
+#ifndef __IRRADIANCE_CACHE_H
+#define __IRRADIANCE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <Core/ConeTracer.h>
+#include <Core/PhotonList.h>
+
+class TaskScheduler;
+
+struct IrradianceCacheStats
+{
+    size_t mLookups = 0; // leaf values asked for by shaded points
+    size_t mHits = 0;
+    size_t mFills = 0; // leaves traced on a miss
+    size_t mFallbacks = 0; // points without a usable leaf, traced directly
+    size_t mInvalidatedRegions = 0;
+    OctreeMarchStats mLeafLookups; // leaves around shaded points
+    OctreeMarchStats mTraces; // cones of fills and fallbacks
+};
+
+// unit normal of OctreeVoxel::mNormal ( rgb8 of normal * 0.5 + 0.5 ), +y for a zero normal
+void UnpackVoxelNormal( uint32_t packed, float normal[3] );
+// scene position of the center of a leaf of the octree
+void GetLeafCenter( const ConeTraceParams &params, uint32_t resolution, uint32_t packedPosition, float center[3] );
+
+// farthest a cone of a point reads the octree, sample offset and node footprint, in leaves
+float GetConeReach( const CpuOctree &octree, const ConeTraceParams &params );
+
+// view independent cone results per octree leaf, traced the first time a shaded point needs the leaf and kept across
+// frames; a relight invalidates the regions ( cells of a coarse level ) whose cones can reach the lit leaves
+class IrradianceCache
+{
+public:
+    // an entry per voxel of the octree build, everything starts invalid
+    void Reset( const std::vector<OctreeVoxel> &voxels, uint32_t height, uint32_t regionLevel );
+
+    // irradiance was rebuilt or the scene revoxelized
+    void InvalidateAll( );
+    // photon leaves of one ProcessShadowMap ( positive or negative injection ), reach from GetConeReach;
+    // returns the number of invalidated regions
+    size_t Invalidate( const std::vector<PhotonLeaf> &lit, float reach, TaskScheduler &scheduler );
+
+    bool IsValid( uint32_t voxel ) const;
+    const float* Find( uint32_t voxel ); // nullptr on a miss, counted in stats
+    void Store( uint32_t voxel, const float value[4] );
+
+    // TraceCones replacement for a surface point: trilinear blend of the leaves around it that face the same way,
+    // missing leaves are traced from their center along their normal
+    void Shade( const CpuOctree &octree, const ConeTraceParams &params, const float position[3], const float normal[3], float result[4] );
+
+    size_t GetEntryCount( ) const;
+    size_t GetValidCount( ) const;
+    size_t GetRegionCount( ) const;
+    size_t GetByteSize( ) const;
+    const IrradianceCacheStats& GetStats( ) const;
+    void ResetStats( );
+
+private:
+    struct Entry
+    {
+        float mValue[4]; // TraceCones result
+        uint32_t mPosition; // PackOctreePosition of the leaf
+        uint32_t mNormal;
+        uint32_t mStamp; // valid while equal to the stamp of its region
+        uint32_t mRegion;
+    };
+
+    uint32_t mHeight = 0;
+    uint32_t mRegionLevel = 0;
+    std::vector<Entry> mEntries;
+    std::vector<uint32_t> mRegionStamps;
+    std::vector<uint8_t> mRegionDistances; // scratch of Invalidate
+    IrradianceCacheStats mStats;
+};
+
+struct IrradianceCacheBenchmarkResult
+{
+    uint32_t mHeight = 0;
+    size_t mEntries = 0;
+    size_t mBytes = 0;
+    size_t mRegions = 0;
+    size_t mPixels = 0; // shaded points per frame
+    std::vector<double> mHitRates; // per frame
+    double mColdMs = 0.0; // first frame, fills most leaves
+    double mCachedMs = 0.0; // mean time of the other frames
+    double mTracedMs = 0.0; // mean frame time of TraceCones per point
+    double mMeanDifference = 0.0; // mean abs difference of interpolated against traced results
+    float mReach = 0.0f; // leaves
+    size_t mRelitLeaves = 0; // local light in the middle frame
+    size_t mInvalidatedRegions = 0;
+    size_t mInvalidatedEntries = 0;
+};
+
+// orbiting view over the room of the cone march benchmark, a local light changes halfway
+IrradianceCacheBenchmarkResult RunIrradianceCacheBenchmark( uint32_t height, size_t pixels, uint32_t frames );
+
+#endif
@@ -0,0 +1,259 @@
+#include <Core/LightManager.h>
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+namespace
+{
+    const float PI = 3.14159265f;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool Equal3( const float a[3], const float b[3] )
+    {
+        return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    float Dot( const float a[3], const float b[3] )
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void Cross( const float a[3], const float b[3], float out[3] )
+    {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void Normalize( float v[3] )
+    {
+        float len = std::sqrt( Dot( v, v ) );
+        if ( len > 0.0f )
+        {
+            v[0] /= len;
+            v[1] /= len;
+            v[2] /= len;
+        }
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void LookTo( const float eye[3], const float dir[3], const float upHint[3], float view[16] )
+    {
+        // right handed, camera looks along -z
+        float back[3] = { -dir[0], -dir[1], -dir[2] };
+        Normalize( back );
+        float right[3], up[3];
+        Cross( upHint, back, right );
+        Normalize( right );
+        Cross( back, right, up );
+
+        for ( int r = 0; r < 3; r++ )
+        {
+            view[r * 4 + 0] = right[r];
+            view[r * 4 + 1] = up[r];
+            view[r * 4 + 2] = back[r];
+            view[r * 4 + 3] = 0.0f;
+        }
+        view[12] = -Dot( right, eye );
+        view[13] = -Dot( up, eye );
+        view[14] = -Dot( back, eye );
+        view[15] = 1.0f;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void Perspective( float fovY, float nearZ, float farZ, float proj[16] )
+    {
+        // square, right handed, z in [0, 1]
+        memset( proj, 0, sizeof( float ) * 16 );
+        proj[0] = proj[5] = 1.0f / std::tan( fovY * 0.5f );
+        proj[10] = farZ / ( nearZ - farZ );
+        proj[11] = -1.0f;
+        proj[14] = nearZ * farZ / ( nearZ - farZ );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LightState::operator==( const LightState &r ) const
+{
+    return mType == r.mType && Equal3( mPosition, r.mPosition ) && Equal3( mDirection, r.mDirection ) &&
+        Equal3( mColor, r.mColor ) && mRadius == r.mRadius && mSpotAngle == r.mSpotAngle;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LightState::operator!=( const LightState &r ) const
+{
+    return !( *this == r );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int LightSchedule::GetFaceCount( ) const
+{
+    int count = 0;
+    for ( const LightInjection &injection : mInjections )
+        count += GetLightFaceCount( injection.mState.mType );
+    return count;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int GetLightFaceCount( LightKind type )
+{
+    return type == LIGHT_POINT ? 6 : 1;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void GetLightFaceMatrices( const LightState &light, int face, float view[16], float proj[16] )
+{
+    static const float cubeDirs[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    static const float cubeUps[6][3] = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, 1, 0 }, { 0, 1, 0 } };
+
+    float nearZ = std::max( light.mRadius * 0.01f, 0.01f );
+    float farZ = std::max( light.mRadius, nearZ * 2.0f );
+
+    if ( light.mType == LIGHT_POINT )
+    {
+        LookTo( light.mPosition, cubeDirs[face % 6], cubeUps[face % 6], view );
+        Perspective( PI * 0.5f, nearZ, farZ, proj );
+        return;
+    }
+
+    // spot cone fits into one frustum
+    static const float up[3] = { 0.0f, 1.0f, 0.0f };
+    static const float side[3] = { 1.0f, 0.0f, 0.0f };
+    float dir[3] = { light.mDirection[0], light.mDirection[1], light.mDirection[2] };
+    Normalize( dir );
+    LookTo( light.mPosition, dir, std::fabs( dir[1] ) < 0.99f ? up : side, view );
+    Perspective( std::min( light.mSpotAngle * 2.0f, PI * 0.95f ), nearZ, farZ, proj );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LightManager::SetBudget( int facesPerFrame )
+{
+    mBudget = std::max( facesPerFrame, 1 );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LightManager::SetMaxDeltaUpdates( int count )
+{
+    mMaxDeltaUpdates = std::max( count, 1 );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LightManager::Sync( const std::vector<LightState> &lights )
+{
+    if ( lights.size( ) > mEntries.size( ) )
+        mEntries.resize( lights.size( ) );
+
+    for ( size_t i = 0; i < mEntries.size( ); i++ )
+    {
+        Entry &entry = mEntries[i];
+        entry.mHasCurrent = i < lights.size( );
+        if ( entry.mHasCurrent )
+            entry.mCurrent = lights[i];
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+LightSchedule LightManager::Schedule( )
+{
+    LightSchedule schedule;
+
+    // injected directional light can't be taken back
+    for ( const Entry &entry : mEntries )
+        mRebuild |= IsDirty( entry ) && entry.mHasInjected && entry.mInjected.mType == LIGHT_DIRECTIONAL;
+
+    if ( mRebuild )
+    {
+        schedule.mRebuild = true;
+        for ( Entry &entry : mEntries )
+            entry.mHasInjected = false;
+        mDeltaUpdates = 0;
+        mRebuild = false;
+    }
+
+    auto commit = [&]( uint32_t index )
+    {
+        Entry &entry = mEntries[index];
+        if ( entry.mHasInjected )
+        {
+            LightInjection removal;
+            removal.mLight = index;
+            removal.mState = entry.mInjected;
+            removal.mSign = -1.0f;
+            schedule.mInjections.push_back( removal );
+            mDeltaUpdates++;
+        }
+        if ( entry.mHasCurrent )
+        {
+            LightInjection injection;
+            injection.mLight = index;
+            injection.mState = entry.mCurrent;
+            schedule.mInjections.push_back( injection );
+        }
+
+        entry.mInjected = entry.mCurrent;
+        entry.mHasInjected = entry.mHasCurrent;
+        entry.mWaitFrames = 0;
+    };
+
+    // directional lights go first and aren't budgeted, local ones wait in line
+    std::vector<uint32_t> local;
+    for ( size_t i = 0; i < mEntries.size( ); i++ )
+    {
+        const Entry &entry = mEntries[i];
+        if ( !IsDirty( entry ) )
+            continue;
+
+        if ( entry.mHasCurrent && entry.mCurrent.mType == LIGHT_DIRECTIONAL )
+            commit( static_cast< uint32_t >( i ) );
+        else
+            local.push_back( static_cast< uint32_t >( i ) );
+    }
+
+    std::stable_sort( local.begin( ), local.end( ), [&]( uint32_t a, uint32_t b )
+    {
+        return mEntries[a].mWaitFrames > mEntries[b].mWaitFrames;
+    } );
+
+    // the longest waiting light is always taken, so a budget below the cube face count still progresses
+    int remaining = mBudget;
+    bool taken = false;
+    for ( uint32_t index : local )
+    {
+        Entry &entry = mEntries[index];
+        int cost = ( entry.mHasInjected ? GetLightFaceCount( entry.mInjected.mType ) : 0 ) +
+            ( entry.mHasCurrent ? GetLightFaceCount( entry.mCurrent.mType ) : 0 );
+
+        if ( taken && cost > remaining )
+        {
+            entry.mWaitFrames++;
+            continue;
+        }
+
+        commit( index );
+        remaining -= cost;
+        taken = true;
+    }
+
+    // removals leave float rounding of the per voxel sums behind
+    if ( mDeltaUpdates >= mMaxDeltaUpdates )
+        mRebuild = true;
+
+    while ( !mEntries.empty( ) && !mEntries.back( ).mHasCurrent && !mEntries.back( ).mHasInjected )
+        mEntries.pop_back( );
+
+    return schedule;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LightManager::Invalidate( )
+{
+    mRebuild = true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t LightManager::GetLightCount( ) const
+{
+    return mEntries.size( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int LightManager::GetPendingCount( ) const
+{
+    int count = 0;
+    for ( const Entry &entry : mEntries )
+        count += IsDirty( entry ) ? 1 : 0;
+    return count;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LightManager::IsDirty( const Entry &entry ) const
+{
+    return entry.mHasCurrent != entry.mHasInjected || ( entry.mHasCurrent && entry.mCurrent != entry.mInjected );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
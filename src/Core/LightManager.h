@@ -0,0 +1,90 @@
+#ifndef __LIGHT_MANAGER_H
+#define __LIGHT_MANAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// must match defines in shadowMap.fx
+enum LightKind
+{
+    LIGHT_DIRECTIONAL = 0,
+    LIGHT_POINT = 1,
+    LIGHT_SPOT = 2,
+};
+
+// everything light injection depends on
+struct LightState
+{
+    LightKind mType = LIGHT_DIRECTIONAL;
+    float mPosition[3];
+    float mDirection[3]; // from light, directional and spot
+    float mColor[3];
+    float mRadius = 0.0f; // point and spot range
+    float mSpotAngle = 0.0f; // cone half angle in radians
+
+    bool operator==( const LightState &r ) const;
+    bool operator!=( const LightState &r ) const;
+};
+
+// one rsm render and photon injection of a light; removal injects the previously injected state with negative sign
+struct LightInjection
+{
+    uint32_t mLight = 0; // index in the synced light list
+    LightState mState;
+    float mSign = 1.0f;
+};
+
+struct LightSchedule
+{
+    bool mRebuild = false; // clear irradiance before injections
+    std::vector<LightInjection> mInjections;
+
+    int GetFaceCount( ) const;
+};
+
+// shadow map faces needed to inject a light: cube for point, single map otherwise
+int GetLightFaceCount( LightKind type );
+
+// row-major view and right handed perspective projection with clip z in [0, 1] of a point ( cube face ) or spot light
+void GetLightFaceMatrices( const LightState &light, int face, float view[16], float proj[16] );
+
+// tracks which lights differ from what irradiance bricks contain and spreads their reinjection over frames
+// directional lights can't be removed ( their rsm covers the scene and is redrawn in place ), so their change
+// rebuilds everything; local lights are updated by removing the old contribution and adding the new one
+class LightManager
+{
+public:
+    void SetBudget( int facesPerFrame ); // local light shadow faces per frame, directional lights are always processed
+    void SetMaxDeltaUpdates( int count ); // removals before a full rebuild clears accumulated float rounding
+
+    // lights are identified by their index, call every frame
+    void Sync( const std::vector<LightState> &lights );
+    // assumes returned injections are executed
+    LightSchedule Schedule( );
+    // irradiance was lost ( e.g. scene was revoxelized )
+    void Invalidate( );
+
+    size_t GetLightCount( ) const;
+    int GetPendingCount( ) const;
+
+private:
+    struct Entry
+    {
+        LightState mCurrent;
+        LightState mInjected;
+        bool mHasCurrent = false;
+        bool mHasInjected = false;
+        uint32_t mWaitFrames = 0; // dirty frames, starving lights go first
+    };
+
+    bool IsDirty( const Entry &entry ) const;
+
+    std::vector<Entry> mEntries;
+    int mBudget = 12;
+    int mMaxDeltaUpdates = 64;
+    int mDeltaUpdates = 0;
+    bool mRebuild = true;
+};
+
+#endif
@@ -0,0 +1,539 @@
+#include <Core/MeshOptimizer.h>
+#include <Core/ObjLoader.h>
+#include <Core/SceneStream.h>
+#include <GeometryGenerator.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <random>
+#include <tuple>
+
+namespace
+{
+    const float* GetPosition( const void *vertices, size_t stride, uint32_t index )
+    {
+        return reinterpret_cast< const float* >( static_cast< const uint8_t* >( vertices ) + stride * index );
+    }
+
+    // fifo cache by timestamps: vertex is cached if less than cacheSize misses happened since its own miss
+    struct FifoCache
+    {
+        std::vector<uint32_t> mTime;
+        uint32_t mNow;
+        uint32_t mSize;
+
+        FifoCache( size_t vertexCount, uint32_t size ) : mTime( vertexCount, 0 ), mNow( size + 1 ), mSize( size ) {}
+
+        // returns 1 on miss
+        uint32_t Access( uint32_t v )
+        {
+            if ( mNow - mTime[v] <= mSize )
+                return 0;
+            mTime[v] = mNow++;
+            return 1;
+        }
+
+        void Flush( )
+        {
+            mNow += mSize + 1;
+        }
+    };
+
+    // triangles around every vertex
+    struct TriangleAdjacency
+    {
+        std::vector<uint32_t> mOffsets; // vertexCount + 1
+        std::vector<uint32_t> mTriangles;
+
+        void Build( const uint32_t *indices, size_t indexCount, size_t vertexCount )
+        {
+            mOffsets.assign( vertexCount + 1, 0 );
+            for ( size_t i = 0; i < indexCount; i++ )
+                mOffsets[indices[i] + 1]++;
+            for ( size_t v = 0; v < vertexCount; v++ )
+                mOffsets[v + 1] += mOffsets[v];
+
+            std::vector<uint32_t> fill( mOffsets.begin( ), mOffsets.end( ) - 1 );
+            mTriangles.resize( indexCount );
+            for ( size_t i = 0; i < indexCount; i++ )
+                mTriangles[fill[indices[i]]++] = static_cast< uint32_t >( i / 3 );
+        }
+    };
+
+    // 6 axis views of a depth buffer over mesh bounds
+    const int kOverdrawResolution = 256;
+
+    void RasterizeTriangle( const float p[3][3], std::vector<float> &depth, size_t &shaded )
+    {
+        float area = ( p[1][0] - p[0][0] ) * ( p[2][1] - p[0][1] ) - ( p[1][1] - p[0][1] ) * ( p[2][0] - p[0][0] );
+        if ( area == 0.0f )
+            return;
+        float sign = area > 0.0f ? 1.0f : -1.0f;
+        float invArea = 1.0f / ( area * sign );
+
+        int minX = ( std::max )( 0, static_cast< int >( std::floor( ( std::min )( ( std::min )( p[0][0], p[1][0] ), p[2][0] ) ) ) );
+        int minY = ( std::max )( 0, static_cast< int >( std::floor( ( std::min )( ( std::min )( p[0][1], p[1][1] ), p[2][1] ) ) ) );
+        int maxX = ( std::min )( kOverdrawResolution - 1, static_cast< int >( std::ceil( ( std::max )( ( std::max )( p[0][0], p[1][0] ), p[2][0] ) ) ) );
+        int maxY = ( std::min )( kOverdrawResolution - 1, static_cast< int >( std::ceil( ( std::max )( ( std::max )( p[0][1], p[1][1] ), p[2][1] ) ) ) );
+
+        for ( int y = minY; y <= maxY; y++ )
+        {
+            for ( int x = minX; x <= maxX; x++ )
+            {
+                float px = x + 0.5f, py = y + 0.5f;
+                float w[3];
+                for ( int e = 0; e < 3; e++ )
+                {
+                    const float *a = p[( e + 1 ) % 3], *b = p[( e + 2 ) % 3];
+                    w[e] = ( ( b[0] - a[0] ) * ( py - a[1] ) - ( b[1] - a[1] ) * ( px - a[0] ) ) * sign;
+                }
+                if ( w[0] < 0.0f || w[1] < 0.0f || w[2] < 0.0f )
+                    continue;
+
+                float z = ( w[0] * p[0][2] + w[1] * p[1][2] + w[2] * p[2][2] ) * invArea;
+                float &stored = depth[y * kOverdrawResolution + x];
+                if ( z < stored )
+                {
+                    stored = z;
+                    shaded++;
+                }
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// nested spheres with shuffled triangles and vertices, the kind of order an exporter gives
+void GenerateShuffledSpheres( std::vector<GGVertex> &vertices, std::vector<uint32_t> &indices )
+{
+    GGMeshData outer, inner;
+    GeometryGenerator::GenerateGeoSphere( 2.0f, 4, outer );
+    GeometryGenerator::GenerateGeoSphere( 1.0f, 4, inner );
+
+    // subdivision splits shared edges, weld them back
+    vertices.clear( );
+    indices.clear( );
+    const GGMeshData *spheres[] = { &outer, &inner };
+    for ( auto sphere : spheres )
+    {
+        std::map<std::tuple<float, float, float>, uint32_t> welded;
+        for ( auto i : sphere->indicies )
+        {
+            const Vec3 &p = sphere->verticies[i].position;
+            auto found = welded.insert( std::make_pair( std::make_tuple( p.x, p.y, p.z ), static_cast< uint32_t >( vertices.size( ) ) ) );
+            if ( found.second )
+                vertices.push_back( sphere->verticies[i] );
+            indices.push_back( found.first->second );
+        }
+    }
+
+    std::mt19937 rng( 42 );
+    std::vector<uint32_t> order( indices.size( ) / 3 );
+    for ( size_t t = 0; t < order.size( ); t++ )
+        order[t] = static_cast< uint32_t >( t );
+    std::shuffle( order.begin( ), order.end( ), rng );
+
+    std::vector<uint32_t> remap( vertices.size( ) );
+    for ( size_t v = 0; v < remap.size( ); v++ )
+        remap[v] = static_cast< uint32_t >( v );
+    std::shuffle( remap.begin( ), remap.end( ), rng );
+
+    std::vector<uint32_t> shuffled( indices.size( ) );
+    for ( size_t t = 0; t < order.size( ); t++ )
+    {
+        for ( int k = 0; k < 3; k++ )
+            shuffled[t * 3 + k] = remap[indices[order[t] * 3 + k]];
+    }
+    indices.swap( shuffled );
+    RemapVertices( vertices, remap );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+double MeshCacheStats::GetACMR( ) const
+{
+    return mTriangles ? static_cast< double >( mTransforms ) / mTriangles : 0.0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+double MeshCacheStats::GetATVR( ) const
+{
+    return mVertices ? static_cast< double >( mTransforms ) / mVertices : 0.0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void MeshCacheStats::Add( const MeshCacheStats &stats )
+{
+    mTransforms += stats.mTransforms;
+    mTriangles += stats.mTriangles;
+    mVertices += stats.mVertices;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+MeshCacheStats AnalyzeVertexCache( const uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize )
+{
+    MeshCacheStats stats;
+    FifoCache cache( vertexCount, cacheSize );
+    std::vector<uint8_t> used( vertexCount, 0 );
+    for ( size_t i = 0; i < indexCount; i++ )
+    {
+        uint32_t v = indices[i];
+        stats.mTransforms += cache.Access( v );
+        stats.mVertices += used[v] ? 0 : 1;
+        used[v] = 1;
+    }
+    stats.mTriangles = indexCount / 3;
+    return stats;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+double AnalyzeOverdraw( const uint32_t *indices, size_t indexCount, const void *vertices, size_t stride, size_t vertexCount )
+{
+    if ( indexCount < 3 || vertexCount == 0 )
+        return 0.0;
+
+    float minP[3] = { 1e30f, 1e30f, 1e30f }, maxP[3] = { -1e30f, -1e30f, -1e30f };
+    for ( size_t v = 0; v < vertexCount; v++ )
+    {
+        const float *p = GetPosition( vertices, stride, static_cast< uint32_t >( v ) );
+        for ( int a = 0; a < 3; a++ )
+        {
+            minP[a] = ( std::min )( minP[a], p[a] );
+            maxP[a] = ( std::max )( maxP[a], p[a] );
+        }
+    }
+
+    size_t shaded = 0, covered = 0;
+    std::vector<float> depth( kOverdrawResolution * kOverdrawResolution );
+    for ( int view = 0; view < 6; view++ )
+    {
+        int axis = view / 2, u = ( axis + 1 ) % 3, w = ( axis + 2 ) % 3;
+        float side = view % 2 ? -1.0f : 1.0f;
+        float scaleU = kOverdrawResolution / ( std::max )( maxP[u] - minP[u], 1e-6f );
+        float scaleW = kOverdrawResolution / ( std::max )( maxP[w] - minP[w], 1e-6f );
+        std::fill( depth.begin( ), depth.end( ), 1e30f );
+
+        for ( size_t i = 0; i + 2 < indexCount; i += 3 )
+        {
+            float p[3][3];
+            for ( int k = 0; k < 3; k++ )
+            {
+                const float *pos = GetPosition( vertices, stride, indices[i + k] );
+                p[k][0] = ( pos[u] - minP[u] ) * scaleU;
+                p[k][1] = ( pos[w] - minP[w] ) * scaleW;
+                p[k][2] = pos[axis] * side;
+            }
+            RasterizeTriangle( p, depth, shaded );
+        }
+
+        for ( auto d : depth )
+            covered += d < 1e30f ? 1 : 0;
+    }
+    return covered ? static_cast< double >( shaded ) / covered : 0.0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void OptimizeVertexCache( uint32_t *destination, const uint32_t *indices, size_t indexCount, size_t vertexCount,
+    uint32_t cacheSize, std::vector<uint32_t> *clusters )
+{
+    size_t triangleCount = indexCount / 3;
+    if ( clusters )
+        clusters->clear( );
+    if ( triangleCount == 0 )
+        return;
+
+    TriangleAdjacency adjacency;
+    adjacency.Build( indices, triangleCount * 3, vertexCount );
+
+    std::vector<uint32_t> live( vertexCount );
+    for ( size_t v = 0; v < vertexCount; v++ )
+        live[v] = adjacency.mOffsets[v + 1] - adjacency.mOffsets[v];
+
+    std::vector<uint32_t> cacheTime( vertexCount, 0 );
+    uint32_t now = cacheSize + 1;
+    std::vector<uint8_t> emitted( triangleCount, 0 );
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    size_t cursor = 0, outputTriangles = 0;
+
+    // vertex from the dead end stack, then the next live one in input order
+    auto skipDeadEnd = [&]( ) -> int64_t
+    {
+        while ( !deadEnd.empty( ) )
+        {
+            uint32_t d = deadEnd.back( );
+            deadEnd.pop_back( );
+            if ( live[d] > 0 )
+                return d;
+        }
+        while ( cursor < vertexCount )
+        {
+            if ( live[cursor] > 0 )
+                return static_cast< int64_t >( cursor );
+            cursor++;
+        }
+        return -1;
+    };
+
+    int64_t fan = skipDeadEnd( );
+    if ( clusters )
+        clusters->push_back( 0 );
+    while ( fan >= 0 )
+    {
+        // emit all triangles around the fanning vertex
+        candidates.clear( );
+        for ( uint32_t a = adjacency.mOffsets[fan]; a < adjacency.mOffsets[fan + 1]; a++ )
+        {
+            uint32_t t = adjacency.mTriangles[a];
+            if ( emitted[t] )
+                continue;
+
+            emitted[t] = 1;
+            for ( int k = 0; k < 3; k++ )
+            {
+                uint32_t v = indices[t * 3 + k];
+                destination[outputTriangles * 3 + k] = v;
+                deadEnd.push_back( v );
+                candidates.push_back( v );
+                live[v]--;
+                if ( now - cacheTime[v] > cacheSize )
+                    cacheTime[v] = now++;
+            }
+            outputTriangles++;
+        }
+
+        // oldest candidate that stays in cache while its triangles are fanned
+        int64_t next = -1, bestPriority = -1;
+        for ( auto v : candidates )
+        {
+            if ( live[v] == 0 )
+                continue;
+
+            int64_t priority = 0;
+            if ( now - cacheTime[v] + 2 * live[v] <= cacheSize )
+                priority = now - cacheTime[v];
+            if ( priority > bestPriority )
+            {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        if ( next < 0 )
+        {
+            next = skipDeadEnd( );
+            if ( next >= 0 && clusters && clusters->back( ) != outputTriangles )
+                clusters->push_back( static_cast< uint32_t >( outputTriangles ) );
+        }
+        fan = next;
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void OptimizeOverdraw( uint32_t *destination, const uint32_t *indices, size_t indexCount, const void *vertices, size_t stride,
+    size_t vertexCount, const std::vector<uint32_t> &hardClusters, uint32_t cacheSize, float threshold )
+{
+    size_t triangleCount = indexCount / 3;
+    if ( triangleCount == 0 )
+        return;
+
+    auto triangleMisses = [&]( FifoCache &cache, size_t t ) -> uint32_t
+    {
+        return cache.Access( indices[t * 3] ) + cache.Access( indices[t * 3 + 1] ) + cache.Access( indices[t * 3 + 2] );
+    };
+
+    // split hard clusters where acmr so far is already close to the whole cluster one
+    std::vector<uint32_t> clusters;
+    FifoCache cache( vertexCount, cacheSize );
+    for ( size_t h = 0; h < ( std::max )( hardClusters.size( ), size_t( 1 ) ); h++ )
+    {
+        size_t start = hardClusters.empty( ) ? 0 : hardClusters[h];
+        size_t end = h + 1 < hardClusters.size( ) ? hardClusters[h + 1] : triangleCount;
+
+        cache.Flush( );
+        size_t misses = 0;
+        for ( size_t t = start; t < end; t++ )
+            misses += triangleMisses( cache, t );
+        double clusterThreshold = threshold * static_cast< double >( misses ) / ( end - start );
+
+        cache.Flush( );
+        misses = 0;
+        size_t clusterStart = start;
+        clusters.push_back( static_cast< uint32_t >( start ) );
+        for ( size_t t = start; t < end; t++ )
+        {
+            misses += triangleMisses( cache, t );
+            if ( t + 1 < end && static_cast< double >( misses ) / ( t - clusterStart + 1 ) <= clusterThreshold )
+            {
+                clusters.push_back( static_cast< uint32_t >( t + 1 ) );
+                clusterStart = t + 1;
+                misses = 0;
+                cache.Flush( );
+            }
+        }
+    }
+
+    // clusters facing away from the mesh center and far from it go first, they occlude the inner ones
+    double meshCenter[3] = { 0.0, 0.0, 0.0 }, meshArea = 0.0;
+    std::vector<double> clusterCenter( clusters.size( ) * 3, 0.0 ), clusterNormal( clusters.size( ) * 3, 0.0 ), clusterArea( clusters.size( ), 0.0 );
+    for ( size_t c = 0; c < clusters.size( ); c++ )
+    {
+        size_t end = c + 1 < clusters.size( ) ? clusters[c + 1] : triangleCount;
+        for ( size_t t = clusters[c]; t < end; t++ )
+        {
+            const float *p0 = GetPosition( vertices, stride, indices[t * 3] );
+            const float *p1 = GetPosition( vertices, stride, indices[t * 3 + 1] );
+            const float *p2 = GetPosition( vertices, stride, indices[t * 3 + 2] );
+            double e1[3], e2[3], n[3];
+            for ( int a = 0; a < 3; a++ )
+            {
+                e1[a] = p1[a] - p0[a];
+                e2[a] = p2[a] - p0[a];
+            }
+            n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+            n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+            n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+            double area = std::sqrt( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+
+            for ( int a = 0; a < 3; a++ )
+            {
+                double center = ( p0[a] + p1[a] + p2[a] ) / 3.0;
+                clusterCenter[c * 3 + a] += center * area;
+                clusterNormal[c * 3 + a] += n[a];
+                meshCenter[a] += center * area;
+            }
+            clusterArea[c] += area;
+            meshArea += area;
+        }
+    }
+    for ( int a = 0; a < 3; a++ )
+        meshCenter[a] /= meshArea > 0.0 ? meshArea : 1.0;
+
+    std::vector<std::pair<double, uint32_t> > order( clusters.size( ) );
+    for ( size_t c = 0; c < clusters.size( ); c++ )
+    {
+        double dotCN = 0.0, lengthN = 0.0;
+        for ( int a = 0; a < 3; a++ )
+        {
+            double center = clusterArea[c] > 0.0 ? clusterCenter[c * 3 + a] / clusterArea[c] : meshCenter[a];
+            dotCN += ( center - meshCenter[a] ) * clusterNormal[c * 3 + a];
+            lengthN += clusterNormal[c * 3 + a] * clusterNormal[c * 3 + a];
+        }
+        order[c] = std::make_pair( lengthN > 0.0 ? -dotCN / std::sqrt( lengthN ) : 0.0, static_cast< uint32_t >( c ) );
+    }
+    std::stable_sort( order.begin( ), order.end( ) );
+
+    size_t written = 0;
+    for ( auto &o : order )
+    {
+        size_t c = o.second;
+        size_t end = c + 1 < clusters.size( ) ? clusters[c + 1] : triangleCount;
+        for ( size_t i = clusters[c] * 3; i < end * 3; i++ )
+            destination[written++] = indices[i];
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void OptimizeVertexFetch( uint32_t *indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t> &remap )
+{
+    const uint32_t unused = ~0u;
+    remap.assign( vertexCount, unused );
+
+    uint32_t next = 0;
+    for ( size_t i = 0; i < indexCount; i++ )
+    {
+        uint32_t &r = remap[indices[i]];
+        if ( r == unused )
+            r = next++;
+        indices[i] = r;
+    }
+
+    for ( auto &r : remap )
+    {
+        if ( r == unused )
+            r = next++;
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+MeshOptimizeResult OptimizeMesh( std::vector<uint32_t> &indices, const void *vertices, size_t stride, size_t vertexCount,
+    std::vector<uint32_t> &remap )
+{
+    MeshOptimizeResult result;
+    indices.resize( indices.size( ) / 3 * 3 );
+    result.mBefore = AnalyzeVertexCache( indices.data( ), indices.size( ), vertexCount );
+
+    std::vector<uint32_t> cacheOrder( indices.size( ) ), clusters;
+    OptimizeVertexCache( cacheOrder.data( ), indices.data( ), indices.size( ), vertexCount, MESH_CACHE_SIZE, &clusters );
+    OptimizeOverdraw( indices.data( ), cacheOrder.data( ), cacheOrder.size( ), vertices, stride, vertexCount, clusters );
+    OptimizeVertexFetch( indices.data( ), indices.size( ), vertexCount, remap );
+
+    result.mAfter = AnalyzeVertexCache( indices.data( ), indices.size( ), vertexCount );
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+MeshOptimizerBenchmarkResult RunMeshOptimizerBenchmark( const char *sceneFn )
+{
+    typedef std::chrono::steady_clock Clock;
+    MeshOptimizerBenchmarkResult result;
+    size_t biggest = 0;
+
+    // stats of one mesh, overdraw only for the biggest one; true if mesh is the biggest so far
+    auto measure = [&]( std::vector<uint32_t> &indices, const void *vertices, size_t stride, size_t vertexCount, std::vector<uint32_t> &remap )
+    {
+        bool isBiggest = indices.size( ) / 3 > biggest;
+        if ( isBiggest )
+        {
+            biggest = indices.size( ) / 3;
+            result.mOverdrawBefore = AnalyzeOverdraw( indices.data( ), indices.size( ), vertices, stride, vertexCount );
+        }
+
+        Clock::time_point start = Clock::now( );
+        MeshOptimizeResult stats = OptimizeMesh( indices, vertices, stride, vertexCount, remap );
+        result.mOptimizeMs += std::chrono::duration<double, std::milli>( Clock::now( ) - start ).count( );
+        result.mStats.mBefore.Add( stats.mBefore );
+        result.mStats.mAfter.Add( stats.mAfter );
+        result.mObjects++;
+        return isBiggest;
+    };
+
+    std::string fn = sceneFn ? sceneFn : "";
+    SceneBinReader reader;
+    std::string error;
+    std::vector<uint32_t> remap;
+    if ( !fn.empty( ) && reader.Open( fn.c_str( ), error ) )
+    {
+        SceneBinObject object;
+        while ( reader.ReadObject( object, error ) )
+        {
+            if ( measure( object.mIndices, object.mVertices.data( ), sizeof( SceneVertex ), object.mVertices.size( ), remap ) )
+            {
+                RemapVertices( object.mVertices, remap );
+                result.mOverdrawAfter = AnalyzeOverdraw( object.mIndices.data( ), object.mIndices.size( ), object.mVertices.data( ),
+                    sizeof( SceneVertex ), object.mVertices.size( ) );
+            }
+        }
+        result.mSource = fn;
+        if ( error.empty( ) )
+            return result;
+        result = MeshOptimizerBenchmarkResult( );
+        biggest = 0;
+    }
+
+    ObjCallbacks callbacks;
+    callbacks.mOnMesh = [&]( ObjMesh &mesh )
+    {
+        GGMeshData &data = mesh.mData;
+        if ( measure( data.indicies, data.verticies.data( ), sizeof( GGVertex ), data.verticies.size( ), remap ) )
+        {
+            RemapVertices( data.verticies, remap );
+            result.mOverdrawAfter = AnalyzeOverdraw( data.indicies.data( ), data.indicies.size( ), data.verticies.data( ),
+                sizeof( GGVertex ), data.verticies.size( ) );
+        }
+    };
+    if ( fn.size( ) > 4 && fn.compare( fn.size( ) - 4, 4, ".obj" ) == 0 && LoadObj( fn.c_str( ), callbacks ) && result.mObjects > 0 )
+    {
+        result.mSource = fn;
+        return result;
+    }
+
+    result = MeshOptimizerBenchmarkResult( );
+    biggest = 0;
+    ObjMesh spheres;
+    GenerateShuffledSpheres( spheres.mData.verticies, spheres.mData.indicies );
+    callbacks.mOnMesh( spheres );
+    result.mSource = "synthetic";
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,94 @@
+#ifndef __MESH_OPTIMIZER_H
+#define __MESH_OPTIMIZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct GGVertex;
+
+// fifo post transform cache of the simulation, close to what current gpus keep for the g-buffer and shadow vertex shaders
+#define MESH_CACHE_SIZE 16
+// overdraw pass may cost this much of the vertex cache efficiency
+#define MESH_OVERDRAW_THRESHOLD 1.05f
+
+// vertex shader invocations of an index buffer against a fifo cache, summable over meshes
+struct MeshCacheStats
+{
+    size_t mTransforms = 0; // cache misses
+    size_t mTriangles = 0;
+    size_t mVertices = 0; // referenced vertices
+
+    double GetACMR( ) const; // average cache miss ratio, transforms per triangle, 0.5 is the ideal of a big grid
+    double GetATVR( ) const; // average transform to vertex ratio, 1 is ideal
+    void Add( const MeshCacheStats &stats );
+};
+
+struct MeshOptimizeResult
+{
+    MeshCacheStats mBefore;
+    MeshCacheStats mAfter;
+};
+
+MeshCacheStats AnalyzeVertexCache( const uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = MESH_CACHE_SIZE );
+
+// share of shaded pixels over covered ones with early depth test in index order, averaged over 6 axis views
+// positions are 3 floats at the start of every stride bytes
+double AnalyzeOverdraw( const uint32_t *indices, size_t indexCount, const void *vertices, size_t stride, size_t vertexCount );
+
+// tipsify (Sander et al. 2007), clusters get first triangle of every part that starts after a dead end
+void OptimizeVertexCache( uint32_t *destination, const uint32_t *indices, size_t indexCount, size_t vertexCount,
+    uint32_t cacheSize = MESH_CACHE_SIZE, std::vector<uint32_t> *clusters = nullptr );
+
+// splits cache optimized triangles into clusters that keep acmr within threshold and sorts them outside in
+// hardClusters is the output of OptimizeVertexCache
+void OptimizeOverdraw( uint32_t *destination, const uint32_t *indices, size_t indexCount, const void *vertices, size_t stride,
+    size_t vertexCount, const std::vector<uint32_t> &hardClusters, uint32_t cacheSize = MESH_CACHE_SIZE,
+    float threshold = MESH_OVERDRAW_THRESHOLD );
+
+// new place of every vertex in the order of first use, unused vertices go last; indices are rewritten
+void OptimizeVertexFetch( uint32_t *indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t> &remap );
+
+// all three passes; indices are rewritten, vertices have to be moved with remap
+MeshOptimizeResult OptimizeMesh( std::vector<uint32_t> &indices, const void *vertices, size_t stride, size_t vertexCount,
+    std::vector<uint32_t> &remap );
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void RemapVertices( std::vector<T> &vertices, const std::vector<uint32_t> &remap )
+{
+    std::vector<T> result( vertices.size( ) );
+    for ( size_t i = 0; i < vertices.size( ); i++ )
+        result[remap[i]] = vertices[i];
+    vertices.swap( result );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// T starts with float3 position
+template< typename T >
+MeshOptimizeResult OptimizeMesh( std::vector<T> &vertices, std::vector<uint32_t> &indices )
+{
+    std::vector<uint32_t> remap;
+    MeshOptimizeResult result = OptimizeMesh( indices, vertices.data( ), sizeof( T ), vertices.size( ), remap );
+    RemapVertices( vertices, remap );
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// nested geo spheres with shuffled triangles and vertices, the kind of order an exporter gives
+void GenerateShuffledSpheres( std::vector<GGVertex> &vertices, std::vector<uint32_t> &indices );
+
+struct MeshOptimizerBenchmarkResult
+{
+    std::string mSource; // scene file or "synthetic"
+    size_t mObjects = 0;
+    MeshOptimizeResult mStats;
+    double mOverdrawBefore = 0.0; // of the biggest object
+    double mOverdrawAfter = 0.0;
+    double mOptimizeMs = 0.0; // all objects
+};
+
+// every object of a scene bin or obj goes through OptimizeMesh; nested shuffled spheres when the file can't be read
+MeshOptimizerBenchmarkResult RunMeshOptimizerBenchmark( const char *sceneFn );
+
+#endif
@@ -0,0 +1,391 @@
+#include <Core/ObjLoader.h>
+#include <Core/MeshOptimizer.h>
+#include <Core/TaskScheduler.h>
+#include <GlobalUtils.h>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string.h>
+#include <unordered_map>
+
+namespace
+{
+    // attributes of one mesh copied out of the file arrays, so the mesh can be built while they grow
+    struct ObjMeshJob
+    {
+        std::vector<Vec3> mPositions;
+        std::vector<Vec3> mNormals;
+        std::vector<Vec3> mUVW;
+        std::vector<ObjFace> mFaces;
+        ObjMesh mMesh;
+    };
+
+    // copies the index range used by faces of every attribute and rebases faces to it, faces are taken
+    // objects of an obj file are usually contiguous, so ranges are close to the used attributes
+    void GatherObjMesh( const std::vector<Vec3> &positions, const std::vector<Vec3> &normals, const std::vector<Vec3> &uvw,
+        std::vector<ObjFace> &faces, ObjMeshJob &job )
+    {
+        // face order: position, texture, normal
+        const std::vector<Vec3> *sources[3] = { &positions, &uvw, &normals };
+        std::vector<Vec3> *targets[3] = { &job.mPositions, &job.mUVW, &job.mNormals };
+        int low[3] = { INT_MAX, INT_MAX, INT_MAX }, high[3] = { -1, -1, -1 };
+        for ( auto &f : faces )
+        {
+            for ( int i = 0; i < 3; i++ )
+            {
+                for ( int k = 0; k < 3; k++ )
+                {
+                    low[k] = ( std::min )( low[k], f[i * 3 + k] );
+                    high[k] = ( std::max )( high[k], f[i * 3 + k] );
+                }
+            }
+        }
+
+        for ( int k = 0; k < 3; k++ )
+        {
+            int size = static_cast< int >( sources[k]->size( ) );
+            ASSERT( low[k] >= 0 && high[k] < size, "face index out of range" );
+            if ( low[k] < 0 || high[k] >= size )
+            {
+                low[k] = 0;
+                high[k] = size - 1;
+            }
+            targets[k]->assign( sources[k]->begin( ) + low[k], sources[k]->begin( ) + high[k] + 1 );
+        }
+
+        job.mFaces.swap( faces );
+        faces.clear( );
+        for ( auto &f : job.mFaces )
+        {
+            for ( int i = 0; i < 3; i++ )
+            {
+                for ( int k = 0; k < 3; k++ )
+                    f[i * 3 + k] -= low[k];
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BuildObjMesh( const std::vector<Vec3> &positions, const std::vector<Vec3> &normals, const std::vector<Vec3> &uvw,
+    const std::vector<ObjFace> &faces, GGMeshData &data )
+{
+    if ( faces.size( ) == 0 || positions.size( ) == 0 || normals.size( ) == 0 || uvw.size( ) == 0 )
+        return false;
+
+    data.verticies.clear( );
+    data.indicies.clear( );
+
+    const size_t lengthLimit = 1 << 21;
+    ASSERT( positions.size( ) < lengthLimit && normals.size( ) < lengthLimit && uvw.size( ) < lengthLimit );
+
+    // build layout, prevent duplicates
+    std::vector<std::vector<std::pair<int, int> > > vertexCoherence;
+    std::unordered_map<int64_t, int> indiciesHash;
+    int maxIndex = 0;
+    for ( auto &f : faces )
+    {
+        int iv[3];
+        for ( int i = 0; i < 3; i++ )
+        {
+            int vp = f[0 + i * 3], vt = f[1 + i * 3], vn = f[2 + i * 3];
+            int64_t key = ( int64_t )vp + ( ( ( int64_t )vt ) << 21 ) + ( ( ( int64_t )vn ) << 42 );
+            auto keyValue = indiciesHash.find( key );
+            if ( keyValue != indiciesHash.end( ) )
+            {
+                data.indicies.push_back( keyValue->second );
+            }
+            else
+            {
+                // push new vertex
+                GGVertex v;
+                v.position = positions[vp];
+                v.UVW = uvw[vt];
+                v.normal = normals[vn];
+                data.verticies.push_back( v );
+                indiciesHash.insert( std::make_pair( key, maxIndex ) );
+                data.indicies.push_back( maxIndex++ );
+                vertexCoherence.push_back( std::vector<std::pair<int, int> >( ) );
+            }
+            iv[i] = data.indicies.back( );
+        }
+        vertexCoherence[iv[0]].push_back( std::make_pair( iv[1], iv[2] ) );
+        vertexCoherence[iv[1]].push_back( std::make_pair( iv[0], iv[2] ) );
+        vertexCoherence[iv[2]].push_back( std::make_pair( iv[0], iv[1] ) );
+    }
+    GeometryGenerator::CalculateTBN( data, vertexCoherence );
+
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// simple obj reader
+// read obj file
+//  read mtllib X - report X lib
+//  read object X - X is a name of object (can be null)
+//      read geometry data till the next object
+//          usemtl - store material
+//
+//      before parsing next object - report current data as a mesh
+//  if there is no objects - end
+bool ParseObj( std::istream &in, const std::string &basePath, const ObjCallbacks &callbacks )
+{
+    std::vector<Vec3> positions;
+    std::vector<Vec3> normals;
+    std::vector<Vec3> uvw;
+    std::vector<ObjFace> faceInfo;
+
+    char tmp;
+    std::string line;
+    ObjMesh mesh;
+    std::string objName = "";
+    bool firstObj = true;
+    int subObjCount = 0;
+    std::string suffix = "0";
+
+    // meshes are built on workers and reported in file order, a few at a time
+    std::unique_ptr<TaskPipeline<ObjMeshJob>> pipeline;
+    if ( callbacks.mScheduler )
+    {
+        pipeline.reset( new TaskPipeline<ObjMeshJob>( *callbacks.mScheduler, callbacks.mScheduler->GetThreadCount( ) * 2, nullptr,
+            [&]( ObjMeshJob &job )
+            {
+                BuildObjMesh( job.mPositions, job.mNormals, job.mUVW, job.mFaces, job.mMesh.mData );
+                if ( callbacks.mProcessMesh )
+                    callbacks.mProcessMesh( job.mMesh );
+            },
+            [&]( ObjMeshJob &job )
+            {
+                if ( callbacks.mOnMesh )
+                    callbacks.mOnMesh( job.mMesh );
+            } ) );
+    }
+
+    auto reportMesh = [&]( ) -> bool
+    {
+        // checks of BuildObjMesh, the result is needed before the mesh is built
+        if ( faceInfo.empty( ) || positions.empty( ) || normals.empty( ) || uvw.empty( ) )
+            return false;
+
+        if ( pipeline )
+        {
+            std::unique_ptr<ObjMeshJob> job = pipeline->Acquire( );
+            job->mMesh.mName = objName + suffix;
+            job->mMesh.mMaterial = mesh.mMaterial;
+            GatherObjMesh( positions, normals, uvw, faceInfo, *job );
+            pipeline->Push( std::move( job ) );
+            return true;
+        }
+
+        BuildObjMesh( positions, normals, uvw, faceInfo, mesh.mData );
+        mesh.mName = objName + suffix;
+        if ( callbacks.mProcessMesh )
+            callbacks.mProcessMesh( mesh );
+        if ( callbacks.mOnMesh )
+            callbacks.mOnMesh( mesh );
+        faceInfo.clear( );
+        return true;
+    };
+
+    while ( std::getline( in, line ) )
+    {
+        std::istringstream iss( line.c_str( ) );
+
+        // new name is an indicator of the next object (the lack of name is possible)
+        size_t objfound = line.find( "object" );
+        if ( objfound != std::string::npos )
+        {
+            if ( !firstObj && reportMesh( ) )
+            {
+                subObjCount = 0;
+                suffix = "0";
+            }
+            else
+            {
+                firstObj = false;
+            }
+
+            // start new object
+            size_t cutlen = objfound + strlen( "object " );
+            if ( line.length( ) > cutlen )
+                objName = line.substr( cutlen );
+            else
+                objName = "";
+
+            mesh.mMaterial.clear( );
+        }
+        else if ( !line.compare( 0, 6, "mtllib" ) )
+        {
+            // material lib path is relative to obj file
+            if ( callbacks.mOnMaterialLib && line.length( ) > strlen( "mtllib " ) )
+                callbacks.mOnMaterialLib( basePath + line.substr( strlen( "mtllib " ) ) );
+        }
+        else if ( !line.compare( 0, 7, "usemtl " ) )
+        {
+            if ( faceInfo.size( ) != 0 )
+            {
+                reportMesh( );
+                suffix = std::to_string( subObjCount++ );
+            }
+
+            mesh.mMaterial = line.substr( strlen( "usemtl " ) );
+        }
+        else if ( !line.compare( 0, 2, "v " ) )
+        {
+            iss >> tmp;
+            float v[3];
+            for ( int i = 0; i < 3; i++ )
+                iss >> v[i];
+
+            positions.push_back( Vec3( v[0], v[1], v[2] ) );
+        }
+        else if ( !line.compare( 0, 3, "vt " ) )
+        {
+            iss >> tmp >> tmp;
+            float vt[3];
+            for ( int i = 0; i < 3; i++ )
+                iss >> vt[i];
+
+            uvw.push_back( Vec3( vt[0], 1.0f - vt[1], vt[2] ) ); // v coordinate is inverted
+        }
+        else if ( !line.compare( 0, 3, "vn " ) )
+        {
+            iss >> tmp >> tmp;
+            float vn[3];
+            for ( int i = 0; i < 3; i++ )
+                iss >> vn[i];
+
+            normals.push_back( Vec3( vn[0], vn[1], vn[2] ) );
+        }
+        else if ( !line.compare( 0, 2, "f " ) )
+        {
+            std::vector<std::array<int, 3> > vertices; // position, texture, normal
+            int idv, idn, idt;
+            iss >> tmp;
+            while ( iss >> idv >> tmp >> idt >> tmp >> idn )
+            {
+                std::array<int, 3> vertex = { { idv - 1, idt - 1, idn - 1 } };
+                vertices.push_back( vertex );
+            }
+            ASSERT( vertices.size( ) >= 3 );
+            if ( vertices.size( ) < 3 )
+                break;
+
+            for ( size_t i = 2; i < vertices.size( ); i++ )
+            {
+                // assume more than 3 verticies connected to first vertex
+                ObjFace face;
+                for ( size_t j = 0; j < 3; j++ )
+                    face[j] = vertices[0][j];
+
+                for ( size_t j = i - 1; j <= i; j++ )
+                {
+                    for ( int k = 0; k < 3; k++ )
+                        face[( 2 - ( i - j ) ) * 3 + k] = vertices[j][k];
+                }
+
+                faceInfo.push_back( face );
+            }
+        }
+    }
+
+    reportMesh( );
+    if ( pipeline )
+        pipeline->Flush( );
+
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LoadObj( const char *fn, const ObjCallbacks &callbacks )
+{
+    std::ifstream objFile( fn );
+    if ( objFile.fail( ) )
+        return false;
+
+    std::string path, tmpstr;
+    SplitFilename( std::string( fn ), path, tmpstr );
+
+    return ParseObj( objFile, path, callbacks );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ObjImportBenchmarkResult RunObjImportBenchmark( const char *fn, size_t maxThreads )
+{
+    typedef std::chrono::steady_clock Clock;
+    if ( maxThreads == 0 )
+        maxThreads = TaskScheduler::GetDefaultWorkerCount( ) + 1;
+
+    // whole file in memory, so disk doesn't take part in the scaling
+    ObjImportBenchmarkResult result;
+    std::string text;
+    std::ifstream file( fn ? fn : "", std::ios::binary );
+    if ( fn && file )
+    {
+        std::ostringstream content;
+        content << file.rdbuf( );
+        text = content.str( );
+        result.mSource = fn;
+    }
+    else
+    {
+        // objects of tessellated planes, each with its own attributes like exported scenes
+        std::ostringstream obj;
+        GGMeshData plane;
+        GeometryGenerator::GeneratePlane( 100.0f, 100.0f, 64, 64, plane );
+        size_t base = 0;
+        for ( int o = 0; o < 48; o++ )
+        {
+            obj << "# object plane" << o << "\nusemtl material" << o % 4 << "\n";
+            for ( auto &v : plane.verticies )
+                obj << "v " << v.position.x + o * 100.0f << " " << v.position.y << " " << v.position.z << "\n";
+            for ( auto &v : plane.verticies )
+                obj << "vt " << v.UVW.x << " " << 1.0f - v.UVW.y << " 0\n";
+            for ( auto &v : plane.verticies )
+                obj << "vn " << v.normal.x << " " << v.normal.y << " " << v.normal.z << "\n";
+            for ( size_t i = 0; i + 2 < plane.indicies.size( ); i += 3 )
+            {
+                obj << "f";
+                for ( int j = 0; j < 3; j++ )
+                {
+                    size_t index = base + plane.indicies[i + j] + 1;
+                    obj << " " << index << "/" << index << "/" << index;
+                }
+                obj << "\n";
+            }
+            base += plane.verticies.size( );
+        }
+        text = obj.str( );
+        result.mSource = "synthetic";
+    }
+
+    for ( size_t threads = 1;; threads *= 2 )
+    {
+        size_t count = ( std::min )( threads, maxThreads );
+        TaskScheduler scheduler( count - 1 );
+
+        // same work as scene import: parse, dedup, tangent frame and mesh optimization
+        size_t meshes = 0, triangles = 0;
+        ObjCallbacks callbacks;
+        callbacks.mScheduler = &scheduler;
+        callbacks.mProcessMesh = []( ObjMesh &mesh ) { OptimizeMesh( mesh.mData.verticies, mesh.mData.indicies ); };
+        callbacks.mOnMesh = [&]( ObjMesh &mesh )
+        {
+            meshes++;
+            triangles += mesh.mData.indicies.size( ) / 3;
+        };
+
+        std::istringstream in( text );
+        Clock::time_point start = Clock::now( );
+        ParseObj( in, "", callbacks );
+        result.mThreads.push_back( count );
+        result.mImportMs.push_back( std::chrono::duration<double, std::milli>( Clock::now( ) - start ).count( ) );
+        result.mMeshes = meshes;
+        result.mTriangles = triangles;
+
+        if ( threads >= maxThreads )
+            break;
+    }
+
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,57 @@
+#ifndef __OBJ_LOADER_H
+#define __OBJ_LOADER_H
+
+#include <array>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+#include <GeometryGenerator.h>
+
+class TaskScheduler;
+
+// object of an obj file, parts with different materials are separate meshes
+struct ObjMesh
+{
+    std::string mName; // object name with material part suffix
+    std::string mMaterial; // empty for default material
+    GGMeshData mData;
+};
+
+// meshes are reported as soon as they are complete, material libs before meshes that use them
+struct ObjCallbacks
+{
+    std::function<void( const std::string &fn )> mOnMaterialLib; // path is relative to working directory
+    std::function<void( ObjMesh &mesh )> mOnMesh; // mesh may be changed, it isn't used after the call
+    std::function<void( ObjMesh &mesh )> mProcessMesh; // before mOnMesh, on workers with a scheduler, so it has to be thread safe
+
+    // meshes are built on its workers while parsing goes on, mOnMesh still comes in file order on the parsing thread
+    TaskScheduler *mScheduler = nullptr;
+};
+
+// obj face: position, texture, normal index for each of 3 vertices
+typedef std::array<int, 9> ObjFace;
+
+// indexed mesh without duplicate vertices and with tangent frame; false if anything is empty
+bool BuildObjMesh( const std::vector<Vec3> &positions, const std::vector<Vec3> &normals, const std::vector<Vec3> &uvw,
+    const std::vector<ObjFace> &faces, GGMeshData &data );
+
+// basePath is prepended to material lib names
+// with a scheduler, up to two meshes per thread are in memory besides the attribute arrays of the file
+bool ParseObj( std::istream &in, const std::string &basePath, const ObjCallbacks &callbacks );
+bool LoadObj( const char *fn, const ObjCallbacks &callbacks );
+
+struct ObjImportBenchmarkResult
+{
+    std::string mSource; // obj file or "synthetic"
+    size_t mMeshes = 0;
+    size_t mTriangles = 0;
+    std::vector<size_t> mThreads;
+    std::vector<double> mImportMs; // parse, build and optimize of the whole file per thread count
+};
+
+// imports an obj from memory like the scene does on 1..maxThreads threads (0 - hardware concurrency)
+// generated planes if fn can't be read
+ObjImportBenchmarkResult RunObjImportBenchmark( const char *fn, size_t maxThreads );
+
+#endif
@@ -0,0 +1,86 @@
+#include <Core/OctreeLayout.h>
+
+namespace
+{
+    const uint32_t kPositionMask = ( 1u << OCTREE_POSITION_BITS ) - 1;
+
+    uint32_t PackUnorm8( float value )
+    {
+        float c = value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+        return static_cast< uint32_t >( c * 255.0f );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t PackOctreePosition( uint32_t x, uint32_t y, uint32_t z )
+{
+    return ( x & kPositionMask ) | ( ( y & kPositionMask ) << OCTREE_POSITION_BITS ) | ( ( z & kPositionMask ) << ( 2 * OCTREE_POSITION_BITS ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UnpackOctreePosition( uint32_t packed, uint32_t &x, uint32_t &y, uint32_t &z )
+{
+    x = packed & kPositionMask;
+    y = ( packed >> OCTREE_POSITION_BITS ) & kPositionMask;
+    z = ( packed >> ( 2 * OCTREE_POSITION_BITS ) ) & kPositionMask;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t PackColor( float r, float g, float b, float a )
+{
+    return PackUnorm8( r ) | ( PackUnorm8( g ) << 8 ) | ( PackUnorm8( b ) << 16 ) | ( PackUnorm8( a ) << 24 );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t GetChildSlot( uint32_t x, uint32_t y, uint32_t z )
+{
+    return ONS_CHILDREN + ( x & 1 ) + ( ( y & 1 ) << 1 ) + ( ( z & 1 ) << 2 );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t GetNeighborSlot( int axis, bool positive )
+{
+    // NeighborMaskToOffset + 7
+    return ONS_NEIGHBORS + axis * 2 + ( positive ? 1 : 0 );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t NodeIDToIndex( uint32_t nodeID )
+{
+    return nodeID * SIZE_OF_NODE_STRUCT;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void IndexToOctreeCoords( uint32_t index, uint32_t bufferSize, uint32_t &x, uint32_t &y )
+{
+    x = index % bufferSize;
+    y = index / bufferSize;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t GetOctreeNodeCapacity( uint32_t bufferSize )
+{
+    return static_cast< size_t >( bufferSize ) * bufferSize / SIZE_OF_NODE_STRUCT;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t GetFullOctreeNodeCount( uint32_t height )
+{
+    // last level children are voxel pointers, not nodes
+    size_t count = 0, levelCount = 1;
+    for ( uint32_t level = 0; level < height; level++ )
+    {
+        count += levelCount;
+        levelCount *= CHILDS_COUNT;
+    }
+    return count;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void BrickIDToTextureCoords( uint32_t id, uint32_t brickBufferSize, uint32_t &x, uint32_t &y, uint32_t &z )
+{
+    // NodeIDToTextureCoords
+    uint32_t blocksPerAxis = brickBufferSize / BRICK_SIZE;
+    uint32_t blocksPerAxisSq = blocksPerAxis * blocksPerAxis;
+    x = ( id % blocksPerAxis ) * BRICK_SIZE;
+    y = ( ( id / blocksPerAxis ) % blocksPerAxis ) * BRICK_SIZE;
+    z = ( id / blocksPerAxisSq ) * BRICK_SIZE;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t GetBrickCapacity( uint32_t brickBufferSize )
+{
+    size_t blocksPerAxis = brickBufferSize / BRICK_SIZE;
+    return blocksPerAxis * blocksPerAxis * blocksPerAxis;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
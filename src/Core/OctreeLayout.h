@@ -0,0 +1,61 @@
+#ifndef __OCTREE_LAYOUT_H
+#define __OCTREE_LAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// gpu octree and brick buffer layout, must match defines in octreeUtils.fx and brickBufferUtils.fx
+#define MAX_OCTREE_HEIGHT 8
+#define CHILDS_COUNT 8
+#define SIZE_OF_NODE_STRUCT 16
+
+#define NODE_UNDEFINED 0xffffffff
+#define NODE_SUBDIVIDE 0xff00ff00
+#define NODE_ALLOCATED 0x0
+#define NODE_LIT       0x00000100
+
+#define BRICK_SIZE 3
+
+// packed position uses 10 bits per axis
+#define OCTREE_POSITION_BITS 10
+
+// uint slots of a node in the octree texture
+enum OctreeNodeSlot
+{
+    ONS_CHILDREN = 0, // 8 children: bit 0 - +x, bit 1 - +y, bit 2 - +z
+    ONS_NEIGHBORS = 8, // -x, +x, -y, +y, -z, +z
+    ONS_PARENT = 14,
+    ONS_FLAGS = 15
+};
+
+// voxel fragment of voxelArrayRW
+struct OctreeVoxel
+{
+    uint32_t mPosition; // PackOctreePosition
+    uint32_t mColor; // rgba8
+    uint32_t mNormal; // rgb8 of normal * 0.5 + 0.5
+    uint32_t mPad; // 128 bits aligment
+};
+
+// WorlPosToOctreePos without scene box: 10 bits per axis
+uint32_t PackOctreePosition( uint32_t x, uint32_t y, uint32_t z );
+void UnpackOctreePosition( uint32_t packed, uint32_t &x, uint32_t &y, uint32_t &z );
+// PackFloat4ToUint: saturated and truncated to 8 bits
+uint32_t PackColor( float r, float g, float b, float a );
+
+// slot of a child or neighbor, axis is 0..2
+uint32_t GetChildSlot( uint32_t x, uint32_t y, uint32_t z );
+uint32_t GetNeighborSlot( int axis, bool positive );
+
+// nodes are stored row by row in a square uint texture
+uint32_t NodeIDToIndex( uint32_t nodeID );
+void IndexToOctreeCoords( uint32_t index, uint32_t bufferSize, uint32_t &x, uint32_t &y );
+size_t GetOctreeNodeCapacity( uint32_t bufferSize );
+// nodes of a full octree above voxel level, upper bound of what the gpu build allocates
+size_t GetFullOctreeNodeCount( uint32_t height );
+
+// bricks are 3x3x3 texel blocks of a cubic 3d texture
+void BrickIDToTextureCoords( uint32_t id, uint32_t brickBufferSize, uint32_t &x, uint32_t &y, uint32_t &z );
+size_t GetBrickCapacity( uint32_t brickBufferSize );
+
+#endif
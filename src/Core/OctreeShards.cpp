@@ -0,0 +1,375 @@
+#include <Core/OctreeShards.h>
+#include <Core/CpuOctree.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    const uint32_t SHARD_FILE_MAGIC = 0x53544356; // VCTS
+    const uint32_t SHARD_FILE_VERSION = 1;
+    const uint32_t VOXEL_FILE_MAGIC = 0x56544356; // VCTV
+    const size_t VOXEL_FILE_CHUNK = 1 << 16;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    uint32_t ShardCell( uint32_t x, uint32_t y, uint32_t z, uint32_t shardLevel )
+    {
+        uint32_t cells = 1u << shardLevel;
+        return ( z * cells + y ) * cells + x;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void WriteU64( std::ofstream &file, uint64_t value )
+    {
+        file.write( reinterpret_cast< const char* >( &value ), sizeof( value ) );
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool ReadU64( std::ifstream &file, uint64_t &value )
+    {
+        return static_cast< bool >( file.read( reinterpret_cast< char* >( &value ), sizeof( value ) ) );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t GetShardCount( uint32_t shardLevel )
+{
+    return 1u << ( 3 * shardLevel );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool IsVoxelInShard( const OctreeVoxel &voxel, uint32_t height, uint32_t shardLevel, uint32_t shard )
+{
+    uint32_t x, y, z, shift = height - shardLevel;
+    UnpackOctreePosition( voxel.mPosition, x, y, z );
+    return ShardCell( x >> shift, y >> shift, z >> shift, shardLevel ) == shard;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void BuildOctreeShard( const std::vector<OctreeVoxel> &voxels, uint32_t height, uint32_t shardLevel, uint32_t shard, OctreeShard &result )
+{
+    result.mHeight = height;
+    result.mShardLevel = ( std::min )( shardLevel, height - 1 );
+    result.mShard = shard;
+    result.mVoxels.clear( );
+    for ( const OctreeVoxel &voxel : voxels )
+    {
+        if ( IsVoxelInShard( voxel, height, result.mShardLevel, shard ) )
+            result.mVoxels.push_back( voxel );
+    }
+    result.mVoxelCount = result.mVoxels.size( );
+
+    // the subtree sees the shard as the whole scene
+    uint32_t shift = height - result.mShardLevel, mask = ( 1u << shift ) - 1;
+    std::vector<OctreeVoxel> local( result.mVoxels );
+    for ( OctreeVoxel &voxel : local )
+    {
+        uint32_t x, y, z;
+        UnpackOctreePosition( voxel.mPosition, x, y, z );
+        voxel.mPosition = PackOctreePosition( x & mask, y & mask, z & mask );
+    }
+
+    CpuOctree subtree;
+    subtree.Build( local, shift );
+    result.mSlots = subtree.GetSlots( );
+    result.mLevelOffsets.resize( shift + 1 );
+    for ( uint32_t level = 0; level <= shift; level++ )
+        result.mLevelOffsets[level] = subtree.GetLevelOffset( level );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void MakeOctreeShard( const CpuOctree &octree, const std::vector<OctreeVoxel> &voxels, OctreeShard &result )
+{
+    result.mHeight = octree.GetHeight( );
+    result.mShardLevel = 0;
+    result.mShard = 0;
+    result.mVoxels = voxels;
+    result.mVoxelCount = voxels.size( );
+    result.mSlots = octree.GetSlots( );
+    result.mLevelOffsets.resize( result.mHeight + 1 );
+    for ( uint32_t level = 0; level <= result.mHeight; level++ )
+        result.mLevelOffsets[level] = octree.GetLevelOffset( level );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SaveOctreeShard( const char *fn, const OctreeShard &shard, std::string &error )
+{
+    std::ofstream file( fn, std::ofstream::binary | std::ofstream::trunc );
+    if ( !file )
+    {
+        error = std::string( "can't open " ) + fn;
+        return false;
+    }
+
+    uint32_t header[5] = { SHARD_FILE_MAGIC, SHARD_FILE_VERSION, shard.mHeight, shard.mShardLevel, shard.mShard };
+    file.write( reinterpret_cast< const char* >( header ), sizeof( header ) );
+    WriteU64( file, shard.mVoxels.size( ) );
+    WriteU64( file, shard.mLevelOffsets.size( ) );
+    for ( size_t offset : shard.mLevelOffsets )
+        WriteU64( file, offset );
+    WriteU64( file, shard.mSlots.size( ) );
+    file.write( reinterpret_cast< const char* >( shard.mSlots.data( ) ), shard.mSlots.size( ) * sizeof( uint32_t ) );
+    file.write( reinterpret_cast< const char* >( shard.mVoxels.data( ) ), shard.mVoxels.size( ) * sizeof( OctreeVoxel ) );
+
+    if ( !file.good( ) )
+    {
+        error = std::string( "write failed: " ) + fn;
+        return false;
+    }
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LoadOctreeShard( const char *fn, OctreeShard &shard, bool headerOnly, std::string &error )
+{
+    std::ifstream file( fn, std::ifstream::binary );
+    if ( !file )
+    {
+        error = std::string( "can't open " ) + fn;
+        return false;
+    }
+
+    uint32_t header[5];
+    if ( !file.read( reinterpret_cast< char* >( header ), sizeof( header ) ) || header[0] != SHARD_FILE_MAGIC )
+    {
+        error = std::string( "not an octree shard: " ) + fn;
+        return false;
+    }
+
+    uint64_t voxels = 0, levels = 0;
+    if ( header[1] != SHARD_FILE_VERSION || header[2] == 0 || header[2] > MAX_OCTREE_HEIGHT || header[3] >= header[2] ||
+        header[4] >= GetShardCount( header[3] ) || !ReadU64( file, voxels ) || !ReadU64( file, levels ) || levels != header[2] - header[3] + 1 )
+    {
+        error = std::string( "broken shard header: " ) + fn;
+        return false;
+    }
+
+    shard.mHeight = header[2];
+    shard.mShardLevel = header[3];
+    shard.mShard = header[4];
+    shard.mVoxelCount = voxels;
+    shard.mLevelOffsets.resize( static_cast< size_t >( levels ) );
+    for ( size_t &offset : shard.mLevelOffsets )
+    {
+        uint64_t value;
+        if ( !ReadU64( file, value ) )
+        {
+            error = std::string( "level offsets are truncated: " ) + fn;
+            return false;
+        }
+        offset = static_cast< size_t >( value );
+    }
+    shard.mSlots.clear( );
+    shard.mVoxels.clear( );
+    if ( headerOnly )
+        return true;
+
+    uint64_t slots = 0;
+    if ( !ReadU64( file, slots ) || slots != shard.mLevelOffsets.back( ) * SIZE_OF_NODE_STRUCT )
+    {
+        error = std::string( "broken shard sizes: " ) + fn;
+        return false;
+    }
+    shard.mSlots.resize( static_cast< size_t >( slots ) );
+    shard.mVoxels.resize( static_cast< size_t >( voxels ) );
+    if ( !file.read( reinterpret_cast< char* >( shard.mSlots.data( ) ), shard.mSlots.size( ) * sizeof( uint32_t ) ) ||
+        !file.read( reinterpret_cast< char* >( shard.mVoxels.data( ) ), shard.mVoxels.size( ) * sizeof( OctreeVoxel ) ) )
+    {
+        error = std::string( "shard is truncated: " ) + fn;
+        return false;
+    }
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SaveVoxelFile( const char *fn, const std::vector<OctreeVoxel> &voxels, std::string &error )
+{
+    std::ofstream file( fn, std::ofstream::binary | std::ofstream::trunc );
+    if ( !file )
+    {
+        error = std::string( "can't open " ) + fn;
+        return false;
+    }
+
+    file.write( reinterpret_cast< const char* >( &VOXEL_FILE_MAGIC ), sizeof( VOXEL_FILE_MAGIC ) );
+    WriteU64( file, voxels.size( ) );
+    file.write( reinterpret_cast< const char* >( voxels.data( ) ), voxels.size( ) * sizeof( OctreeVoxel ) );
+    if ( !file.good( ) )
+    {
+        error = std::string( "write failed: " ) + fn;
+        return false;
+    }
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LoadVoxelFile( const char *fn, uint32_t height, uint32_t shardLevel, uint32_t shard, std::vector<OctreeVoxel> &voxels,
+    std::string &error )
+{
+    voxels.clear( );
+    std::ifstream file( fn, std::ifstream::binary );
+    if ( !file )
+    {
+        error = std::string( "can't open " ) + fn;
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint64_t count = 0;
+    if ( !file.read( reinterpret_cast< char* >( &magic ), sizeof( magic ) ) || magic != VOXEL_FILE_MAGIC || !ReadU64( file, count ) )
+    {
+        error = std::string( "not a voxel file: " ) + fn;
+        return false;
+    }
+
+    std::vector<OctreeVoxel> chunk;
+    for ( uint64_t first = 0; first < count; first += chunk.size( ) )
+    {
+        chunk.resize( static_cast< size_t >( ( std::min )( count - first, static_cast< uint64_t >( VOXEL_FILE_CHUNK ) ) ) );
+        if ( !file.read( reinterpret_cast< char* >( chunk.data( ) ), chunk.size( ) * sizeof( OctreeVoxel ) ) )
+        {
+            error = std::string( "voxels are truncated: " ) + fn;
+            return false;
+        }
+        for ( const OctreeVoxel &voxel : chunk )
+        {
+            if ( shardLevel == 0 || IsVoxelInShard( voxel, height, shardLevel, shard ) )
+                voxels.push_back( voxel );
+        }
+    }
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MergeOctreeShards( const std::vector<std::string> &files, CpuOctree &octree, std::vector<OctreeVoxel> &voxels, std::string &error )
+{
+    voxels.clear( );
+    if ( files.empty( ) )
+    {
+        error = "no shards";
+        return false;
+    }
+
+    // headers: every shard cell exactly once, all of one octree
+    std::vector<OctreeShard> headers( files.size( ) );
+    for ( size_t i = 0; i < files.size( ); i++ )
+    {
+        if ( !LoadOctreeShard( files[i].c_str( ), headers[i], true, error ) )
+            return false;
+    }
+    uint32_t height = headers[0].mHeight, shardLevel = headers[0].mShardLevel, shards = GetShardCount( shardLevel );
+    std::vector<size_t> fileOfShard( shards, files.size( ) );
+    for ( size_t i = 0; i < files.size( ); i++ )
+    {
+        if ( headers[i].mHeight != height || headers[i].mShardLevel != shardLevel || fileOfShard[headers[i].mShard] != files.size( ) )
+        {
+            error = "shards of different octrees or a shard twice: " + files[i];
+            return false;
+        }
+        fileOfShard[headers[i].mShard] = i;
+    }
+    if ( files.size( ) != shards )
+    {
+        error = "shards are missing";
+        return false;
+    }
+
+    // shard cells with voxels and their ancestors, a node above the shard level is subdivided if any of them is
+    std::vector<std::vector<uint8_t>> occupied( shardLevel + 1 );
+    occupied[shardLevel].resize( shards );
+    for ( uint32_t shard = 0; shard < shards; shard++ )
+        occupied[shardLevel][shard] = headers[fileOfShard[shard]].mVoxelCount > 0 ? 1 : 0;
+    for ( uint32_t level = shardLevel; level > 0; level-- )
+    {
+        uint32_t cells = 1u << level;
+        occupied[level - 1].assign( GetShardCount( level - 1 ), 0 );
+        for ( uint32_t z = 0; z < cells; z++ )
+        for ( uint32_t y = 0; y < cells; y++ )
+        for ( uint32_t x = 0; x < cells; x++ )
+            occupied[level - 1][ShardCell( x >> 1, y >> 1, z >> 1, level - 1 )] |= occupied[level][ShardCell( x, y, z, level )];
+    }
+
+    // nodes down to the shard level in Build order, each with its cell
+    std::vector<uint32_t> slots( SIZE_OF_NODE_STRUCT, NODE_UNDEFINED );
+    std::vector<size_t> levelOffsets( 1, 0 );
+    levelOffsets.push_back( 1 );
+    std::vector<uint32_t> cells( 1, 0 ), nextCells;
+    for ( uint32_t level = 0; level < shardLevel; level++ )
+    {
+        nextCells.clear( );
+        for ( size_t id = levelOffsets[level]; id < levelOffsets[level + 1]; id++ )
+        {
+            uint32_t index = NodeIDToIndex( static_cast< uint32_t >( id ) ), cell = cells[id - levelOffsets[level]];
+            if ( !occupied[level][cell] )
+                continue;
+
+            uint32_t size = 1u << level, x = cell % size, y = cell / size % size, z = cell / size / size;
+            uint32_t firstChild = static_cast< uint32_t >( slots.size( ) );
+            slots.resize( slots.size( ) + CHILDS_COUNT * SIZE_OF_NODE_STRUCT, NODE_UNDEFINED );
+            for ( uint32_t i = 0; i < CHILDS_COUNT; i++ )
+            {
+                uint32_t childIndex = firstChild + i * SIZE_OF_NODE_STRUCT;
+                slots[index + ONS_CHILDREN + i] = childIndex;
+                slots[childIndex + ONS_PARENT] = index;
+                nextCells.push_back( ShardCell( 2 * x + ( i & 1 ), 2 * y + ( i >> 1 & 1 ), 2 * z + ( i >> 2 ), level + 1 ) );
+            }
+            slots[index + ONS_FLAGS] = NODE_ALLOCATED;
+        }
+        levelOffsets.push_back( slots.size( ) / SIZE_OF_NODE_STRUCT );
+        cells.swap( nextCells );
+    }
+
+    // levels below: subtrees one after the other in the order of their shard nodes
+    uint32_t depth = height - shardLevel;
+    size_t shardNodes = levelOffsets[shardLevel + 1] - levelOffsets[shardLevel];
+    std::vector<std::vector<size_t>> bases( shards, std::vector<size_t>( depth, 0 ) );
+    for ( uint32_t local = 1; local < depth; local++ )
+    {
+        size_t offset = levelOffsets.back( );
+        for ( size_t i = 0; i < shardNodes; i++ )
+        {
+            const OctreeShard &header = headers[fileOfShard[cells[i]]];
+            bases[cells[i]][local] = offset;
+            offset += header.mLevelOffsets[local + 1] - header.mLevelOffsets[local];
+        }
+        levelOffsets.push_back( offset );
+    }
+    slots.resize( levelOffsets.back( ) * SIZE_OF_NODE_STRUCT, NODE_UNDEFINED );
+
+    std::vector<size_t> rootOfShard( shards, 0 );
+    for ( size_t i = 0; i < shardNodes; i++ )
+        rootOfShard[cells[i]] = levelOffsets[shardLevel] + i;
+
+    // bodies in shard order, voxels are appended and leaves moved with them
+    OctreeShard shard;
+    for ( uint32_t cell = 0; cell < shards; cell++ )
+    {
+        if ( !occupied[shardLevel][cell] )
+            continue;
+        if ( !LoadOctreeShard( files[fileOfShard[cell]].c_str( ), shard, false, error ) )
+            return false;
+
+        const std::vector<size_t> &offsets = shard.mLevelOffsets;
+        auto globalIndex = [&]( uint32_t localIndex ) -> uint32_t
+        {
+            size_t id = localIndex / SIZE_OF_NODE_STRUCT;
+            uint32_t local = static_cast< uint32_t >( std::upper_bound( offsets.begin( ), offsets.end( ), id ) - offsets.begin( ) ) - 1;
+            size_t global = local == 0 ? rootOfShard[cell] : bases[cell][local] + id - offsets[local];
+            return NodeIDToIndex( static_cast< uint32_t >( global ) );
+        };
+
+        uint32_t voxelBase = static_cast< uint32_t >( voxels.size( ) );
+        for ( uint32_t local = 0; local < depth; local++ )
+        {
+            for ( size_t id = offsets[local]; id < offsets[local + 1]; id++ )
+            {
+                uint32_t from = NodeIDToIndex( static_cast< uint32_t >( id ) ), to = globalIndex( from );
+                for ( uint32_t i = 0; i < CHILDS_COUNT; i++ )
+                {
+                    uint32_t child = shard.mSlots[from + ONS_CHILDREN + i];
+                    if ( child != NODE_UNDEFINED )
+                        slots[to + ONS_CHILDREN + i] = local + 1 == depth ? voxelBase + child : globalIndex( child );
+                }
+                if ( local > 0 )
+                    slots[to + ONS_PARENT] = globalIndex( shard.mSlots[from + ONS_PARENT] );
+                slots[to + ONS_FLAGS] = shard.mSlots[from + ONS_FLAGS];
+            }
+        }
+        voxels.insert( voxels.end( ), shard.mVoxels.begin( ), shard.mVoxels.end( ) );
+    }
+
+    octree.Assemble( slots, levelOffsets, voxels );
+    return true;
+}
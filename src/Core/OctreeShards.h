@@ -0,0 +1,53 @@
+#ifndef __OCTREE_SHARDS_H
+#define __OCTREE_SHARDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <Core/OctreeLayout.h>
+
+class CpuOctree;
+
+// node of shardLevel and the subtree of its voxels, built on its own ( another process or host ) and merged later;
+// a whole octree is the shard 0 of level 0
+struct OctreeShard
+{
+    uint32_t mHeight = 0; // of the whole octree
+    uint32_t mShardLevel = 0;
+    uint32_t mShard = 0; // cell at shardLevel, x fastest
+    uint64_t mVoxelCount = 0; // set by a header only load too
+    std::vector<OctreeVoxel> mVoxels; // inside of the shard in input order, global positions
+    std::vector<uint32_t> mSlots; // CpuOctree slots of the subtree, the root is the shard node, leaves point to mVoxels
+    std::vector<size_t> mLevelOffsets; // GetLevelOffset of the subtree, levels shardLevel..height
+};
+
+uint32_t GetShardCount( uint32_t shardLevel );
+bool IsVoxelInShard( const OctreeVoxel &voxel, uint32_t height, uint32_t shardLevel, uint32_t shard );
+
+// CpuOctree::Build of the voxels inside of the shard, height - shardLevel levels below the shard node
+void BuildOctreeShard( const std::vector<OctreeVoxel> &voxels, uint32_t height, uint32_t shardLevel, uint32_t shard, OctreeShard &result );
+
+// a merged octree as a shard of level 0
+void MakeOctreeShard( const CpuOctree &octree, const std::vector<OctreeVoxel> &voxels, OctreeShard &result );
+
+// | magic | version | height | shard level | shard | voxel count | level count | level offsets | slot count | slots | voxels |
+// counts and offsets are uint64, so shard files move between hosts of any build
+bool SaveOctreeShard( const char *fn, const OctreeShard &shard, std::string &error );
+// headerOnly stops after the level offsets, they give the node counts
+bool LoadOctreeShard( const char *fn, OctreeShard &shard, bool headerOnly, std::string &error );
+
+// voxel list of a sharded bake: | magic | voxel count ( uint64 ) | voxels |
+bool SaveVoxelFile( const char *fn, const std::vector<OctreeVoxel> &voxels, std::string &error );
+// only the voxels of the shard are kept, reading goes in chunks so a worker holds its own voxels only;
+// shardLevel 0 reads all of them
+bool LoadVoxelFile( const char *fn, uint32_t height, uint32_t shardLevel, uint32_t shard, std::vector<OctreeVoxel> &voxels,
+    std::string &error );
+
+// one shard file per shard cell in any order; nodes above the shard level come from the shard roots, shard nodes move
+// to their Build ids level by level and leaves to the voxels concatenated in shard order, neighbor links across shard
+// faces are made by CpuOctree::Assemble. headers are read first and bodies one at a time, the same octree as
+// CpuOctree::Build of the concatenated voxels
+bool MergeOctreeShards( const std::vector<std::string> &files, CpuOctree &octree, std::vector<OctreeVoxel> &voxels, std::string &error );
+
+#endif
@@ -0,0 +1,248 @@
+#include <Core/PathBenchmark.h>
+#include <Core/CameraPath.h>
+#include <Core/Culling.h>
+#include <Core/ShadowCascades.h>
+#include <Core/VMath.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    // sponza sized volume
+    const float kSceneMin[3] = { -1920.0f, -130.0f, -1200.0f };
+    const float kSceneMax[3] = { 1800.0f, 1500.0f, 1100.0f };
+
+    // own generator, std distributions differ between standard libraries
+    struct Lcg
+    {
+        uint32_t mState;
+
+        explicit Lcg( uint32_t seed ) : mState( seed ) { }
+
+        float Next( float minValue, float maxValue )
+        {
+            mState = mState * 1664525u + 1013904223u;
+            return minValue + ( maxValue - minValue ) * static_cast< float >( mState >> 8 ) / 16777216.0f;
+        }
+    };
+
+    void BuildScene( size_t count, CullingBoxes &boxes )
+    {
+        Lcg rng( 1234 );
+        boxes.Clear( );
+        boxes.Reserve( count );
+        for ( size_t i = 0; i < count; i++ )
+        {
+            float c[3], s[3];
+            for ( int k = 0; k < 3; k++ )
+            {
+                c[k] = rng.Next( kSceneMin[k], kSceneMax[k] );
+                s[k] = rng.Next( 2.0f, 60.0f );
+            }
+            float pMin[3] = { c[0] - s[0], c[1] - s[1], c[2] - s[2] };
+            float pMax[3] = { c[0] + s[0], c[1] + s[1], c[2] + s[2] };
+            AABB box;
+            box.Extend( pMin );
+            box.Extend( pMax );
+            boxes.Push( box );
+        }
+    }
+
+    // same as Camera: looks along theta, phi with y up
+    Mat4 CameraView( const CameraKey &key )
+    {
+        Vec3 eye( key.mPosition[0], key.mPosition[1], key.mPosition[2] );
+        Vec3 dir( std::sin( key.mTheta ) * std::cos( key.mPhi ), std::sin( key.mPhi ), std::cos( key.mTheta ) * std::cos( key.mPhi ) );
+        return Mat4LookToRH( eye, dir, Vec3( 0.0f, 1.0f, 0.0f ) );
+    }
+
+    double Percentile( const std::vector<double> &sorted, double p )
+    {
+        size_t rank = static_cast< size_t >( std::ceil( p * sorted.size( ) ) );
+        rank = ( std::max )( rank, static_cast< size_t >( 1 ) );
+        return sorted[( std::min )( rank, sorted.size( ) ) - 1];
+    }
+
+    std::string Escape( const std::string &s )
+    {
+        std::string out;
+        for ( char c : s )
+        {
+            if ( c == '"' || c == '\\' )
+                out += '\\';
+            out += c;
+        }
+        return out;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FramePercentiles ComputeFramePercentiles( const std::vector<double> &frameMs )
+{
+    FramePercentiles result;
+    result.mCount = frameMs.size( );
+    if ( frameMs.empty( ) )
+        return result;
+
+    std::vector<double> sorted( frameMs );
+    std::sort( sorted.begin( ), sorted.end( ) );
+
+    double sum = 0.0;
+    for ( double ms : sorted )
+        sum += ms;
+
+    result.mMin = sorted.front( );
+    result.mMax = sorted.back( );
+    result.mMean = sum / sorted.size( );
+    result.mP50 = Percentile( sorted, 0.5 );
+    result.mP90 = Percentile( sorted, 0.9 );
+    result.mP95 = Percentile( sorted, 0.95 );
+    result.mP99 = Percentile( sorted, 0.99 );
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FramePercentiles PathBenchmarkReport::GetSummary( ) const
+{
+    std::vector<double> frameMs( mFrames.size( ) );
+    for ( size_t i = 0; i < mFrames.size( ); i++ )
+        frameMs[i] = mFrames[i].mMs;
+    return ComputeFramePercentiles( frameMs );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string PathBenchmarkReport::ToJson( ) const
+{
+    FramePercentiles summary = GetSummary( );
+
+    std::ostringstream out;
+    out.precision( 6 );
+    out << "{\n";
+    out << "  \"name\": \"" << Escape( mName ) << "\",\n";
+    out << "  \"pipeline\": \"" << Escape( mPipeline ) << "\",\n";
+    out << "  \"frames\": " << mFrames.size( ) << ",\n";
+    out << "  \"summary_ms\": { \"min\": " << summary.mMin << ", \"mean\": " << summary.mMean << ", \"p50\": " << summary.mP50
+        << ", \"p90\": " << summary.mP90 << ", \"p95\": " << summary.mP95 << ", \"p99\": " << summary.mP99
+        << ", \"max\": " << summary.mMax << " },\n";
+
+    out << "  \"frame_ms\": [";
+    for ( size_t i = 0; i < mFrames.size( ); i++ )
+        out << ( i > 0 ? ", " : "" ) << mFrames[i].mMs;
+    out << "],\n";
+
+    out << "  \"visible\": [";
+    for ( size_t i = 0; i < mFrames.size( ); i++ )
+        out << ( i > 0 ? ", " : "" ) << mFrames[i].mVisible;
+    out << "],\n";
+
+    out << "  \"shadow_redraws\": [";
+    for ( size_t i = 0; i < mFrames.size( ); i++ )
+        out << ( i > 0 ? ", " : "" ) << mFrames[i].mShadowRedraws;
+    out << "]\n";
+    out << "}\n";
+
+    return out.str( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PathBenchmarkReport::Save( const char *fn ) const
+{
+    std::ofstream file( fn );
+    file << ToJson( );
+    return file.good( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+PathBenchmarkReport RunCpuPathBenchmark( const CameraPath &path, int frames, size_t boxCount )
+{
+    typedef std::chrono::steady_clock Clock;
+
+    PathBenchmarkReport report;
+    report.mName = "cpu_reference";
+    report.mPipeline = "cpu_reference";
+    if ( frames <= 0 || path.GetKeyCount( ) == 0 )
+        return report;
+
+    CullingBoxes boxes;
+    BuildScene( boxCount, boxes );
+    std::vector<uint8_t> visible;
+
+    // D3DRenderer projection
+    const float n = 1.0f, f = 10000.0f;
+    Mat4 proj = Mat4PerspectiveFovRH( 0.25f * 3.14159265f, 4.0f / 3.0f, n, f );
+
+    float diagonal = 0.0f;
+    for ( int k = 0; k < 3; k++ )
+        diagonal += ( kSceneMax[k] - kSceneMin[k] ) * ( kSceneMax[k] - kSceneMin[k] );
+    diagonal = std::sqrt( diagonal );
+
+    ShadowCascadeParams params;
+    params.mNear = n;
+    params.mFar = ( std::min )( f, diagonal );
+
+    ShadowCascades cascades;
+    float duration = path.GetDuration( );
+    report.mFrames.resize( frames );
+
+    for ( int i = 0; i < frames; i++ )
+    {
+        Clock::time_point start = Clock::now( );
+
+        float t = frames > 1 ? duration * i / ( frames - 1 ) : 0.0f;
+        CameraKey key = path.Evaluate( t );
+
+        Mat4 view = CameraView( key );
+        Mat4 viewProj = Mat4Multiply( view, proj );
+
+        // sun as Scene::UpdateSun places it
+        ShadowLightInput light;
+        float cosPitch = std::fabs( std::cos( key.mSunPitch ) );
+        light.mDirection[0] = -std::cos( key.mSunYaw ) * cosPitch;
+        light.mDirection[1] = -std::sin( key.mSunPitch );
+        light.mDirection[2] = -std::sin( key.mSunYaw ) * cosPitch;
+        for ( int k = 0; k < 3; k++ )
+        {
+            light.mSceneMin[k] = kSceneMin[k];
+            light.mSceneMax[k] = kSceneMax[k];
+        }
+        cascades.Update( view.m, proj.m, light, params );
+
+        PathBenchmarkFrame &frame = report.mFrames[i];
+        frame.mVisible = static_cast< uint32_t >( CullBoxes( Frustum::FromViewProj( viewProj.m ), boxes, visible ) );
+
+        // redrawn maps cull their casters like the renderer would
+        for ( int c = -1; c < cascades.GetCount( ); c++ )
+        {
+            const ShadowCascade &cascade = c < 0 ? cascades.GetSceneCascade( ) : cascades.GetCascade( c );
+            if ( !cascade.mDirty )
+                continue;
+            CullBoxes( Frustum::FromViewProj( cascade.mViewProj ), boxes, visible );
+            frame.mShadowRedraws++;
+        }
+        cascades.ClearDirty( );
+
+        frame.mMs = std::chrono::duration<double, std::milli>( Clock::now( ) - start ).count( );
+    }
+
+    return report;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CameraPath MakeOrbitPath( float radius, float height, float duration )
+{
+    CameraPath path;
+    const int keys = 16;
+    for ( int i = 0; i <= keys; i++ )
+    {
+        float a = 6.2831853f * i / keys;
+        CameraKey key;
+        key.mTime = duration * i / keys;
+        key.mPosition[0] = radius * std::cos( a );
+        key.mPosition[1] = height;
+        key.mPosition[2] = radius * std::sin( a );
+        key.mTheta = std::atan2( -key.mPosition[0], -key.mPosition[2] ); // look at the center
+        key.mPhi = -0.2f;
+        key.mSunYaw = 1.0f;
+        key.mSunPitch = 1.26f;
+        path.AddKey( key );
+    }
+    return path;
+}
@@ -0,0 +1,52 @@
+#ifndef __PATH_BENCHMARK_H
+#define __PATH_BENCHMARK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class CameraPath;
+
+// nearest rank percentiles of frame times in ms
+struct FramePercentiles
+{
+    size_t mCount = 0;
+    double mMin = 0.0;
+    double mMean = 0.0;
+    double mP50 = 0.0;
+    double mP90 = 0.0;
+    double mP95 = 0.0;
+    double mP99 = 0.0;
+    double mMax = 0.0;
+};
+
+FramePercentiles ComputeFramePercentiles( const std::vector<double> &frameMs );
+
+struct PathBenchmarkFrame
+{
+    double mMs = 0.0;
+    uint32_t mVisible = 0; // objects passed camera culling
+    int mShadowRedraws = 0; // shadow maps drawn this frame
+};
+
+struct PathBenchmarkReport
+{
+    std::string mName;
+    std::string mPipeline; // "gpu" for the renderer, "cpu_reference" for the headless replay
+    std::vector<PathBenchmarkFrame> mFrames;
+
+    FramePercentiles GetSummary( ) const;
+    std::string ToJson( ) const;
+    bool Save( const char *fn ) const;
+};
+
+// replays the path over a deterministic synthetic scene of boxes without gpu: per frame camera matrices,
+// shadow cascade fitting and frustum culling for the camera and every redrawn cascade
+// visible and redraw counts repeat from run to run, times are what is measured
+PathBenchmarkReport RunCpuPathBenchmark( const CameraPath &path, int frames, size_t boxes );
+
+// orbit looking at the scene center under default sun, used when no path is recorded
+CameraPath MakeOrbitPath( float radius, float height, float duration );
+
+#endif
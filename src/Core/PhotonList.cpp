@@ -0,0 +1,340 @@
+#include <Core/PhotonList.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+
+namespace
+{
+    const float INV_255 = 1.0f / 255.0f;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    uint32_t SpreadBits( uint32_t v )
+    {
+        // 10 bits -> every third bit
+        v &= 0x3ff;
+        v = ( v | ( v << 16 ) ) & 0x030000ff;
+        v = ( v | ( v << 8 ) ) & 0x0300f00f;
+        v = ( v | ( v << 4 ) ) & 0x030c30c3;
+        v = ( v | ( v << 2 ) ) & 0x09249249;
+        return v;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    uint32_t CompactBits( uint32_t v )
+    {
+        v &= 0x09249249;
+        v = ( v ^ ( v >> 2 ) ) & 0x030c30c3;
+        v = ( v ^ ( v >> 4 ) ) & 0x0300f00f;
+        v = ( v ^ ( v >> 8 ) ) & 0xff0000ff;
+        v = ( v ^ ( v >> 16 ) ) & 0x000003ff;
+        return v;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    uint32_t PackFlux( float r, float g, float b )
+    {
+        // same rounding as PackFloat4ToUint in utils.fx
+        auto pack = []( float v ) { return static_cast< uint32_t >( std::min( std::max( v, 0.0f ), 1.0f ) * 255.0f ); };
+        return pack( r ) | ( pack( g ) << 8 ) | ( pack( b ) << 16 ) | ( 255u << 24 );
+    }
+
+    // sparse octree over lit leaves, stands in for the gpu node pool in the injection benchmark
+    struct LeafOctree
+    {
+        ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        void Build( const std::vector<PhotonLeaf> &leaves, uint32_t resolution )
+        {
+            mHeight = 0;
+            while ( ( 1u << mHeight ) < resolution )
+                mHeight++;
+
+            // node i children are mNodes[i * 8 + octant], 0 - empty, last level stores leaf index + 1
+            mNodes.assign( 8, 0 );
+            for ( size_t i = 0; i < leaves.size( ); i++ )
+            {
+                uint32_t node = 0;
+                for ( int level = 0; level < mHeight; level++ )
+                {
+                    size_t child = node * 8 + Octant( leaves[i].mKey, level );
+                    if ( level == mHeight - 1 )
+                    {
+                        mNodes[child] = static_cast< uint32_t >( i ) + 1;
+                        break;
+                    }
+
+                    if ( mNodes[child] == 0 )
+                    {
+                        mNodes[child] = static_cast< uint32_t >( mNodes.size( ) / 8 );
+                        mNodes.resize( mNodes.size( ) + 8, 0 );
+                    }
+                    node = mNodes[child];
+                }
+            }
+        }
+        ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        int Find( uint32_t key ) const
+        {
+            uint32_t node = 0;
+            for ( int level = 0; level < mHeight; level++ )
+            {
+                node = mNodes[node * 8 + Octant( key, level )];
+                if ( node == 0 )
+                    return -1;
+            }
+            return static_cast< int >( node ) - 1;
+        }
+        ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        uint32_t Octant( uint32_t key, int level ) const
+        {
+            // morton code is the octant path from the root, 3 bits per level
+            return ( key >> ( 3 * ( mHeight - 1 - level ) ) ) & 7;
+        }
+
+        int mHeight = 0;
+        std::vector<uint32_t> mNodes;
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t MortonEncode( uint32_t x, uint32_t y, uint32_t z )
+{
+    return SpreadBits( x ) | ( SpreadBits( y ) << 1 ) | ( SpreadBits( z ) << 2 );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void MortonDecode( uint32_t key, uint32_t &x, uint32_t &y, uint32_t &z )
+{
+    x = CompactBits( key );
+    y = CompactBits( key >> 1 );
+    z = CompactBits( key >> 2 );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void CompactPhotons( const float *positions, const uint32_t *flux, size_t count, const PhotonGrid &grid, std::vector<Photon> &photons )
+{
+    photons.clear( );
+    photons.reserve( count );
+
+    float scale[3];
+    for ( int a = 0; a < 3; a++ )
+        scale[a] = grid.mResolution / ( grid.mMax[a] - grid.mMin[a] );
+
+    uint32_t maxCoord = grid.mResolution - 1;
+    for ( size_t i = 0; i < count; i++ )
+    {
+        const float *p = positions + i * 3;
+        bool inside = true;
+        for ( int a = 0; a < 3; a++ )
+            inside &= p[a] >= grid.mMin[a] && p[a] <= grid.mMax[a];
+
+        if ( !inside )
+            continue;
+
+        uint32_t c[3];
+        for ( int a = 0; a < 3; a++ )
+            c[a] = std::min( static_cast< uint32_t >( ( p[a] - grid.mMin[a] ) * scale[a] ), maxCoord );
+
+        Photon photon = { MortonEncode( c[0], c[1], c[2] ), flux[i] };
+        photons.push_back( photon );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SortPhotons( std::vector<Photon> &photons, std::vector<Photon> &scratch )
+{
+    // the same scheme as RenderQueue::RadixSort, 8 bits per pass and constant digits are skipped
+    size_t count = photons.size( );
+    scratch.resize( count );
+
+    uint32_t varyingBits = 0;
+    for ( size_t i = 1; i < count; i++ )
+        varyingBits |= photons[i].mKey ^ photons[0].mKey;
+
+    for ( int shift = 0; shift < 32; shift += 8 )
+    {
+        if ( ( ( varyingBits >> shift ) & 0xff ) == 0 )
+            continue;
+
+        size_t histogram[256] = { 0 };
+        for ( size_t i = 0; i < count; i++ )
+            histogram[( photons[i].mKey >> shift ) & 0xff]++;
+
+        size_t offset = 0;
+        for ( size_t d = 0; d < 256; d++ )
+        {
+            size_t h = histogram[d];
+            histogram[d] = offset;
+            offset += h;
+        }
+
+        for ( size_t i = 0; i < count; i++ )
+            scratch[histogram[( photons[i].mKey >> shift ) & 0xff]++] = photons[i];
+
+        photons.swap( scratch );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ReducePhotons( const std::vector<Photon> &photons, std::vector<PhotonLeaf> &leaves )
+{
+    leaves.clear( );
+
+    size_t i = 0;
+    while ( i < photons.size( ) )
+    {
+        // segment of equal keys
+        uint32_t key = photons[i].mKey;
+        uint32_t sum[3] = { 0, 0, 0 };
+        size_t first = i;
+        for ( ; i < photons.size( ) && photons[i].mKey == key; i++ )
+        {
+            uint32_t f = photons[i].mFlux;
+            sum[0] += f & 0xff;
+            sum[1] += ( f >> 8 ) & 0xff;
+            sum[2] += ( f >> 16 ) & 0xff;
+        }
+
+        PhotonLeaf leaf;
+        leaf.mKey = key;
+        leaf.mCount = static_cast< uint32_t >( i - first );
+        for ( int c = 0; c < 3; c++ )
+            leaf.mFlux[c] = sum[c] * INV_255 / leaf.mCount;
+        leaves.push_back( leaf );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+PhotonBenchmarkResult RunPhotonListBenchmark( int resolution, uint32_t octreeResolution, int iterations )
+{
+    typedef std::chrono::steady_clock Clock;
+
+    PhotonBenchmarkResult result;
+    result.mResolution = resolution;
+    result.mOctreeResolution = octreeResolution;
+    result.mTexels = static_cast< size_t >( resolution ) * resolution;
+    iterations = std::max( iterations, 1 );
+
+    // rolling terrain with a raised block seen from above, a strip of texels misses the octree
+    std::vector<float> positions( result.mTexels * 3 );
+    std::vector<uint32_t> flux( result.mTexels );
+    for ( int y = 0; y < resolution; y++ )
+    {
+        for ( int x = 0; x < resolution; x++ )
+        {
+            size_t i = static_cast< size_t >( y ) * resolution + x;
+            float u = ( x + 0.5f ) / resolution, v = ( y + 0.5f ) / resolution;
+            bool block = u > 0.3f && u < 0.5f && v > 0.4f && v < 0.7f;
+            float height = 0.4f + 0.15f * std::sin( u * 6.0f ) * std::cos( v * 5.0f ) + ( block ? 0.2f : 0.0f );
+
+            positions[i * 3 + 0] = u;
+            positions[i * 3 + 1] = u > 0.9f ? -1.0f : height;
+            positions[i * 3 + 2] = v;
+
+            // checker albedo, NdotL falls off with slope
+            bool checker = ( ( static_cast< int >( u * 16.0f ) + static_cast< int >( v * 16.0f ) ) & 1 ) != 0;
+            float slope = 0.9f * std::cos( u * 6.0f ) * std::cos( v * 5.0f );
+            float ndotl = 1.0f / std::sqrt( 1.0f + slope * slope );
+            flux[i] = checker ? PackFlux( 0.8f * ndotl, 0.2f * ndotl, 0.2f * ndotl ) : PackFlux( 0.3f * ndotl, 0.7f * ndotl, 0.3f * ndotl );
+        }
+    }
+
+    PhotonGrid grid = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, octreeResolution };
+
+    std::vector<Photon> photons, sorted, scratch;
+    std::vector<PhotonLeaf> leaves;
+    auto ms = []( Clock::time_point start ) { return std::chrono::duration< double, std::milli >( Clock::now( ) - start ).count( ); };
+
+    double compactMs = 0.0, sortMs = 0.0, stdSortMs = 0.0, reduceMs = 0.0;
+    for ( int it = 0; it < iterations; it++ )
+    {
+        Clock::time_point start = Clock::now( );
+        CompactPhotons( positions.data( ), flux.data( ), result.mTexels, grid, photons );
+        compactMs += ms( start );
+
+        sorted = photons;
+        start = Clock::now( );
+        SortPhotons( sorted, scratch );
+        sortMs += ms( start );
+
+        start = Clock::now( );
+        ReducePhotons( sorted, leaves );
+        reduceMs += ms( start );
+    }
+
+    std::vector<Photon> reference = photons;
+    Clock::time_point start = Clock::now( );
+    std::stable_sort( reference.begin( ), reference.end( ), []( const Photon &a, const Photon &b ) { return a.mKey < b.mKey; } );
+    stdSortMs = ms( start );
+
+    result.mPhotons = photons.size( );
+    result.mLeaves = leaves.size( );
+    result.mCompactMs = compactMs / iterations;
+    result.mSortMs = sortMs / iterations;
+    result.mReduceMs = reduceMs / iterations;
+    result.mStdSortMs = stdSortMs;
+
+    // validate against straightforward implementations
+    bool matches = reference.size( ) == sorted.size( );
+    for ( size_t i = 0; matches && i < sorted.size( ); i++ )
+        matches = reference[i].mKey == sorted[i].mKey && reference[i].mFlux == sorted[i].mFlux;
+
+    std::map< uint32_t, std::pair< double, uint32_t > > referenceLeaves;
+    for ( size_t i = 0; i < photons.size( ); i++ )
+    {
+        std::pair< double, uint32_t > &entry = referenceLeaves[photons[i].mKey];
+        entry.first += ( photons[i].mFlux & 0xff ) * INV_255;
+        entry.second++;
+    }
+
+    matches &= referenceLeaves.size( ) == leaves.size( );
+    size_t leafIndex = 0;
+    for ( auto it = referenceLeaves.begin( ); matches && it != referenceLeaves.end( ); ++it, ++leafIndex )
+    {
+        const PhotonLeaf &leaf = leaves[leafIndex];
+        matches = leaf.mKey == it->first && leaf.mCount == it->second.second &&
+            std::fabs( leaf.mFlux[0] - it->second.first / it->second.second ) < 1e-4;
+    }
+    result.mMatchesReference = matches;
+
+    // injection: former path traverses the octree for every texel and keeps the first one per leaf,
+    // photon list path traverses once per leaf and writes the average
+    LeafOctree octree;
+    octree.Build( leaves, octreeResolution );
+    std::vector<float> irradiance( leaves.size( ) * 3 );
+    std::vector<uint8_t> litFlags( leaves.size( ) );
+
+    double perTexelMs = 0.0, perLeafMs = 0.0;
+    for ( int it = 0; it < iterations; it++ )
+    {
+        start = Clock::now( );
+        CompactPhotons( positions.data( ), flux.data( ), result.mTexels, grid, photons );
+        std::fill( litFlags.begin( ), litFlags.end( ), 0 );
+        for ( size_t i = 0; i < photons.size( ); i++ )
+        {
+            int leaf = octree.Find( photons[i].mKey );
+            if ( leaf < 0 || litFlags[leaf] )
+                continue;
+
+            litFlags[leaf] = 1;
+            uint32_t f = photons[i].mFlux;
+            irradiance[leaf * 3 + 0] = ( f & 0xff ) * INV_255;
+            irradiance[leaf * 3 + 1] = ( ( f >> 8 ) & 0xff ) * INV_255;
+            irradiance[leaf * 3 + 2] = ( ( f >> 16 ) & 0xff ) * INV_255;
+        }
+        perTexelMs += ms( start );
+
+        start = Clock::now( );
+        CompactPhotons( positions.data( ), flux.data( ), result.mTexels, grid, photons );
+        SortPhotons( photons, scratch );
+        ReducePhotons( photons, leaves );
+        for ( size_t i = 0; i < leaves.size( ); i++ )
+        {
+            int leaf = octree.Find( leaves[i].mKey );
+            if ( leaf < 0 )
+                continue;
+
+            for ( int c = 0; c < 3; c++ )
+                irradiance[leaf * 3 + c] = leaves[i].mFlux[c];
+        }
+        perLeafMs += ms( start );
+    }
+    result.mPerTexelInjectMs = perTexelMs / iterations;
+    result.mLeafInjectMs = perLeafMs / iterations;
+
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,68 @@
+#ifndef __PHOTON_LIST_H
+#define __PHOTON_LIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// must match define in brickBuffer.fx
+#define PHOTON_AXIS_BITS 10 // octree resolution up to 1024, key uses 30 bits
+
+// shadow texel that hit the octree: morton code of its leaf and rgba8 flux ( albedo * NdotL ) from the reflective shadow map
+struct Photon
+{
+    uint32_t mKey;
+    uint32_t mFlux;
+};
+
+// one entry per lit leaf after reduction
+struct PhotonLeaf
+{
+    uint32_t mKey;
+    uint32_t mCount; // photons merged into the leaf
+    float mFlux[3]; // average
+};
+
+// octree volume, leaf coords are ( pos - min ) / ( max - min ) * resolution
+struct PhotonGrid
+{
+    float mMin[3];
+    float mMax[3];
+    uint32_t mResolution;
+};
+
+struct PhotonBenchmarkResult
+{
+    int mResolution = 0; // shadow map side
+    uint32_t mOctreeResolution = 0;
+    size_t mTexels = 0;
+    size_t mPhotons = 0; // texels inside the octree
+    size_t mLeaves = 0; // unique lit leaves
+
+    // ms per run
+    double mCompactMs = 0.0;
+    double mSortMs = 0.0;
+    double mStdSortMs = 0.0;
+    double mReduceMs = 0.0;
+    double mPerTexelInjectMs = 0.0; // former path: traversal per texel with lit flag test
+    double mLeafInjectMs = 0.0; // photon list path: compact, sort, reduce and one traversal per leaf
+
+    bool mMatchesReference = false; // sort against std::stable_sort, reduce against std::map accumulation
+};
+
+uint32_t MortonEncode( uint32_t x, uint32_t y, uint32_t z );
+void MortonDecode( uint32_t key, uint32_t &x, uint32_t &y, uint32_t &z );
+
+// positions - xyz world position of each texel, texels outside of the grid are dropped
+void CompactPhotons( const float *positions, const uint32_t *flux, size_t count, const PhotonGrid &grid, std::vector<Photon> &photons );
+
+// lsd radix sort by key, stable; scratch is reused between calls
+void SortPhotons( std::vector<Photon> &photons, std::vector<Photon> &scratch );
+
+// photons must be sorted, averages flux of equal keys
+void ReducePhotons( const std::vector<Photon> &photons, std::vector<PhotonLeaf> &leaves );
+
+// synthetic height field seen from a directional light above
+PhotonBenchmarkResult RunPhotonListBenchmark( int resolution, uint32_t octreeResolution, int iterations );
+
+#endif
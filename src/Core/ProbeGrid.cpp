@@ -0,0 +1,636 @@
+#include <Core/ProbeGrid.h>
+#include <Core/CompactVertex.h>
+#include <Core/TaskScheduler.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+    const uint32_t PROBE_FILE_MAGIC = 0x50544356; // VCTP
+    const uint32_t PROBE_FILE_VERSION = 1;
+    const float PROBE_NORMAL_OFFSET = 0.25f; // of the probe spacing
+    const float PROBE_BACKFACE_WEIGHT = 0.05f; // least weight of a probe right behind the surface
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void AddMarchStats( OctreeMarchStats &sum, const OctreeMarchStats &stats )
+    {
+        sum.mLookups += stats.mLookups;
+        sum.mFetches += stats.mFetches;
+        sum.mParentSteps += stats.mParentSteps;
+        sum.mNeighborSteps += stats.mNeighborSteps;
+        sum.mRootTraversals += stats.mRootTraversals;
+        sum.mDenseSamples += stats.mDenseSamples;
+        sum.mSkippedSamples += stats.mSkippedSamples;
+        sum.mFieldFetches += stats.mFieldFetches;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool InvertMatrix( std::vector<double> &m, uint32_t size )
+    {
+        // gauss jordan with partial pivoting, m is row major
+        std::vector<double> inverse( size * size, 0.0 );
+        for ( uint32_t i = 0; i < size; i++ )
+            inverse[i * size + i] = 1.0;
+
+        for ( uint32_t col = 0; col < size; col++ )
+        {
+            uint32_t pivot = col;
+            for ( uint32_t row = col + 1; row < size; row++ )
+            {
+                if ( std::fabs( m[row * size + col] ) > std::fabs( m[pivot * size + col] ) )
+                    pivot = row;
+            }
+            if ( std::fabs( m[pivot * size + col] ) < 1e-9 )
+                return false;
+
+            for ( uint32_t k = 0; k < size; k++ )
+            {
+                std::swap( m[col * size + k], m[pivot * size + k] );
+                std::swap( inverse[col * size + k], inverse[pivot * size + k] );
+            }
+
+            double scale = 1.0 / m[col * size + col];
+            for ( uint32_t k = 0; k < size; k++ )
+            {
+                m[col * size + k] *= scale;
+                inverse[col * size + k] *= scale;
+            }
+
+            for ( uint32_t row = 0; row < size; row++ )
+            {
+                double factor = m[row * size + col];
+                if ( row == col || factor == 0.0 )
+                    continue;
+                for ( uint32_t k = 0; k < size; k++ )
+                {
+                    m[row * size + k] -= factor * m[col * size + k];
+                    inverse[row * size + k] -= factor * inverse[col * size + k];
+                }
+            }
+        }
+
+        m.swap( inverse );
+        return true;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EvaluateProbe( const float *coefficients, uint32_t count, const float normal[3], float result[4] )
+{
+    float basis[SH_L2_COEFFICIENTS];
+    EvaluateSH( normal, basis );
+    for ( int c = 0; c < 4; c++ )
+    {
+        float value = 0.0f;
+        for ( uint32_t k = 0; k < count; k++ )
+            value += coefficients[c * count + k] * basis[k];
+        result[c] = value;
+    }
+
+    // ringing of the fit can leave the range of the traced values
+    for ( int c = 0; c < 3; c++ )
+        result[c] = ( std::max )( result[c], 0.0f );
+    result[3] = ( std::max )( 0.0f, ( std::min )( result[3], 1.0f ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EvaluateSH( const float direction[3], float basis[SH_L2_COEFFICIENTS] )
+{
+    float x = direction[0], y = direction[1], z = direction[2];
+    basis[0] = 0.282095f;
+    basis[1] = 0.488603f * y;
+    basis[2] = 0.488603f * z;
+    basis[3] = 0.488603f * x;
+    basis[4] = 1.092548f * x * y;
+    basis[5] = 1.092548f * y * z;
+    basis[6] = 0.315392f * ( 3.0f * z * z - 1.0f );
+    basis[7] = 1.092548f * x * z;
+    basis[8] = 0.546274f * ( x * x - y * y );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void GetProbeDirections( uint32_t count, std::vector<float> &directions )
+{
+    const double goldenAngle = 3.14159265358979 * ( 3.0 - std::sqrt( 5.0 ) );
+    directions.resize( count * 3 );
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+        double z = 1.0 - ( 2.0 * i + 1.0 ) / count;
+        double r = std::sqrt( ( std::max )( 0.0, 1.0 - z * z ) );
+        double phi = goldenAngle * i;
+        directions[i * 3 + 0] = static_cast< float >( r * std::cos( phi ) );
+        directions[i * 3 + 1] = static_cast< float >( r * std::sin( phi ) );
+        directions[i * 3 + 2] = static_cast< float >( z );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BuildSHProjection( const std::vector<float> &directions, uint32_t coefficients, std::vector<float> &projection )
+{
+    uint32_t count = static_cast< uint32_t >( directions.size( ) / 3 );
+    coefficients = ( std::min )( coefficients, static_cast< uint32_t >( SH_L2_COEFFICIENTS ) );
+    if ( count < coefficients )
+        return false;
+
+    // ( A^T A )^-1 A^T with a row of basis values per direction
+    std::vector<double> basis( static_cast< size_t >( count ) * coefficients );
+    for ( uint32_t j = 0; j < count; j++ )
+    {
+        float values[SH_L2_COEFFICIENTS];
+        EvaluateSH( &directions[j * 3], values );
+        for ( uint32_t k = 0; k < coefficients; k++ )
+            basis[j * coefficients + k] = values[k];
+    }
+
+    std::vector<double> normal( coefficients * coefficients, 0.0 );
+    for ( uint32_t j = 0; j < count; j++ )
+    {
+        for ( uint32_t row = 0; row < coefficients; row++ )
+        {
+            for ( uint32_t col = 0; col < coefficients; col++ )
+                normal[row * coefficients + col] += basis[j * coefficients + row] * basis[j * coefficients + col];
+        }
+    }
+    if ( !InvertMatrix( normal, coefficients ) )
+        return false;
+
+    projection.assign( static_cast< size_t >( coefficients ) * count, 0.0f );
+    for ( uint32_t k = 0; k < coefficients; k++ )
+    {
+        for ( uint32_t j = 0; j < count; j++ )
+        {
+            double value = 0.0;
+            for ( uint32_t i = 0; i < coefficients; i++ )
+                value += normal[k * coefficients + i] * basis[j * coefficients + i];
+            projection[k * count + j] = static_cast< float >( value );
+        }
+    }
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ProbeBakeParams::ProbeBakeParams( ) :
+    mCoefficients( SH_L2_COEFFICIENTS ),
+    mDirections( 32 )
+{
+    for ( int a = 0; a < 3; a++ )
+        mResolution[a] = 16;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ProbeGrid::ProbeGrid( )
+{
+    for ( int a = 0; a < 3; a++ )
+    {
+        mMin[a] = mMax[a] = 0.0f;
+        mResolution[a] = 0;
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ProbeGrid::Bake( const CpuOctree &octree, const ConeTraceParams &params, const ProbeBakeParams &bake, TaskScheduler &scheduler,
+    const ConeTraceVolumes &volumes )
+{
+    for ( int a = 0; a < 3; a++ )
+    {
+        mMin[a] = params.mMin[a];
+        mMax[a] = params.mMax[a];
+        mResolution[a] = ( std::max )( bake.mResolution[a], 1u );
+    }
+    mCoefficients = bake.mCoefficients <= SH_L1_COEFFICIENTS ? SH_L1_COEFFICIENTS : SH_L2_COEFFICIENTS;
+
+    std::vector<float> directions, projection;
+    uint32_t count = ( std::max )( bake.mDirections, 2 * mCoefficients );
+    GetProbeDirections( count, directions );
+    BuildSHProjection( directions, mCoefficients, projection );
+
+    size_t probes = GetProbeCount( );
+    mValues.assign( probes * 4 * mCoefficients, 0.0f );
+    mValid.assign( probes, 0 );
+
+    auto bakeProbes = [&]( size_t first, size_t last ) -> ProbeBakeStats
+    {
+        ProbeBakeStats stats;
+        std::vector<float> traced( count * 4 );
+        uint32_t resolution = octree.GetResolution( );
+
+        for ( size_t probe = first; probe < last; probe++ )
+        {
+            uint32_t cell[3] = {
+                static_cast< uint32_t >( probe % mResolution[0] ),
+                static_cast< uint32_t >( probe / mResolution[0] % mResolution[1] ),
+                static_cast< uint32_t >( probe / mResolution[0] / mResolution[1] ) };
+
+            float position[3];
+            uint32_t coords[3];
+            for ( int a = 0; a < 3; a++ )
+            {
+                float t = ( cell[a] + 0.5f ) / mResolution[a];
+                position[a] = mMin[a] + t * ( mMax[a] - mMin[a] );
+                coords[a] = ( std::min )( static_cast< uint32_t >( t * resolution ), resolution - 1 );
+            }
+            stats.mProbes++;
+
+            // cones of a probe inside a voxel start behind the surface
+            uint32_t slot, nodeCoords[3];
+            if ( octree.Traverse( coords[0], coords[1], coords[2], octree.GetHeight( ), slot, nodeCoords, stats.mMarch.mFetches ) &&
+                octree.Fetch( slot ) != NODE_UNDEFINED )
+            {
+                stats.mInvalidProbes++;
+                continue;
+            }
+
+            for ( uint32_t j = 0; j < count; j++ )
+                TraceCones( octree, params, position, &directions[j * 3], CL_ROPES, &traced[j * 4], stats.mMarch, volumes );
+            stats.mTraces += count;
+
+            float *values = &mValues[probe * 4 * mCoefficients];
+            for ( int c = 0; c < 4; c++ )
+            {
+                for ( uint32_t k = 0; k < mCoefficients; k++ )
+                {
+                    float value = 0.0f;
+                    for ( uint32_t j = 0; j < count; j++ )
+                        value += projection[k * count + j] * traced[j * 4 + c];
+                    values[c * mCoefficients + k] = value;
+                }
+            }
+            mValid[probe] = 1;
+        }
+        return stats;
+    };
+    auto addStats = []( const ProbeBakeStats &sum, const ProbeBakeStats &stats ) -> ProbeBakeStats
+    {
+        ProbeBakeStats result = sum;
+        result.mProbes += stats.mProbes;
+        result.mInvalidProbes += stats.mInvalidProbes;
+        result.mTraces += stats.mTraces;
+        AddMarchStats( result.mMarch, stats.mMarch );
+        return result;
+    };
+    mStats = scheduler.ParallelReduce( 0, probes, 4, ProbeBakeStats( ), bakeProbes, addStats );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProbeGrid::Save( const char *fn, std::string &error ) const
+{
+    std::ofstream file( fn, std::ofstream::binary | std::ofstream::trunc );
+    if ( !file )
+    {
+        error = std::string( "can't open " ) + fn;
+        return false;
+    }
+
+    uint32_t header[6] = { PROBE_FILE_MAGIC, PROBE_FILE_VERSION, mCoefficients, mResolution[0], mResolution[1], mResolution[2] };
+    file.write( reinterpret_cast< const char* >( header ), sizeof( header ) );
+    file.write( reinterpret_cast< const char* >( mMin ), sizeof( mMin ) );
+    file.write( reinterpret_cast< const char* >( mMax ), sizeof( mMax ) );
+
+    std::vector<uint8_t> bits( ( mValid.size( ) + 7 ) / 8, 0 );
+    for ( size_t i = 0; i < mValid.size( ); i++ )
+        bits[i / 8] |= mValid[i] ? static_cast< uint8_t >( 1u << ( i % 8 ) ) : 0;
+    file.write( reinterpret_cast< const char* >( bits.data( ) ), bits.size( ) );
+
+    std::vector<uint16_t> halves( 4 * mCoefficients );
+    for ( size_t i = 0; i < mValid.size( ); i++ )
+    {
+        if ( !mValid[i] )
+            continue;
+        for ( size_t k = 0; k < halves.size( ); k++ )
+            halves[k] = FloatToHalf( mValues[i * halves.size( ) + k] );
+        file.write( reinterpret_cast< const char* >( halves.data( ) ), halves.size( ) * sizeof( uint16_t ) );
+    }
+
+    if ( !file.good( ) )
+    {
+        error = std::string( "write failed: " ) + fn;
+        return false;
+    }
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProbeGrid::Load( const char *fn, std::string &error )
+{
+    std::ifstream file( fn, std::ifstream::binary );
+    if ( !file )
+    {
+        error = std::string( "can't open " ) + fn;
+        return false;
+    }
+
+    uint32_t header[6];
+    float boxMin[3], boxMax[3];
+    if ( !file.read( reinterpret_cast< char* >( header ), sizeof( header ) ) || header[0] != PROBE_FILE_MAGIC )
+    {
+        error = "not a probe grid";
+        return false;
+    }
+    if ( header[1] != PROBE_FILE_VERSION || ( header[2] != SH_L1_COEFFICIENTS && header[2] != SH_L2_COEFFICIENTS ) )
+    {
+        error = "unsupported probe grid version";
+        return false;
+    }
+    uint64_t probes = static_cast< uint64_t >( header[3] ) * header[4] * header[5];
+    if ( probes == 0 || probes > ( 1u << 30 ) || !file.read( reinterpret_cast< char* >( boxMin ), sizeof( boxMin ) ) ||
+        !file.read( reinterpret_cast< char* >( boxMax ), sizeof( boxMax ) ) )
+    {
+        error = "broken probe grid header";
+        return false;
+    }
+
+    std::vector<uint8_t> bits( static_cast< size_t >( ( probes + 7 ) / 8 ) );
+    if ( !file.read( reinterpret_cast< char* >( bits.data( ) ), bits.size( ) ) )
+    {
+        error = "valid bits are truncated";
+        return false;
+    }
+
+    uint32_t coefficients = header[2];
+    std::vector<uint8_t> valid( static_cast< size_t >( probes ), 0 );
+    std::vector<float> values( valid.size( ) * 4 * coefficients, 0.0f );
+    std::vector<uint16_t> halves( 4 * coefficients );
+    for ( size_t i = 0; i < valid.size( ); i++ )
+    {
+        if ( ( bits[i / 8] & ( 1u << ( i % 8 ) ) ) == 0 )
+            continue;
+        if ( !file.read( reinterpret_cast< char* >( halves.data( ) ), halves.size( ) * sizeof( uint16_t ) ) )
+        {
+            error = "probes are truncated";
+            return false;
+        }
+        for ( size_t k = 0; k < halves.size( ); k++ )
+            values[i * halves.size( ) + k] = HalfToFloat( halves[k] );
+        valid[i] = 1;
+    }
+
+    for ( int a = 0; a < 3; a++ )
+    {
+        mMin[a] = boxMin[a];
+        mMax[a] = boxMax[a];
+        mResolution[a] = header[3 + a];
+    }
+    mCoefficients = coefficients;
+    mValues.swap( values );
+    mValid.swap( valid );
+    mStats = ProbeBakeStats( );
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProbeGrid::Evaluate( const float position[3], const float normal[3], float result[4] ) const
+{
+    if ( mValid.empty( ) )
+        return false;
+
+    // probes are at cell centers, outside of the outer ones the nearest probe is used. the lookup is moved off the
+    // surface along the normal, so probes in front of the surface get the larger trilinear weights
+    float cellSize[3];
+    uint32_t base[3], next[3];
+    float frac[3];
+    for ( int a = 0; a < 3; a++ )
+    {
+        cellSize[a] = ( mMax[a] - mMin[a] ) / mResolution[a];
+        float offset = position[a] + normal[a] * PROBE_NORMAL_OFFSET * cellSize[a];
+        float t = ( offset - mMin[a] ) / cellSize[a] - 0.5f;
+        t = ( std::max )( 0.0f, ( std::min )( t, static_cast< float >( mResolution[a] - 1 ) ) );
+        base[a] = ( std::min )( static_cast< uint32_t >( t ), mResolution[a] - 1 );
+        next[a] = ( std::min )( base[a] + 1, mResolution[a] - 1 );
+        frac[a] = t - base[a];
+    }
+
+    float blend[4 * SH_L2_COEFFICIENTS] = { };
+    float total = 0.0f;
+    for ( uint32_t corner = 0; corner < 8; corner++ )
+    {
+        uint32_t cell[3];
+        float weight = 1.0f;
+        for ( int a = 0; a < 3; a++ )
+        {
+            bool upper = ( corner >> a & 1 ) != 0;
+            cell[a] = upper ? next[a] : base[a];
+            weight *= upper ? frac[a] : 1.0f - frac[a];
+        }
+        if ( weight <= 0.0f || !IsValid( cell[0], cell[1], cell[2] ) )
+            continue;
+
+        // probes behind the surface see the other side of it, they fade out smoothly but never reach zero so a
+        // point with every probe behind it still gets a blend
+        float toProbe[3], distance = 0.0f, facing = 0.0f;
+        for ( int a = 0; a < 3; a++ )
+        {
+            toProbe[a] = mMin[a] + ( cell[a] + 0.5f ) * cellSize[a] - position[a];
+            distance += toProbe[a] * toProbe[a];
+            facing += toProbe[a] * normal[a];
+        }
+        facing = distance > 0.0f ? facing / std::sqrt( distance ) : 1.0f;
+        facing = ( facing + 1.0f ) * 0.5f;
+        weight *= facing * facing + PROBE_BACKFACE_WEIGHT;
+
+        const float *coefficients = GetCoefficients( cell[0], cell[1], cell[2] );
+        for ( uint32_t k = 0; k < 4 * mCoefficients; k++ )
+            blend[k] += coefficients[k] * weight;
+        total += weight;
+    }
+    if ( total <= 0.0f )
+        return false;
+
+    for ( uint32_t k = 0; k < 4 * mCoefficients; k++ )
+        blend[k] /= total;
+    EvaluateProbe( blend, mCoefficients, normal, result );
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t ProbeGrid::GetResolution( int axis ) const
+{
+    return mResolution[axis];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t ProbeGrid::GetCoefficientCount( ) const
+{
+    return mCoefficients;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t ProbeGrid::GetProbeCount( ) const
+{
+    return static_cast< size_t >( mResolution[0] ) * mResolution[1] * mResolution[2];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProbeGrid::IsValid( uint32_t x, uint32_t y, uint32_t z ) const
+{
+    return mValid[ProbeIndex( x, y, z )] != 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const float* ProbeGrid::GetCoefficients( uint32_t x, uint32_t y, uint32_t z ) const
+{
+    return &mValues[ProbeIndex( x, y, z ) * 4 * mCoefficients];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t ProbeGrid::GetByteSize( ) const
+{
+    return mValues.size( ) * sizeof( float ) + mValid.size( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t ProbeGrid::GetFileSize( ) const
+{
+    size_t valid = std::count( mValid.begin( ), mValid.end( ), 1 );
+    return 6 * sizeof( uint32_t ) + 6 * sizeof( float ) + ( mValid.size( ) + 7 ) / 8 + valid * 4 * mCoefficients * sizeof( uint16_t );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const ProbeBakeStats& ProbeGrid::GetStats( ) const
+{
+    return mStats;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t ProbeGrid::ProbeIndex( uint32_t x, uint32_t y, uint32_t z ) const
+{
+    return ( static_cast< size_t >( z ) * mResolution[1] + y ) * mResolution[0] + x;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ProbeBakeBenchmarkResult RunProbeBakeBenchmark( uint32_t height, uint32_t resolution, uint32_t directions )
+{
+    typedef std::chrono::steady_clock Clock;
+    auto ms = []( Clock::time_point start ) { return std::chrono::duration< double, std::milli >( Clock::now( ) - start ).count( ); };
+
+    height = ( std::max )( 4u, ( std::min )( height, static_cast< uint32_t >( MAX_OCTREE_HEIGHT ) ) );
+    resolution = ( std::max )( resolution, 1u );
+
+    std::vector<OctreeVoxel> voxels;
+    std::vector<ConeTracePoint> surface;
+    GenerateConeTestRoom( height, voxels, surface );
+    CpuOctree octree;
+    octree.Build( voxels, height );
+
+    // cone march benchmark settings
+    ConeTraceParams params;
+    params.mFirstLevel = height - 2;
+    params.mLastLevel = params.mFirstLevel > 4 ? params.mFirstLevel - 4 : 0;
+    float voxelSize = ( params.mMax[0] - params.mMin[0] ) / octree.GetResolution( );
+
+    ProbeBakeParams bake;
+    for ( int a = 0; a < 3; a++ )
+        bake.mResolution[a] = resolution;
+    bake.mDirections = directions;
+
+    ProbeBakeBenchmarkResult result;
+    result.mHeight = height;
+    result.mResolution = resolution;
+    result.mDirections = ( std::max )( directions, 2u * SH_L2_COEFFICIENTS );
+
+    TaskScheduler serial( 0 );
+    TaskScheduler &parallel = TaskScheduler::Get( );
+    result.mThreads = parallel.GetThreadCount( );
+
+    ProbeGrid serialGrid, grid, l1;
+    Clock::time_point start = Clock::now( );
+    serialGrid.Bake( octree, params, bake, serial );
+    result.mSerialMs = ms( start );
+
+    start = Clock::now( );
+    grid.Bake( octree, params, bake, parallel );
+    result.mParallelMs = ms( start );
+    result.mProbes = grid.GetProbeCount( );
+    result.mValidProbes = result.mProbes - grid.GetStats( ).mInvalidProbes;
+    result.mProbesPerSecond = result.mProbes / ( std::max )( result.mParallelMs, 1e-3 ) * 1000.0;
+
+    result.mBakesMatch = true;
+    size_t values = 4 * grid.GetCoefficientCount( );
+    for ( uint32_t z = 0; z < resolution; z++ )
+    {
+        for ( uint32_t y = 0; y < resolution; y++ )
+        {
+            for ( uint32_t x = 0; x < resolution; x++ )
+            {
+                result.mBakesMatch &= serialGrid.IsValid( x, y, z ) == grid.IsValid( x, y, z ) &&
+                    std::equal( grid.GetCoefficients( x, y, z ), grid.GetCoefficients( x, y, z ) + values, serialGrid.GetCoefficients( x, y, z ) );
+            }
+        }
+    }
+
+    bake.mCoefficients = SH_L1_COEFFICIENTS;
+    l1.Bake( octree, params, bake, parallel );
+    result.mL1FileBytes = l1.GetFileSize( );
+    result.mL2FileBytes = grid.GetFileSize( );
+
+    // fit error at the probes for normals the bake didn't trace
+    std::mt19937 rng( 23 );
+    std::normal_distribution<float> gauss;
+    OctreeMarchStats stats;
+    size_t fits = 0;
+    for ( uint32_t z = 0; z < resolution; z++ )
+    {
+        for ( uint32_t y = 0; y < resolution; y++ )
+        {
+            for ( uint32_t x = 0; x < resolution; x++ )
+            {
+                if ( !grid.IsValid( x, y, z ) )
+                    continue;
+
+                float position[3], normal[3], length = 0.0f;
+                uint32_t cell[3] = { x, y, z };
+                for ( int a = 0; a < 3; a++ )
+                {
+                    position[a] = params.mMin[a] + ( cell[a] + 0.5f ) / resolution * ( params.mMax[a] - params.mMin[a] );
+                    normal[a] = gauss( rng );
+                    length += normal[a] * normal[a];
+                }
+                length = ( std::max )( std::sqrt( length ), 1e-6f );
+                for ( int a = 0; a < 3; a++ )
+                    normal[a] /= length;
+
+                float traced[4], fitL1[4], fitL2[4];
+                TraceCones( octree, params, position, normal, CL_ROPES, traced, stats );
+                EvaluateProbe( l1.GetCoefficients( x, y, z ), SH_L1_COEFFICIENTS, normal, fitL1 );
+                EvaluateProbe( grid.GetCoefficients( x, y, z ), SH_L2_COEFFICIENTS, normal, fitL2 );
+                for ( int c = 0; c < 4; c++ )
+                {
+                    result.mL1Error += std::fabs( fitL1[c] - traced[c] ) / 4.0;
+                    result.mL2Error += std::fabs( fitL2[c] - traced[c] ) / 4.0;
+                }
+                fits++;
+            }
+        }
+    }
+    result.mL1Error /= ( std::max )( fits, size_t( 1 ) );
+    result.mL2Error /= ( std::max )( fits, size_t( 1 ) );
+
+    // the grid in place of TraceCones at surface points
+    std::uniform_int_distribution<size_t> pick( 0, surface.size( ) - 1 );
+    std::vector<ConeTracePoint> points( 4096 );
+    for ( ConeTracePoint &point : points )
+    {
+        point = surface[pick( rng )];
+        for ( int a = 0; a < 3; a++ )
+            point.mPosition[a] = params.mMin[a] + point.mPosition[a] * voxelSize;
+    }
+
+    std::vector<float> probed( points.size( ) * 4 ), traced( points.size( ) * 4 );
+    std::vector<uint8_t> covered( points.size( ) );
+    start = Clock::now( );
+    for ( size_t i = 0; i < points.size( ); i++ )
+        covered[i] = grid.Evaluate( points[i].mPosition, points[i].mNormal, &probed[i * 4] ) ? 1 : 0;
+    result.mEvaluateUs = ms( start ) * 1000.0 / points.size( );
+
+    start = Clock::now( );
+    for ( size_t i = 0; i < points.size( ); i++ )
+        TraceCones( octree, params, points[i].mPosition, points[i].mNormal, CL_ROPES, &traced[i * 4], stats );
+    result.mTraceUs = ms( start ) * 1000.0 / points.size( );
+
+    size_t compared = 0, spherePoints = 0;
+    for ( size_t i = 0; i < points.size( ); i++ )
+    {
+        if ( !covered[i] )
+            continue;
+        double difference = 0.0;
+        for ( int c = 0; c < 4; c++ )
+            difference += std::fabs( probed[i * 4 + c] - traced[i * 4 + c] ) / 4.0;
+        result.mSurfaceDifference += difference;
+        compared++;
+
+        // wall normals are axis aligned
+        const float *normal = points[i].mNormal;
+        if ( std::fabs( normal[0] ) + std::fabs( normal[1] ) + std::fabs( normal[2] ) > 1.0f + 1e-4f )
+        {
+            result.mSphereDifference += difference;
+            spherePoints++;
+        }
+    }
+    result.mSurfaceDifference /= ( std::max )( compared, size_t( 1 ) );
+    result.mSphereDifference /= ( std::max )( spherePoints, size_t( 1 ) );
+    return result;
+}
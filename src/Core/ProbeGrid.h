@@ -0,0 +1,110 @@
+#ifndef __PROBE_GRID_H
+#define __PROBE_GRID_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <Core/ConeTracer.h>
+
+class TaskScheduler;
+
+#define SH_L1_COEFFICIENTS 4
+#define SH_L2_COEFFICIENTS 9
+
+// real spherical harmonics of bands 0 - 2 for a unit direction, order 1, y, z, x, xy, yz, 3z^2 - 1, xz, x^2 - y^2
+void EvaluateSH( const float direction[3], float basis[SH_L2_COEFFICIENTS] );
+
+// rgb and 1 - ao of the coefficients of one probe ( 4 channels of count ) at normal, clamped to the traced range
+void EvaluateProbe( const float *coefficients, uint32_t count, const float normal[3], float result[4] );
+
+// fibonacci sphere, xyz per direction
+void GetProbeDirections( uint32_t count, std::vector<float> &directions );
+
+// least squares fit of the first coefficients to values at directions: coefficient k is the sum over directions j of
+// projection[k * count + j] * value[j]; false if the directions don't determine the coefficients
+bool BuildSHProjection( const std::vector<float> &directions, uint32_t coefficients, std::vector<float> &projection );
+
+struct ProbeBakeParams
+{
+    uint32_t mResolution[3]; // probes per axis, at cell centers of the scene box
+    uint32_t mCoefficients; // SH_L1_COEFFICIENTS or SH_L2_COEFFICIENTS
+    uint32_t mDirections; // TraceCones normals per probe, at least twice the coefficients
+
+    ProbeBakeParams( );
+};
+
+struct ProbeBakeStats
+{
+    size_t mProbes = 0;
+    size_t mInvalidProbes = 0; // inside a voxel, not baked
+    size_t mTraces = 0; // TraceCones calls
+    OctreeMarchStats mMarch;
+};
+
+// TraceCones results ( rgb and 1 - ao ) of a regular probe grid over the scene box as SH of the normal, for pixels
+// whose cones would leave the box or aren't worth tracing; a probe gives what a surface there with any normal would get
+class ProbeGrid
+{
+public:
+    ProbeGrid( );
+
+    // probes in parallel, the same coefficients for any thread count
+    void Bake( const CpuOctree &octree, const ConeTraceParams &params, const ProbeBakeParams &bake, TaskScheduler &scheduler,
+        const ConeTraceVolumes &volumes = ConeTraceVolumes( ) );
+
+    // | magic | version | coefficients | resolution xyz | box min xyz | box max xyz | valid bits | valid probes |
+    // probe: 4 channels of half float coefficients, x fastest order
+    bool Save( const char *fn, std::string &error ) const;
+    bool Load( const char *fn, std::string &error );
+
+    // trilinear blend of the valid probes around position evaluated at normal, false if none of them is valid
+    bool Evaluate( const float position[3], const float normal[3], float result[4] ) const;
+
+    uint32_t GetResolution( int axis ) const;
+    uint32_t GetCoefficientCount( ) const;
+    size_t GetProbeCount( ) const;
+    bool IsValid( uint32_t x, uint32_t y, uint32_t z ) const;
+    const float* GetCoefficients( uint32_t x, uint32_t y, uint32_t z ) const; // coefficients of r, g, b, then 1 - ao
+    size_t GetByteSize( ) const;
+    size_t GetFileSize( ) const; // what Save writes
+    const ProbeBakeStats& GetStats( ) const; // of the last Bake
+
+private:
+    size_t ProbeIndex( uint32_t x, uint32_t y, uint32_t z ) const;
+
+    float mMin[3];
+    float mMax[3];
+    uint32_t mResolution[3];
+    uint32_t mCoefficients = 0;
+    std::vector<float> mValues; // 4 * mCoefficients per probe
+    std::vector<uint8_t> mValid;
+    ProbeBakeStats mStats;
+};
+
+struct ProbeBakeBenchmarkResult
+{
+    uint32_t mHeight = 0;
+    uint32_t mResolution = 0; // probes per axis
+    uint32_t mDirections = 0;
+    size_t mProbes = 0;
+    size_t mValidProbes = 0;
+    size_t mThreads = 0; // of the parallel bake
+    double mSerialMs = 0.0; // L2 bake
+    double mParallelMs = 0.0;
+    double mProbesPerSecond = 0.0; // parallel
+    size_t mL1FileBytes = 0;
+    size_t mL2FileBytes = 0;
+    double mL1Error = 0.0; // mean abs difference of probe SH against TraceCones at the probe, random normals
+    double mL2Error = 0.0;
+    double mSurfaceDifference = 0.0; // L2 grid against TraceCones at surface points of the room
+    double mSphereDifference = 0.0; // the same at the points of the spheres, cones of wall points pick up the wall itself
+    double mEvaluateUs = 0.0; // per surface point
+    double mTraceUs = 0.0;
+    bool mBakesMatch = false; // serial and parallel coefficients are equal
+};
+
+// room of the cone march benchmark, cone march settings
+ProbeBakeBenchmarkResult RunProbeBakeBenchmark( uint32_t height, uint32_t resolution, uint32_t directions );
+
+#endif
@@ -0,0 +1,157 @@
+#include <Core/RangeAllocator.h>
+#include <GlobalUtils.h>
+#include <iterator>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+RangeAllocator::RangeAllocator( size_t capacity ) :
+    mCapacity( 0 ),
+    mUsed( 0 )
+{
+    Reset( capacity );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RangeAllocator::Reset( size_t capacity )
+{
+    mFreeByOffset.clear( );
+    mFreeBySize.clear( );
+    mAllocated.clear( );
+
+    mCapacity = capacity;
+    mUsed = 0;
+
+    if ( capacity > 0 )
+        InsertFreeBlock( 0, capacity );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RangeAllocator::Grow( size_t newCapacity )
+{
+    if ( newCapacity <= mCapacity )
+        return;
+
+    size_t offset = mCapacity;
+    size_t size = newCapacity - mCapacity;
+    mCapacity = newCapacity;
+
+    // merge with the last free block
+    if ( !mFreeByOffset.empty( ) )
+    {
+        auto last = std::prev( mFreeByOffset.end( ) );
+        if ( last->first + last->second == offset )
+        {
+            offset = last->first;
+            size += last->second;
+            RemoveFreeBlock( last );
+        }
+    }
+
+    InsertFreeBlock( offset, size );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t RangeAllocator::Allocate( size_t size )
+{
+    if ( size == 0 )
+        return INVALID_OFFSET;
+
+    // best fit: smallest free block that can hold the range
+    auto bestFit = mFreeBySize.lower_bound( size );
+    if ( bestFit == mFreeBySize.end( ) )
+        return INVALID_OFFSET;
+
+    size_t blockOffset = bestFit->second;
+    size_t blockSize = bestFit->first;
+    RemoveFreeBlock( mFreeByOffset.find( blockOffset ) );
+
+    if ( blockSize > size )
+        InsertFreeBlock( blockOffset + size, blockSize - size );
+
+    mAllocated[blockOffset] = size;
+    mUsed += size;
+    return blockOffset;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RangeAllocator::Free( size_t offset )
+{
+    auto allocIt = mAllocated.find( offset );
+    ASSERT( allocIt != mAllocated.end( ), "Unknown range offset ", offset );
+    if ( allocIt == mAllocated.end( ) )
+        return false;
+
+    size_t size = allocIt->second;
+    mAllocated.erase( allocIt );
+    mUsed -= size;
+
+    // coalesce with the right neighbour
+    auto next = mFreeByOffset.find( offset + size );
+    if ( next != mFreeByOffset.end( ) )
+    {
+        size += next->second;
+        RemoveFreeBlock( next );
+    }
+
+    // coalesce with the left neighbour
+    auto prev = mFreeByOffset.lower_bound( offset );
+    if ( prev != mFreeByOffset.begin( ) )
+    {
+        --prev;
+        if ( prev->first + prev->second == offset )
+        {
+            offset = prev->first;
+            size += prev->second;
+            RemoveFreeBlock( prev );
+        }
+    }
+
+    InsertFreeBlock( offset, size );
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t RangeAllocator::GetCapacity( ) const
+{
+    return mCapacity;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t RangeAllocator::GetUsed( ) const
+{
+    return mUsed;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t RangeAllocator::GetAllocationSize( size_t offset ) const
+{
+    auto it = mAllocated.find( offset );
+    return it != mAllocated.end( ) ? it->second : 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+RangeAllocatorStats RangeAllocator::GetStats( ) const
+{
+    RangeAllocatorStats stats;
+    stats.mCapacity = mCapacity;
+    stats.mUsed = mUsed;
+    stats.mFree = mCapacity - mUsed;
+    stats.mFreeBlockCount = mFreeByOffset.size( );
+    stats.mAllocationCount = mAllocated.size( );
+    stats.mLargestFreeBlock = mFreeBySize.empty( ) ? 0 : mFreeBySize.rbegin( )->first;
+    stats.mFragmentation = stats.mFree > 0 ? 1.0f - static_cast< float >( stats.mLargestFreeBlock ) / stats.mFree : 0.0f;
+    return stats;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RangeAllocator::InsertFreeBlock( size_t offset, size_t size )
+{
+    mFreeByOffset[offset] = size;
+    mFreeBySize.insert( std::make_pair( size, offset ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RangeAllocator::RemoveFreeBlock( std::map<size_t, size_t>::iterator it )
+{
+    auto range = mFreeBySize.equal_range( it->second );
+    for ( auto sizeIt = range.first; sizeIt != range.second; ++sizeIt )
+    {
+        if ( sizeIt->second == it->first )
+        {
+            mFreeBySize.erase( sizeIt );
+            break;
+        }
+    }
+
+    mFreeByOffset.erase( it );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,51 @@
+#ifndef __RANGE_ALLOCATOR_H
+#define __RANGE_ALLOCATOR_H
+
+#include <cstddef>
+#include <map>
+
+// fragmentation and usage report, all values in allocator units
+struct RangeAllocatorStats
+{
+    size_t mCapacity = 0;
+    size_t mUsed = 0;
+    size_t mFree = 0;
+    size_t mLargestFreeBlock = 0;
+    size_t mFreeBlockCount = 0;
+    size_t mAllocationCount = 0;
+    float mFragmentation = 0.0f; // 1 - largest free block / free space, 0 when free space is one block
+};
+
+// device independent sub-allocator for linear ranges (vertices, indices, bytes...)
+// best fit allocation, freed neighbours are coalesced
+class RangeAllocator
+{
+public:
+    static const size_t INVALID_OFFSET = ~size_t( 0 );
+
+    explicit RangeAllocator( size_t capacity = 0 );
+
+    void Reset( size_t capacity ); // drops all allocations
+    void Grow( size_t newCapacity ); // appends free space at the end, keeps allocations
+
+    size_t Allocate( size_t size ); // returns INVALID_OFFSET if there is no space
+    bool Free( size_t offset );
+
+    size_t GetCapacity( ) const;
+    size_t GetUsed( ) const;
+    size_t GetAllocationSize( size_t offset ) const; // 0 for unknown offset
+    RangeAllocatorStats GetStats( ) const;
+
+private:
+    size_t mCapacity;
+    size_t mUsed;
+
+    std::map<size_t, size_t> mFreeByOffset; // offset -> size, used for coalescing
+    std::multimap<size_t, size_t> mFreeBySize; // size -> offset, used for best fit search
+    std::map<size_t, size_t> mAllocated; // offset -> size
+
+    void InsertFreeBlock( size_t offset, size_t size );
+    void RemoveFreeBlock( std::map<size_t, size_t>::iterator it );
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include <Core/RenderQueue.h>
+#include <GlobalUtils.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t RenderQueue::PackKey( uint32_t technique, uint32_t material, uint32_t albedoTex, uint32_t normalTex )
+{
+    WARNING( technique > 0xff || material > 0xffffff || albedoTex > 0xffff || normalTex > 0xffff, "Render key overflow" );
+
+    return ( static_cast< uint64_t >( technique & 0xff ) << 56 ) |
+        ( static_cast< uint64_t >( material & 0xffffff ) << 32 ) |
+        ( static_cast< uint64_t >( albedoTex & 0xffff ) << 16 ) |
+        static_cast< uint64_t >( normalTex & 0xffff );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t RenderQueue::GetTechnique( uint64_t key )
+{
+    return static_cast< uint32_t >( key >> 56 ) & 0xff;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t RenderQueue::GetMaterial( uint64_t key )
+{
+    return static_cast< uint32_t >( key >> 32 ) & 0xffffff;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t RenderQueue::GetAlbedoTexture( uint64_t key )
+{
+    return static_cast< uint32_t >( key >> 16 ) & 0xffff;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t RenderQueue::GetNormalTexture( uint64_t key )
+{
+    return static_cast< uint32_t >( key ) & 0xffff;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderQueue::Clear( )
+{
+    mItems.clear( );
+    mBatches.clear( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderQueue::Push( uint64_t key, uint32_t object, uint32_t page, uint32_t firstIndex, uint32_t indexCount )
+{
+    RenderItem item = { key, object, page, firstIndex, indexCount };
+    mItems.push_back( item );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderQueue::RadixSort( )
+{
+    // lsd radix sort of (key, item) pairs, 8 bits per pass; stable, so it can be chained for secondary keys
+    size_t count = mSortEntries.size( );
+    mTmpSortEntries.resize( count );
+
+    // skip digits which are equal for all entries
+    uint64_t varyingBits = 0;
+    for ( size_t i = 1; i < count; i++ )
+        varyingBits |= mSortEntries[i].mKey ^ mSortEntries[0].mKey;
+
+    for ( int shift = 0; shift < 64; shift += 8 )
+    {
+        if ( ( ( varyingBits >> shift ) & 0xff ) == 0 )
+            continue;
+
+        size_t histogram[256] = { 0 };
+        for ( size_t i = 0; i < count; i++ )
+            histogram[( mSortEntries[i].mKey >> shift ) & 0xff]++;
+
+        size_t offset = 0;
+        for ( size_t d = 0; d < 256; d++ )
+        {
+            size_t h = histogram[d];
+            histogram[d] = offset;
+            offset += h;
+        }
+
+        for ( size_t i = 0; i < count; i++ )
+            mTmpSortEntries[histogram[( mSortEntries[i].mKey >> shift ) & 0xff]++] = mSortEntries[i];
+
+        mSortEntries.swap( mTmpSortEntries );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderQueue::Build( )
+{
+    mBatches.clear( );
+    if ( mItems.empty( ) )
+        return;
+
+    size_t count = mItems.size( );
+    mSortEntries.resize( count );
+
+    // secondary key first: geometry location, so equal states end up in index buffer order
+    for ( size_t i = 0; i < count; i++ )
+    {
+        mSortEntries[i].mKey = ( static_cast< uint64_t >( mItems[i].mPage ) << 32 ) | mItems[i].mFirstIndex;
+        mSortEntries[i].mItem = static_cast< uint32_t >( i );
+    }
+    RadixSort( );
+
+    // primary key: state
+    for ( size_t i = 0; i < count; i++ )
+        mSortEntries[i].mKey = mItems[mSortEntries[i].mItem].mKey;
+    RadixSort( );
+
+    mTmpItems.resize( count );
+    for ( size_t i = 0; i < count; i++ )
+        mTmpItems[i] = mItems[mSortEntries[i].mItem];
+    mItems.swap( mTmpItems );
+
+    RenderBatch batch = { mItems[0].mKey, mItems[0].mObject, mItems[0].mPage, mItems[0].mFirstIndex, mItems[0].mIndexCount, 1 };
+    for ( size_t i = 1; i < mItems.size( ); i++ )
+    {
+        const RenderItem &item = mItems[i];
+        bool adjacent = item.mKey == batch.mKey && item.mPage == batch.mPage && item.mFirstIndex == batch.mFirstIndex + batch.mIndexCount;
+        if ( adjacent )
+        {
+            batch.mIndexCount += item.mIndexCount;
+            batch.mItemCount++;
+            continue;
+        }
+
+        mBatches.push_back( batch );
+        RenderBatch next = { item.mKey, item.mObject, item.mPage, item.mFirstIndex, item.mIndexCount, 1 };
+        batch = next;
+    }
+    mBatches.push_back( batch );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const std::vector<RenderItem>& RenderQueue::GetItems( ) const
+{
+    return mItems;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const std::vector<RenderBatch>& RenderQueue::GetBatches( ) const
+{
+    return mBatches;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+RenderQueueStats RenderQueue::GetStats( ) const
+{
+    RenderQueueStats stats;
+    stats.mItems = mItems.size( );
+    stats.mBatches = mBatches.size( );
+    for ( size_t i = 0; i < mBatches.size( ); i++ )
+    {
+        if ( i == 0 || mBatches[i].mKey != mBatches[i - 1].mKey )
+            stats.mStateChanges++;
+    }
+    return stats;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+RenderQueueStats RenderQueue::RunBenchmark( size_t draws, uint32_t materials, uint32_t textures )
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // synthetic scene: meshes laid out one after another, material assigned randomly
+    std::mt19937 rng( 1234 );
+    std::uniform_int_distribution<uint32_t> matDist( 0, std::max( materials, 1u ) - 1 );
+    std::uniform_int_distribution<uint32_t> texDist( 0, std::max( textures, 1u ) - 1 );
+    std::uniform_int_distribution<uint32_t> sizeDist( 6, 3000 );
+
+    std::vector<uint64_t> materialKeys( std::max( materials, 1u ) );
+    for ( size_t i = 0; i < materialKeys.size( ); i++ )
+        materialKeys[i] = PackKey( 0, static_cast< uint32_t >( i ), texDist( rng ), texDist( rng ) );
+
+    RenderQueue queue;
+    uint32_t firstIndex = 0;
+    for ( size_t i = 0; i < draws; i++ )
+    {
+        uint32_t indexCount = sizeDist( rng );
+        queue.Push( materialKeys[matDist( rng )], static_cast< uint32_t >( i ), 0, firstIndex, indexCount );
+        firstIndex += indexCount;
+    }
+    std::vector<RenderItem> source = queue.mItems;
+
+    // warm up, so first touch of internal buffers isn't measured
+    queue.Build( );
+    queue.mItems = source;
+
+    Clock::time_point start = Clock::now( );
+    queue.Build( );
+    double sortTime = std::chrono::duration< double >( Clock::now( ) - start ).count( );
+
+    // reference: comparison sort with the same ordering
+    std::vector<RenderItem> reference = source;
+    start = Clock::now( );
+    std::sort( reference.begin( ), reference.end( ), []( const RenderItem &a, const RenderItem &b )
+    {
+        if ( a.mKey != b.mKey )
+            return a.mKey < b.mKey;
+        if ( a.mPage != b.mPage )
+            return a.mPage < b.mPage;
+        return a.mFirstIndex < b.mFirstIndex;
+    } );
+    double stdSortTime = std::chrono::duration< double >( Clock::now( ) - start ).count( );
+
+    for ( size_t i = 0; i < reference.size( ); i++ )
+        ASSERT( reference[i].mObject == queue.mItems[i].mObject, "Radix sort order mismatch" );
+
+    RenderQueueStats stats = queue.GetStats( );
+    stats.mSortTime = sortTime;
+    stats.mStdSortTime = stdSortTime;
+    return stats;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,81 @@
+#ifndef __RENDER_QUEUE_H
+#define __RENDER_QUEUE_H
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// single draw request
+// mKey holds packed state (technique, material, textures), geometry is a range in a pooled index buffer
+struct RenderItem
+{
+    uint64_t mKey;
+    uint32_t mObject; // user index, e.g. position in scene geometry list
+    uint32_t mPage;
+    uint32_t mFirstIndex;
+    uint32_t mIndexCount;
+};
+
+// several items with equal key and adjacent index ranges merged into one draw
+struct RenderBatch
+{
+    uint64_t mKey;
+    uint32_t mObject; // first merged item object
+    uint32_t mPage;
+    uint32_t mFirstIndex;
+    uint32_t mIndexCount;
+    uint32_t mItemCount;
+};
+
+struct RenderQueueStats
+{
+    size_t mItems = 0;
+    size_t mBatches = 0;
+    size_t mStateChanges = 0; // batches whose key differs from previous one
+    double mSortTime = 0.0; // seconds, filled by benchmark
+    double mStdSortTime = 0.0;
+};
+
+// sorts draws by packed state key with radix sort and merges them into ranged draws
+//
+// key layout:
+// | 63..56 technique | 55..32 material | 31..16 albedo texture | 15..0 normal texture |
+class RenderQueue
+{
+public:
+    static uint64_t PackKey( uint32_t technique, uint32_t material, uint32_t albedoTex, uint32_t normalTex );
+    static uint32_t GetTechnique( uint64_t key );
+    static uint32_t GetMaterial( uint64_t key );
+    static uint32_t GetAlbedoTexture( uint64_t key );
+    static uint32_t GetNormalTexture( uint64_t key );
+
+    void Clear( );
+    void Push( uint64_t key, uint32_t object, uint32_t page, uint32_t firstIndex, uint32_t indexCount );
+
+    // sorts by key, inside equal keys by geometry location, then merges adjacent ranges
+    void Build( );
+
+    const std::vector<RenderItem>& GetItems( ) const;
+    const std::vector<RenderBatch>& GetBatches( ) const;
+    RenderQueueStats GetStats( ) const;
+
+    // sorts and batches synthetic draws, compares radix sort with std::sort
+    static RenderQueueStats RunBenchmark( size_t draws, uint32_t materials, uint32_t textures );
+
+private:
+    struct SortEntry
+    {
+        uint64_t mKey;
+        uint32_t mItem;
+    };
+
+    std::vector<RenderItem> mItems;
+    std::vector<RenderItem> mTmpItems;
+    std::vector<SortEntry> mSortEntries;
+    std::vector<SortEntry> mTmpSortEntries;
+    std::vector<RenderBatch> mBatches;
+
+    void RadixSort( );
+};
+
+#endif
@@ -0,0 +1,436 @@
+#include <Core/SceneStream.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <sstream>
+
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment( lib, "psapi.lib" )
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const size_t kMaxStringLength = 4096; // names and paths, anything longer is a broken file
+
+    // checksum and bounds of streamed geometry, accumulated in the same order on write and read
+    struct SceneDigest
+    {
+        double mPositionSum;
+        uint64_t mIndexSum;
+        float mMin[3];
+        float mMax[3];
+
+        SceneDigest( ) : mPositionSum( 0.0 ), mIndexSum( 0 )
+        {
+            for ( int a = 0; a < 3; a++ )
+            {
+                mMin[a] = 1e30f;
+                mMax[a] = -1e30f;
+            }
+        }
+
+        void Add( const SceneVertex *vertices, size_t vertexCount, const uint32_t *indices, size_t indexCount )
+        {
+            for ( size_t i = 0; i < vertexCount; i++ )
+            {
+                for ( int a = 0; a < 3; a++ )
+                {
+                    float p = vertices[i].mPosition[a];
+                    mPositionSum += p;
+                    mMin[a] = ( std::min )( mMin[a], p );
+                    mMax[a] = ( std::max )( mMax[a], p );
+                }
+            }
+            for ( size_t i = 0; i < indexCount; i++ )
+                mIndexSum += indices[i];
+        }
+
+        bool operator==( const SceneDigest &r ) const
+        {
+            for ( int a = 0; a < 3; a++ )
+            {
+                if ( mMin[a] != r.mMin[a] || mMax[a] != r.mMax[a] )
+                    return false;
+            }
+            return mPositionSum == r.mPositionSum && mIndexSum == r.mIndexSum;
+        }
+    };
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// height field patch, every object is a different tile of the same terrain
+void GenerateSyntheticObject( size_t object, size_t side, std::vector<SceneVertex> &vertices, std::vector<uint32_t> &indices )
+{
+    const float spacing = 1.0f;
+    const size_t tilesPerRow = 64;
+    float originX = static_cast< float >( object % tilesPerRow ) * ( side - 1 ) * spacing;
+    float originZ = static_cast< float >( object / tilesPerRow ) * ( side - 1 ) * spacing;
+
+    vertices.resize( side * side );
+    for ( size_t z = 0; z < side; z++ )
+    {
+        for ( size_t x = 0; x < side; x++ )
+        {
+            SceneVertex &v = vertices[z * side + x];
+            v.mPosition[0] = originX + x * spacing;
+            v.mPosition[2] = originZ + z * spacing;
+            v.mPosition[1] = 10.0f * std::sin( v.mPosition[0] * 0.05f ) * std::cos( v.mPosition[2] * 0.05f );
+            v.mNormal[0] = 0.0f; v.mNormal[1] = 1.0f; v.mNormal[2] = 0.0f;
+            v.mBinormal[0] = 1.0f; v.mBinormal[1] = 0.0f; v.mBinormal[2] = 0.0f;
+            v.mUV[0] = static_cast< float >( x ) / ( side - 1 );
+            v.mUV[1] = static_cast< float >( z ) / ( side - 1 );
+        }
+    }
+
+    indices.clear( );
+    for ( uint32_t z = 0; z + 1 < side; z++ )
+    {
+        for ( uint32_t x = 0; x + 1 < side; x++ )
+        {
+            uint32_t i0 = static_cast< uint32_t >( z * side + x );
+            uint32_t i1 = i0 + 1, i2 = i0 + static_cast< uint32_t >( side ), i3 = i2 + 1;
+            uint32_t quad[] = { i0, i2, i1, i1, i2, i3 };
+            indices.insert( indices.end( ), quad, quad + 6 );
+        }
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneBinReader::Open( const char *fn, std::string &error )
+{
+    Close( );
+
+    mFile.open( fn, std::ifstream::binary );
+    if ( mFile.fail( ) )
+    {
+        error = std::string( "can't open " ) + fn;
+        return false;
+    }
+
+    mFile.seekg( 0, std::ios::end );
+    mFileSize = static_cast< uint64_t >( mFile.tellg( ) );
+    mFile.seekg( 0, std::ios::beg );
+
+    size_t libCount = 0;
+    if ( !ReadSize( libCount ) || libCount > kMaxStringLength )
+    {
+        error = "broken material lib list";
+        return false;
+    }
+
+    mMaterialLibs.resize( libCount );
+    for ( auto &lib : mMaterialLibs )
+    {
+        if ( !ReadString( lib ) )
+        {
+            error = "broken material lib name";
+            return false;
+        }
+    }
+
+    if ( !ReadSize( mObjectCount ) )
+    {
+        error = "missing object count";
+        return false;
+    }
+
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBinReader::Close( )
+{
+    if ( mFile.is_open( ) )
+        mFile.close( );
+    mFile.clear( );
+
+    mFileSize = 0;
+    mMaterialLibs.clear( );
+    mObjectCount = 0;
+    mObjectsRead = 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const std::vector<std::string>& SceneBinReader::GetMaterialLibs( ) const
+{
+    return mMaterialLibs;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t SceneBinReader::GetObjectCount( ) const
+{
+    return mObjectCount;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t SceneBinReader::GetObjectsRead( ) const
+{
+    return mObjectsRead;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneBinReader::ReadObject( SceneBinObject &object, std::string &error )
+{
+    if ( !mFile.is_open( ) || mObjectsRead >= mObjectCount )
+        return false;
+
+    std::ostringstream where;
+    where << "object " << mObjectsRead;
+
+    // counts are checked against the rest of the file before anything is allocated
+    auto fits = [&]( size_t count, size_t elementSize ) -> bool
+    {
+        uint64_t left = mFileSize - static_cast< uint64_t >( mFile.tellg( ) );
+        return count <= left / elementSize;
+    };
+
+    size_t vertexCount = 0, indexCount = 0;
+    if ( !ReadString( object.mName ) || !ReadString( object.mMaterial ) )
+    {
+        error = where.str( ) + ": broken name";
+        return false;
+    }
+
+    if ( !ReadSize( vertexCount ) || !fits( vertexCount, sizeof( SceneVertex ) ) )
+    {
+        error = where.str( ) + ": vertices are truncated";
+        return false;
+    }
+    object.mVertices.resize( vertexCount );
+    mFile.read( reinterpret_cast< char* >( object.mVertices.data( ) ), vertexCount * sizeof( SceneVertex ) );
+
+    if ( !ReadSize( indexCount ) || !fits( indexCount, sizeof( uint32_t ) ) )
+    {
+        error = where.str( ) + ": indices are truncated";
+        return false;
+    }
+    object.mIndices.resize( indexCount );
+    mFile.read( reinterpret_cast< char* >( object.mIndices.data( ) ), indexCount * sizeof( uint32_t ) );
+
+    if ( mFile.fail( ) )
+    {
+        error = where.str( ) + ": read failed";
+        return false;
+    }
+
+    mObjectsRead++;
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::istream& SceneBinReader::GetStream( )
+{
+    return mFile;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneBinReader::ReadSize( size_t &size )
+{
+    mFile.read( reinterpret_cast< char* >( &size ), sizeof( size_t ) );
+    return !mFile.fail( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneBinReader::ReadString( std::string &str )
+{
+    size_t length = 0;
+    if ( !ReadSize( length ) || length > kMaxStringLength )
+        return false;
+
+    str.resize( length );
+    if ( length )
+        mFile.read( &str[0], length );
+    return !mFile.fail( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SceneBinWriter::~SceneBinWriter( )
+{
+    // unfinished save doesn't replace anything
+    if ( mFile.is_open( ) )
+    {
+        mFile.close( );
+        std::remove( ( mFileName + ".tmp" ).c_str( ) );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneBinWriter::Open( const char *fn, const std::vector<std::string> &materialLibs )
+{
+    if ( mFile.is_open( ) )
+        return false;
+
+    mFileName = fn;
+    mFile.clear( );
+    mFile.open( ( mFileName + ".tmp" ).c_str( ), std::ofstream::binary | std::ofstream::trunc );
+    if ( mFile.fail( ) )
+        return false;
+
+    WriteSize( materialLibs.size( ) );
+    for ( auto &lib : materialLibs )
+        WriteString( lib );
+
+    mObjectCount = 0;
+    mObjectCountPos = mFile.tellp( );
+    WriteSize( 0 );
+
+    return !mFile.fail( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneBinWriter::IsOpen( ) const
+{
+    return mFile.is_open( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneBinWriter::WriteObject( const std::string &name, const std::string &material, const SceneVertex *vertices, size_t vertexCount,
+    const uint32_t *indices, size_t indexCount )
+{
+    if ( !mFile.is_open( ) )
+        return false;
+
+    WriteString( name );
+    WriteString( material );
+    WriteSize( vertexCount );
+    mFile.write( reinterpret_cast< const char* >( vertices ), vertexCount * sizeof( SceneVertex ) );
+    WriteSize( indexCount );
+    mFile.write( reinterpret_cast< const char* >( indices ), indexCount * sizeof( uint32_t ) );
+
+    mObjectCount++;
+    return !mFile.fail( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::ostream& SceneBinWriter::GetStream( )
+{
+    return mFile;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneBinWriter::Close( )
+{
+    if ( !mFile.is_open( ) )
+        return false;
+
+    mFile.seekp( mObjectCountPos );
+    WriteSize( mObjectCount );
+    bool written = !mFile.fail( );
+    mFile.close( );
+
+    // rename doesn't replace existing files on windows
+    std::string tmpName = mFileName + ".tmp";
+    if ( !written )
+    {
+        std::remove( tmpName.c_str( ) );
+        return false;
+    }
+    std::remove( mFileName.c_str( ) );
+    return std::rename( tmpName.c_str( ), mFileName.c_str( ) ) == 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBinWriter::WriteSize( size_t size )
+{
+    mFile.write( reinterpret_cast< const char* >( &size ), sizeof( size_t ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneBinWriter::WriteString( const std::string &str )
+{
+    WriteSize( str.length( ) );
+    mFile.write( str.c_str( ), str.length( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t GetCurrentRSS( )
+{
+#if defined( _WIN32 )
+    PROCESS_MEMORY_COUNTERS counters;
+    if ( !GetProcessMemoryInfo( GetCurrentProcess( ), &counters, sizeof( counters ) ) )
+        return 0;
+    return counters.WorkingSetSize;
+#elif defined( __linux__ )
+    long pages = 0, residentPages = 0;
+    FILE *statm = fopen( "/proc/self/statm", "r" );
+    if ( !statm )
+        return 0;
+    int read = fscanf( statm, "%ld %ld", &pages, &residentPages );
+    fclose( statm );
+    return read == 2 ? static_cast< size_t >( residentPages ) * static_cast< size_t >( sysconf( _SC_PAGESIZE ) ) : 0;
+#else
+    return 0;
+#endif
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t GetPeakRSS( )
+{
+#if defined( _WIN32 )
+    PROCESS_MEMORY_COUNTERS counters;
+    if ( !GetProcessMemoryInfo( GetCurrentProcess( ), &counters, sizeof( counters ) ) )
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+        return 0;
+#if defined( __APPLE__ )
+    return static_cast< size_t >( usage.ru_maxrss );
+#else
+    return static_cast< size_t >( usage.ru_maxrss ) * 1024; // kilobytes
+#endif
+#endif
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SceneStreamBenchmarkResult RunSceneStreamBenchmark( const char *fn, uint64_t bytes, size_t objectVertices )
+{
+    typedef std::chrono::steady_clock Clock;
+    SceneStreamBenchmarkResult result;
+
+    size_t side = ( std::max )( static_cast< size_t >( std::sqrt( static_cast< double >( objectVertices ) ) ), size_t( 2 ) );
+    size_t trianglesPerObject = 2 * ( side - 1 ) * ( side - 1 );
+    uint64_t objectBytes = side * side * sizeof( SceneVertex ) + trianglesPerObject * 3 * sizeof( uint32_t );
+    size_t objects = static_cast< size_t >( ( std::max )( bytes / objectBytes, uint64_t( 1 ) ) );
+
+    // write: generate into reused buffers
+    SceneDigest written;
+    SceneBinObject object;
+    std::vector<std::string> libs( 1, "synthetic.mtl" );
+    SceneBinWriter writer;
+    Clock::time_point start = Clock::now( );
+    if ( !writer.Open( fn, libs ) )
+        return result;
+
+    for ( size_t i = 0; i < objects; i++ )
+    {
+        GenerateSyntheticObject( i, side, object.mVertices, object.mIndices );
+        written.Add( object.mVertices.data( ), object.mVertices.size( ), object.mIndices.data( ), object.mIndices.size( ) );
+        if ( !writer.WriteObject( "tile" + std::to_string( i ), "terrain", object.mVertices.data( ), object.mVertices.size( ),
+            object.mIndices.data( ), object.mIndices.size( ) ) )
+            return result;
+    }
+    if ( !writer.Close( ) )
+        return result;
+    double writeTime = std::chrono::duration<double>( Clock::now( ) - start ).count( );
+
+    // read back one object at a time
+    SceneDigest read;
+    SceneBinReader reader;
+    std::string error;
+    start = Clock::now( );
+    bool opened = reader.Open( fn, error );
+    while ( opened && reader.ReadObject( object, error ) )
+    {
+        read.Add( object.mVertices.data( ), object.mVertices.size( ), object.mIndices.data( ), object.mIndices.size( ) );
+        result.mTriangles += object.mIndices.size( ) / 3;
+        result.mLargestObject = ( std::max )( result.mLargestObject,
+            object.mVertices.capacity( ) * sizeof( SceneVertex ) + object.mIndices.capacity( ) * sizeof( uint32_t ) );
+    }
+    double readTime = std::chrono::duration<double>( Clock::now( ) - start ).count( );
+
+    result.mObjects = reader.GetObjectsRead( );
+    result.mMatches = opened && error.empty( ) && result.mObjects == objects && read == written;
+    reader.Close( );
+
+    std::ifstream file( fn, std::ifstream::binary | std::ifstream::ate );
+    result.mBytes = static_cast< uint64_t >( file.tellg( ) );
+    file.close( );
+    std::remove( fn );
+
+    result.mWriteMBs = writeTime > 0.0 ? result.mBytes * 1e-6 / writeTime : 0.0;
+    result.mReadMBs = readTime > 0.0 ? result.mBytes * 1e-6 / readTime : 0.0;
+    result.mPeakRSS = GetPeakRSS( );
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
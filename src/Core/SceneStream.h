@@ -0,0 +1,109 @@
+#ifndef __SCENE_STREAM_H
+#define __SCENE_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// vertex of the scene bin, same layout as Vertex3F3F3F2F
+struct SceneVertex
+{
+    float mPosition[3];
+    float mNormal[3];
+    float mBinormal[3];
+    float mUV[2];
+};
+
+// one object of the scene bin, buffers are reused from object to object
+struct SceneBinObject
+{
+    std::string mName;
+    std::string mMaterial;
+    std::vector<SceneVertex> mVertices;
+    std::vector<uint32_t> mIndices;
+};
+
+// scene bin layout, sizes are size_t of the build:
+// | material lib count | material libs | object count | objects | optional trailer (bvh) |
+// object: | name | material | vertex count | vertices | index count | indices |
+// string: | length | chars |
+//
+// reads one object at a time, so memory is bounded by the largest object instead of the scene
+class SceneBinReader
+{
+public:
+    bool Open( const char *fn, std::string &error );
+    void Close( );
+
+    const std::vector<std::string>& GetMaterialLibs( ) const;
+    size_t GetObjectCount( ) const;
+    size_t GetObjectsRead( ) const;
+
+    // false when all objects are read or on error
+    bool ReadObject( SceneBinObject &object, std::string &error );
+
+    // positioned after the last object once all of them are read
+    std::istream& GetStream( );
+
+private:
+    bool ReadSize( size_t &size );
+    bool ReadString( std::string &str );
+
+    std::ifstream mFile;
+    uint64_t mFileSize = 0;
+    std::vector<std::string> mMaterialLibs;
+    size_t mObjectCount = 0;
+    size_t mObjectsRead = 0;
+};
+
+// writes objects as they come into fn.tmp, Close patches object count and replaces fn,
+// so a scene can be saved while it is streamed from the same file
+class SceneBinWriter
+{
+public:
+    ~SceneBinWriter( );
+
+    bool Open( const char *fn, const std::vector<std::string> &materialLibs );
+    bool IsOpen( ) const;
+    bool WriteObject( const std::string &name, const std::string &material, const SceneVertex *vertices, size_t vertexCount,
+        const uint32_t *indices, size_t indexCount );
+
+    // for the trailer, after the last object
+    std::ostream& GetStream( );
+    bool Close( );
+
+private:
+    void WriteSize( size_t size );
+    void WriteString( const std::string &str );
+
+    std::ofstream mFile;
+    std::string mFileName;
+    std::streampos mObjectCountPos;
+    size_t mObjectCount = 0;
+};
+
+// resident set size of the process in bytes, 0 if unknown on the platform
+size_t GetCurrentRSS( );
+size_t GetPeakRSS( );
+
+// height field patch of side x side vertices, every object is a different tile of the same terrain
+void GenerateSyntheticObject( size_t object, size_t side, std::vector<SceneVertex> &vertices, std::vector<uint32_t> &indices );
+
+struct SceneStreamBenchmarkResult
+{
+    uint64_t mBytes = 0; // scene file size
+    size_t mObjects = 0;
+    uint64_t mTriangles = 0;
+    double mWriteMBs = 0.0;
+    double mReadMBs = 0.0;
+    size_t mPeakRSS = 0; // bytes, for the whole process
+    size_t mLargestObject = 0; // bytes of the biggest object buffers
+    bool mMatches = false; // checksum and bounds of read objects equal written ones
+};
+
+// writes a synthetic scene of about bytes to fn object by object and streams it back, fn is removed afterwards
+SceneStreamBenchmarkResult RunSceneStreamBenchmark( const char *fn, uint64_t bytes, size_t objectVertices );
+
+#endif
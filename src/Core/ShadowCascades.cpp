@@ -0,0 +1,299 @@
+#include <Core/ShadowCascades.h>
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+namespace
+{
+    float Dot( const float a[3], const float b[3] )
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    void Cross( const float a[3], const float b[3], float out[3] )
+    {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    void Normalize( float v[3] )
+    {
+        float len = std::sqrt( Dot( v, v ) );
+        if ( len > 0.0f )
+        {
+            v[0] /= len;
+            v[1] /= len;
+            v[2] /= len;
+        }
+    }
+
+    void Multiply( const float a[16], const float b[16], float out[16] )
+    {
+        for ( int r = 0; r < 4; r++ )
+        {
+            for ( int c = 0; c < 4; c++ )
+            {
+                out[r * 4 + c] = a[r * 4 + 0] * b[0 * 4 + c] + a[r * 4 + 1] * b[1 * 4 + c] +
+                    a[r * 4 + 2] * b[2 * 4 + c] + a[r * 4 + 3] * b[3 * 4 + c];
+            }
+        }
+    }
+
+    void GetBoxCorner( const float bMin[3], const float bMax[3], int i, float out[3] )
+    {
+        out[0] = ( i & 1 ) ? bMax[0] : bMin[0];
+        out[1] = ( i & 2 ) ? bMax[1] : bMin[1];
+        out[2] = ( i & 4 ) ? bMax[2] : bMin[2];
+    }
+
+    // camera position and axes from a row-major world to view matrix (right handed, looks along -z)
+    void ExtractCamera( const float view[16], float eye[3], float right[3], float up[3], float forward[3] )
+    {
+        for ( int i = 0; i < 3; i++ )
+        {
+            right[i] = view[i * 4 + 0];
+            up[i] = view[i * 4 + 1];
+            forward[i] = -view[i * 4 + 2];
+        }
+
+        const float *t = &view[12];
+        for ( int i = 0; i < 3; i++ )
+            eye[i] = -( t[0] * right[i] + t[1] * up[i] - t[2] * forward[i] );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ShadowLightInput::operator==( const ShadowLightInput &r ) const
+{
+    return memcmp( mDirection, r.mDirection, sizeof( mDirection ) ) == 0 &&
+        memcmp( mSceneMin, r.mSceneMin, sizeof( mSceneMin ) ) == 0 &&
+        memcmp( mSceneMax, r.mSceneMax, sizeof( mSceneMax ) ) == 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ShadowLightInput::operator!=( const ShadowLightInput &r ) const
+{
+    return !( *this == r );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ComputeCascadeSplits( float nearZ, float farZ, int count, float lambda, float *splits )
+{
+    splits[0] = nearZ;
+    for ( int i = 1; i < count; i++ )
+    {
+        float part = static_cast< float >( i ) / count;
+        float logSplit = nearZ * std::pow( farZ / nearZ, part );
+        float uniformSplit = nearZ + ( farZ - nearZ ) * part;
+        splits[i] = lambda * logSplit + ( 1.0f - lambda ) * uniformSplit;
+    }
+    splits[count] = farZ;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ShadowCascades::Update( const float cameraView[16], const float cameraProj[16], const ShadowLightInput &light,
+    const ShadowCascadeParams &params )
+{
+    ShadowCascadeParams p = params;
+    p.mCount = std::max( 1, std::min( p.mCount, MAX_SHADOW_CASCADES ) );
+    p.mNear = std::max( p.mNear, 1e-3f );
+    p.mFar = std::max( p.mFar, p.mNear * 1.01f );
+
+    if ( !mHasLight || mLight != light || mParams.mCount != p.mCount || mParams.mResolution != p.mResolution )
+    {
+        mLight = light;
+        mHasLight = true;
+        Invalidate( );
+
+        // light space basis like a right handed look-to view, up is switched for vertical light
+        memcpy( mLightDir, light.mDirection, sizeof( mLightDir ) );
+        Normalize( mLightDir );
+        float back[3] = { -mLightDir[0], -mLightDir[1], -mLightDir[2] };
+        float worldUp[3] = { 0.0f, 1.0f, 0.0f };
+        if ( std::fabs( mLightDir[1] ) > 0.99f )
+        {
+            worldUp[1] = 0.0f;
+            worldUp[2] = 1.0f;
+        }
+        Cross( worldUp, back, mLightRight );
+        Normalize( mLightRight );
+        Cross( back, mLightRight, mLightUp );
+
+        // depth range of the whole scene, so casters outside of a camera slice still land in the map
+        mDepthMin = 1e30f;
+        mDepthMax = -1e30f;
+        for ( int i = 0; i < 8; i++ )
+        {
+            float corner[3];
+            GetBoxCorner( light.mSceneMin, light.mSceneMax, i, corner );
+            float d = Dot( corner, mLightDir );
+            mDepthMin = std::min( mDepthMin, d );
+            mDepthMax = std::max( mDepthMax, d );
+        }
+        float pad = std::max( ( mDepthMax - mDepthMin ) * 0.01f, 1.0f );
+        mDepthMin -= pad;
+        mDepthMax += pad;
+
+        FitSceneCascade( p.mResolution );
+    }
+    mParams = p;
+
+    float eye[3], right[3], up[3], forward[3];
+    ExtractCamera( cameraView, eye, right, up, forward );
+
+    // squared tangent of the half diagonal fov, proj[0] and proj[5] are cot of half fovs
+    float tanX = cameraProj[0] != 0.0f ? 1.0f / cameraProj[0] : 1.0f;
+    float tanY = cameraProj[5] != 0.0f ? 1.0f / cameraProj[5] : 1.0f;
+    float k = tanX * tanX + tanY * tanY;
+
+    float splits[MAX_SHADOW_CASCADES + 1];
+    ComputeCascadeSplits( p.mNear, p.mFar, p.mCount, p.mLambda, splits );
+
+    for ( int i = 0; i < p.mCount; i++ )
+    {
+        float n = splits[i], f = splits[i + 1];
+
+        // smallest sphere around the slice with center on the view axis, it doesn't depend on camera rotation
+        float d = std::min( ( n + f ) * ( 1.0f + k ) * 0.5f, f );
+        float radius = std::max( std::sqrt( ( d - n ) * ( d - n ) + k * n * n ), std::sqrt( ( f - d ) * ( f - d ) + k * f * f ) );
+        radius = std::ceil( radius * 16.0f ) / 16.0f; // kill float noise between frames
+
+        float center[3];
+        for ( int c = 0; c < 3; c++ )
+            center[c] = eye[c] + forward[c] * d;
+
+        ShadowCascade &cascade = mCascades[i];
+        cascade.mSplitNear = n;
+        cascade.mSplitFar = f;
+        FitCascade( cascade, center, radius, p );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ShadowCascades::FitCascade( ShadowCascade &cascade, const float center[3], float sphereRadius, const ShadowCascadeParams &params )
+{
+    float radius = sphereRadius * ( 1.0f + std::max( params.mGuardBand, 0.0f ) );
+    float texel = 2.0f * radius / params.mResolution;
+    float lightCenter[2] = { Dot( center, mLightRight ), Dot( center, mLightUp ) };
+
+    // keep cached placement while the slice sphere stays inside the box
+    if ( cascade.mValid && cascade.mRadius == radius )
+    {
+        bool inside = true;
+        for ( int a = 0; a < 2; a++ )
+            inside &= std::fabs( lightCenter[a] - cascade.mCenter[a] ) + sphereRadius <= radius;
+
+        if ( inside )
+            return;
+    }
+
+    // snap to texels so the rasterized depth doesn't shimmer when the cascade moves
+    for ( int a = 0; a < 2; a++ )
+        cascade.mCenter[a] = std::floor( lightCenter[a] / texel + 0.5f ) * texel;
+    cascade.mRadius = radius;
+    cascade.mTexelSize = texel;
+    cascade.mValid = true;
+    cascade.mDirty = true;
+
+    BuildMatrices( cascade );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ShadowCascades::FitSceneCascade( int resolution )
+{
+    // light space rectangle of the scene box, square to keep texels square
+    float lMin[2] = { 1e30f, 1e30f }, lMax[2] = { -1e30f, -1e30f };
+    for ( int i = 0; i < 8; i++ )
+    {
+        float corner[3];
+        GetBoxCorner( mLight.mSceneMin, mLight.mSceneMax, i, corner );
+        float l[2] = { Dot( corner, mLightRight ), Dot( corner, mLightUp ) };
+        for ( int a = 0; a < 2; a++ )
+        {
+            lMin[a] = std::min( lMin[a], l[a] );
+            lMax[a] = std::max( lMax[a], l[a] );
+        }
+    }
+
+    ShadowCascade &cascade = mSceneCascade;
+    cascade.mRadius = std::max( std::max( lMax[0] - lMin[0], lMax[1] - lMin[1] ) * 0.5f, 1e-3f );
+    cascade.mTexelSize = 2.0f * cascade.mRadius / std::max( resolution, 1 );
+    for ( int a = 0; a < 2; a++ )
+        cascade.mCenter[a] = ( lMin[a] + lMax[a] ) * 0.5f;
+    cascade.mSplitNear = 0.0f;
+    cascade.mSplitFar = 1e30f;
+    cascade.mValid = true;
+    cascade.mDirty = true;
+
+    BuildMatrices( cascade );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ShadowCascades::BuildMatrices( ShadowCascade &cascade )
+{
+    // look-to view from the center of the box near plane
+    float back[3] = { -mLightDir[0], -mLightDir[1], -mLightDir[2] };
+    float eye[3];
+    for ( int c = 0; c < 3; c++ )
+        eye[c] = cascade.mCenter[0] * mLightRight[c] + cascade.mCenter[1] * mLightUp[c] + mDepthMin * mLightDir[c];
+
+    float *v = cascade.mView;
+    for ( int r = 0; r < 3; r++ )
+    {
+        v[r * 4 + 0] = mLightRight[r];
+        v[r * 4 + 1] = mLightUp[r];
+        v[r * 4 + 2] = back[r];
+        v[r * 4 + 3] = 0.0f;
+    }
+    v[12] = -Dot( mLightRight, eye );
+    v[13] = -Dot( mLightUp, eye );
+    v[14] = -Dot( back, eye );
+    v[15] = 1.0f;
+
+    // right handed ortho, width = height = 2 * radius, near 0
+    float depthRange = mDepthMax - mDepthMin;
+    float *p = cascade.mProj;
+    memset( p, 0, sizeof( cascade.mProj ) );
+    p[0] = 1.0f / cascade.mRadius;
+    p[5] = 1.0f / cascade.mRadius;
+    p[10] = -1.0f / depthRange;
+    p[15] = 1.0f;
+
+    Multiply( cascade.mView, cascade.mProj, cascade.mViewProj );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ShadowCascades::Invalidate( )
+{
+    for ( int i = 0; i < MAX_SHADOW_CASCADES; i++ )
+    {
+        mCascades[i].mValid = false;
+        mCascades[i].mDirty = true;
+    }
+    mSceneCascade.mDirty = true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ShadowCascades::ClearDirty( )
+{
+    for ( int i = 0; i < MAX_SHADOW_CASCADES; i++ )
+        mCascades[i].mDirty = false;
+    mSceneCascade.mDirty = false;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int ShadowCascades::GetCount( ) const
+{
+    return mParams.mCount;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int ShadowCascades::GetDirtyCount( ) const
+{
+    int count = mSceneCascade.mDirty ? 1 : 0;
+    for ( int i = 0; i < mParams.mCount; i++ )
+        count += mCascades[i].mDirty ? 1 : 0;
+    return count;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const ShadowCascade& ShadowCascades::GetCascade( int i ) const
+{
+    return mCascades[i];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const ShadowCascade& ShadowCascades::GetSceneCascade( ) const
+{
+    return mSceneCascade;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
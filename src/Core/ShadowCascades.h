@@ -0,0 +1,84 @@
+#ifndef __SHADOW_CASCADES_H
+#define __SHADOW_CASCADES_H
+
+#include <stddef.h>
+
+// must match define in gbuffer.fx
+#define MAX_SHADOW_CASCADES 4
+
+struct ShadowCascadeParams
+{
+    int mCount = 4;
+    int mResolution = 2048; // per cascade
+    float mNear = 1.0f; // camera view depth range split between cascades
+    float mFar = 3000.0f;
+    float mLambda = 0.75f; // 0 - uniform splits, 1 - logarithmic
+    float mGuardBand = 0.2f; // extra radius part, cascade moves only when its slice leaves this band
+};
+
+// everything shadow map depth depends on, any change invalidates all cached maps
+struct ShadowLightInput
+{
+    float mDirection[3]; // from light to scene
+    float mSceneMin[3];
+    float mSceneMax[3];
+
+    bool operator==( const ShadowLightInput &r ) const;
+    bool operator!=( const ShadowLightInput &r ) const;
+};
+
+// row-major matrices for row vectors (DirectXMath convention), right handed ortho, clip z in [0, 1]
+struct ShadowCascade
+{
+    float mView[16];
+    float mProj[16];
+    float mViewProj[16];
+
+    float mSplitNear = 0.0f; // camera view depth range covered by the cascade
+    float mSplitFar = 0.0f;
+    float mCenter[2]; // light space, snapped to texels
+    float mRadius = 0.0f; // half size of the ortho box
+    float mTexelSize = 0.0f;
+
+    bool mValid = false;
+    bool mDirty = true; // depth has to be redrawn
+};
+
+// view depth of cascade borders, splits has count + 1 values, practical split scheme
+void ComputeCascadeSplits( float nearZ, float farZ, int count, float lambda, float *splits );
+
+// camera fitted cascades and a stable whole scene cascade with redraw tracking
+// cascades are fitted to rotation invariant bounding spheres of the view frustum slices and snapped
+// to shadow map texels, so camera rotation and small moves neither change nor shimmer them
+class ShadowCascades
+{
+public:
+    // camera matrices are row-major for row vectors, proj is a symmetric perspective projection
+    void Update( const float cameraView[16], const float cameraProj[16], const ShadowLightInput &light,
+        const ShadowCascadeParams &params );
+
+    void Invalidate( );
+    void ClearDirty( ); // call after dirty maps were redrawn
+
+    int GetCount( ) const;
+    int GetDirtyCount( ) const; // including scene cascade
+    const ShadowCascade& GetCascade( int i ) const;
+    const ShadowCascade& GetSceneCascade( ) const;
+
+private:
+    void FitCascade( ShadowCascade &cascade, const float center[3], float sphereRadius, const ShadowCascadeParams &params );
+    void FitSceneCascade( int resolution );
+    void BuildMatrices( ShadowCascade &cascade );
+
+    ShadowCascade mCascades[MAX_SHADOW_CASCADES];
+    ShadowCascade mSceneCascade;
+    ShadowCascadeParams mParams;
+    ShadowLightInput mLight;
+    bool mHasLight = false;
+
+    // light space basis and scene depth range along light direction
+    float mLightRight[3], mLightUp[3], mLightDir[3];
+    float mDepthMin = 0.0f, mDepthMax = 1.0f;
+};
+
+#endif
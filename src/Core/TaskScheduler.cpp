@@ -0,0 +1,552 @@
+#include <Core/TaskScheduler.h>
+#include <GlobalUtils.h>
+#include <chrono>
+#include <cmath>
+
+// vs2013 has no thread_local, pointers are fine with __declspec( thread )
+#if defined( _MSC_VER ) && _MSC_VER < 1900
+#define TASK_THREAD_LOCAL __declspec( thread )
+#else
+#define TASK_THREAD_LOCAL thread_local
+#endif
+
+struct Task
+{
+    std::function<void( )> mWork;
+    std::atomic<int> mPending; // unfinished dependencies, plus one while the task is being submitted
+    std::atomic<bool> mDone;
+
+    std::mutex mLock;
+    bool mFinished; // mDone under mLock, decides if a new successor has to wait
+    std::vector<TaskHandle> mSuccessors;
+    TaskHandle mSelf; // keeps the task alive while it's queued
+
+    Task( ) : mPending( 0 ), mDone( false ), mFinished( false ) {}
+};
+
+struct TaskWorker
+{
+    TaskScheduler *mScheduler;
+    TaskDeque mDeque;
+    uint32_t mRandom; // victim selection
+    std::atomic<uint64_t> mExecuted;
+    std::atomic<uint64_t> mStolen;
+    std::atomic<uint64_t> mSleeps;
+
+    TaskWorker( TaskScheduler *scheduler, uint32_t seed ) :
+        mScheduler( scheduler ), mRandom( seed | 1 ), mExecuted( 0 ), mStolen( 0 ), mSleeps( 0 ) {}
+};
+
+namespace
+{
+    TASK_THREAD_LOCAL TaskWorker *tlsWorker = nullptr;
+
+    // worker loop spins this many times over all deques before it sleeps
+    const int IDLE_SPINS = 64;
+
+    uint32_t NextRandom( uint32_t &state )
+    {
+        // xorshift32
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+}
+
+struct TaskDeque::Ring
+{
+    int64_t mMask;
+    std::unique_ptr<std::atomic<Task*>[]> mItems;
+
+    explicit Ring( int64_t capacity ) : mMask( capacity - 1 ), mItems( new std::atomic<Task*>[static_cast< size_t >( capacity )] ) {}
+
+    Task* Get( int64_t i ) const { return mItems[static_cast< size_t >( i & mMask )].load( std::memory_order_relaxed ); }
+    void Put( int64_t i, Task *task ) { mItems[static_cast< size_t >( i & mMask )].store( task, std::memory_order_relaxed ); }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskDeque::TaskDeque( size_t capacity ) :
+    mTop( 0 ),
+    mBottom( 0 )
+{
+    int64_t pow2 = 2;
+    while ( pow2 < static_cast< int64_t >( capacity ) )
+        pow2 <<= 1;
+
+    Ring *ring = new Ring( pow2 );
+    mRings.push_back( ring );
+    mRing.store( ring, std::memory_order_relaxed );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskDeque::~TaskDeque( )
+{
+    for ( Ring *ring : mRings )
+        delete ring;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskDeque::Push( Task *task )
+{
+    int64_t b = mBottom.load( std::memory_order_relaxed );
+    int64_t t = mTop.load( std::memory_order_acquire );
+    Ring *ring = mRing.load( std::memory_order_relaxed );
+    if ( b - t > ring->mMask )
+    {
+        // full, items move to a twice bigger ring at the same positions
+        Ring *bigger = new Ring( ( ring->mMask + 1 ) * 2 );
+        for ( int64_t i = t; i < b; i++ )
+            bigger->Put( i, ring->Get( i ) );
+        mRings.push_back( bigger );
+        mRing.store( bigger, std::memory_order_release );
+        ring = bigger;
+    }
+
+    ring->Put( b, task );
+    mBottom.store( b + 1, std::memory_order_release ); // instead of release fence + relaxed store, sanitizers see it
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Task* TaskDeque::Pop( )
+{
+    int64_t b = mBottom.load( std::memory_order_relaxed ) - 1;
+    Ring *ring = mRing.load( std::memory_order_relaxed );
+    mBottom.store( b, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    int64_t t = mTop.load( std::memory_order_relaxed );
+
+    if ( t > b )
+    {
+        // empty
+        mBottom.store( b + 1, std::memory_order_relaxed );
+        return nullptr;
+    }
+
+    Task *task = ring->Get( b );
+    if ( t == b )
+    {
+        // last item, thieves may want it too
+        if ( !mTop.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+            task = nullptr;
+        mBottom.store( b + 1, std::memory_order_relaxed );
+    }
+    return task;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Task* TaskDeque::Steal( )
+{
+    int64_t t = mTop.load( std::memory_order_acquire );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    int64_t b = mBottom.load( std::memory_order_acquire );
+    if ( t >= b )
+        return nullptr;
+
+    Ring *ring = mRing.load( std::memory_order_acquire );
+    Task *task = ring->Get( t );
+    if ( !mTop.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+        return nullptr;
+    return task;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t TaskDeque::GetSize( ) const
+{
+    int64_t b = mBottom.load( std::memory_order_relaxed );
+    int64_t t = mTop.load( std::memory_order_relaxed );
+    return b > t ? static_cast< size_t >( b - t ) : 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskScheduler::TaskScheduler( size_t workers ) :
+    mOwnerThread( std::this_thread::get_id( ) ),
+    mInjectedCount( 0 ),
+    mWorkEpoch( 0 ),
+    mSleeping( 0 ),
+    mStop( false )
+{
+    StartWorkers( workers );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskScheduler::~TaskScheduler( )
+{
+    StopWorkers( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t TaskScheduler::GetDefaultWorkerCount( )
+{
+    unsigned int hardware = std::thread::hardware_concurrency( );
+    return hardware > 1 ? hardware - 1 : 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskScheduler& TaskScheduler::Get( )
+{
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskScheduler::StartWorkers( size_t workers )
+{
+    mWorkers.clear( );
+    for ( size_t i = 0; i <= workers; i++ )
+        mWorkers.push_back( std::unique_ptr<TaskWorker>( new TaskWorker( this, static_cast< uint32_t >( 2654435761u * ( i + 1 ) ) ) ) );
+
+    for ( size_t i = 1; i <= workers; i++ )
+        mThreads.push_back( std::thread( &TaskScheduler::WorkerLoop, this, mWorkers[i].get( ) ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskScheduler::StopWorkers( )
+{
+    {
+        std::lock_guard<std::mutex> lock( mSleepLock );
+        mStop.store( true );
+        mWake.notify_all( );
+    }
+    for ( auto &thread : mThreads )
+        thread.join( );
+    mThreads.clear( );
+    mStop.store( false );
+
+    for ( auto &worker : mWorkers )
+        ASSERT( worker->mDeque.GetSize( ) == 0, "tasks are lost on stop" );
+    ASSERT( mInjected.empty( ), "tasks are lost on stop" );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskScheduler::SetWorkerCount( size_t workers )
+{
+    ASSERT( std::this_thread::get_id( ) == mOwnerThread );
+    StopWorkers( );
+    StartWorkers( workers );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t TaskScheduler::GetWorkerCount( ) const
+{
+    return mThreads.size( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t TaskScheduler::GetThreadCount( ) const
+{
+    return mThreads.size( ) + 1;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskWorker* TaskScheduler::GetCurrentWorker( )
+{
+    if ( tlsWorker && tlsWorker->mScheduler == this )
+        return tlsWorker;
+    if ( std::this_thread::get_id( ) == mOwnerThread )
+        return mWorkers[0].get( );
+    return nullptr;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskScheduler::WorkerLoop( TaskWorker *worker )
+{
+    tlsWorker = worker;
+    while ( !mStop.load( ) )
+    {
+        if ( RunOneTask( worker ) )
+            continue;
+
+        // epoch is read before the last look, a push after it wakes the worker up
+        uint64_t epoch = mWorkEpoch.load( );
+        bool found = false;
+        for ( int spin = 0; spin < IDLE_SPINS && !found; spin++ )
+        {
+            std::this_thread::yield( );
+            found = RunOneTask( worker );
+        }
+        if ( found )
+            continue;
+
+        std::unique_lock<std::mutex> lock( mSleepLock );
+        mSleeping++;
+        worker->mSleeps.fetch_add( 1, std::memory_order_relaxed );
+        mWake.wait( lock, [&]( ) { return mStop.load( ) || mWorkEpoch.load( ) != epoch; } );
+        mSleeping--;
+    }
+    tlsWorker = nullptr;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskScheduler::Schedule( Task *task )
+{
+    TaskWorker *worker = GetCurrentWorker( );
+    if ( worker )
+    {
+        worker->mDeque.Push( task );
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock( mInjectLock );
+        mInjected.push_back( task );
+        mInjectedCount++;
+    }
+
+    mWorkEpoch.fetch_add( 1 );
+    if ( mSleeping.load( ) > 0 )
+    {
+        std::lock_guard<std::mutex> lock( mSleepLock );
+        mWake.notify_one( );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Task* TaskScheduler::FindTask( TaskWorker *worker )
+{
+    // own work first (newest, cache warm), then foreign threads, then the oldest work of others
+    if ( worker )
+    {
+        if ( Task *task = worker->mDeque.Pop( ) )
+            return task;
+    }
+
+    if ( mInjectedCount.load( ) > 0 )
+    {
+        std::lock_guard<std::mutex> lock( mInjectLock );
+        if ( !mInjected.empty( ) )
+        {
+            Task *task = mInjected.front( );
+            mInjected.pop_front( );
+            mInjectedCount--;
+            return task;
+        }
+    }
+
+    size_t count = mWorkers.size( );
+    uint32_t start = worker ? NextRandom( worker->mRandom ) : 0;
+    for ( size_t i = 0; i < count; i++ )
+    {
+        TaskWorker *victim = mWorkers[( start + i ) % count].get( );
+        if ( victim == worker )
+            continue;
+
+        if ( Task *task = victim->mDeque.Steal( ) )
+        {
+            if ( worker )
+                worker->mStolen.fetch_add( 1, std::memory_order_relaxed );
+            return task;
+        }
+    }
+    return nullptr;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TaskScheduler::RunOneTask( TaskWorker *worker )
+{
+    Task *task = FindTask( worker );
+    if ( !task )
+        return false;
+
+    Execute( task, worker );
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskScheduler::Execute( Task *task, TaskWorker *worker )
+{
+    // the queue reference goes away with this function
+    TaskHandle self;
+    self.swap( task->mSelf );
+
+    task->mWork( );
+    task->mWork = nullptr;
+
+    std::vector<TaskHandle> successors;
+    {
+        std::lock_guard<std::mutex> lock( task->mLock );
+        task->mFinished = true;
+        successors.swap( task->mSuccessors );
+    }
+    task->mDone.store( true, std::memory_order_release );
+
+    for ( auto &successor : successors )
+    {
+        if ( successor->mPending.fetch_sub( 1 ) == 1 )
+            Schedule( successor.get( ) );
+    }
+
+    if ( worker )
+        worker->mExecuted.fetch_add( 1, std::memory_order_relaxed );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskHandle TaskScheduler::Run( std::function<void( )> work )
+{
+    return Run( std::move( work ), std::vector<TaskHandle>( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskHandle TaskScheduler::Run( std::function<void( )> work, const std::vector<TaskHandle> &dependencies )
+{
+    TaskHandle task = std::make_shared<Task>( );
+    task->mWork = std::move( work );
+    task->mSelf = task;
+    task->mPending.store( static_cast< int >( dependencies.size( ) ) + 1 );
+
+    for ( auto &dependency : dependencies )
+    {
+        if ( dependency )
+        {
+            std::lock_guard<std::mutex> lock( dependency->mLock );
+            if ( !dependency->mFinished )
+            {
+                dependency->mSuccessors.push_back( task );
+                continue;
+            }
+        }
+        task->mPending.fetch_sub( 1 );
+    }
+
+    if ( task->mPending.fetch_sub( 1 ) == 1 )
+        Schedule( task.get( ) );
+    return task;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TaskScheduler::IsDone( const TaskHandle &task ) const
+{
+    return !task || task->mDone.load( std::memory_order_acquire );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskScheduler::Wait( const TaskHandle &task )
+{
+    // help while waiting: the owner thread has no other way to get its own deque executed without workers
+    TaskWorker *worker = GetCurrentWorker( );
+    while ( !IsDone( task ) )
+    {
+        if ( !RunOneTask( worker ) )
+            std::this_thread::yield( );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskScheduler::Wait( const std::vector<TaskHandle> &tasks )
+{
+    for ( auto &task : tasks )
+        Wait( task );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskScheduler::ParallelFor( size_t begin, size_t end, size_t grain, const std::function<void( size_t first, size_t last )> &body )
+{
+    if ( end <= begin )
+        return;
+
+    grain = ( std::max )( grain, size_t( 1 ) );
+    size_t ranges = ( end - begin + grain - 1 ) / grain;
+    size_t helpers = ( std::min )( ranges, GetThreadCount( ) ) - 1;
+    if ( helpers == 0 )
+    {
+        body( begin, end );
+        return;
+    }
+
+    // ranges are handed out by a counter, so a slow range doesn't hold a fixed share of the others
+    std::atomic<size_t> next( 0 );
+    auto drain = [&]( )
+    {
+        size_t r;
+        while ( ( r = next.fetch_add( 1 ) ) < ranges )
+        {
+            size_t first = begin + r * grain;
+            body( first, ( std::min )( end, first + grain ) );
+        }
+    };
+
+    std::vector<TaskHandle> tasks;
+    for ( size_t i = 0; i < helpers; i++ )
+        tasks.push_back( Run( drain ) );
+    drain( );
+    Wait( tasks );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskSchedulerStats TaskScheduler::GetStats( ) const
+{
+    TaskSchedulerStats stats;
+    for ( auto &worker : mWorkers )
+    {
+        stats.mExecuted += worker->mExecuted.load( std::memory_order_relaxed );
+        stats.mStolen += worker->mStolen.load( std::memory_order_relaxed );
+        stats.mSleeps += worker->mSleeps.load( std::memory_order_relaxed );
+    }
+    return stats;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskScheduler::ResetStats( )
+{
+    for ( auto &worker : mWorkers )
+    {
+        worker->mExecuted.store( 0 );
+        worker->mStolen.store( 0 );
+        worker->mSleeps.store( 0 );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskSchedulerBenchmarkResult RunTaskSchedulerBenchmark( size_t maxThreads )
+{
+    typedef std::chrono::steady_clock Clock;
+    if ( maxThreads == 0 )
+        maxThreads = ( std::max )( 1u, std::thread::hardware_concurrency( ) );
+
+    TaskSchedulerBenchmarkResult result;
+    for ( size_t threads = 1;; threads *= 2 )
+    {
+        result.mThreads.push_back( ( std::min )( threads, maxThreads ) );
+        if ( threads >= maxThreads )
+            break;
+    }
+
+    // about the size of a tbn or dedup pass over a big mesh, in small pieces
+    const size_t items = 1 << 22;
+    std::vector<float> values( items );
+    const size_t leaves = 1 << 12;
+
+    auto reduceMap = []( size_t first, size_t last ) -> double
+    {
+        double sum = 0.0;
+        for ( size_t i = first; i < last; i++ )
+            sum += std::sqrt( static_cast< double >( i ) );
+        return sum;
+    };
+    auto reduceAdd = []( double a, double b ) { return a + b; };
+    double reference = 0.0;
+    for ( size_t first = 0; first < items * 4; first += 4096 )
+        reference = reduceAdd( reference, reduceMap( first, ( std::min )( items * 4, first + 4096 ) ) );
+
+    result.mMatches = true;
+    for ( size_t threads : result.mThreads )
+    {
+        TaskScheduler scheduler( threads - 1 );
+
+        Clock::time_point start = Clock::now( );
+        scheduler.ParallelFor( 0, items, 1024, [&]( size_t first, size_t last )
+        {
+            for ( size_t i = first; i < last; i++ )
+                values[i] = std::sin( i * 0.001f ) * std::cos( i * 0.002f );
+        } );
+        result.mForMs.push_back( std::chrono::duration<double, std::milli>( Clock::now( ) - start ).count( ) );
+
+        start = Clock::now( );
+        double sum = scheduler.ParallelReduce( size_t( 0 ), items * 4, 4096, 0.0, reduceMap, reduceAdd );
+        result.mReduceMs.push_back( std::chrono::duration<double, std::milli>( Clock::now( ) - start ).count( ) );
+        result.mMatches = result.mMatches && sum == reference;
+
+        // binary tree of tasks, every inner node depends on its two children
+        start = Clock::now( );
+        std::vector<TaskHandle> level;
+        std::vector<double> sums( leaves * 2, 0.0 );
+        for ( size_t i = 0; i < leaves; i++ )
+        {
+            level.push_back( scheduler.Run( [&sums, i, leaves]( )
+            {
+                double s = 0.0;
+                for ( size_t j = 0; j < 2048; j++ )
+                    s += std::sqrt( static_cast< double >( i * 2048 + j ) );
+                sums[leaves + i] = s;
+            } ) );
+        }
+        for ( size_t width = leaves / 2; width > 0; width /= 2 )
+        {
+            std::vector<TaskHandle> next;
+            for ( size_t i = 0; i < width; i++ )
+            {
+                size_t node = width + i;
+                std::vector<TaskHandle> children;
+                children.push_back( level[i * 2] );
+                children.push_back( level[i * 2 + 1] );
+                next.push_back( scheduler.Run( [&sums, node]( ) { sums[node] = sums[node * 2] + sums[node * 2 + 1]; }, children ) );
+            }
+            level.swap( next );
+        }
+        scheduler.Wait( level[0] );
+        result.mGraphMs.push_back( std::chrono::duration<double, std::milli>( Clock::now( ) - start ).count( ) );
+    }
+
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,237 @@
+#ifndef __TASK_SCHEDULER_H
+#define __TASK_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Task;
+struct TaskWorker;
+typedef std::shared_ptr<Task> TaskHandle;
+
+// lock free work stealing deque (Chase, Lev 2005 with the memory orders of Le et al. 2013)
+// owner pushes and pops at the bottom, any thread steals from the top; the ring grows, old rings live until destruction
+class TaskDeque
+{
+public:
+    explicit TaskDeque( size_t capacity = 256 );
+    ~TaskDeque( );
+
+    void Push( Task *task ); // owner only
+    Task* Pop( ); // owner only, nullptr if empty
+    Task* Steal( ); // nullptr if empty or lost the race
+    size_t GetSize( ) const; // approximate for other threads
+
+private:
+    struct Ring;
+
+    std::atomic<int64_t> mTop;
+    std::atomic<int64_t> mBottom;
+    std::atomic<Ring*> mRing;
+    std::vector<Ring*> mRings; // every ring ever used, stealers may still read the old ones
+};
+
+struct TaskSchedulerStats
+{
+    uint64_t mExecuted = 0;
+    uint64_t mStolen = 0; // executed tasks taken from deques of other threads
+    uint64_t mSleeps = 0; // times a worker went idle
+};
+
+// work stealing job system, one deque per worker thread plus one for the thread that creates the scheduler
+// tasks pushed from other threads go to a locked queue; waiting threads execute other tasks instead of blocking
+class TaskScheduler
+{
+public:
+    // workers besides the owner thread, with 0 tasks run only while the owner waits
+    explicit TaskScheduler( size_t workers = GetDefaultWorkerCount( ) );
+    ~TaskScheduler( );
+
+    static size_t GetDefaultWorkerCount( ); // hardware concurrency minus the owner
+
+    // shared scheduler of the process, the first call has to happen on the main thread
+    static TaskScheduler& Get( );
+
+    // owner thread only, no tasks may be in flight; threads are restarted
+    void SetWorkerCount( size_t workers );
+    size_t GetWorkerCount( ) const;
+    size_t GetThreadCount( ) const; // workers and owner
+
+    TaskHandle Run( std::function<void( )> work );
+    // work starts after all dependencies are done, finished ones and nullptr are fine
+    TaskHandle Run( std::function<void( )> work, const std::vector<TaskHandle> &dependencies );
+
+    bool IsDone( const TaskHandle &task ) const;
+    void Wait( const TaskHandle &task ); // executes queued tasks until task is done
+    void Wait( const std::vector<TaskHandle> &tasks );
+
+    // body gets [first, last) ranges of at most grain items, calling thread takes part
+    void ParallelFor( size_t begin, size_t end, size_t grain, const std::function<void( size_t first, size_t last )> &body );
+
+    // map( first, last ) -> T for every range, results are reduced in range order, so float sums don't depend on timing
+    template< typename T, typename Map, typename Reduce >
+    T ParallelReduce( size_t begin, size_t end, size_t grain, const T &identity, Map map, Reduce reduce );
+
+    TaskSchedulerStats GetStats( ) const;
+    void ResetStats( );
+
+private:
+    TaskScheduler( const TaskScheduler& );
+    TaskScheduler& operator=( const TaskScheduler& );
+
+    void StartWorkers( size_t workers );
+    void StopWorkers( );
+    void WorkerLoop( TaskWorker *worker );
+
+    TaskWorker* GetCurrentWorker( );
+    void Schedule( Task *task );
+    Task* FindTask( TaskWorker *worker );
+    bool RunOneTask( TaskWorker *worker ); // false if nothing was found
+    void Execute( Task *task, TaskWorker *worker );
+
+    std::thread::id mOwnerThread;
+    std::vector<std::unique_ptr<TaskWorker>> mWorkers; // 0 is the owner
+    std::vector<std::thread> mThreads;
+
+    std::mutex mInjectLock; // tasks from threads without a deque
+    std::deque<Task*> mInjected;
+    std::atomic<size_t> mInjectedCount;
+
+    std::mutex mSleepLock;
+    std::condition_variable mWake;
+    std::atomic<uint64_t> mWorkEpoch; // bumped on every push, sleepers recheck it under the lock
+    std::atomic<int> mSleeping;
+    std::atomic<bool> mStop;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template< typename T, typename Map, typename Reduce >
+T TaskScheduler::ParallelReduce( size_t begin, size_t end, size_t grain, const T &identity, Map map, Reduce reduce )
+{
+    if ( end <= begin )
+        return identity;
+
+    grain = ( std::max )( grain, size_t( 1 ) );
+    size_t ranges = ( end - begin + grain - 1 ) / grain;
+    std::vector<T> partial( ranges, identity );
+    ParallelFor( 0, ranges, 1, [&]( size_t first, size_t last )
+    {
+        for ( size_t r = first; r < last; r++ )
+        {
+            size_t rangeBegin = begin + r * grain;
+            partial[r] = map( rangeBegin, ( std::min )( end, rangeBegin + grain ) );
+        }
+    } );
+
+    T result = identity;
+    for ( size_t r = 0; r < ranges; r++ )
+        result = reduce( result, partial[r] );
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// items pass serial stage in push order on workers, then parallel stage, then finish in push order on the pushing thread
+// at most limit items are alive at a time, so memory is bounded by the largest items instead of the whole input
+// finished items are recycled by Acquire to keep their buffers
+template< typename T >
+class TaskPipeline
+{
+public:
+    typedef std::function<void( T &item )> Stage;
+
+    TaskPipeline( TaskScheduler &scheduler, size_t limit, Stage serial, Stage parallel, Stage finish ) :
+        mScheduler( scheduler ), mLimit( ( std::max )( limit, size_t( 1 ) ) ), mSerial( serial ), mParallel( parallel ), mFinish( finish )
+    {
+    }
+    ~TaskPipeline( )
+    {
+        Flush( );
+    }
+
+    std::unique_ptr<T> Acquire( )
+    {
+        while ( mFree.empty( ) && mItems.size( ) >= mLimit )
+            FinishFront( );
+
+        if ( mFree.empty( ) )
+            return std::unique_ptr<T>( new T( ) );
+
+        std::unique_ptr<T> item = std::move( mFree.back( ) );
+        mFree.pop_back( );
+        return item;
+    }
+
+    void Push( std::unique_ptr<T> item )
+    {
+        while ( mItems.size( ) >= mLimit )
+            FinishFront( );
+
+        T *raw = item.get( );
+        TaskHandle stage;
+        if ( mSerial )
+        {
+            Stage &serial = mSerial;
+            stage = mScheduler.Run( [raw, &serial]( ) { serial( *raw ); }, std::vector<TaskHandle>( 1, mLastSerial ) );
+            mLastSerial = stage;
+        }
+        if ( mParallel )
+        {
+            Stage &parallel = mParallel;
+            stage = mScheduler.Run( [raw, &parallel]( ) { parallel( *raw ); }, std::vector<TaskHandle>( 1, stage ) );
+        }
+
+        mItems.push_back( std::move( item ) );
+        mTasks.push_back( stage );
+    }
+
+    void Flush( )
+    {
+        while ( !mItems.empty( ) )
+            FinishFront( );
+        mLastSerial.reset( );
+    }
+
+private:
+    void FinishFront( )
+    {
+        if ( mTasks.front( ) )
+            mScheduler.Wait( mTasks.front( ) );
+        if ( mFinish )
+            mFinish( *mItems.front( ) );
+        mFree.push_back( std::move( mItems.front( ) ) );
+        mItems.pop_front( );
+        mTasks.pop_front( );
+    }
+
+    TaskScheduler &mScheduler;
+    size_t mLimit;
+    Stage mSerial;
+    Stage mParallel;
+    Stage mFinish;
+    std::deque<std::unique_ptr<T>> mItems;
+    std::deque<TaskHandle> mTasks;
+    std::vector<std::unique_ptr<T>> mFree;
+    TaskHandle mLastSerial;
+};
+
+struct TaskSchedulerBenchmarkResult
+{
+    std::vector<size_t> mThreads;
+    std::vector<double> mForMs; // parallel for over many small tasks
+    std::vector<double> mReduceMs;
+    std::vector<double> mGraphMs; // task tree with dependencies
+    bool mMatches = false; // every thread count gives the serial reduce result
+};
+
+// same workloads on 1..maxThreads threads (0 - hardware concurrency)
+TaskSchedulerBenchmarkResult RunTaskSchedulerBenchmark( size_t maxThreads );
+
+#endif
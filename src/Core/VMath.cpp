@@ -0,0 +1,512 @@
+#include <Core/VMath.h>
+#include <Core/CpuFeatures.h>
+#include <GlobalUtils.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define VMATH_SSE
+#include <emmintrin.h>
+#elif defined( __ARM_NEON ) || defined( _M_ARM ) || defined( _M_ARM64 )
+#define VMATH_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef VCT_AVX_KERNELS
+// VMathAVX.cpp, transforms the points up to the last multiple of 8 and returns their count
+size_t TransformPointsAVX( const float m[16], const float *x, const float *y, const float *z, size_t count,
+    float *outX, float *outY, float *outZ, float *outW );
+#endif
+
+namespace
+{
+    void TransformPointsScalar( const Mat4 &m, const float *x, const float *y, const float *z, size_t begin, size_t end,
+        float *outX, float *outY, float *outZ, float *outW )
+    {
+        const float *e = m.m;
+        for ( size_t i = begin; i < end; i++ )
+        {
+            float px = x[i], py = y[i], pz = z[i];
+            float rx = px * e[0] + py * e[4] + pz * e[8] + e[12];
+            float ry = px * e[1] + py * e[5] + pz * e[9] + e[13];
+            float rz = px * e[2] + py * e[6] + pz * e[10] + e[14];
+            float rw = px * e[3] + py * e[7] + pz * e[11] + e[15];
+            outX[i] = rx;
+            outY[i] = ry;
+            outZ[i] = rz;
+            if ( outW )
+                outW[i] = rw;
+            else
+            {
+                outX[i] = rx / rw;
+                outY[i] = ry / rw;
+                outZ[i] = rz / rw;
+            }
+        }
+    }
+
+#ifdef VMATH_SSE
+    // null outW divides by w
+    void TransformPointsSSE( const Mat4 &m, const float *x, const float *y, const float *z, size_t count,
+        float *outX, float *outY, float *outZ, float *outW )
+    {
+        __m128 e[16];
+        for ( int i = 0; i < 16; i++ )
+            e[i] = _mm_set1_ps( m.m[i] );
+
+        size_t end = count & ~size_t( 3 );
+        for ( size_t i = 0; i < end; i += 4 )
+        {
+            __m128 px = _mm_loadu_ps( x + i );
+            __m128 py = _mm_loadu_ps( y + i );
+            __m128 pz = _mm_loadu_ps( z + i );
+            __m128 r[4];
+            for ( int c = 0; c < 4; c++ )
+            {
+                r[c] = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( px, e[c] ), _mm_mul_ps( py, e[4 + c] ) ),
+                    _mm_mul_ps( pz, e[8 + c] ) ), e[12 + c] );
+            }
+            if ( outW )
+                _mm_storeu_ps( outW + i, r[3] );
+            else
+            {
+                r[0] = _mm_div_ps( r[0], r[3] );
+                r[1] = _mm_div_ps( r[1], r[3] );
+                r[2] = _mm_div_ps( r[2], r[3] );
+            }
+            _mm_storeu_ps( outX + i, r[0] );
+            _mm_storeu_ps( outY + i, r[1] );
+            _mm_storeu_ps( outZ + i, r[2] );
+        }
+        TransformPointsScalar( m, x, y, z, end, count, outX, outY, outZ, outW );
+    }
+#endif
+
+#ifdef VMATH_NEON
+    float32x4_t Divide( float32x4_t a, float32x4_t b )
+    {
+#if defined( __aarch64__ ) || defined( _M_ARM64 )
+        return vdivq_f32( a, b );
+#else
+        // armv7 has no vector divide, estimate refined by two newton steps
+        float32x4_t inv = vrecpeq_f32( b );
+        inv = vmulq_f32( inv, vrecpsq_f32( b, inv ) );
+        inv = vmulq_f32( inv, vrecpsq_f32( b, inv ) );
+        return vmulq_f32( a, inv );
+#endif
+    }
+
+    void TransformPointsNEON( const Mat4 &m, const float *x, const float *y, const float *z, size_t count,
+        float *outX, float *outY, float *outZ, float *outW )
+    {
+        float32x4_t e[16];
+        for ( int i = 0; i < 16; i++ )
+            e[i] = vdupq_n_f32( m.m[i] );
+
+        size_t end = count & ~size_t( 3 );
+        for ( size_t i = 0; i < end; i += 4 )
+        {
+            float32x4_t px = vld1q_f32( x + i );
+            float32x4_t py = vld1q_f32( y + i );
+            float32x4_t pz = vld1q_f32( z + i );
+            float32x4_t r[4];
+            for ( int c = 0; c < 4; c++ )
+            {
+                r[c] = vaddq_f32( vaddq_f32( vaddq_f32( vmulq_f32( px, e[c] ), vmulq_f32( py, e[4 + c] ) ),
+                    vmulq_f32( pz, e[8 + c] ) ), e[12 + c] );
+            }
+            if ( outW )
+                vst1q_f32( outW + i, r[3] );
+            else
+            {
+                r[0] = Divide( r[0], r[3] );
+                r[1] = Divide( r[1], r[3] );
+                r[2] = Divide( r[2], r[3] );
+            }
+            vst1q_f32( outX + i, r[0] );
+            vst1q_f32( outY + i, r[1] );
+            vst1q_f32( outZ + i, r[2] );
+        }
+        TransformPointsScalar( m, x, y, z, end, count, outX, outY, outZ, outW );
+    }
+#endif
+
+    void TransformPointsPath( const Mat4 &m, const float *x, const float *y, const float *z, size_t count,
+        float *outX, float *outY, float *outZ, float *outW, MathPath path )
+    {
+        ASSERT( IsMathPathSupported( path ), "Math path isn't supported: ", path );
+        switch ( path )
+        {
+#ifdef VCT_AVX_KERNELS
+        case MP_AVX:
+        {
+            size_t end = TransformPointsAVX( m.m, x, y, z, count, outX, outY, outZ, outW );
+            TransformPointsScalar( m, x, y, z, end, count, outX, outY, outZ, outW );
+            break;
+        }
+#endif
+#ifdef VMATH_SSE
+        case MP_SSE:
+            TransformPointsSSE( m, x, y, z, count, outX, outY, outZ, outW );
+            break;
+#endif
+#ifdef VMATH_NEON
+        case MP_NEON:
+            TransformPointsNEON( m, x, y, z, count, outX, outY, outZ, outW );
+            break;
+#endif
+        default:
+            TransformPointsScalar( m, x, y, z, 0, count, outX, outY, outZ, outW );
+            break;
+        }
+    }
+
+    MathPath GetWidestPath( )
+    {
+#ifdef VCT_AVX_KERNELS
+        if ( IsAVXSupported( ) )
+            return MP_AVX;
+#endif
+#if defined( VMATH_SSE )
+        return MP_SSE;
+#elif defined( VMATH_NEON )
+        return MP_NEON;
+#else
+        return MP_SCALAR;
+#endif
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Vec3 Add( const Vec3 &a, const Vec3 &b )
+{
+    return Vec3( a.x + b.x, a.y + b.y, a.z + b.z );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Vec3 Subtract( const Vec3 &a, const Vec3 &b )
+{
+    return Vec3( a.x - b.x, a.y - b.y, a.z - b.z );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Vec3 Scale( const Vec3 &v, float s )
+{
+    return Vec3( v.x * s, v.y * s, v.z * s );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float Dot( const Vec3 &a, const Vec3 &b )
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Vec3 Cross( const Vec3 &a, const Vec3 &b )
+{
+    return Vec3( a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float Length( const Vec3 &v )
+{
+    return std::sqrt( Dot( v, v ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Vec3 Normalize( const Vec3 &v )
+{
+    float length = Length( v );
+    return length > 0.0f ? Scale( v, 1.0f / length ) : v;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Mat4 Mat4Identity( )
+{
+    Mat4 out;
+    for ( int i = 0; i < 16; i++ )
+        out.m[i] = ( i % 5 ) == 0 ? 1.0f : 0.0f;
+    return out;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Mat4 Mat4FromArray( const float m[16] )
+{
+    Mat4 out;
+    for ( int i = 0; i < 16; i++ )
+        out.m[i] = m[i];
+    return out;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Mat4 Mat4Multiply( const Mat4 &a, const Mat4 &b )
+{
+    Mat4 out;
+    for ( int r = 0; r < 4; r++ )
+    {
+        for ( int c = 0; c < 4; c++ )
+            out( r, c ) = a( r, 0 ) * b( 0, c ) + a( r, 1 ) * b( 1, c ) + a( r, 2 ) * b( 2, c ) + a( r, 3 ) * b( 3, c );
+    }
+    return out;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Mat4 Mat4Transpose( const Mat4 &m )
+{
+    Mat4 out;
+    for ( int r = 0; r < 4; r++ )
+    {
+        for ( int c = 0; c < 4; c++ )
+            out( r, c ) = m( c, r );
+    }
+    return out;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Mat4Inverse( const Mat4 &m, Mat4 &out, float *det )
+{
+    // cofactors from 2x2 minors of the top and bottom row pairs
+    const float *a = m.m;
+    float s0 = a[0] * a[5] - a[4] * a[1];
+    float s1 = a[0] * a[6] - a[4] * a[2];
+    float s2 = a[0] * a[7] - a[4] * a[3];
+    float s3 = a[1] * a[6] - a[5] * a[2];
+    float s4 = a[1] * a[7] - a[5] * a[3];
+    float s5 = a[2] * a[7] - a[6] * a[3];
+
+    float c5 = a[10] * a[15] - a[14] * a[11];
+    float c4 = a[9] * a[15] - a[13] * a[11];
+    float c3 = a[9] * a[14] - a[13] * a[10];
+    float c2 = a[8] * a[15] - a[12] * a[11];
+    float c1 = a[8] * a[14] - a[12] * a[10];
+    float c0 = a[8] * a[13] - a[12] * a[9];
+
+    float d = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if ( det )
+        *det = d;
+
+    if ( d == 0.0f || !std::isfinite( d ) )
+    {
+        out = Mat4Identity( );
+        return false;
+    }
+
+    float inv = 1.0f / d;
+    float *o = out.m;
+    o[0] = ( a[5] * c5 - a[6] * c4 + a[7] * c3 ) * inv;
+    o[1] = ( -a[1] * c5 + a[2] * c4 - a[3] * c3 ) * inv;
+    o[2] = ( a[13] * s5 - a[14] * s4 + a[15] * s3 ) * inv;
+    o[3] = ( -a[9] * s5 + a[10] * s4 - a[11] * s3 ) * inv;
+
+    o[4] = ( -a[4] * c5 + a[6] * c2 - a[7] * c1 ) * inv;
+    o[5] = ( a[0] * c5 - a[2] * c2 + a[3] * c1 ) * inv;
+    o[6] = ( -a[12] * s5 + a[14] * s2 - a[15] * s1 ) * inv;
+    o[7] = ( a[8] * s5 - a[10] * s2 + a[11] * s1 ) * inv;
+
+    o[8] = ( a[4] * c4 - a[5] * c2 + a[7] * c0 ) * inv;
+    o[9] = ( -a[0] * c4 + a[1] * c2 - a[3] * c0 ) * inv;
+    o[10] = ( a[12] * s4 - a[13] * s2 + a[15] * s0 ) * inv;
+    o[11] = ( -a[8] * s4 + a[9] * s2 - a[11] * s0 ) * inv;
+
+    o[12] = ( -a[4] * c3 + a[5] * c1 - a[6] * c0 ) * inv;
+    o[13] = ( a[0] * c3 - a[1] * c1 + a[2] * c0 ) * inv;
+    o[14] = ( -a[12] * s3 + a[13] * s1 - a[14] * s0 ) * inv;
+    o[15] = ( a[8] * s3 - a[9] * s1 + a[10] * s0 ) * inv;
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Mat4 Mat4Translation( const Vec3 &t )
+{
+    Mat4 out = Mat4Identity( );
+    out( 3, 0 ) = t.x;
+    out( 3, 1 ) = t.y;
+    out( 3, 2 ) = t.z;
+    return out;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Mat4 Mat4Scaling( const Vec3 &s )
+{
+    Mat4 out = Mat4Identity( );
+    out( 0, 0 ) = s.x;
+    out( 1, 1 ) = s.y;
+    out( 2, 2 ) = s.z;
+    return out;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Mat4 Mat4LookToRH( const Vec3 &eye, const Vec3 &dir, const Vec3 &up )
+{
+    // camera looks along -z, columns are the view basis
+    Vec3 axisZ = Normalize( Scale( dir, -1.0f ) );
+    Vec3 axisX = Normalize( Cross( up, axisZ ) );
+    Vec3 axisY = Cross( axisZ, axisX );
+
+    Mat4 out;
+    const Vec3 axes[3] = { axisX, axisY, axisZ };
+    for ( int c = 0; c < 3; c++ )
+    {
+        out( 0, c ) = axes[c].x;
+        out( 1, c ) = axes[c].y;
+        out( 2, c ) = axes[c].z;
+        out( 3, c ) = -Dot( axes[c], eye );
+    }
+    out( 0, 3 ) = out( 1, 3 ) = out( 2, 3 ) = 0.0f;
+    out( 3, 3 ) = 1.0f;
+    return out;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Mat4 Mat4LookAtRH( const Vec3 &eye, const Vec3 &focus, const Vec3 &up )
+{
+    return Mat4LookToRH( eye, Subtract( focus, eye ), up );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Mat4 Mat4PerspectiveFovRH( float fovY, float aspect, float nearZ, float farZ )
+{
+    float h = std::cos( 0.5f * fovY ) / std::sin( 0.5f * fovY );
+    float range = farZ / ( nearZ - farZ );
+
+    Mat4 out;
+    for ( int i = 0; i < 16; i++ )
+        out.m[i] = 0.0f;
+    out( 0, 0 ) = h / aspect;
+    out( 1, 1 ) = h;
+    out( 2, 2 ) = range;
+    out( 2, 3 ) = -1.0f;
+    out( 3, 2 ) = range * nearZ;
+    return out;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Mat4 Mat4OrthographicRH( float width, float height, float nearZ, float farZ )
+{
+    return Mat4OrthographicOffCenterRH( -0.5f * width, 0.5f * width, -0.5f * height, 0.5f * height, nearZ, farZ );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Mat4 Mat4OrthographicOffCenterRH( float left, float right, float bottom, float top, float nearZ, float farZ )
+{
+    float invWidth = 1.0f / ( right - left );
+    float invHeight = 1.0f / ( top - bottom );
+    float range = 1.0f / ( nearZ - farZ );
+
+    Mat4 out = Mat4Identity( );
+    out( 0, 0 ) = 2.0f * invWidth;
+    out( 1, 1 ) = 2.0f * invHeight;
+    out( 2, 2 ) = range;
+    out( 3, 0 ) = -( left + right ) * invWidth;
+    out( 3, 1 ) = -( top + bottom ) * invHeight;
+    out( 3, 2 ) = range * nearZ;
+    return out;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Vec4 TransformPoint( const Vec3 &p, const Mat4 &m )
+{
+    return Vec4( p.x * m( 0, 0 ) + p.y * m( 1, 0 ) + p.z * m( 2, 0 ) + m( 3, 0 ),
+        p.x * m( 0, 1 ) + p.y * m( 1, 1 ) + p.z * m( 2, 1 ) + m( 3, 1 ),
+        p.x * m( 0, 2 ) + p.y * m( 1, 2 ) + p.z * m( 2, 2 ) + m( 3, 2 ),
+        p.x * m( 0, 3 ) + p.y * m( 1, 3 ) + p.z * m( 2, 3 ) + m( 3, 3 ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Vec3 TransformCoord( const Vec3 &p, const Mat4 &m )
+{
+    Vec4 r = TransformPoint( p, m );
+    return Vec3( r.x / r.w, r.y / r.w, r.z / r.w );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Vec3 TransformNormal( const Vec3 &n, const Mat4 &m )
+{
+    return Vec3( n.x * m( 0, 0 ) + n.y * m( 1, 0 ) + n.z * m( 2, 0 ),
+        n.x * m( 0, 1 ) + n.y * m( 1, 1 ) + n.z * m( 2, 1 ),
+        n.x * m( 0, 2 ) + n.y * m( 1, 2 ) + n.z * m( 2, 2 ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool IsMathPathSupported( MathPath path )
+{
+    switch ( path )
+    {
+    case MP_SCALAR:
+        return true;
+#ifdef VMATH_SSE
+    case MP_SSE:
+        return true;
+#endif
+#ifdef VCT_AVX_KERNELS
+    case MP_AVX:
+        return IsAVXSupported( );
+#endif
+#ifdef VMATH_NEON
+    case MP_NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TransformPointsSoA( const Mat4 &m, const float *x, const float *y, const float *z, size_t count,
+    float *outX, float *outY, float *outZ, float *outW, MathPath path )
+{
+    ASSERT( outW, "TransformPointsSoA needs w output" );
+    TransformPointsPath( m, x, y, z, count, outX, outY, outZ, outW, path );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TransformPointsSoA( const Mat4 &m, const float *x, const float *y, const float *z, size_t count,
+    float *outX, float *outY, float *outZ, float *outW )
+{
+    TransformPointsSoA( m, x, y, z, count, outX, outY, outZ, outW, GetWidestPath( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TransformCoordsSoA( const Mat4 &m, const float *x, const float *y, const float *z, size_t count,
+    float *outX, float *outY, float *outZ, MathPath path )
+{
+    TransformPointsPath( m, x, y, z, count, outX, outY, outZ, nullptr, path );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void TransformCoordsSoA( const Mat4 &m, const float *x, const float *y, const float *z, size_t count,
+    float *outX, float *outY, float *outZ )
+{
+    TransformCoordsSoA( m, x, y, z, count, outX, outY, outZ, GetWidestPath( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+MathBenchmarkResult RunMathBenchmark( size_t points, size_t iterations )
+{
+    typedef std::chrono::steady_clock Clock;
+
+    Mat4 viewProj = Mat4Multiply( Mat4LookAtRH( Vec3( 0.0f, 300.0f, 1500.0f ), Vec3( ), Vec3( 0.0f, 1.0f, 0.0f ) ),
+        Mat4PerspectiveFovRH( 0.25f * 3.14159265f, 4.0f / 3.0f, 1.0f, 10000.0f ) );
+
+    std::mt19937 rng( 4321 );
+    std::uniform_real_distribution<float> posDist( -1200.0f, 1200.0f );
+    std::vector<float> x( points ), y( points ), z( points );
+    for ( size_t i = 0; i < points; i++ )
+    {
+        x[i] = posDist( rng );
+        y[i] = posDist( rng );
+        z[i] = posDist( rng );
+    }
+
+    MathBenchmarkResult result;
+    result.mPoints = points;
+    if ( points == 0 )
+        return result;
+
+    std::vector<float> refX( points ), refY( points ), refZ( points ), refW( points );
+    TransformPointsSoA( viewProj, &x[0], &y[0], &z[0], points, &refX[0], &refY[0], &refZ[0], &refW[0], MP_SCALAR );
+
+    std::vector<float> outX( points ), outY( points ), outZ( points ), outW( points );
+    size_t runs = ( std::max )( iterations, size_t( 1 ) );
+    for ( int path = 0; path < MP_COUNT; path++ )
+    {
+        result.mPointsPerSecond[path] = 0.0;
+        if ( !IsMathPathSupported( static_cast< MathPath >( path ) ) )
+            continue;
+
+        Clock::time_point start = Clock::now( );
+        for ( size_t it = 0; it < runs; it++ )
+        {
+            TransformPointsSoA( viewProj, &x[0], &y[0], &z[0], points, &outX[0], &outY[0], &outZ[0], &outW[0],
+                static_cast< MathPath >( path ) );
+        }
+        double seconds = std::chrono::duration< double >( Clock::now( ) - start ).count( );
+        result.mPointsPerSecond[path] = seconds > 0.0 ? points * runs / seconds : 0.0;
+
+        // same operation order in every path, only fused or reordered code generation can differ
+        for ( size_t i = 0; i < points; i++ )
+        {
+            float scale = 1.0f + std::fabs( refW[i] ) + std::fabs( refX[i] );
+            result.mPathsMatch &= std::fabs( outX[i] - refX[i] ) <= 1e-5f * scale && std::fabs( outW[i] - refW[i] ) <= 1e-5f * scale;
+        }
+    }
+
+    return result;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,94 @@
+#ifndef __VMATH_H
+#define __VMATH_H
+
+#include <stddef.h>
+
+// portable replacement for the DirectXMath subset used on cpu side
+// matrices are row-major for row vectors (v * M), projections are right handed with clip z in [0, w],
+// so results are interchangeable with XMFLOAT4X4 and the float[16] matrices of Core
+struct Vec3
+{
+    float x, y, z;
+
+    Vec3( ) : x( 0.0f ), y( 0.0f ), z( 0.0f ) { }
+    Vec3( float vx, float vy, float vz ) : x( vx ), y( vy ), z( vz ) { }
+};
+
+struct Vec4
+{
+    float x, y, z, w;
+
+    Vec4( ) : x( 0.0f ), y( 0.0f ), z( 0.0f ), w( 0.0f ) { }
+    Vec4( float vx, float vy, float vz, float vw ) : x( vx ), y( vy ), z( vz ), w( vw ) { }
+};
+
+struct Mat4
+{
+    float m[16];
+
+    float& operator()( int row, int col ) { return m[row * 4 + col]; }
+    float operator()( int row, int col ) const { return m[row * 4 + col]; }
+};
+
+Vec3 Add( const Vec3 &a, const Vec3 &b );
+Vec3 Subtract( const Vec3 &a, const Vec3 &b );
+Vec3 Scale( const Vec3 &v, float s );
+float Dot( const Vec3 &a, const Vec3 &b );
+Vec3 Cross( const Vec3 &a, const Vec3 &b );
+float Length( const Vec3 &v );
+Vec3 Normalize( const Vec3 &v ); // zero vector stays zero
+
+Mat4 Mat4Identity( );
+Mat4 Mat4FromArray( const float m[16] );
+Mat4 Mat4Multiply( const Mat4 &a, const Mat4 &b ); // a then b
+Mat4 Mat4Transpose( const Mat4 &m );
+// false and identity for a singular matrix, det may be null
+bool Mat4Inverse( const Mat4 &m, Mat4 &out, float *det = nullptr );
+
+Mat4 Mat4Translation( const Vec3 &t );
+Mat4 Mat4Scaling( const Vec3 &s );
+Mat4 Mat4LookToRH( const Vec3 &eye, const Vec3 &dir, const Vec3 &up );
+Mat4 Mat4LookAtRH( const Vec3 &eye, const Vec3 &focus, const Vec3 &up );
+Mat4 Mat4PerspectiveFovRH( float fovY, float aspect, float nearZ, float farZ );
+Mat4 Mat4OrthographicRH( float width, float height, float nearZ, float farZ );
+Mat4 Mat4OrthographicOffCenterRH( float left, float right, float bottom, float top, float nearZ, float farZ );
+
+Vec4 TransformPoint( const Vec3 &p, const Mat4 &m ); // w = 1
+Vec3 TransformCoord( const Vec3 &p, const Mat4 &m ); // w = 1, divided by result w
+Vec3 TransformNormal( const Vec3 &n, const Mat4 &m ); // w = 0
+
+enum MathPath
+{
+    MP_SCALAR,
+    MP_SSE,
+    MP_AVX,
+    MP_NEON,
+
+    MP_COUNT
+};
+
+bool IsMathPathSupported( MathPath path );
+
+// batched transforms of structure of arrays points, count is arbitrary, outputs may alias inputs
+// uses the widest path the cpu supports (AVX - 8 points per iteration, SSE and NEON - 4)
+void TransformPointsSoA( const Mat4 &m, const float *x, const float *y, const float *z, size_t count,
+    float *outX, float *outY, float *outZ, float *outW );
+void TransformPointsSoA( const Mat4 &m, const float *x, const float *y, const float *z, size_t count,
+    float *outX, float *outY, float *outZ, float *outW, MathPath path );
+// divided by w, for voxelization and projected bounds
+void TransformCoordsSoA( const Mat4 &m, const float *x, const float *y, const float *z, size_t count,
+    float *outX, float *outY, float *outZ );
+void TransformCoordsSoA( const Mat4 &m, const float *x, const float *y, const float *z, size_t count,
+    float *outX, float *outY, float *outZ, MathPath path );
+
+struct MathBenchmarkResult
+{
+    size_t mPoints = 0;
+    double mPointsPerSecond[MP_COUNT]; // 0 when path isn't supported
+    bool mPathsMatch = true; // all supported paths agree with scalar reference
+};
+
+// random points through a view projection matrix
+MathBenchmarkResult RunMathBenchmark( size_t points, size_t iterations );
+
+#endif
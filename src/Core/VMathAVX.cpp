@@ -0,0 +1,43 @@
+#include <stddef.h>
+
+// the only math code built with avx code generation, TransformPointsSoA calls it after IsAVXSupported. it takes the
+// raw matrix and has no inline functions or templates, avx copies of those could be picked by the linker for other code
+#ifdef VCT_AVX_KERNELS
+#include <immintrin.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t TransformPointsAVX( const float m[16], const float *x, const float *y, const float *z, size_t count,
+    float *outX, float *outY, float *outZ, float *outW )
+{
+    __m256 e[16];
+    for ( int i = 0; i < 16; i++ )
+        e[i] = _mm256_set1_ps( m[i] );
+
+    size_t end = count & ~size_t( 7 );
+    for ( size_t i = 0; i < end; i += 8 )
+    {
+        __m256 px = _mm256_loadu_ps( x + i );
+        __m256 py = _mm256_loadu_ps( y + i );
+        __m256 pz = _mm256_loadu_ps( z + i );
+        __m256 r[4];
+        for ( int c = 0; c < 4; c++ )
+        {
+            r[c] = _mm256_add_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( px, e[c] ), _mm256_mul_ps( py, e[4 + c] ) ),
+                _mm256_mul_ps( pz, e[8 + c] ) ), e[12 + c] );
+        }
+        if ( outW )
+            _mm256_storeu_ps( outW + i, r[3] );
+        else
+        {
+            r[0] = _mm256_div_ps( r[0], r[3] );
+            r[1] = _mm256_div_ps( r[1], r[3] );
+            r[2] = _mm256_div_ps( r[2], r[3] );
+        }
+        _mm256_storeu_ps( outX + i, r[0] );
+        _mm256_storeu_ps( outY + i, r[1] );
+        _mm256_storeu_ps( outZ + i, r[2] );
+    }
+    return end;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
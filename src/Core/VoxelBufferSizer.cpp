@@ -0,0 +1,77 @@
+#include <Core/VoxelBufferSizer.h>
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+VoxelBufferSizer::VoxelBufferSizer( const VoxelBufferPolicy &policy ) :
+    mPolicy( policy )
+{
+    mPolicy.mGranularity = ( std::max )( mPolicy.mGranularity, size_t( 1 ) );
+    mPolicy.mMinCapacity = ( std::max )( mPolicy.mMinCapacity, size_t( 1 ) );
+    mPolicy.mMaxCapacity = ( std::max )( mPolicy.mMaxCapacity, mPolicy.mMinCapacity );
+    mPolicy.mGrowth = ( std::max )( mPolicy.mGrowth, 1.0f );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t VoxelBufferSizer::RoundUp( size_t fragments ) const
+{
+    size_t g = mPolicy.mGranularity;
+    size_t rounded = ( std::max )( fragments, mPolicy.mMinCapacity );
+    rounded = ( rounded + g - 1 ) / g * g;
+    return ( std::min )( rounded, mPolicy.mMaxCapacity );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+VoxelBufferDecision VoxelBufferSizer::Reserve( size_t fragments )
+{
+    VoxelBufferDecision decision;
+    size_t capacity = mStats.mCapacity;
+
+    if ( capacity == 0 )
+    {
+        // first allocation is exact, there is no history to grow from
+        decision.mAction = VBA_CREATE;
+        capacity = RoundUp( fragments );
+    }
+    else if ( fragments > capacity && capacity < mPolicy.mMaxCapacity )
+    {
+        decision.mAction = VBA_GROW;
+        size_t grown = static_cast< size_t >( capacity * static_cast< double >( mPolicy.mGrowth ) );
+        capacity = RoundUp( ( std::max )( fragments, grown ) );
+    }
+    else if ( fragments < capacity * static_cast< double >( mPolicy.mShrinkBelow ) && RoundUp( fragments ) < capacity )
+    {
+        decision.mAction = VBA_SHRINK;
+        capacity = RoundUp( fragments );
+    }
+
+    if ( decision.mAction != VBA_KEEP )
+        mStats.mReallocations++;
+
+    decision.mCapacity = capacity;
+    decision.mDropped = fragments > capacity ? fragments - capacity : 0;
+    if ( decision.mDropped > 0 )
+        mStats.mOverflows++;
+
+    mStats.mCapacity = capacity;
+    mStats.mLastCount = fragments;
+    mStats.mPeakCount = ( std::max )( mStats.mPeakCount, fragments );
+    return decision;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VoxelBufferSizer::Reset( )
+{
+    mStats.mCapacity = 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t VoxelBufferSizer::GetCapacity( ) const
+{
+    return mStats.mCapacity;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const VoxelBufferPolicy& VoxelBufferSizer::GetPolicy( ) const
+{
+    return mPolicy;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+VoxelBufferStats VoxelBufferSizer::GetStats( ) const
+{
+    return mStats;
+}
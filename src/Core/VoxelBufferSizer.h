@@ -0,0 +1,61 @@
+#ifndef __VOXEL_BUFFER_SIZER_H
+#define __VOXEL_BUFFER_SIZER_H
+
+#include <cstddef>
+
+// all values in voxel fragments (16 bytes each)
+struct VoxelBufferPolicy
+{
+    size_t mMinCapacity = 1 << 16;
+    size_t mMaxCapacity = 1 << 23; // 128 MB, the resource size every d3d11 device has to support
+    size_t mGranularity = 1 << 12;
+    float mGrowth = 1.5f; // growth over the current capacity, counts above it are allocated exactly
+    float mShrinkBelow = 0.25f; // counts under this part of the capacity give the memory back
+};
+
+enum VoxelBufferAction
+{
+    VBA_KEEP,
+    VBA_CREATE,
+    VBA_GROW,
+    VBA_SHRINK,
+};
+
+struct VoxelBufferDecision
+{
+    VoxelBufferAction mAction = VBA_KEEP;
+    size_t mCapacity = 0; // capacity after the decision
+    size_t mDropped = 0; // counted fragments over mMaxCapacity, they are lost
+};
+
+struct VoxelBufferStats
+{
+    size_t mCapacity = 0;
+    size_t mLastCount = 0;
+    size_t mPeakCount = 0;
+    size_t mReallocations = 0; // creates, grows and shrinks
+    size_t mOverflows = 0; // reserves that dropped fragments
+};
+
+// capacity of the gpu voxel fragment array from the fragment count of the counting pass;
+// the buffer is kept while counts fit, so rebuilds of the same scene don't reallocate
+class VoxelBufferSizer
+{
+public:
+    explicit VoxelBufferSizer( const VoxelBufferPolicy &policy = VoxelBufferPolicy( ) );
+
+    VoxelBufferDecision Reserve( size_t fragments );
+    void Reset( ); // buffer is released, next reserve creates it again
+
+    size_t GetCapacity( ) const;
+    const VoxelBufferPolicy& GetPolicy( ) const;
+    VoxelBufferStats GetStats( ) const;
+
+private:
+    VoxelBufferPolicy mPolicy;
+    VoxelBufferStats mStats;
+
+    size_t RoundUp( size_t fragments ) const; // granularity and min/max clamp
+};
+
+#endif
@@ -0,0 +1,339 @@
+#include <Core/VoxelMerge.h>
+#include <Core/TaskScheduler.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <random>
+#include <thread>
+
+namespace
+{
+    // fragments per sort or reduce range, smaller ranges cost more histogram clears than they save
+    const size_t MERGE_GRAIN = 1 << 14;
+
+    struct VoxelSum
+    {
+        uint64_t mColor[4];
+        float mNormal[3];
+        uint32_t mCount;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void ClearSum( VoxelSum &sum )
+    {
+        for ( int c = 0; c < 4; c++ )
+            sum.mColor[c] = 0;
+        for ( int a = 0; a < 3; a++ )
+            sum.mNormal[a] = 0.0f;
+        sum.mCount = 0;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void AddFragment( VoxelSum &sum, const OctreeVoxel &fragment )
+    {
+        for ( int c = 0; c < 4; c++ )
+            sum.mColor[c] += ( fragment.mColor >> ( c * 8 ) ) & 0xff;
+        // normal is stored as n * 0.5 + 0.5, sum it signed so opposite fragments cancel out
+        for ( int a = 0; a < 3; a++ )
+            sum.mNormal[a] += ( ( fragment.mNormal >> ( a * 8 ) ) & 0xff ) * ( 2.0f / 255.0f ) - 1.0f;
+        sum.mCount++;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    OctreeVoxel ResolveSum( const VoxelSum &sum, const OctreeVoxel &first )
+    {
+        OctreeVoxel voxel = first;
+        voxel.mPad = sum.mCount;
+        if ( sum.mCount == 1 )
+            return voxel;
+
+        voxel.mColor = 0;
+        for ( int c = 0; c < 4; c++ )
+            voxel.mColor |= static_cast< uint32_t >( ( sum.mColor[c] + sum.mCount / 2 ) / sum.mCount ) << ( c * 8 );
+
+        // fragments facing away from each other keep the normal of the first one, 8 bit rounding leaves up to 0.007 per fragment
+        float length = std::sqrt( sum.mNormal[0] * sum.mNormal[0] + sum.mNormal[1] * sum.mNormal[1] + sum.mNormal[2] * sum.mNormal[2] );
+        if ( length > 0.02f * sum.mCount )
+        {
+            voxel.mNormal = 0;
+            for ( int a = 0; a < 3; a++ )
+            {
+                float n = ( std::min )( ( std::max )( sum.mNormal[a] / length * 0.5f + 0.5f, 0.0f ), 1.0f );
+                voxel.mNormal |= static_cast< uint32_t >( n * 255.0f + 0.5f ) << ( a * 8 );
+            }
+        }
+        return voxel;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    size_t GetRangeCount( size_t count, TaskScheduler &scheduler )
+    {
+        // a few ranges per thread so stealing can even out, and never smaller than the grain
+        size_t ranges = ( std::min )( ( count + MERGE_GRAIN - 1 ) / MERGE_GRAIN, scheduler.GetThreadCount( ) * 4 );
+        return ( std::max )( ranges, size_t( 1 ) );
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SortVoxelFragments( std::vector<OctreeVoxel> &fragments, std::vector<OctreeVoxel> &scratch, TaskScheduler &scheduler )
+{
+    // the same scheme as SortPhotons with a histogram per range, ranges scatter to disjoint slots of every digit
+    size_t count = fragments.size( );
+    scratch.resize( count );
+    if ( count < 2 )
+        return;
+
+    size_t ranges = GetRangeCount( count, scheduler );
+    size_t rangeSize = ( count + ranges - 1 ) / ranges;
+
+    uint32_t firstKey = fragments[0].mPosition;
+    uint32_t varyingBits = scheduler.ParallelReduce( size_t( 0 ), count, rangeSize, 0u,
+        [&]( size_t first, size_t last ) -> uint32_t
+        {
+            uint32_t bits = 0;
+            for ( size_t i = first; i < last; i++ )
+                bits |= fragments[i].mPosition ^ firstKey;
+            return bits;
+        },
+        []( uint32_t a, uint32_t b ) { return a | b; } );
+
+    std::vector<size_t> histograms( ranges * 256 );
+    for ( int shift = 0; shift < 32; shift += 8 ) // 30 bits of position, the top digit is mostly skipped
+    {
+        if ( ( ( varyingBits >> shift ) & 0xff ) == 0 )
+            continue;
+
+        const OctreeVoxel *src = fragments.data( );
+        OctreeVoxel *dst = scratch.data( );
+
+        scheduler.ParallelFor( 0, ranges, 1, [&]( size_t firstRange, size_t lastRange )
+        {
+            for ( size_t r = firstRange; r < lastRange; r++ )
+            {
+                size_t *histogram = &histograms[r * 256];
+                std::fill( histogram, histogram + 256, size_t( 0 ) );
+                size_t last = ( std::min )( count, ( r + 1 ) * rangeSize );
+                for ( size_t i = r * rangeSize; i < last; i++ )
+                    histogram[( src[i].mPosition >> shift ) & 0xff]++;
+            }
+        } );
+
+        // digit major, range minor keeps the sort stable
+        size_t offset = 0;
+        for ( size_t d = 0; d < 256; d++ )
+        {
+            for ( size_t r = 0; r < ranges; r++ )
+            {
+                size_t h = histograms[r * 256 + d];
+                histograms[r * 256 + d] = offset;
+                offset += h;
+            }
+        }
+
+        scheduler.ParallelFor( 0, ranges, 1, [&]( size_t firstRange, size_t lastRange )
+        {
+            for ( size_t r = firstRange; r < lastRange; r++ )
+            {
+                size_t *histogram = &histograms[r * 256];
+                size_t last = ( std::min )( count, ( r + 1 ) * rangeSize );
+                for ( size_t i = r * rangeSize; i < last; i++ )
+                    dst[histogram[( src[i].mPosition >> shift ) & 0xff]++] = src[i];
+            }
+        } );
+
+        fragments.swap( scratch );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ReduceVoxelFragments( const std::vector<OctreeVoxel> &fragments, std::vector<OctreeVoxel> &voxels, TaskScheduler &scheduler )
+{
+    size_t count = fragments.size( );
+    voxels.clear( );
+    if ( count == 0 )
+        return;
+
+    // range borders are moved to the start of a position run, so every voxel is reduced by one range
+    size_t ranges = GetRangeCount( count, scheduler );
+    std::vector<size_t> borders( ranges + 1, count );
+    borders[0] = 0;
+    for ( size_t r = 1; r < ranges; r++ )
+    {
+        size_t border = ( std::max )( borders[r - 1], count * r / ranges );
+        while ( border > 0 && border < count && fragments[border].mPosition == fragments[border - 1].mPosition )
+            border++;
+        borders[r] = border;
+    }
+
+    std::vector<size_t> offsets( ranges + 1, 0 );
+    scheduler.ParallelFor( 0, ranges, 1, [&]( size_t firstRange, size_t lastRange )
+    {
+        for ( size_t r = firstRange; r < lastRange; r++ )
+        {
+            size_t runs = 0;
+            for ( size_t i = borders[r]; i < borders[r + 1]; i++ )
+                runs += i == borders[r] || fragments[i].mPosition != fragments[i - 1].mPosition;
+            offsets[r + 1] = runs;
+        }
+    } );
+
+    for ( size_t r = 0; r < ranges; r++ )
+        offsets[r + 1] += offsets[r];
+    voxels.resize( offsets[ranges] );
+
+    scheduler.ParallelFor( 0, ranges, 1, [&]( size_t firstRange, size_t lastRange )
+    {
+        for ( size_t r = firstRange; r < lastRange; r++ )
+        {
+            size_t out = offsets[r];
+            size_t i = borders[r];
+            while ( i < borders[r + 1] )
+            {
+                size_t first = i;
+                VoxelSum sum;
+                ClearSum( sum );
+                for ( ; i < borders[r + 1] && fragments[i].mPosition == fragments[first].mPosition; i++ )
+                    AddFragment( sum, fragments[i] );
+                voxels[out++] = ResolveSum( sum, fragments[first] );
+            }
+        }
+    } );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t MergeVoxelFragments( std::vector<OctreeVoxel> &fragments, std::vector<OctreeVoxel> &scratch, TaskScheduler &scheduler )
+{
+    SortVoxelFragments( fragments, scratch, scheduler );
+    ReduceVoxelFragments( fragments, scratch, scheduler );
+    fragments.swap( scratch );
+    return fragments.size( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void GenerateVoxelFragments( size_t count, uint32_t seed, std::vector<OctreeVoxel> &fragments )
+{
+    // sphere shells at the octree resolution, fragments come in random order like appends of many pixel shader waves
+    std::mt19937 rng( seed );
+    std::uniform_real_distribution<float> unit( 0.0f, 1.0f );
+    const float resolution = static_cast< float >( 1 << OCTREE_POSITION_BITS );
+
+    const int shells = 16;
+    float centers[shells][3];
+    float radii[shells];
+    uint32_t colors[shells];
+    for ( int s = 0; s < shells; s++ )
+    {
+        radii[s] = 20.0f + unit( rng ) * 120.0f;
+        for ( int a = 0; a < 3; a++ )
+            centers[s][a] = radii[s] + unit( rng ) * ( resolution - 2.0f * radii[s] - 1.0f );
+        colors[s] = PackColor( unit( rng ), unit( rng ), unit( rng ), 1.0f );
+    }
+
+    fragments.resize( count );
+    for ( size_t i = 0; i < count; i++ )
+    {
+        int s = static_cast< int >( unit( rng ) * shells ) % shells;
+        float z = unit( rng ) * 2.0f - 1.0f;
+        float phi = unit( rng ) * 6.2831853f;
+        float r = std::sqrt( ( std::max )( 0.0f, 1.0f - z * z ) );
+        float dir[3] = { r * std::cos( phi ), r * std::sin( phi ), z };
+
+        uint32_t c[3];
+        for ( int a = 0; a < 3; a++ )
+            c[a] = static_cast< uint32_t >( centers[s][a] + dir[a] * radii[s] );
+
+        // texture detail on top of the shell color
+        uint32_t noise = static_cast< uint32_t >( unit( rng ) * 32.0f );
+        OctreeVoxel &fragment = fragments[i];
+        fragment.mPosition = PackOctreePosition( c[0], c[1], c[2] );
+        fragment.mColor = colors[s] & 0xff000000;
+        for ( int ch = 0; ch < 3; ch++ )
+            fragment.mColor |= ( std::min )( ( ( colors[s] >> ( ch * 8 ) ) & 0xff ) + noise, 255u ) << ( ch * 8 );
+        fragment.mNormal = PackColor( dir[0] * 0.5f + 0.5f, dir[1] * 0.5f + 0.5f, dir[2] * 0.5f + 0.5f, 0.0f );
+        fragment.mPad = 0;
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void MergeVoxelFragmentsReference( const std::vector<OctreeVoxel> &fragments, std::vector<OctreeVoxel> &voxels )
+{
+    std::map<uint32_t, std::pair<VoxelSum, OctreeVoxel>> sums;
+    for ( const OctreeVoxel &fragment : fragments )
+    {
+        auto it = sums.find( fragment.mPosition );
+        if ( it == sums.end( ) )
+        {
+            VoxelSum sum;
+            ClearSum( sum );
+            it = sums.insert( std::make_pair( fragment.mPosition, std::make_pair( sum, fragment ) ) ).first;
+        }
+        AddFragment( it->second.first, fragment );
+    }
+
+    voxels.clear( );
+    for ( const auto &it : sums )
+        voxels.push_back( ResolveSum( it.second.first, it.second.second ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AreVoxelsEqual( const std::vector<OctreeVoxel> &a, const std::vector<OctreeVoxel> &b )
+{
+    if ( a.size( ) != b.size( ) )
+        return false;
+    for ( size_t i = 0; i < a.size( ); i++ )
+    {
+        if ( a[i].mPosition != b[i].mPosition || a[i].mColor != b[i].mColor || a[i].mNormal != b[i].mNormal || a[i].mPad != b[i].mPad )
+            return false;
+    }
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+VoxelMergeBenchmarkResult RunVoxelMergeBenchmark( size_t fragments, size_t maxThreads, int iterations )
+{
+    typedef std::chrono::steady_clock Clock;
+    auto ms = []( Clock::time_point start ) { return std::chrono::duration< double, std::milli >( Clock::now( ) - start ).count( ); };
+
+    iterations = ( std::max )( iterations, 1 );
+    if ( maxThreads == 0 )
+        maxThreads = ( std::max )( 1u, std::thread::hardware_concurrency( ) );
+
+    VoxelMergeBenchmarkResult result;
+    for ( size_t threads = 1;; threads *= 2 )
+    {
+        result.mThreads.push_back( ( std::min )( threads, maxThreads ) );
+        if ( threads >= maxThreads )
+            break;
+    }
+
+    std::vector<OctreeVoxel> input;
+    GenerateVoxelFragments( fragments, 42, input );
+    result.mFragments = input.size( );
+
+    std::vector<OctreeVoxel> reference;
+    MergeVoxelFragmentsReference( input, reference );
+    result.mVoxels = reference.size( );
+
+    // former cost model: comparison sort of the whole array, then the same serial reduce
+    std::vector<OctreeVoxel> work, scratch;
+    result.mStdSortMs = 1e30;
+    for ( int it = 0; it < iterations; it++ )
+    {
+        work = input;
+        Clock::time_point start = Clock::now( );
+        std::stable_sort( work.begin( ), work.end( ), []( const OctreeVoxel &a, const OctreeVoxel &b ) { return a.mPosition < b.mPosition; } );
+        TaskScheduler serial( 0 );
+        ReduceVoxelFragments( work, scratch, serial );
+        result.mStdSortMs = ( std::min )( result.mStdSortMs, ms( start ) );
+    }
+
+    result.mMatchesReference = true;
+    for ( size_t threads : result.mThreads )
+    {
+        TaskScheduler scheduler( threads - 1 );
+        double best = 1e30;
+        for ( int it = 0; it < iterations; it++ )
+        {
+            work = input;
+            Clock::time_point start = Clock::now( );
+            MergeVoxelFragments( work, scratch, scheduler );
+            best = ( std::min )( best, ms( start ) );
+        }
+        result.mMergeMs.push_back( best );
+        result.mMatchesReference = result.mMatchesReference && AreVoxelsEqual( work, reference );
+    }
+
+    return result;
+}
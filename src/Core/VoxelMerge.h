@@ -0,0 +1,42 @@
+#ifndef __VOXEL_MERGE_H
+#define __VOXEL_MERGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <Core/OctreeLayout.h>
+
+class TaskScheduler;
+
+// CreateVoxelArrayPS appends a fragment per rasterized pixel, so a leaf gets one from every triangle and
+// axis that covers it; merging leaves one voxel per position before FlagNodes and ConnectNodesToVoxels run
+
+// parallel lsd radix sort by packed position, stable; scratch is reused between calls
+void SortVoxelFragments( std::vector<OctreeVoxel> &fragments, std::vector<OctreeVoxel> &scratch, TaskScheduler &scheduler );
+
+// fragments must be sorted, averages color and normal of equal positions; mPad of a merged voxel is its fragment count
+void ReduceVoxelFragments( const std::vector<OctreeVoxel> &fragments, std::vector<OctreeVoxel> &voxels, TaskScheduler &scheduler );
+
+// sort and reduce, fragments are replaced by merged voxels in position order; returns unique voxel count
+size_t MergeVoxelFragments( std::vector<OctreeVoxel> &fragments, std::vector<OctreeVoxel> &scratch, TaskScheduler &scheduler );
+
+// sphere shells at the octree resolution, fragments in random order like appends of many pixel shader waves
+void GenerateVoxelFragments( size_t count, uint32_t seed, std::vector<OctreeVoxel> &fragments );
+// the merge as a std::map accumulation
+void MergeVoxelFragmentsReference( const std::vector<OctreeVoxel> &fragments, std::vector<OctreeVoxel> &voxels );
+bool AreVoxelsEqual( const std::vector<OctreeVoxel> &a, const std::vector<OctreeVoxel> &b );
+
+struct VoxelMergeBenchmarkResult
+{
+    size_t mFragments = 0;
+    size_t mVoxels = 0; // unique positions
+    std::vector<size_t> mThreads;
+    std::vector<double> mMergeMs; // sort and reduce, best of iterations
+    double mStdSortMs = 0.0; // std::sort and serial reduce
+    bool mMatchesReference = false; // every thread count gives the std::map accumulation
+};
+
+// fragments of random sphere shells in append order, 1..maxThreads threads (0 - hardware concurrency)
+VoxelMergeBenchmarkResult RunVoxelMergeBenchmark( size_t fragments, size_t maxThreads, int iterations );
+
+#endif
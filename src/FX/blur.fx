@@ -1,6 +1,12 @@
 #include "utils.fx"
 
-// This FX contains blur technique from NVIDIA SSAO paper
+// This FX contains joint bilateral upsampling of low res indirect irradiance guided by gbuffer depth and normals
+
+// must match defines in Core/BilateralUpsample.h
+#define UPSAMPLE_MAX_RADIUS 8
+#define UPSAMPLE_PHASES 8
+#define UPSAMPLE_TAPS ( 2 * UPSAMPLE_MAX_RADIUS + 2 )
+#define UPSAMPLE_EPSILON 1e-4f
 
 struct FullScreenQuadOut
 {
@@ -9,84 +15,76 @@ struct FullScreenQuadOut
 };
 
 float4x4 gWorldViewProj;
-float falloff;
-float sharpness;
-float radius;
-float2 pixelOffset;
+float depthSharpness; // premultiplied by log2( e )
+float normalSharpness; // premultiplied by log2( e )
+float2 lowResSize;
+int upsampleRadius;
+
+// separable spatial weights, [phase * UPSAMPLE_TAPS + tap]
+float upsampleWeightsX[UPSAMPLE_PHASES * UPSAMPLE_TAPS];
+float upsampleWeightsY[UPSAMPLE_PHASES * UPSAMPLE_TAPS];
 
 Texture2D depthTexture;
+Texture2D normalTexture;
 Texture2D colorTexture;
-Texture2D blurXTexture;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 FullScreenQuadOut FullScreenQuadOutVS( Vertex_3F3F3F2F vin )
 {
     FullScreenQuadOut vout;
-    
+
     vout.PosH = mul( float4( vin.Pos, 1.0f ), gWorldViewProj );
     vout.UV = vin.UV;
 
     return vout;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-float4 BlurFunction( float2 uv, float r, float centerDepth, inout float weightSum )
+float4 UpsamplePS( FullScreenQuadOut pin ) : SV_Target
 {
-    float4 col = colorTexture.Sample( pointSamplerClamp, uv );
-    float depth = depthTexture.Sample( pointSamplerClamp, uv ).r;
+    float centerDepth = depthTexture.SampleLevel( pointSamplerClamp, pin.UV, 0 ).r;
+    float3 centerNormal = normalTexture.SampleLevel( pointSamplerClamp, pin.UV, 0 ).xyz * 2.0f - 1.0f;
 
-    float ddiff = depth - centerDepth;
-    float weight = exp( -r * r * falloff - ddiff * ddiff * sharpness );
-    weightSum += weight;
+    // low res texel below the pixel center and quantized subpixel phase for the weight lut
+    float2 p = pin.UV * lowResSize - 0.5f;
+    float2 base = floor( p );
+    int2 lutOffset = min( int2( ( p - base ) * UPSAMPLE_PHASES ), UPSAMPLE_PHASES - 1 ) * UPSAMPLE_TAPS;
+    int taps = 2 * upsampleRadius + 2;
 
-    return weight * col;
-}
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-float4 BlurX( FullScreenQuadOut pin ) : SV_Target
-{
     float4 colSum = 0;
     float weightSum = 0;
-    float centerDepth = depthTexture.Sample( pointSamplerClamp, pin.UV ).r;
 
-    for ( float r = -radius; r <= radius; ++r )
+    [loop]
+    for ( int ty = 0; ty < taps; ty++ )
     {
-        float2 uv = pin.UV.xy + float2( r * pixelOffset.x , 0 );
-        colSum += BlurFunction( uv, r, centerDepth, weightSum );
-    }
+        float wy = upsampleWeightsY[lutOffset.y + ty];
 
-    return colSum / weightSum;
-}
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-float4 BlurY( FullScreenQuadOut pin ) : SV_Target
-{
-    float4 colSum = 0;
-    float weightSum = 0;
-    float centerDepth = depthTexture.Sample( pointSamplerClamp, pin.UV ).r;
+        [loop]
+        for ( int tx = 0; tx < taps; tx++ )
+        {
+            // depth and normal are taken at low res texel center, the same point cone tracing used
+            float2 uv = ( base + float2( tx, ty ) - upsampleRadius + 0.5f ) / lowResSize;
+            float4 col = colorTexture.SampleLevel( pointSamplerClamp, uv, 0 );
+            float depth = depthTexture.SampleLevel( pointSamplerClamp, uv, 0 ).r;
+            float3 normal = normalTexture.SampleLevel( pointSamplerClamp, uv, 0 ).xyz * 2.0f - 1.0f;
 
-    for ( float r = -radius; r <= radius; ++r )
-    {
-        float2 uv = pin.UV.xy + float2( 0, r * pixelOffset.y ); 
-        colSum += BlurFunction( uv, r, centerDepth, weightSum );
-    }
+            float ddiff = depth - centerDepth;
+            float range = exp2( -ddiff * ddiff * depthSharpness - ( 1.0f - dot( normal, centerNormal ) ) * normalSharpness );
+            float weight = upsampleWeightsX[lutOffset.x + tx] * wy * ( range + UPSAMPLE_EPSILON );
 
-    float4 blurX = blurXTexture.Sample( pointSamplerClamp, pin.UV );
-    float4 finalColor = ( colSum / weightSum + blurX ) * 0.5f;
+            colSum += weight * col;
+            weightSum += weight;
+        }
+    }
 
-    return finalColor;
+    return weightSum > 0.0f ? colSum / weightSum : 0.0f;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 technique11 UpscaleBlur
 {
-    pass BlurX
-    {
-        SetVertexShader( CompileShader( vs_4_0, FullScreenQuadOutVS() ) );
-        SetGeometryShader( NULL );
-        SetPixelShader( CompileShader( ps_4_0, BlurX() ) );
-    }
-
-    pass BlurY
+    pass Upsample
     {
         SetVertexShader( CompileShader( vs_4_0, FullScreenQuadOutVS() ) );
         SetGeometryShader( NULL );
-        SetPixelShader( CompileShader( ps_4_0, BlurY() ) );
+        SetPixelShader( CompileShader( ps_4_0, UpsamplePS() ) );
     }
 }
@@ -16,8 +16,24 @@ float4x4 gShadowInverseView;
 float4x4 gShadowInverseProj;
 
 Texture2D shadowMap;
+Texture2D fluxMap; // reflective shadow map: albedo * NdotL
 uint2 shadowMapResolution;
 
+// must match define in Core/PhotonList.h
+#define PHOTON_AXIS_BITS 10
+#define PHOTON_KEY_INVALID 0xffffffff
+
+// ( morton key of the leaf, packed flux ) per shadow texel inside the octree, u0 and u1 are taken by the octree
+RWStructuredBuffer<uint2> photonListRW : register(u2);
+uint photonCount;
+float injectionSign; // -1 takes a light out of the irradiance
+uint sortBlockSize; // bitonic sort step
+uint sortStride;
+
+// float sum of the injected lights per voxel, brick corners are resolved from it; alias averaging never writes it,
+// so injecting a light again with negative sign takes it out exactly
+RWStructuredBuffer<float4> leafIrradianceRW;
+
 cbuffer LightProps
 {
     float4x4 gLightProj;
@@ -854,11 +870,32 @@ float ProjectHalfsphereOnCircleSide( in float2 nProj )
     return result * 0.33333f; // one full side is 1/3 of half sphere projection
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-emptyRT ProcessingShadowMapPS( FullScreenQuadOut pin ) : SV_Target
+uint MortonSpreadBits( uint v )
+{
+    // 10 bits -> every third bit
+    v &= 0x3ff;
+    v = ( v | ( v << 16 ) ) & 0x030000ff;
+    v = ( v | ( v << 8 ) ) & 0x0300f00f;
+    v = ( v | ( v << 4 ) ) & 0x030c30c3;
+    v = ( v | ( v << 2 ) ) & 0x09249249;
+    return v;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint MortonCompactBits( uint v )
+{
+    v &= 0x09249249;
+    v = ( v ^ ( v >> 2 ) ) & 0x030c30c3;
+    v = ( v ^ ( v >> 4 ) ) & 0x0300f00f;
+    v = ( v ^ ( v >> 8 ) ) & 0xff0000ff;
+    v = ( v ^ ( v >> 16 ) ) & 0x000003ff;
+    return v;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+emptyRT CompactPhotonsPS( FullScreenQuadOut pin ) : SV_Target
 {
+    // append every shadow texel inside the octree, duplicates are merged after sorting
     emptyRT output;
 
-    // get world position from shadowmap
     int3 screenCoords = int3( pin.PosH.xy, 0 );
     float3 worldPos = GetWorldPosFromDepth( screenCoords );
 
@@ -866,58 +903,101 @@ emptyRT ProcessingShadowMapPS( FullScreenQuadOut pin ) : SV_Target
     if ( any( worldPos < minBB ) || any( worldPos >  maxBB ) )
         discard;
 
-    uint octreePos = WorlPosToOctreePos( worldPos );
+    uint3 leafCoords = min( uint3( ( worldPos - minBB ) / ( maxBB - minBB ) * octreeResolution ), octreeResolution - 1 );
+    uint key = MortonSpreadBits( leafCoords.x ) | ( MortonSpreadBits( leafCoords.y ) << 1 ) | ( MortonSpreadBits( leafCoords.z ) << 2 );
+    float3 flux = fluxMap.Load( screenCoords ).rgb;
+    // empty texels ( local light far plane, unlit or out of range surfaces ) add nothing
+    if ( all( flux == 0.0f ) )
+        discard;
 
-    // get left, top, left-top value and discard if it's octreePos is equal to current (to prevent performance degrade)
-    float3 tmpWorldPos;
-    uint tmpOctreePos = 0;
-    if ( screenCoords.x > 0 )
-    {
-        tmpWorldPos = GetWorldPosFromDepth( screenCoords + int3( -1, 0, 0 ) );
-        tmpOctreePos = WorlPosToOctreePos( tmpWorldPos );
-        if ( tmpOctreePos == octreePos )
-            discard;
+    uint index = photonListRW.IncrementCounter( );
+    photonListRW[index] = uint2( key, PackFloat4ToUint( float4( flux, 1.0f ) ) );
 
-        if ( screenCoords.y < 0 )
-        {
-            tmpWorldPos = GetWorldPosFromDepth( screenCoords + int3( -1, -1, 0 ) );
-            tmpOctreePos = WorlPosToOctreePos( tmpWorldPos );
-            if ( tmpOctreePos == octreePos )
-                discard;
-        }
+    return output;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PadPhotonsVS( uint id: SV_VertexID )
+{
+    // fill the list up to the sort size, invalid keys go to the end
+    photonListRW[photonCount + id] = uint2( PHOTON_KEY_INVALID, 0 );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SortPhotonsVS( uint id: SV_VertexID )
+{
+    // one compare-exchange of bitonic sort step ( sortBlockSize, sortStride ), each vertex owns a pair
+    uint i = ( id / sortStride ) * sortStride * 2 + id % sortStride;
+    uint j = i + sortStride;
+    bool ascending = ( i & sortBlockSize ) == 0;
+
+    uint2 a = photonListRW[i];
+    uint2 b = photonListRW[j];
+    if ( ( a.x > b.x ) == ascending )
+    {
+        photonListRW[i] = b;
+        photonListRW[j] = a;
     }
-    if ( screenCoords.y < 0 )
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void InjectPhotonsVS( uint id: SV_VertexID )
+{
+    // first photon of every key segment averages the segment and writes its leaf once
+    uint key = photonListRW[id].x;
+    if ( id > 0 && photonListRW[id - 1].x == key )
+        return;
+
+    float3 flux = 0;
+    uint count = 0;
+    [loop]
+    for ( uint i = id; i < photonCount; i++ )
     {
-        tmpWorldPos = GetWorldPosFromDepth( screenCoords + int3( 0, -1, 0 ) );
-        tmpOctreePos = WorlPosToOctreePos( tmpWorldPos );
-        if ( tmpOctreePos == octreePos )
-            discard;
+        uint2 photon = photonListRW[i];
+        if ( photon.x != key )
+            break;
+
+        flux += UnpackUintToFloat4( photon.y ).rgb;
+        count++;
     }
 
-    // find voxel, calculate and write irradiance value to brick buffer if success
+    uint3 leafCoords = uint3( MortonCompactBits( key ), MortonCompactBits( key >> 1 ), MortonCompactBits( key >> 2 ) );
+
+    // find voxel and write irradiance value to brick buffer
     uint voxelIndex = 0;
     uint voxelParentIndex = 0;
     uint3 voxelMask = 0;
 
-    if ( PhotonTraverseOctree( octreePos, voxelIndex, voxelParentIndex, voxelMask ) )
+    if ( PhotonTraverseOctree( PackUint3ToUint( leafCoords ), voxelIndex, voxelParentIndex, voxelMask ) )
     {
         if ( voxelIndex != NODE_UNDEFINED )
         {
-            Voxel v = voxelArrayR[voxelIndex];
-            float4 vCol = UnpackUintToFloat4( v.color );
-            float3 vNrm = UnpackUintToFloat3( v.normal ) * 2.0f - 1.0f;
-            float4 outputEnergy = float4( saturate( dot( vNrm, -lDirection.xyz ) ) * lColorRadius.rgb * vCol.rgb, 1.0f ); // assume there is no attenuation
-
-            // write to brick corners (see ConstructOpacityVS scheme)
-            uint3 brickCoords = NodeIDToTextureCoords( IndexToID( voxelParentIndex ) );
-            uint3 localOffset = voxelMask * 2;
-            irradianceBrickBufferRW[brickCoords + localOffset] = PackFloat4ToUint( outputEnergy );
+            // local light attenuation is in the flux already, removed lights are injected with negative sign
+            float3 energy = flux / count * lColorRadius.rgb * injectionSign;
+
+            // lights are injected one after another, ResolveLeafIrradianceVS writes the sum to the bricks
+            leafIrradianceRW[voxelIndex] += float4( energy, 0.0f );
         }
     }
-
-    return output;
 }
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ResolveLeafIrradianceVS( uint voxelID: SV_VertexID )
+{
+    // bricks are cleared and leaf flags reset before, lit voxels write their float sum into the brick corner of their
+    // leaf ( see ConstructOpacityVS scheme ); lit flags come from the InterlockedOr in PhotonTraverseOctree of the
+    // traversal below, this pass only resolves the sum. below half of an 8 bit step packs to zero anyway, which also
+    // skips the float rounding left by removed lights
+    float3 irradiance = leafIrradianceRW[voxelID].rgb;
+    if ( all( irradiance < 0.5f / 255.0f ) )
+        return;
+
+    uint voxelIndex = 0;
+    uint voxelParentIndex = 0;
+    uint3 voxelMask = 0;
 
+    if ( PhotonTraverseOctree( voxelArrayR[voxelID].position, voxelIndex, voxelParentIndex, voxelMask ) && voxelIndex == voxelID )
+    {
+        uint3 brickCoords = NodeIDToTextureCoords( IndexToID( voxelParentIndex ) ) + voxelMask * 2;
+        irradianceBrickBufferRW[brickCoords] = PackFloat4ToUint( float4( max( irradiance, 0.0f ), 1.0f ) );
+    }
+}
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // reset lit nodes flags
 void ResetOctreeFlagsVS( uint nodeOffset: SV_VertexID )
@@ -1012,11 +1092,39 @@ technique11 GenerateLightBriks
         SetPixelShader( NULL );
     }
 
-    pass ProcessingShadowMap
+    pass CompactPhotons
     {
         SetVertexShader( CompileShader( vs_5_0, FullScreenQuadOutVS() ) );
         SetGeometryShader( NULL );
-        SetPixelShader( CompileShader( ps_5_0, ProcessingShadowMapPS() ) );
+        SetPixelShader( CompileShader( ps_5_0, CompactPhotonsPS() ) );
+    }
+
+    pass PadPhotons
+    {
+        SetVertexShader( CompileShader( vs_5_0, PadPhotonsVS() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( NULL );
+    }
+
+    pass SortPhotons
+    {
+        SetVertexShader( CompileShader( vs_5_0, SortPhotonsVS() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( NULL );
+    }
+
+    pass InjectPhotons
+    {
+        SetVertexShader( CompileShader( vs_5_0, InjectPhotonsVS() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( NULL );
+    }
+
+    pass ResolveLeafIrradiance
+    {
+        SetVertexShader( CompileShader( vs_5_0, ResolveLeafIrradianceVS() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( NULL );
     }
 
     pass AverageLitNodeValues
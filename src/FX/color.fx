@@ -22,6 +22,11 @@ VertexOut VS(Vertex_3F3F3F2F vin)
     return vout;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+VertexOut CompactVS( Vertex_Compact16 vin )
+{
+    return VS( DecodeCompactVertex( vin ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 float4 PS(VertexOut pin) : SV_Target
 {
     float4 sampleColor = defaultTexture.Sample( linearSampler, pin.UV );
@@ -40,4 +45,11 @@ technique11 ColorTech
         SetGeometryShader( NULL );
         SetPixelShader( CompileShader( ps_4_0, PS() ) );
     }
+
+    pass SimplePassCompact
+    {
+        SetVertexShader( CompileShader( vs_4_0, CompactVS() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( CompileShader( ps_4_0, PS() ) );
+    }
 }
@@ -18,6 +18,10 @@ Texture2D depthTexture;
 float2 resScale;
 
 bool useOpacityBuffer;
+bool useNeighborRopes; // see MarchOctreeR
+bool useEmptySpace; // samples in cells known to be empty skip the octree, see TraceCones in Core/ConeTracer.cpp
+Texture3D<uint> emptySpaceR; // distance to the nearest node with voxels per cell of emptySpaceLevel
+uint emptySpaceLevel;
 float lambdaFalloff;
 float localConeOffset;
 float worldConeOffset;
@@ -31,6 +35,14 @@ bool debugView;
 
 static const uint conesNum = 5;
 
+// node of the previous sample of a cone, cpu reference is MarchOctree in Core/ConeTracer.h
+struct OctreeMarcher
+{
+    uint nodeIndex;
+    uint level;
+    int3 cell; // node coords in nodes of its level
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 FullScreenQuadOut FullScreenQuadOutVS( Vertex_3F3F3F2F vin )
 {
@@ -48,16 +60,94 @@ float GetNodeWidth( in uint octreeLevel )
     return ( maxBB.x - minBB.x ) / ( octreeResolution >> ( octreeHeight - octreeLevel ) );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool WorldToBrickPosition( in float3 worldPos, in uint octreeLevel, out float3 brickPos )
+OctreeMarcher InitOctreeMarcher( )
+{
+    OctreeMarcher marcher = (OctreeMarcher)0;
+    marcher.nodeIndex = NODE_UNDEFINED;
+    return marcher;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MarchOctreeR( inout OctreeMarcher marcher, in uint vPos, in uint currentLevel, out uint nodeValue, out int3 nodeCoords )
 {
+    // TraverseOctreeR that continues from the node of the previous sample:
+    // parent links up to the sample level, neighbor links into the adjacent cell, root traversal otherwise
+    nodeValue = 0;
+    nodeCoords = 0;
+    int3 target = UnpackUintToUint3( vPos ) >> ( octreeHeight - currentLevel );
+
+    // climb has to be shorter than a traversal from the root, leaf level has no links
+    if ( marcher.nodeIndex != NODE_UNDEFINED && marcher.level >= currentLevel && marcher.level - currentLevel < currentLevel &&
+         currentLevel < octreeHeight )
+    {
+        for ( ; marcher.level > currentLevel; marcher.level-- )
+        {
+            marcher.nodeIndex = GetParentR( IndexToCoords( marcher.nodeIndex ) );
+            marcher.cell = marcher.cell >> 1;
+        }
+
+        int3 d = target - marcher.cell;
+        if ( all( abs( d ) <= 1 ) )
+        {
+            uint lastAxis = d.z != 0 ? 2 : ( d.y != 0 ? 1 : 0 );
+            uint node = marcher.nodeIndex;
+
+            [unroll]
+            for ( uint axis = 0; axis < 3; axis++ )
+            {
+                if ( d[axis] != 0 && node != NODE_UNDEFINED )
+                {
+                    // 1 - negative, 2 - positive
+                    uint3 mask = 0;
+                    mask[axis] = d[axis] > 0 ? 2 : 1;
+                    node = GetNodeNeighborR( node, mask );
+
+                    // the last link is the target cell itself, it is undefined only if the cell has no node
+                    if ( node == NODE_UNDEFINED && axis == lastAxis )
+                        return false;
+                }
+            }
+
+            if ( node != NODE_UNDEFINED )
+            {
+                marcher.nodeIndex = node;
+                marcher.cell = target;
+                nodeValue = node;
+                nodeCoords = target << ( octreeHeight - currentLevel );
+                return true;
+            }
+        }
+    }
+
+    if ( !TraverseOctreeR( vPos, currentLevel, nodeValue, nodeCoords ) )
+        return false;
+
+    if ( currentLevel < octreeHeight )
+    {
+        marcher.nodeIndex = nodeValue;
+        marcher.level = currentLevel;
+        marcher.cell = target;
+    }
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool WorldToBrickPosition( in float3 worldPos, in uint octreeLevel, inout OctreeMarcher marcher, out float3 brickPos )
+{
+    brickPos = 0.0f;
+
     if ( any( worldPos > maxBB ) || any( worldPos < minBB ) )
         return false;
 
     uint octreePos = WorlPosToOctreePos( worldPos );
     uint nodeIndex;
-    uint3 nodeStartCoords;
-    
-    if ( TraverseOctreeR( octreePos, octreeLevel, nodeIndex, nodeStartCoords ) )
+    int3 nodeStartCoords;
+    bool found = false;
+
+    if ( useNeighborRopes )
+        found = MarchOctreeR( marcher, octreePos, octreeLevel, nodeIndex, nodeStartCoords );
+    else
+        found = TraverseOctreeR( octreePos, octreeLevel, nodeIndex, nodeStartCoords );
+
+    if ( found )
     {
         uint nodeID = IndexToID( nodeIndex );
 
@@ -75,6 +165,25 @@ bool WorldToBrickPosition( in float3 worldPos, in uint octreeLevel, out float3 b
     return false;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InEmptyCells( in int3 voxelCoords, in uint octreeLevel, in int3 emptyMin, in int3 emptyMax )
+{
+    // field cells of the node of the sample and its neighbors, the brick borders are shared with them
+    int3 nodeCell = voxelCoords >> ( octreeHeight - octreeLevel );
+    int3 first = max( nodeCell - 1, 0 );
+    int3 last = min( nodeCell + 1, int( ( 1u << octreeLevel ) - 1 ) );
+    if ( octreeLevel <= emptySpaceLevel )
+    {
+        first = first << ( emptySpaceLevel - octreeLevel );
+        last = ( ( last + 1 ) << ( emptySpaceLevel - octreeLevel ) ) - 1;
+    }
+    else
+    {
+        first = first >> ( octreeLevel - emptySpaceLevel );
+        last = last >> ( octreeLevel - emptySpaceLevel );
+    }
+    return all( first >= emptyMin ) && all( last <= emptyMax );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void RotateConesDir( float3 normal, inout float3 coneDir[conesNum] )
 {
     // find rotation between normal and half-sphere orientation (coneDir[0])
@@ -167,8 +276,18 @@ float4 ConeTracingPS( FullScreenQuadOut pin ) : SV_Target
     float opacity = 0.0f;
     float3 worldSamplePos, brickSamplePos;
 
+    // every cone starts from the node of the first sample of the first cone, it is at most a cell away
+    OctreeMarcher firstMarcher = InitOctreeMarcher( );
+
+    // field cells known to be empty from the last field read, shared by the cones; starts empty, so the first
+    // sample is always looked up
+    int3 emptyMin = 0;
+    int3 emptyMax = -1;
+
     for ( uint i = 0; i < conesNum; i++ )
     {
+        OctreeMarcher marcher = firstMarcher;
+
         [unroll(4)]
         for ( uint octreeLevel = firstLevel; octreeLevel > lastLevel; octreeLevel-- )
         {
@@ -181,7 +300,15 @@ float4 ConeTracingPS( FullScreenQuadOut pin ) : SV_Target
             float3 worldSamplePos = worldPos + worldConeOffset * normal + coneDir[i] * sampleOffset;
             float3 brickSamplePos;
 
-            if ( WorldToBrickPosition( worldSamplePos, octreeLevel, brickSamplePos ) )
+            bool inside = all( worldSamplePos <= maxBB ) && all( worldSamplePos >= minBB );
+            int3 voxelCoords = int3( UnpackUintToUint3( WorlPosToOctreePos( worldSamplePos ) ) );
+            bool skipped = useEmptySpace && inside && InEmptyCells( voxelCoords, octreeLevel, emptyMin, emptyMax );
+
+            bool sampled = !skipped && WorldToBrickPosition( worldSamplePos, octreeLevel, marcher, brickSamplePos );
+            if ( i == 0 && octreeLevel == firstLevel )
+                firstMarcher = marcher;
+
+            if ( sampled )
             {
                 sampleCol = irradianceBrickBufferR.Sample( linearSampler, brickSamplePos );
                 if ( useOpacityBuffer )
@@ -201,12 +328,24 @@ float4 ConeTracingPS( FullScreenQuadOut pin ) : SV_Target
                 coneCol[i].rgb = prevCol.rgb + curCol.rgb * ( 1.0f - prevCol.a );
                 coneCol[i].a = prevCol.a + ( 1.0f - prevCol.a ) * curCol.a;
             }
-            else if ( any( worldSamplePos > maxBB ) || any( worldSamplePos < minBB ) )
+            else if ( !inside )
             {
                 coneAO[i] += aoFalloff;
                 coneCol[i].a = 1.0f;
             }
 
+            if ( useEmptySpace && inside && !skipped && ( !sampled || opacity == 0.0f ) )
+            {
+                // empty sample: every cell closer to its field cell than the distance has no voxels either
+                int3 fieldCell = voxelCoords >> ( octreeHeight - emptySpaceLevel );
+                int distance = int( emptySpaceR[uint3( fieldCell )] );
+                if ( distance > 0 )
+                {
+                    emptyMin = fieldCell - ( distance - 1 );
+                    emptyMax = fieldCell + ( distance - 1 );
+                }
+            }
+
             if ( coneCol[i].a >= 1.0f )
                 break;
         }
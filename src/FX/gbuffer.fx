@@ -1,5 +1,8 @@
 #include "utils.fx"
 
+// must match define in Core/ShadowCascades.h
+#define MAX_SHADOW_CASCADES 4
+
 float4x4 gWorldViewProj;
 float4x4 gInverseView;
 float4x4 gInverseProj;
@@ -20,12 +23,14 @@ Texture2D normalTexture;
 
 Texture2D depthTexture;
 Texture2D shadowTexture;
+Texture2D cascadeTextures[MAX_SHADOW_CASCADES];
 
 Texture2D indirectIrradianceTexture;
 
 cbuffer ShadowMap
 {
     float4x4 gLightProj;
+    float4x4 gCascadeProj[MAX_SHADOW_CASCADES];
     float4 lColorRadius;
     float4 lPos;
     float4 lDirection;
@@ -33,6 +38,7 @@ cbuffer ShadowMap
 
 bool useNormalMap;
 float shadowBias;
+int cascadeCount;
 float aoInfluence;
 float directInfluence;
 float indirectInfluence;
@@ -54,6 +60,11 @@ FullVertexOut GBufferVS(Vertex_3F3F3F2F vin)
     return vout;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FullVertexOut GBufferCompactVS( Vertex_Compact16 vin )
+{
+    return GBufferVS( DecodeCompactVertex( vin ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 GBufferPixelOut GBufferPS(FullVertexOut pin) : SV_Target
 {
     float4 albedo = albedoTexture.Sample(linearSampler, pin.UV);
@@ -77,6 +88,34 @@ GBufferPixelOut GBufferPS(FullVertexOut pin) : SV_Target
     return output;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float2 GetShadowMapSize( Texture2D shadowMap )
+{
+    float shadowW = 0.0f, shadowH = 0.0f;
+    shadowMap.GetDimensions( shadowW, shadowH );
+    return float2( shadowW, shadowH );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float SampleShadowPCF( Texture2D shadowMap, float4 lProj )
+{
+    lProj.xy = lProj.xy * 0.5f + 0.5f;
+    lProj.y = 1.0f - lProj.y;
+
+    // PCF
+    float2 texelOffset = 1.0f / GetShadowMapSize( shadowMap );
+    float average = 0.0f;
+
+    for ( float x = -1.0f; x < 1.1f; x += 1.0f )
+    {
+        for ( float y = -1.0f; y < 1.1f; y += 1.0f )
+        {
+            float2 offset = float2( x, y ) * texelOffset;
+            average += shadowMap.SampleCmpLevelZero( shadowSampler, lProj.xy + offset, lProj.z - shadowBias ).r;
+        }
+    }
+
+    return average / 9;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 LightingPixelOut CombinePS( FullVertexOut pin, uniform bool useVoxelConeTracing ) : SV_Target
 {
     LightingPixelOut output;
@@ -88,31 +127,30 @@ LightingPixelOut CombinePS( FullVertexOut pin, uniform bool useVoxelConeTracing
     float4 projCoords = float4( float2( pin.UV.x, 1.0f - pin.UV.y ) * 2.0f - 1.0f, depth, 1.0f);
     float4 worldPos = GetWorldPos( projCoords, gInverseProj, gInverseView );
     
-    float4 lProj = mul( worldPos, gLightProj );
-    lProj.xy = lProj.xy * 0.5f + 0.5f;
-    lProj.y = 1.0f - lProj.y;
-    
+    // first cascade containing the pixel with pcf footprint, scene shadow map otherwise
     float percentLit = 0.0f;
-    if ( lProj.z >= 0.001f )
+    bool inCascade = false;
+
+    [unroll]
+    for ( int i = 0; i < MAX_SHADOW_CASCADES; i++ )
     {
-        // PCF
-        float shadowW = 0.0f, shadowH = 0.0f;
-        shadowTexture.GetDimensions( shadowW, shadowH );
-        float xOffset = 1.0 / shadowW;
-        float yOffset = 1.0 / shadowH;
-        
-        float average = 0.0f;
-        
-        for ( float x = -1.0f; x < 1.1f; x += 1.0f )
+        if ( i < cascadeCount && !inCascade )
         {
-            for ( float y = -1.0f; y < 1.1f; y += 1.0f )
+            float4 cProj = mul( worldPos, gCascadeProj[i] );
+            float2 border = 1.0f - 4.0f / GetShadowMapSize( cascadeTextures[i] );
+            if ( all( abs( cProj.xy ) < border ) && cProj.z > 0.0f && cProj.z < 1.0f )
             {
-                float2 offset = float2( x * xOffset, y * yOffset );
-                average += shadowTexture.SampleCmpLevelZero( shadowSampler, lProj.xy + offset, lProj.z - shadowBias ).r;
+                percentLit = SampleShadowPCF( cascadeTextures[i], cProj );
+                inCascade = true;
             }
         }
+    }
 
-        percentLit = average / 9;
+    if ( !inCascade )
+    {
+        float4 lProj = mul( worldPos, gLightProj );
+        if ( lProj.z >= 0.001f )
+            percentLit = SampleShadowPCF( shadowTexture, lProj );
     }
 
     float3 diffuse = albedo * clamp( dot( normal, normalize(-lDirection.xyz) ), 0.0f, 1.0f ) * lColorRadius.rgb;
@@ -140,6 +178,14 @@ technique11 GBuffer
         SetGeometryShader( NULL );
         SetPixelShader( CompileShader( ps_4_0, GBufferPS() ) );
     }
+
+    // GPass for scene geometry in the quantized layout
+    pass GPassCompact
+    {
+        SetVertexShader( CompileShader( vs_4_0, GBufferCompactVS() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( CompileShader( ps_4_0, GBufferPS() ) );
+    }
     
     pass CombinePass
     {
@@ -347,16 +347,11 @@ bool PhotonTraverseOctree( in uint vPos, out uint nodeValue, out uint parentInde
 
     // each bit mean voxel/octan in the node
     uint voxelMask = 1 << ( mask.x + ( mask.y << 1 ) + ( mask.z << 2 ) );
-    uint oldFlag = 0;
     
     // mark lit voxel
-    // NOTE: with InterlockedOr we prevent redundant writing to brick bufer, but InterlockedOr can cause performance degrade
-    // should be tested, is this way really faster... I guess no
-    InterlockedOr( octreeRW[flagC], voxelMask | NODE_LIT, oldFlag );
-    
-    // already was here
-    if ( oldFlag & voxelMask )
-        return false;
+    // NOTE: photon list visits every leaf once per light face, InterlockedOr is needed for sibling leaves sharing the parent flag
+    // the voxel can be lit already by another light or face, its contribution is accumulated
+    InterlockedOr( octreeRW[flagC], voxelMask | NODE_LIT );
 
     return true;
 }
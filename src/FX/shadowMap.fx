@@ -1,12 +1,30 @@
 #include "utils.fx"
 
+// must match LightKind in Core/LightManager.h
+#define LIGHT_DIRECTIONAL 0
+#define LIGHT_POINT 1
+#define LIGHT_SPOT 2
+
 float4x4 gWorldViewProj;
+float4 lDirection; // w - cos of spot half angle
+float4 lPosRadius;
+int lType;
+
+Texture2D albedoTexture;
 
 struct ShadowMapVertexOut
 {
     float4 PosH : SV_POSITION;
 };
 
+struct ReflectiveShadowMapVertexOut
+{
+    float4 PosH : SV_POSITION;
+    float3 Position : POSITION;
+    float3 Normal : NORMAL;
+    float2 UV : TEXCOORD;
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ShadowMapVertexOut ShadowMapVS( Vertex_3F3F3F2F vin )
 {
@@ -17,6 +35,56 @@ ShadowMapVertexOut ShadowMapVS( Vertex_3F3F3F2F vin )
     return vout;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ShadowMapVertexOut ShadowMapCompactVS( Vertex_Compact16 vin )
+{
+    return ShadowMapVS( DecodeCompactVertex( vin ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ReflectiveShadowMapVertexOut ReflectiveShadowMapVS( Vertex_3F3F3F2F vin )
+{
+    // geometry is in world space already
+    ReflectiveShadowMapVertexOut vout;
+    vout.PosH = mul( float4( vin.Pos, 1.0f ), gWorldViewProj );
+    vout.Position = vin.Pos;
+    vout.Normal = vin.Normal;
+    vout.UV = vin.UV;
+
+    return vout;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ReflectiveShadowMapVertexOut ReflectiveShadowMapCompactVS( Vertex_Compact16 vin )
+{
+    return ReflectiveShadowMapVS( DecodeCompactVertex( vin ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float4 ReflectiveShadowMapPS( ReflectiveShadowMapVertexOut pin ) : SV_Target
+{
+    // reflected flux of the texel, light color is applied at injection
+    float3 albedo = albedoTexture.Sample( linearSampler, pin.UV ).rgb;
+    float3 toLight = normalize( -lDirection.xyz );
+    float attenuation = 1.0f;
+
+    if ( lType != LIGHT_DIRECTIONAL )
+    {
+        // smooth range falloff, spot edge fades over the outer fifth of the cone
+        float3 v = lPosRadius.xyz - pin.Position;
+        float dist = length( v );
+        toLight = v / max( dist, 1e-4f );
+
+        float range = saturate( 1.0f - dist / lPosRadius.w );
+        attenuation = range * range;
+        if ( lType == LIGHT_SPOT )
+        {
+            float cosAngle = dot( -toLight, normalize( lDirection.xyz ) );
+            attenuation *= smoothstep( lDirection.w, lerp( lDirection.w, 1.0f, 0.2f ), cosAngle );
+        }
+    }
+
+    float ndotl = saturate( dot( normalize( pin.Normal ), toLight ) );
+
+    return float4( albedo * ndotl * attenuation, 1.0f );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 technique11 ShadowMap
 {
     pass ShadowMapPass
@@ -25,4 +93,27 @@ technique11 ShadowMap
         SetGeometryShader( NULL );
         SetPixelShader( NULL );
     }
+
+    // depth and flux for photon injection
+    pass ReflectiveShadowMapPass
+    {
+        SetVertexShader( CompileShader( vs_4_0, ReflectiveShadowMapVS() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( CompileShader( ps_4_0, ReflectiveShadowMapPS() ) );
+    }
+
+    // same passes for scene geometry in the quantized layout
+    pass ShadowMapPassCompact
+    {
+        SetVertexShader( CompileShader( vs_4_0, ShadowMapCompactVS() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( NULL );
+    }
+
+    pass ReflectiveShadowMapPassCompact
+    {
+        SetVertexShader( CompileShader( vs_4_0, ReflectiveShadowMapCompactVS() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( CompileShader( ps_4_0, ReflectiveShadowMapPS() ) );
+    }
 }
@@ -13,6 +13,17 @@ struct Vertex_3F3F3F2F
     //float4 Color  : COLOR;
 };
 
+// quantized IA layout, must match CompactVertex of Core/CompactVertex.h
+struct Vertex_Compact16
+{
+    uint4 Pos    : POSITION; // unorm16 xyz inside of the object bounds, w - bounds slot
+    float4 Frame : NORMAL; // octahedral normal xy, binormal zw
+    float2 UV    : TEXCOORD;
+};
+
+// two elements per bounds slot: min, quantization step
+Buffer<float4> gGeometryBounds;
+
 struct FullVertexOut
 {
     float4 PosH     : SV_POSITION;
@@ -128,4 +139,25 @@ uint3 UnpackUintToUint3( uint value )
                   ( value >> 10 ) & 0x3ff, 
                   ( value >> 20 ) & 0x3ff );
 }
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float3 DecodeOctahedral( float2 oct )
+{
+    float3 n = float3( oct, 1.0f - abs( oct.x ) - abs( oct.y ) );
+    float t = saturate( -n.z );
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize( n );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Vertex_3F3F3F2F DecodeCompactVertex( Vertex_Compact16 vin )
+{
+    Vertex_3F3F3F2F v;
+
+    uint slot = vin.Pos.w * 2;
+    v.Pos = gGeometryBounds.Load( slot ).xyz + float3( vin.Pos.xyz ) * gGeometryBounds.Load( slot + 1 ).xyz;
+    v.Normal = DecodeOctahedral( vin.Frame.xy );
+    v.Binormal = DecodeOctahedral( vin.Frame.zw );
+    v.UV = vin.UV;
+
+    return v;
+}
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
@@ -11,11 +11,17 @@ struct emptyRT{};
 Texture2D albedoTexture;
 Texture2D normalTexture;
 
-uint fragBufferSize;
+uint fragBufferSize; // voxel array capacity, sized by the counting pass
+RWStructuredBuffer<uint> fragmentCounterRW; // only the hidden counter is used
 
 uint currentOctreeLevel;
 bool useNormalMap;
 
+// empty space distance field of one octree level, cpu reference is OctreeDistanceField in Core/DistanceField.h
+RWTexture3D<uint> emptySpaceRW;
+Texture3D<uint> emptySpaceR;
+uint emptySpaceLevel;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 uint2 GetAddr( in uint index, in uint texSize, in uint formatSize = 1, in uint offset = 0 )
 {
@@ -38,6 +44,11 @@ FullVertexOut CreateVoxelArrayVS( Vertex_3F3F3F2F vin )
     return vout;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+FullVertexOut CreateVoxelArrayCompactVS( Vertex_Compact16 vin )
+{
+    return CreateVoxelArrayVS( DecodeCompactVertex( vin ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 [maxvertexcount(3)]
 void CreateVoxelArrayGS( triangle FullVertexOut gin[3], inout TriangleStream<FullVertexOut> triStream )
 {
@@ -148,14 +159,25 @@ emptyRT CreateVoxelArrayPS( FullVertexOut pin ) : SV_Target
     voxel.pad = 0;
 
     uint bufferSize = voxelArrayRW.IncrementCounter();
-    voxelArrayRW[bufferSize] = voxel;
+    if ( bufferSize < fragBufferSize )
+    {
+        voxelArrayRW[bufferSize] = voxel;
 
-    // write voxels count to indirect buffer
-    IndirectIncVoxelCount();
+        // write voxels count to indirect buffer, fragments over capacity are dropped and not counted
+        IndirectIncVoxelCount();
+    }
 
     return output;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+emptyRT CountVoxelFragmentsPS( FullVertexOut pin ) : SV_Target
+{
+    // same coverage as CreateVoxelArrayPS, the voxel array is allocated from this count
+    emptyRT output;
+    fragmentCounterRW.IncrementCounter();
+    return output;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void FlagNodesVS(uint voxelID: SV_VertexID)
 {
     uint nodeIndex = 0;
@@ -221,11 +243,50 @@ void ConnectNodesToVoxelsVS( uint voxelID: SV_VertexID )
         octreeRW[IndexToCoords( leafPlace )] = voxelID;
         octreeRW[GetFlagC( IndexToCoords( leafPlace - leafPlace % SIZE_OF_NODE_STRUCT ) )] = NODE_ALLOCATED; // this is a hack but I don't remember why
 
-        // TODO check how to merge values if needed
-        // write to node flag value thats it's not empty
+        // with vct.merge_voxels the voxel array holds one averaged voxel per leaf (VCT::MergeVoxelArray),
+        // without it any fragment of the leaf can win
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint3 EmptySpaceCell( uint cellID )
+{
+    uint size = 1u << emptySpaceLevel;
+    return uint3( cellID % size, ( cellID / size ) % size, cellID / ( size * size ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void MarkEmptySpaceVS( uint cellID: SV_VertexID )
+{
+    // cells of nodes with voxels are 0, the others 255; runs before light injection, so flags have no NODE_LIT bits
+    uint3 cell = EmptySpaceCell( cellID );
+    uint nodeIndex = 0;
+    bool occupied = TraverseOctree( PackUint3ToUint( cell << ( octreeHeight - emptySpaceLevel ) ), emptySpaceLevel, nodeIndex ) &&
+        GetFlag( nodeIndex ) == NODE_ALLOCATED;
 
-        // maybe write to deffered voxel array and merge it after
+    emptySpaceRW[cell] = occupied ? 0 : 255;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EmptySpaceAlongAxisVS( uint cellID: SV_VertexID, uniform uint axis )
+{
+    // min over the line of max( |i - j|, distance of j ), searched outwards until a farther cell can't be closer;
+    // a pass per axis gives the chebyshev distance like ChebyshevDistanceTransform
+    const int3 axisSteps[3] = { int3( 1, 0, 0 ), int3( 0, 1, 0 ), int3( 0, 0, 1 ) };
+    int3 axisStep = axisSteps[axis];
+    int size = 1 << emptySpaceLevel;
+    int3 cell = int3( EmptySpaceCell( cellID ) );
+
+    uint distance = emptySpaceR[uint3( cell )];
+    [loop]
+    for ( int k = 1; k < int( distance ) && k < size; k++ )
+    {
+        int3 lower = cell - axisStep * k;
+        int3 upper = cell + axisStep * k;
+        if ( all( lower >= 0 ) )
+            distance = min( distance, max( uint( k ), emptySpaceR[uint3( lower )] ) );
+        if ( all( upper < size ) )
+            distance = min( distance, max( uint( k ), emptySpaceR[uint3( upper )] ) );
     }
+
+    emptySpaceRW[uint3( cell )] = distance;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -238,6 +299,29 @@ technique11 GenerateOctree
         SetGeometryShader( CompileShader( gs_5_0, CreateVoxelArrayGS() ) );
         SetPixelShader( CompileShader( ps_5_0, CreateVoxelArrayPS() ) );
     }
+
+    // same for scene geometry in the quantized layout
+    pass CreateVoxelArrayCompact
+    {
+        SetVertexShader( CompileShader( vs_5_0, CreateVoxelArrayCompactVS() ) );
+        SetGeometryShader( CompileShader( gs_5_0, CreateVoxelArrayGS() ) );
+        SetPixelShader( CompileShader( ps_5_0, CreateVoxelArrayPS() ) );
+    }
+
+    // counting passes run before CreateVoxelArray with the same rasterization
+    pass CountVoxelFragments
+    {
+        SetVertexShader( CompileShader( vs_5_0, CreateVoxelArrayVS() ) );
+        SetGeometryShader( CompileShader( gs_5_0, CreateVoxelArrayGS() ) );
+        SetPixelShader( CompileShader( ps_5_0, CountVoxelFragmentsPS() ) );
+    }
+
+    pass CountVoxelFragmentsCompact
+    {
+        SetVertexShader( CompileShader( vs_5_0, CreateVoxelArrayCompactVS() ) );
+        SetGeometryShader( CompileShader( gs_5_0, CreateVoxelArrayGS() ) );
+        SetPixelShader( CompileShader( ps_5_0, CountVoxelFragmentsPS() ) );
+    }
     
     // during these passes we construct octree level by level
     // for (currentOctreeLevel = 0; currentOctreeLevel < octreeHeight - 1; currentOctreeLevel++)
@@ -274,6 +358,36 @@ technique11 GenerateOctree
         SetPixelShader( NULL );
     }
 
-    // additional pass to merge voxels ?
+    // empty space field after ConnectNodesToVoxels, one vertex per cell: MarkEmptySpace, then a pass per axis
+    // with emptySpaceR and emptySpaceRW swapped between them
+    pass MarkEmptySpace
+    {
+        SetVertexShader( CompileShader( vs_5_0, MarkEmptySpaceVS() ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( NULL );
+    }
+
+    pass EmptySpaceAlongAxisX
+    {
+        SetVertexShader( CompileShader( vs_5_0, EmptySpaceAlongAxisVS( 0 ) ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( NULL );
+    }
+
+    pass EmptySpaceAlongAxisY
+    {
+        SetVertexShader( CompileShader( vs_5_0, EmptySpaceAlongAxisVS( 1 ) ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( NULL );
+    }
+
+    pass EmptySpaceAlongAxisZ
+    {
+        SetVertexShader( CompileShader( vs_5_0, EmptySpaceAlongAxisVS( 2 ) ) );
+        SetGeometryShader( NULL );
+        SetPixelShader( NULL );
+    }
+
+    // voxels are merged on cpu between CreateVoxelArray and FlagNodes, see Core/VoxelMerge.h
     //     think about dynamic part of octree?
 }
\ No newline at end of file
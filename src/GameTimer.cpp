@@ -1,34 +1,33 @@
 #include <GameTimer.h>
-#include <windows.h>
+#include <algorithm>
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static float ToSeconds( GameTimer::Clock::duration d )
+{
+    return std::max( 0.0f, std::chrono::duration_cast< std::chrono::duration< float > >( d ).count( ) );
+}
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 GameTimer::GameTimer( ) : 
     mStopped(true),
     mDeltaTime(0),
-    mCurrTime(0),
-    mPrevTime(0),
-    mPausedTime(0)
+    mPausedTime(Clock::duration::zero())
 {
-    __int64 countsPerSec = 0;
-    QueryPerformanceFrequency( ( LARGE_INTEGER* )( &countsPerSec ) );
-    mSecondsPerCount = 1.0f / countsPerSec;
-
     // starting point
-    QueryPerformanceCounter( ( LARGE_INTEGER* )( &mBaseTime ) );
+    mBaseTime = Clock::now( );
     mStopTime = mBaseTime;
+    mCurrTime = mBaseTime;
+    mPrevTime = mBaseTime;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void GameTimer::Start()
 {
     if ( mStopped )
     {
-        __int64 currTime = 0;
-        QueryPerformanceCounter( ( LARGE_INTEGER* )( &currTime ) );
+        Clock::time_point currTime = Clock::now( );
 
         mPausedTime += currTime - mStopTime;
         mPrevTime = currTime;
-        mCurrTime = mStopTime;
-        mStopTime = 0;
+        mCurrTime = currTime;
 
         mStopped = false;
     }
@@ -41,7 +40,7 @@ void GameTimer::Stop()
     if ( mStopped )
         return;
 
-    QueryPerformanceCounter( ( LARGE_INTEGER* )( &mStopTime ) );
+    mStopTime = Clock::now( );
     mDeltaTime = 0;
     mPrevTime = mStopTime;
     mCurrTime = mStopTime;
@@ -50,16 +49,15 @@ void GameTimer::Stop()
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void GameTimer::Reset( )
 {
-    __int64 currTime = 0;
-    QueryPerformanceCounter( ( LARGE_INTEGER* )( &currTime ) );
+    Clock::time_point currTime = Clock::now( );
 
     mBaseTime = currTime;
     mCurrTime = currTime;
     mPrevTime = currTime;
+    mStopTime = currTime;
 
     mDeltaTime = 0;
-    mPausedTime = 0;
-    mStopTime = 0;
+    mPausedTime = Clock::duration::zero();
 
     mStopped = false;
 }
@@ -72,15 +70,16 @@ void GameTimer::Tick()
         return;
     }
 
-    QueryPerformanceCounter( ( LARGE_INTEGER* )( &mCurrTime ) );
-    mDeltaTime = max( 0, ( mCurrTime - mPrevTime ) * mSecondsPerCount );
+    mCurrTime = Clock::now( );
+    mDeltaTime = ToSeconds( mCurrTime - mPrevTime );
     mPrevTime = mCurrTime;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 float GameTimer::GetLiveTime()
 {
-    QueryPerformanceCounter( ( LARGE_INTEGER* )( &mCurrTime ) );
-    return max( 0, ( mCurrTime - mBaseTime - mPausedTime ) * mSecondsPerCount );
+    // paused timer doesn't run
+    Clock::time_point now = mStopped ? mStopTime : Clock::now( );
+    return ToSeconds( now - mBaseTime - mPausedTime );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 float GameTimer::GetDeltaTime()
@@ -98,4 +97,4 @@ GameTimer& GameTimer::GetAppTimer( )
     static GameTimer appTimer;
     return appTimer;
 }
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
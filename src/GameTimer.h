@@ -1,9 +1,14 @@
 #ifndef __GAME_TIMER_H
 #define __GAME_TIMER_H
 
+#include <chrono>
+
+// portable timer based on std::chrono::steady_clock
 class GameTimer
 {
 public:
+    typedef std::chrono::steady_clock Clock;
+
     GameTimer();
 
     void Start();
@@ -19,16 +24,15 @@ public:
     // TODO we don't have any engine class yet, so we put main timer here
     static GameTimer &GetAppTimer();
 private:
-    float mSecondsPerCount;
     float mDeltaTime;
 
-    __int64 mBaseTime;
-    __int64 mPausedTime;
-    __int64 mStopTime;
-    __int64 mPrevTime;
-    __int64 mCurrTime;
+    Clock::time_point mBaseTime;
+    Clock::duration mPausedTime;
+    Clock::time_point mStopTime;
+    Clock::time_point mPrevTime;
+    Clock::time_point mCurrTime;
 
     bool mStopped;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,8 +1,7 @@
 #include <GeometryGenerator.h>
 #include <GlobalUtils.h>
 #include <algorithm>
-
-using namespace DirectX;
+#include <math.h>
 
 float AngleFromXY( float x, float y );
 
@@ -14,21 +13,19 @@ void GeometryGenerator::CalculateTBN( GGMeshData &data, const std::vector<std::v
     int vsize = vertexCoherence.size();
     for ( int iv0 = 0; iv0 < vsize; iv0++ )
     {
-        auto &vcBegin = vertexCoherence[iv0].cbegin();
-        auto &vcEnd = vertexCoherence[iv0].cend( );
+        auto vcBegin = vertexCoherence[iv0].cbegin();
+        auto vcEnd = vertexCoherence[iv0].cend( );
         auto &curVertex = data.verticies[iv0];
-        XMVECTOR binormal( XMVectorZero( ) ), normal( XMVectorZero( ) );
+        Vec3 binormal, normal;
 
-        for ( auto &vPair = vcBegin; vPair != vcEnd; ++vPair )
+        for ( auto vPair = vcBegin; vPair != vcEnd; ++vPair )
         {
             int iv1 = vPair->first, iv2 = vPair->second;
-            binormal += XMLoadFloat3( &CalculateBinormal( curVertex, data.verticies[iv1], data.verticies[iv2] ) );
-            normal += XMLoadFloat3( &curVertex.normal );
+            binormal = Add( binormal, CalculateBinormal( curVertex, data.verticies[iv1], data.verticies[iv2] ) );
+            normal = Add( normal, curVertex.normal );
         }
-        binormal = XMVector3Normalize( binormal );
-        normal = XMVector3Normalize( normal );
-        XMStoreFloat3( &curVertex.binormal, binormal );
-        XMStoreFloat3( &curVertex.normal, normal );
+        curVertex.binormal = Normalize( binormal );
+        curVertex.normal = Normalize( normal );
     }
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -56,10 +53,10 @@ void GeometryGenerator::GeneratePlane( float width, float depth, uint32_t n, uin
             float z = -depth * 0.5f + j * dz;
 
             GGVertex &v = meshData.verticies[i * m + j];
-            v.position = XMFLOAT3( x, 0.0f, z );
-            v.normal = XMFLOAT3( 0.0f, 1.0f, 0.0f );
-            v.binormal = XMFLOAT3( 0.0f, 0.0f, 1.0f );
-            v.UVW = XMFLOAT3( du * i, dv * j, 0.0f );
+            v.position = Vec3( x, 0.0f, z );
+            v.normal = Vec3( 0.0f, 1.0f, 0.0f );
+            v.binormal = Vec3( 0.0f, 0.0f, 1.0f );
+            v.UVW = Vec3( du * i, dv * j, 0.0f );
         }
     }
 
@@ -84,14 +81,14 @@ void GeometryGenerator::GenerateCube( GGMeshData &meshData )
     meshData.verticies.resize( 8 );
 
     std::vector<GGVertex> &v = meshData.verticies;
-    v[0].position = XMFLOAT3( -1.0f, -1.0f, -1.0f );
-    v[1].position = XMFLOAT3( -1.0f, 1.0f, -1.0f );
-    v[2].position = XMFLOAT3( 1.0f, 1.0f, -1.0f );
-    v[3].position = XMFLOAT3( 1.0f, -1.0f, -1.0f );
-    v[4].position = XMFLOAT3( -1.0f, -1.0f, 1.0f );
-    v[5].position = XMFLOAT3( -1.0f, 1.0f, 1.0f );
-    v[6].position = XMFLOAT3( 1.0f, 1.0f, 1.0f );
-    v[7].position = XMFLOAT3( 1.0f, -1.0f, 1.0f );
+    v[0].position = Vec3( -1.0f, -1.0f, -1.0f );
+    v[1].position = Vec3( -1.0f, 1.0f, -1.0f );
+    v[2].position = Vec3( 1.0f, 1.0f, -1.0f );
+    v[3].position = Vec3( 1.0f, -1.0f, -1.0f );
+    v[4].position = Vec3( -1.0f, -1.0f, 1.0f );
+    v[5].position = Vec3( -1.0f, 1.0f, 1.0f );
+    v[6].position = Vec3( 1.0f, 1.0f, 1.0f );
+    v[7].position = Vec3( 1.0f, -1.0f, 1.0f );
 
     // TODO normal, tangent, uvw
 
@@ -128,7 +125,7 @@ void GeometryGenerator::GenerateCylinder( float height, float topRadius, float b
 
     float dr = ( topRadius - bottomRadius ) / stackCount;
     float dh = height / stackCount;
-    float da = XM_2PI / sliceCount;
+    float da = ( 2.0f * PI ) / sliceCount;
 
     // generate middle
     //       /\ v
@@ -151,19 +148,15 @@ void GeometryGenerator::GenerateCylinder( float height, float topRadius, float b
             float c = cosf( alpha );
             float s = sinf( alpha );
 
-            v.position = XMFLOAT3( r * c, y, r * s );
+            v.position = Vec3( r * c, y, r * s );
 
             // note: possibly incorrect
             v.UVW.x = static_cast<float>( j ) / sliceCount;
             v.UVW.y = 1.0f - static_cast<float>( i ) / stackCount;
 
-            v.binormal = XMFLOAT3( -s, 0.0f, c ); // TODO this is tangent calculation and should be replaced by binormal calculatuion
-            XMFLOAT3 bitangent( dr * c, -height, dr * s );
-
-            XMVECTOR T = XMLoadFloat3( &v.binormal );
-            XMVECTOR B = XMLoadFloat3( &bitangent );
-            XMVECTOR N = XMVector3Normalize( XMVector3Cross( T, B ) );
-            XMStoreFloat3( &v.normal, N );
+            v.binormal = Vec3( -s, 0.0f, c ); // TODO this is tangent calculation and should be replaced by binormal calculatuion
+            Vec3 bitangent( dr * c, -height, dr * s );
+            v.normal = Normalize( Cross( v.binormal, bitangent ) );
 
             meshData.verticies.push_back( v );
         }
@@ -197,14 +190,14 @@ void GeometryGenerator::GenerateGeoSphere( float radius, uint32_t subDivNum, GGM
     const float pX = 0.525731f;
     const float pZ = 0.850651f;
 
-    XMFLOAT3 pos[12] =
+    Vec3 pos[12] =
     {
-        XMFLOAT3( -pX, 0.0f, pZ ), XMFLOAT3( pX, 0.0f, pZ ),
-        XMFLOAT3( -pX, 0.0f, -pZ ), XMFLOAT3( pX, 0.0f, -pZ ),
-        XMFLOAT3( 0.0f, pZ, pX ), XMFLOAT3( 0.0f, pZ, -pX ),
-        XMFLOAT3( 0.0f, -pZ, pX ), XMFLOAT3( 0.0f, -pZ, -pX ),
-        XMFLOAT3( pZ, pX, 0.0f ), XMFLOAT3( -pZ, pX, 0.0f ),
-        XMFLOAT3( pZ, -pX, 0.0f ), XMFLOAT3( -pZ, -pX, 0.0f ),
+        Vec3( -pX, 0.0f, pZ ), Vec3( pX, 0.0f, pZ ),
+        Vec3( -pX, 0.0f, -pZ ), Vec3( pX, 0.0f, -pZ ),
+        Vec3( 0.0f, pZ, pX ), Vec3( 0.0f, pZ, -pX ),
+        Vec3( 0.0f, -pZ, pX ), Vec3( 0.0f, -pZ, -pX ),
+        Vec3( pZ, pX, 0.0f ), Vec3( -pZ, pX, 0.0f ),
+        Vec3( pZ, -pX, 0.0f ), Vec3( -pZ, -pX, 0.0f ),
     };
 
     meshData.verticies.resize( 12 );
@@ -226,31 +219,29 @@ void GeometryGenerator::GenerateGeoSphere( float radius, uint32_t subDivNum, GGM
     {
         GGVertex &v = meshData.verticies[i];
 
-        XMVECTOR n = XMVector3Normalize( XMLoadFloat3( &v.position ) );
-        XMVECTOR p = radius * n;
-        XMStoreFloat3( &meshData.verticies[i].position, p );
-        XMStoreFloat3( &meshData.verticies[i].normal, n );
+        Vec3 n = Normalize( v.position );
+        v.position = Scale( n, radius );
+        v.normal = n;
 
         float theta = AngleFromXY( v.position.x, v.position.z );
         float phi = acosf( v.normal.y );
 
-        v.UVW.x = theta / XM_2PI;
-        v.UVW.y = phi / XM_PI;
+        v.UVW.x = theta / ( 2.0f * PI );
+        v.UVW.y = phi / PI;
 
         // TODO this is tangent calculation and should be replaced by binormal calculatuion
-        v.binormal = XMFLOAT3( -radius * sinf( phi )* sinf( theta ),
+        v.binormal = Vec3( -radius * sinf( phi )* sinf( theta ),
             0.0f,
             radius * sinf( phi ) * cos( theta ) );
 
-        XMVECTOR T = XMLoadFloat3( &v.binormal );
-        XMStoreFloat3( &v.binormal, XMVector3Normalize( T ) );
+        v.binormal = Normalize( v.binormal );
     }
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-XMFLOAT3 GeometryGenerator::CalculateBinormal( const GGVertex &v0, const GGVertex &v1, const GGVertex &v2 )
+Vec3 GeometryGenerator::CalculateBinormal( const GGVertex &v0, const GGVertex &v1, const GGVertex &v2 )
 {
-    XMFLOAT3 e0 = XMFLOAT3( v1.position.x - v0.position.x, v1.position.y - v0.position.y, v1.position.z - v0.position.z );
-    XMFLOAT3 e1 = XMFLOAT3( v2.position.x - v0.position.x, v2.position.y - v0.position.y, v2.position.z - v0.position.z );
+    Vec3 e0 = Vec3( v1.position.x - v0.position.x, v1.position.y - v0.position.y, v1.position.z - v0.position.z );
+    Vec3 e1 = Vec3( v2.position.x - v0.position.x, v2.position.y - v0.position.y, v2.position.z - v0.position.z );
 
     float du0 = v1.UVW.x - v0.UVW.x;
     float du1 = v2.UVW.x - v0.UVW.x;
@@ -258,7 +249,7 @@ XMFLOAT3 GeometryGenerator::CalculateBinormal( const GGVertex &v0, const GGVerte
     float dv1 = v2.UVW.y - v0.UVW.y;
     
     float determ = 1.0f / ( du0 * dv1 - du1 * dv0 );
-    return XMFLOAT3( ( -du1 * e0.x + du0 * e1.x ) * determ,
+    return Vec3( ( -du1 * e0.x + du0 * e1.x ) * determ,
         ( -du1 * e0.y + du0 * e1.y ) * determ,
         ( -du1 * e0.z + du0 * e1.z ) * determ );
 }
@@ -267,7 +258,7 @@ void GeometryGenerator::GenerateCap( uint32_t sliceCount, float y, bool topCap,
 {
     uint32_t baseIndex = meshData.verticies.size( );
 
-    float da = XM_2PI / sliceCount;
+    float da = ( 2.0f * PI ) / sliceCount;
     for ( uint32_t i = 0; i <= sliceCount; ++i )
     {
         float alpha = da * i;
@@ -310,15 +301,17 @@ void GeometryGenerator::Subdivide( GGMeshData& meshData )
     meshData.verticies.resize( 0 );
     meshData.indicies.resize( 0 );
 
-    //       v1
-    //       *
-    //      / \
-    //     /   \
-    //  m0*-----*m1
-    //   / \   / \
-    //  /   \ /   \
-    // *-----*-----*
-    // v0    m2     v2
+    /*
+           v1
+           *
+          / \
+         /   \
+      m0*-----*m1
+       / \   / \
+      /   \ /   \
+     *-----*-----*
+     v0    m2     v2
+    */
 
     size_t numTris = inputCopy.indicies.size() / 3;
     for ( size_t i = 0; i < numTris; ++i )
@@ -336,17 +329,17 @@ void GeometryGenerator::Subdivide( GGMeshData& meshData )
         // For subdivision, we just care about the position component.  We derive the other
         // vertex components in CreateGeosphere.
 
-        m0.position = XMFLOAT3(
+        m0.position = Vec3(
             0.5f*( v0.position.x + v1.position.x ),
             0.5f*( v0.position.y + v1.position.y ),
             0.5f*( v0.position.z + v1.position.z ) );
 
-        m1.position = XMFLOAT3(
+        m1.position = Vec3(
             0.5f*( v1.position.x + v2.position.x ),
             0.5f*( v1.position.y + v2.position.y ),
             0.5f*( v1.position.z + v2.position.z ) );
 
-        m2.position = XMFLOAT3(
+        m2.position = Vec3(
             0.5f*( v0.position.x + v2.position.x ),
             0.5f*( v0.position.y + v2.position.y ),
             0.5f*( v0.position.z + v2.position.z ) );
@@ -393,12 +386,12 @@ float AngleFromXY( float x, float y )
         theta = atanf( y / x ); // in [-pi/2, +pi/2]
 
         if ( theta < 0.0f )
-            theta += 2.0f * XM_PI; // in [0, 2*pi).
+            theta += 2.0f * PI; // in [0, 2*pi).
     }
 
     // Quadrant II or III
     else
-        theta = atanf( y / x ) + XM_PI; // in [0, 2*pi).
+        theta = atanf( y / x ) + PI; // in [0, 2*pi).
 
     return theta;
 }
@@ -1,9 +1,10 @@
 #ifndef __GEOMETRY_GENERATOR_H
 #define  __GEOMETRY_GENERATOR_H
 
+#include <stdint.h>
 #include <string>
 #include <vector>
-#include <DirectXMath.h>
+#include <Core/VMath.h>
 
 struct GGVertex
 {
@@ -24,10 +25,10 @@ struct GGVertex
         UVW( u, v, w )
     {}
 
-    DirectX::XMFLOAT3 position;
-    DirectX::XMFLOAT3 normal;
-    DirectX::XMFLOAT3 binormal;
-    DirectX::XMFLOAT3 UVW;
+    Vec3 position;
+    Vec3 normal;
+    Vec3 binormal;
+    Vec3 UVW;
 };
 
 struct GGMeshData
@@ -47,7 +48,7 @@ public:
     static void GenerateGeoSphere( float radius, uint32_t subDivNum, GGMeshData &meshData );
 
 private:
-    static DirectX::XMFLOAT3 GeometryGenerator::CalculateBinormal( const GGVertex &v0, const GGVertex &v1, const GGVertex &v2 );
+    static Vec3 CalculateBinormal( const GGVertex &v0, const GGVertex &v1, const GGVertex &v2 );
     static void GenerateCap( uint32_t sliceCount, float y, bool topCap, float radius, GGMeshData &meshData );
     static void Subdivide( GGMeshData& meshData );
 };
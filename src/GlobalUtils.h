@@ -59,7 +59,7 @@ void WriteLog( LoggerLevel level, const char *moduleName, int line, const Types&
 #define LOG_ERROR( ... ) LOG( LOG_ERROR, __VA_ARGS__ )
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #define ASSERT_( condition, ... ) if ( !(condition) ) { LOG_ERROR( "\tAssert! Condition: ", #condition, "\t", __VA_ARGS__); assert(false); }
-#define ASSERT( condition, ... ) ASSERT_( condition, "", __VA_ARGS__ )
+#define ASSERT( ... ) ASSERT_( __VA_ARGS__, "" ) // message is optional, trailing "" keeps gcc happy without it
 #define WARNING( condition, ... ) if ( condition ) LOG_INFO( "\tWarning! Condition: ", #condition, "\t", __VA_ARGS__ )
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 template< typename T >
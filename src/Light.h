@@ -10,7 +10,8 @@ struct LightSource
         position( 0.0, 0.0, 0.0 ),
         direction( 0.0, -1.0, 0.0 ),
         color( 0.0, 0.0, 0.0 ),
-        radius( 0.0 )
+        radius( 0.0 ),
+        spotAngle( 0.0 )
     {
 
     }
@@ -26,7 +27,8 @@ struct LightSource
             compareXMFLOAT3( color, r.color ) &&
             compareXMFLOAT3( position, r.position ) &&
             compareXMFLOAT3( direction, r.direction ) &&
-            radius == r.radius;
+            radius == r.radius &&
+            spotAngle == r.spotAngle;
     }
 
     bool operator!=( const LightSource &r ) const
@@ -34,17 +36,20 @@ struct LightSource
         return !( *this == r );
     }
 
+    // must match LightKind in Core/LightManager.h
     enum LightType
     {
-        DIRECTIONAL
-        // POINT
+        DIRECTIONAL,
+        POINT,
+        SPOT
     } type;
 
     DirectX::XMFLOAT3 position;
     DirectX::XMFLOAT3 direction;
     DirectX::XMFLOAT3 color;
 
-    float radius;
+    float radius; // sun distance, point and spot range
+    float spotAngle; // cone half angle in radians
     // bool castShadow
 };
 
@@ -21,8 +21,8 @@ bool Blur::IsReady()
     return mIsReady;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void Blur::UpscaleBlur( std::shared_ptr<D3DTextureBuffer2D> &depth, std::shared_ptr<D3DTextureBuffer2D> &smallTex,
-    std::shared_ptr<D3DTextureBuffer2D> &bigTexTmp, std::shared_ptr<D3DTextureBuffer2D> &bigTexRT )
+void Blur::UpscaleBlur( std::shared_ptr<D3DTextureBuffer2D> &depth, std::shared_ptr<D3DTextureBuffer2D> &normal,
+    std::shared_ptr<D3DTextureBuffer2D> &smallTex, std::shared_ptr<D3DTextureBuffer2D> &bigTexRT )
 {
     if ( !mIsReady )
         return;
@@ -30,49 +30,53 @@ void Blur::UpscaleBlur( std::shared_ptr<D3DTextureBuffer2D> &depth, std::shared_
     D3DRenderer &renderer = D3DRenderer::Get( );
     auto immediateContext = renderer.GetContext( );
 
-    // prepare blur
+    // prepare upsample
     DirectX::XMFLOAT4X4 view, proj;
     renderer.GetFullscreenQuadMats( view, proj );
     DirectX::XMMATRIX worldViewProj = DirectX::XMLoadFloat4x4( &view ) * DirectX::XMLoadFloat4x4( &proj );
     mfx.mfxWorldViewProj->SetMatrix( reinterpret_cast< float* >( &worldViewProj ) );
 
     Settings &settings = Settings::Get( );
-    float radius = settings.mBlurRadius;
-    mfx.mfxSharpness->SetFloat( settings.mBlurSharpness );
-    mfx.mfxRadius->SetFloat( radius );
-    float sigma = ( radius + 1.0f ) * 0.5f;
-    mfx.mfxFalloff->SetFloat( 1.0f / ( 2.0f * sigma * sigma ) );
-    mfx.mfxDepthTexture->SetResource( depth->GetSRV() );
+    float smallWidth = static_cast< float >( smallTex->GetWidth( ) );
+    float smallHeight = static_cast< float >( smallTex->GetHeight( ) );
+    float scaleX = smallWidth / bigTexRT->GetWidth( );
+    float scaleY = smallHeight / bigTexRT->GetHeight( );
+    if ( settings.mBlurRadius != mWeightsRadius || scaleX != mWeightsScaleX || scaleY != mWeightsScaleY )
+    {
+        mWeights.Build( settings.mBlurRadius, scaleX, scaleY );
+        mWeightsRadius = settings.mBlurRadius;
+        mWeightsScaleX = scaleX;
+        mWeightsScaleY = scaleY;
+    }
 
-    float pixelOffset[] = { 1.0f / depth->GetWidth( ), 1.0f / depth->GetHeight( ) };
-    mfx.mfxPixelOffset->SetFloatVector( pixelOffset );
+    const float log2e = 1.44269504f;
+    mfx.mfxDepthSharpness->SetFloat( settings.mBlurSharpness * log2e );
+    mfx.mfxNormalSharpness->SetFloat( settings.mBlurNormalSharpness * log2e );
+    mfx.mfxUpsampleRadius->SetInt( mWeights.mRadius );
+    mfx.mfxUpsampleWeightsX->SetFloatArray( mWeights.mWeights[0], 0, UPSAMPLE_PHASES * UPSAMPLE_TAPS );
+    mfx.mfxUpsampleWeightsY->SetFloatArray( mWeights.mWeights[1], 0, UPSAMPLE_PHASES * UPSAMPLE_TAPS );
 
-    // prepare X pass
-    renderer.SetViewport( static_cast< float >( bigTexTmp->GetWidth( ) ), 
-        static_cast< float >( bigTexTmp->GetHeight( ) ), 0.0f, 1.0f, 0, 0 );
+    float lowResSize[] = { smallWidth, smallHeight };
+    mfx.mfxLowResSize->SetFloatVector( lowResSize );
 
-    ID3D11RenderTargetView* tmpRT = bigTexTmp->GetRTV();
-    immediateContext->OMSetRenderTargets( 1, &tmpRT, nullptr );
-    mfx.mfxColorTex->SetResource( smallTex->GetSRV() );
+    mfx.mfxDepthTexture->SetResource( depth->GetSRV( ) );
+    mfx.mfxNormalTexture->SetResource( normal->GetSRV( ) );
+    mfx.mfxColorTex->SetResource( smallTex->GetSRV( ) );
 
-    mfx.mfxPassX->Apply( 0, immediateContext );
-    renderer.DrawGeometry( renderer.GetQuad( ) );
-
-    // prepare Y pass
-    tmpRT = bigTexRT->GetRTV( );
-    immediateContext->OMSetRenderTargets( 1, &tmpRT, nullptr );
-    mfx.mfxPassY->Apply( 0, immediateContext ); // apply rt here to set bigTexTmp as srv (effect11 lack)
+    renderer.SetViewport( static_cast< float >( bigTexRT->GetWidth( ) ),
+        static_cast< float >( bigTexRT->GetHeight( ) ), 0.0f, 1.0f, 0, 0 );
 
-    mfx.mfxBlurXTex->SetResource( bigTexTmp->GetSRV() );
+    ID3D11RenderTargetView* rt = bigTexRT->GetRTV( );
+    immediateContext->OMSetRenderTargets( 1, &rt, nullptr );
 
-    mfx.mfxPassY->Apply( 0, immediateContext );
+    mfx.mfxPassUpsample->Apply( 0, immediateContext );
     renderer.DrawGeometry( renderer.GetQuad( ) );
 
     // clear pipeline
     mfx.mfxDepthTexture->SetResource( nullptr );
+    mfx.mfxNormalTexture->SetResource( nullptr );
     mfx.mfxColorTex->SetResource( nullptr );
-    mfx.mfxBlurXTex->SetResource( nullptr );
-    mfx.mfxPassY->Apply( 0, immediateContext );
+    mfx.mfxPassUpsample->Apply( 0, immediateContext );
 
     renderer.SetDefaultViewport( );
 }
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <FXBindings/FXBlur.h>
+#include <Core/BilateralUpsample.h>
 
 class D3DTextureBuffer2D;
 
@@ -14,14 +15,20 @@ public:
     bool Init( );
     bool IsReady( );
 
-    // generate depth-based blur, use separate X Y passes and need tmp texture
-    void UpscaleBlur( std::shared_ptr<D3DTextureBuffer2D> &depth, std::shared_ptr<D3DTextureBuffer2D> &smallTex,
-        std::shared_ptr<D3DTextureBuffer2D> &bigTexTmp, std::shared_ptr<D3DTextureBuffer2D> &bigTexRT );
+    // joint bilateral upsample of smallTex into bigTexRT guided by depth and normals, single pass
+    void UpscaleBlur( std::shared_ptr<D3DTextureBuffer2D> &depth, std::shared_ptr<D3DTextureBuffer2D> &normal,
+        std::shared_ptr<D3DTextureBuffer2D> &smallTex, std::shared_ptr<D3DTextureBuffer2D> &bigTexRT );
 
 private:
     bool mIsReady = false;
 
     FXBlur mfx;
+
+    // spatial weight lut, rebuilt when radius or resolution ratio changes
+    UpsampleWeights mWeights;
+    float mWeightsRadius = -1.0f;
+    float mWeightsScaleX = -1.0f;
+    float mWeightsScaleY = -1.0f;
 };
 
 #endif
\ No newline at end of file
@@ -2,7 +2,7 @@
 #include <GlobalUtils.h>
 #include <GeometryGenerator.h>
 #include <D3DRenderer.h>
-#include <Settings.h>
+#include <Core/CompactVertex.h>
 
 std::set<D3DGeometryBuffer*> D3DGeometryBuffer::mInternalStorage;
 
@@ -13,88 +13,105 @@ struct D3DGeometryBuffer::_GeometryBufferAgregator : public D3DGeometryBuffer
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::shared_ptr<D3DGeometryBuffer> D3DGeometryBuffer::Create( const GGMeshData &data )
+size_t D3DGeometryBuffer::GetVertexStride( VertexFormat format )
+{
+    switch ( format )
+    {
+    case V_3F3F3F2F:
+        return sizeof( Vertex3F3F3F2F );
+    case V_COMPACT16:
+        return sizeof( CompactVertex );
+    default:
+        ASSERT( false, "Unknown vertex format ", format );
+        return 0;
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<D3DGeometryBuffer> D3DGeometryBuffer::Create( const GGMeshData &data, VertexFormat format )
 {
-    D3DRenderer &renderer = D3DRenderer::Get( );
-    std::shared_ptr<D3DGeometryBuffer> agregator = std::make_shared<_GeometryBufferAgregator>( );
     std::vector<Vertex3F3F3F2F> verticies;
+    verticies.reserve( data.verticies.size( ) );
 
     for ( size_t i = 0; i < data.verticies.size( ); i++ )
     {
         Vertex3F3F3F2F v;
         const GGVertex &ggv = data.verticies[i];
-        v.mPosition = ggv.position;
-        v.mNormal = ggv.normal;
-        v.mBinormal = ggv.binormal;
+        v.mPosition = DirectX::XMFLOAT3( ggv.position.x, ggv.position.y, ggv.position.z );
+        v.mNormal = DirectX::XMFLOAT3( ggv.normal.x, ggv.normal.y, ggv.normal.z );
+        v.mBinormal = DirectX::XMFLOAT3( ggv.binormal.x, ggv.binormal.y, ggv.binormal.z );
         v.mUV = DirectX::XMFLOAT2( ggv.UVW.x, ggv.UVW.y );
 
         verticies.push_back( v );
-        renderer.CalcStaticSceneBB( v.mPosition );
     }
 
-    FillGeometryBufferAgregator( agregator, verticies, data.indicies );
-
-    agregator->mIndexCount = data.indicies.size( );
-    agregator->mFormat = D3DGeometryBuffer::V_3F3F3F2F;
-
-    if ( Settings::Get( ).mSaveScene )
-    {
-        agregator->mRawVB = verticies;
-        agregator->mRawIB = data.indicies;
-    }
-
-    return agregator;
+    return Create( verticies.data( ), verticies.size( ), data.indicies.data( ), data.indicies.size( ), format );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 std::shared_ptr<D3DGeometryBuffer> D3DGeometryBuffer::Create(
-    const std::vector<Vertex3F3F3F2F> &vBuf, const std::vector<uint32_t> &iBuf )
+    const Vertex3F3F3F2F *vBuf, size_t vCount, const uint32_t *iBuf, size_t iCount, VertexFormat format )
 {
     D3DRenderer &renderer = D3DRenderer::Get( );
     std::shared_ptr<D3DGeometryBuffer> agregator = std::make_shared<_GeometryBufferAgregator>( );
 
-    for ( size_t i = 0; i < vBuf.size(); i++ )
+    for ( size_t i = 0; i < vCount; i++ )
+    {
         renderer.CalcStaticSceneBB( vBuf[i].mPosition );
+        agregator->mBoundingBox.Extend( &vBuf[i].mPosition.x );
+    }
 
-    FillGeometryBufferAgregator( agregator, vBuf, iBuf );
-
-    agregator->mIndexCount = iBuf.size( );
-    agregator->mFormat = D3DGeometryBuffer::V_3F3F3F2F;
-
-    if ( Settings::Get( ).mSaveScene )
+    agregator->mFormat = format;
+    if ( format == V_COMPACT16 )
     {
-        agregator->mRawVB = vBuf;
-        agregator->mRawIB = iBuf;
+        // quantize against the object bounds, the slot goes into every vertex so merged draws still decode
+        static_assert( sizeof( SceneVertex ) == sizeof( Vertex3F3F3F2F ), "scene vertex must match geometry buffer vertex" );
+        const SceneVertex *sceneVertices = reinterpret_cast< const SceneVertex* >( vBuf );
+        CompactVertexBounds bounds = ComputeCompactVertexBounds( sceneVertices, vCount );
+        agregator->mBoundsSlot = renderer.AllocateGeometryBounds( bounds );
+        ASSERT( agregator->mBoundsSlot >= 0, "Out of geometry bounds slots" );
+        if ( agregator->mBoundsSlot < 0 )
+            return agregator;
+
+        std::vector<CompactVertex> compact( vCount );
+        EncodeCompactVertices( sceneVertices, vCount, bounds, static_cast< uint16_t >( agregator->mBoundsSlot ), compact.data( ) );
+        FillGeometryBufferAgregator( agregator, compact.data( ), vCount, iBuf, iCount );
     }
+    else
+        FillGeometryBufferAgregator( agregator, vBuf, vCount, iBuf, iCount );
 
     return agregator;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ID3D11Buffer* D3DGeometryBuffer::GetVB( ) const
 {
-    ASSERT( mVB );
-    return mVB;
+    ASSERT( mAllocated );
+    return D3DRenderer::Get( ).GetGeometryPool( mFormat ).GetVB( mRange.mPage );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ID3D11Buffer* D3DGeometryBuffer::GetIB( ) const
 {
-    ASSERT( mIB );
-    return mIB;
+    ASSERT( mAllocated );
+    return D3DRenderer::Get( ).GetGeometryPool( mFormat ).GetIB( mRange.mPage );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 int D3DGeometryBuffer::GetIndexCount( ) const
 {
-    ASSERT( mIndexCount );
-    return mIndexCount;
+    ASSERT( mRange.mIndexCount );
+    return static_cast< int >( mRange.mIndexCount );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int D3DGeometryBuffer::GetFirstIndex( ) const
+{
+    return static_cast< int >( mRange.mFirstIndex );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::vector<Vertex3F3F3F2F>& D3DGeometryBuffer::GetRawVB( )
+const GeometryRange& D3DGeometryBuffer::GetRange( ) const
 {
-    return mRawVB;
+    return mRange;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::vector<uint32_t>& D3DGeometryBuffer::GetRawIB( )
+const AABB& D3DGeometryBuffer::GetBoundingBox( ) const
 {
-    return mRawIB;
+    return mBoundingBox;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 std::set<D3DGeometryBuffer*>& D3DGeometryBuffer::GetStorage()
@@ -103,55 +120,32 @@ std::set<D3DGeometryBuffer*>& D3DGeometryBuffer::GetStorage()
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void D3DGeometryBuffer::FillGeometryBufferAgregator( std::shared_ptr<D3DGeometryBuffer> &agregator,
-    const std::vector<Vertex3F3F3F2F> &vBuf, const std::vector<uint32_t> &iBuf )
+    const void *vBuf, size_t vCount, const uint32_t *iBuf, size_t iCount )
 {
-    D3DRenderer &renderer = D3DRenderer::Get( );
-    auto device = renderer.GetDevice();
-
-    D3D11_BUFFER_DESC vbd;
-    vbd.Usage = D3D11_USAGE_IMMUTABLE;
-    vbd.ByteWidth = vBuf.size( ) * sizeof( Vertex3F3F3F2F );
-    vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    vbd.CPUAccessFlags = 0;
-    vbd.MiscFlags = 0;
-    vbd.StructureByteStride = 0;
-
-    D3D11_SUBRESOURCE_DATA vinitData;
-    vinitData.SysMemPitch = 0;
-    vinitData.SysMemSlicePitch = 0;
-    vinitData.pSysMem = &vBuf[0];
-    HRESULT hr = device->CreateBuffer( &vbd, &vinitData, &agregator->mVB );
-    ASSERT( hr == S_OK );
+    // copy mesh into shared vertex/index buffers of its format
+    D3DGeometryPool &pool = D3DRenderer::Get( ).GetGeometryPool( agregator->mFormat );
+    ASSERT( pool.GetVertexStride( ) == GetVertexStride( agregator->mFormat ) );
 
-    D3D11_BUFFER_DESC ibd;
-    ibd.Usage = D3D11_USAGE_IMMUTABLE;
-    ibd.ByteWidth = iBuf.size( ) * sizeof( uint32_t );
-    ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    ibd.CPUAccessFlags = 0;
-    ibd.MiscFlags = 0;
-    ibd.StructureByteStride = 0;
-
-    D3D11_SUBRESOURCE_DATA iinitData;
-    iinitData.SysMemPitch = 0;
-    iinitData.SysMemSlicePitch = 0;
-    iinitData.pSysMem = &iBuf[0];
-    hr = device->CreateBuffer( &ibd, &iinitData, &agregator->mIB );
+    agregator->mAllocated = pool.Allocate( vBuf, vCount, iBuf, iCount, agregator->mRange );
+    ASSERT( agregator->mAllocated, "Can't allocate geometry in pool" );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-D3DGeometryBuffer::D3DGeometryBuffer()
+D3DGeometryBuffer::D3DGeometryBuffer() :
+    mFormat( V_3F3F3F2F ),
+    mAllocated( false ),
+    mBoundsSlot( -1 )
 {
     mInternalStorage.insert( this );
-
-    ID3D11Buffer *mVB = nullptr;
-    ID3D11Buffer *mIB = nullptr;
-    int mIndexCount = 0;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 D3DGeometryBuffer::~D3DGeometryBuffer( )
 {
     mInternalStorage.erase( this );
 
-    COMSafeRelease( mVB );
-    COMSafeRelease( mIB );
+    D3DRenderer &renderer = D3DRenderer::Get( );
+    if ( mAllocated )
+        renderer.GetGeometryPool( mFormat ).Free( mRange );
+    if ( mBoundsSlot >= 0 )
+        renderer.FreeGeometryBounds( mBoundsSlot );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -5,6 +5,8 @@
 #include <vector>
 #include <memory>
 #include <set>
+#include <D3DGeometryPool.h>
+#include <Core/Culling.h>
 
 struct ID3D11Buffer;
 struct GGMeshData;
@@ -17,39 +19,44 @@ struct Vertex3F3F3F2F
     DirectX::XMFLOAT2 mUV;
 };
 
+// mesh sub-allocated in renderer geometry pool, no cpu copy is kept after upload
 class D3DGeometryBuffer
 {
 public:
     enum VertexFormat
     {
-        V_3F3F3F2F
+        V_3F3F3F2F,
+        V_COMPACT16, // CompactVertex, position is decoded with the object bounds slot of the renderer
+
+        V_COUNT
     } mFormat;
 
-    static std::shared_ptr<D3DGeometryBuffer> Create( const GGMeshData &data );
-    static std::shared_ptr<D3DGeometryBuffer> Create( const std::vector<Vertex3F3F3F2F> &vBuf, const std::vector<uint32_t> &iBuf );
+    static size_t GetVertexStride( VertexFormat format );
+
+    // compact vertices are encoded from the float ones here, every format lives in its own pool
+    static std::shared_ptr<D3DGeometryBuffer> Create( const GGMeshData &data, VertexFormat format = V_3F3F3F2F );
+    static std::shared_ptr<D3DGeometryBuffer> Create( const Vertex3F3F3F2F *vBuf, size_t vCount, const uint32_t *iBuf, size_t iCount,
+        VertexFormat format = V_3F3F3F2F );
 
     ID3D11Buffer* GetVB() const;
     ID3D11Buffer* GetIB() const;
     int GetIndexCount() const;
-
-    std::vector<Vertex3F3F3F2F>& GetRawVB();
-    std::vector<uint32_t>& GetRawIB();
+    int GetFirstIndex() const;
+    const GeometryRange& GetRange() const;
+    const AABB& GetBoundingBox() const;
 
     static std::set<D3DGeometryBuffer*>& GetStorage();
 
 private:
-    ID3D11Buffer *mVB;
-    ID3D11Buffer *mIB;
-    int mIndexCount;
-
-    // provided by Settings.mSaveScene
-    std::vector<Vertex3F3F3F2F> mRawVB;
-    std::vector<uint32_t> mRawIB;
+    GeometryRange mRange;
+    bool mAllocated;
+    int mBoundsSlot; // V_COMPACT16 only, -1 otherwise
+    AABB mBoundingBox; // object space, calculated on creation
 
     static std::set<D3DGeometryBuffer*> mInternalStorage;
 
-    static void FillGeometryBufferAgregator( 
-        std::shared_ptr<D3DGeometryBuffer> &agregator, const std::vector<Vertex3F3F3F2F> &vBuf, const std::vector<uint32_t> &iBuf );
+    static void FillGeometryBufferAgregator( std::shared_ptr<D3DGeometryBuffer> &agregator,
+        const void *vBuf, size_t vCount, const uint32_t *iBuf, size_t iCount );
 
     D3DGeometryBuffer( );
     ~D3DGeometryBuffer( );
@@ -0,0 +1,189 @@
+#include <D3DGeometryPool.h>
+#include <D3DStructuredBuffer.h>
+#include <D3DRenderer.h>
+#include <GlobalUtils.h>
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static void MergeStats( RangeAllocatorStats &dst, const RangeAllocatorStats &src )
+{
+    dst.mCapacity += src.mCapacity;
+    dst.mUsed += src.mUsed;
+    dst.mFree += src.mFree;
+    dst.mLargestFreeBlock = ( std::max )( dst.mLargestFreeBlock, src.mLargestFreeBlock );
+    dst.mFreeBlockCount += src.mFreeBlockCount;
+    dst.mAllocationCount += src.mAllocationCount;
+    dst.mFragmentation = dst.mFree > 0 ? 1.0f - static_cast< float >( dst.mLargestFreeBlock ) / dst.mFree : 0.0f;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool D3DGeometryPool::Init( size_t pageVertices, size_t pageIndices, size_t vertexStride )
+{
+    Clear( );
+
+    mPageVertices = pageVertices;
+    mPageIndices = pageIndices;
+    mVertexStride = vertexStride;
+
+    mIsReady = CreatePage( mPageVertices, mPageIndices );
+    return mIsReady;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void D3DGeometryPool::Clear( )
+{
+    for each ( auto &page in mPages )
+    {
+        ASSERT( page.mVertices.GetUsed( ) == 0 && page.mIndices.GetUsed( ) == 0, "Geometry pool is cleared with live ranges" );
+        COMSafeRelease( page.mVB );
+        COMSafeRelease( page.mIB );
+    }
+
+    mPages.clear( );
+    mIsReady = false;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool D3DGeometryPool::IsReady( )
+{
+    return mIsReady;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool D3DGeometryPool::Allocate( const void *vData, size_t vCount, const uint32_t *iData, size_t iCount, GeometryRange &range )
+{
+    ASSERT( mIsReady );
+    if ( !mIsReady || vCount == 0 || iCount == 0 )
+        return false;
+
+    // first page with enough space for both ranges
+    size_t pageId = 0;
+    size_t baseVertex = RangeAllocator::INVALID_OFFSET;
+    size_t firstIndex = RangeAllocator::INVALID_OFFSET;
+    for ( ; pageId < mPages.size( ); pageId++ )
+    {
+        Page &page = mPages[pageId];
+        baseVertex = page.mVertices.Allocate( vCount );
+        if ( baseVertex == RangeAllocator::INVALID_OFFSET )
+            continue;
+
+        firstIndex = page.mIndices.Allocate( iCount );
+        if ( firstIndex != RangeAllocator::INVALID_OFFSET )
+            break;
+
+        page.mVertices.Free( baseVertex );
+        baseVertex = RangeAllocator::INVALID_OFFSET;
+    }
+
+    // no space - add a new page, big meshes get their own page
+    if ( pageId == mPages.size( ) )
+    {
+        if ( !CreatePage( ( std::max )( mPageVertices, vCount ), ( std::max )( mPageIndices, iCount ) ) )
+            return false;
+
+        Page &page = mPages.back( );
+        baseVertex = page.mVertices.Allocate( vCount );
+        firstIndex = page.mIndices.Allocate( iCount );
+    }
+
+    Page &page = mPages[pageId];
+    ID3D11DeviceContext *context = D3DRenderer::Get( ).GetContext( );
+
+    D3D11_BOX vBox = { static_cast< UINT >( baseVertex * mVertexStride ), 0, 0,
+        static_cast< UINT >( ( baseVertex + vCount ) * mVertexStride ), 1, 1 };
+    context->UpdateSubresource( page.mVB, 0, &vBox, vData, 0, 0 );
+
+    // indices are stored page-absolute, so adjacent meshes can be drawn with a single call
+    std::vector<uint32_t> pageIndices( iData, iData + iCount );
+    for ( size_t i = 0; i < iCount; i++ )
+        pageIndices[i] += static_cast< uint32_t >( baseVertex );
+
+    D3D11_BOX iBox = { static_cast< UINT >( firstIndex * sizeof( uint32_t ) ), 0, 0,
+        static_cast< UINT >( ( firstIndex + iCount ) * sizeof( uint32_t ) ), 1, 1 };
+    context->UpdateSubresource( page.mIB, 0, &iBox, pageIndices.data( ), 0, 0 );
+
+    range.mPage = pageId;
+    range.mBaseVertex = baseVertex;
+    range.mVertexCount = vCount;
+    range.mFirstIndex = firstIndex;
+    range.mIndexCount = iCount;
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void D3DGeometryPool::Free( const GeometryRange &range )
+{
+    ASSERT( range.mPage < mPages.size( ) );
+    if ( range.mPage >= mPages.size( ) )
+        return;
+
+    Page &page = mPages[range.mPage];
+    page.mVertices.Free( range.mBaseVertex );
+    page.mIndices.Free( range.mFirstIndex );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ID3D11Buffer* D3DGeometryPool::GetVB( size_t page ) const
+{
+    ASSERT( page < mPages.size( ) );
+    return mPages[page].mVB;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ID3D11Buffer* D3DGeometryPool::GetIB( size_t page ) const
+{
+    ASSERT( page < mPages.size( ) );
+    return mPages[page].mIB;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t D3DGeometryPool::GetVertexStride( ) const
+{
+    return mVertexStride;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t D3DGeometryPool::GetPageCount( ) const
+{
+    return mPages.size( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+RangeAllocatorStats D3DGeometryPool::GetVertexStats( ) const
+{
+    RangeAllocatorStats stats;
+    for each ( auto &page in mPages )
+        MergeStats( stats, page.mVertices.GetStats( ) );
+
+    return stats;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+RangeAllocatorStats D3DGeometryPool::GetIndexStats( ) const
+{
+    RangeAllocatorStats stats;
+    for each ( auto &page in mPages )
+        MergeStats( stats, page.mIndices.GetStats( ) );
+
+    return stats;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool D3DGeometryPool::CreatePage( size_t vertices, size_t indices )
+{
+    ID3D11Device *device = D3DRenderer::Get( ).GetDevice( );
+
+    Page page;
+    D3D11_BUFFER_DESC vbd = D3DStructuredBuffer::GenBufferDesc(
+        D3D11_USAGE_DEFAULT, static_cast< UINT >( vertices * mVertexStride ), D3D11_BIND_VERTEX_BUFFER, 0, 0, 0 );
+    HRESULT hr = device->CreateBuffer( &vbd, nullptr, &page.mVB );
+    ASSERT( hr == S_OK, "Can't create geometry pool vertex buffer" );
+    if ( FAILED( hr ) )
+        return false;
+
+    D3D11_BUFFER_DESC ibd = D3DStructuredBuffer::GenBufferDesc(
+        D3D11_USAGE_DEFAULT, static_cast< UINT >( indices * sizeof( uint32_t ) ), D3D11_BIND_INDEX_BUFFER, 0, 0, 0 );
+    hr = device->CreateBuffer( &ibd, nullptr, &page.mIB );
+    ASSERT( hr == S_OK, "Can't create geometry pool index buffer" );
+    if ( FAILED( hr ) )
+    {
+        COMSafeRelease( page.mVB );
+        return false;
+    }
+
+    page.mVertices.Reset( vertices );
+    page.mIndices.Reset( indices );
+    mPages.push_back( page );
+
+    LOG_INFO( "Geometry pool page ", mPages.size( ) - 1, ": ", vertices, " vertices, ", indices, " indices" );
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,63 @@
+#ifndef __D3D_GEOMETRY_POOL_H
+#define __D3D_GEOMETRY_POOL_H
+
+#include <vector>
+#include <stdint.h>
+#include <Core/RangeAllocator.h>
+
+struct ID3D11Buffer;
+
+// location of a mesh inside of the pool
+// indices in the page are already offset by mBaseVertex
+struct GeometryRange
+{
+    size_t mPage = 0;
+    size_t mBaseVertex = 0;
+    size_t mVertexCount = 0;
+    size_t mFirstIndex = 0;
+    size_t mIndexCount = 0;
+};
+
+// packs static meshes into a few big vertex/index buffers (pages)
+// so consecutive draws don't rebind IA buffers
+class D3DGeometryPool
+{
+public:
+    D3DGeometryPool( ) = default;
+
+    bool Init( size_t pageVertices, size_t pageIndices, size_t vertexStride );
+    void Clear( );
+
+    bool IsReady( );
+
+    bool Allocate( const void *vData, size_t vCount, const uint32_t *iData, size_t iCount, GeometryRange &range );
+    void Free( const GeometryRange &range );
+
+    ID3D11Buffer* GetVB( size_t page ) const;
+    ID3D11Buffer* GetIB( size_t page ) const;
+    size_t GetVertexStride( ) const;
+    size_t GetPageCount( ) const;
+
+    // summary over all pages
+    RangeAllocatorStats GetVertexStats( ) const;
+    RangeAllocatorStats GetIndexStats( ) const;
+
+private:
+    struct Page
+    {
+        ID3D11Buffer *mVB = nullptr;
+        ID3D11Buffer *mIB = nullptr;
+        RangeAllocator mVertices;
+        RangeAllocator mIndices;
+    };
+
+    bool mIsReady = false;
+    size_t mPageVertices = 0;
+    size_t mPageIndices = 0;
+    size_t mVertexStride = 0;
+    std::vector<Page> mPages;
+
+    bool CreatePage( size_t vertices, size_t indices );
+};
+
+#endif
@@ -13,6 +13,7 @@
 #include <Light.h>
 #include <D3DGeometryBuffer.h>
 #include <Settings.h>
+#include <Core/CompactVertex.h>
 
 #include <fstream>
 #include <vector>
@@ -88,7 +89,23 @@ bool D3DRenderer::Init( HWND hWnd )
     // Setup the viewport
     SetDefaultViewport( );
 
-    //BuildGeometryBuffer();
+    Settings &settings = Settings::Get( );
+    // float pool always exists for the quad and ui, scene geometry goes to the pool of the scene format
+    mSceneVertexFormat = settings.mCompactVertices ? D3DGeometryBuffer::V_COMPACT16 : D3DGeometryBuffer::V_3F3F3F2F;
+    for ( int format = 0; format < D3DGeometryBuffer::V_COUNT; format++ )
+    {
+        if ( format != D3DGeometryBuffer::V_3F3F3F2F && format != mSceneVertexFormat )
+            continue;
+
+        D3DGeometryBuffer::VertexFormat vertexFormat = static_cast< D3DGeometryBuffer::VertexFormat >( format );
+        if ( !mGeometryPools[format].Init( settings.mGeometryPoolVertices, settings.mGeometryPoolIndices,
+            D3DGeometryBuffer::GetVertexStride( vertexFormat ) ) )
+        {
+            LOG_ERROR( "Can't create geometry pool" );
+            return false;
+        }
+    }
+
     CreateDefaultGeometry( );
 
     D3D11_RASTERIZER_DESC rsDesc;
@@ -208,6 +225,19 @@ bool D3DRenderer::Resize( HWND hWnd, UINT width, UINT height )
     return true;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void D3DRenderer::ReloadSettings( uint32_t reload )
+{
+    if ( reload & SR_SHADOW_MAPS )
+    {
+        mShadowMapper.Clear( );
+        bool initialized = mShadowMapper.Init( );
+        ASSERT( initialized );
+    }
+
+    if ( mGIEnabled && ( reload & ( SR_SHADOW_MAPS | SR_VCT ) ) )
+        mVCT.Reallocate( reload );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void D3DRenderer::Cleanup( )
 {
     mGBuffer.Clear();
@@ -220,6 +250,16 @@ void D3DRenderer::Cleanup( )
     mDefaultTexture.reset( );
     mDefaultMaterial.reset( );
     mQuad.reset( );
+    for ( int format = 0; format < D3DGeometryBuffer::V_COUNT; format++ )
+        mGeometryPools[format].Clear( );
+    ResetGeometryBinding( );
+    mGeometryBounds.clear( );
+    mFreeGeometryBounds.clear( );
+    mGeometryBoundsCapacity = 0;
+    COMSafeRelease( mGeometryBoundsSRV );
+    COMSafeRelease( mGeometryBoundsBuffer );
+    mMaterialIDs.clear( );
+    mTextureIDs.clear( );
 
     COMSafeRelease( mSyncQueryA );
     COMSafeRelease( mSyncQueryB );
@@ -313,17 +353,15 @@ void D3DRenderer::RenderTick( )
 
     SetDefaultViewport( );
     SetDefaultMats();
+    ResetGeometryBinding( ); // other code (ui) could bind own buffers
+    UpdateCullingBoxes( );
 
     mImmediateContext->RSSetState( mCullRS );
     mImmediateContext->OMSetDepthStencilState( mDepthNoStencilDS, 0 );
     mImmediateContext->OMSetBlendState( NULL, 0, 0xffffffff );
 
-    // render sun shadow map
-    float dLength = 0.0f;
-    DirectX::XMStoreFloat( &dLength, DirectX::XMVector3Length( 
-        DirectX::XMVectorSubtract( DirectX::XMLoadFloat3( &mStaticSceneBB.second ),
-        DirectX::XMLoadFloat3( &mStaticSceneBB.first ) ) ) );
-    mShadowMapper.Draw( mGeometryToRender, mLightToRender[0], std::make_pair( dLength * 0.7f, dLength * 0.7f ) );
+    // render sun shadow maps, cached ones are kept
+    mShadowMapper.Draw( mGeometryToRender, mLightToRender[0], mStaticSceneBB );
 
     // render g-buffer
     mGBuffer.DrawGBuffer( mGeometryToRender );
@@ -342,11 +380,10 @@ void D3DRenderer::RenderTick( )
 
             mImmediateContext->RSSetState( mCullRS );
         }
-        if ( mVCT.NeedsProcessLight( mLightToRender[0] ) )
-        {
-            mVCT.ClearIrradianceBrickBuffer( ); // clear previous light information
-            mVCT.ProcessShadowMap( mLightToRender[0], mShadowMapper.GetShadowMap( ) );
-        }
+        // local light maps need depth test, injection itself doesn't
+        mImmediateContext->OMSetDepthStencilState( mDepthNoStencilDS, 0 );
+        mVCT.InjectLights( mGeometryToRender, mLightToRender, mShadowMapper );
+        mImmediateContext->OMSetDepthStencilState( mNoDepthNoStencilDS, 0 );
         if ( mVCT.IsReady() )
         {
             mVCT.VoxelConeTracing( );
@@ -361,7 +398,7 @@ void D3DRenderer::RenderTick( )
             if ( mShadowMapper.IsReady( ) && mGBuffer.IsReady() )
             {
                 ShadowMap &smap = mShadowMapper.GetShadowMap( );
-                mGBuffer.DrawCombine( mLightToRender[0], smap );
+                mGBuffer.DrawCombine( mLightToRender[0], smap, mShadowMapper.GetCascadedShadowMap( ) );
             }
         }
         break;
@@ -395,7 +432,7 @@ void D3DRenderer::RenderTick( )
     mUIDrawer.Draw();
 
     SendSyncQuery();
-    mLastPresentResult = mSwapChain->Present( 1, 0 );
+    mLastPresentResult = mSwapChain->Present( mPresentInterval, 0 );
     ASSERT( mLastPresentResult == S_OK || mLastPresentResult == DXGI_STATUS_OCCLUDED );
     SyncFence(); // wait for previous frame
 
@@ -427,6 +464,7 @@ void D3DRenderer::SetIndirectLayout( )
     mImmediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_POINTLIST );
     mImmediateContext->IASetVertexBuffers( 0, 0, nullptr, nullptr, nullptr );
     mImmediateContext->IASetIndexBuffer( nullptr, DXGI_FORMAT_R32_UINT, 0 );
+    ResetGeometryBinding( );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -451,9 +489,14 @@ void D3DRenderer::SetViewTransform( const DirectX::XMFLOAT4X4 &view )
     mDefaultView = view;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void D3DRenderer::SetPresentInterval( UINT interval )
+{
+    mPresentInterval = interval;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void D3DRenderer::PushSceneGeometryToRender( const SceneGeometry &geometry )
 {
-    // NOTE place for batching
+    // batching is done per pass by BuildRenderQueue
     mGeometryToRender.push_back( geometry );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -464,15 +507,111 @@ void D3DRenderer::PushLigthToRender( const LightSource &light )
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void D3DRenderer::DrawGeometry( const std::shared_ptr<D3DGeometryBuffer> &geom )
 {
-    UINT stride = sizeof( Vertex3F3F3F2F ); // does Vertex3F3F3F2F will be everywhere?
-    UINT offset = 0;
-
     if ( geom )
     {
-        auto vb = geom->GetVB();
+        // indices are page-absolute, so base vertex is always 0
+        BindGeometryPage( geom->mFormat, geom->GetRange( ).mPage );
+        mImmediateContext->DrawIndexed( geom->GetIndexCount( ), geom->GetFirstIndex( ), 0 );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void D3DRenderer::DrawRenderBatch( const RenderBatch &batch )
+{
+    BindGeometryPage( mSceneVertexFormat, batch.mPage );
+    mImmediateContext->DrawIndexed( batch.mIndexCount, batch.mFirstIndex, 0 );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void D3DRenderer::SetSceneGeometryLayout( ID3DX11EffectShaderResourceVariable *geometryBounds )
+{
+    mImmediateContext->IASetInputLayout( GetInputLayout( mSceneVertexFormat ) );
+    mImmediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+    if ( mSceneVertexFormat == D3DGeometryBuffer::V_COMPACT16 )
+        geometryBounds->SetResource( GetGeometryBoundsSRV( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void D3DRenderer::BuildRenderQueue( const std::vector<SceneGeometry> &objs, RenderQueueTechnique technique, bool useMaterials, RenderQueue &queue,
+    const std::vector<uint8_t> *visible )
+{
+    ASSERT( !visible || visible->size( ) == objs.size( ) );
+
+    queue.Clear( );
+    for ( size_t i = 0; i < objs.size( ); i++ )
+    {
+        const SceneGeometry &obj = objs[i];
+        if ( !obj.mGeometryBuffer || visible && !( *visible )[i] )
+            continue;
+
+        uint64_t key = RenderQueue::PackKey( technique, 0, 0, 0 );
+        const Material *mat = obj.mMaterial.get( );
+        if ( useMaterials && mat )
+        {
+            key = RenderQueue::PackKey( technique, GetRenderQueueID( mat, mMaterialIDs ),
+                GetRenderQueueID( mat->tex0.get( ), mTextureIDs ), GetRenderQueueID( mat->tex1.get( ), mTextureIDs ) );
+        }
+
+        const GeometryRange &range = obj.mGeometryBuffer->GetRange( );
+        queue.Push( key, static_cast< uint32_t >( i ), static_cast< uint32_t >( range.mPage ),
+            static_cast< uint32_t >( range.mFirstIndex ), static_cast< uint32_t >( range.mIndexCount ) );
+    }
+
+    queue.Build( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t D3DRenderer::CullGeometry( const std::vector<SceneGeometry> &objs, const DirectX::XMMATRIX &viewProj, std::vector<uint8_t> &visible )
+{
+    // boxes are built for the frame geometry list only
+    ASSERT( &objs == &mGeometryToRender && mCullingBoxes.GetCount( ) == objs.size( ) );
+    if ( !Settings::Get( ).mFrustumCulling || mCullingBoxes.GetCount( ) != objs.size( ) )
+    {
+        visible.assign( objs.size( ), 1 );
+        return objs.size( );
+    }
+
+    DirectX::XMFLOAT4X4 vp;
+    DirectX::XMStoreFloat4x4( &vp, viewProj );
+    return CullBoxes( Frustum::FromViewProj( &vp.m[0][0] ), mCullingBoxes, visible );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void D3DRenderer::UpdateCullingBoxes( )
+{
+    mCullingBoxes.Clear( );
+    mCullingBoxes.Reserve( mGeometryToRender.size( ) );
+    for each ( auto &obj in mGeometryToRender )
+        mCullingBoxes.Push( obj.mGeometryBuffer ? obj.mGeometryBuffer->GetBoundingBox( ) : AABB( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t D3DRenderer::GetRenderQueueID( const void *resource, std::unordered_map<const void*, uint32_t> &ids )
+{
+    if ( !resource )
+        return 0;
+
+    auto it = ids.find( resource );
+    if ( it != ids.end( ) )
+        return it->second;
+
+    uint32_t id = static_cast< uint32_t >( ids.size( ) + 1 );
+    ids[resource] = id;
+    return id;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void D3DRenderer::BindGeometryPage( D3DGeometryBuffer::VertexFormat format, size_t page )
+{
+    // all meshes of a pool page share buffers, so rebind only on page change
+    D3DGeometryPool &pool = mGeometryPools[format];
+    ID3D11Buffer *vb = pool.GetVB( page );
+    if ( vb != mBoundVB )
+    {
+        UINT stride = static_cast< UINT >( pool.GetVertexStride( ) );
+        UINT offset = 0;
         mImmediateContext->IASetVertexBuffers( 0, 1, &vb, &stride, &offset );
-        mImmediateContext->IASetIndexBuffer( geom->GetIB(), DXGI_FORMAT_R32_UINT, 0 );
-        mImmediateContext->DrawIndexed( geom->GetIndexCount(), 0, 0 );
+        mBoundVB = vb;
+    }
+
+    ID3D11Buffer *ib = pool.GetIB( page );
+    if ( ib != mBoundIB )
+    {
+        mImmediateContext->IASetIndexBuffer( ib, DXGI_FORMAT_R32_UINT, 0 );
+        mBoundIB = ib;
     }
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -569,6 +708,17 @@ ID3D11InputLayout* D3DRenderer::GetDefaultInputLayout( )
     return mDefaultShader.GetDefaultInputLayout( );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ID3D11InputLayout* D3DRenderer::GetInputLayout( D3DGeometryBuffer::VertexFormat format )
+{
+    ASSERT( mDefaultShader.IsReady() );
+    return mDefaultShader.GetInputLayout( format );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+D3DGeometryBuffer::VertexFormat D3DRenderer::GetSceneVertexFormat( )
+{
+    return mSceneVertexFormat;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void D3DRenderer::GetViewProjMats( DirectX::XMFLOAT4X4 &view, DirectX::XMFLOAT4X4 &proj )
 {
     view = mView;
@@ -591,12 +741,100 @@ std::shared_ptr<D3DGeometryBuffer> D3DRenderer::GetQuad( )
     return mQuad;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+D3DGeometryPool& D3DRenderer::GetGeometryPool( D3DGeometryBuffer::VertexFormat format )
+{
+    return mGeometryPools[format];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int D3DRenderer::AllocateGeometryBounds( const CompactVertexBounds &bounds )
+{
+    const size_t slotFloats = 8;
+    int slot;
+    if ( !mFreeGeometryBounds.empty( ) )
+    {
+        slot = mFreeGeometryBounds.back( );
+        mFreeGeometryBounds.pop_back( );
+    }
+    else
+    {
+        // slot is stored as uint16 in the vertices
+        slot = static_cast< int >( mGeometryBounds.size( ) / slotFloats );
+        if ( slot > UINT16_MAX )
+            return -1;
+        mGeometryBounds.resize( mGeometryBounds.size( ) + slotFloats, 0.0f );
+    }
+
+    float *dst = &mGeometryBounds[slot * slotFloats];
+    for ( int a = 0; a < 3; a++ )
+    {
+        dst[a] = bounds.mMin[a];
+        dst[4 + a] = bounds.mStep[a];
+    }
+    mGeometryBoundsDirty = true;
+
+    return slot;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void D3DRenderer::FreeGeometryBounds( int slot )
+{
+    // table is gone after cleanup
+    if ( slot >= 0 && static_cast< size_t >( slot ) * 8 < mGeometryBounds.size( ) )
+        mFreeGeometryBounds.push_back( slot );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ID3D11ShaderResourceView* D3DRenderer::GetGeometryBoundsSRV( )
+{
+    if ( !mGeometryBoundsDirty || mGeometryBounds.empty( ) )
+        return mGeometryBoundsSRV;
+
+    // table changes only while loading, grow by doubling and upload it whole
+    size_t slots = mGeometryBounds.size( ) / 8;
+    if ( slots > mGeometryBoundsCapacity )
+    {
+        COMSafeRelease( mGeometryBoundsSRV );
+        COMSafeRelease( mGeometryBoundsBuffer );
+        mGeometryBoundsCapacity = ( std::max )( slots, ( std::max )( mGeometryBoundsCapacity * 2, size_t( 256 ) ) );
+
+        D3D11_BUFFER_DESC bufDesc = D3DStructuredBuffer::GenBufferDesc( D3D11_USAGE_DEFAULT,
+            static_cast< UINT >( mGeometryBoundsCapacity * 8 * sizeof( float ) ), D3D11_BIND_SHADER_RESOURCE, 0, 0, 0 );
+        HRESULT hr = md3dDevice->CreateBuffer( &bufDesc, nullptr, &mGeometryBoundsBuffer );
+        ASSERT( hr == S_OK );
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        ZeroMemory( &srvDesc, sizeof( srvDesc ) );
+        srvDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        srvDesc.Buffer.FirstElement = 0;
+        srvDesc.Buffer.NumElements = static_cast< UINT >( mGeometryBoundsCapacity * 2 );
+        if ( hr == S_OK )
+            hr = md3dDevice->CreateShaderResourceView( mGeometryBoundsBuffer, &srvDesc, &mGeometryBoundsSRV );
+        ASSERT( hr == S_OK );
+        if ( hr != S_OK )
+        {
+            mGeometryBoundsCapacity = 0;
+            return nullptr;
+        }
+    }
+
+    D3D11_BOX box = { 0, 0, 0, static_cast< UINT >( mGeometryBounds.size( ) * sizeof( float ) ), 1, 1 };
+    mImmediateContext->UpdateSubresource( mGeometryBoundsBuffer, 0, &box, mGeometryBounds.data( ), 0, 0 );
+    mGeometryBoundsDirty = false;
+
+    return mGeometryBoundsSRV;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 GBuffer& D3DRenderer::GetGBuffer( )
 {
     ASSERT( mGBuffer.IsReady() );
     return mGBuffer;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ShadowMapper& D3DRenderer::GetShadowMapper( )
+{
+    ASSERT( mShadowMapper.IsReady( ) );
+    return mShadowMapper;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 VCT& D3DRenderer::GetVCT( )
 {
     ASSERT( mVCT.IsReady( ) );
@@ -661,6 +899,15 @@ D3DRenderer::D3DRenderer():
     mSyncQueryA( nullptr ),
     mSyncQueryB( nullptr ),
     mFirstFrame( true ),
+    mPresentInterval( 1 ),
+
+    mSceneVertexFormat( D3DGeometryBuffer::V_3F3F3F2F ),
+    mBoundVB( nullptr ),
+    mBoundIB( nullptr ),
+    mGeometryBoundsDirty( false ),
+    mGeometryBoundsCapacity( 0 ),
+    mGeometryBoundsBuffer( nullptr ),
+    mGeometryBoundsSRV( nullptr ),
 
     mGIEnabled( true )
 {
@@ -908,6 +1155,12 @@ void D3DRenderer::SendSyncQuery()
     mImmediateContext->End( mSyncQueryA );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void D3DRenderer::ResetGeometryBinding( )
+{
+    mBoundVB = nullptr;
+    mBoundIB = nullptr;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void D3DRenderer::SyncFence()
 {
     if ( !mFirstFrame )
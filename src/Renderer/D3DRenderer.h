@@ -14,17 +14,30 @@
 #include <VCT.h>
 #include <UIDrawer.h>
 #include <Blur.h>
+#include <D3DGeometryPool.h>
+#include <D3DGeometryBuffer.h>
+#include <Core/RenderQueue.h>
+#include <Core/Culling.h>
 
 class D3DTextureBuffer2D;
 class D3DStructuredBuffer;
-class D3DGeometryBuffer;
 struct Material;
 struct ID3D11Buffer;
 struct ID3DX11Effect;
+struct ID3DX11EffectShaderResourceVariable;
+struct CompactVertexBounds;
 struct GGMeshData;
 struct LightSource;
 struct SceneGeometry;
 
+// technique part of render queue key
+enum RenderQueueTechnique
+{
+    RQT_SHADOW_MAP,
+    RQT_GBUFFER,
+    RQT_VOXELIZATION
+};
+
 // dx11 based renderer
 class D3DRenderer
 {
@@ -35,6 +48,7 @@ public:
 
     bool Init( HWND hWnd ); // predefined settings, hwnd instance, etc
     bool Resize( HWND hWnd, UINT width, UINT height );
+    void ReloadSettings( uint32_t reload ); // SettingsReload mask, recreates only affected parts
     void Cleanup();
     void RenderTick();
 
@@ -42,10 +56,17 @@ public:
     void SetIndirectLayout( );
     void SetViewport( float w, float h, float minD, float maxD, float topLeftX, float topLeftY );
     void SetViewTransform( const DirectX::XMFLOAT4X4 &view );
+    void SetPresentInterval( UINT interval ); // 0 disables vsync, benchmarks use it
     void PushSceneGeometryToRender( const SceneGeometry &geometry );
     void PushLigthToRender( const LightSource &light );
 
-    void DrawGeometry( const std::shared_ptr<D3DGeometryBuffer> &geom );
+    void DrawGeometry( const std::shared_ptr<D3DGeometryBuffer> &geom ); // stride and pool follow the geometry format
+    void DrawRenderBatch( const RenderBatch &batch ); // batches are scene geometry, so they are in the scene format
+    // input layout and topology of the scene format, bounds are bound to the fx variable for compact vertices
+    void SetSceneGeometryLayout( ID3DX11EffectShaderResourceVariable *geometryBounds );
+    void BuildRenderQueue( const std::vector<SceneGeometry> &objs, RenderQueueTechnique technique, bool useMaterials, RenderQueue &queue,
+        const std::vector<uint8_t> *visible = nullptr );
+    size_t CullGeometry( const std::vector<SceneGeometry> &objs, const DirectX::XMMATRIX &viewProj, std::vector<uint8_t> &visible );
     void CalcStaticSceneBB( const DirectX::XMFLOAT3 &vtx );
 
     HRESULT CreateEffect( const char *shaderName, ID3DX11Effect **fx );
@@ -63,15 +84,24 @@ public:
     std::shared_ptr<D3DTextureBuffer2D> GetMainRT( );
     std::shared_ptr<D3DTextureBuffer2D> GetMainDepth( );
     ID3D11InputLayout* GetDefaultInputLayout();
+    ID3D11InputLayout* GetInputLayout( D3DGeometryBuffer::VertexFormat format );
+    D3DGeometryBuffer::VertexFormat GetSceneVertexFormat( ); // Settings::mCompactVertices at init
     void GetViewProjMats( DirectX::XMFLOAT4X4 &view, DirectX::XMFLOAT4X4 &proj );
     void GetFullscreenQuadMats( DirectX::XMFLOAT4X4 &view, DirectX::XMFLOAT4X4 &proj );
     std::shared_ptr<Material> GetDefaultMaterial();
     std::shared_ptr<D3DGeometryBuffer> GetQuad();
 
     GBuffer&    GetGBuffer();
+    ShadowMapper& GetShadowMapper();
     VCT&        GetVCT();
     UIDrawer&   GetUIDrawer();
     Blur&       GetBlur();
+    D3DGeometryPool& GetGeometryPool( D3DGeometryBuffer::VertexFormat format = D3DGeometryBuffer::V_3F3F3F2F );
+
+    // object bounds table for compact vertices, -1 if all 65536 slots are taken
+    int AllocateGeometryBounds( const CompactVertexBounds &bounds );
+    void FreeGeometryBounds( int slot );
+    ID3D11ShaderResourceView* GetGeometryBoundsSRV( ); // uploads the table if it changed
 
     uint32_t GetValueFromCounter( std::shared_ptr<D3DStructuredBuffer> &buffer );
     bool IsGIEnabled();
@@ -96,6 +126,11 @@ private:
     void ReportLiveObjects();
     void SendSyncQuery();
     void SyncFence();
+    void ResetGeometryBinding();
+    void BindGeometryPage( D3DGeometryBuffer::VertexFormat format, size_t page );
+    void UpdateCullingBoxes( );
+
+    uint32_t GetRenderQueueID( const void *resource, std::unordered_map<const void*, uint32_t> &ids );
 
     int mWidth;
     int mHeight;
@@ -132,6 +167,7 @@ private:
     ID3D11Query *mSyncQueryA, *mSyncQueryB;
     bool mFirstFrame;
     HRESULT mLastPresentResult;
+    UINT mPresentInterval;
 
     D3D11_VIEWPORT curVP; // does it needs severals copies for MRT ?
 
@@ -148,6 +184,27 @@ private:
     // reserved geometry
     std::shared_ptr<D3DGeometryBuffer> mQuad;
 
+    // shared vertex/index buffers for all meshes of a format and last bound ones
+    D3DGeometryPool mGeometryPools[D3DGeometryBuffer::V_COUNT];
+    D3DGeometryBuffer::VertexFormat mSceneVertexFormat;
+    ID3D11Buffer *mBoundVB;
+    ID3D11Buffer *mBoundIB;
+
+    // min and step of every compact object as two float4, Buffer<float4> gGeometryBounds in fx
+    std::vector<float> mGeometryBounds;
+    std::vector<int> mFreeGeometryBounds;
+    bool mGeometryBoundsDirty;
+    size_t mGeometryBoundsCapacity; // slots of the gpu buffer
+    ID3D11Buffer *mGeometryBoundsBuffer;
+    ID3D11ShaderResourceView *mGeometryBoundsSRV;
+
+    // dense ids for render queue keys, 0 is reserved for null
+    std::unordered_map<const void*, uint32_t> mMaterialIDs;
+    std::unordered_map<const void*, uint32_t> mTextureIDs;
+
+    // bounding boxes of mGeometryToRender, rebuilt each frame
+    CullingBoxes mCullingBoxes;
+
     // used render techniques
     DefaultShader mDefaultShader;
     GBuffer mGBuffer;
@@ -6,6 +6,12 @@
 #include <d3dx11effect.h>
 #include <Material.h>
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+DefaultShader::DefaultShader( )
+{
+    for ( int i = 0; i < D3DGeometryBuffer::V_COUNT; i++ )
+        mInputLayouts[i] = nullptr;
+}
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool DefaultShader::Init( )
 {
@@ -27,7 +33,8 @@ bool DefaultShader::Init( )
 void DefaultShader::Clear()
 {
     mfx.Clear();
-    COMSafeRelease( mInputLayout );
+    for ( int i = 0; i < D3DGeometryBuffer::V_COUNT; i++ )
+        COMSafeRelease( mInputLayouts[i] );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool DefaultShader::IsReady()
@@ -59,19 +66,30 @@ void DefaultShader::Draw( std::shared_ptr<D3DTextureBuffer2D> &colorRT, std::sha
     mfx.mfxShowAlpha->SetBool( showAlpha );
 
     // set per material params
-    immediateContext->IASetInputLayout( mInputLayout );
     immediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
     //immediateContext->RSSetState( mNoCullRS );
 
     for each ( auto &obj in objs )
     {
+        if ( !obj.mGeometryBuffer )
+            continue;
+
         const std::shared_ptr<Material> &mat = obj.mMaterial;
         if ( mat->tex0 )
             mfx.mfxDefaultTexture->SetResource( mat->tex0->GetSRV() );
         else
             mfx.mfxDefaultTexture->SetResource( renderer.GetDefaultTexture( )->GetSRV( ) );
 
-        mfx.mfxPass->Apply( 0, immediateContext );
+        // objects may come in any format, quad is float and scene geometry may be compact
+        D3DGeometryBuffer::VertexFormat format = obj.mGeometryBuffer->mFormat;
+        immediateContext->IASetInputLayout( mInputLayouts[format] );
+        if ( format == D3DGeometryBuffer::V_COMPACT16 )
+        {
+            mfx.mfxGeometryBounds->SetResource( renderer.GetGeometryBoundsSRV( ) );
+            mfx.mfxCompactPass->Apply( 0, immediateContext );
+        }
+        else
+            mfx.mfxPass->Apply( 0, immediateContext );
 
         renderer.DrawGeometry( obj.mGeometryBuffer );
     }
@@ -86,7 +104,12 @@ void DefaultShader::Draw( std::shared_ptr<D3DTextureBuffer2D> &colorRT, std::sha
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ID3D11InputLayout* DefaultShader::GetDefaultInputLayout()
 {
-    return mInputLayout;
+    return mInputLayouts[D3DGeometryBuffer::V_3F3F3F2F];
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ID3D11InputLayout* DefaultShader::GetInputLayout( D3DGeometryBuffer::VertexFormat format )
+{
+    return mInputLayouts[format];
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool DefaultShader::BuildLayout()
@@ -107,8 +130,24 @@ bool DefaultShader::BuildLayout()
 
     D3DX11_PASS_DESC passDesc;
     mfx.mTech->GetPassByIndex( 0 )->GetDesc( &passDesc );
-    HRESULT hr = d3dDevice->CreateInputLayout(
-        vertexDesc, ARRAYSIZE( vertexDesc ), passDesc.pIAInputSignature, passDesc.IAInputSignatureSize, &mInputLayout );
+    HRESULT hr = d3dDevice->CreateInputLayout( vertexDesc, ARRAYSIZE( vertexDesc ), passDesc.pIAInputSignature,
+        passDesc.IAInputSignatureSize, &mInputLayouts[D3DGeometryBuffer::V_3F3F3F2F] );
+
+    ASSERT( hr == S_OK );
+    if ( hr != S_OK )
+        return false;
+
+    // CompactVertex: unorm16 position with bounds slot in w, octahedral normal and binormal, half uv
+    D3D11_INPUT_ELEMENT_DESC compactDesc[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UINT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R8G8B8A8_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
+
+    mfx.mfxCompactPass->GetDesc( &passDesc );
+    hr = d3dDevice->CreateInputLayout( compactDesc, ARRAYSIZE( compactDesc ), passDesc.pIAInputSignature,
+        passDesc.IAInputSignatureSize, &mInputLayouts[D3DGeometryBuffer::V_COMPACT16] );
 
     ASSERT( hr == S_OK );
 
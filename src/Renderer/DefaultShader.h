@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <FXBindings/FXDefault.h>
+#include <D3DGeometryBuffer.h>
 
 struct SceneGeometry;
 struct ID3D11InputLayout;
@@ -12,7 +13,7 @@ class D3DTextureBuffer2D;
 class DefaultShader
 {
 public:
-    DefaultShader() = default;
+    DefaultShader();
 
     bool Init();
     void Clear();
@@ -24,13 +25,14 @@ public:
         SceneGeometry &obj, bool showAlpha = false );
 
     ID3D11InputLayout* GetDefaultInputLayout();
+    ID3D11InputLayout* GetInputLayout( D3DGeometryBuffer::VertexFormat format );
 
 private:
     bool BuildLayout();
 
     bool mIsReady = false;
     FXDefault mfx;
-    ID3D11InputLayout *mInputLayout = nullptr;
+    ID3D11InputLayout *mInputLayouts[D3DGeometryBuffer::V_COUNT];
 };
 
 #endif
\ No newline at end of file
@@ -23,18 +23,19 @@ bool FXBlur::Load( )
         GET_FX_VAR( loadingCheck, mTech, mFX->GetTechniqueByName( "UpscaleBlur" ) );
         if ( mTech->IsValid() )
         {
-            GET_FX_VAR( loadingCheck, mfxPassX, mTech->GetPassByName( "BlurX" ) );
-            GET_FX_VAR( loadingCheck, mfxPassY, mTech->GetPassByName( "BlurY" ) );
+            GET_FX_VAR( loadingCheck, mfxPassUpsample, mTech->GetPassByName( "Upsample" ) );
         }
 
         GET_FX_VAR( loadingCheck, mfxWorldViewProj, mFX->GetVariableByName( "gWorldViewProj" )->AsMatrix( ) );
         GET_FX_VAR( loadingCheck, mfxDepthTexture, mFX->GetVariableByName( "depthTexture" )->AsShaderResource( ) );
+        GET_FX_VAR( loadingCheck, mfxNormalTexture, mFX->GetVariableByName( "normalTexture" )->AsShaderResource( ) );
         GET_FX_VAR( loadingCheck, mfxColorTex, mFX->GetVariableByName( "colorTexture" )->AsShaderResource( ) );
-        GET_FX_VAR( loadingCheck, mfxBlurXTex, mFX->GetVariableByName( "blurXTexture" )->AsShaderResource( ) );
-        GET_FX_VAR( loadingCheck, mfxFalloff, mFX->GetVariableByName( "falloff" )->AsScalar( ) );
-        GET_FX_VAR( loadingCheck, mfxSharpness, mFX->GetVariableByName( "sharpness" )->AsScalar( ) );
-        GET_FX_VAR( loadingCheck, mfxRadius, mFX->GetVariableByName( "radius" )->AsScalar( ) );
-        GET_FX_VAR( loadingCheck, mfxPixelOffset, mFX->GetVariableByName( "pixelOffset" )->AsVector( ) );
+        GET_FX_VAR( loadingCheck, mfxDepthSharpness, mFX->GetVariableByName( "depthSharpness" )->AsScalar( ) );
+        GET_FX_VAR( loadingCheck, mfxNormalSharpness, mFX->GetVariableByName( "normalSharpness" )->AsScalar( ) );
+        GET_FX_VAR( loadingCheck, mfxUpsampleRadius, mFX->GetVariableByName( "upsampleRadius" )->AsScalar( ) );
+        GET_FX_VAR( loadingCheck, mfxUpsampleWeightsX, mFX->GetVariableByName( "upsampleWeightsX" )->AsScalar( ) );
+        GET_FX_VAR( loadingCheck, mfxUpsampleWeightsY, mFX->GetVariableByName( "upsampleWeightsY" )->AsScalar( ) );
+        GET_FX_VAR( loadingCheck, mfxLowResSize, mFX->GetVariableByName( "lowResSize" )->AsVector( ) );
 
         mIsLoaded = loadingCheck;
     }
@@ -14,17 +14,18 @@ struct FXBlur : public GeneralFX
     bool IsLoaded( );
 
     ID3DX11EffectTechnique *mTech = nullptr;
-    ID3DX11EffectPass *mfxPassX = nullptr;
-    ID3DX11EffectPass *mfxPassY = nullptr;
+    ID3DX11EffectPass *mfxPassUpsample = nullptr;
 
     ID3DX11EffectMatrixVariable *mfxWorldViewProj = nullptr;
     ID3DX11EffectShaderResourceVariable *mfxDepthTexture = nullptr;
+    ID3DX11EffectShaderResourceVariable *mfxNormalTexture = nullptr;
     ID3DX11EffectShaderResourceVariable *mfxColorTex = nullptr;
-    ID3DX11EffectShaderResourceVariable *mfxBlurXTex = nullptr;
-    ID3DX11EffectScalarVariable *mfxFalloff = nullptr;
-    ID3DX11EffectScalarVariable *mfxSharpness = nullptr;
-    ID3DX11EffectScalarVariable *mfxRadius = nullptr;
-    ID3DX11EffectVectorVariable *mfxPixelOffset = nullptr;
+    ID3DX11EffectScalarVariable *mfxDepthSharpness = nullptr;
+    ID3DX11EffectScalarVariable *mfxNormalSharpness = nullptr;
+    ID3DX11EffectScalarVariable *mfxUpsampleRadius = nullptr;
+    ID3DX11EffectScalarVariable *mfxUpsampleWeightsX = nullptr;
+    ID3DX11EffectScalarVariable *mfxUpsampleWeightsY = nullptr;
+    ID3DX11EffectVectorVariable *mfxLowResSize = nullptr;
 
 private:
     bool mIsLoaded = false;
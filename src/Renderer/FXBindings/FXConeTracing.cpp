@@ -49,6 +49,10 @@ bool FXConeTracing::Load( )
         GET_FX_VAR( fxCheck, mfxIndirectAmplification, mFX->GetVariableByName( "indirectAmplification" )->AsScalar( ) );
         GET_FX_VAR( fxCheck, mfxStepCorrection, mFX->GetVariableByName( "stepCorrection" )->AsScalar( ) );
         GET_FX_VAR( fxCheck, mfxUseOpacityBuffer, mFX->GetVariableByName( "useOpacityBuffer" )->AsScalar( ) );
+        GET_FX_VAR( fxCheck, mfxUseNeighborRopes, mFX->GetVariableByName( "useNeighborRopes" )->AsScalar( ) );
+        GET_FX_VAR( fxCheck, mfxEmptySpaceR, mFX->GetVariableByName( "emptySpaceR" )->AsShaderResource( ) );
+        GET_FX_VAR( fxCheck, mfxUseEmptySpace, mFX->GetVariableByName( "useEmptySpace" )->AsScalar( ) );
+        GET_FX_VAR( fxCheck, mfxEmptySpaceLevel, mFX->GetVariableByName( "emptySpaceLevel" )->AsScalar( ) );
 
         GET_FX_VAR( fxCheck, mfxDebugConeDir, mFX->GetVariableByName( "debugConeDir" )->AsScalar( ) );
         GET_FX_VAR( fxCheck, mfxDebugView, mFX->GetVariableByName( "debugView" )->AsScalar( ) );
@@ -87,6 +91,10 @@ void FXConeTracing::BindVCTResources( VCT &vctResources )
     mfxIndirectAmplification->SetFloat( vctResources.GetIndirectInfluence( ) );
     mfxStepCorrection->SetFloat( vctResources.GetStepCorrection( ) );
     mfxUseOpacityBuffer->SetBool( vctResources.GetUseOpacityBuffer( ) );
+    mfxUseNeighborRopes->SetBool( vctResources.GetNeighborRopes( ) );
+    mfxEmptySpaceR->SetResource( vctResources.GetEmptySpace( )->GetSRV( ) );
+    mfxUseEmptySpace->SetBool( vctResources.GetUseEmptySpace( ) );
+    mfxEmptySpaceLevel->SetInt( vctResources.GetEmptySpaceLevel( ) );
 
     auto &indirectTex = vctResources.GetIndirectIrradianceSmall( );
     float resScale[] = { static_cast<float>( renderer.GetWidth() ) / indirectTex->GetWidth(),
@@ -40,6 +40,10 @@ struct FXConeTracing : public GeneralFX
     ID3DX11EffectScalarVariable *mfxIndirectAmplification = nullptr;
     ID3DX11EffectScalarVariable *mfxStepCorrection = nullptr;
     ID3DX11EffectScalarVariable *mfxUseOpacityBuffer = nullptr;
+    ID3DX11EffectScalarVariable *mfxUseNeighborRopes = nullptr;
+    ID3DX11EffectShaderResourceVariable *mfxEmptySpaceR = nullptr;
+    ID3DX11EffectScalarVariable *mfxUseEmptySpace = nullptr;
+    ID3DX11EffectScalarVariable *mfxEmptySpaceLevel = nullptr;
 
     ID3DX11EffectScalarVariable *mfxDebugView = nullptr;
     ID3DX11EffectScalarVariable *mfxDebugConeDir = nullptr;
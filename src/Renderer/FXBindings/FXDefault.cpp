@@ -22,11 +22,15 @@ bool FXDefault::Load( )
 
         GET_FX_VAR( loadingCheck, mTech, mFX->GetTechniqueByName( "ColorTech" ) );
         if ( mTech->IsValid() )
+        {
             GET_FX_VAR( loadingCheck, mfxPass, mTech->GetPassByName( "SimplePass" ) );
+            GET_FX_VAR( loadingCheck, mfxCompactPass, mTech->GetPassByName( "SimplePassCompact" ) );
+        }
 
         GET_FX_VAR( loadingCheck, mfxWorldViewProj, mFX->GetVariableByName( "gWorldViewProj" )->AsMatrix( ) );
         GET_FX_VAR( loadingCheck, mfxDefaultTexture, mFX->GetVariableByName( "defaultTexture" )->AsShaderResource( ) );
         GET_FX_VAR( loadingCheck, mfxShowAlpha, mFX->GetVariableByName( "showAlpha" )->AsScalar( ) );
+        GET_FX_VAR( loadingCheck, mfxGeometryBounds, mFX->GetVariableByName( "gGeometryBounds" )->AsShaderResource( ) );
 
         mIsLoaded = loadingCheck;
     }
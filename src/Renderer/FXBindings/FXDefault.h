@@ -16,9 +16,11 @@ struct FXDefault : public GeneralFX
 
     ID3DX11EffectTechnique *mTech = nullptr;
     ID3DX11EffectPass *mfxPass = nullptr;
+    ID3DX11EffectPass *mfxCompactPass = nullptr;
     ID3DX11EffectMatrixVariable *mfxWorldViewProj = nullptr;
     ID3DX11EffectShaderResourceVariable *mfxDefaultTexture = nullptr;
     ID3DX11EffectScalarVariable *mfxShowAlpha = nullptr;
+    ID3DX11EffectShaderResourceVariable *mfxGeometryBounds = nullptr;
 
 private:
     bool mIsLoaded = false;
@@ -22,6 +22,7 @@ bool FXGBuffer::Load( )
         if ( mTech->IsValid( ) )
         {
             GET_FX_VAR( loadingCheck, mfxGPass, mTech->GetPassByName( "GPass" ) );
+            GET_FX_VAR( loadingCheck, mfxGPassCompact, mTech->GetPassByName( "GPassCompact" ) );
             GET_FX_VAR( loadingCheck, mfxCombinePass, mTech->GetPassByName( "CombinePass" ) );
             GET_FX_VAR( loadingCheck, mfxCombineWithVCTPass, mTech->GetPassByName( "CombinePassWithVCT" ) );
         }
@@ -32,6 +33,7 @@ bool FXGBuffer::Load( )
         GET_FX_VAR( loadingCheck, mfxAlbedoTexture, mFX->GetVariableByName( "albedoTexture" )->AsShaderResource( ) );
         GET_FX_VAR( loadingCheck, mfxNormalTexture, mFX->GetVariableByName( "normalTexture" )->AsShaderResource( ) );
         GET_FX_VAR( loadingCheck, mfxIndirectIrradiance, mFX->GetVariableByName( "indirectIrradianceTexture" )->AsShaderResource( ) );
+        GET_FX_VAR( loadingCheck, mfxGeometryBounds, mFX->GetVariableByName( "gGeometryBounds" )->AsShaderResource( ) );
 
         GET_FX_VAR( loadingCheck, mfxDepthTexture, mFX->GetVariableByName( "depthTexture" )->AsShaderResource( ) );
         GET_FX_VAR( loadingCheck, mfxInverseProj, mFX->GetVariableByName( "gInverseProj" )->AsMatrix( ) );
@@ -42,6 +44,9 @@ bool FXGBuffer::Load( )
         GET_FX_VAR( loadingCheck, mfxLightPosition, mFX->GetVariableByName( "lPos" )->AsVector( ) );
         GET_FX_VAR( loadingCheck, mfxLightDirection, mFX->GetVariableByName( "lDirection" )->AsVector( ) );
         GET_FX_VAR( loadingCheck, mfxShadowTexture, mFX->GetVariableByName( "shadowTexture" )->AsShaderResource( ) );
+        GET_FX_VAR( loadingCheck, mfxCascadeProj, mFX->GetVariableByName( "gCascadeProj" )->AsMatrix( ) );
+        GET_FX_VAR( loadingCheck, mfxCascadeCount, mFX->GetVariableByName( "cascadeCount" )->AsScalar( ) );
+        GET_FX_VAR( loadingCheck, mfxCascadeTextures, mFX->GetVariableByName( "cascadeTextures" )->AsShaderResource( ) );
         GET_FX_VAR( loadingCheck, mfxShadowBias, mFX->GetVariableByName( "shadowBias" )->AsScalar( ) );
         GET_FX_VAR( loadingCheck, mfxAOInfluence, mFX->GetVariableByName( "aoInfluence" )->AsScalar( ) );
         GET_FX_VAR( loadingCheck, mfxDirectInfluence, mFX->GetVariableByName( "directInfluence" )->AsScalar( ) );
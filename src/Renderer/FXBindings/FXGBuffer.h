@@ -16,6 +16,7 @@ struct FXGBuffer : public GeneralFX
 
     ID3DX11EffectTechnique *mTech = nullptr;
     ID3DX11EffectPass *mfxGPass = nullptr;
+    ID3DX11EffectPass *mfxGPassCompact = nullptr;
     ID3DX11EffectPass *mfxCombinePass = nullptr;
     ID3DX11EffectPass *mfxCombineWithVCTPass = nullptr;
     ID3DX11EffectMatrixVariable *mfxWorldViewProj = nullptr;
@@ -26,6 +27,7 @@ struct FXGBuffer : public GeneralFX
     ID3DX11EffectShaderResourceVariable *mfxNormalTexture = nullptr;
     ID3DX11EffectShaderResourceVariable *mfxDepthTexture = nullptr;
     ID3DX11EffectShaderResourceVariable *mfxIndirectIrradiance = nullptr;
+    ID3DX11EffectShaderResourceVariable *mfxGeometryBounds = nullptr;
 
     ID3DX11EffectMatrixVariable *mfxInverseProj = nullptr;
     ID3DX11EffectMatrixVariable *mfxInverseView = nullptr;
@@ -35,6 +37,9 @@ struct FXGBuffer : public GeneralFX
     ID3DX11EffectVectorVariable *mfxLightPosition = nullptr;
     ID3DX11EffectVectorVariable *mfxLightDirection = nullptr;
     ID3DX11EffectShaderResourceVariable *mfxShadowTexture = nullptr;
+    ID3DX11EffectMatrixVariable *mfxCascadeProj = nullptr;
+    ID3DX11EffectScalarVariable *mfxCascadeCount = nullptr;
+    ID3DX11EffectShaderResourceVariable *mfxCascadeTextures = nullptr;
     ID3DX11EffectScalarVariable *mfxShadowBias = nullptr;
     ID3DX11EffectScalarVariable *mfxAOInfluence = nullptr;
     ID3DX11EffectScalarVariable *mfxDirectInfluence = nullptr;
@@ -39,7 +39,11 @@ bool FXGenerateBrickBuffer::Load( )
         if ( mProcessingShadowMap.mTech->IsValid( ) )
         {
             auto &psm = mProcessingShadowMap;
-            GET_FX_VAR( fxCheck, psm.mProcessPass, psm.mTech->GetPassByName( "ProcessingShadowMap" ) );
+            GET_FX_VAR( fxCheck, psm.mCompactPhotons, psm.mTech->GetPassByName( "CompactPhotons" ) );
+            GET_FX_VAR( fxCheck, psm.mPadPhotons, psm.mTech->GetPassByName( "PadPhotons" ) );
+            GET_FX_VAR( fxCheck, psm.mSortPhotons, psm.mTech->GetPassByName( "SortPhotons" ) );
+            GET_FX_VAR( fxCheck, psm.mInjectPhotons, psm.mTech->GetPassByName( "InjectPhotons" ) );
+            GET_FX_VAR( fxCheck, psm.mResolveLeafIrradiance, psm.mTech->GetPassByName( "ResolveLeafIrradiance" ) );
             GET_FX_VAR( fxCheck, psm.mResetOctreeFlags, psm.mTech->GetPassByName( "ResetOctreeFlags" ) );
             GET_FX_VAR( fxCheck, psm.mAverageLitNodeValues, psm.mTech->GetPassByName( "AverageLitNodeValues" ) );
             GET_FX_VAR( fxCheck, psm.mAverageAlongAxisX, psm.mTech->GetPassByName( "AverageAlongAxisX" ) );
@@ -66,8 +70,16 @@ bool FXGenerateBrickBuffer::Load( )
         GET_FX_VAR( fxCheck, mfxLightPosition, mFX->GetVariableByName( "lPos" )->AsVector( ) );
         GET_FX_VAR( fxCheck, mfxLightDirection, mFX->GetVariableByName( "lDirection" )->AsVector( ) );
         GET_FX_VAR( fxCheck, mfxShadowMap, mFX->GetVariableByName( "shadowMap" )->AsShaderResource( ) );
+        GET_FX_VAR( fxCheck, mfxFluxMap, mFX->GetVariableByName( "fluxMap" )->AsShaderResource( ) );
         GET_FX_VAR( fxCheck, mfxShadowMapResolution, mFX->GetVariableByName( "shadowMapResolution" )->AsVector( ) );
 
+        GET_FX_VAR( fxCheck, mfxPhotonListRW, mFX->GetVariableByName( "photonListRW" )->AsUnorderedAccessView( ) );
+        GET_FX_VAR( fxCheck, mfxPhotonCount, mFX->GetVariableByName( "photonCount" )->AsScalar( ) );
+        GET_FX_VAR( fxCheck, mfxInjectionSign, mFX->GetVariableByName( "injectionSign" )->AsScalar( ) );
+        GET_FX_VAR( fxCheck, mfxSortBlockSize, mFX->GetVariableByName( "sortBlockSize" )->AsScalar( ) );
+        GET_FX_VAR( fxCheck, mfxSortStride, mFX->GetVariableByName( "sortStride" )->AsScalar( ) );
+        GET_FX_VAR( fxCheck, mfxLeafIrradianceRW, mFX->GetVariableByName( "leafIrradianceRW" )->AsUnorderedAccessView( ) );
+
         GET_FX_VAR( fxCheck, mfxShadowInverseProj, mFX->GetVariableByName( "gShadowInverseProj" )->AsMatrix( ) );
         GET_FX_VAR( fxCheck, mfxShadowInverseView, mFX->GetVariableByName( "gShadowInverseView" )->AsMatrix( ) );
 
@@ -102,6 +114,7 @@ void FXGenerateBrickBuffer::BindVCTResources( VCT &vctResources )
     auto irradianceBuf = vctResources.GetIrradianceBrickBuffer();
     mfxIrradianceBrickBufferRW->SetUnorderedAccessView( irradianceBuf->GetUAV( ) );
     mfxIrradianceBrickBufferR->SetResource( irradianceBuf->GetSRV( ) );
+    mfxLeafIrradianceRW->SetUnorderedAccessView( vctResources.GetLeafIrradiance( )->GetUAV( ) );
 
     mfxBrickBufferSize->SetInt( vctResources.GetBrickBufferSize( ) );
     mfxDebugOctreeLevel->SetInt( vctResources.GetDebugOctreeLevel( ) );
@@ -35,7 +35,11 @@ struct FXGenerateBrickBuffer : public GeneralFX
     {
         ProcessingShadowMapTechnique( ) = default;
         ID3DX11EffectTechnique *mTech = nullptr;
-        ID3DX11EffectPass *mProcessPass = nullptr;
+        ID3DX11EffectPass *mCompactPhotons = nullptr;
+        ID3DX11EffectPass *mPadPhotons = nullptr;
+        ID3DX11EffectPass *mSortPhotons = nullptr;
+        ID3DX11EffectPass *mInjectPhotons = nullptr;
+        ID3DX11EffectPass *mResolveLeafIrradiance = nullptr;
         ID3DX11EffectPass *mResetOctreeFlags = nullptr;
         ID3DX11EffectPass *mAverageLitNodeValues = nullptr;
         ID3DX11EffectPass *mAverageAlongAxisX = nullptr;
@@ -68,8 +72,16 @@ struct FXGenerateBrickBuffer : public GeneralFX
     ID3DX11EffectVectorVariable *mfxLightDirection = nullptr;
 
     ID3DX11EffectShaderResourceVariable *mfxShadowMap = nullptr;
+    ID3DX11EffectShaderResourceVariable *mfxFluxMap = nullptr;
     ID3DX11EffectVectorVariable *mfxShadowMapResolution = nullptr;
 
+    ID3DX11EffectUnorderedAccessViewVariable *mfxPhotonListRW = nullptr;
+    ID3DX11EffectScalarVariable *mfxPhotonCount = nullptr;
+    ID3DX11EffectScalarVariable *mfxInjectionSign = nullptr;
+    ID3DX11EffectScalarVariable *mfxSortBlockSize = nullptr;
+    ID3DX11EffectScalarVariable *mfxSortStride = nullptr;
+    ID3DX11EffectUnorderedAccessViewVariable *mfxLeafIrradianceRW = nullptr;
+
     ID3DX11EffectMatrixVariable *mfxShadowInverseProj = nullptr;
     ID3DX11EffectMatrixVariable *mfxShadowInverseView = nullptr;
 
@@ -26,26 +26,39 @@ bool FXGenerateOctree::Load( )
         {
             auto &mgo = mGenOctree;
             GET_FX_VAR( fxCheck, mgo.mCreateVoxelArray, mgo.mTech->GetPassByName( "CreateVoxelArray" ) );
+            GET_FX_VAR( fxCheck, mgo.mCreateVoxelArrayCompact, mgo.mTech->GetPassByName( "CreateVoxelArrayCompact" ) );
+            GET_FX_VAR( fxCheck, mgo.mCountVoxelFragments, mgo.mTech->GetPassByName( "CountVoxelFragments" ) );
+            GET_FX_VAR( fxCheck, mgo.mCountVoxelFragmentsCompact, mgo.mTech->GetPassByName( "CountVoxelFragmentsCompact" ) );
             GET_FX_VAR( fxCheck, mgo.mFlagNodes, mgo.mTech->GetPassByName( "FlagNodes" ) );
             GET_FX_VAR( fxCheck, mgo.mSubdivideNodes, mgo.mTech->GetPassByName( "SubdivideNodes" ) );
             GET_FX_VAR( fxCheck, mgo.mConnectNeighbors, mgo.mTech->GetPassByName( "ConnectNeighbors" ) );
             GET_FX_VAR( fxCheck, mgo.mConnectNodesToVoxels, mgo.mTech->GetPassByName( "ConnectNodesToVoxels" ) );
+            GET_FX_VAR( fxCheck, mgo.mMarkEmptySpace, mgo.mTech->GetPassByName( "MarkEmptySpace" ) );
+            GET_FX_VAR( fxCheck, mgo.mEmptySpaceAlongAxisX, mgo.mTech->GetPassByName( "EmptySpaceAlongAxisX" ) );
+            GET_FX_VAR( fxCheck, mgo.mEmptySpaceAlongAxisY, mgo.mTech->GetPassByName( "EmptySpaceAlongAxisY" ) );
+            GET_FX_VAR( fxCheck, mgo.mEmptySpaceAlongAxisZ, mgo.mTech->GetPassByName( "EmptySpaceAlongAxisZ" ) );
         }
 
         GET_FX_VAR( fxCheck, mfxWorldView, mFX->GetVariableByName( "gWorldView" )->AsMatrix( ) );
         GET_FX_VAR( fxCheck, mfxOrthoProj, mFX->GetVariableByName( "gOrthoProj" )->AsMatrix( ) );
         GET_FX_VAR( fxCheck, mfxAlbedoTexture, mFX->GetVariableByName( "albedoTexture" )->AsShaderResource( ) );
         GET_FX_VAR( fxCheck, mfxNormalTexture, mFX->GetVariableByName( "normalTexture" )->AsShaderResource( ) );
+        GET_FX_VAR( fxCheck, mfxGeometryBounds, mFX->GetVariableByName( "gGeometryBounds" )->AsShaderResource( ) );
 
         GET_FX_VAR( fxCheck, mfxUseNormalMap, mFX->GetVariableByName( "useNormalMap" )->AsScalar( ) );
 
         GET_FX_VAR( fxCheck, mfxVoxelArrayRW, mFX->GetVariableByName( "voxelArrayRW" )->AsUnorderedAccessView( ) );
+        GET_FX_VAR( fxCheck, mfxFragmentCounterRW, mFX->GetVariableByName( "fragmentCounterRW" )->AsUnorderedAccessView( ) );
         GET_FX_VAR( fxCheck, mfxVoxelArrayR, mFX->GetVariableByName( "voxelArrayR" )->AsShaderResource( ) );
         GET_FX_VAR( fxCheck, mfxIndirectDrawBuffer, mFX->GetVariableByName( "indirectDrawBuffer" )->AsUnorderedAccessView( ) );
 
         GET_FX_VAR( fxCheck, mfxFragmentBufferSize, mFX->GetVariableByName( "fragBufferSize" )->AsScalar( ) );
         GET_FX_VAR( fxCheck, mfxCurrentOctreeLevel, mFX->GetVariableByName( "currentOctreeLevel" )->AsScalar( ) );
 
+        GET_FX_VAR( fxCheck, mfxEmptySpaceRW, mFX->GetVariableByName( "emptySpaceRW" )->AsUnorderedAccessView( ) );
+        GET_FX_VAR( fxCheck, mfxEmptySpaceR, mFX->GetVariableByName( "emptySpaceR" )->AsShaderResource( ) );
+        GET_FX_VAR( fxCheck, mfxEmptySpaceLevel, mFX->GetVariableByName( "emptySpaceLevel" )->AsScalar( ) );
+
         fxCheck &= mOctreeVariables.LoadFromFx( mFX );
         mIsLoaded = fxCheck;
     }
@@ -91,6 +104,7 @@ void FXGenerateOctree::BindVCTResources( VCT &vctResources )
     mfxVoxelArrayRW->SetUnorderedAccessView( voxelArray->GetUAV() );
     mfxVoxelArrayR->SetResource( voxelArray->GetSRV() );
     mfxIndirectDrawBuffer->SetUnorderedAccessView( vctResources.GetIndirectDrawBuffer( )->GetUAV() );
+    mfxFragmentCounterRW->SetUnorderedAccessView( vctResources.GetFragmentCounter( )->GetUAV( ) );
 
     mfxFragmentBufferSize->SetInt( vctResources.GetFragmentListSize( ) );
 
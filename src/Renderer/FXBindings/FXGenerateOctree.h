@@ -24,10 +24,17 @@ struct FXGenerateOctree : public GeneralFX
         GenerateOctreeTechnique() = default;
         ID3DX11EffectTechnique *mTech = nullptr;
         ID3DX11EffectPass *mCreateVoxelArray = nullptr;
+        ID3DX11EffectPass *mCreateVoxelArrayCompact = nullptr;
+        ID3DX11EffectPass *mCountVoxelFragments = nullptr;
+        ID3DX11EffectPass *mCountVoxelFragmentsCompact = nullptr;
         ID3DX11EffectPass *mFlagNodes = nullptr;
         ID3DX11EffectPass *mSubdivideNodes = nullptr;
         ID3DX11EffectPass *mConnectNeighbors = nullptr;
         ID3DX11EffectPass *mConnectNodesToVoxels = nullptr;
+        ID3DX11EffectPass *mMarkEmptySpace = nullptr;
+        ID3DX11EffectPass *mEmptySpaceAlongAxisX = nullptr;
+        ID3DX11EffectPass *mEmptySpaceAlongAxisY = nullptr;
+        ID3DX11EffectPass *mEmptySpaceAlongAxisZ = nullptr;
     } mGenOctree;
 
     ID3DX11EffectMatrixVariable *mfxWorldView = nullptr;
@@ -35,18 +42,24 @@ struct FXGenerateOctree : public GeneralFX
 
     ID3DX11EffectShaderResourceVariable *mfxAlbedoTexture = nullptr;
     ID3DX11EffectShaderResourceVariable *mfxNormalTexture = nullptr;
+    ID3DX11EffectShaderResourceVariable *mfxGeometryBounds = nullptr;
 
     ID3DX11EffectScalarVariable *mfxUseNormalMap = nullptr;
 
     ID3DX11EffectScalarVariable *mfxFragmentBufferSize = nullptr;
 
     ID3DX11EffectUnorderedAccessViewVariable *mfxVoxelArrayRW = nullptr;
+    ID3DX11EffectUnorderedAccessViewVariable *mfxFragmentCounterRW = nullptr;
     ID3DX11EffectShaderResourceVariable *mfxVoxelArrayR = nullptr;
     ID3DX11EffectUnorderedAccessViewVariable *mfxIndirectDrawBuffer = nullptr;
 
     FXOctreeVariables mOctreeVariables;
     ID3DX11EffectScalarVariable *mfxCurrentOctreeLevel = nullptr;
 
+    ID3DX11EffectUnorderedAccessViewVariable *mfxEmptySpaceRW = nullptr;
+    ID3DX11EffectShaderResourceVariable *mfxEmptySpaceR = nullptr;
+    ID3DX11EffectScalarVariable *mfxEmptySpaceLevel = nullptr;
+
 private:
     bool mIsLoaded = false;
     ID3DX11Effect *mFX = nullptr;
@@ -20,9 +20,19 @@ bool FXShadowMap::Load( )
 
         GET_FX_VAR( loadingCheck, mShadowMapTech, mFX->GetTechniqueByName( "ShadowMap" ) );
         if ( mShadowMapTech->IsValid() )
+        {
             GET_FX_VAR( loadingCheck, mfxShadowMapPass, mShadowMapTech->GetPassByName( "ShadowMapPass" ) );
+            GET_FX_VAR( loadingCheck, mfxReflectiveShadowMapPass, mShadowMapTech->GetPassByName( "ReflectiveShadowMapPass" ) );
+            GET_FX_VAR( loadingCheck, mfxShadowMapPassCompact, mShadowMapTech->GetPassByName( "ShadowMapPassCompact" ) );
+            GET_FX_VAR( loadingCheck, mfxReflectiveShadowMapPassCompact, mShadowMapTech->GetPassByName( "ReflectiveShadowMapPassCompact" ) );
+        }
 
         GET_FX_VAR( loadingCheck, mfxWorldViewProj, mFX->GetVariableByName( "gWorldViewProj" )->AsMatrix( ) );
+        GET_FX_VAR( loadingCheck, mfxLightDirection, mFX->GetVariableByName( "lDirection" )->AsVector( ) );
+        GET_FX_VAR( loadingCheck, mfxLightPosRadius, mFX->GetVariableByName( "lPosRadius" )->AsVector( ) );
+        GET_FX_VAR( loadingCheck, mfxLightType, mFX->GetVariableByName( "lType" )->AsScalar( ) );
+        GET_FX_VAR( loadingCheck, mfxAlbedoTexture, mFX->GetVariableByName( "albedoTexture" )->AsShaderResource( ) );
+        GET_FX_VAR( loadingCheck, mfxGeometryBounds, mFX->GetVariableByName( "gGeometryBounds" )->AsShaderResource( ) );
 
         mIsLoaded = loadingCheck;
     }
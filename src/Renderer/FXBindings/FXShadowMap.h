@@ -16,7 +16,15 @@ struct FXShadowMap : public GeneralFX
 
     ID3DX11EffectTechnique *mShadowMapTech = nullptr;
     ID3DX11EffectPass *mfxShadowMapPass = nullptr;
+    ID3DX11EffectPass *mfxReflectiveShadowMapPass = nullptr;
+    ID3DX11EffectPass *mfxShadowMapPassCompact = nullptr;
+    ID3DX11EffectPass *mfxReflectiveShadowMapPassCompact = nullptr;
     ID3DX11EffectMatrixVariable *mfxWorldViewProj = nullptr;
+    ID3DX11EffectVectorVariable *mfxLightDirection = nullptr;
+    ID3DX11EffectVectorVariable *mfxLightPosRadius = nullptr;
+    ID3DX11EffectScalarVariable *mfxLightType = nullptr;
+    ID3DX11EffectShaderResourceVariable *mfxAlbedoTexture = nullptr;
+    ID3DX11EffectShaderResourceVariable *mfxGeometryBounds = nullptr;
 
 private:
     bool mIsLoaded = false;
@@ -63,40 +63,51 @@ void GBuffer::DrawGBuffer( const std::vector<SceneGeometry> &objs )
     immediateContext->ClearRenderTargetView( colorRTV, DirectX::Colors::SeaGreen );
     immediateContext->ClearRenderTargetView( normalRTV, DirectX::Colors::IndianRed );
     immediateContext->ClearDepthStencilView( mainDSV, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0 );
-    immediateContext->IASetInputLayout( renderer.GetDefaultInputLayout( ) );
-    immediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+    renderer.SetSceneGeometryLayout( mfx.mfxGeometryBounds );
+    bool compact = renderer.GetSceneVertexFormat( ) == D3DGeometryBuffer::V_COMPACT16;
+    ID3DX11EffectPass *gPass = compact ? mfx.mfxGPassCompact : mfx.mfxGPass;
 
     // set world view proj for scene
     renderer.GetViewProjMats( mSceneView, mSceneProj );
     DirectX::XMMATRIX worldViewProj = DirectX::XMLoadFloat4x4( &mSceneView ) * DirectX::XMLoadFloat4x4( &mSceneProj );
     mfx.mfxWorldViewProj->SetMatrix( reinterpret_cast< float* >( &worldViewProj ) );
 
-    for each ( auto &obj in objs )
+    // draw visible objects sorted by material; textures are set only when they change
+    renderer.CullGeometry( objs, worldViewProj, mVisible );
+    renderer.BuildRenderQueue( objs, RQT_GBUFFER, true, mRenderQueue, &mVisible );
+    const std::vector<RenderBatch> &batches = mRenderQueue.GetBatches( );
+    for ( size_t i = 0; i < batches.size( ); i++ )
     {
-        // set per material params
-        const std::shared_ptr<Material> &mat = obj.mMaterial;
-        if ( mat->tex0 )
-            mfx.mfxAlbedoTexture->SetResource( mat->tex0->GetSRV() );
-        else
-            mfx.mfxAlbedoTexture->SetResource( renderer.GetDefaultTexture()->GetSRV( ) );
-
-        if ( mat->tex1 )
+        const RenderBatch &batch = batches[i];
+        bool first = i == 0;
+        uint64_t prevKey = first ? 0 : batches[i - 1].mKey;
+        const std::shared_ptr<Material> &mat = objs[batch.mObject].mMaterial;
+
+        bool albedoChanged = first || RenderQueue::GetAlbedoTexture( batch.mKey ) != RenderQueue::GetAlbedoTexture( prevKey );
+        if ( albedoChanged )
         {
-            mfx.mfxUseNormalMap->SetBool( true ); // performance hint: should be batched
-            mfx.mfxNormalTexture->SetResource( mat->tex1->GetSRV() );
+            if ( mat->tex0 )
+                mfx.mfxAlbedoTexture->SetResource( mat->tex0->GetSRV( ) );
+            else
+                mfx.mfxAlbedoTexture->SetResource( renderer.GetDefaultTexture( )->GetSRV( ) );
         }
-        else
+
+        bool normalChanged = first || RenderQueue::GetNormalTexture( batch.mKey ) != RenderQueue::GetNormalTexture( prevKey );
+        if ( normalChanged )
         {
-            mfx.mfxUseNormalMap->SetBool( false );
+            mfx.mfxUseNormalMap->SetBool( mat->tex1 != nullptr );
+            if ( mat->tex1 )
+                mfx.mfxNormalTexture->SetResource( mat->tex1->GetSRV( ) );
         }
 
-        mfx.mfxGPass->Apply( 0, immediateContext );
+        if ( albedoChanged || normalChanged )
+            gPass->Apply( 0, immediateContext );
 
-        renderer.DrawGeometry( obj.mGeometryBuffer );
+        renderer.DrawRenderBatch( batch );
     }
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void GBuffer::DrawCombine( LightSource &lSource, ShadowMap &shadowMap )
+void GBuffer::DrawCombine( LightSource &lSource, ShadowMap &shadowMap, CascadedShadowMap &cascades )
 {
     // TODO maybe combine shadowMaps and lSources idn; store scene matrix to get inverse
 
@@ -123,6 +134,15 @@ void GBuffer::DrawCombine( LightSource &lSource, ShadowMap &shadowMap )
     DirectX::XMMATRIX worldToLightProj = DirectX::XMLoadFloat4x4( &shadowMap.mView ) * DirectX::XMLoadFloat4x4( &shadowMap.mProj );
     mfx.mfxLightProj->SetMatrix( reinterpret_cast< float* >( &worldToLightProj ) );
 
+    // cascades are tried first, scene shadow map covers the rest
+    ID3D11ShaderResourceView *cascadeSRVs[MAX_SHADOW_CASCADES] = { nullptr };
+    for ( int i = 0; i < cascades.mCount; i++ )
+        cascadeSRVs[i] = cascades.mShadowTexture[i]->GetSRV( );
+    if ( cascades.mCount > 0 )
+        mfx.mfxCascadeProj->SetMatrixArray( &cascades.mViewProj[0].m[0][0], 0, cascades.mCount );
+    mfx.mfxCascadeCount->SetInt( cascades.mCount );
+    mfx.mfxCascadeTextures->SetResourceArray( cascadeSRVs, 0, MAX_SHADOW_CASCADES );
+
     DirectX::XMFLOAT3 &lColor = lSource.color;
     DirectX::XMFLOAT3 &lPos = lSource.position;
     DirectX::XMFLOAT3 &lDir = lSource.direction;
@@ -178,6 +198,8 @@ void GBuffer::DrawCombine( LightSource &lSource, ShadowMap &shadowMap )
     mfx.mfxNormalTexture->SetResource( nullptr );
     mfx.mfxDepthTexture->SetResource( nullptr );
     mfx.mfxShadowTexture->SetResource( nullptr );
+    ID3D11ShaderResourceView *nullSRVs[MAX_SHADOW_CASCADES] = { nullptr };
+    mfx.mfxCascadeTextures->SetResourceArray( nullSRVs, 0, MAX_SHADOW_CASCADES );
     mfx.mfxIndirectIrradiance->SetResource( nullptr );
     mfx.mfxCombineWithVCTPass->Apply( 0, immediateContext );
 }
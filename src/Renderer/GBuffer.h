@@ -5,9 +5,11 @@
 #include <memory>
 #include <DirectXMath.h>
 #include <FXBindings/FXGBuffer.h>
+#include <Core/RenderQueue.h>
 
 struct LightSource;
 struct ShadowMap;
+struct CascadedShadowMap;
 struct SceneGeometry;
 class D3DTextureBuffer2D;
 
@@ -21,7 +23,7 @@ public:
 
     bool IsReady( );
     void DrawGBuffer( const std::vector<SceneGeometry> &objs );
-    void DrawCombine( LightSource &lSource, ShadowMap &shadowMap );
+    void DrawCombine( LightSource &lSource, ShadowMap &shadowMap, CascadedShadowMap &cascades );
 
     std::shared_ptr<D3DTextureBuffer2D> GetColor( );
     std::shared_ptr<D3DTextureBuffer2D> GetNormal( );
@@ -33,6 +35,8 @@ private:
     bool mIsReady = false;
 
     FXGBuffer mfx;
+    RenderQueue mRenderQueue;
+    std::vector<uint8_t> mVisible;
 
     std::shared_ptr<D3DTextureBuffer2D> mColor; // TODO is it really should be weak? it should be shared
     std::shared_ptr<D3DTextureBuffer2D> mNormal; // it needs to rework storage system
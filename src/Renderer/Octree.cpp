@@ -4,6 +4,7 @@
 #include <D3DStructuredBuffer.h>
 #include <D3DRenderer.h>
 #include <Settings.h>
+#include <Core/OctreeLayout.h>
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Octree::Init()
@@ -14,7 +15,7 @@ void Octree::Init()
     mResolution = 1 << mHeight;
 
     mBufferSize = settings.mOctreeBufferRes;
-    ASSERT( mBufferSize % 16 == 0, "mBufferSize should be divider of 16" );
+    ASSERT( mBufferSize % SIZE_OF_NODE_STRUCT == 0, "mBufferSize should be divider of 16" );
 
     mNodesPackCounter = D3DStructuredBuffer::CreateAtomicCounter( );
 
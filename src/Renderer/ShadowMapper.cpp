@@ -5,22 +5,43 @@
 #include <DirectXColors.h>
 #include <d3dx11effect.h>
 #include <Material.h>
-#include <Camera.h>
 #include <Light.h>
 #include <Settings.h>
+#include <algorithm>
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static DirectX::XMFLOAT4X4 ToXMFLOAT4X4( const float m[16] )
+{
+    DirectX::XMFLOAT4X4 result;
+    memcpy( &result, m, sizeof( result ) );
+    return result;
+}
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool ShadowMapper::Init( )
 {
     if ( mIsReady )
         return mIsReady;
 
-    D3DRenderer &renderer = D3DRenderer::Get( );
     Settings &settings = Settings::Get( );
     bool isLoaded = mfx.Load( );
 
     mShadowMap.mShadowTexture = D3DTextureBuffer2D::Create( false, true, true, false,
         nullptr, nullptr, nullptr, nullptr, 0.0f, settings.mShadowMapRes, settings.mShadowMapRes );
+    mShadowMap.mFluxTexture = D3DTextureBuffer2D::Create( true, false, true, false,
+        nullptr, nullptr, nullptr, nullptr, 0.0f, settings.mShadowMapRes, settings.mShadowMapRes );
+
+    mLightFaceMap.mShadowTexture = D3DTextureBuffer2D::Create( false, true, true, false,
+        nullptr, nullptr, nullptr, nullptr, 0.0f, settings.mLocalLightShadowRes, settings.mLocalLightShadowRes );
+    mLightFaceMap.mFluxTexture = D3DTextureBuffer2D::Create( true, false, true, false,
+        nullptr, nullptr, nullptr, nullptr, 0.0f, settings.mLocalLightShadowRes, settings.mLocalLightShadowRes );
+
+    // all cascades are allocated, count can be changed at runtime
+    for ( int i = 0; i < MAX_SHADOW_CASCADES; i++ )
+    {
+        mCascadedShadowMap.mShadowTexture[i] = D3DTextureBuffer2D::Create( false, true, true, false,
+            nullptr, nullptr, nullptr, nullptr, 0.0f, settings.mShadowMapRes, settings.mShadowMapRes );
+    }
+    mCascades.Invalidate( );
 
     mIsReady = isLoaded;
     ASSERT( mIsReady );
@@ -33,6 +54,12 @@ void ShadowMapper::Clear( )
     mIsReady = false;
     mfx.Clear( );
     mShadowMap.mShadowTexture.reset();
+    mShadowMap.mFluxTexture.reset( );
+    mLightFaceMap.mShadowTexture.reset( );
+    mLightFaceMap.mFluxTexture.reset( );
+    for ( int i = 0; i < MAX_SHADOW_CASCADES; i++ )
+        mCascadedShadowMap.mShadowTexture[i].reset( );
+    mCascadedShadowMap.mCount = 0;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool ShadowMapper::IsReady( )
@@ -41,7 +68,7 @@ bool ShadowMapper::IsReady( )
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void ShadowMapper::Draw( const std::vector<SceneGeometry> &objs, const LightSource &light,
-    const std::pair<float, float> &spaceSize )
+    const std::pair<DirectX::XMFLOAT3, DirectX::XMFLOAT3> &sceneBB )
 {
     ASSERT( mIsReady );
     if ( !mIsReady )
@@ -50,35 +77,149 @@ void ShadowMapper::Draw( const std::vector<SceneGeometry> &objs, const LightSour
     D3DRenderer &renderer = D3DRenderer::Get( );
     Settings &settings = Settings::Get();
 
-    auto &shTex = mShadowMap.mShadowTexture;
-    renderer.SetViewport( float( shTex->GetWidth( ) ), float( shTex->GetHeight( ) ), 0.0f, 1.0f, 0, 0 );
+    ShadowLightInput lightInput;
+    DirectX::XMStoreFloat3( reinterpret_cast< DirectX::XMFLOAT3* >( lightInput.mDirection ), DirectX::XMLoadFloat3( &light.direction ) );
+    DirectX::XMStoreFloat3( reinterpret_cast< DirectX::XMFLOAT3* >( lightInput.mSceneMin ), DirectX::XMLoadFloat3( &sceneBB.first ) );
+    DirectX::XMStoreFloat3( reinterpret_cast< DirectX::XMFLOAT3* >( lightInput.mSceneMax ), DirectX::XMLoadFloat3( &sceneBB.second ) );
+
+    // cascades split camera depth from its near plane up to the scene size, farther pixels use the scene map
+    DirectX::XMFLOAT4X4 view, proj;
+    renderer.GetViewProjMats( view, proj );
+    float sceneDiagonal = 0.0f;
+    DirectX::XMStoreFloat( &sceneDiagonal, DirectX::XMVector3Length(
+        DirectX::XMVectorSubtract( DirectX::XMLoadFloat3( &sceneBB.second ), DirectX::XMLoadFloat3( &sceneBB.first ) ) ) );
+
+    ShadowCascadeParams params;
+    params.mCount = settings.mShadowCascades;
+    params.mResolution = settings.mShadowMapRes;
+    params.mNear = proj._43 / proj._33; // right handed perspective with z in [0, 1]
+    params.mFar = ( std::min )( proj._43 / ( proj._33 + 1.0f ), sceneDiagonal );
+    params.mLambda = settings.mShadowCascadeLambda;
+    params.mGuardBand = settings.mShadowCascadeGuard;
+    mCascades.Update( &view.m[0][0], &proj.m[0][0], lightInput, params );
+
+    mRedrawCount = 0;
+
+    const ShadowCascade &sceneCascade = mCascades.GetSceneCascade( );
+    if ( sceneCascade.mDirty )
+    {
+        mShadowMap.mView = ToXMFLOAT4X4( sceneCascade.mView );
+        mShadowMap.mProj = ToXMFLOAT4X4( sceneCascade.mProj );
+
+        // scene map covers the whole octree, it also stores flux for photon injection
+        LightState sun;
+        sun.mType = LIGHT_DIRECTIONAL;
+        sun.mDirection[0] = light.direction.x;
+        sun.mDirection[1] = light.direction.y;
+        sun.mDirection[2] = light.direction.z;
+        SetReflectiveLight( sun );
+        DrawDepth( objs, ToXMFLOAT4X4( sceneCascade.mViewProj ), mShadowMap.mShadowTexture, mShadowMap.mFluxTexture.get( ) );
+        mRedrawCount++;
+    }
+
+    mCascadedShadowMap.mCount = mCascades.GetCount( );
+    for ( int i = 0; i < mCascadedShadowMap.mCount; i++ )
+    {
+        const ShadowCascade &cascade = mCascades.GetCascade( i );
+        mCascadedShadowMap.mViewProj[i] = ToXMFLOAT4X4( cascade.mViewProj );
+        if ( cascade.mDirty )
+        {
+            DrawDepth( objs, mCascadedShadowMap.mViewProj[i], mCascadedShadowMap.mShadowTexture[i] );
+            mRedrawCount++;
+        }
+    }
+
+    mCascades.ClearDirty( );
+    renderer.SetDefaultViewport( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ShadowMap& ShadowMapper::DrawLightFace( const std::vector<SceneGeometry> &objs, const LightState &light, int face )
+{
+    ASSERT( mIsReady );
+    if ( !mIsReady )
+        return mLightFaceMap;
+
+    float view[16], proj[16];
+    GetLightFaceMatrices( light, face, view, proj );
+    mLightFaceMap.mView = ToXMFLOAT4X4( view );
+    mLightFaceMap.mProj = ToXMFLOAT4X4( proj );
 
-    // create camera from light source position
-    Camera lightCamera;
-    lightCamera.SetPosition( light.position );
-    lightCamera.SetDirection( light.direction );
-    mShadowMap.mView = lightCamera.GetWorldToViewTransform( );
-    DirectX::XMStoreFloat4x4( &mShadowMap.mProj, DirectX::XMMatrixOrthographicRH(
-        spaceSize.first, spaceSize.second, settings.mShadowMapZNear, settings.mShadowMapZFar ) );
+    DirectX::XMFLOAT4X4 viewProj;
+    DirectX::XMStoreFloat4x4( &viewProj, DirectX::XMMatrixMultiply( DirectX::XMLoadFloat4x4( &mLightFaceMap.mView ),
+        DirectX::XMLoadFloat4x4( &mLightFaceMap.mProj ) ) );
 
-    DirectX::XMMATRIX worldViewProj = DirectX::XMLoadFloat4x4( &mShadowMap.mView ) * DirectX::XMLoadFloat4x4( &mShadowMap.mProj );
+    SetReflectiveLight( light );
+    DrawDepth( objs, viewProj, mLightFaceMap.mShadowTexture, mLightFaceMap.mFluxTexture.get( ) );
+    D3DRenderer::Get( ).SetDefaultViewport( );
+
+    return mLightFaceMap;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ShadowMapper::SetReflectiveLight( const LightState &light )
+{
+    DirectX::XMVECTOR lDir = DirectX::XMVectorSet( light.mDirection[0], light.mDirection[1], light.mDirection[2], DirectX::XMScalarCos( light.mSpotAngle ) );
+    DirectX::XMVECTOR lPosRadius = DirectX::XMVectorSet( light.mPosition[0], light.mPosition[1], light.mPosition[2], light.mRadius );
+    mfx.mfxLightDirection->SetFloatVector( reinterpret_cast< float* >( &lDir ) );
+    mfx.mfxLightPosRadius->SetFloatVector( reinterpret_cast< float* >( &lPosRadius ) );
+    mfx.mfxLightType->SetInt( light.mType );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ShadowMapper::DrawDepth( const std::vector<SceneGeometry> &objs, const DirectX::XMFLOAT4X4 &viewProj,
+    std::shared_ptr<D3DTextureBuffer2D> &texture, D3DTextureBuffer2D *fluxTexture )
+{
+    D3DRenderer &renderer = D3DRenderer::Get( );
+    renderer.SetViewport( float( texture->GetWidth( ) ), float( texture->GetHeight( ) ), 0.0f, 1.0f, 0, 0 );
+
+    DirectX::XMMATRIX worldViewProj = DirectX::XMLoadFloat4x4( &viewProj );
     mfx.mfxWorldViewProj->SetMatrix( reinterpret_cast< float* >( &worldViewProj ) );
 
-    auto dsv = mShadowMap.mShadowTexture->GetDSV();
+    auto dsv = texture->GetDSV();
     auto immediateContext = renderer.GetContext( );
-    ID3D11RenderTargetView* shmap[] = { nullptr };
+    ID3D11RenderTargetView* shmap[] = { fluxTexture ? fluxTexture->GetRTV( ) : nullptr };
     immediateContext->ClearDepthStencilView( dsv, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0 );
+    if ( fluxTexture )
+        immediateContext->ClearRenderTargetView( shmap[0], DirectX::Colors::Black );
     immediateContext->OMSetRenderTargets( 1, shmap, dsv );
-    immediateContext->IASetInputLayout( renderer.GetDefaultInputLayout() );
-    immediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+    renderer.SetSceneGeometryLayout( mfx.mfxGeometryBounds );
+    bool compact = renderer.GetSceneVertexFormat( ) == D3DGeometryBuffer::V_COMPACT16;
+
+    // objects outside of the light ortho volume are clipped anyway, so cull them
+    renderer.CullGeometry( objs, worldViewProj, mVisible );
 
-    mfx.mfxShadowMapPass->Apply( 0, immediateContext );
-    for each ( auto &obj in objs )
+    if ( !fluxTexture )
     {
-        renderer.DrawGeometry( obj.mGeometryBuffer );
+        // depth only - materials don't matter, adjacent meshes are merged into one draw
+        ( compact ? mfx.mfxShadowMapPassCompact : mfx.mfxShadowMapPass )->Apply( 0, immediateContext );
+
+        renderer.BuildRenderQueue( objs, RQT_SHADOW_MAP, false, mRenderQueue, &mVisible );
+        for each ( auto &batch in mRenderQueue.GetBatches( ) )
+            renderer.DrawRenderBatch( batch );
+        return;
     }
 
-    renderer.SetDefaultViewport( );
+    // reflective shadow map needs albedo, set it only when it changes
+    ID3DX11EffectPass *fluxPass = compact ? mfx.mfxReflectiveShadowMapPassCompact : mfx.mfxReflectiveShadowMapPass;
+    renderer.BuildRenderQueue( objs, RQT_SHADOW_MAP, true, mRenderQueue, &mVisible );
+    const std::vector<RenderBatch> &batches = mRenderQueue.GetBatches( );
+    for ( size_t i = 0; i < batches.size( ); i++ )
+    {
+        const RenderBatch &batch = batches[i];
+        bool first = i == 0;
+        if ( first || RenderQueue::GetAlbedoTexture( batch.mKey ) != RenderQueue::GetAlbedoTexture( batches[i - 1].mKey ) )
+        {
+            const std::shared_ptr<Material> &mat = objs[batch.mObject].mMaterial;
+            if ( mat->tex0 )
+                mfx.mfxAlbedoTexture->SetResource( mat->tex0->GetSRV( ) );
+            else
+                mfx.mfxAlbedoTexture->SetResource( renderer.GetDefaultTexture( )->GetSRV( ) );
+            fluxPass->Apply( 0, immediateContext );
+        }
+
+        renderer.DrawRenderBatch( batch );
+    }
+
+    mfx.mfxAlbedoTexture->SetResource( nullptr );
+    fluxPass->Apply( 0, immediateContext );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ShadowMap& ShadowMapper::GetShadowMap()
@@ -86,3 +227,13 @@ ShadowMap& ShadowMapper::GetShadowMap()
     return mShadowMap;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CascadedShadowMap& ShadowMapper::GetCascadedShadowMap( )
+{
+    return mCascadedShadowMap;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int ShadowMapper::GetRedrawCount( )
+{
+    return mRedrawCount;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
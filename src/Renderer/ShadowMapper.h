@@ -5,6 +5,9 @@
 #include <memory>
 #include <DirectXMath.h>
 #include <FXBindings/FXShadowMap.h>
+#include <Core/RenderQueue.h>
+#include <Core/ShadowCascades.h>
+#include <Core/LightManager.h>
 
 struct SceneGeometry;
 struct LightSource;
@@ -15,6 +18,15 @@ struct ShadowMap
     DirectX::XMFLOAT4X4 mView;
     DirectX::XMFLOAT4X4 mProj;
     std::shared_ptr<D3DTextureBuffer2D> mShadowTexture;
+    std::shared_ptr<D3DTextureBuffer2D> mFluxTexture; // reflective shadow map: albedo * NdotL
+};
+
+// camera fitted cascades for the combine pass
+struct CascadedShadowMap
+{
+    int mCount = 0;
+    DirectX::XMFLOAT4X4 mViewProj[MAX_SHADOW_CASCADES];
+    std::shared_ptr<D3DTextureBuffer2D> mShadowTexture[MAX_SHADOW_CASCADES];
 };
 
 class ShadowMapper
@@ -26,15 +38,34 @@ public:
     void Clear( );
 
     bool IsReady( );
-    void Draw( const std::vector<SceneGeometry> &objs, const LightSource &light, const std::pair<float, float> &spaceSize );
+    // redraws only cascades which moved or whose light changed
+    void Draw( const std::vector<SceneGeometry> &objs, const LightSource &light,
+        const std::pair<DirectX::XMFLOAT3, DirectX::XMFLOAT3> &sceneBB );
 
+    // reflective shadow map of a point light cube face or a spot light, for photon injection
+    ShadowMap& DrawLightFace( const std::vector<SceneGeometry> &objs, const LightState &light, int face );
+
+    // stable whole scene map, used for photon injection and outside of cascades
     ShadowMap& GetShadowMap( );
+    CascadedShadowMap& GetCascadedShadowMap( );
+    int GetRedrawCount( ); // maps redrawn during last Draw
 
 private:
+    // flux texture turns it into reflective shadow map pass with materials
+    void SetReflectiveLight( const LightState &light );
+    void DrawDepth( const std::vector<SceneGeometry> &objs, const DirectX::XMFLOAT4X4 &viewProj, std::shared_ptr<D3DTextureBuffer2D> &texture,
+        D3DTextureBuffer2D *fluxTexture = nullptr );
+
     bool mIsReady = false;
     FXShadowMap mfx;
+    RenderQueue mRenderQueue;
+    std::vector<uint8_t> mVisible;
 
+    ShadowCascades mCascades;
     ShadowMap mShadowMap;
+    ShadowMap mLightFaceMap; // reused for every local light face
+    CascadedShadowMap mCascadedShadowMap;
+    int mRedrawCount = 0;
 };
 
 #endif
\ No newline at end of file
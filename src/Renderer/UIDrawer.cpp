@@ -133,6 +133,32 @@ void UIDrawer::BuildRendererUI()
 
     static_assert( ARRAYSIZE( items ) == RO_COUNT, "Items size doesn't match RO_COUNT" );
     ImGui::Combo( "Output", reinterpret_cast< int* >( &settings.mRenderOutput ), items, RO_COUNT );
+
+    const char* pacingItems[] = {
+        "After present",
+        "Before input",
+    };
+
+    static_assert( ARRAYSIZE( pacingItems ) == FPM_COUNT, "Items size doesn't match FPM_COUNT" );
+    ImGui::Combo( "Frame pacing", reinterpret_cast< int* >( &settings.mFramePacingMode ), pacingItems, FPM_COUNT );
+
+    ImGui::Checkbox( "Frustum culling", &settings.mFrustumCulling );
+
+    ImGui::SliderInt( "Shadow cascades", &settings.mShadowCascades, 1, MAX_SHADOW_CASCADES );
+    ImGui::SliderFloat( "Cascade split lambda", &settings.mShadowCascadeLambda, 0.0f, 1.0f );
+    ImGui::Text( "Shadow maps redrawn: %d", D3DRenderer::Get( ).GetShadowMapper( ).GetRedrawCount( ) );
+
+    D3DRenderer &renderer = D3DRenderer::Get( );
+    D3DGeometryPool &pool = renderer.GetGeometryPool( renderer.GetSceneVertexFormat( ) );
+    RangeAllocatorStats vStats = pool.GetVertexStats( );
+    RangeAllocatorStats iStats = pool.GetIndexStats( );
+    // sizes as unsigned, the vs2013 crt behind ImGui::Text has no %zu
+    ImGui::Text( "Geometry pool: %u pages, %u meshes, %u B/vertex", static_cast< unsigned >( pool.GetPageCount( ) ),
+        static_cast< unsigned >( vStats.mAllocationCount ), static_cast< unsigned >( pool.GetVertexStride( ) ) );
+    ImGui::Text( "Vertices %u/%u frag %.2f", static_cast< unsigned >( vStats.mUsed ), static_cast< unsigned >( vStats.mCapacity ),
+        vStats.mFragmentation );
+    ImGui::Text( "Indices %u/%u frag %.2f", static_cast< unsigned >( iStats.mUsed ), static_cast< unsigned >( iStats.mCapacity ),
+        iStats.mFragmentation );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void UIDrawer::BuildSceneUI( )
@@ -148,8 +174,6 @@ void UIDrawer::BuildSceneUI( )
 
     // hide unnecessary settings
     // ImGui::SliderFloat( "Light distance", &settings.mLightDistance, 0.0f, 2.0f );
-    // ImGui::SliderFloat( "Shadow map z near", &settings.mShadowMapZNear, 0.0001f, 100.0f );
-    // ImGui::SliderFloat( "Shadow map z far", &settings.mShadowMapZFar, settings.mShadowMapZNear + 3.0f, 20000.0f );
     // ImGui::SliderFloat( "Shadow bias", &settings.mShadowBias, 0, 5000.0f );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -201,6 +225,17 @@ void UIDrawer::BuildVCTUI( )
             ImGui::SliderFloat( "GI amplification", &settings.mVCTIndirectAmplification, 0.0f, 10.0f );
             ImGui::SliderFloat( "Step correction", &settings.mVCTStepCorrection, 0.001f, 2.0f );
             ImGui::Checkbox( "Use opacity from buffer", &settings.mVCTUseOpacityBuffer );
+            ImGui::Checkbox( "Neighbor ropes", &settings.mVCTNeighborRopes );
+            ImGui::Checkbox( "Empty space skipping", &settings.mVCTEmptySpace );
+
+            ImGui::SliderInt( "Local lights", &settings.mLocalLightCount, 0, 16 );
+            ImGui::SliderInt( "Injection budget", &settings.mLightInjectionBudget, 1, 36 ); // shadow faces per frame
+            ImGui::Text( "Lights pending: %d, faces injected: %d", renderer.GetVCT( ).GetLightManager( ).GetPendingCount( ),
+                renderer.GetVCT( ).GetInjectedFaceCount( ) );
+            VoxelBufferStats voxelStats = renderer.GetVCT( ).GetVoxelBufferStats( );
+            ImGui::Text( "Voxel fragments %u/%u, reallocations %u, overflows %u", static_cast< unsigned >( voxelStats.mLastCount ),
+                static_cast< unsigned >( voxelStats.mCapacity ), static_cast< unsigned >( voxelStats.mReallocations ),
+                static_cast< unsigned >( voxelStats.mOverflows ) );
 
             ImGui::SliderInt( "Octree first", &settings.mVCTDebugOctreeFirstLevel, 1, settings.mOctreeHeight - 1 ); // kick
             if ( settings.mVCTDebugOctreeLastLevel >= settings.mVCTDebugOctreeFirstLevel )
@@ -212,6 +247,7 @@ void UIDrawer::BuildVCTUI( )
             ImGui::SliderInt( "Cone dir", &settings.mVCTDebugConeDir, 0, 4 );
 
             ImGui::SliderFloat( "Blur radius", &settings.mBlurRadius, 0.5f, 30.0f );
+            ImGui::SliderFloat( "Blur normal sharpness", &settings.mBlurNormalSharpness, 0.0f, 64.0f );
         }
         break;
     case RenderOutput::RO_BRICKS:
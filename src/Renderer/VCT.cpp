@@ -11,30 +11,58 @@
 #include <Material.h>
 #include <Settings.h>
 #include <Light.h>
+#include <ShadowMapper.h>
+#include <Core/OctreeLayout.h>
+#include <Core/VoxelMerge.h>
+#include <Core/TaskScheduler.h>
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static LightState ToLightState( const LightSource &light )
+{
+    LightState state;
+    state.mType = static_cast< LightKind >( light.type );
+    const DirectX::XMFLOAT3 *vectors[] = { &light.position, &light.direction, &light.color };
+    float *dst[] = { state.mPosition, state.mDirection, state.mColor };
+    for ( int i = 0; i < 3; i++ )
+    {
+        dst[i][0] = vectors[i]->x;
+        dst[i][1] = vectors[i]->y;
+        dst[i][2] = vectors[i]->z;
+    }
+    state.mRadius = light.radius;
+    state.mSpotAngle = light.spotAngle;
+    return state;
+}
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool VCT::Init( )
 {
-    mOctree.Init( );
+    CreateVoxelResources( );
+    CreatePhotonResources( );
 
-    // init DefferedVoxelThread
-    size_t voxelSize = 4; // uint position, uint color, uint normal, uint pad
-    size_t numElem = 1024 * 1024;
-    D3D11_BUFFER_DESC defferedFragBD = D3DStructuredBuffer::GenBufferDesc( D3D11_USAGE_DEFAULT, sizeof( int )* voxelSize * numElem,
-        D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE, 0, D3D11_RESOURCE_MISC_BUFFER_STRUCTURED, sizeof( int )* voxelSize );
-    D3D11_UNORDERED_ACCESS_VIEW_DESC defferedFragUAVDesc = D3DStructuredBuffer::GenUAVDesc( 0, numElem, D3D11_BUFFER_UAV_FLAG_COUNTER, D3D11_UAV_DIMENSION_BUFFER, DXGI_FORMAT_UNKNOWN );
+    mIsReady = mfxGenOctree.Load();
+    mIsReady &= mfxGenBrickBuffer.Load( );
+    mIsReady &= mfxConeTracing.Load( );
 
-    D3D11_SHADER_RESOURCE_VIEW_DESC defferedFragSRVDesc;
-    defferedFragSRVDesc.Format = DXGI_FORMAT_UNKNOWN;
-    defferedFragSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
-    defferedFragSRVDesc.BufferEx.FirstElement = 0;
-    defferedFragSRVDesc.BufferEx.NumElements = numElem;
-    defferedFragSRVDesc.BufferEx.Flags = 0;
+    ASSERT( mIsReady );
+
+    return mIsReady;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VCT::CreateVoxelResources( )
+{
+    mOctree.Init( );
 
     Settings &settings = Settings::Get( );
     D3DRenderer &renderer = D3DRenderer::Get( );
 
-    mVoxelArray = D3DStructuredBuffer::CreateBuffer( true, true, &defferedFragBD, nullptr, &defferedFragSRVDesc, &defferedFragUAVDesc );
+    // voxel array is kept between rebuilds and sized by the counting pass of VoxelizeStaticScene,
+    // until the first count it holds the policy minimum so bindings always have a buffer
+    if ( !mFragmentCounter )
+        mFragmentCounter = D3DStructuredBuffer::CreateAtomicCounter( );
+    if ( !mVoxelArray )
+        CreateVoxelArray( mVoxelBufferSizer.GetPolicy( ).mMinCapacity );
+    else if ( settings.mMergeVoxels != ( mVoxelReadback != nullptr ) )
+        CreateVoxelArray( mFragmentListSize );
 
     mBrickBufferSize = settings.mBrickBufferRes;
     D3D11_TEXTURE3D_DESC brickBufferDesc;
@@ -64,6 +92,25 @@ bool VCT::Init( )
     mOpacityBrickBuffer = D3DTextureBuffer3D::Create( true, true, &brickBufferDesc, &brickBufferSRVDesc, &brickBufferUAVDesc );
     mIrradianceBrickBuffer = D3DTextureBuffer3D::Create( true, true, &brickBufferDesc, &brickBufferSRVDesc, &brickBufferUAVDesc );
 
+    // empty space field two levels above the leaves, a byte per cell like OctreeDistanceField
+    mEmptySpaceLevel = mOctree.mHeight > 2 ? static_cast< uint32_t >( mOctree.mHeight - 2 ) : 0;
+    UINT emptySpaceSize = 1u << mEmptySpaceLevel;
+    D3D11_TEXTURE3D_DESC emptySpaceDesc = brickBufferDesc;
+    emptySpaceDesc.Width = emptySpaceSize;
+    emptySpaceDesc.Height = emptySpaceSize;
+    emptySpaceDesc.Depth = emptySpaceSize;
+    emptySpaceDesc.Format = DXGI_FORMAT_R8_UINT;
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC emptySpaceSRVDesc = brickBufferSRVDesc;
+    emptySpaceSRVDesc.Format = DXGI_FORMAT_R8_UINT;
+
+    D3D11_UNORDERED_ACCESS_VIEW_DESC emptySpaceUAVDesc = brickBufferUAVDesc;
+    emptySpaceUAVDesc.Texture3D.WSize = emptySpaceSize;
+    emptySpaceUAVDesc.Format = DXGI_FORMAT_R8_UINT;
+
+    mEmptySpace = D3DTextureBuffer3D::Create( true, true, &emptySpaceDesc, &emptySpaceSRVDesc, &emptySpaceUAVDesc );
+    mEmptySpaceScratch = D3DTextureBuffer3D::Create( true, true, &emptySpaceDesc, &emptySpaceSRVDesc, &emptySpaceUAVDesc );
+
     // init buffer for indirect draw calls
     size_t indirectBufferSize = 4 + mOctree.mHeight * 4;
     D3D11_BUFFER_DESC indirectBufferBD = D3DStructuredBuffer::GenBufferDesc( D3D11_USAGE_DEFAULT, sizeof( int )* indirectBufferSize,
@@ -90,19 +137,114 @@ bool VCT::Init( )
         D3DTextureBuffer2D::Create( true, false, true, false, 0, 0, 0, 0, 0.0f, settings.mVCTConeTracingRes, settings.mVCTConeTracingRes );
 
     mIndirectIrradianceBig = D3DTextureBuffer2D::Create( true, false, true, false, 0, 0, 0, 0, 1.0f, 0, 0 );
-    mIndirectIrradianceBigTmp = D3DTextureBuffer2D::Create( true, false, true, false, 0, 0, 0, 0, 1.0f, 0, 0 );
+
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VCT::CreateVoxelArray( size_t capacity )
+{
+    mVoxelArray.reset( );
+    mVoxelReadback.reset( );
+    mLeafIrradiance.reset( );
+
+    // init DefferedVoxelThread
+    size_t voxelSize = sizeof( OctreeVoxel ) / sizeof( int ); // uint position, uint color, uint normal, uint pad
+    UINT numElem = static_cast< UINT >( capacity );
+    D3D11_BUFFER_DESC defferedFragBD = D3DStructuredBuffer::GenBufferDesc( D3D11_USAGE_DEFAULT, sizeof( int )* voxelSize * numElem,
+        D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE, 0, D3D11_RESOURCE_MISC_BUFFER_STRUCTURED, sizeof( int )* voxelSize );
+    D3D11_UNORDERED_ACCESS_VIEW_DESC defferedFragUAVDesc = D3DStructuredBuffer::GenUAVDesc( 0, numElem, D3D11_BUFFER_UAV_FLAG_COUNTER, D3D11_UAV_DIMENSION_BUFFER, DXGI_FORMAT_UNKNOWN );
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC defferedFragSRVDesc;
+    defferedFragSRVDesc.Format = DXGI_FORMAT_UNKNOWN;
+    defferedFragSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
+    defferedFragSRVDesc.BufferEx.FirstElement = 0;
+    defferedFragSRVDesc.BufferEx.NumElements = numElem;
+    defferedFragSRVDesc.BufferEx.Flags = 0;
+
+    mVoxelArray = D3DStructuredBuffer::CreateBuffer( true, true, &defferedFragBD, nullptr, &defferedFragSRVDesc, &defferedFragUAVDesc );
+    mFragmentListSize = capacity;
+
+    // float4 per voxel, the light sum isn't quantized, so removals subtract exactly what was added
+    D3D11_BUFFER_DESC leafIrradianceBD = D3DStructuredBuffer::GenBufferDesc( D3D11_USAGE_DEFAULT, sizeof( float ) * 4 * numElem,
+        D3D11_BIND_UNORDERED_ACCESS, 0, D3D11_RESOURCE_MISC_BUFFER_STRUCTURED, sizeof( float ) * 4 );
+    D3D11_UNORDERED_ACCESS_VIEW_DESC leafIrradianceUAVDesc = D3DStructuredBuffer::GenUAVDesc( 0, numElem, 0, D3D11_UAV_DIMENSION_BUFFER, DXGI_FORMAT_UNKNOWN );
+    mLeafIrradiance = D3DStructuredBuffer::CreateBuffer( false, true, &leafIrradianceBD, nullptr, nullptr, &leafIrradianceUAVDesc );
+
+    if ( Settings::Get( ).mMergeVoxels )
+    {
+        D3D11_BUFFER_DESC readbackBD = D3DStructuredBuffer::GenBufferDesc( D3D11_USAGE_STAGING, sizeof( int )* voxelSize * numElem,
+            0, D3D11_CPU_ACCESS_READ, D3D11_RESOURCE_MISC_BUFFER_STRUCTURED, sizeof( int )* voxelSize );
+        mVoxelReadback = D3DStructuredBuffer::CreateBuffer( false, false, &readbackBD, nullptr, nullptr, nullptr );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VCT::ReserveVoxelArray( size_t fragments )
+{
+    VoxelBufferDecision decision = mVoxelBufferSizer.Reserve( fragments );
+    if ( decision.mAction != VBA_KEEP )
+    {
+        const char *actions[] = { "kept", "created", "grown", "shrunk" };
+        LOG_INFO( "Voxel array ", actions[decision.mAction], " for ", fragments, " fragments: ", decision.mCapacity, " fragments, ",
+            decision.mCapacity * sizeof( OctreeVoxel ) / ( 1024 * 1024 ), " MB" );
+        CreateVoxelArray( decision.mCapacity );
+    }
+
+    if ( decision.mDropped > 0 )
+    {
+        LOG_ERROR( "Voxel array overflow: ", fragments, " fragments counted, ", decision.mDropped, " dropped over the limit of ",
+            decision.mCapacity, ", lower vct.octree_height" );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VCT::CreatePhotonResources( )
+{
+    Settings &settings = Settings::Get( );
+
+    // photon list can hold every texel of the scene shadow map
+    size_t photonSize = 2; // uint key, uint flux
+    mPhotonListCapacity = 1;
+    while ( mPhotonListCapacity < static_cast< size_t >( settings.mShadowMapRes ) * settings.mShadowMapRes )
+        mPhotonListCapacity <<= 1;
+
+    D3D11_BUFFER_DESC photonListBD = D3DStructuredBuffer::GenBufferDesc( D3D11_USAGE_DEFAULT, sizeof( int ) * photonSize * mPhotonListCapacity,
+        D3D11_BIND_UNORDERED_ACCESS, 0, D3D11_RESOURCE_MISC_BUFFER_STRUCTURED, sizeof( int ) * photonSize );
+    D3D11_UNORDERED_ACCESS_VIEW_DESC photonListUAVDesc = D3DStructuredBuffer::GenUAVDesc( 0, mPhotonListCapacity, D3D11_BUFFER_UAV_FLAG_COUNTER,
+        D3D11_UAV_DIMENSION_BUFFER, DXGI_FORMAT_UNKNOWN );
+    mPhotonList = D3DStructuredBuffer::CreateBuffer( false, true, &photonListBD, nullptr, nullptr, &photonListUAVDesc );
 
     // should be max shadow resolution size
     mProcessShadowRT = 
         D3DTextureBuffer2D::Create( true, false, false, false, 0, 0, 0, 0, 1.0f, settings.mShadowMapRes, settings.mShadowMapRes );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VCT::Reallocate( uint32_t reload )
+{
+    if ( !mIsReady )
+        return;
 
-    mIsReady = mfxGenOctree.Load();
-    mIsReady &= mfxGenBrickBuffer.Load( );
-    mIsReady &= mfxConeTracing.Load( );
+    // everything sized by octree, brick and cone tracing settings is created again, effects are kept
+    if ( reload & SR_VCT )
+    {
+        mOctree.Clear( );
+        mIndirectDrawBuffer.reset( );
+        mOpacityBrickBuffer.reset( );
+        mIrradianceBrickBuffer.reset( );
+        mEmptySpace.reset( );
+        mEmptySpaceScratch.reset( );
+        mIndirectIrradianceSmall.reset( );
+        mIndirectIrradianceBig.reset( );
+        CreateVoxelResources( );
+        mNeedsVoxelization = true;
+    }
 
-    ASSERT( mIsReady );
+    if ( reload & SR_SHADOW_MAPS )
+    {
+        mPhotonList.reset( );
+        mProcessShadowRT.reset( );
+        CreatePhotonResources( );
+    }
 
-    return mIsReady;
+    // irradiance is injected again
+    mLightManager.Invalidate( );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void VCT::Clear()
@@ -110,13 +252,19 @@ void VCT::Clear()
     mOctree.Clear( );
 
     mVoxelArray.reset();
+    mVoxelReadback.reset( );
+    mLeafIrradiance.reset( );
+    mFragmentCounter.reset( );
+    mVoxelBufferSizer.Reset( );
     mIndirectDrawBuffer.reset();
     mOpacityBrickBuffer.reset();
     mIrradianceBrickBuffer.reset();
+    mEmptySpace.reset( );
+    mEmptySpaceScratch.reset( );
     mIndirectIrradianceSmall.reset();
     mIndirectIrradianceBig.reset();
-    mIndirectIrradianceBigTmp.reset();
     mProcessShadowRT.reset();
+    mPhotonList.reset( );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool VCT::IsReady( )
@@ -129,11 +277,6 @@ bool VCT::NeedsVoxelization()
     return mNeedsVoxelization;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool VCT::NeedsProcessLight( const LightSource &lsource )
-{
-    return mProcessedLight != lsource;
-}
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void VCT::VoxelizeStaticScene( const std::vector<SceneGeometry> &objs )
 {
     if ( !mIsReady )
@@ -146,46 +289,79 @@ void VCT::VoxelizeStaticScene( const std::vector<SceneGeometry> &objs )
     D3DRenderer &renderer = D3DRenderer::Get( );
     auto immediateContext = renderer.GetContext( );
     UINT tmpClearValue[4] = { 0, 0, 0, 0 };
+    ID3D11RenderTargetView *mainRTV = renderer.GetMainRT( )->GetRTV();
+    renderer.SetSceneGeometryLayout( mfxGenOctree.mfxGeometryBounds );
+    bool compact = renderer.GetSceneVertexFormat( ) == D3DGeometryBuffer::V_COMPACT16;
+    renderer.BuildRenderQueue( objs, RQT_VOXELIZATION, true, mRenderQueue );
+    const std::vector<RenderBatch> &batches = mRenderQueue.GetBatches( );
+
+    // counting pass: the same rasterization without writes, voxel array is sized by its fragment count
+    ID3D11UnorderedAccessView *counterUAV = mFragmentCounter->GetUAV( );
+    immediateContext->OMSetRenderTargetsAndUnorderedAccessViews( 0, nullptr, nullptr, 0, 1, &counterUAV, tmpClearValue ); // clear counters - effect11 lack
+    immediateContext->OMSetRenderTargets( 1, &mainRTV, nullptr );
+    renderer.SetViewport( static_cast<float>( mOctree.mResolution ), static_cast<float>( mOctree.mResolution ), 0, 1.0f, 0, 0 );
+
+    ID3DX11EffectPass *countPass = compact ? mfxGenOctree.mGenOctree.mCountVoxelFragmentsCompact : mfxGenOctree.mGenOctree.mCountVoxelFragments;
+    countPass->Apply( 0, immediateContext );
+    for ( size_t i = 0; i < batches.size( ); i++ )
+        renderer.DrawRenderBatch( batches[i] );
+
+    mfxGenOctree.mfxFragmentCounterRW->SetUnorderedAccessView( nullptr );
+    countPass->Apply( 0, immediateContext );
+
+    // performance hit: return value immediately, can stall GPU
+    ReserveVoxelArray( renderer.GetValueFromCounter( mFragmentCounter ) );
+    mfxGenOctree.BindVCTResources( *this ); // voxel array could be created again
+
     ID3D11UnorderedAccessView *uav = mVoxelArray->GetUAV();
     immediateContext->ClearUnorderedAccessViewUint( uav, tmpClearValue );
     immediateContext->OMSetRenderTargetsAndUnorderedAccessViews( 0, nullptr, nullptr, 0, 1, &uav, tmpClearValue ); // clear counters - effect11 lack
 
     mOctree.ClearOctree( );
 
-    ID3D11RenderTargetView *mainRTV = renderer.GetMainRT( )->GetRTV();
     immediateContext->OMSetRenderTargets( 1, &mainRTV, nullptr );
 
     renderer.SetViewport( static_cast<float>( mOctree.mResolution ), static_cast<float>( mOctree.mResolution ), 0, 1.0f, 0, 0 );
 
-    immediateContext->IASetInputLayout( renderer.GetDefaultInputLayout() );
-    immediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+    ID3DX11EffectPass *voxelizePass = compact ? mfxGenOctree.mGenOctree.mCreateVoxelArrayCompact : mfxGenOctree.mGenOctree.mCreateVoxelArray;
 
-    // voxelize scene
-    for each ( auto &obj in objs )
+    // voxelize scene sorted by material; textures are set only when they change
+    for ( size_t i = 0; i < batches.size( ); i++ )
     {
-        const std::shared_ptr<Material> &mat = obj.mMaterial;
-        if ( mat->tex0 )
-            mfxGenOctree.mfxAlbedoTexture->SetResource( mat->tex0->GetSRV( ) );
-        else
-            mfxGenOctree.mfxAlbedoTexture->SetResource( renderer.GetDefaultTexture( )->GetSRV( ) );
+        const RenderBatch &batch = batches[i];
+        bool first = i == 0;
+        uint64_t prevKey = first ? 0 : batches[i - 1].mKey;
+        const std::shared_ptr<Material> &mat = objs[batch.mObject].mMaterial;
 
-        if ( mat->tex1 )
+        bool albedoChanged = first || RenderQueue::GetAlbedoTexture( batch.mKey ) != RenderQueue::GetAlbedoTexture( prevKey );
+        if ( albedoChanged )
         {
-            mfxGenOctree.mfxUseNormalMap->SetBool( true ); // performance hint: should be batched
-            mfxGenOctree.mfxNormalTexture->SetResource( mat->tex1->GetSRV() );
+            if ( mat->tex0 )
+                mfxGenOctree.mfxAlbedoTexture->SetResource( mat->tex0->GetSRV( ) );
+            else
+                mfxGenOctree.mfxAlbedoTexture->SetResource( renderer.GetDefaultTexture( )->GetSRV( ) );
         }
-        else
+
+        bool normalChanged = first || RenderQueue::GetNormalTexture( batch.mKey ) != RenderQueue::GetNormalTexture( prevKey );
+        if ( normalChanged )
         {
-            mfxGenOctree.mfxUseNormalMap->SetBool( false );
+            mfxGenOctree.mfxUseNormalMap->SetBool( mat->tex1 != nullptr );
+            if ( mat->tex1 )
+                mfxGenOctree.mfxNormalTexture->SetResource( mat->tex1->GetSRV( ) );
         }
 
-        mfxGenOctree.mGenOctree.mCreateVoxelArray->Apply( 0, immediateContext );
-        renderer.DrawGeometry( obj.mGeometryBuffer );
+        if ( albedoChanged || normalChanged )
+            voxelizePass->Apply( 0, immediateContext );
+
+        renderer.DrawRenderBatch( batch );
     }
 
     // clear
     mfxGenOctree.mfxVoxelArrayRW->SetUnorderedAccessView( nullptr );
-    mfxGenOctree.mGenOctree.mCreateVoxelArray->Apply( 0, immediateContext );
+    voxelizePass->Apply( 0, immediateContext );
+
+    if ( mVoxelReadback )
+        MergeVoxelArray( );
 
     renderer.SetIndirectLayout( );
     ID3D11Buffer *indirectBuffer = GetIndirectDrawBuffer( )->GetBuffer();
@@ -212,6 +388,9 @@ void VCT::VoxelizeStaticScene( const std::vector<SceneGeometry> &objs )
     mfxGenOctree.mGenOctree.mConnectNodesToVoxels->Apply( 0, immediateContext );
     immediateContext->DrawInstancedIndirect( indirectBuffer, 0 );
 
+    // before light injection adds NODE_LIT to the node flags
+    BuildEmptySpace( );
+
     // now we get octree and we can build brick buffer
     // performance hit: return value immediately, can stall GPU
     uint32_t nodesPackCount = renderer.GetValueFromCounter( mOctree.mNodesPackCounter );
@@ -219,9 +398,48 @@ void VCT::VoxelizeStaticScene( const std::vector<SceneGeometry> &objs )
 
     GenOpacityBrickBuffer( );
 
+    // new octree has no light information
+    mLightManager.Invalidate( );
     mNeedsVoxelization = false;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VCT::MergeVoxelArray( )
+{
+    D3DRenderer &renderer = D3DRenderer::Get( );
+    auto immediateContext = renderer.GetContext( );
+
+    // the counter runs past the capacity, those fragments were never written
+    // performance hit: return value immediately, can stall GPU
+    uint32_t fragmentCount = ( std::min )( renderer.GetValueFromCounter( mVoxelArray ), static_cast< uint32_t >( mFragmentListSize ) );
+    if ( fragmentCount == 0 )
+        return;
+
+    D3D11_BOX box = { 0, 0, 0, static_cast< UINT >( fragmentCount * sizeof( OctreeVoxel ) ), 1, 1 };
+    immediateContext->CopySubresourceRegion( mVoxelReadback->GetBuffer( ), 0, 0, 0, 0, mVoxelArray->GetBuffer( ), 0, &box );
+
+    D3D11_MAPPED_SUBRESOURCE subRes;
+    HRESULT hr = immediateContext->Map( mVoxelReadback->GetBuffer( ), 0, D3D11_MAP_READ, 0, &subRes );
+    ASSERT( hr == S_OK );
+    if ( hr != S_OK )
+        return;
+
+    const OctreeVoxel *fragments = static_cast< const OctreeVoxel* >( subRes.pData );
+    mVoxelFragments.assign( fragments, fragments + fragmentCount );
+    immediateContext->Unmap( mVoxelReadback->GetBuffer( ), 0 );
+
+    // sorted by position, so neighbouring voxels traverse the same nodes one after another
+    uint32_t voxelCount = static_cast< uint32_t >( MergeVoxelFragments( mVoxelFragments, mVoxelMergeScratch, TaskScheduler::Get( ) ) );
+
+    box.right = static_cast< UINT >( voxelCount * sizeof( OctreeVoxel ) );
+    immediateContext->UpdateSubresource( mVoxelArray->GetBuffer( ), 0, &box, mVoxelFragments.data( ), 0, 0 );
+
+    // FlagNodes and ConnectNodesToVoxels draw a vertex per voxel, see INDIRECT_VOXELS_OFFSET in indirectBufferUtils.fx
+    D3D11_BOX countBox = { 0, 0, 0, sizeof( uint32_t ), 1, 1 };
+    immediateContext->UpdateSubresource( mIndirectDrawBuffer->GetBuffer( ), 0, &countBox, &voxelCount, 0, 0 );
+
+    LOG_INFO( "Voxel fragments ", fragmentCount, " merged to ", voxelCount, " voxels" );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void VCT::ClearIrradianceBrickBuffer()
 {
     if ( !mIsReady )
@@ -244,13 +462,19 @@ void VCT::ClearIrradianceBrickBuffer()
     context->Draw( mOctree.mNodesCount, 0 );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void VCT::ProcessShadowMap( LightSource &lsource, ShadowMap &shadowMap )
+void VCT::ProcessShadowMap( const LightState &light, ShadowMap &shadowMap, float sign )
 {
-    if ( !mIsReady || NeedsVoxelization( ) || !shadowMap.mShadowTexture )
+    if ( !mIsReady || NeedsVoxelization( ) || !shadowMap.mShadowTexture || !shadowMap.mFluxTexture )
         return;
 
     D3DRenderer &renderer = D3DRenderer::Get( );
     auto context = renderer.GetContext();
+
+    // clear photon counter - effect11 lack
+    UINT tmpClearValue[4] = { 0, 0, 0, 0 };
+    ID3D11UnorderedAccessView *photonListUAV = mPhotonList->GetUAV( );
+    context->OMSetRenderTargetsAndUnorderedAccessViews( 0, nullptr, nullptr, 0, 1, &photonListUAV, tmpClearValue );
+
     ID3D11RenderTargetView *rt = mProcessShadowRT->GetRTV();
     context->ClearRenderTargetView( rt, DirectX::Colors::AliceBlue );
     context->OMSetRenderTargets( 1, &rt, nullptr );
@@ -266,15 +490,16 @@ void VCT::ProcessShadowMap( LightSource &lsource, ShadowMap &shadowMap )
     mfxGenBrickBuffer.mfxShadowInverseView->SetMatrix( reinterpret_cast< float* >( &iView ) );
     // get resolution from shadowMap
 
-    DirectX::XMFLOAT3 &lColor = lsource.color;
-    DirectX::XMFLOAT3 &lPos = lsource.position;
-    DirectX::XMFLOAT3 &lDir = lsource.direction;
-    DirectX::XMVECTOR vlColorRadius = DirectX::XMVectorSet( lColor.x, lColor.y, lColor.z, lsource.radius );
-    DirectX::XMVECTOR vlPos = DirectX::XMVectorSet( lPos.x, lPos.y, lPos.z, 1.0f );
-    DirectX::XMVECTOR vlDir = DirectX::XMVectorSet( lDir.x, lDir.y, lDir.z, 1.0f );
+    const float *lColor = light.mColor;
+    const float *lPos = light.mPosition;
+    const float *lDir = light.mDirection;
+    DirectX::XMVECTOR vlColorRadius = DirectX::XMVectorSet( lColor[0], lColor[1], lColor[2], light.mRadius );
+    DirectX::XMVECTOR vlPos = DirectX::XMVectorSet( lPos[0], lPos[1], lPos[2], 1.0f );
+    DirectX::XMVECTOR vlDir = DirectX::XMVectorSet( lDir[0], lDir[1], lDir[2], 1.0f );
     mfxGenBrickBuffer.mfxLightColorRadius->SetFloatVector( reinterpret_cast< float* >( &vlColorRadius ) );
     mfxGenBrickBuffer.mfxLightPosition->SetFloatVector( reinterpret_cast< float* >( &vlPos ) );
-    mfxGenBrickBuffer.mfxLightDirection->SetFloatVector( reinterpret_cast< float* >( &lDir ) );
+    mfxGenBrickBuffer.mfxLightDirection->SetFloatVector( reinterpret_cast< float* >( &vlDir ) );
+    mfxGenBrickBuffer.mfxInjectionSign->SetFloat( sign );
 
     mfxGenBrickBuffer.BindVCTResources( *this );
 
@@ -288,14 +513,70 @@ void VCT::ProcessShadowMap( LightSource &lsource, ShadowMap &shadowMap )
     immediateContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
 
     mfxGenBrickBuffer.mfxShadowMap->SetResource( shadowTex->GetSRV() );
+    mfxGenBrickBuffer.mfxFluxMap->SetResource( shadowMap.mFluxTexture->GetSRV( ) );
+    mfxGenBrickBuffer.mfxPhotonListRW->SetUnorderedAccessView( photonListUAV );
 
-    mfxGenBrickBuffer.mProcessingShadowMap.mProcessPass->Apply( 0, immediateContext );
+    // texels which hit the octree become ( leaf key, flux ) photons
+    mfxGenBrickBuffer.mProcessingShadowMap.mCompactPhotons->Apply( 0, immediateContext );
 
     renderer.DrawGeometry( renderer.GetQuad( ) );
 
     mfxGenBrickBuffer.mfxShadowMap->SetResource( nullptr );
-    mfxGenBrickBuffer.mProcessingShadowMap.mProcessPass->Apply( 0, immediateContext );
+    mfxGenBrickBuffer.mfxFluxMap->SetResource( nullptr );
+    mfxGenBrickBuffer.mProcessingShadowMap.mCompactPhotons->Apply( 0, immediateContext );
+
+    // performance hit: return value immediately, can stall GPU
+    uint32_t photonCount = renderer.GetValueFromCounter( mPhotonList );
+    SortAndInjectPhotons( photonCount );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VCT::InjectLights( const std::vector<SceneGeometry> &objs, const std::vector<LightSource> &lights, ShadowMapper &shadowMapper )
+{
+    mInjectedFaceCount = 0;
+    if ( !mIsReady || NeedsVoxelization( ) )
+        return;
+
+    Settings &settings = Settings::Get( );
+    std::vector<LightState> states( lights.size( ) );
+    for ( size_t i = 0; i < lights.size( ); i++ )
+        states[i] = ToLightState( lights[i] );
+
+    mLightManager.SetBudget( settings.mLightInjectionBudget );
+    mLightManager.Sync( states );
+    LightSchedule schedule = mLightManager.Schedule( );
+    if ( !schedule.mRebuild && schedule.mInjections.empty( ) )
+        return;
+
+    D3DRenderer &renderer = D3DRenderer::Get( );
+    auto immediateContext = renderer.GetContext( );
 
+    if ( schedule.mRebuild )
+    {
+        // clear previous light information, the bricks are cleared by ResolveLeafIrradiance
+        UINT tmpClearValue[4] = { 0, 0, 0, 0 };
+        immediateContext->ClearUnorderedAccessViewUint( mLeafIrradiance->GetUAV( ), tmpClearValue );
+    }
+
+    for each ( auto &injection in schedule.mInjections )
+    {
+        if ( injection.mState.mType == LIGHT_DIRECTIONAL )
+        {
+            // scene map is drawn for the first light only
+            ASSERT( injection.mLight == 0 );
+            if ( injection.mLight == 0 )
+                ProcessShadowMap( injection.mState, shadowMapper.GetShadowMap( ), injection.mSign );
+            continue;
+        }
+
+        for ( int face = 0; face < GetLightFaceCount( injection.mState.mType ); face++ )
+        {
+            ShadowMap &faceMap = shadowMapper.DrawLightFace( objs, injection.mState, face );
+            ProcessShadowMap( injection.mState, faceMap, injection.mSign );
+        }
+    }
+    mInjectedFaceCount = schedule.GetFaceCount( );
+
+    ResolveLeafIrradiance( );
     GenRadianceBrickBuffer( mIrradianceBrickBuffer );
 
     renderer.SetDefaultViewport();
@@ -304,9 +585,65 @@ void VCT::ProcessShadowMap( LightSource &lsource, ShadowMap &shadowMap )
     mfxGenBrickBuffer.mOctreeVariables.mfxOctreeR->SetResource( nullptr );
     mfxGenBrickBuffer.mOctreeVariables.mfxOctreeRW->SetUnorderedAccessView( nullptr );
     mfxGenBrickBuffer.mfxBrickBufferRW->SetUnorderedAccessView( nullptr );
+    mfxGenBrickBuffer.mfxPhotonListRW->SetUnorderedAccessView( nullptr );
+    mfxGenBrickBuffer.mfxLeafIrradianceRW->SetUnorderedAccessView( nullptr );
     mfxGenBrickBuffer.mProcessingShadowMap.mAverageLitNodeValues->Apply( 0, immediateContext );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VCT::ResolveLeafIrradiance( )
+{
+    // the alias averaging of GenRadianceBrickBuffer overwrites leaf brick corners, so the bricks are rebuilt from the
+    // float sums after every injection instead of adding to what the last averaging left there
+    ClearIrradianceBrickBuffer( );
+
+    D3DRenderer &renderer = D3DRenderer::Get( );
+    auto immediateContext = renderer.GetContext( );
+
+    mfxGenBrickBuffer.BindVCTResources( *this );
+
+    renderer.SetIndirectLayout( );
+    mfxGenBrickBuffer.mProcessingShadowMap.mResolveLeafIrradiance->Apply( 0, immediateContext );
+    immediateContext->DrawInstancedIndirect( mIndirectDrawBuffer->GetBuffer( ), 0 );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VCT::SortAndInjectPhotons( uint32_t photonCount )
+{
+    // bitonic sort by leaf key, then the first photon of every key averages its run and traverses the octree,
+    // so each lit leaf is written once instead of once per texel (see Core/PhotonList.h for the cpu reference)
+    if ( photonCount == 0 )
+        return;
+
+    D3DRenderer &renderer = D3DRenderer::Get( );
+    auto context = renderer.GetContext( );
+    auto &psm = mfxGenBrickBuffer.mProcessingShadowMap;
+
+    size_t sortSize = 1;
+    while ( sortSize < photonCount )
+        sortSize <<= 1;
+    ASSERT( sortSize <= mPhotonListCapacity );
+
+    renderer.SetIndirectLayout( );
+    mfxGenBrickBuffer.mfxPhotonCount->SetInt( photonCount );
+
+    if ( sortSize > photonCount )
+    {
+        psm.mPadPhotons->Apply( 0, context );
+        context->Draw( sortSize - photonCount, 0 );
+    }
+
+    for ( size_t blockSize = 2; blockSize <= sortSize; blockSize <<= 1 )
+    {
+        for ( size_t stride = blockSize >> 1; stride > 0; stride >>= 1 )
+        {
+            mfxGenBrickBuffer.mfxSortBlockSize->SetInt( blockSize );
+            mfxGenBrickBuffer.mfxSortStride->SetInt( stride );
+            psm.mSortPhotons->Apply( 0, context );
+            context->Draw( sortSize / 2, 0 );
+        }
+    }
 
-    mProcessedLight = lsource;
+    psm.mInjectPhotons->Apply( 0, context );
+    context->Draw( photonCount, 0 );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void VCT::VoxelConeTracing( )
@@ -357,8 +694,7 @@ void VCT::VoxelConeTracing( )
     mfxConeTracing.mfxConeTracing->Apply( 0, immediateContext );
 
     auto &blur = renderer.GetBlur( );
-    blur.UpscaleBlur( gbuffer.GetDepth( ), mIndirectIrradianceSmall,
-        mIndirectIrradianceBigTmp, mIndirectIrradianceBig );
+    blur.UpscaleBlur( gbuffer.GetDepth( ), gbuffer.GetNormal( ), mIndirectIrradianceSmall, mIndirectIrradianceBig );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void VCT::DrawBuffers( bool showVoxels )
@@ -421,6 +757,26 @@ size_t VCT::GetFragmentListSize( )
     return mFragmentListSize;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<D3DStructuredBuffer> VCT::GetFragmentCounter( )
+{
+    return mFragmentCounter;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+VoxelBufferStats VCT::GetVoxelBufferStats( ) const
+{
+    return mVoxelBufferSizer.GetStats( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+LightManager& VCT::GetLightManager( )
+{
+    return mLightManager;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int VCT::GetInjectedFaceCount( )
+{
+    return mInjectedFaceCount;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 std::shared_ptr<D3DStructuredBuffer> VCT::GetIndirectDrawBuffer()
 {
     return mIndirectDrawBuffer;
@@ -431,6 +787,11 @@ std::shared_ptr<D3DStructuredBuffer> VCT::GetVoxelArray( )
     return mVoxelArray;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<D3DStructuredBuffer> VCT::GetLeafIrradiance( )
+{
+    return mLeafIrradiance;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 std::shared_ptr<D3DTextureBuffer3D> VCT::GetOpacityBrickBuffer( )
 {
     return mOpacityBrickBuffer;
@@ -441,6 +802,11 @@ std::shared_ptr<D3DTextureBuffer3D> VCT::GetIrradianceBrickBuffer( )
     return mIrradianceBrickBuffer;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<D3DTextureBuffer3D> VCT::GetEmptySpace( )
+{
+    return mEmptySpace;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 std::shared_ptr<D3DTextureBuffer2D> VCT::GetIndirectIrradianceSmall( )
 {
     return mIndirectIrradianceSmall;
@@ -492,6 +858,23 @@ bool VCT::GetUseOpacityBuffer()
     return settings.mVCTUseOpacityBuffer;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool VCT::GetNeighborRopes( )
+{
+    Settings &settings = Settings::Get( );
+    return settings.mVCTNeighborRopes;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool VCT::GetUseEmptySpace( )
+{
+    Settings &settings = Settings::Get( );
+    return settings.mVCTEmptySpace;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t VCT::GetEmptySpaceLevel( )
+{
+    return mEmptySpaceLevel;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 int VCT::GetDebugOctreeLevel( )
 {
     Settings &settings = Settings::Get( );
@@ -576,6 +959,43 @@ void VCT::GenOpacityBrickBuffer()
     mfxGenBrickBuffer.mGenBrickBuffer.mAverageAlongAxisZ->Apply( 0, immediateContext );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VCT::BuildEmptySpace( )
+{
+    D3DRenderer &renderer = D3DRenderer::Get( );
+    auto immediateContext = renderer.GetContext( );
+    auto &mgo = mfxGenOctree.mGenOctree;
+    UINT cellsCount = 1u << ( 3 * mEmptySpaceLevel );
+
+    // occupied cells of the octree level into the scratch texture, one vertex per cell
+    mfxGenOctree.mfxEmptySpaceLevel->SetInt( mEmptySpaceLevel );
+    mfxGenOctree.mfxEmptySpaceR->SetResource( nullptr );
+    mfxGenOctree.mfxEmptySpaceRW->SetUnorderedAccessView( mEmptySpaceScratch->GetUAV( ) );
+    mgo.mMarkEmptySpace->Apply( 0, immediateContext );
+    immediateContext->Draw( cellsCount, 0 );
+
+    // x: scratch -> field, y: field -> scratch, z: scratch -> field
+    ID3DX11EffectPass *axisPasses[3] = { mgo.mEmptySpaceAlongAxisX, mgo.mEmptySpaceAlongAxisY, mgo.mEmptySpaceAlongAxisZ };
+    D3DTextureBuffer3D *buffers[2] = { mEmptySpace.get( ), mEmptySpaceScratch.get( ) };
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        D3DTextureBuffer3D *target = buffers[axis & 1], *source = buffers[( axis + 1 ) & 1];
+
+        // the target is bound first, so the source isn't a bound uav anymore when it is bound as srv
+        mfxGenOctree.mfxEmptySpaceR->SetResource( nullptr );
+        mfxGenOctree.mfxEmptySpaceRW->SetUnorderedAccessView( target->GetUAV( ) );
+        axisPasses[axis]->Apply( 0, immediateContext );
+
+        mfxGenOctree.mfxEmptySpaceR->SetResource( source->GetSRV( ) );
+        axisPasses[axis]->Apply( 0, immediateContext );
+        immediateContext->Draw( cellsCount, 0 );
+    }
+
+    // cone tracing binds the field as srv
+    mfxGenOctree.mfxEmptySpaceR->SetResource( nullptr );
+    mfxGenOctree.mfxEmptySpaceRW->SetUnorderedAccessView( nullptr );
+    mgo.mEmptySpaceAlongAxisZ->Apply( 0, immediateContext );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void VCT::GenRadianceBrickBuffer( std::shared_ptr<D3DTextureBuffer3D> &texbuffer )
 {
     D3DRenderer &renderer = D3DRenderer::Get();
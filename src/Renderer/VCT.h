@@ -9,6 +9,10 @@
 #include <FXBindings/FXGenerateOctree.h>
 #include <FXBindings/FXGenerateBrickBuffer.h>
 #include <FXBindings/FXConeTracing.h>
+#include <Core/RenderQueue.h>
+#include <Core/LightManager.h>
+#include <Core/OctreeLayout.h>
+#include <Core/VoxelBufferSizer.h>
 
 class D3DTextureBuffer2D;
 class D3DTextureBuffer3D;
@@ -17,6 +21,7 @@ struct ID3D11Texture2D;
 struct ID3D11Buffer;
 struct SceneGeometry;
 struct ShadowMap;
+class ShadowMapper;
 
 // voxel cone tracing class
 class VCT
@@ -26,15 +31,19 @@ public:
 
     bool Init( );
     void Clear( );
+    // recreates resources sized by changed settings, reload is SettingsReload mask
+    void Reallocate( uint32_t reload );
 
     bool IsReady( );
     bool NeedsVoxelization( );
-    bool NeedsProcessLight( const LightSource &lsource );
 
     void VoxelizeStaticScene( const std::vector<SceneGeometry> &objs );
     //void VoxelizeDynamicScene( const std::vector<SceneGeometry> &objs );
     void ClearIrradianceBrickBuffer();
-    void ProcessShadowMap( LightSource &lsource, ShadowMap &shadowMap );
+    // injects changed lights within the per frame budget, only the first light can be directional ( the sun,
+    // its scene map is drawn by ShadowMapper::Draw ), point and spot reflective shadow maps are drawn here
+    void InjectLights( const std::vector<SceneGeometry> &objs, const std::vector<LightSource> &lights, ShadowMapper &shadowMapper );
+    void ProcessShadowMap( const LightState &light, ShadowMap &shadowMap, float sign );
 
     void VoxelConeTracing( );
 
@@ -42,11 +51,17 @@ public:
 
     Octree& GetOctree( );
     size_t GetFragmentListSize( );
+    std::shared_ptr<D3DStructuredBuffer> GetFragmentCounter( );
+    VoxelBufferStats GetVoxelBufferStats( ) const;
+    LightManager& GetLightManager( );
+    int GetInjectedFaceCount( ); // light faces injected during last frame
 
     std::shared_ptr<D3DStructuredBuffer> GetIndirectDrawBuffer( );
     std::shared_ptr<D3DStructuredBuffer> GetVoxelArray( );
+    std::shared_ptr<D3DStructuredBuffer> GetLeafIrradiance( );
     std::shared_ptr<D3DTextureBuffer3D> GetOpacityBrickBuffer( );
     std::shared_ptr<D3DTextureBuffer3D> GetIrradianceBrickBuffer( );
+    std::shared_ptr<D3DTextureBuffer3D> GetEmptySpace( );
     std::shared_ptr<D3DTextureBuffer2D> GetIndirectIrradianceSmall( );
     std::shared_ptr<D3DTextureBuffer2D> GetIndirectIrradiance( );
 
@@ -57,6 +72,9 @@ public:
     float GetIndirectInfluence( );
     float GetStepCorrection( );
     bool GetUseOpacityBuffer( );
+    bool GetNeighborRopes( );
+    bool GetUseEmptySpace( );
+    uint32_t GetEmptySpaceLevel( );
 
     int GetDebugOctreeLevel( );
     bool GetDebugView( );
@@ -70,27 +88,47 @@ private:
     bool mIsReady = false;
     bool mNeedsVoxelization = true;
 
-    size_t mFragmentListSize;
-    std::weak_ptr<D3DStructuredBuffer> mFragmentCounter;
+    size_t mFragmentListSize = 0; // voxel array capacity
+    std::shared_ptr<D3DStructuredBuffer> mFragmentCounter; // fragments of the counting pass
+    VoxelBufferSizer mVoxelBufferSizer;
     std::shared_ptr<D3DStructuredBuffer> mIndirectDrawBuffer; // contains metadata for directx indirect draw (voxels count, nodes count per tree level)
     std::shared_ptr<D3DStructuredBuffer> mVoxelArray;
-    LightSource mProcessedLight;
+    std::shared_ptr<D3DStructuredBuffer> mVoxelReadback; // staging copy of mVoxelArray, only with voxel merging
+    std::shared_ptr<D3DStructuredBuffer> mLeafIrradiance; // float sum of the injected lights per voxel of mVoxelArray
+    std::vector<OctreeVoxel> mVoxelFragments; // merge buffers are kept between voxelizations, see Core/VoxelMerge.h
+    std::vector<OctreeVoxel> mVoxelMergeScratch;
+    LightManager mLightManager;
+    int mInjectedFaceCount = 0;
 
     size_t mBrickBufferSize;
     std::shared_ptr<D3DTextureBuffer3D> mOpacityBrickBuffer;
     std::shared_ptr<D3DTextureBuffer3D> mIrradianceBrickBuffer;
 
+    uint32_t mEmptySpaceLevel = 0;
+    std::shared_ptr<D3DTextureBuffer3D> mEmptySpace; // R8 distance to the nearest node with voxels per cell of mEmptySpaceLevel
+    std::shared_ptr<D3DTextureBuffer3D> mEmptySpaceScratch; // other target of the per axis passes
+
     std::shared_ptr<D3DTextureBuffer2D> mProcessShadowRT;
+    std::shared_ptr<D3DStructuredBuffer> mPhotonList; // ( leaf morton key, flux ) per shadow texel, see Core/PhotonList.h
+    size_t mPhotonListCapacity = 0; // power of two for the bitonic sort
     std::shared_ptr<D3DTextureBuffer2D> mIndirectIrradianceSmall; // render indirect irradiance via VCT here
     std::shared_ptr<D3DTextureBuffer2D> mIndirectIrradianceBig; // final indirect irradiance texture
-    std::shared_ptr<D3DTextureBuffer2D> mIndirectIrradianceBigTmp; // used for blur; can be replaced by mIndirectIrradianceBig and merged to gbuffer
 
     Octree mOctree;
     FXGenerateOctree mfxGenOctree;
     FXGenerateBrickBuffer mfxGenBrickBuffer;
     FXConeTracing mfxConeTracing;
+    RenderQueue mRenderQueue;
 
+    void CreateVoxelResources( );
+    void CreateVoxelArray( size_t capacity );
+    void ReserveVoxelArray( size_t fragments ); // sizer decision for the counted fragments, overflow goes to the log
+    void CreatePhotonResources( ); // sized by shadow map resolution
+    void MergeVoxelArray( ); // one voxel per leaf in mVoxelArray and voxels count
     void GenOpacityBrickBuffer();
+    void BuildEmptySpace( ); // distance field of the new octree, see Core/DistanceField.h for the cpu reference
+    void SortAndInjectPhotons( uint32_t photonCount );
+    void ResolveLeafIrradiance( ); // rewrites the leaf bricks from mLeafIrradiance
     void GenRadianceBrickBuffer( std::shared_ptr<D3DTextureBuffer3D> &texbuffer );
 
     void AverageBrickAlias( FXGenerateBrickBuffer *fx, ID3D11Buffer *indirectBuffer, size_t indirectBufferOffset );
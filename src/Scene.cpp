@@ -6,6 +6,10 @@
 #include <Material.h>
 #include <SceneGeometry.h>
 #include <GeometryGenerator.h>
+#include <Core/ObjLoader.h>
+#include <Core/SceneStream.h>
+#include <Core/MeshOptimizer.h>
+#include <Core/TaskScheduler.h>
 #include <Light.h>
 #include <Settings.h>
 #include <GameTimer.h>
@@ -17,23 +21,29 @@
 #include <array>
 #include <unordered_map>
 
-void LoadSingleObj( const char *fn, GGMeshData &data );
-
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 Scene::Scene():
     mIsLoaded( false ),
     mLastTime( 0.0f ),
     mCamMoveDir( 0.0f, 0.0f, 0.0f ),
-    mSunOffset( 0.0f )
+    mSunOffset( 0.0f ),
+    mGatherBVHInput( false )
 {
-    // load scene
+    // load scene, objects are saved as they are loaded if needed
     Settings &settings = Settings::Get( );
-    bool sceneLoaded = LoadSceneFromBin( settings.mSceneFn );
+    if ( settings.mSaveScene )
+        mSaveSceneFn = settings.mSaveSceneFn;
+
+    bool sceneLoaded = LoadSceneFromBin( settings.mSceneFn.c_str( ) );
     ASSERT( sceneLoaded );
 
-    // save if needed
-    if ( sceneLoaded && settings.mSaveScene && settings.mSaveSceneFn )
-        SaveSceneToBin( settings.mSaveSceneFn );
+    if ( sceneLoaded && settings.mBuildSceneBVH && mSceneBVH.IsEmpty( ) )
+        BuildSceneBVH( );
+    mBVHInput.Clear( );
+
+    if ( sceneLoaded )
+        FinishSceneSave( );
+    LOG_INFO( "Scene: ", mSceneGeometries.size( ), " objects, peak RSS ", GetPeakRSS( ) >> 20, "MB" );
 
     // set camera
     mMainCamera.SetPosition( settings.mInitCamPos[0], settings.mInitCamPos[1], settings.mInitCamPos[2] );
@@ -64,7 +74,13 @@ void Scene::Update()
     mLastTime = timer.GetLiveTime( );
 
     UpdateSun( dt );
-    renderer.PushLigthToRender( mSun );
+    renderer.PushLigthToRender( mSun ); // sun goes first, only it has scene shadow maps
+
+    UpdateLocalLights( );
+    for each ( auto &light in mLocalLights )
+    {
+        renderer.PushLigthToRender( light );
+    }
 
     // update camera
     mMainCamera.ChangePosition( mCamMoveDir.x * offset, mCamMoveDir.y * offset, mCamMoveDir.z * offset );
@@ -89,67 +105,43 @@ bool Scene::LoadScene( const char *objFileName )
     return false;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void Scene::SaveSceneToBin( const char *fn )
+void Scene::SaveObject( const std::string &name, const std::string &matName, const SceneVertex *vertices, size_t vertexCount,
+    const uint32_t *indices, size_t indexCount )
 {
-    // open ofstream
-    std::ofstream binFile;
-    binFile.open( fn, std::ofstream::binary );
-    if ( binFile.fail( ) )
+    if ( mSaveSceneFn.empty( ) )
+        return;
+
+    // material libs go first in the file, they are all known before the first object
+    if ( !mSceneSaver.IsOpen( ) && !mSceneSaver.Open( mSaveSceneFn.c_str( ), mUsedMatLibs ) )
     {
         ASSERT( false );
-        LOG_ERROR( "Error during opening file: ", fn );
+        LOG_ERROR( "Error during opening file: ", mSaveSceneFn );
+        mSaveSceneFn.clear( );
         return;
     }
 
-    auto writeSize = [&]( size_t size )
-    {
-        binFile.write( ( char* )( &size ), sizeof( size_t ) );
-    };
-
-    auto writeString = [&]( const std::string &str )
-    {
-        size_t len = str.length( );
-        writeSize( len );
-        binFile.write( str.c_str( ), len );
-    };
-
-    // save mUsedMaterials
-    size_t mSize = mUsedMatLibs.size( );
-    writeSize( mSize );
-    for ( size_t i = 0; i < mUsedMatLibs.size( ); i++ )
-        writeString( mUsedMatLibs[i] );
-
-    D3DRenderer &renderer = D3DRenderer::Get( );
-
-    //  save mSceneGeometries
-    size_t oSize = mSceneGeometries.size( );
-    writeSize( oSize );
-    for ( size_t i = 0; i < oSize; i++ )
-    {
-        SceneGeometry &sg = mSceneGeometries[i];
-
-        // save name
-        writeString( sg.mName );
-
-        // save matName
-        writeString( sg.mMaterial->mName );
-
-        auto &gb = sg.mGeometryBuffer;
+    bool written = mSceneSaver.WriteObject( name, matName, vertices, vertexCount, indices, indexCount );
+    ASSERT( written, "Can't write ", name, " to ", mSaveSceneFn );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Scene::LogMeshOptimization( const MeshOptimizeResult &result )
+{
+    LOG_INFO( "Mesh optimization: ", result.mAfter.mTriangles, " triangles, ACMR ", result.mBefore.GetACMR( ), " -> ", result.mAfter.GetACMR( ),
+        " ATVR ", result.mBefore.GetATVR( ), " -> ", result.mAfter.GetATVR( ), " (fifo ", MESH_CACHE_SIZE, ")" );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Scene::FinishSceneSave( )
+{
+    if ( !mSceneSaver.IsOpen( ) )
+        return;
 
-        // save vtxs
-        auto &rawVB = gb->GetRawVB();
-        size_t vCount = rawVB.size( );
-        writeSize( vCount );
-        binFile.write( ( char* )( &rawVB[0] ), vCount * sizeof( Vertex3F3F3F2F ) );
+    // optional trailer, older loaders stop reading before it
+    if ( !mSceneBVH.IsEmpty( ) )
+        mSceneBVH.Save( mSceneSaver.GetStream( ) );
 
-        // save inds
-        auto &rawIB = gb->GetRawIB();
-        size_t iCount = rawIB.size( );
-        writeSize( iCount );
-        binFile.write( ( char* )( &rawIB[0] ), iCount * sizeof( uint32_t ) );
-    }
-
-    binFile.close( );
+    if ( !mSceneSaver.Close( ) )
+        LOG_ERROR( "Can't save scene to ", mSaveSceneFn );
+    mSaveSceneFn.clear( );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Scene::CleanUp()
@@ -161,83 +153,167 @@ void Scene::CleanUp()
     mSceneGeometries.clear( );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const BVH& Scene::GetSceneBVH( ) const
+{
+    return mSceneBVH;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Scene::BuildSceneBVH( )
+{
+    // streaming kept only the checksum, the bin is read once more
+    if ( !mGatherBVHInput )
+    {
+        std::string error;
+        if ( !ReadBVHInput( Settings::Get( ).mSceneFn.c_str( ), mBVHInput, error ) || mBVHInput.GetChecksum( ) != mBVHChecksum.Get( ) )
+        {
+            LOG_ERROR( "Can't read scene BVH input: ", error.empty( ) ? "scene file changed while loading" : error );
+            mBVHInput.Clear( );
+            return;
+        }
+    }
+
+    if ( !mSceneBVH.Build( mBVHInput ) )
+    {
+        LOG_ERROR( "Can't build scene BVH" );
+        return;
+    }
+
+    const BVHStats &stats = mSceneBVH.GetStats( );
+    LOG_INFO( "Scene BVH: ", stats.mTriangles, " triangles, ", stats.mNodes, " nodes, ", stats.mLeaves, " leaves, depth ",
+        stats.mMaxDepth, ", build ", stats.mBuildTime * 1000.0, "ms" );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Scene::RunBVHBenchmark( )
+{
+    if ( mSceneBVH.IsEmpty( ) )
+    {
+        LOG_ERROR( "Scene BVH is empty, enable Settings::mBuildSceneBVH" );
+        return;
+    }
+
+    // rebuild from scratch to measure build time even if bvh came from the cache
+    // no cpu copy of the geometry is kept, so it's streamed from the scene file again
+    BVHBuildInput input;
+    std::string error;
+    if ( ReadBVHInput( Settings::Get( ).mSceneFn.c_str( ), input, error ) && input.GetTriangleCount( ) > 0 )
+    {
+        BVH bvh;
+        bvh.Build( input );
+        LOG_INFO( "BVH benchmark: build ", bvh.GetStats( ).mBuildTime * 1000.0, "ms for ", bvh.GetStats( ).mTriangles, " triangles" );
+    }
+    else
+    {
+        LOG_INFO( "BVH benchmark: can't read scene geometry (", error, "), build time is in the load log" );
+    }
+
+    size_t hits = 0;
+    const size_t rays = 1000000;
+    double raysPerSecond = mSceneBVH.RunRayBenchmark( rays, hits );
+    LOG_INFO( "BVH benchmark: ", raysPerSecond * 1e-6, " Mrays/s, ", hits, " hits of ", rays, " rays" );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Scene::ReadBVHInput( const char *fn, BVHBuildInput &input, std::string &error ) const
+{
+    SceneBinReader reader;
+    SceneBinObject object;
+    uint32_t objectID = 0;
+    if ( !reader.Open( fn, error ) )
+        return false;
+
+    while ( reader.ReadObject( object, error ) )
+    {
+        if ( object.mVertices.empty( ) || object.mIndices.empty( ) )
+            continue;
+
+        input.AddMesh( object.mVertices[0].mPosition, sizeof( SceneVertex ), object.mVertices.size( ),
+            object.mIndices.data( ), object.mIndices.size( ), objectID++ );
+    }
+    return error.empty( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool Scene::LoadSceneFromBin( const char *fn )
 {
-    // open ifstream
-    std::ifstream binFile;
-    binFile.open( fn, std::ifstream::binary );
-    if ( binFile.fail( ) )
+    SceneBinReader reader;
+    std::string error;
+    if ( !reader.Open( fn, error ) )
     {
         ASSERT( false );
-        LOG_ERROR( "Error during opening file: ", fn );
+        LOG_ERROR( "Error during opening file: ", fn, " ", error );
         return false;
     }
 
-    auto readSize = [&]( size_t &size )
-    {
-        binFile.read( ( char* )( &size ), sizeof( size_t ) );
-    };
+    // LoadMTL remembers used material libs
+    for each ( auto &matLibPath in reader.GetMaterialLibs( ) )
+        LoadMTL( matLibPath.c_str( ) );
 
-    auto readString = [&]( std::string &str )
+    // bins keep import order, they are optimized again only when saved
+    bool optimize = Settings::Get( ).mOptimizeMeshes && !mSaveSceneFn.empty( );
+    MeshOptimizeResult optimization;
+    std::mutex optimizationLock;
+
+    // optimized objects can't match the bvh cached in the bin, so only then their positions are kept for the build
+    mGatherBVHInput = optimize;
+
+    // objects are read one after another on workers, optimized in parallel and handed to gpu in file order here,
+    // a few objects per thread are in memory at a time and their buffers are reused
+    struct BinLoadItem
     {
-        const size_t bufSize = 256;
-        size_t len;
-        readSize( len );
-        ASSERT( len < bufSize );
-        if ( len >= bufSize )
-            len = bufSize - 1;
-
-        if ( len )
-        {
-            static char tmpStr[bufSize];
-            binFile.read( tmpStr, len );
-            tmpStr[len] = '\0';
-            str = tmpStr;
-        }
+        SceneBinObject mObject;
+        bool mRead;
     };
+    TaskScheduler &scheduler = TaskScheduler::Get( );
+    TaskPipeline<BinLoadItem> pipeline( scheduler, scheduler.GetThreadCount( ) * 2,
+        [&]( BinLoadItem &item )
+        {
+            // after an error the rest is skipped, error is read only after the pipeline is flushed
+            item.mRead = error.empty( ) && reader.ReadObject( item.mObject, error );
+        },
+        [&]( BinLoadItem &item )
+        {
+            if ( !item.mRead || !optimize )
+                return;
+
+            MeshOptimizeResult result = OptimizeMesh( item.mObject.mVertices, item.mObject.mIndices );
+            std::lock_guard<std::mutex> lock( optimizationLock );
+            optimization.mBefore.Add( result.mBefore );
+            optimization.mAfter.Add( result.mAfter );
+        },
+        [&]( BinLoadItem &item )
+        {
+            if ( !item.mRead )
+                return;
 
-    // load mUsedMaterials
-    size_t mSize = 0;
-    readSize( mSize );
-    for ( size_t i = 0; i < mSize; i++ )
-    {
-        std::string matLibPath;
-        readString( matLibPath );
-        mUsedMatLibs.push_back( matLibPath );
+            SceneBinObject &object = item.mObject;
+            size_t vCount = object.mVertices.size( ), iCount = object.mIndices.size( );
+            ASSERT( iCount > 0 && vCount > 0 );
+            if ( iCount > 0 && vCount > 0 )
+                CreateNewObject( object.mName, object.mMaterial, object.mVertices.data( ), vCount, object.mIndices.data( ), iCount );
+        } );
 
-        LoadMTL( matLibPath.c_str( ) );
+    for ( size_t i = 0; i < reader.GetObjectCount( ); i++ )
+        pipeline.Push( pipeline.Acquire( ) );
+    pipeline.Flush( );
+
+    if ( !error.empty( ) )
+    {
+        ASSERT( false );
+        LOG_ERROR( "Error during reading file: ", fn, " ", error );
+        return false;
     }
 
-    D3DRenderer &renderer = D3DRenderer::Get( );
+    if ( optimize )
+        LogMeshOptimization( optimization );
 
-    //  load mSceneGeometries
-    size_t oSize = 0;
-    binFile.read( ( char* )( &oSize ), sizeof( size_t ) );
-    for ( size_t i = 0; i < oSize; i++ )
+    // bvh trailer is optional, it's rebuilt if missing or doesn't match the geometry
+    if ( Settings::Get( ).mBuildSceneBVH && mSceneBVH.Load( reader.GetStream( ) ) )
     {
-        std::string name, matName;
-        readString( name );
-        readString( matName );
-
-        // load vtxs
-        size_t vCount = 0;
-        readSize( vCount );
-        std::vector<Vertex3F3F3F2F> vBuf( vCount );
-        binFile.read( ( char* )( &vBuf[0] ), vCount * sizeof( Vertex3F3F3F2F ) );
-
-        // load inds
-        size_t iCount = 0;
-        readSize( iCount );
-        std::vector<uint32_t> iBuf( iCount );
-        binFile.read( ( char* )( &iBuf[0] ), iCount * sizeof( uint32_t ) );
-
-        ASSERT( iCount > 0 && vCount > 0 );
-        if ( iCount > 0 && vCount > 0 ) // && i > 0x100 && i < 0x150 )
-            CreateNewObject( name, matName, vBuf, iBuf );
+        if ( mSceneBVH.GetStats( ).mTriangles == mBVHChecksum.GetTriangleCount( ) &&
+            mSceneBVH.GetChecksum( ) == mBVHChecksum.Get( ) )
+            LOG_INFO( "Scene BVH loaded from ", fn, ": ", mSceneBVH.GetStats( ).mNodes, " nodes" );
+        else
+            mSceneBVH.Clear( );
     }
 
-    binFile.close( );
-
     return true;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -354,243 +430,112 @@ bool Scene::LoadMTL( const char *fn )
     return true;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// simple obj reader
-// load scene
-// read obj file
-//  read mtllib X - load X lib
-//  read object X - X is a name of object (can be null)
-//      read geometry data till the next object
-//          usemtl - store material
-//          
-//      before parsing next object - store current data to scene object
-//  if there is no objects - end
 bool Scene::ParseObjFile( const char *fn )
 {
-    std::ifstream objFile;
-    objFile.open( fn, std::ifstream::in );
-    if ( objFile.fail( ) )
+    // parsing is portable, every finished mesh goes to gpu right away
+    D3DRenderer &renderer = D3DRenderer::Get( );
+    ObjCallbacks callbacks;
+    callbacks.mOnMaterialLib = [&]( const std::string &mtlfn )
+    {
+        bool success = LoadMTL( mtlfn.c_str( ) );
+        ASSERT( success );
+    };
+    // meshes are built and optimized on workers, gpu buffers, bvh input and saving stay on this thread in file order
+    // obj files have no cached bvh, positions are always kept for the build
+    bool optimize = Settings::Get( ).mOptimizeMeshes;
+    mGatherBVHInput = true;
+    MeshOptimizeResult optimization;
+    std::mutex optimizationLock;
+    callbacks.mScheduler = &TaskScheduler::Get( );
+    callbacks.mProcessMesh = [&]( ObjMesh &mesh )
+    {
+        if ( !optimize )
+            return;
+
+        MeshOptimizeResult result = OptimizeMesh( mesh.mData.verticies, mesh.mData.indicies );
+        std::lock_guard<std::mutex> lock( optimizationLock );
+        optimization.mBefore.Add( result.mBefore );
+        optimization.mAfter.Add( result.mAfter );
+    };
+    callbacks.mOnMesh = [&]( ObjMesh &mesh )
+    {
+        CreateNewObject( mesh.mName, mesh.mData, mesh.mMaterial.empty( ) ? renderer.GetDefaultMaterial( ) : FindMaterial( mesh.mMaterial ) );
+    };
+
+    bool parsed = LoadObj( fn, callbacks );
+    if ( parsed )
+        FinishSceneSave( );
+    if ( parsed && optimize )
+        LogMeshOptimization( optimization );
+    if ( !parsed )
     {
         ASSERT( false );
         LOG_ERROR( "Error during opening file: ", fn );
         return false;
     }
 
-    // load scene
-    std::vector<DirectX::XMFLOAT3> positions;
-    std::vector<DirectX::XMFLOAT3> normals;
-    std::vector<DirectX::XMFLOAT3> uvw;
-    std::vector<std::array<int, 9> > faceInfo;
-
-    std::string path, tmpstr;
-    SplitFilename( std::string( fn ), path, tmpstr );
-
-    char tmp;
-    std::string line;
-    std::string objName = "";
-    GGMeshData geometryData;
-    bool firstObj = true;
-    D3DRenderer &renderer = D3DRenderer::Get( );
-    std::shared_ptr<Material> curMat = renderer.GetDefaultMaterial( );
-    int subObjCount = 0;
-    std::string suffix = "0";
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Scene::CreateNewObject( const std::string &name, const GGMeshData &data, const std::shared_ptr<Material> &mat )
+{
+    auto &geometryBuffer = D3DGeometryBuffer::Create( data, D3DRenderer::Get( ).GetSceneVertexFormat( ) );
+    mGeometryBuffers.push_back( geometryBuffer );
 
-    while ( !objFile.eof( ) ) // && mSceneGeometries.size( ) < 10 )
+    if ( Settings::Get( ).mBuildSceneBVH && !data.verticies.empty( ) )
     {
-        std::getline( objFile, line );
-        std::istringstream iss( line.c_str( ) );
-
-        // new name is an indicator of the next object (the lack of name is possible)
-        size_t objfound = line.find( "object" );
-        if ( objfound != std::string::npos )
+        uint32_t object = static_cast< uint32_t >( mSceneGeometries.size( ) );
+        mBVHChecksum.AddMesh( &data.verticies[0].position, sizeof( GGVertex ), data.verticies.size( ),
+            data.indicies.data( ), data.indicies.size( ), object );
+        if ( mGatherBVHInput )
         {
-            if ( !firstObj && CreateGeometryFromObj( positions, normals, uvw, faceInfo, geometryData ) )
-            {
-                CreateNewObject( objName + suffix, geometryData, curMat );
-                faceInfo.clear( );
-                subObjCount = 0;
-                suffix = "0";
-            }
-            else
-            {
-                firstObj = false;
-            }
-
-            // start new object
-            size_t cutlen = objfound + strlen( "object " );
-            int nameLength = line.length( ) - cutlen;
-            if ( nameLength > 0 )
-                objName = line.substr( cutlen ); // , nameLength 
-            else
-                objName = "";
-
-            curMat = renderer.GetDefaultMaterial( );
-        }
-        else if ( !line.compare( 0, 6, "mtllib" ) )
-        {
-            size_t cutlen = strlen( "mtllib " );
-            int nameLength = line.length( ) - cutlen;
-            std::string mtlfn = path + line.substr( cutlen );
-            bool success = LoadMTL( mtlfn.c_str( ) );
-            ASSERT( success );
-            // load material lib
-            // concat obj path and current path
-        }
-        else if ( !line.compare( 0, 7, "usemtl " ) )
-        {
-            if ( faceInfo.size( ) != 0 )
-            {
-                if ( CreateGeometryFromObj( positions, normals, uvw, faceInfo, geometryData ) )
-                {
-                    CreateNewObject( objName + suffix, geometryData, curMat );
-                    faceInfo.clear( );
-                }
-                suffix = std::to_string( subObjCount++ );
-            }
-
-            std::string matName = line.substr( strlen( "usemtl " ) );
-            curMat = FindMaterial( matName );
-        }
-        else if ( !line.compare( 0, 2, "v " ) )
-        {
-            iss >> tmp;
-            float v[3];
-            for ( int i = 0; i < 3; i++ )
-                iss >> v[i];
-
-            positions.push_back( DirectX::XMFLOAT3( v[0], v[1], v[2] ) );
-        }
-        else if ( !line.compare( 0, 3, "vt " ) )
-        {
-            iss >> tmp >> tmp;
-            float vt[3];
-            for ( int i = 0; i < 3; i++ )
-                iss >> vt[i];
-
-            uvw.push_back( DirectX::XMFLOAT3( vt[0], 1.0f - vt[1], vt[2] ) ); // v coordinate is inverted
+            mBVHInput.AddMesh( &data.verticies[0].position, sizeof( GGVertex ), data.verticies.size( ),
+                data.indicies.data( ), data.indicies.size( ), object );
         }
-        else if ( !line.compare( 0, 3, "vn " ) )
-        {
-            iss >> tmp >> tmp;
-            float vn[3];
-            for ( int i = 0; i < 3; i++ )
-                iss >> vn[i];
+    }
 
-            normals.push_back( DirectX::XMFLOAT3( vn[0], vn[1], vn[2] ) );
-        }
-        else if ( !line.compare( 0, 2, "f " ) )
+    if ( !mSaveSceneFn.empty( ) )
+    {
+        std::vector<SceneVertex> vertices( data.verticies.size( ) );
+        for ( size_t i = 0; i < vertices.size( ); i++ )
         {
-            std::vector<std::array<int, 3> > vertices; // position, normal, texture
-            int idv, idn, idt;
-            iss >> tmp;
-            while ( iss >> idv >> tmp >> idt >> tmp >> idn )
-            {
-                std::array<int, 3> vertex = { idv - 1, idt - 1, idn - 1 };
-                vertices.push_back( vertex );
-            }
-            ASSERT( vertices.size( ) >= 3 );
-            if ( vertices.size( ) < 3 )
-                break;
-
-            for ( size_t i = 2; i < vertices.size( ); i++ )
-            {
-                // assume more than 3 verticies connected to first vertex
-                std::array<int, 9> face;
-                for ( size_t j = 0; j < 3; j++ )
-                    face[j] = vertices[0][j];
-
-                for ( size_t j = i - 1; j <= i; j++ )
-                {
-                    for ( int k = 0; k < 3; k++ )
-                        face[( 2 - ( i - j ) ) * 3 + k] = vertices[j][k];
-                }
-
-                faceInfo.push_back( face );
-            }
+            const GGVertex &ggv = data.verticies[i];
+            SceneVertex &v = vertices[i];
+            v.mPosition[0] = ggv.position.x; v.mPosition[1] = ggv.position.y; v.mPosition[2] = ggv.position.z;
+            v.mNormal[0] = ggv.normal.x; v.mNormal[1] = ggv.normal.y; v.mNormal[2] = ggv.normal.z;
+            v.mBinormal[0] = ggv.binormal.x; v.mBinormal[1] = ggv.binormal.y; v.mBinormal[2] = ggv.binormal.z;
+            v.mUV[0] = ggv.UVW.x; v.mUV[1] = ggv.UVW.y;
         }
+        SaveObject( name, mat->mName, vertices.data( ), vertices.size( ), data.indicies.data( ), data.indicies.size( ) );
     }
 
-    // TODO clear comment - last element issue ????
-    if ( CreateGeometryFromObj( positions, normals, uvw, faceInfo, geometryData ) )
-        CreateNewObject( objName + suffix, geometryData, curMat );
-
-    return true;
-}
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void Scene::CreateNewObject( const std::string &name, const GGMeshData &data, const std::shared_ptr<Material> &mat )
-{
-    auto &geometryBuffer = D3DGeometryBuffer::Create( data );
-    mGeometryBuffers.push_back( geometryBuffer );
-
     SceneGeometry sceneGeometry( name, geometryBuffer, mat );
     mSceneGeometries.push_back( sceneGeometry );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void Scene::CreateNewObject( const std::string &name, const std::string &matName,
-    const std::vector<Vertex3F3F3F2F> &vBuf, const std::vector<uint32_t> &iBuf )
+void Scene::CreateNewObject( const std::string &name, const std::string &matName, const SceneVertex *vertices, size_t vertexCount,
+    const uint32_t *indices, size_t indexCount )
 {
-    auto &geometryBuffer = D3DGeometryBuffer::Create( vBuf, iBuf );
+    static_assert( sizeof( SceneVertex ) == sizeof( Vertex3F3F3F2F ), "scene bin vertex must match geometry buffer vertex" );
+    auto &geometryBuffer = D3DGeometryBuffer::Create( reinterpret_cast< const Vertex3F3F3F2F* >( vertices ), vertexCount, indices, indexCount,
+        D3DRenderer::Get( ).GetSceneVertexFormat( ) );
     mGeometryBuffers.push_back( geometryBuffer );
 
+    if ( Settings::Get( ).mBuildSceneBVH && vertexCount > 0 )
+    {
+        uint32_t object = static_cast< uint32_t >( mSceneGeometries.size( ) );
+        mBVHChecksum.AddMesh( vertices[0].mPosition, sizeof( SceneVertex ), vertexCount, indices, indexCount, object );
+        if ( mGatherBVHInput )
+            mBVHInput.AddMesh( vertices[0].mPosition, sizeof( SceneVertex ), vertexCount, indices, indexCount, object );
+    }
+
     std::shared_ptr<Material> mat = FindMaterial( matName );
+    SaveObject( name, mat->mName, vertices, vertexCount, indices, indexCount );
 
     SceneGeometry sceneGeometry( name, geometryBuffer, mat );
     mSceneGeometries.push_back( sceneGeometry );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool Scene::CreateGeometryFromObj( const std::vector<DirectX::XMFLOAT3> &positions,
-    const std::vector<DirectX::XMFLOAT3> &normals,
-    const std::vector<DirectX::XMFLOAT3> &uvw,
-    const std::vector<std::array<int, 9> > &faceInfo,
-    GGMeshData &data )
-{
-    if ( faceInfo.size( ) == 0 || positions.size() == 0 || normals.size() == 0 || uvw.size() == 0 )
-        return false;
-
-    data.verticies.clear( );
-    data.indicies.clear( );
-
-    const int lengthLimit = 1 << 21;
-    ASSERT( positions.size( ) < lengthLimit && normals.size( ) < lengthLimit && uvw.size( ) < lengthLimit );
-
-    // build layout, prevent duplicates
-    std::vector<std::vector<std::pair<int, int> > > vertexCoherence;
-    std::unordered_map<__int64, int> indiciesHash;
-    int maxIndex = 0;
-    for each ( auto f in faceInfo )
-    {
-        int iv[3];
-        for ( int i = 0; i < 3; i++ )
-        {
-            int vp = f[0 + i * 3], vt = f[1 + i * 3], vn = f[2 + i * 3];
-            __int64 key = ( __int64 )vp + ( ( ( __int64 )vt ) << 21 ) + ( ( ( __int64 )vn ) << 42 );
-            auto keyValue = indiciesHash.find( key );
-            if ( keyValue != indiciesHash.end( ) )
-            {
-                data.indicies.push_back( keyValue->second );
-            }
-            else
-            {
-                // push new vertex
-                GGVertex v;
-                v.position = positions[vp];
-                v.UVW = uvw[vt];
-                v.normal = normals[vn];
-                data.verticies.push_back( v );
-                indiciesHash.insert( std::make_pair( key, maxIndex ) );
-                data.indicies.push_back( maxIndex++ );
-                vertexCoherence.push_back( std::vector<std::pair<int, int> >( ) );
-            }
-            iv[i] = data.indicies.back();
-        }
-        vertexCoherence[iv[0]].push_back( std::make_pair( iv[1], iv[2] ) );
-        vertexCoherence[iv[1]].push_back( std::make_pair( iv[0], iv[2] ) );
-        vertexCoherence[iv[2]].push_back( std::make_pair( iv[0], iv[1] ) );
-    }
-    GeometryGenerator::CalculateTBN( data, vertexCoherence );
-
-    return true;
-}
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Scene::AddMaterial( const Material &material )
 {
     D3DRenderer &renderer = D3DRenderer::Get( );
@@ -646,6 +591,34 @@ void Scene::LoadMaterialTextureFromFile( const std::string &line, const std::str
     }
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+CameraKey Scene::GetCameraKey( ) const
+{
+    Settings &settings = Settings::Get( );
+    const DirectX::XMFLOAT4 &pos = mMainCamera.GetPosition( );
+
+    CameraKey key;
+    key.mPosition[0] = pos.x;
+    key.mPosition[1] = pos.y;
+    key.mPosition[2] = pos.z;
+    key.mTheta = mMainCamera.GetTheta( );
+    key.mPhi = mMainCamera.GetPhi( );
+    key.mSunYaw = settings.mSunYaw + mSunOffset;
+    key.mSunPitch = settings.mSunPitch;
+    return key;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Scene::SetCameraKey( const CameraKey &key )
+{
+    // sun animation offset is folded into yaw
+    Settings &settings = Settings::Get( );
+    settings.mSunYaw = key.mSunYaw;
+    settings.mSunPitch = key.mSunPitch;
+    mSunOffset = 0.0f;
+
+    mMainCamera.SetPosition( key.mPosition[0], key.mPosition[1], key.mPosition[2] );
+    mMainCamera.SetDegrees( key.mTheta, key.mPhi );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Scene::UpdateSun( float dt )
 {
     Settings &settings = Settings::Get( );
@@ -687,6 +660,42 @@ void Scene::UpdateSun( float dt )
     mSun.direction = DirectX::XMFLOAT3( -x, -y, -z );
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Scene::UpdateLocalLights( )
+{
+    // ring of alternating point and spot lights, spots look down
+    Settings &settings = Settings::Get( );
+    int count = settings.mLocalLightCount > 0 ? settings.mLocalLightCount : 0;
+
+    D3DRenderer &renderer = D3DRenderer::Get( );
+    auto sceneBB = renderer.GetStaticSceneBB( );
+    DirectX::XMVECTOR bbMin = DirectX::XMLoadFloat3( &sceneBB.first );
+    DirectX::XMVECTOR bbMax = DirectX::XMLoadFloat3( &sceneBB.second );
+    DirectX::XMFLOAT3 center, extent;
+    DirectX::XMStoreFloat3( &center, DirectX::XMVectorScale( DirectX::XMVectorAdd( bbMin, bbMax ), 0.5f ) );
+    DirectX::XMStoreFloat3( &extent, DirectX::XMVectorSubtract( bbMax, bbMin ) );
+    float diagonal = DirectX::XMVectorGetX( DirectX::XMVector3Length( DirectX::XMVectorSubtract( bbMax, bbMin ) ) );
+
+    // rebuild only on change, moving lights would make them reinjected every frame
+    if ( mLocalLights.size( ) == static_cast< size_t >( count ) && ( count == 0 || mLocalLights[0].radius == diagonal * 0.35f ) )
+        return;
+
+    const DirectX::XMFLOAT3 colors[] = { DirectX::XMFLOAT3( 1.0f, 0.75f, 0.45f ), DirectX::XMFLOAT3( 0.45f, 0.65f, 1.0f ) };
+
+    mLocalLights.resize( count );
+    for ( int i = 0; i < count; i++ )
+    {
+        LightSource &light = mLocalLights[i];
+        float angle = PI * 2.0f * i / count;
+        light.type = ( i % 2 == 0 ) ? LightSource::POINT : LightSource::SPOT;
+        light.position = DirectX::XMFLOAT3( center.x + cosf( angle ) * extent.x * 0.3f, sceneBB.first.y + extent.y / 3.0f,
+            center.z + sinf( angle ) * extent.z * 0.3f );
+        light.direction = DirectX::XMFLOAT3( 0.0f, -1.0f, 0.0f );
+        light.color = colors[i % 2];
+        light.radius = diagonal * 0.35f;
+        light.spotAngle = 0.6f;
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Scene::UpdateCamDirection()
 {
     float dx = 0.0f, dy = 0.0f, dz = 0.0f;
@@ -732,111 +741,3 @@ void Scene::UpdateCamDirection()
     }
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// TODO - remove, it works with perfect cases with v/vt/vn
-void LoadSingleObj( const char *fn, GGMeshData &data )
-{
-    data.verticies.clear( );
-    data.indicies.clear( );
-
-    std::ifstream objFile;
-    objFile.open( fn, std::ifstream::in );
-    if ( objFile.fail( ) )
-    {
-        ASSERT( false );
-        LOG_ERROR( "Error during opening file: ", fn );
-        return;
-    }
-
-    std::vector<DirectX::XMFLOAT3> positions;
-    std::vector<DirectX::XMFLOAT3> normals;
-    std::vector<DirectX::XMFLOAT3> uvw;
-    std::vector<std::array<int, 9> > faceInfo;
-
-    std::string line;
-    while ( !objFile.eof( ) ) {
-        std::getline( objFile, line );
-        std::istringstream iss( line.c_str( ) );
-
-        char tmp;
-        if ( !line.compare( 0, 2, "v " ) ) {
-            iss >> tmp;
-            float v[3];
-            for ( int i = 0; i < 3; i++ )
-                iss >> v[i];
-
-            positions.push_back( DirectX::XMFLOAT3( v[0], v[1], v[2] ) );
-        }
-        else if ( !line.compare( 0, 3, "vt " ) ) {
-            iss >> tmp >> tmp;
-            float vt[3];
-            for ( int i = 0; i < 3; i++ )
-                iss >> vt[i];
-
-            uvw.push_back( DirectX::XMFLOAT3( 1.0f - vt[0], vt[1], vt[2] ) );
-            //uvw.push_back( DirectX::XMFLOAT3( vt[0], vt[1], vt[2] ) );
-        }
-        else if ( !line.compare( 0, 3, "vn " ) ) {
-            iss >> tmp >> tmp;
-            float vn[3];
-            for ( int i = 0; i < 3; i++ )
-                iss >> vn[i];
-
-            normals.push_back( DirectX::XMFLOAT3( vn[0], vn[1], vn[2] ) );
-        }
-        else if ( !line.compare( 0, 2, "f " ) ) {
-            std::array<int, 9> face; // position, normal, texture
-            int idv, idn, idt, i = 0;
-            iss >> tmp;
-            while ( iss >> idv >> tmp >> idt >> tmp >> idn ) {
-                idv--; // in wavefront obj all indices start at 1, not zero
-                face[0 + i * 3] = idv;
-                idt--;
-                face[1 + i * 3] = idt;
-                idn--;
-                face[2 + i * 3] = idn;
-                i++;
-            }
-            faceInfo.push_back( face );
-        }
-    }
-
-    size_t lengthLimit = 1 << 21;
-    ASSERT( positions.size( ) < lengthLimit && normals.size( ) < lengthLimit && uvw.size( ) < lengthLimit );
-
-    // build layout, prevent duplicates
-    std::vector<std::vector<std::pair<int, int> > > vertexCoherence;
-    std::unordered_map<__int64, int> indiciesHash;
-    int maxIndex = 0;
-    for each ( auto f in faceInfo )
-    {
-        int iv[3];
-        for ( int i = 0; i < 3; i++ )
-        {
-            int vp = f[0 + i * 3], vt = f[1 + i * 3], vn = f[2 + i * 3];
-            __int64 key = ( __int64 )vp + ( ( ( __int64 )vt ) << 21 ) + ( ( ( __int64 )vn ) << 42 );
-            auto keyValue = indiciesHash.find( key );
-            if ( keyValue != indiciesHash.end( ) )
-            {
-                data.indicies.push_back( keyValue->second );
-            }
-            else
-            {
-                // push new vertex
-                GGVertex v;
-                v.position = positions[vp];
-                v.UVW = DirectX::XMFLOAT3( 1.0f - uvw[vt].x, 1.0f - uvw[vt].y, uvw[vt].z );
-                v.normal = normals[vn];
-                data.verticies.push_back( v );
-                indiciesHash.insert( std::make_pair( key, maxIndex ) );
-                data.indicies.push_back( maxIndex++ );
-                vertexCoherence.push_back( std::vector<std::pair<int, int> >( ) );
-            }
-            iv[i] = data.indicies.back( );
-        }
-        vertexCoherence[iv[0]].push_back( std::make_pair( iv[1], iv[2] ) );
-        vertexCoherence[iv[1]].push_back( std::make_pair( iv[0], iv[2] ) );
-        vertexCoherence[iv[2]].push_back( std::make_pair( iv[0], iv[1] ) );
-    }
-    GeometryGenerator::CalculateTBN( data, vertexCoherence );
-}
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -10,6 +10,9 @@
 
 #include <Camera.h>
 #include <Light.h>
+#include <Core/BVH.h>
+#include <Core/CameraPath.h>
+#include <Core/SceneStream.h>
 
 namespace DirectX
 {
@@ -21,7 +24,7 @@ class D3DGeometryBuffer;
 struct Material;
 struct GGMeshData;
 struct SceneGeometry;
-struct Vertex3F3F3F2F;
+struct MeshOptimizeResult;
 
 // this should belong to engine class but we don't have that yet
 enum CamDirection
@@ -44,29 +47,44 @@ public:
     void Update();
     bool LoadScene( const char *objFileName );
     bool LoadSceneFromBin( const char *binFileName );
-    void SaveSceneToBin( const char *binFileName );
     void CleanUp();
 
+    const BVH& GetSceneBVH() const;
+    void RunBVHBenchmark();
+
     // this should belong to engine or camera class
     void ChangeCamRot( float dTheta, float dPhi );
     void SetCamDirection( CamDirection &dir );
     void ReleaseCamDirection( CamDirection &dir );
+
+    // camera and sun for path recording and replay
+    CameraKey GetCameraKey( ) const;
+    void SetCameraKey( const CameraKey &key );
 private:
 
     bool LoadMTL( const char *fn );
     bool ParseObjFile( const char *fn );
     void CreateNewObject( const std::string &name, const GGMeshData &data, const std::shared_ptr<Material> &mat );
-    void CreateNewObject( const std::string &name, const std::string &matName,
-        const std::vector<Vertex3F3F3F2F> &vBuf, const std::vector<uint32_t> &iBuf );
-    bool CreateGeometryFromObj( const std::vector<DirectX::XMFLOAT3> &positions, const std::vector<DirectX::XMFLOAT3> &normals,
-        const std::vector<DirectX::XMFLOAT3> &uvw, const std::vector<std::array<int, 9> > &faceInfo, GGMeshData &data );
+    void CreateNewObject( const std::string &name, const std::string &matName, const SceneVertex *vertices, size_t vertexCount,
+        const uint32_t *indices, size_t indexCount );
+
+    // Settings::mSaveScene: objects are written while they are loaded, no cpu copy of the scene is kept
+    void SaveObject( const std::string &name, const std::string &matName, const SceneVertex *vertices, size_t vertexCount,
+        const uint32_t *indices, size_t indexCount );
+    void FinishSceneSave( );
+    void LogMeshOptimization( const MeshOptimizeResult &result );
 
     void AddMaterial( const Material &material );
     std::shared_ptr<Material> FindMaterial( const std::string &matName );
     void LoadMaterialTextureFromFile( const std::string &line, const std::string &fPath, const char *signature,
         std::shared_ptr<D3DTextureBuffer2D> &textureSlot );
 
+    void BuildSceneBVH();
+    // positions of all objects of a scene bin, objects are numbered like CreateNewObject does
+    bool ReadBVHInput( const char *fn, BVHBuildInput &input, std::string &error ) const;
+
     void UpdateSun( float dt );
+    void UpdateLocalLights( );
     void UpdateCamDirection();
 
     bool mIsLoaded;
@@ -85,8 +103,19 @@ private:
     std::vector<SceneGeometry> mSceneGeometries; // possibly better to store smart pointers?
     std::vector<std::string> mUsedMatLibs;
 
+    std::string mSaveSceneFn; // empty if scene isn't saved
+    SceneBinWriter mSceneSaver;
+
+    // triangles of all scene objects for cpu ray queries. streaming keeps only a checksum to validate the bvh cached in
+    // the bin, positions are gathered while streaming only if the cache can't match, otherwise read again for a rebuild
+    BVH mSceneBVH;
+    BVHChecksum mBVHChecksum;
+    BVHBuildInput mBVHInput; // lives only during loading
+    bool mGatherBVHInput;
+
     LightSource mSun;
     float mSunOffset;
+    std::vector<LightSource> mLocalLights;
 };
 
 #endif
\ No newline at end of file
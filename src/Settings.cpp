@@ -1,4 +1,6 @@
 #include <Settings.h>
+#include <Core/ShadowCascades.h>
+#include <fstream>
 
 #define S_MIN_OCTREE_HEIGHT 2
 #define S_MAX_OCTREE_HEIGHT 9
@@ -15,17 +17,25 @@ Settings::Settings( )
 
     mRenderOutput = RO_COLOR;
     mShadowMapRes = 2048; // 4096 for quality picture
-    mShadowMapZNear = 1.0f;
-    mShadowMapZFar = 5000.0f;
+    mShadowCascades = 4; // camera fitted, whole scene map is used beyond them
+    mShadowCascadeLambda = 0.75f; // 0 - uniform splits, 1 - logarithmic
+    mShadowCascadeGuard = 0.2f; // extra cascade size, cascade is redrawn only when the camera leaves it
     mShadowBias = 3600;
+    mLocalLightShadowRes = 512; // point and spot reflective shadow maps, only used for photon injection
 
     mBlurRadius = 6.0f;
     mBlurSharpness = 100000.0f;
+    mBlurNormalSharpness = 16.0f;
 
     mDirectInfluence = 1.0f;
     mIndirectInfluence = 1.0f;
     mAOInfluence = 1.0f;
 
+    mGeometryPoolVertices = 1 << 20; // pool page size, bigger meshes get own page
+    mGeometryPoolIndices = 3 << 20;
+    mCompactVertices = true;
+    mFrustumCulling = true;
+
     // VCT settings
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     mVCTEnable = true;
@@ -48,7 +58,11 @@ Settings::Settings( )
     mVCTIndirectAmplification = 6.0f;
     mVCTStepCorrection = 0.76f;
     mVCTUseOpacityBuffer = true;
+    mVCTNeighborRopes = true;
+    mVCTEmptySpace = false; // few cone samples are in empty space, see Core/DistanceField.h
     mVCTConeTracingRes = 400; // 800 for quality picture
+    mMergeVoxels = true;
+    mLightInjectionBudget = 12; // point and spot shadow faces injected per frame, the rest waits for next frames
 
     mShowAO = false;
 
@@ -61,6 +75,7 @@ Settings::Settings( )
     mLightDistance = 1.0f;
     mSunColor[0] = 0.95f; mSunColor[1] = 0.97f; mSunColor[2] = 0.86f;
     mSunPower = 1.3f;
+    mLocalLightCount = 4; // demo ring of point and spot lights inside the scene
 
     mMouseSens = 0.005f;
     mInitCamPos[0] = 896; mInitCamPos[1] = 558; mInitCamPos[2] = 63;
@@ -71,6 +86,8 @@ Settings::Settings( )
     // Common settings
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     mFrameDeltaTime = 0.0166f; // 60 FPS cap
+    mFramePacingMode = FPM_AFTER_PRESENT;
+    mFrameSpinThreshold = 0.002f; // spin last 2ms of frame wait instead of sleeping
 
 #ifdef _DEBUG
     mShaderDir = "FXBin/Debug/";
@@ -78,8 +95,141 @@ Settings::Settings( )
     mShaderDir = "FXBin/Release/";
 #endif
     mMediaDir = "Media/";
+    mWorkerThreads = 0;
 
     mSceneFn = "Media/sponza/sponza.bin";
     mSaveSceneFn = "Media/sponza/sponza.bin";
     mSaveScene = false;
+    mOptimizeMeshes = true;
+    mBuildSceneBVH = true; // cpu ray queries over scene triangles, cached in the scene bin
+
+    BuildConfigSchema( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Settings::BuildConfigSchema( )
+{
+    // keys of settings.ini, ranges keep values inside what renderer can allocate
+    static const char *renderOutputNames[] = { "color", "indirect", "bricks", "voxels" };
+    static const char *debugBufferNames[] = { "opacity", "irradiance" };
+    static const char *pacingNames[] = { "after_present", "before_input" };
+    static_assert( sizeof( renderOutputNames ) / sizeof( renderOutputNames[0] ) == RO_COUNT, "Names size doesn't match RO_COUNT" );
+    static_assert( sizeof( debugBufferNames ) / sizeof( debugBufferNames[0] ) == DBUF_COUNT, "Names size doesn't match DBUF_COUNT" );
+    static_assert( sizeof( pacingNames ) / sizeof( pacingNames[0] ) == FPM_COUNT, "Names size doesn't match FPM_COUNT" );
+
+    ConfigSchema &cs = mConfigSchema;
+    cs.AddInt( "renderer.window_width", &mWndWidth, 64, 16384, SR_RESTART );
+    cs.AddInt( "renderer.window_height", &mWndHeight, 64, 16384, SR_RESTART );
+    cs.AddEnum( "renderer.render_output", reinterpret_cast< int* >( &mRenderOutput ), renderOutputNames, RO_COUNT );
+    cs.AddInt( "renderer.shadow_map_res", &mShadowMapRes, 64, 8192, SR_SHADOW_MAPS );
+    cs.AddInt( "renderer.shadow_cascades", &mShadowCascades, 1, MAX_SHADOW_CASCADES );
+    cs.AddFloat( "renderer.shadow_cascade_lambda", &mShadowCascadeLambda, 0.0f, 1.0f );
+    cs.AddFloat( "renderer.shadow_cascade_guard", &mShadowCascadeGuard, 0.0f, 4.0f );
+    cs.AddFloat( "renderer.shadow_bias", &mShadowBias, 0.0f, 100000.0f );
+    cs.AddInt( "renderer.local_light_shadow_res", &mLocalLightShadowRes, 64, 4096, SR_SHADOW_MAPS );
+    cs.AddFloat( "renderer.blur_radius", &mBlurRadius, 0.0f, 64.0f );
+    cs.AddFloat( "renderer.blur_sharpness", &mBlurSharpness, 0.0f, 1e9f );
+    cs.AddFloat( "renderer.blur_normal_sharpness", &mBlurNormalSharpness, 0.0f, 1e9f );
+    cs.AddFloat( "renderer.ao_influence", &mAOInfluence, 0.0f, 1.0f );
+    cs.AddFloat( "renderer.direct_influence", &mDirectInfluence, 0.0f, 1.0f );
+    cs.AddFloat( "renderer.indirect_influence", &mIndirectInfluence, 0.0f, 1.0f );
+    cs.AddInt( "renderer.geometry_pool_vertices", &mGeometryPoolVertices, 1024, 1 << 26, SR_RESTART );
+    cs.AddInt( "renderer.geometry_pool_indices", &mGeometryPoolIndices, 1024, 1 << 26, SR_RESTART );
+    cs.AddBool( "renderer.compact_vertices", &mCompactVertices, SR_RESTART );
+    cs.AddBool( "renderer.frustum_culling", &mFrustumCulling );
+
+    cs.AddBool( "vct.enable", &mVCTEnable );
+    cs.AddInt( "vct.octree_height", &mOctreeHeight, S_MIN_OCTREE_HEIGHT, S_MAX_OCTREE_HEIGHT, SR_VCT );
+    cs.AddInt( "vct.octree_buffer_res", &mOctreeBufferRes, 64, 16384, SR_VCT );
+    cs.AddInt( "vct.brick_buffer_res", &mBrickBufferRes, 3, 2048, SR_VCT );
+    cs.AddInt( "vct.cone_tracing_res", &mVCTConeTracingRes, 16, 4096, SR_VCT );
+    cs.AddFloat( "vct.lambda_falloff", &mVCTLambdaFalloff, 0.0f, 1.0f );
+    cs.AddFloat( "vct.local_cone_offset", &mVCTLocalConeOffset, 0.0f, 100.0f );
+    cs.AddFloat( "vct.world_cone_offset", &mVCTWorldConeOffset, 0.0f, 100.0f );
+    cs.AddFloat( "vct.indirect_amplification", &mVCTIndirectAmplification, 0.0f, 100.0f );
+    cs.AddFloat( "vct.step_correction", &mVCTStepCorrection, 0.001f, 10.0f );
+    cs.AddBool( "vct.use_opacity_buffer", &mVCTUseOpacityBuffer );
+    cs.AddBool( "vct.neighbor_ropes", &mVCTNeighborRopes );
+    cs.AddBool( "vct.empty_space", &mVCTEmptySpace );
+    cs.AddBool( "vct.merge_voxels", &mMergeVoxels, SR_VCT );
+    cs.AddInt( "vct.light_injection_budget", &mLightInjectionBudget, 1, 1024 );
+    cs.AddBool( "vct.show_ao", &mShowAO );
+    cs.AddEnum( "vct.debug_buffer", reinterpret_cast< int* >( &mVCTDebugBuffer ), debugBufferNames, DBUF_COUNT );
+
+    cs.AddFloat( "scene.sun_yaw", &mSunYaw, -100.0f, 100.0f );
+    cs.AddFloat( "scene.sun_pitch", &mSunPitch, 0.0f, 1.570f );
+    cs.AddFloat( "scene.light_distance", &mLightDistance, 0.0f, 100.0f );
+    cs.AddFloat3( "scene.sun_color", mSunColor );
+    cs.AddFloat( "scene.sun_power", &mSunPower, 0.0f, 1000.0f );
+    cs.AddInt( "scene.local_light_count", &mLocalLightCount, 0, 64 );
+    cs.AddBool( "scene.light_animation", &mLightAnimation );
+    cs.AddFloat( "scene.light_animation_speed", &mLightAnimationSpeed, -100.0f, 100.0f );
+    cs.AddFloat( "scene.mouse_sens", &mMouseSens, 0.0f, 1.0f );
+    cs.AddFloat3( "scene.camera_position", mInitCamPos, SR_RESTART );
+    cs.AddFloat( "scene.camera_phi", &mInitCamPhi, -100.0f, 100.0f, SR_RESTART );
+    cs.AddFloat( "scene.camera_theta", &mInitCamTheta, -100.0f, 100.0f, SR_RESTART );
+    cs.AddFloat( "scene.camera_speed", &mCameraSpeed, 0.0f, 1e6f );
+
+    cs.AddFloat( "common.frame_delta_time", &mFrameDeltaTime, 0.0f, 1.0f );
+    cs.AddEnum( "common.frame_pacing", reinterpret_cast< int* >( &mFramePacingMode ), pacingNames, FPM_COUNT );
+    cs.AddFloat( "common.frame_spin_threshold", &mFrameSpinThreshold, 0.0f, 1.0f );
+    cs.AddString( "common.shader_dir", &mShaderDir, SR_RESTART );
+    cs.AddString( "common.media_dir", &mMediaDir, SR_RESTART );
+    cs.AddString( "common.scene", &mSceneFn, SR_RESTART );
+    cs.AddString( "common.save_scene", &mSaveSceneFn, SR_RESTART );
+    cs.AddBool( "common.save_scene_enable", &mSaveScene, SR_RESTART );
+    cs.AddInt( "common.worker_threads", &mWorkerThreads, 0, 256, SR_RESTART );
+    cs.AddBool( "common.optimize_meshes", &mOptimizeMeshes, SR_RESTART );
+    cs.AddBool( "common.build_scene_bvh", &mBuildSceneBVH, SR_RESTART );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Settings::LoadConfig( const char *fn )
+{
+    mConfigFn = fn;
+
+    std::ifstream test( fn );
+    if ( !test.is_open( ) )
+    {
+        // first start, keep defaults and give a file to edit
+        std::ofstream file( fn );
+        file << "# VCT settings, edits are applied while running\n\n" << mConfigSchema.Write( );
+        LOG_INFO( "Settings file created: ", fn );
+        mConfigWatcher.SetPath( fn );
+        return file.good( );
+    }
+    test.close( );
+
+    mConfigWatcher.SetPath( fn );
+    ApplyConfig( );
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t Settings::ReloadConfig( )
+{
+    if ( mConfigFn.empty( ) || !mConfigWatcher.Poll( ) )
+        return SR_NONE;
+
+    return ApplyConfig( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint32_t Settings::ApplyConfig( )
+{
+    ConfigDocument doc;
+    std::vector<std::string> errors;
+    std::vector<ConfigChange> changes;
+    LoadConfigFile( mConfigFn.c_str( ), doc, errors );
+    uint32_t reload = mConfigSchema.Apply( doc, changes, errors );
+
+    for ( auto &error : errors )
+        LOG_ERROR( mConfigFn, " ", error );
+    for ( auto &change : changes )
+        LOG_INFO( "Setting ", change.mKey, ": ", change.mOldValue, " -> ", change.mNewValue );
+    if ( reload & SR_RESTART )
+        LOG_INFO( "Some changed settings are used after restart only" );
+
+    // debug levels follow octree height
+    mVCTDebugOctreeLevel = Clamp( mVCTDebugOctreeLevel, 0, mOctreeHeight - 1 );
+    mVCTDebugOctreeFirstLevel = Clamp( mVCTDebugOctreeFirstLevel, 1, mOctreeHeight - 1 );
+    mVCTDebugOctreeLastLevel = Clamp( mVCTDebugOctreeLastLevel, 0, mVCTDebugOctreeFirstLevel - 1 );
+
+    return reload;
 }
\ No newline at end of file
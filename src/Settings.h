@@ -2,6 +2,9 @@
 #define __SETTINGS_H
 
 #include <GlobalUtils.h>
+#include <Core/FramePacer.h>
+#include <Core/Config.h>
+#include <string>
 
 enum RenderOutput
 {
@@ -21,6 +24,15 @@ enum DebugBuffer
     DBUF_COUNT
 };
 
+// what has to be recreated after a config change
+enum SettingsReload
+{
+    SR_NONE = 0,
+    SR_SHADOW_MAPS = 1 << 0, // shadow mapper and photon list
+    SR_VCT = 1 << 1, // octree, brick buffers and cone tracing targets, scene is voxelized again
+    SR_RESTART = 1 << 2, // window, geometry pool, camera start and paths, used on next start only
+};
+
 class Settings
 {
 public:
@@ -39,17 +51,25 @@ public:
 
     RenderOutput mRenderOutput;
     int mShadowMapRes;
-    float mShadowMapZNear;
-    float mShadowMapZFar;
+    int mShadowCascades;
+    float mShadowCascadeLambda;
+    float mShadowCascadeGuard;
     float mShadowBias;
+    int mLocalLightShadowRes;
 
     float mBlurSharpness;
     float mBlurRadius;
+    float mBlurNormalSharpness;
 
     float mAOInfluence;
     float mDirectInfluence;
     float mIndirectInfluence;
 
+    int mGeometryPoolVertices;
+    int mGeometryPoolIndices;
+    bool mCompactVertices; // scene geometry in 16 byte quantized vertices instead of 44 byte floats
+    bool mFrustumCulling;
+
     // VCT settings
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     bool mVCTEnable;
@@ -72,7 +92,11 @@ public:
     float mVCTIndirectAmplification;
     float mVCTStepCorrection;
     bool mVCTUseOpacityBuffer;
+    bool mVCTNeighborRopes; // cone samples continue from the previous node through parent and neighbor links
+    bool mVCTEmptySpace; // cone samples in cells the empty space field marks as empty skip the octree
     int mVCTConeTracingRes;
+    bool mMergeVoxels; // voxel fragments are merged per leaf on cpu before the octree build
+    int mLightInjectionBudget;
 
     bool mShowAO;
 
@@ -81,6 +105,7 @@ public:
     float mSunYaw;
     float mSunPitch;
     float mLightDistance;
+    int mLocalLightCount;
     float mSunColor[3];
     float mSunPower;
 
@@ -96,16 +121,34 @@ public:
     // Common settings
     ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     float mFrameDeltaTime;
+    FramePacingMode mFramePacingMode;
+    float mFrameSpinThreshold;
 
-    char *mShaderDir;
-    char *mMediaDir;
+    int mWorkerThreads; // task scheduler threads besides the main one, 0 - hardware concurrency minus one
 
-    char *mSceneFn;
-    char *mSaveSceneFn;
+    std::string mShaderDir;
+    std::string mMediaDir;
+
+    std::string mSceneFn;
+    std::string mSaveSceneFn; // written object by object while the scene streams in, may be mSceneFn
     bool mSaveScene;
+    bool mOptimizeMeshes; // vertex cache, overdraw and fetch order at obj import and when a bin is saved
+    bool mBuildSceneBVH; // positions of the whole scene are read only if the bvh cached in the bin is missing or stale
+
+    // reads config over defaults, missing file is created with current values
+    bool LoadConfig( const char *fn );
+    // applies config file edits, returns SettingsReload mask of changed values
+    uint32_t ReloadConfig( );
 
 private:
     Settings();
+
+    void BuildConfigSchema( );
+    uint32_t ApplyConfig( );
+
+    ConfigSchema mConfigSchema;
+    ConfigFileWatcher mConfigWatcher;
+    std::string mConfigFn;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,336 @@
+#include <Core/RenderQueue.h>
+#include <Core/Culling.h>
+#include <Core/BilateralUpsample.h>
+#include <Core/PhotonList.h>
+#include <Core/CameraPath.h>
+#include <Core/PathBenchmark.h>
+#include <Core/VMath.h>
+#include <Core/ObjLoader.h>
+#include <Core/BVH.h>
+#include <Core/SceneStream.h>
+#include <Core/MeshOptimizer.h>
+#include <Core/TaskScheduler.h>
+#include <Core/CompactVertex.h>
+#include <Core/VoxelMerge.h>
+#include <Core/ConeTracer.h>
+#include <Core/DenseMipVolume.h>
+#include <Core/DistanceField.h>
+#include <Core/IrradianceCache.h>
+#include <Core/ProbeGrid.h>
+#include <GeometryGenerator.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// vct_core cpu benchmarks without window and device, same workloads as headless switches of the renderer
+// usage: vct_core_benchmark [path file], path file is replayed by the cpu path benchmark (orbit without it)
+//        vct_core_benchmark -tasks [obj] [threads], scheduler and obj import scaling from 1 thread up (synthetic obj without it)
+//        vct_core_benchmark -mesh_optimizer <scene bin or obj>, optimizer stats of a scene (synthetic without it)
+//        vct_core_benchmark -scene_stream <GB> [scene file], streams a synthetic scene through the scene bin loader
+//        vct_core_benchmark -voxel_merge [fragments] [threads], voxel fragment sort and merge from 1 thread up
+//        vct_core_benchmark -cone_march [height] [points], octree texels per cone sample, root traversal vs neighbor ropes
+//        vct_core_benchmark -hybrid_volume [height] [cutoff] [points], dense mips for levels up to cutoff (0 - suggested) vs sparse octree
+//        vct_core_benchmark -empty_space [height] [level] [points], distance field of a level (0 - height - 2), cone samples it skips
+//        vct_core_benchmark -irradiance_cache [height] [pixels] [frames], per leaf cone results reused over an orbit with a relight halfway
+//        vct_core_benchmark -probe_bake [height] [probes per axis] [directions], SH probe grid bake rate, file size and fit error
+//
+
+typedef std::chrono::steady_clock Clock;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+double GetSeconds( Clock::time_point start )
+{
+    return std::chrono::duration<double>( Clock::now( ) - start ).count( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunGeometryBenchmark( )
+{
+    // tessellated plane written as obj text, parsed back and put into bvh
+    GGMeshData plane;
+    Clock::time_point start = Clock::now( );
+    GeometryGenerator::GeneratePlane( 1000.0f, 1000.0f, 512, 512, plane );
+    double generateTime = GetSeconds( start );
+
+    std::ostringstream obj;
+    obj << "# object plane\n";
+    for ( auto &v : plane.verticies )
+        obj << "v " << v.position.x << " " << v.position.y << " " << v.position.z << "\n";
+    for ( auto &v : plane.verticies )
+        obj << "vt " << v.UVW.x << " " << 1.0f - v.UVW.y << " 0\n";
+    obj << "vn 0 1 0\n";
+    for ( size_t i = 0; i + 2 < plane.indicies.size( ); i += 3 )
+    {
+        obj << "f";
+        for ( int j = 0; j < 3; j++ )
+            obj << " " << plane.indicies[i + j] + 1 << "/" << plane.indicies[i + j] + 1 << "/1";
+        obj << "\n";
+    }
+
+    std::vector<ObjMesh> meshes;
+    ObjCallbacks callbacks;
+    callbacks.mOnMesh = [&]( const ObjMesh &mesh ) { meshes.push_back( mesh ); };
+    std::istringstream in( obj.str( ) );
+    start = Clock::now( );
+    bool parsed = ParseObj( in, "", callbacks ) && meshes.size( ) == 1;
+    double parseTime = GetSeconds( start );
+    if ( !parsed )
+        return false;
+
+    const GGMeshData &mesh = meshes[0].mData;
+    BVHBuildInput input;
+    input.AddMesh( mesh.verticies.data( ), sizeof( GGVertex ), mesh.verticies.size( ), mesh.indicies.data( ), mesh.indicies.size( ), 0 );
+    BVH bvh;
+    if ( !bvh.Build( input ) )
+        return false;
+
+    size_t hits = 0;
+    double raysPerSecond = bvh.RunRayBenchmark( 1000000, hits );
+    std::cout << "Geometry benchmark: verticies " << mesh.verticies.size( ) << " triangles " << mesh.indicies.size( ) / 3
+        << " generate " << generateTime * 1000.0 << "ms obj parse " << parseTime * 1000.0 << "ms bvh build "
+        << bvh.GetStats( ).mBuildTime * 1000.0 << "ms rays " << raysPerSecond * 1e-6 << "M/s hits " << hits << std::endl;
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int RunSceneStreamBenchmark( int argc, char **argv )
+{
+    // out of core check: file can be larger than RAM, peak RSS has to stay near the largest object
+    double gigabytes = argc > 2 ? atof( argv[2] ) : 1.0;
+    const char *fn = argc > 3 ? argv[3] : "scene_stream_benchmark.bin";
+    uint64_t bytes = static_cast< uint64_t >( ( gigabytes > 0.0 ? gigabytes : 1.0 ) * ( 1 << 30 ) );
+
+    SceneStreamBenchmarkResult result = RunSceneStreamBenchmark( fn, bytes, 1 << 20 );
+    std::cout << "Scene stream benchmark: " << ( result.mBytes >> 20 ) << "MB objects " << result.mObjects << " triangles "
+        << result.mTriangles << " write " << result.mWriteMBs << "MB/s read " << result.mReadMBs << "MB/s largest object "
+        << ( result.mLargestObject >> 20 ) << "MB peak RSS " << ( result.mPeakRSS >> 20 ) << "MB matches " << result.mMatches << std::endl;
+    return result.mMatches ? 0 : 1;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PrintMeshOptimizerBenchmark( const char *fn )
+{
+    MeshOptimizerBenchmarkResult result = RunMeshOptimizerBenchmark( fn );
+    const MeshOptimizeResult &stats = result.mStats;
+    std::cout << "Mesh optimizer benchmark " << result.mSource << ": objects " << result.mObjects << " triangles " << stats.mAfter.mTriangles
+        << " ACMR " << stats.mBefore.GetACMR( ) << " -> " << stats.mAfter.GetACMR( ) << " ATVR " << stats.mBefore.GetATVR( ) << " -> "
+        << stats.mAfter.GetATVR( ) << " overdraw of biggest " << result.mOverdrawBefore << " -> " << result.mOverdrawAfter << " optimize "
+        << result.mOptimizeMs << "ms" << std::endl;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int RunTaskBenchmark( const char *fn, size_t maxThreads )
+{
+    TaskSchedulerBenchmarkResult tasks = RunTaskSchedulerBenchmark( maxThreads );
+    for ( size_t i = 0; i < tasks.mThreads.size( ); i++ )
+    {
+        std::cout << "Task scheduler benchmark: threads " << tasks.mThreads[i] << " parallel for " << tasks.mForMs[i] << "ms reduce "
+            << tasks.mReduceMs[i] << "ms graph " << tasks.mGraphMs[i] << "ms speedup " << tasks.mForMs[0] / tasks.mForMs[i] << " "
+            << tasks.mReduceMs[0] / tasks.mReduceMs[i] << " " << tasks.mGraphMs[0] / tasks.mGraphMs[i] << std::endl;
+    }
+
+    ObjImportBenchmarkResult import = RunObjImportBenchmark( fn, maxThreads );
+    for ( size_t i = 0; i < import.mThreads.size( ); i++ )
+    {
+        std::cout << "Obj import benchmark " << import.mSource << ": meshes " << import.mMeshes << " triangles " << import.mTriangles
+            << " threads " << import.mThreads[i] << " import " << import.mImportMs[i] << "ms speedup "
+            << import.mImportMs[0] / import.mImportMs[i] << std::endl;
+    }
+    return tasks.mMatches ? 0 : 1;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PrintVoxelMergeBenchmark( size_t fragments, size_t maxThreads )
+{
+    VoxelMergeBenchmarkResult merge = RunVoxelMergeBenchmark( fragments, maxThreads, 5 );
+    for ( size_t i = 0; i < merge.mThreads.size( ); i++ )
+    {
+        std::cout << "Voxel merge benchmark: fragments " << merge.mFragments << " voxels " << merge.mVoxels << " threads " << merge.mThreads[i]
+            << " radix sort + reduce " << merge.mMergeMs[i] << "ms std::stable_sort + reduce " << merge.mStdSortMs << "ms speedup "
+            << merge.mMergeMs[0] / merge.mMergeMs[i] << " matches reference " << merge.mMatchesReference << std::endl;
+    }
+    return merge.mMatchesReference;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PrintConeMarchBenchmark( uint32_t height, size_t points )
+{
+    ConeMarchBenchmarkResult march = RunConeMarchBenchmark( height, points, 3 );
+    const OctreeMarchStats &root = march.mRoot, &ropes = march.mRopes;
+    double samples = static_cast< double >( ( std::max )( root.mLookups, size_t( 1 ) ) );
+    std::cout << "Cone march benchmark: height " << march.mHeight << " voxels " << march.mVoxels << " nodes " << march.mNodes
+        << " points " << march.mPoints << " samples " << root.mLookups << " fetches per sample root " << root.mFetches / samples
+        << " ropes " << ropes.mFetches / samples << " (parent " << ropes.mParentSteps / samples << " neighbor " << ropes.mNeighborSteps / samples
+        << " root traversals " << ropes.mRootTraversals / samples << ") root " << march.mRootMs << "ms ropes " << march.mRopesMs
+        << "ms results match " << march.mResultsMatch << std::endl;
+    return march.mResultsMatch;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PrintHybridVolumeBenchmark( uint32_t height, uint32_t cutoff, size_t points )
+{
+    HybridVolumeBenchmarkResult hybrid = RunHybridVolumeBenchmark( height, cutoff, points, 3 );
+    std::cout << "Hybrid volume benchmark: height " << hybrid.mHeight << " cutoff " << hybrid.mCutoff << " occupancy";
+    for ( double occupancy : hybrid.mOccupancy )
+        std::cout << " " << occupancy;
+    std::cout << " levels 0.." << hybrid.mCutoff << " sparse " << hybrid.mSparseBytes / 1024.0 << "KB dense " << hybrid.mDenseBytes / 1024.0
+        << "KB build " << hybrid.mBuildMs << "ms points " << hybrid.mPoints << " samples " << hybrid.mSamples << " dense "
+        << hybrid.mDenseSamples << " fetches per sample sparse " << hybrid.mSparseFetches << " hybrid " << hybrid.mHybridFetches
+        << " sparse " << hybrid.mSparseMs << "ms hybrid " << hybrid.mHybridMs << "ms mean difference " << hybrid.mMeanDifference << std::endl;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PrintEmptySpaceBenchmark( uint32_t height, uint32_t level, size_t points )
+{
+    EmptySpaceBenchmarkResult empty = RunEmptySpaceBenchmark( height, level, points, 3 );
+    double emptyCells = 100.0 * empty.mEmptyCells / static_cast< double >( ( std::max )( empty.mFieldBytes, size_t( 1 ) ) );
+    double saved = 100.0 * empty.mSkippedSamples / static_cast< double >( ( std::max )( empty.mSamples, size_t( 1 ) ) );
+    std::cout << "Empty space benchmark: height " << empty.mHeight << " field level " << empty.mLevel << " " << empty.mFieldBytes / 1024.0
+        << "KB empty cells " << emptyCells << "% build 1 thread " << empty.mSerialBuildMs << "ms " << empty.mThreads << " threads "
+        << empty.mParallelBuildMs << "ms points " << empty.mPoints << " samples " << empty.mSamples << " skipped " << empty.mSkippedSamples << " (" << saved << "%) fetches per sample "
+        << empty.mBaseFetches << " skipping " << empty.mSkipFetches << " + field " << empty.mFieldFetches << " base " << empty.mBaseMs
+        << "ms skipping " << empty.mSkipMs << "ms results match " << empty.mResultsMatch << std::endl;
+    return empty.mResultsMatch;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void PrintIrradianceCacheBenchmark( uint32_t height, size_t pixels, uint32_t frames )
+{
+    IrradianceCacheBenchmarkResult cache = RunIrradianceCacheBenchmark( height, pixels, frames );
+    size_t relight = cache.mHitRates.size( ) / 2;
+    double warm = 0.0;
+    for ( size_t i = 1; i < relight; i++ )
+        warm += cache.mHitRates[i] / ( relight - 1 );
+    std::cout << "Irradiance cache benchmark: height " << cache.mHeight << " entries " << cache.mEntries << " " << cache.mBytes / 1024.0
+        << "KB regions " << cache.mRegions << " pixels " << cache.mPixels << " frames " << cache.mHitRates.size( ) << " hit rate first "
+        << cache.mHitRates.front( ) << " warm " << warm << " after relight " << cache.mHitRates[relight] << " last " << cache.mHitRates.back( )
+        << " frame cold " << cache.mColdMs << "ms cached " << cache.mCachedMs << "ms traced " << cache.mTracedMs << "ms mean difference " << cache.mMeanDifference
+        << " reach " << cache.mReach << " leaves relit " << cache.mRelitLeaves << " invalidated regions " << cache.mInvalidatedRegions
+        << " entries " << cache.mInvalidatedEntries << std::endl;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PrintProbeBakeBenchmark( uint32_t height, uint32_t resolution, uint32_t directions )
+{
+    ProbeBakeBenchmarkResult probes = RunProbeBakeBenchmark( height, resolution, directions );
+    std::cout << "Probe bake benchmark: height " << probes.mHeight << " probes " << probes.mResolution << "^3 valid " << probes.mValidProbes
+        << " directions " << probes.mDirections << " bake 1 thread " << probes.mSerialMs << "ms " << probes.mThreads << " threads "
+        << probes.mParallelMs << "ms " << probes.mProbesPerSecond << " probes/s file L1 " << probes.mL1FileBytes / 1024.0 << "KB L2 "
+        << probes.mL2FileBytes / 1024.0 << "KB fit error L1 " << probes.mL1Error << " L2 " << probes.mL2Error << " surface difference "
+        << probes.mSurfaceDifference << " spheres " << probes.mSphereDifference << " per point probes " << probes.mEvaluateUs << "us traced " << probes.mTraceUs << "us bakes match "
+        << probes.mBakesMatch << std::endl;
+    return probes.mBakesMatch;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char **argv )
+{
+    if ( argc > 1 && strcmp( argv[1], "-scene_stream" ) == 0 )
+        return RunSceneStreamBenchmark( argc, argv );
+
+    if ( argc > 1 && strcmp( argv[1], "-tasks" ) == 0 )
+        return RunTaskBenchmark( argc > 2 ? argv[2] : nullptr, argc > 3 ? static_cast< size_t >( atoi( argv[3] ) ) : 0 );
+
+    if ( argc > 1 && strcmp( argv[1], "-voxel_merge" ) == 0 )
+    {
+        size_t fragments = argc > 2 ? static_cast< size_t >( atol( argv[2] ) ) : 1 << 22;
+        return PrintVoxelMergeBenchmark( fragments, argc > 3 ? static_cast< size_t >( atoi( argv[3] ) ) : 0 ) ? 0 : 1;
+    }
+
+    if ( argc > 1 && strcmp( argv[1], "-cone_march" ) == 0 )
+    {
+        uint32_t height = argc > 2 ? static_cast< uint32_t >( atoi( argv[2] ) ) : 8;
+        return PrintConeMarchBenchmark( height, argc > 3 ? static_cast< size_t >( atol( argv[3] ) ) : 100000 ) ? 0 : 1;
+    }
+
+    if ( argc > 1 && strcmp( argv[1], "-hybrid_volume" ) == 0 )
+    {
+        uint32_t height = argc > 2 ? static_cast< uint32_t >( atoi( argv[2] ) ) : 8;
+        uint32_t cutoff = argc > 3 ? static_cast< uint32_t >( atoi( argv[3] ) ) : 5;
+        PrintHybridVolumeBenchmark( height, cutoff, argc > 4 ? static_cast< size_t >( atol( argv[4] ) ) : 100000 );
+        return 0;
+    }
+
+    if ( argc > 1 && strcmp( argv[1], "-empty_space" ) == 0 )
+    {
+        uint32_t height = argc > 2 ? static_cast< uint32_t >( atoi( argv[2] ) ) : 8;
+        uint32_t level = argc > 3 ? static_cast< uint32_t >( atoi( argv[3] ) ) : 0;
+        return PrintEmptySpaceBenchmark( height, level, argc > 4 ? static_cast< size_t >( atol( argv[4] ) ) : 100000 ) ? 0 : 1;
+    }
+
+    if ( argc > 1 && strcmp( argv[1], "-irradiance_cache" ) == 0 )
+    {
+        uint32_t height = argc > 2 ? static_cast< uint32_t >( atoi( argv[2] ) ) : 8;
+        size_t pixels = argc > 3 ? static_cast< size_t >( atol( argv[3] ) ) : 20000;
+        PrintIrradianceCacheBenchmark( height, pixels, argc > 4 ? static_cast< uint32_t >( atoi( argv[4] ) ) : 20 );
+        return 0;
+    }
+
+    if ( argc > 1 && strcmp( argv[1], "-probe_bake" ) == 0 )
+    {
+        uint32_t height = argc > 2 ? static_cast< uint32_t >( atoi( argv[2] ) ) : 8;
+        uint32_t resolution = argc > 3 ? static_cast< uint32_t >( atoi( argv[3] ) ) : 16;
+        return PrintProbeBakeBenchmark( height, resolution, argc > 4 ? static_cast< uint32_t >( atoi( argv[4] ) ) : 32 ) ? 0 : 1;
+    }
+
+    if ( argc > 1 && strcmp( argv[1], "-mesh_optimizer" ) == 0 )
+    {
+        PrintMeshOptimizerBenchmark( argc > 2 ? argv[2] : nullptr );
+        return 0;
+    }
+
+    RenderQueueStats queue = RenderQueue::RunBenchmark( 100000, 512, 256 );
+    std::cout << "Render queue benchmark: items " << queue.mItems << " batches " << queue.mBatches << " radix sort + batching "
+        << queue.mSortTime * 1000.0 << "ms std::sort " << queue.mStdSortTime * 1000.0 << "ms" << std::endl;
+
+    CullingBenchmarkResult culling = RunCullingBenchmark( 100000, 100 );
+    std::cout << "Culling benchmark: boxes " << culling.mBoxes << " visible " << culling.mVisible << " paths match " << culling.mPathsMatch
+        << " scalar " << culling.mBoxesPerSecond[CP_SCALAR] * 1e-6 << "M/s sse " << culling.mBoxesPerSecond[CP_SSE] * 1e-6
+        << "M/s avx " << culling.mBoxesPerSecond[CP_AVX] * 1e-6 << "M/s" << std::endl;
+
+    MathBenchmarkResult math = RunMathBenchmark( 100000, 100 );
+    std::cout << "Math benchmark: points " << math.mPoints << " paths match " << math.mPathsMatch
+        << " scalar " << math.mPointsPerSecond[MP_SCALAR] * 1e-6 << "M/s sse " << math.mPointsPerSecond[MP_SSE] * 1e-6
+        << "M/s avx " << math.mPointsPerSecond[MP_AVX] * 1e-6 << "M/s neon " << math.mPointsPerSecond[MP_NEON] * 1e-6 << "M/s" << std::endl;
+
+    CompactVertexBenchmarkResult compact = RunCompactVertexBenchmark( 100000, 50 );
+    std::cout << "Compact vertex benchmark: vertices " << compact.mVertices << " paths match " << compact.mPathsMatch
+        << " scalar " << compact.mVerticesPerSecond[MP_SCALAR] * 1e-6 << "M/s sse " << compact.mVerticesPerSecond[MP_SSE] * 1e-6
+        << "M/s avx " << compact.mVerticesPerSecond[MP_AVX] * 1e-6 << "M/s max error position " << compact.mMaxPositionError
+        << " steps normal " << compact.mMaxNormalErrorDegrees << "deg uv " << compact.mMaxUVError << std::endl;
+
+    UpsampleBenchmarkResult upsample = RunUpsampleBenchmark( 256, 256, 1280, 720, 3 );
+    std::cout << "Upsample benchmark: psnr vs legacy " << upsample.mPSNR << "dB legacy " << upsample.mLegacyMPixels << "Mpix/s scalar "
+        << upsample.mScalarMPixels << "Mpix/s simd " << upsample.mSimdMPixels << "Mpix/s" << std::endl;
+
+    PhotonBenchmarkResult photons = RunPhotonListBenchmark( 2048, 256, 5 );
+    std::cout << "Photon list benchmark: photons " << photons.mPhotons << " leaves " << photons.mLeaves << " radix sort " << photons.mSortMs
+        << "ms std::stable_sort " << photons.mStdSortMs << "ms inject per texel " << photons.mPerTexelInjectMs << "ms per leaf "
+        << photons.mLeafInjectMs << "ms matches reference " << photons.mMatchesReference << std::endl;
+
+    CameraPath path;
+    std::string error;
+    if ( argc > 1 && !path.Load( argv[1], error ) )
+    {
+        std::cout << "Can't load camera path " << argv[1] << ": " << error << std::endl;
+        return 1;
+    }
+    if ( argc <= 1 )
+        path = MakeOrbitPath( 1500.0f, 600.0f, 20.0f );
+
+    PathBenchmarkReport report = RunCpuPathBenchmark( path, 600, 20000 );
+    FramePercentiles summary = report.GetSummary( );
+    std::cout << "Path benchmark: frames " << summary.mCount << " mean " << summary.mMean << "ms p50 " << summary.mP50
+        << "ms p99 " << summary.mP99 << "ms max " << summary.mMax << "ms" << std::endl;
+
+    PrintMeshOptimizerBenchmark( nullptr );
+    bool voxelMerge = PrintVoxelMergeBenchmark( 1 << 20, 0 );
+    bool coneMarch = PrintConeMarchBenchmark( 8, 20000 );
+    PrintHybridVolumeBenchmark( 8, 5, 20000 );
+    bool emptySpace = PrintEmptySpaceBenchmark( 8, 0, 20000 );
+    PrintIrradianceCacheBenchmark( 8, 5000, 10 );
+    bool probeBake = PrintProbeBakeBenchmark( 8, 8, 32 );
+    bool tasks = RunTaskBenchmark( nullptr, 0 ) == 0;
+
+    bool geometry = RunGeometryBenchmark( );
+    if ( !geometry )
+        std::cout << "Geometry benchmark failed" << std::endl;
+
+    return culling.mPathsMatch && math.mPathsMatch && photons.mMatchesReference && voxelMerge && coneMarch && emptySpace && probeBake && tasks && geometry ? 0 : 1;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
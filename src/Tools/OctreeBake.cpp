@@ -0,0 +1,207 @@
+#include <Core/OctreeShards.h>
+#include <Core/CpuOctree.h>
+#include <Core/ConeTracer.h>
+#include <Core/SceneStream.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// offline octree bake split into spatial shards, every shard is a process of its own that only reads the voxel file and
+// writes its shard file, so shards can run as N workers of one box or on other hosts with a shared directory
+// usage: vct_octree_bake -shard <voxel file> <height> <shard level> <shard> <shard file>, subtree of one shard cell
+//        vct_octree_bake -merge <octree file> <shard files...>, one octree ( a shard file of level 0 ) from every shard
+//        vct_octree_bake -bake <voxel file> <height> <shard level> <workers> <octree file>, -shard processes and -merge
+//        vct_octree_bake -test [height] [shard level] [workers], -bake of the cone test room against a single process build
+//
+
+typedef std::chrono::steady_clock Clock;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+double GetMs( Clock::time_point start )
+{
+    return std::chrono::duration< double, std::milli >( Clock::now( ) - start ).count( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string GetShardFileName( const std::string &octreeFile, uint32_t shard )
+{
+    std::ostringstream fn;
+    fn << octreeFile << ".shard" << shard;
+    return fn.str( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int BakeShard( const char *voxelFile, uint32_t height, uint32_t shardLevel, uint32_t shard, const char *shardFile )
+{
+    std::string error;
+    std::vector<OctreeVoxel> voxels;
+    OctreeShard result;
+    if ( !LoadVoxelFile( voxelFile, height, shardLevel, shard, voxels, error ) )
+    {
+        std::cout << "shard " << shard << ": " << error << std::endl;
+        return 1;
+    }
+    BuildOctreeShard( voxels, height, shardLevel, shard, result );
+    if ( !SaveOctreeShard( shardFile, result, error ) )
+    {
+        std::cout << "shard " << shard << ": " << error << std::endl;
+        return 1;
+    }
+    return 0;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MergeShards( const char *octreeFile, const std::vector<std::string> &files )
+{
+    std::string error;
+    CpuOctree octree;
+    std::vector<OctreeVoxel> voxels;
+    OctreeShard merged;
+    if ( !MergeOctreeShards( files, octree, voxels, error ) )
+    {
+        std::cout << "merge: " << error << std::endl;
+        return false;
+    }
+    MakeOctreeShard( octree, voxels, merged );
+    if ( !SaveOctreeShard( octreeFile, merged, error ) )
+    {
+        std::cout << "merge: " << error << std::endl;
+        return false;
+    }
+    std::cout << "Merged " << files.size( ) << " shards: nodes " << octree.GetNodeCount( ) << " voxels " << voxels.size( )
+        << " peak RSS " << GetPeakRSS( ) / ( 1024.0 * 1024.0 ) << "MB" << std::endl;
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Bake( const char *self, const char *voxelFile, uint32_t height, uint32_t shardLevel, size_t workers, const char *octreeFile )
+{
+    shardLevel = ( std::min )( shardLevel, height - 1 );
+    uint32_t shards = GetShardCount( shardLevel );
+    std::vector<std::string> files( shards );
+    for ( uint32_t shard = 0; shard < shards; shard++ )
+        files[shard] = GetShardFileName( octreeFile, shard );
+
+    // a process per shard, workers at a time; exit codes are the only thing that comes back
+    std::atomic<uint32_t> next( 0 );
+    std::atomic<uint32_t> failed( 0 );
+    auto worker = [&]( )
+    {
+        for ( uint32_t shard = next++; shard < shards; shard = next++ )
+        {
+            std::ostringstream command;
+            command << "\"" << self << "\" -shard \"" << voxelFile << "\" " << height << " " << shardLevel << " " << shard
+                << " \"" << files[shard] << "\"";
+            if ( std::system( command.str( ).c_str( ) ) != 0 )
+                failed++;
+        }
+    };
+    std::vector<std::thread> threads;
+    for ( size_t i = 0; i < ( std::max )( workers, size_t( 1 ) ); i++ )
+        threads.push_back( std::thread( worker ) );
+    for ( std::thread &thread : threads )
+        thread.join( );
+
+    bool merged = failed == 0 && MergeShards( octreeFile, files );
+    if ( failed != 0 )
+        std::cout << "bake: " << failed << " shards failed" << std::endl;
+    for ( const std::string &fn : files )
+        std::remove( fn.c_str( ) );
+    return merged;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunBakeTest( const char *self, uint32_t height, uint32_t shardLevel, size_t workers )
+{
+    height = ( std::max )( 2u, ( std::min )( height, static_cast< uint32_t >( MAX_OCTREE_HEIGHT ) ) );
+    shardLevel = ( std::min )( shardLevel, height - 1 );
+
+    std::vector<OctreeVoxel> voxels;
+    std::vector<ConeTracePoint> surface;
+    GenerateConeTestRoom( height, voxels, surface );
+
+    const char *voxelFile = "octree_bake_test_voxels.bin", *octreeFile = "octree_bake_test.bin";
+    std::string error;
+    if ( !SaveVoxelFile( voxelFile, voxels, error ) )
+    {
+        std::cout << "test: " << error << std::endl;
+        return false;
+    }
+
+    Clock::time_point start = Clock::now( );
+    CpuOctree single;
+    single.Build( voxels, height );
+    double singleMs = GetMs( start );
+
+    start = Clock::now( );
+    bool baked = Bake( self, voxelFile, height, shardLevel, workers, octreeFile );
+    double shardedMs = GetMs( start );
+
+    // a single build of the voxels in shard order is what the merge has to give
+    OctreeShard merged;
+    bool loaded = baked && LoadOctreeShard( octreeFile, merged, false, error );
+    std::vector<OctreeVoxel> inShardOrder;
+    for ( uint32_t shard = 0; shard < GetShardCount( shardLevel ); shard++ )
+    {
+        for ( const OctreeVoxel &voxel : voxels )
+        {
+            if ( IsVoxelInShard( voxel, height, shardLevel, shard ) )
+                inShardOrder.push_back( voxel );
+        }
+    }
+    CpuOctree reference;
+    reference.Build( inShardOrder, height );
+
+    bool matches = loaded && merged.mHeight == height && merged.mSlots == reference.GetSlots( ) &&
+        merged.mVoxels.size( ) == inShardOrder.size( ) && reference.GetNodeCount( ) == single.GetNodeCount( );
+    for ( uint32_t level = 0; matches && level <= height; level++ )
+        matches = merged.mLevelOffsets[level] == single.GetLevelOffset( level );
+    for ( size_t i = 0; matches && i < inShardOrder.size( ); i++ )
+        matches = merged.mVoxels[i].mPosition == inShardOrder[i].mPosition && merged.mVoxels[i].mColor == inShardOrder[i].mColor;
+
+    std::cout << "Octree bake test: height " << height << " shard level " << shardLevel << " shards " << GetShardCount( shardLevel )
+        << " workers " << workers << " voxels " << voxels.size( ) << " nodes " << single.GetNodeCount( ) << " single process "
+        << singleMs << "ms sharded " << shardedMs << "ms " << ( matches ? "matches" : "DOESN'T MATCH" ) << " the single process build"
+        << std::endl;
+
+    std::remove( voxelFile );
+    std::remove( octreeFile );
+    return matches;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char **argv )
+{
+    if ( argc > 6 && strcmp( argv[1], "-shard" ) == 0 )
+    {
+        return BakeShard( argv[2], static_cast< uint32_t >( atoi( argv[3] ) ), static_cast< uint32_t >( atoi( argv[4] ) ),
+            static_cast< uint32_t >( atoi( argv[5] ) ), argv[6] );
+    }
+
+    if ( argc > 3 && strcmp( argv[1], "-merge" ) == 0 )
+        return MergeShards( argv[2], std::vector<std::string>( argv + 3, argv + argc ) ) ? 0 : 1;
+
+    if ( argc > 6 && strcmp( argv[1], "-bake" ) == 0 )
+    {
+        return Bake( argv[0], argv[2], static_cast< uint32_t >( atoi( argv[3] ) ), static_cast< uint32_t >( atoi( argv[4] ) ),
+            static_cast< size_t >( atoi( argv[5] ) ), argv[6] ) ? 0 : 1;
+    }
+
+    if ( argc > 1 && strcmp( argv[1], "-test" ) == 0 )
+    {
+        uint32_t height = argc > 2 ? static_cast< uint32_t >( atoi( argv[2] ) ) : 6;
+        uint32_t shardLevel = argc > 3 ? static_cast< uint32_t >( atoi( argv[3] ) ) : 1;
+        size_t workers = argc > 4 ? static_cast< size_t >( atoi( argv[4] ) ) : std::max( 1u, std::thread::hardware_concurrency( ) );
+        return RunBakeTest( argv[0], height, shardLevel, workers ) ? 0 : 1;
+    }
+
+    std::cout << "usage: vct_octree_bake -shard <voxel file> <height> <shard level> <shard> <shard file>" << std::endl
+        << "       vct_octree_bake -merge <octree file> <shard files...>" << std::endl
+        << "       vct_octree_bake -bake <voxel file> <height> <shard level> <workers> <octree file>" << std::endl
+        << "       vct_octree_bake -test [height] [shard level] [workers]" << std::endl;
+    return 1;
+}
@@ -7,15 +7,33 @@
 #include <Camera.h>
 #include <Scene.h>
 #include <Settings.h>
+#include <Core/FramePacer.h>
+#include <Core/RenderQueue.h>
+#include <Core/Culling.h>
+#include <Core/BilateralUpsample.h>
+#include <Core/ShadowCascades.h>
+#include <Core/PhotonList.h>
+#include <Core/LightManager.h>
+#include <Core/Config.h>
+#include <Core/CameraPath.h>
+#include <Core/PathBenchmark.h>
+#include <Core/VMath.h>
+#include <Core/SceneStream.h>
+#include <Core/MeshOptimizer.h>
+#include <Core/TaskScheduler.h>
+#include <CoreTests.h>
+#include <DirectXMath.h>
 #include <direct.h>
 
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <vector>
+#include <algorithm>
 
 #include <functional>
 #include <chrono>
-#include <thread>
+#include <random>
 
 //
 // This is a simple DX11.1 render engine created to study modern graphics technologies. Particularly Voxel Cone Tracing.
@@ -47,10 +65,420 @@ bool SetupWorkingDirectory()
     return _chdir( path.c_str() ) == 0;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RunPacingBenchmark()
+{
+    // headless run: no window, no device, only pacer against simulated frame work
+    Settings &settings = Settings::Get( );
+    const float workTimes[] = { 0.0f, 0.25f, 0.5f, 0.9f };
+    for each ( float workPart in workTimes )
+    {
+        float workTime = workPart * settings.mFrameDeltaTime;
+        FrameStats stats = FramePacer::RunJitterBenchmark( settings.mFrameDeltaTime, settings.mFrameSpinThreshold, workTime, 600 );
+        LOG_INFO( "Pacing benchmark: target ", settings.mFrameDeltaTime * 1000.0f, "ms work ", workTime * 1000.0f,
+            "ms mean ", stats.mMean * 1000.0f, "ms jitter ", stats.mStdDev * 1000.0f,
+            "ms min ", stats.mMin * 1000.0f, "ms max ", stats.mMax * 1000.0f, "ms" );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RunRenderQueueBenchmark()
+{
+    // 100k synthetic draws, sort and batching only
+    RenderQueueStats stats = RenderQueue::RunBenchmark( 100000, 512, 256 );
+    LOG_INFO( "Render queue benchmark: items ", stats.mItems, " batches ", stats.mBatches, " state changes ", stats.mStateChanges,
+        " radix sort + batching ", stats.mSortTime * 1000.0, "ms std::sort ", stats.mStdSortTime * 1000.0, "ms" );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RunFrustumCullingBenchmark()
+{
+    // all compiled simd paths are checked against scalar reference
+    CullingBenchmarkResult result = RunCullingBenchmark( 100000, 100 );
+    LOG_INFO( "Culling benchmark: boxes ", result.mBoxes, " visible ", result.mVisible, " paths match ", result.mPathsMatch,
+        " scalar ", result.mBoxesPerSecond[CP_SCALAR] * 1e-6, "M/s sse ", result.mBoxesPerSecond[CP_SSE] * 1e-6,
+        "M/s avx ", result.mBoxesPerSecond[CP_AVX] * 1e-6, "M/s" );
+    ASSERT( result.mPathsMatch );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RunBilateralUpsampleBenchmark()
+{
+    // cpu reference of blur.fx at default cone tracing and window resolution, compared with the former two pass blur
+    Settings &settings = Settings::Get( );
+    UpsampleBenchmarkResult result = RunUpsampleBenchmark( settings.mVCTConeTracingRes, settings.mVCTConeTracingRes,
+        settings.mWndWidth, settings.mWndHeight, 5 );
+    LOG_INFO( "Upsample benchmark: ", result.mLowWidth, "x", result.mLowHeight, " -> ", result.mHighWidth, "x", result.mHighHeight,
+        " taps ", result.mTaps, " error vs legacy mean ", result.mMeanError, " max ", result.mMaxError, " psnr ", result.mPSNR,
+        "dB simd error ", result.mSimdMaxError, " legacy ", result.mLegacyMPixels, "Mpix/s scalar ", result.mScalarMPixels,
+        "Mpix/s simd ", result.mSimdMPixels, "Mpix/s" );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunShadowCascadeCheck()
+{
+    // split, fit and cache invalidation logic on synthetic cameras
+    std::string failure;
+    bool passed = RunShadowCascadeTest( failure );
+    if ( passed )
+        LOG_INFO( "Shadow cascade check passed" );
+    else
+        LOG_ERROR( "Shadow cascade check failed: ", failure );
+
+    return passed;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunPhotonInjectionBenchmark()
+{
+    // cpu reference of photon compaction, sort and reduce at default shadow map and octree resolution
+    Settings &settings = Settings::Get( );
+    PhotonBenchmarkResult result = RunPhotonListBenchmark( settings.mShadowMapRes, 1u << settings.mOctreeHeight, 5 );
+    LOG_INFO( "Photon list benchmark: ", result.mResolution, "x", result.mResolution, " texels, octree ", result.mOctreeResolution,
+        " photons ", result.mPhotons, " leaves ", result.mLeaves, " compact ", result.mCompactMs, "ms radix sort ", result.mSortMs,
+        "ms std::stable_sort ", result.mStdSortMs, "ms reduce ", result.mReduceMs, "ms inject per texel ", result.mPerTexelInjectMs,
+        "ms per leaf ", result.mLeafInjectMs, "ms matches reference ", result.mMatchesReference );
+    if ( !result.mMatchesReference )
+        LOG_ERROR( "Photon list doesn't match reference sort/reduce" );
+
+    return result.mMatchesReference;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunLightScheduleCheck()
+{
+    // dirty tracking, injection budget and rebuild rules of light injection on synthetic light sets
+    std::string failure;
+    bool passed = RunLightManagerTest( failure );
+    if ( passed )
+        LOG_INFO( "Light schedule check passed" );
+    else
+        LOG_ERROR( "Light schedule check failed: ", failure );
+
+    return passed;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunConfigCheck()
+{
+    // settings file parser, validation and change diffing
+    std::string failure;
+    bool passed = RunConfigTest( failure );
+    if ( passed )
+        LOG_INFO( "Config check passed" );
+    else
+        LOG_ERROR( "Config check failed: ", failure );
+
+    return passed;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+float GetMatrixError( const Mat4 &m, const DirectX::XMMATRIX &reference )
+{
+    // relative to the largest element
+    DirectX::XMFLOAT4X4 r;
+    DirectX::XMStoreFloat4x4( &r, reference );
+    const float *values = &r.m[0][0];
+
+    float scale = 1.0f, error = 0.0f;
+    for ( int i = 0; i < 16; i++ )
+    {
+        scale = ( std::max )( scale, fabsf( values[i] ) );
+        error = ( std::max )( error, fabsf( m.m[i] - values[i] ) );
+    }
+    return error / scale;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunMathCheck()
+{
+    // portable math against golden values, then against DirectXMath of this build on random cameras
+    std::string failure;
+    bool passed = RunMathTest( failure );
+
+    std::mt19937 rng( 2468 );
+    std::uniform_real_distribution<float> posDist( -2000.0f, 2000.0f );
+    std::uniform_real_distribution<float> fovDist( 0.3f, 2.0f );
+    std::uniform_real_distribution<float> aspectDist( 0.5f, 2.5f );
+    float maxError = 0.0f, maxInverseError = 0.0f;
+    for ( int i = 0; i < 256 && passed; i++ )
+    {
+        Vec3 eye( posDist( rng ), posDist( rng ), posDist( rng ) );
+        Vec3 focus( posDist( rng ), posDist( rng ), posDist( rng ) );
+        float fov = fovDist( rng ), aspect = aspectDist( rng );
+        float nearZ = 1.0f + fabsf( posDist( rng ) ) * 0.01f, farZ = nearZ + 1000.0f + fabsf( posDist( rng ) );
+
+        DirectX::XMMATRIX xmView = DirectX::XMMatrixLookAtRH( DirectX::XMVectorSet( eye.x, eye.y, eye.z, 1.0f ),
+            DirectX::XMVectorSet( focus.x, focus.y, focus.z, 1.0f ), DirectX::XMVectorSet( 0.0f, 1.0f, 0.0f, 0.0f ) );
+        DirectX::XMMATRIX xmProj = DirectX::XMMatrixPerspectiveFovRH( fov, aspect, nearZ, farZ );
+        DirectX::XMMATRIX xmOrtho = DirectX::XMMatrixOrthographicRH( farZ, nearZ * 100.0f, -nearZ, farZ );
+        DirectX::XMMATRIX xmViewProj = DirectX::XMMatrixMultiply( xmView, xmProj );
+        DirectX::XMMATRIX xmInverse = DirectX::XMMatrixInverse( nullptr, xmViewProj );
+
+        Mat4 view = Mat4LookAtRH( eye, focus, Vec3( 0.0f, 1.0f, 0.0f ) );
+        Mat4 proj = Mat4PerspectiveFovRH( fov, aspect, nearZ, farZ );
+        Mat4 viewProj = Mat4Multiply( view, proj );
+        Mat4 inverse;
+        Mat4Inverse( viewProj, inverse );
+
+        maxError = ( std::max )( maxError, GetMatrixError( view, xmView ) );
+        maxError = ( std::max )( maxError, GetMatrixError( proj, xmProj ) );
+        maxError = ( std::max )( maxError, GetMatrixError( Mat4OrthographicRH( farZ, nearZ * 100.0f, -nearZ, farZ ), xmOrtho ) );
+        maxError = ( std::max )( maxError, GetMatrixError( viewProj, xmViewProj ) );
+        maxInverseError = ( std::max )( maxInverseError, GetMatrixError( inverse, xmInverse ) );
+    }
+
+    if ( passed && ( maxError > 1e-5f || maxInverseError > 1e-3f ) )
+    {
+        std::ostringstream out;
+        out << "differs from DirectXMath, error " << maxError << " inverse error " << maxInverseError;
+        failure = out.str( );
+        passed = false;
+    }
+
+    if ( passed )
+    {
+        MathBenchmarkResult result = RunMathBenchmark( 1000000, 20 );
+        LOG_INFO( "Math check passed, DirectXMath error ", maxError, " inverse ", maxInverseError, " paths match ", result.mPathsMatch,
+            " soa transform scalar ", result.mPointsPerSecond[MP_SCALAR] * 1e-6, "M/s sse ", result.mPointsPerSecond[MP_SSE] * 1e-6,
+            "M/s avx ", result.mPointsPerSecond[MP_AVX] * 1e-6, "M/s" );
+        passed = result.mPathsMatch;
+    }
+    else
+        LOG_ERROR( "Math check failed: ", failure );
+
+    return passed;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::vector< std::wstring > SplitCommandLine( LPCWSTR cmdLine )
+{
+    // whitespace separated tokens, quotes keep file names with spaces together
+    std::vector< std::wstring > tokens;
+    if ( !cmdLine )
+        return tokens;
+
+    std::wstring token;
+    bool quoted = false, pending = false;
+    for ( const wchar_t *c = cmdLine; *c; c++ )
+    {
+        if ( *c == L'"' )
+        {
+            quoted = !quoted;
+            pending = true;
+        }
+        else if ( !quoted && ( *c == L' ' || *c == L'\t' ) )
+        {
+            if ( pending )
+                tokens.push_back( token );
+            token.clear( );
+            pending = false;
+        }
+        else
+        {
+            token += *c;
+            pending = true;
+        }
+    }
+    if ( pending )
+        tokens.push_back( token );
+    return tokens;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HasSwitch( LPCWSTR cmdLine, LPCWSTR name )
+{
+    // whole tokens only, so -benchmark doesn't match -path_benchmark
+    std::vector< std::wstring > tokens = SplitCommandLine( cmdLine );
+    return std::find( tokens.begin( ), tokens.end( ), name ) != tokens.end( );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string GetSwitchValue( LPCWSTR cmdLine, LPCWSTR name )
+{
+    // token after a switch, empty if the switch is missing or followed by another switch
+    std::vector< std::wstring > tokens = SplitCommandLine( cmdLine );
+    std::vector< std::wstring >::const_iterator found = std::find( tokens.begin( ), tokens.end( ), name );
+    if ( found == tokens.end( ) || ++found == tokens.end( ) || ( *found )[0] == L'-' )
+        return std::string( );
+
+    std::string value;
+    for ( wchar_t c : *found )
+        value += static_cast< char >( c );
+    return value;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LoadBenchmarkPath( const std::string &fn, CameraPath &path )
+{
+    // orbit around sponza when no path is given
+    if ( fn.empty( ) )
+    {
+        path = MakeOrbitPath( 1500.0f, 600.0f, 20.0f );
+        return true;
+    }
+
+    std::string error;
+    if ( !path.Load( fn.c_str( ), error ) || path.GetKeyCount( ) == 0 )
+    {
+        LOG_ERROR( "Can't load camera path ", fn, ": ", error );
+        return false;
+    }
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int GetBenchmarkFrames( LPCWSTR cmdLine )
+{
+    int frames = atoi( GetSwitchValue( cmdLine, L"-frames" ).c_str( ) );
+    return frames > 0 ? frames : 600;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void LogPathBenchmark( const PathBenchmarkReport &report, const char *fn )
+{
+    FramePercentiles summary = report.GetSummary( );
+    LOG_INFO( "Path benchmark ", report.mName, " (", report.mPipeline, "): frames ", summary.mCount, " mean ", summary.mMean,
+        "ms p50 ", summary.mP50, "ms p90 ", summary.mP90, "ms p95 ", summary.mP95, "ms p99 ", summary.mP99,
+        "ms max ", summary.mMax, "ms" );
+    if ( !report.Save( fn ) )
+        LOG_ERROR( "Can't write ", fn );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunHeadlessPathBenchmark( LPCWSTR cmdLine )
+{
+    // headless replay of culling and cascade fitting along the path, no device needed
+    std::string failure;
+    if ( !RunCameraPathTest( failure ) || !RunPathBenchmarkTest( failure ) )
+    {
+        LOG_ERROR( "Path benchmark check failed: ", failure );
+        return false;
+    }
+
+    std::string fn = GetSwitchValue( cmdLine, L"-path_benchmark" );
+    CameraPath path;
+    if ( !LoadBenchmarkPath( fn, path ) )
+        return false;
+
+    PathBenchmarkReport report = RunCpuPathBenchmark( path, GetBenchmarkFrames( cmdLine ), 20000 );
+    report.mName = fn.empty( ) ? "orbit" : fn;
+    LogPathBenchmark( report, "path_benchmark.json" );
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunSceneStreamCheck( LPCWSTR cmdLine )
+{
+    // synthetic scene of N GB (1 by default) written and streamed back object by object, peak RSS stays near one object
+    std::string failure;
+    if ( !RunSceneStreamTest( failure ) )
+    {
+        LOG_ERROR( "Scene stream check failed: ", failure );
+        return false;
+    }
+
+    double gigabytes = atof( GetSwitchValue( cmdLine, L"-scene_stream_benchmark" ).c_str( ) );
+    uint64_t bytes = static_cast< uint64_t >( ( gigabytes > 0.0 ? gigabytes : 1.0 ) * ( 1 << 30 ) );
+    SceneStreamBenchmarkResult result = RunSceneStreamBenchmark( "scene_stream_benchmark.bin", bytes, 1 << 20 );
+    LOG_INFO( "Scene stream benchmark: ", result.mBytes >> 20, "MB objects ", result.mObjects, " triangles ", result.mTriangles,
+        " write ", result.mWriteMBs, "MB/s read ", result.mReadMBs, "MB/s largest object ", result.mLargestObject >> 20,
+        "MB peak RSS ", result.mPeakRSS >> 20, "MB matches ", result.mMatches );
+    if ( !result.mMatches )
+        LOG_ERROR( "Streamed scene doesn't match written one" );
+
+    return result.mMatches;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunTaskSchedulerCheck( LPCWSTR cmdLine )
+{
+    // 1 -> N threads on synthetic loops and on the obj import of the scene (sponza.obj next to the bin by default)
+    std::string failure;
+    if ( !RunTaskSchedulerTest( failure ) )
+    {
+        LOG_ERROR( "Task scheduler check failed: ", failure );
+        return false;
+    }
+
+    TaskSchedulerBenchmarkResult tasks = RunTaskSchedulerBenchmark( 0 );
+    for ( size_t i = 0; i < tasks.mThreads.size( ); i++ )
+    {
+        LOG_INFO( "Task scheduler benchmark: threads ", tasks.mThreads[i], " parallel for ", tasks.mForMs[i], "ms reduce ", tasks.mReduceMs[i],
+            "ms graph ", tasks.mGraphMs[i], "ms speedup ", tasks.mForMs[0] / tasks.mForMs[i], " ", tasks.mReduceMs[0] / tasks.mReduceMs[i],
+            " ", tasks.mGraphMs[0] / tasks.mGraphMs[i] );
+    }
+
+    std::string fn = GetSwitchValue( cmdLine, L"-task_benchmark" );
+    if ( fn.empty( ) )
+    {
+        fn = Settings::Get( ).mSceneFn;
+        fn = fn.substr( 0, fn.find_last_of( '.' ) ) + ".obj";
+    }
+
+    ObjImportBenchmarkResult import = RunObjImportBenchmark( fn.c_str( ), 0 );
+    for ( size_t i = 0; i < import.mThreads.size( ); i++ )
+    {
+        LOG_INFO( "Obj import benchmark ", import.mSource, ": meshes ", import.mMeshes, " triangles ", import.mTriangles, " threads ",
+            import.mThreads[i], " import ", import.mImportMs[i], "ms speedup ", import.mImportMs[0] / import.mImportMs[i] );
+    }
+    return tasks.mMatches;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunMeshOptimizerCheck( LPCWSTR cmdLine )
+{
+    // every object of the scene (sponza bin by default) through the import optimizer, nothing is written
+    std::string failure;
+    if ( !RunMeshOptimizerTest( failure ) )
+    {
+        LOG_ERROR( "Mesh optimizer check failed: ", failure );
+        return false;
+    }
+
+    std::string fn = GetSwitchValue( cmdLine, L"-mesh_optimizer_benchmark" );
+    if ( fn.empty( ) )
+        fn = Settings::Get( ).mSceneFn;
+
+    MeshOptimizerBenchmarkResult result = RunMeshOptimizerBenchmark( fn.c_str( ) );
+    const MeshOptimizeResult &stats = result.mStats;
+    LOG_INFO( "Mesh optimizer benchmark ", result.mSource, ": objects ", result.mObjects, " triangles ", stats.mAfter.mTriangles,
+        " ACMR ", stats.mBefore.GetACMR( ), " -> ", stats.mAfter.GetACMR( ), " ATVR ", stats.mBefore.GetATVR( ), " -> ", stats.mAfter.GetATVR( ),
+        " overdraw of biggest ", result.mOverdrawBefore, " -> ", result.mOverdrawAfter, " optimize ", result.mOptimizeMs, "ms" );
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunGpuPathBenchmark( LPCWSTR cmdLine, WindowHandler &wHandler, Scene &scene )
+{
+    std::string fn = GetSwitchValue( cmdLine, L"-benchmark" );
+    CameraPath path;
+    if ( !LoadBenchmarkPath( fn, path ) )
+        return false;
+
+    // frames go as fast as possible with fixed lights, path time advances by frame number so runs are comparable
+    Settings &settings = Settings::Get( );
+    D3DRenderer &renderer = D3DRenderer::Get( );
+    settings.mLightAnimation = false;
+    renderer.SetPresentInterval( 0 );
+
+    int frames = GetBenchmarkFrames( cmdLine );
+    float step = frames > 1 ? path.GetDuration( ) / ( frames - 1 ) : 0.0f;
+
+    PathBenchmarkReport report;
+    report.mName = fn.empty( ) ? "orbit" : fn;
+    report.mPipeline = "gpu";
+    report.mFrames.reserve( frames );
+
+    MSG msg = { 0 };
+    for ( int i = 0; i < frames && WM_QUIT != msg.message; i++ )
+    {
+        while ( PeekMessage( &msg, nullptr, 0, 0, PM_REMOVE ) )
+        {
+            wHandler.GetWindowMsg( &msg );
+            if ( WM_QUIT == msg.message )
+                break;
+        }
+
+        auto start = std::chrono::steady_clock::now( );
+
+        scene.SetCameraKey( path.Evaluate( i * step ) );
+        scene.Update( );
+        renderer.RenderTick( );
+
+        PathBenchmarkFrame frame;
+        frame.mMs = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now( ) - start ).count( );
+        frame.mShadowRedraws = renderer.GetShadowMapper( ).GetRedrawCount( );
+        report.mFrames.push_back( frame );
+    }
+
+    renderer.SetPresentInterval( 1 );
+    LogPathBenchmark( report, "benchmark.json" );
+    return true;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow )
 {
     UNREFERENCED_PARAMETER( hPrevInstance );
-    UNREFERENCED_PARAMETER( lpCmdLine );
 
 #ifdef _DEBUG
     _CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
@@ -59,6 +487,65 @@ int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     // change working directory
     SetupWorkingDirectory( );
 
+    // defaults are overridden by settings file, benchmarks use it too
+    Settings::Get( ).LoadConfig( "settings.ini" );
+
+    // shared scheduler belongs to this thread, scene loading and cpu passes run on it
+    TaskScheduler &scheduler = TaskScheduler::Get( );
+    if ( Settings::Get( ).mWorkerThreads > 0 )
+        scheduler.SetWorkerCount( Settings::Get( ).mWorkerThreads );
+
+    if ( HasSwitch( lpCmdLine, L"-pacing_benchmark" ) )
+    {
+        RunPacingBenchmark( );
+        return 0;
+    }
+
+    if ( HasSwitch( lpCmdLine, L"-render_queue_benchmark" ) )
+    {
+        RunRenderQueueBenchmark( );
+        return 0;
+    }
+
+    if ( HasSwitch( lpCmdLine, L"-culling_benchmark" ) )
+    {
+        RunFrustumCullingBenchmark( );
+        return 0;
+    }
+
+    if ( HasSwitch( lpCmdLine, L"-upsample_benchmark" ) )
+    {
+        RunBilateralUpsampleBenchmark( );
+        return 0;
+    }
+
+    if ( HasSwitch( lpCmdLine, L"-shadow_cascade_check" ) )
+        return RunShadowCascadeCheck( ) ? 0 : 1;
+
+    if ( HasSwitch( lpCmdLine, L"-photon_benchmark" ) )
+        return RunPhotonInjectionBenchmark( ) ? 0 : 1;
+
+    if ( HasSwitch( lpCmdLine, L"-light_schedule_check" ) )
+        return RunLightScheduleCheck( ) ? 0 : 1;
+
+    if ( HasSwitch( lpCmdLine, L"-config_check" ) )
+        return RunConfigCheck( ) ? 0 : 1;
+
+    if ( HasSwitch( lpCmdLine, L"-math_check" ) )
+        return RunMathCheck( ) ? 0 : 1;
+
+    if ( HasSwitch( lpCmdLine, L"-path_benchmark" ) )
+        return RunHeadlessPathBenchmark( lpCmdLine ) ? 0 : 1;
+
+    if ( HasSwitch( lpCmdLine, L"-task_benchmark" ) )
+        return RunTaskSchedulerCheck( lpCmdLine ) ? 0 : 1;
+
+    if ( HasSwitch( lpCmdLine, L"-mesh_optimizer_benchmark" ) )
+        return RunMeshOptimizerCheck( lpCmdLine ) ? 0 : 1;
+
+    if ( HasSwitch( lpCmdLine, L"-scene_stream_benchmark" ) )
+        return RunSceneStreamCheck( lpCmdLine ) ? 0 : 1;
+
     WindowHandler wHandler;
     if ( FAILED( wHandler.InitWindow( hInstance, nCmdShow ) ) )
         return 0;
@@ -75,6 +562,24 @@ int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 
     Scene scene; // load scene
 
+    if ( HasSwitch( lpCmdLine, L"-bvh_benchmark" ) )
+    {
+        scene.RunBVHBenchmark( );
+        scene.CleanUp( );
+        wHandler.CleanUp( );
+        renderer.Cleanup( );
+        return 0;
+    }
+
+    if ( HasSwitch( lpCmdLine, L"-benchmark" ) )
+    {
+        bool passed = RunGpuPathBenchmark( lpCmdLine, wHandler, scene );
+        scene.CleanUp( );
+        wHandler.CleanUp( );
+        renderer.Cleanup( );
+        return passed ? 0 : 1;
+    }
+
     // setup camera and renderer callbacks
     std::function< void( float, float ) >        CamRotCallback = std::bind( &Scene::ChangeCamRot, &scene, std::placeholders::_1, std::placeholders::_2 );
     std::function< void( CamDirection ) >     SetCamDirCallback = std::bind( &Scene::SetCamDirection, &scene, std::placeholders::_1 );
@@ -93,42 +598,71 @@ int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     appTimer.Start();
     float timeElapsed = 0;
 
+    FramePacer pacer;
+
+    // -record_path file: camera and sun are sampled while flying and saved on exit, -benchmark plays it back
+    std::string recordFn = GetSwitchValue( lpCmdLine, L"-record_path" );
+    CameraPathRecorder recorder;
+
     // main message loop
     MSG msg = { 0 };
     while ( WM_QUIT != msg.message )
     {
-        if ( PeekMessage( &msg, nullptr, 0, 0, PM_REMOVE ) )
+        pacer.SetTargetFrameTime( settings.mFrameDeltaTime );
+        pacer.SetSpinThreshold( settings.mFrameSpinThreshold );
+        pacer.SetMode( settings.mFramePacingMode );
+
+        // latency mode: wait first, then sample input right before simulation
+        if ( pacer.GetMode( ) == FPM_BEFORE_INPUT )
+            pacer.Wait( );
+
+        // drain all pending messages, so input doesn't lag behind by several frames
+        while ( PeekMessage( &msg, nullptr, 0, 0, PM_REMOVE ) )
         {
             wHandler.GetWindowMsg( &msg );
+            if ( WM_QUIT == msg.message )
+                break;
         }
-        else
+
+        if ( WM_QUIT == msg.message )
+            break;
+
+        // push scene to render
+        scene.Update();
+
+        if ( !recordFn.empty( ) )
+            recorder.Record( appTimer.GetLiveTime( ), scene.GetCameraKey( ) );
+
+        // draw scene
+        renderer.RenderTick();
+
+        // update timer
+        appTimer.Tick( );
+
+        if ( pacer.GetMode( ) == FPM_AFTER_PRESENT )
+            pacer.Wait( );
+
+        if ( appTimer.GetLiveTime( ) - timeElapsed > 1.0 )
         {
-            // push scene to render
-            scene.Update();
-
-            // draw scene
-            renderer.RenderTick();
-
-            // update timer
-            appTimer.Tick( );
-            if ( appTimer.GetDeltaTime( ) < settings.mFrameDeltaTime )
-            {
-                int waitFor = static_cast< int >( ( settings.mFrameDeltaTime - appTimer.GetDeltaTime( ) ) * 1000 );
-                std::this_thread::sleep_for( std::chrono::milliseconds( waitFor ) );
-            }
-
-            if ( appTimer.GetLiveTime( ) - timeElapsed > 1.0 )
-            {
-                int FPS = static_cast< int >( 1.0f / appTimer.GetDeltaTime( ) );
-                std::ostringstream title;
-                title.precision( 5 );
-                title << std::fixed << "Voxel Cone Tracing FPS: " << std::setw( 6 ) << FPS; // << " Frame Time: " << appTimer.GetDeltaTime();
-                SetWindowTextA( hwnd, title.str( ).c_str( ) );
-                timeElapsed = appTimer.GetLiveTime( );
-            }
+            FrameStats stats = pacer.GetStats( );
+            int FPS = stats.mMean > 0.0f ? static_cast< int >( 1.0f / stats.mMean + 0.5f ) : 0;
+            std::ostringstream title;
+            title.precision( 2 );
+            title << std::fixed << "Voxel Cone Tracing FPS: " << std::setw( 6 ) << FPS
+                << " Jitter: " << stats.mStdDev * 1000.0f << "ms Max: " << stats.mMax * 1000.0f << "ms";
+            SetWindowTextA( hwnd, title.str( ).c_str( ) );
+            timeElapsed = appTimer.GetLiveTime( );
+
+            // apply settings.ini edits
+            uint32_t reload = settings.ReloadConfig( );
+            if ( reload != SR_NONE )
+                renderer.ReloadSettings( reload );
         }
     }
 
+    if ( !recordFn.empty( ) && !recorder.Finish( ).Save( recordFn.c_str( ) ) )
+        LOG_ERROR( "Can't write camera path ", recordFn );
+
     scene.CleanUp();
     wHandler.CleanUp();
     renderer.Cleanup();
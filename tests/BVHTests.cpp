@@ -0,0 +1,220 @@
+#include <Core/BVH.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // the same moller-trumbore test as the bvh on the same edges, so hits match bit for bit
+    bool IntersectTriangle( const BVHBuildInput &input, size_t triangle, const BVHRay &ray, float tMax, float &t )
+    {
+        const float *v0 = &input.mPositions[input.mIndices[triangle * 3 + 0] * 3];
+        const float *v1 = &input.mPositions[input.mIndices[triangle * 3 + 1] * 3];
+        const float *v2 = &input.mPositions[input.mIndices[triangle * 3 + 2] * 3];
+        float e1[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+        float e2[3] = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+        const float *o = ray.mOrigin, *d = ray.mDir;
+
+        float p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+        float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+        if ( std::fabs( det ) < 1e-9f )
+            return false;
+
+        float invDet = 1.0f / det;
+        float s[3] = { o[0] - v0[0], o[1] - v0[1], o[2] - v0[2] };
+        float u = ( s[0] * p[0] + s[1] * p[1] + s[2] * p[2] ) * invDet;
+        if ( u < 0.0f || u > 1.0f )
+            return false;
+
+        float q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+        float v = ( d[0] * q[0] + d[1] * q[1] + d[2] * q[2] ) * invDet;
+        if ( v < 0.0f || u + v > 1.0f )
+            return false;
+
+        t = ( e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2] ) * invDet;
+        return t >= ray.mTMin && t <= tMax;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // closest hit of all triangles, false if nothing is hit
+    bool IntersectBruteForce( const BVHBuildInput &input, const BVHRay &ray, float &t, size_t &triangle )
+    {
+        float tMax = ray.mTMax;
+        bool found = false;
+        for ( size_t i = 0; i < input.GetTriangleCount( ); i++ )
+        {
+            float tt;
+            if ( IntersectTriangle( input, i, ray, tMax, tt ) )
+            {
+                tMax = t = tt;
+                triangle = i;
+                found = true;
+            }
+        }
+        return found;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // random rays from inside of the bounds, closest and any hits against brute force; mismatch gives the failed ray
+    bool MatchesBruteForce( const BVH &bvh, const BVHBuildInput &input, size_t rays, uint32_t seed, std::string &mismatch )
+    {
+        std::mt19937 rng( seed );
+        std::uniform_real_distribution<float> unit( 0.0f, 1.0f );
+        const AABB &bounds = bvh.GetBounds( );
+        size_t hits = 0;
+        for ( size_t r = 0; r < rays; r++ )
+        {
+            BVHRay ray;
+            for ( int a = 0; a < 3; a++ )
+                ray.mOrigin[a] = bounds.mMin[a] + unit( rng ) * ( bounds.mMax[a] - bounds.mMin[a] );
+            float z = unit( rng ) * 2.0f - 1.0f, phi = unit( rng ) * 6.2831853f, radius = std::sqrt( 1.0f - z * z );
+            ray.mDir[0] = radius * std::cos( phi );
+            ray.mDir[1] = radius * std::sin( phi );
+            ray.mDir[2] = z;
+            ray.mTMin = 0.0f;
+            // every fourth ray is short, so the tMax cut of the traversal is covered too
+            ray.mTMax = r % 4 == 0 ? unit( rng ) * ( bounds.mMax[0] - bounds.mMin[0] ) * 0.25f : 1e30f;
+
+            float t = 0.0f;
+            size_t triangle = 0;
+            bool expected = IntersectBruteForce( input, ray, t, triangle );
+            BVHRay closer = ray;
+            closer.mTMax = t * ( 1.0f - 1e-6f );
+            float other = 0.0f;
+            size_t otherTriangle = 0;
+            bool unique = expected && !IntersectBruteForce( input, closer, other, otherTriangle );
+            BVHHit hit;
+            bool found = bvh.Intersect( ray, hit );
+            bool occluded = bvh.Occluded( ray );
+            // equal t of two triangles may give either of them, so only an unique closest hit has to name its triangle
+            bool same = found == expected && occluded == expected && ( !found || hit.mT == t ) &&
+                ( !unique || hit.mObject == input.mTriangleObject[triangle] );
+            if ( !same )
+            {
+                std::ostringstream stream;
+                stream << "ray " << r << ": bvh " << found << " t " << hit.mT << " occluded " << occluded << ", brute force " << expected
+                    << " t " << t;
+                mismatch = stream.str( );
+                return false;
+            }
+            hits += found;
+        }
+
+        // rays that hit nothing or everything wouldn't test much
+        if ( hits < rays / 10 || hits == rays )
+        {
+            mismatch = "random rays must hit some of the triangles";
+            return false;
+        }
+        return true;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void AddTriangle( BVHBuildInput &input, const float v0[3], const float v1[3], const float v2[3], uint32_t object )
+    {
+        float positions[9] = { v0[0], v0[1], v0[2], v1[0], v1[1], v1[2], v2[0], v2[1], v2[2] };
+        uint32_t indices[3] = { 0, 1, 2 };
+        input.AddMesh( positions, 3 * sizeof( float ), 3, indices, 3, object );
+    }
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunBVHTest( std::string &failure )
+{
+    TestCheck check;
+    std::string mismatch;
+
+    // random triangles of random sizes in a unit cube, several objects
+    std::mt19937 rng( 42 );
+    std::uniform_real_distribution<float> unit( 0.0f, 1.0f );
+    BVHBuildInput input;
+    for ( uint32_t i = 0; i < 3000; i++ )
+    {
+        float size = 0.01f + 0.1f * unit( rng ) * unit( rng );
+        float center[3] = { unit( rng ), unit( rng ), unit( rng ) };
+        float v[3][3];
+        for ( int k = 0; k < 3; k++ )
+        {
+            for ( int a = 0; a < 3; a++ )
+                v[k][a] = center[a] + ( unit( rng ) - 0.5f ) * size;
+        }
+        AddTriangle( input, v[0], v[1], v[2], i % 7 );
+    }
+
+    BVH bvh;
+    check( bvh.Build( input, 4 ), "random triangles must build" );
+    check( bvh.GetStats( ).mTriangles == input.GetTriangleCount( ) && bvh.GetChecksum( ) == input.GetChecksum( ),
+        "stats and checksum must describe the input" );
+    check( MatchesBruteForce( bvh, input, 2000, 1, mismatch ), "random triangles: " + mismatch );
+
+    // the running checksum of a streamed scene must match the checksum of the gathered input
+    BVHChecksum streamed;
+    const uint32_t triangleIndices[3] = { 0, 1, 2 };
+    for ( size_t t = 0; t < input.GetTriangleCount( ); t++ )
+        streamed.AddMesh( &input.mPositions[t * 9], 3 * sizeof( float ), 3, triangleIndices, 3, input.mTriangleObject[t] );
+    check( streamed.GetTriangleCount( ) == input.GetTriangleCount( ) && streamed.Get( ) == input.GetChecksum( ),
+        "running checksum must match the checksum of the gathered input" );
+    check( BVHChecksum( ).Get( ) == BVHBuildInput( ).GetChecksum( ), "empty checksums must match" );
+
+    // a single leaf tree
+    BVHBuildInput few;
+    const float a[3] = { 0.0f, 0.0f, 0.0f }, b[3] = { 1.0f, 0.0f, 0.0f }, c[3] = { 0.0f, 1.0f, 0.0f }, d[3] = { 0.0f, 0.0f, 1.0f };
+    AddTriangle( few, a, b, c, 0 );
+    AddTriangle( few, a, b, d, 1 );
+    BVH leaf;
+    leaf.Build( few, 1 );
+    check( leaf.GetStats( ).mNodes == 1 && leaf.GetStats( ).mLeaves == 1, "two triangles must give a single leaf" );
+
+    // clusters of 16 triangles growing by 10% per cluster along x: SAH peels a few clusters off at every split and
+    // each of them is an inner node, so a ray along the axis leaves 3 of them on the stack per level, more than the 64
+    // entries a fixed stack had. the hit sides face away from the axis, so only triangles of about the ray's distance
+    // from the axis are hit, the small ones at the deep end of the tree. sizes stay above the determinant epsilon and
+    // below float overflow of the SAH costs
+    BVHBuildInput nested;
+    const uint32_t clusters = 350, clusterSize = 16;
+    for ( uint32_t i = 0; i < clusters; i++ )
+    {
+        float size = 0.01f * std::pow( 1.1f, static_cast< float >( i ) );
+        for ( uint32_t j = 0; j < clusterSize; j++ )
+        {
+            float x = 1.5f * size * ( 1.0f + 0.01f * j );
+            float v0[3] = { x, size, 0.0f }, v1[3] = { x, 0.0f, size }, v2[3] = { x, size, size };
+            AddTriangle( nested, v0, v1, v2, i * clusterSize + j );
+        }
+    }
+    BVH deep;
+    deep.Build( nested, 1 );
+    check( 3 * deep.GetStats( ).mMaxDepth + 1 > 64, "growing clusters must give a deep tree" );
+    size_t missed = 0;
+    for ( uint32_t i = 0; i < clusters; i += 7 )
+    {
+        float offset = 0.006f * std::pow( 1.1f, static_cast< float >( i ) );
+        BVHRay ray = { { 0.0f, offset, offset }, { 1.0f, 0.0f, 0.0f }, 0.0f, 1e30f };
+        float t = 0.0f;
+        size_t triangle = 0;
+        BVHHit hit;
+        bool expected = IntersectBruteForce( nested, ray, t, triangle );
+        missed += !expected || !deep.Intersect( ray, hit ) || hit.mT != t || hit.mObject != nested.mTriangleObject[triangle] ||
+            !deep.Occluded( ray );
+    }
+    check( missed == 0, "deep tree must not drop subtrees" );
+
+    // save and load keep the tree and the checksum, a checksum of other geometry differs
+    std::stringstream stream;
+    check( bvh.Save( stream ), "bvh must save" );
+    BVH loaded;
+    check( loaded.Load( stream ) && loaded.GetStats( ).mNodes == bvh.GetStats( ).mNodes &&
+        loaded.GetStats( ).mMaxDepth == bvh.GetStats( ).mMaxDepth && loaded.GetChecksum( ) == input.GetChecksum( ),
+        "bvh must load what was saved" );
+    check( MatchesBruteForce( loaded, input, 200, 3, mismatch ), "loaded bvh: " + mismatch );
+    BVHBuildInput moved = input;
+    moved.mPositions[5] += 1e-3f;
+    check( moved.GetChecksum( ) != input.GetChecksum( ) && moved.GetTriangleCount( ) == input.GetTriangleCount( ),
+        "moved vertex of the same triangle count must change the checksum" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,56 @@
+#include <Core/BilateralUpsample.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunBilateralUpsampleTest( std::string &failure )
+{
+    TestCheck check;
+
+    // synthetic scene against the former BlurX/BlurY math, full res width isn't a multiple of 4 so the scalar tail
+    // after the simd pixels runs too
+    UpsampleBenchmarkResult result = RunUpsampleBenchmark( 100, 100, 322, 181, 1 );
+    check( result.mPSNR > 30.0, "upsample must stay within 30 dB psnr of the legacy blur" );
+    check( !IsUpsampleSimdSupported( ) || result.mSimdMaxError < 1e-5, "simd upsample doesn't match scalar reference" );
+
+    // constant color stays constant across depth and normal edges, weights are normalized
+    FloatImage lowColor, depth, normal;
+    lowColor.Resize( 16, 16, 4 );
+    for ( float &c : lowColor.mData )
+        c = 0.25f;
+    depth.Resize( 61, 47, 1 );
+    normal.Resize( 61, 47, 3 );
+    for ( int y = 0; y < depth.mHeight; y++ )
+    {
+        for ( int x = 0; x < depth.mWidth; x++ )
+        {
+            bool near = x < depth.mWidth / 2;
+            depth.GetPixel( x, y )[0] = near ? 0.9f : 0.99f;
+            float *n = normal.GetPixel( x, y );
+            n[0] = near ? 1.0f : 0.0f;
+            n[1] = 0.0f;
+            n[2] = near ? 0.0f : 1.0f;
+        }
+    }
+    UpsampleParams params;
+    UpsampleWeights weights;
+    weights.Build( params.mRadius, 16.0f / depth.mWidth, 16.0f / depth.mHeight );
+    for ( int simd = 0; simd < 2; simd++ )
+    {
+        FloatImage out;
+        JointBilateralUpsample( lowColor, depth, normal, weights, params, out, simd == 1 );
+        float maxError = 0.0f;
+        for ( float c : out.mData )
+            maxError = ( std::max )( maxError, std::fabs( c - 0.25f ) );
+        check( out.mWidth == depth.mWidth && out.mHeight == depth.mHeight && maxError < 1e-5f,
+            simd ? "simd upsample of a constant image must be constant" : "scalar upsample of a constant image must be constant" );
+    }
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,79 @@
+#include <Core/CameraPath.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <string>
+
+namespace
+{
+    const float kPi = 3.14159265f;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunCameraPathTest( std::string &failure )
+{
+    TestCheck check;
+    auto isNear = []( float a, float b ) { return std::fabs( a - b ) < 1e-4f; };
+
+    // evenly spaced collinear keys, catmull-rom reproduces the line
+    CameraPath path;
+    for ( int i = 0; i < 5; i++ )
+    {
+        CameraKey key;
+        key.mTime = 2.0f + i; // path time is relative to the first key
+        key.mPosition[0] = 10.0f * i;
+        key.mPosition[1] = 5.0f;
+        key.mPhi = 0.1f * i;
+        key.mSunPitch = 1.0f;
+        path.AddKey( key );
+    }
+    check( isNear( path.GetDuration( ), 4.0f ), "duration must span first to last key" );
+    check( isNear( path.Evaluate( 2.0f ).mPosition[0], 20.0f ), "key time must give key value" );
+    check( isNear( path.Evaluate( 2.5f ).mPosition[0], 25.0f ) && isNear( path.Evaluate( 0.25f ).mPosition[0], 2.5f ),
+        "spline must keep evenly spaced collinear keys on their line" );
+    check( isNear( path.Evaluate( 1.5f ).mPhi, 0.15f ), "angles must be interpolated" );
+    check( isNear( path.Evaluate( -1.0f ).mPosition[0], 0.0f ) && isNear( path.Evaluate( 10.0f ).mPosition[0], 40.0f ),
+        "time must be clamped to the path" );
+
+    // yaw crossing +-pi goes the short way
+    CameraPath turn;
+    CameraKey a, b;
+    a.mTheta = 3.0f;
+    a.mSunYaw = 6.2f;
+    b.mTime = 1.0f;
+    b.mTheta = -3.0f;
+    b.mSunYaw = 0.1f;
+    turn.AddKey( a );
+    turn.AddKey( b );
+    CameraKey mid = turn.Evaluate( 0.5f );
+    check( std::fabs( mid.mTheta ) > 3.1f, "theta must wrap through pi" );
+    check( mid.mTheta >= -kPi - 1e-4f && mid.mTheta <= kPi + 1e-4f, "theta must stay in camera range" );
+    check( std::fabs( std::fmod( mid.mSunYaw + 4.0f * kPi, 2.0f * kPi ) - 0.0084f ) < 0.05f, "sun yaw must wrap the short way" );
+
+    // text round trip
+    CameraPath loaded;
+    std::string error;
+    check( loaded.Parse( path.Write( ), error ), "written path must parse" );
+    check( loaded.GetKeyCount( ) == path.GetKeyCount( ) && loaded.GetKey( 3 ).mTime == path.GetKey( 3 ).mTime &&
+        loaded.GetKey( 3 ).mPhi == path.GetKey( 3 ).mPhi, "path must round trip exactly" );
+    check( !loaded.Parse( "0 1 2 3 4 5 6\n", error ) && error.find( "line 1" ) == 0, "short line must be reported" );
+    check( !loaded.Parse( "1 0 0 0 0 0 0 0\n0 0 0 0 0 0 0 0\n", error ), "time going back must be reported" );
+
+    // recorder keeps one key per interval and the last sample
+    CameraPathRecorder recorder( 0.25f );
+    for ( int i = 0; i <= 10; i++ )
+    {
+        CameraKey state;
+        state.mPosition[0] = static_cast< float >( i );
+        recorder.Record( 100.0f + i * 0.1f, state );
+    }
+    const CameraPath &recorded = recorder.Finish( );
+    check( recorded.GetKeyCount( ) == 5, "recorder must sample by interval" );
+    check( recorded.GetKeyCount( ) > 0 && isNear( recorded.GetKey( 0 ).mTime, 0.0f ) &&
+        isNear( recorded.GetKey( recorded.GetKeyCount( ) - 1 ).mPosition[0], 10.0f ), "recorded path must span whole recording" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,109 @@
+#include <Core/CompactVertex.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunCompactVertexTest( std::string &failure )
+{
+    TestCheck check;
+
+    // half conversion: every half except nans survives a round trip, ties go to even, out of range goes to inf
+    bool roundTrip = true;
+    for ( uint32_t h = 0; h < 0x10000; h++ )
+    {
+        bool isNan = ( h & 0x7c00 ) == 0x7c00 && ( h & 0x3ff ) != 0;
+        if ( !isNan )
+            roundTrip &= FloatToHalf( HalfToFloat( static_cast< uint16_t >( h ) ) ) == h;
+    }
+    check( roundTrip, "every half must round trip through float" );
+    check( FloatToHalf( 1.0f + 1.0f / 2048.0f ) == 0x3c00 && FloatToHalf( 1.0f + 3.0f / 2048.0f ) == 0x3c02,
+        "half rounding ties must go to even" );
+    check( FloatToHalf( 65504.0f ) == 0x7bff && FloatToHalf( 65520.0f ) == 0x7c00 && FloatToHalf( -1e10f ) == 0xfc00,
+        "half overflow must give infinity" );
+    check( FloatToHalf( std::numeric_limits<float>::quiet_NaN( ) ) == 0x7e00, "nan must stay nan" );
+    check( FloatToHalf( 1.0f / 16777216.0f ) == 0x0001 && FloatToHalf( -0.0f ) == 0x8000, "denormals and signed zero must be kept" );
+
+    // octahedral frame: axes are exact, zero vector is +z
+    const float axes[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    for ( int i = 0; i < 6; i++ )
+    {
+        int8_t oct[2];
+        float decoded[3];
+        EncodeOctahedral( axes[i], oct );
+        DecodeOctahedral( oct, decoded );
+        check( decoded[0] == axes[i][0] && decoded[1] == axes[i][1] && decoded[2] == axes[i][2], "axes must decode exactly" );
+    }
+    const float zero[3] = { 0.0f, 0.0f, 0.0f };
+    int8_t zeroOct[2];
+    float zeroDecoded[3];
+    EncodeOctahedral( zero, zeroOct );
+    DecodeOctahedral( zeroOct, zeroDecoded );
+    check( zeroDecoded[2] == 1.0f, "zero vector must decode to +z" );
+
+    // random mesh within error bounds, count isn't a multiple of the simd width
+    const size_t count = 4099;
+    std::vector<SceneVertex> vertices = GenerateVertexSoup( count, 77 );
+    for ( size_t i = 0; i < count; i += 97 )
+        vertices[i].mNormal[0] = vertices[i].mNormal[1] = vertices[i].mNormal[2] = 0.0f;
+    CompactVertexBounds bounds = ComputeCompactVertexBounds( vertices.data( ), count );
+    std::vector<CompactVertex> reference( count );
+    EncodeCompactVertices( vertices.data( ), count, bounds, 513, reference.data( ), MP_SCALAR );
+
+    // every compiled path writes the scalar bytes
+    for ( int path = 0; path < MP_COUNT; path++ )
+    {
+        if ( !IsMathPathSupported( static_cast< MathPath >( path ) ) )
+            continue;
+        std::vector<CompactVertex> output( count );
+        EncodeCompactVertices( vertices.data( ), count, bounds, 513, output.data( ), static_cast< MathPath >( path ) );
+        check( memcmp( output.data( ), reference.data( ), count * sizeof( CompactVertex ) ) == 0, "simd encoder must match scalar" );
+    }
+
+    CompactVertexBenchmarkResult error;
+    for ( size_t i = 0; i < count; i += 97 )
+        vertices[i].mNormal[2] = 1.0f; // zero normals decode to +z, measure them against it
+    MeasureCompactVertexError( vertices, reference, bounds, error );
+    check( error.mMaxPositionError <= 0.51f, "position error must stay within half a quantization step" );
+    check( error.mMaxNormalErrorDegrees < 1.5f, "octahedral snorm8 error must stay under 1.5 degrees" );
+    check( error.mMaxUVError <= 1.0f / 2048.0f, "half uv error must stay within half an ulp" );
+
+    bool extremes[3][2] = { { false, false }, { false, false }, { false, false } };
+    bool slotKept = true;
+    for ( size_t i = 0; i < count; i++ )
+    {
+        slotKept &= reference[i].mBoundsSlot == 513;
+        for ( int a = 0; a < 3; a++ )
+        {
+            extremes[a][0] |= reference[i].mPosition[a] == 0;
+            extremes[a][1] |= reference[i].mPosition[a] == 65535;
+        }
+    }
+    check( slotKept, "bounds slot must be stored in every vertex" );
+    check( extremes[0][0] && extremes[0][1] && extremes[1][0] && extremes[1][1] && extremes[2][0] && extremes[2][1],
+        "bounds must map to the full unorm16 range" );
+
+    // flat axis of a plane decodes exactly
+    std::vector<SceneVertex> plane = GenerateVertexSoup( 64, 5 );
+    for ( size_t i = 0; i < plane.size( ); i++ )
+        plane[i].mPosition[1] = 12.5f;
+    CompactVertexBounds planeBounds = ComputeCompactVertexBounds( plane.data( ), plane.size( ) );
+    std::vector<CompactVertex> planeCompact( plane.size( ) );
+    EncodeCompactVertices( plane.data( ), plane.size( ), planeBounds, 0, planeCompact.data( ) );
+    bool flat = planeBounds.mStep[1] == 0.0f;
+    for ( size_t i = 0; i < plane.size( ); i++ )
+    {
+        SceneVertex decoded;
+        DecodeCompactVertex( planeCompact[i], planeBounds, decoded );
+        flat &= planeCompact[i].mPosition[1] == 0 && decoded.mPosition[1] == 12.5f;
+    }
+    check( flat, "flat axis must decode exactly" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,101 @@
+#include <Core/ConeTracer.h>
+#include <Core/DenseMipVolume.h>
+#include <Core/DistanceField.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunConeTracerTest( std::string &failure )
+{
+    TestCheck check;
+
+    const uint32_t height = 5;
+    std::vector<OctreeVoxel> voxels;
+    std::vector<ConeTracePoint> surface;
+    GenerateConeTestRoom( height, voxels, surface );
+    CpuOctree octree;
+    octree.Build( voxels, height );
+    const uint32_t resolution = octree.GetResolution( );
+
+    // same cell one level up is a parent link, the adjacent cell a neighbor link
+    OctreeMarchState state;
+    OctreeMarchStats stats;
+    uint32_t nodeIndex, nodeCoords[3], expected, expectedCoords[3];
+    size_t fetches = 0;
+    check( MarchOctree( octree, state, 5, 0, 5, 4, nodeIndex, nodeCoords, stats ) && stats.mFetches == 4 && stats.mRootTraversals == 1,
+        "first lookup must traverse from the root" );
+    check( MarchOctree( octree, state, 5, 0, 5, 3, nodeIndex, nodeCoords, stats ) && stats.mFetches == 5 && stats.mParentSteps == 1,
+        "lookup one level up must read the parent link" );
+    octree.Traverse( 5, 0, 5, 3, expected, expectedCoords, fetches );
+    check( nodeIndex == expected, "parent link must give the node of the traversal" );
+    check( MarchOctree( octree, state, 9, 0, 5, 3, nodeIndex, nodeCoords, stats ) && stats.mFetches == 6 && stats.mNeighborSteps == 1,
+        "lookup in the adjacent cell must read the neighbor link" );
+    octree.Traverse( 9, 0, 5, 3, expected, expectedCoords, fetches );
+    check( nodeIndex == expected && nodeCoords[0] == 8 && nodeCoords[1] == 0 && nodeCoords[2] == 4, "neighbor link must give the node of the traversal" );
+    check( !MarchOctree( octree, state, 14, 14, 14, 4, nodeIndex, nodeCoords, stats ), "empty room center must have no node" );
+
+    // random walks: small moves, level goes down or stays like in a cone, sometimes jumps
+    std::mt19937 rng( 3 );
+    std::uniform_int_distribution<int> step( -6, 6 ), jump( 0, 15 );
+    std::uniform_int_distribution<uint32_t> coord( 0, resolution - 1 ), levels( 0, height );
+    bool same = true;
+    for ( int walk = 0; walk < 2000; walk++ )
+    {
+        OctreeMarchState walker;
+        OctreeMarchStats walkStats;
+        int pos[3] = { static_cast< int >( coord( rng ) ), 0, static_cast< int >( coord( rng ) ) };
+        pos[1] = jump( rng ) < 8 ? 0 : static_cast< int >( coord( rng ) );
+        uint32_t level = levels( rng );
+        for ( int s = 0; s < 12; s++ )
+        {
+            uint32_t x = static_cast< uint32_t >( pos[0] ), y = static_cast< uint32_t >( pos[1] ), z = static_cast< uint32_t >( pos[2] );
+            bool marched = MarchOctree( octree, walker, x, y, z, level, nodeIndex, nodeCoords, walkStats );
+            bool traversed = octree.Traverse( x, y, z, level, expected, expectedCoords, fetches );
+            same = same && marched == traversed;
+            if ( marched && traversed )
+            {
+                same = same && nodeIndex == expected && nodeCoords[0] == expectedCoords[0] && nodeCoords[1] == expectedCoords[1]
+                    && nodeCoords[2] == expectedCoords[2];
+            }
+
+            for ( int a = 0; a < 3; a++ )
+                pos[a] = ( std::max )( 0, ( std::min )( static_cast< int >( resolution ) - 1, pos[a] + step( rng ) ) );
+            int j = jump( rng );
+            if ( j == 0 )
+                level = levels( rng );
+            else if ( j < 8 && level > 0 )
+                level--;
+        }
+    }
+    check( same, "marcher must find the nodes of the root traversal" );
+
+    // cones of both lookups sample the same nodes, ropes read fewer texels
+    ConeTraceParams params;
+    params.mFirstLevel = height - 1;
+    params.mLastLevel = 0;
+    float voxelSize = ( params.mMax[0] - params.mMin[0] ) / resolution;
+    params.mWorldConeOffset = voxelSize * 1.5f;
+    OctreeMarchStats rootStats, ropeStats;
+    bool match = true;
+    for ( size_t i = 0; i < surface.size( ); i += 7 )
+    {
+        float position[3], rootColor[4], ropeColor[4];
+        for ( int a = 0; a < 3; a++ )
+            position[a] = params.mMin[a] + surface[i].mPosition[a] * voxelSize;
+        TraceCones( octree, params, position, surface[i].mNormal, CL_ROOT, rootColor, rootStats );
+        TraceCones( octree, params, position, surface[i].mNormal, CL_ROPES, ropeColor, ropeStats );
+        for ( int c = 0; c < 4; c++ )
+            match = match && rootColor[c] == ropeColor[c];
+    }
+    check( match, "cone colors must not depend on the lookup" );
+    check( rootStats.mLookups == ropeStats.mLookups && ropeStats.mFetches < rootStats.mFetches, "ropes must read fewer octree texels" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,139 @@
+#include <Core/Config.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunConfigTest( std::string &failure )
+{
+    TestCheck check;
+
+    // parser
+    const char *text =
+        "# comment\n"
+        "top = 1\n"
+        "[render] ; section comment\n"
+        "  res = 2048   # trailing comment\n"
+        "path = \"Media/a;b#c.bin\"\n"
+        "color = [0.5, 1, 2]\r\n"
+        "res = 1024\n"
+        "broken line\n"
+        "[bad section\n"
+        "bad key = 1\n"
+        "name = \"unterminated\n";
+
+    ConfigDocument doc;
+    std::vector<std::string> errors;
+    bool parsed = ParseConfig( text, doc, errors );
+    check( !parsed && errors.size( ) == 4, "parser must report each malformed line" );
+    check( errors.size( ) > 0 && errors[0].find( "line 8" ) == 0, "parser errors must carry line numbers" );
+    check( doc.count( "top" ) == 1 && doc["top"].mValue == "1", "keys before first section have no prefix" );
+    check( doc.count( "render.res" ) == 1 && doc["render.res"].mValue == "1024" && doc["render.res"].mLine == 7,
+        "duplicate key must keep the last value" );
+    check( doc["render.path"].mValue == "Media/a;b#c.bin", "comment chars inside quotes must be kept" );
+    check( doc["render.color"].mValue == "[0.5, 1, 2]", "value must be trimmed" );
+
+    // schema validation and diffing
+    bool vsync = false;
+    int res = 512;
+    float lambda = 0.5f;
+    float color[3] = { 1.0f, 1.0f, 1.0f };
+    std::string path = "a.bin";
+    int mode = 0;
+    const char *modeNames[] = { "FIRST", "SECOND" };
+
+    ConfigSchema schema;
+    schema.AddBool( "render.vsync", &vsync );
+    schema.AddInt( "render.res", &res, 16, 4096, 1 );
+    schema.AddFloat( "render.lambda", &lambda, 0.0f, 1.0f );
+    schema.AddFloat3( "render.color", color );
+    schema.AddString( "common.path", &path, 4 );
+    schema.AddEnum( "common.mode", &mode, modeNames, 2, 2 );
+    check( schema.GetFieldCount( ) == 6, "schema must keep all fields" );
+
+    ConfigDocument update;
+    errors.clear( );
+    ParseConfig( "[render]\nvsync = on\nres = 8192\nlambda = 0.5\ncolor = 0.25, 0.5, 0.75\nunknown = 1\n"
+        "[common]\npath = \"b.bin\"\nmode = second\n", update, errors );
+    std::vector<ConfigChange> changes;
+    uint32_t reload = schema.Apply( update, changes, errors );
+    check( errors.size( ) == 2, "out of range and unknown keys must be reported" );
+    check( res == 512, "invalid value must keep current one" );
+    check( vsync && color[1] == 0.5f && path == "b.bin" && mode == 1, "valid values must be applied" );
+    check( changes.size( ) == 4, "only differing values are changes" );
+    check( reload == ( 4 | 2 ), "reload mask must combine changed fields only" );
+
+    bool lambdaChanged = false;
+    for ( auto &change : changes )
+        lambdaChanged |= change.mKey == "render.lambda";
+    check( !lambdaChanged, "equal value must not be a change" );
+
+    changes.clear( );
+    errors.clear( );
+    check( schema.Apply( update, changes, errors ) == 0 && changes.empty( ), "applying same document twice must not change anything" );
+
+    ConfigDocument badTypes;
+    ParseConfig( "[render]\nvsync = maybe\nres = 1.5\nlambda = x\ncolor = 1, 2\n[common]\nmode = THIRD\n", badTypes, errors );
+    errors.clear( );
+    changes.clear( );
+    schema.Apply( badTypes, changes, errors );
+    check( errors.size( ) == 5 && changes.empty( ), "type errors must be reported and ignored" );
+
+    // write and parse round trip
+    lambda = 0.1f;
+    res = 1000;
+    std::string written = schema.Write( );
+    check( written.find( "[render]\nvsync = true\nres = 1000\n" ) == 0, "written config must be grouped by section" );
+
+    bool vsync2 = false;
+    int res2 = 16;
+    float lambda2 = 0.0f;
+    float color2[3] = { 0.0f, 0.0f, 0.0f };
+    std::string path2;
+    int mode2 = 0;
+    ConfigSchema schema2;
+    schema2.AddBool( "render.vsync", &vsync2 );
+    schema2.AddInt( "render.res", &res2, 16, 4096 );
+    schema2.AddFloat( "render.lambda", &lambda2, 0.0f, 1.0f );
+    schema2.AddFloat3( "render.color", color2 );
+    schema2.AddString( "common.path", &path2 );
+    schema2.AddEnum( "common.mode", &mode2, modeNames, 2 );
+
+    ConfigDocument roundTrip;
+    errors.clear( );
+    changes.clear( );
+    ParseConfig( written, roundTrip, errors );
+    schema2.Apply( roundTrip, changes, errors );
+    check( errors.empty( ), "written config must parse without errors" );
+    check( vsync2 == vsync && res2 == res && lambda2 == lambda && color2[2] == color[2] && path2 == path && mode2 == mode,
+        "write and parse must round trip exactly" );
+
+    // file watcher, size differs so mtime resolution doesn't matter
+    const char *fn = "config_selftest.tmp";
+    {
+        std::ofstream file( fn );
+        file << "a = 1\n";
+    }
+    ConfigFileWatcher watcher;
+    watcher.SetPath( fn );
+    check( !watcher.Poll( ), "unchanged file must not be reported" );
+    {
+        std::ofstream file( fn );
+        file << "a = 10\n";
+    }
+    check( watcher.Poll( ), "changed file must be reported" );
+    check( !watcher.Poll( ), "change must be reported once" );
+
+    ConfigDocument fileDoc;
+    errors.clear( );
+    check( LoadConfigFile( fn, fileDoc, errors ) && fileDoc["a"].mValue == "10", "config file must be loaded" );
+    remove( fn );
+    check( !watcher.Poll( ), "missing file must not be reported" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
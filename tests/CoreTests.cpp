@@ -0,0 +1,92 @@
+#include "CoreTests.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// vct_core tests without window and device
+// usage: vct_core_tests [test name], runs all tests without a name
+//        vct_core_tests -deque_stress [tasks], work stealing deque with a thief per core
+//
+
+struct CoreTest
+{
+    const char *mName;
+    bool( *mRun )( std::string &failure );
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main( int argc, char **argv )
+{
+    if ( argc > 1 && strcmp( argv[1], "-deque_stress" ) == 0 )
+    {
+        std::string failure;
+        size_t tasks = argc > 2 ? static_cast< size_t >( atol( argv[2] ) ) : 10000000;
+        bool passed = RunTaskDequeStressTest( std::max( 1u, std::thread::hardware_concurrency( ) ), tasks, failure );
+        std::cout << "Deque stress: tasks " << tasks << ( passed ? " passed" : " failed: " ) << failure << std::endl;
+        return passed ? 0 : 1;
+    }
+
+    const CoreTest tests[] =
+    {
+        { "culling", RunCullingTest },
+        { "shadow_cascades", RunShadowCascadeTest },
+        { "photon_list", RunPhotonListTest },
+        { "light_manager", RunLightManagerTest },
+        { "config", RunConfigTest },
+        { "camera_path", RunCameraPathTest },
+        { "path_benchmark", RunPathBenchmarkTest },
+        { "math", RunMathTest },
+        { "math_paths", RunMathPathsTest },
+        { "obj_loader", RunObjLoaderTest },
+        { "octree_layout", RunOctreeLayoutTest },
+        { "scene_stream", RunSceneStreamTest },
+        { "mesh_optimizer", RunMeshOptimizerTest },
+        { "task_scheduler", RunTaskSchedulerTest },
+        { "compact_vertex", RunCompactVertexTest },
+        { "voxel_merge", RunVoxelMergeTest },
+        { "voxel_buffer_sizer", RunVoxelBufferSizerTest },
+        { "cpu_octree", RunCpuOctreeTest },
+        { "cone_tracer", RunConeTracerTest },
+        { "dense_mip_volume", RunDenseMipVolumeTest },
+        { "distance_field", RunDistanceFieldTest },
+        { "irradiance_cache", RunIrradianceCacheTest },
+        { "probe_grid", RunProbeGridTest },
+        { "octree_shards", RunOctreeShardsTest },
+        { "frame_pacer", RunFramePacerTest },
+        { "range_allocator", RunRangeAllocatorTest },
+        { "render_queue", RunRenderQueueTest },
+        { "bvh", RunBVHTest },
+        { "bilateral_upsample", RunBilateralUpsampleTest },
+    };
+
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+    int failed = 0, run = 0;
+    for ( auto &test : tests )
+    {
+        if ( filter && strcmp( filter, test.mName ) != 0 )
+            continue;
+
+        std::string failure;
+        bool passed = test.mRun( failure );
+        std::cout << ( passed ? "passed " : "FAILED " ) << test.mName;
+        if ( !passed )
+            std::cout << ": " << failure;
+        std::cout << std::endl;
+
+        failed += passed ? 0 : 1;
+        run++;
+    }
+
+    if ( run == 0 )
+    {
+        std::cout << "unknown test " << filter << std::endl;
+        return 1;
+    }
+    return failed == 0 ? 0 : 1;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
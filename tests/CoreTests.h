@@ -0,0 +1,72 @@
+#ifndef __CORE_TESTS_H
+#define __CORE_TESTS_H
+
+#include <stddef.h>
+#include <string>
+
+//
+// vct_core tests, one file per module; every test gives false and the description of its first failed check
+//
+
+// ring buffer stats, spin and sleep waits, sleep overshoot and late frames of the frame limiter
+bool RunFramePacerTest( std::string &failure );
+// alloc, best fit, coalescing, grow and fragmentation stats against random churn
+bool RunRangeAllocatorTest( std::string &failure );
+// key packing, radix sort against std::sort and merging of adjacent ranges
+bool RunRenderQueueTest( std::string &failure );
+// closest and any hits of random rays against brute force, deep trees, running checksum and save / load with the geometry checksum
+bool RunBVHTest( std::string &failure );
+// simd against scalar upsample, psnr against the legacy blur and normalized weights across edges
+bool RunBilateralUpsampleTest( std::string &failure );
+// plane extraction, known boxes against a perspective frustum and an ortho light volume on every path, simd against scalar
+bool RunCullingTest( std::string &failure );
+// checks split scheme, slice coverage, caching and invalidation on synthetic cameras
+bool RunShadowCascadeTest( std::string &failure );
+// morton keys, compaction, sort order and leaf ranges of hand made photons, empty and single leaf input, reference run
+bool RunPhotonListTest( std::string &failure );
+// dirty tracking, budget, fairness, removal and rebuild rules
+bool RunLightManagerTest( std::string &failure );
+// parser, validation, diffing, write-parse round trip and file watching
+bool RunConfigTest( std::string &failure );
+// interpolation, angle wrapping, text round trip and recording
+bool RunCameraPathTest( std::string &failure );
+// percentiles, json output and replay determinism
+bool RunPathBenchmarkTest( std::string &failure );
+// matrices against DirectXMath reference values and simd paths against scalar
+bool RunMathTest( std::string &failure );
+// sse, avx and neon soa transforms against scalar with odd counts, widest path pick, short run of the math benchmark
+bool RunMathPathsTest( std::string &failure );
+// objects, material parts, polygon triangulation, vertex sharing and parallel build on a text scene
+bool RunObjLoaderTest( std::string &failure );
+// packing, slots and capacities against hand computed values
+bool RunOctreeLayoutTest( std::string &failure );
+// round trip, truncated files and replace on close
+bool RunSceneStreamTest( std::string &failure );
+// cache simulation, tipsify, overdraw ordering and fetch remap on hand made meshes
+bool RunMeshOptimizerTest( std::string &failure );
+// owner pushes and pops while thieves steal; every task has to come out exactly once
+bool RunTaskDequeStressTest( size_t thieves, size_t tasks, std::string &failure );
+// deque stress, dependencies, nested waits, parallel for/reduce and pipeline order
+bool RunTaskSchedulerTest( std::string &failure );
+// error bounds of positions, octahedral frame and half uvs, special values and simd against scalar
+bool RunCompactVertexTest( std::string &failure );
+// ordering, averages, counts and thread independence against a std::map reference
+bool RunVoxelMergeTest( std::string &failure );
+// create, keep, growth, shrink hysteresis and overflow sequences
+bool RunVoxelBufferSizerTest( std::string &failure );
+// links, leaves and averages of random sparse octrees against brute force
+bool RunCpuOctreeTest( std::string &failure );
+// marcher against root traversal on random walks and cones
+bool RunConeTracerTest( std::string &failure );
+// conversion and sampler against the octree values
+bool RunDenseMipVolumeTest( std::string &failure );
+// transform and field against brute force, cone colors and lookups with and without empty space skipping
+bool RunDistanceFieldTest( std::string &failure );
+// fills, invalidation sets against brute force and interpolation
+bool RunIrradianceCacheTest( std::string &failure );
+// projection, bake against TraceCones, invalid probes, interpolation and file round trip
+bool RunProbeGridTest( std::string &failure );
+// merged shards of random scenes and the cone test room against CpuOctree::Build, file errors
+bool RunOctreeShardsTest( std::string &failure );
+
+#endif
@@ -0,0 +1,114 @@
+#include <Core/CpuOctree.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunCpuOctreeTest( std::string &failure )
+{
+    TestCheck check;
+
+    // random points in one corner and a plane, so there are empty subtrees and cut neighbor links on every level
+    const uint32_t height = 5;
+    const uint32_t resolution = 1u << height;
+    std::mt19937 rng( 7 );
+    std::uniform_int_distribution<uint32_t> corner( 0, resolution / 2 - 1 ), any( 0, resolution - 1 ), color( 0, 0xffffff );
+    std::vector<OctreeVoxel> voxels;
+    for ( int i = 0; i < 300; i++ )
+        voxels.push_back( { PackOctreePosition( corner( rng ), corner( rng ), corner( rng ) ), color( rng ), 0, 0 } );
+    for ( int i = 0; i < 200; i++ )
+        voxels.push_back( { PackOctreePosition( any( rng ), resolution - 3, any( rng ) ), color( rng ), 0, 0 } );
+
+    CpuOctree octree;
+    octree.Build( voxels, height );
+
+    // occupied cells per level, brute force
+    std::vector<std::set<uint32_t>> occupied( height + 1 );
+    for ( const OctreeVoxel &voxel : voxels )
+    {
+        uint32_t x, y, z;
+        UnpackOctreePosition( voxel.mPosition, x, y, z );
+        for ( uint32_t level = 0; level <= height; level++ )
+        {
+            uint32_t shift = height - level;
+            occupied[level].insert( PackOctreePosition( x >> shift, y >> shift, z >> shift ) );
+        }
+    }
+
+    size_t expectedNodes = 1;
+    for ( uint32_t level = 0; level + 1 < height; level++ )
+        expectedNodes += occupied[level].size( ) * CHILDS_COUNT;
+    check( octree.GetNodeCount( ) == expectedNodes, "every occupied node above the last level must get 8 children" );
+    check( octree.GetLevelOffset( 1 ) == 1 && octree.GetLevelOffset( 2 ) == 9, "level offsets must follow the allocation order" );
+
+    size_t fetches = 0;
+    uint32_t nodeIndex, nodeCoords[3], other, otherCoords[3];
+    for ( uint32_t level = 1; level < height; level++ )
+    {
+        uint32_t cells = 1u << level, shift = height - level;
+        for ( uint32_t cz = 0; cz < cells; cz++ )
+        for ( uint32_t cy = 0; cy < cells; cy++ )
+        for ( uint32_t cx = 0; cx < cells; cx++ )
+        {
+            bool found = octree.Traverse( cx << shift, cy << shift, cz << shift, level, nodeIndex, nodeCoords, fetches );
+            bool exists = occupied[level - 1].count( PackOctreePosition( cx >> 1, cy >> 1, cz >> 1 ) ) > 0;
+            if ( !check( found == exists, "node must exist exactly under occupied parents" ) || !found )
+                continue;
+
+            check( nodeCoords[0] == cx << shift && nodeCoords[1] == cy << shift && nodeCoords[2] == cz << shift,
+                "traversal must return node start coords" );
+            octree.Traverse( cx << shift, cy << shift, cz << shift, level - 1, other, otherCoords, fetches );
+            check( octree.Fetch( nodeIndex + ONS_PARENT ) == other, "parent link must point to the node of the level above" );
+
+            // neighbor link is the node of the adjacent cell, undefined where the traversal fails
+            uint32_t cell[3] = { cx, cy, cz };
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                for ( int positive = 0; positive < 2; positive++ )
+                {
+                    uint32_t n[3] = { cell[0], cell[1], cell[2] };
+                    n[axis] += positive ? 1 : static_cast< uint32_t >( -1 );
+                    uint32_t expected = NODE_UNDEFINED;
+                    if ( n[axis] < cells && octree.Traverse( n[0] << shift, n[1] << shift, n[2] << shift, level, other, otherCoords, fetches ) )
+                        expected = other;
+                    check( octree.Fetch( nodeIndex + GetNeighborSlot( axis, positive != 0 ) ) == expected,
+                        "neighbor link must match the traversal of the adjacent cell" );
+                }
+            }
+        }
+    }
+
+    // leaves point to the last voxel of their position
+    for ( size_t i = 0; i < voxels.size( ); i++ )
+    {
+        uint32_t x, y, z;
+        UnpackOctreePosition( voxels[i].mPosition, x, y, z );
+        check( octree.Traverse( x, y, z, height, nodeIndex, nodeCoords, fetches ), "every voxel must reach its leaf" );
+        uint32_t id = octree.Fetch( nodeIndex );
+        check( id >= i && voxels[id].mPosition == voxels[i].mPosition, "leaf must hold the last voxel of its position" );
+    }
+    fetches = 0;
+    octree.Traverse( 0, 0, 0, height - 1, nodeIndex, nodeCoords, fetches );
+    check( fetches == height - 1, "traversal must read one texel per level" );
+
+    // averages
+    float rootOpacity = octree.GetValue( 0 ).mOpacity;
+    check( std::fabs( rootOpacity - occupied[height].size( ) / static_cast< float >( resolution * resolution * resolution ) ) < 1e-6f,
+        "root opacity must be the occupied part of all leaves" );
+    OctreeVoxel single = { PackOctreePosition( 3, 3, 3 ), PackColor( 1.0f, 0.0f, 0.2f, 1.0f ), 0, 0 };
+    CpuOctree one;
+    one.Build( std::vector<OctreeVoxel>( 1, single ), 2 );
+    one.Traverse( 3, 3, 3, 1, nodeIndex, nodeCoords, fetches );
+    const OctreeNodeValue &value = one.GetValue( nodeIndex );
+    check( one.GetNodeCount( ) == 9 && value.mOpacity == 0.125f && value.mColor[0] == 1.0f && std::fabs( value.mColor[2] - 51.0f / 255.0f ) < 1e-6f,
+        "single voxel must give its color and one leaf of opacity" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
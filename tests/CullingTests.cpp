@@ -0,0 +1,115 @@
+#include <Core/Culling.h>
+#include <Core/VMath.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool PlanesMatch( const Frustum &frustum, const float expected[Frustum::FP_COUNT][4] )
+    {
+        for ( int p = 0; p < Frustum::FP_COUNT; p++ )
+        {
+            for ( int c = 0; c < 4; c++ )
+            {
+                if ( std::fabs( frustum.mPlanes[p][c] - expected[p][c] ) > 1e-4f * ( 1.0f + std::fabs( expected[p][c] ) ) )
+                    return false;
+            }
+        }
+        return true;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void PushBox( CullingBoxes &boxes, float x, float y, float z, float extent )
+    {
+        AABB box;
+        const float pMin[3] = { x - extent, y - extent, z - extent }, pMax[3] = { x + extent, y + extent, z + extent };
+        box.Extend( pMin );
+        box.Extend( pMax );
+        boxes.Push( box );
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // every supported path has to give the expected visibility
+    bool CullsAsExpected( const Frustum &frustum, const CullingBoxes &boxes, const std::vector<uint8_t> &expected )
+    {
+        size_t expectedCount = 0;
+        for ( uint8_t v : expected )
+            expectedCount += v;
+        for ( int path = 0; path < CP_COUNT; path++ )
+        {
+            if ( !IsCullingPathSupported( static_cast< CullingPath >( path ) ) )
+                continue;
+            std::vector<uint8_t> visible;
+            if ( CullBoxes( frustum, boxes, visible, static_cast< CullingPath >( path ) ) != expectedCount || visible != expected )
+                return false;
+        }
+        return true;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunCullingTest( std::string &failure )
+{
+    TestCheck check;
+    const float s = 0.70710678f;
+
+    // camera at the origin looking down -z, fov 90, near 1, far 1000: side planes at 45 degrees through the origin
+    const float n = 1.0f, f = 1000.0f;
+    const float perspective[16] = {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, f / ( n - f ), -1.0f,
+        0.0f, 0.0f, n * f / ( n - f ), 0.0f
+    };
+    const float perspectivePlanes[Frustum::FP_COUNT][4] = {
+        { s, 0.0f, -s, 0.0f }, { -s, 0.0f, -s, 0.0f }, { 0.0f, s, -s, 0.0f }, { 0.0f, -s, -s, 0.0f },
+        { 0.0f, 0.0f, -1.0f, -1.0f }, { 0.0f, 0.0f, 1.0f, 1000.0f }
+    };
+    Frustum camera = Frustum::FromViewProj( perspective );
+    check( PlanesMatch( camera, perspectivePlanes ), "perspective planes must be the normalized frustum sides" );
+
+    // 9 boxes, more than a simd lane group, so a padded tail is culled too
+    CullingBoxes boxes;
+    PushBox( boxes, 0.0f, 0.0f, -10.0f, 1.0f ); // inside
+    PushBox( boxes, 0.0f, 0.0f, 10.0f, 1.0f ); // behind the camera
+    PushBox( boxes, -100.0f, 0.0f, -10.0f, 1.0f ); // left of the left plane
+    PushBox( boxes, -10.0f, 0.0f, -10.0f, 1.0f ); // on the left plane
+    PushBox( boxes, 0.0f, 30.0f, -10.0f, 1.0f ); // above the top plane
+    PushBox( boxes, 0.0f, 0.0f, -1100.0f, 5.0f ); // past the far plane
+    PushBox( boxes, 0.0f, 0.0f, -1000.0f, 5.0f ); // on the far plane
+    PushBox( boxes, 0.0f, 0.0f, 0.0f, 5.0f ); // around the camera, on the near plane
+    boxes.Push( AABB( ) ); // empty
+    const uint8_t cameraVisible[] = { 1, 0, 0, 1, 0, 0, 1, 1, 0 };
+    check( CullsAsExpected( camera, boxes, std::vector<uint8_t>( cameraVisible, cameraVisible + 9 ) ),
+        "perspective frustum must keep the boxes inside and on its planes only" );
+
+    // light volume of XMMatrixOrthographicRH( 200, 100, 10, 500 ) looking down -z: an axis aligned box
+    Frustum light = Frustum::FromViewProj( Mat4OrthographicRH( 200.0f, 100.0f, 10.0f, 500.0f ).m );
+    const float orthoPlanes[Frustum::FP_COUNT][4] = {
+        { 1.0f, 0.0f, 0.0f, 100.0f }, { -1.0f, 0.0f, 0.0f, 100.0f }, { 0.0f, 1.0f, 0.0f, 50.0f }, { 0.0f, -1.0f, 0.0f, 50.0f },
+        { 0.0f, 0.0f, -1.0f, -10.0f }, { 0.0f, 0.0f, 1.0f, 500.0f }
+    };
+    check( PlanesMatch( light, orthoPlanes ), "ortho planes must be the sides of the light box" );
+
+    CullingBoxes lightBoxes;
+    PushBox( lightBoxes, 0.0f, 0.0f, -200.0f, 10.0f ); // inside
+    PushBox( lightBoxes, 150.0f, 0.0f, -200.0f, 10.0f ); // right of the box
+    PushBox( lightBoxes, 105.0f, 0.0f, -200.0f, 10.0f ); // on the right side
+    PushBox( lightBoxes, 0.0f, -70.0f, -200.0f, 10.0f ); // below
+    PushBox( lightBoxes, 0.0f, 0.0f, 0.0f, 5.0f ); // in front of the near plane
+    PushBox( lightBoxes, 0.0f, 0.0f, -8.0f, 5.0f ); // on the near plane
+    PushBox( lightBoxes, 0.0f, 0.0f, -600.0f, 50.0f ); // past the far plane
+    const uint8_t lightVisible[] = { 1, 0, 1, 0, 0, 1, 0 };
+    check( CullsAsExpected( light, lightBoxes, std::vector<uint8_t>( lightVisible, lightVisible + 7 ) ),
+        "ortho light volume must keep the boxes inside and on its sides only" );
+
+    // all supported simd paths against scalar reference on random boxes
+    check( RunCullingBenchmark( 10000, 1 ).mPathsMatch, "simd culling doesn't match scalar reference" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
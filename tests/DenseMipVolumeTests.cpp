@@ -0,0 +1,116 @@
+#include <Core/DenseMipVolume.h>
+#include <Core/ConeTracer.h>
+#include <Core/CpuOctree.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    size_t TexelIndex( uint32_t x, uint32_t y, uint32_t z, uint32_t size )
+    {
+        return ( static_cast< size_t >( z ) * size + y ) * size + x;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunDenseMipVolumeTest( std::string &failure )
+{
+    TestCheck check;
+
+    const uint32_t height = 5, cutoff = 3;
+    std::vector<OctreeVoxel> voxels;
+    std::vector<ConeTracePoint> surface;
+    GenerateConeTestRoom( height, voxels, surface );
+    CpuOctree octree;
+    octree.Build( voxels, height );
+
+    std::vector<uint32_t> texels;
+    BrickBufferView bricks;
+    bricks.mSize = GetBrickBufferSizeFor( octree.GetNodeCount( ) );
+    octree.WriteBricks( bricks.mSize, texels );
+    bricks.mTexels = texels.data( );
+    check( GetBrickCapacity( bricks.mSize ) >= octree.GetNodeCount( ), "brick buffer must hold every node" );
+
+    DenseMipVolume dense;
+    dense.Build( octree.GetSlots( ), height, bricks, cutoff );
+    check( dense.GetMipCount( ) == cutoff + 1 && dense.GetMipSize( 0 ) == 8 && dense.GetMip( cutoff ).size( ) == 1, "mip chain must end at the root" );
+    check( dense.GetByteSize( ) == GetDenseMipByteSize( cutoff ) && GetDenseMipByteSize( cutoff ) == 4 * ( 1 + 8 + 64 + 512 ),
+        "dense size must be the full mip chain" );
+
+    // every texel is the brick center of the node of its cell, empty cells are zero
+    size_t fetches = 0;
+    bool texelsMatch = true;
+    for ( uint32_t level = 0; level <= cutoff; level++ )
+    {
+        uint32_t size = 1u << level, shift = height - level;
+        const std::vector<uint32_t> &mip = dense.GetMip( cutoff - level );
+        for ( uint32_t z = 0; z < size; z++ )
+        for ( uint32_t y = 0; y < size; y++ )
+        for ( uint32_t x = 0; x < size; x++ )
+        {
+            uint32_t nodeIndex, nodeCoords[3], expected = 0;
+            if ( octree.Traverse( x << shift, y << shift, z << shift, level, nodeIndex, nodeCoords, fetches ) )
+            {
+                const OctreeNodeValue &value = octree.GetValue( nodeIndex );
+                expected = PackColor( value.mColor[0], value.mColor[1], value.mColor[2], value.mOpacity );
+            }
+            texelsMatch = texelsMatch && mip[TexelIndex( x, y, z, size )] == expected;
+        }
+    }
+    check( texelsMatch, "texels must be the brick centers of the octree nodes" );
+
+    // sampler: exact at texel centers, linear between them, clamped at the border
+    const std::vector<uint32_t> &fine = dense.GetMip( 0 );
+    auto unpack = []( uint32_t texel, int c ) { return ( ( texel >> ( c * 8 ) ) & 0xff ) / 255.0f; };
+    float at[4], between[4], outside[4];
+    const float center[3] = { 1.5f / 8.0f, 0.5f / 8.0f, 2.5f / 8.0f }, half[3] = { 2.0f / 8.0f, 0.5f / 8.0f, 2.5f / 8.0f };
+    const float below[3] = { -0.5f, 0.5f / 8.0f, 2.5f / 8.0f };
+    dense.Sample( center, cutoff, at );
+    dense.Sample( half, cutoff, between );
+    dense.Sample( below, cutoff, outside );
+    bool sampled = true;
+    for ( int c = 0; c < 4; c++ )
+    {
+        float a = unpack( fine[TexelIndex( 1, 0, 2, 8 )], c ), b = unpack( fine[TexelIndex( 2, 0, 2, 8 )], c );
+        sampled = sampled && std::fabs( at[c] - a ) < 1e-5f && std::fabs( between[c] - ( a + b ) * 0.5f ) < 1e-5f
+            && std::fabs( outside[c] - unpack( fine[TexelIndex( 0, 0, 2, 8 )], c ) ) < 1e-5f;
+    }
+    check( sampled, "sampler must match a linear clamp sampler" );
+    check( at[3] > 0.0f, "floor texel must be opaque" );
+
+    // cones: dense levels don't read the octree
+    ConeTraceParams params;
+    params.mFirstLevel = height - 1;
+    params.mLastLevel = 0;
+    float voxelSize = ( params.mMax[0] - params.mMin[0] ) / octree.GetResolution( );
+    params.mWorldConeOffset = voxelSize * 1.5f;
+    ConeTraceVolumes volumes;
+    volumes.mDense = &dense;
+    OctreeMarchStats sparseStats, hybridStats;
+    float position[3], color[4];
+    for ( size_t i = 0; i < surface.size( ); i += 11 )
+    {
+        for ( int a = 0; a < 3; a++ )
+            position[a] = params.mMin[a] + surface[i].mPosition[a] * voxelSize;
+        TraceCones( octree, params, position, surface[i].mNormal, CL_ROPES, color, sparseStats );
+        TraceCones( octree, params, position, surface[i].mNormal, CL_ROPES, color, hybridStats, volumes );
+    }
+    check( hybridStats.mDenseSamples > 0 && hybridStats.mFetches < sparseStats.mFetches, "hybrid cones must sample dense levels" );
+
+    DenseMipVolume all;
+    all.Build( octree.GetSlots( ), height, bricks, 100 );
+    check( all.GetCutoff( ) == height - 1, "cutoff must stop at the last node level" );
+    OctreeMarchStats denseOnly;
+    volumes.mDense = &all;
+    TraceCones( octree, params, position, surface.back( ).mNormal, CL_ROPES, color, denseOnly, volumes );
+    check( denseOnly.mLookups == 0 && denseOnly.mFetches == 0 && denseOnly.mDenseSamples > 0, "fully dense cones must not read the octree" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,167 @@
+#include <Core/DistanceField.h>
+#include <Core/ConeTracer.h>
+#include <Core/CpuOctree.h>
+#include <Core/DenseMipVolume.h>
+#include <Core/TaskScheduler.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const uint8_t MAX_DISTANCE = 255;
+
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    size_t CellIndex( uint32_t x, uint32_t y, uint32_t z, uint32_t size )
+    {
+        return ( static_cast< size_t >( z ) * size + y ) * size + x;
+    }
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void BruteForceDistances( const std::vector<uint8_t> &occupied, uint32_t size, std::vector<uint8_t> &distances )
+    {
+        distances.assign( occupied.size( ), MAX_DISTANCE );
+        for ( uint32_t z = 0; z < size; z++ )
+        for ( uint32_t y = 0; y < size; y++ )
+        for ( uint32_t x = 0; x < size; x++ )
+        {
+            for ( uint32_t cz = 0; cz < size; cz++ )
+            for ( uint32_t cy = 0; cy < size; cy++ )
+            for ( uint32_t cx = 0; cx < size; cx++ )
+            {
+                if ( occupied[CellIndex( cx, cy, cz, size )] == 0 )
+                    continue;
+                uint32_t dx = x > cx ? x - cx : cx - x, dy = y > cy ? y - cy : cy - y, dz = z > cz ? z - cz : cz - z;
+                uint32_t d = ( std::min )( ( std::max )( dx, ( std::max )( dy, dz ) ), static_cast< uint32_t >( MAX_DISTANCE ) );
+                uint8_t &cell = distances[CellIndex( x, y, z, size )];
+                cell = ( std::min )( cell, static_cast< uint8_t >( d ) );
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunDistanceFieldTest( std::string &failure )
+{
+    TestCheck check;
+
+    TaskScheduler serial( 0 );
+    TaskScheduler parallel( 3 );
+
+    // random grids against brute force, a few sizes and fill rates, serial and parallel
+    std::mt19937 rng( 5 );
+    const uint32_t sizes[] = { 1, 2, 7, 13 };
+    const double fills[] = { 0.0, 0.002, 0.05, 0.4 };
+    bool transformMatches = true;
+    for ( uint32_t size : sizes )
+    for ( double fill : fills )
+    {
+        std::bernoulli_distribution occupy( fill );
+        std::vector<uint8_t> occupied( static_cast< size_t >( size ) * size * size ), grid( occupied.size( ) ), expected;
+        for ( size_t i = 0; i < occupied.size( ); i++ )
+        {
+            occupied[i] = occupy( rng ) ? 1 : 0;
+            grid[i] = occupied[i] != 0 ? 0 : MAX_DISTANCE;
+        }
+        BruteForceDistances( occupied, size, expected );
+
+        std::vector<uint8_t> other = grid;
+        ChebyshevDistanceTransform( grid, size, serial );
+        ChebyshevDistanceTransform( other, size, parallel );
+        transformMatches = transformMatches && grid == expected && other == expected;
+    }
+    check( transformMatches, "distance transform must match brute force" );
+
+    // a single voxel: distances grow by one per ring and saturate
+    std::vector<uint8_t> ring( static_cast< size_t >( 3 ) * 3 * 3, MAX_DISTANCE );
+    ring[0] = 0;
+    ChebyshevDistanceTransform( ring, 3, parallel );
+    check( ring[CellIndex( 2, 1, 0, 3 )] == 2 && ring[CellIndex( 1, 1, 1, 3 )] == 1 && ring[CellIndex( 2, 2, 2, 3 )] == 2,
+        "distance must be the chebyshev ring of the voxel" );
+    const uint32_t far = 258;
+    std::vector<uint8_t> saturated( static_cast< size_t >( far ) * far * far, MAX_DISTANCE );
+    saturated[0] = 0;
+    ChebyshevDistanceTransform( saturated, far, parallel );
+    check( saturated[CellIndex( 1, 0, 0, far )] == 1 && saturated[CellIndex( 254, 3, 0, far )] == 254 &&
+        saturated[CellIndex( 256, 0, 0, far )] == MAX_DISTANCE && saturated[CellIndex( far - 1, far - 1, far - 1, far )] == MAX_DISTANCE,
+        "distances must saturate at 255" );
+
+    // octree field: occupied cells are the nodes with voxels of the level
+    const uint32_t height = 5;
+    std::vector<OctreeVoxel> voxels;
+    std::vector<ConeTracePoint> surface;
+    GenerateConeTestRoom( height, voxels, surface );
+    CpuOctree octree;
+    octree.Build( voxels, height );
+
+    OctreeDistanceField field;
+    field.Build( octree, 100, parallel );
+    check( field.GetLevel( ) == height - 1 && field.GetSize( ) == 16 && field.GetByteSize( ) == 16 * 16 * 16, "level must stop at the last node level" );
+
+    const uint32_t level = 3, size = 1u << level, shift = height - level;
+    field.Build( octree, level, parallel );
+    std::vector<uint8_t> occupied( static_cast< size_t >( size ) * size * size, 0 ), expected;
+    size_t fetches = 0;
+    for ( uint32_t z = 0; z < size; z++ )
+    for ( uint32_t y = 0; y < size; y++ )
+    for ( uint32_t x = 0; x < size; x++ )
+    {
+        uint32_t nodeIndex, nodeCoords[3];
+        if ( octree.Traverse( x << shift, y << shift, z << shift, level, nodeIndex, nodeCoords, fetches ) )
+            occupied[CellIndex( x, y, z, size )] = octree.Fetch( nodeIndex + ONS_FLAGS ) == NODE_ALLOCATED ? 1 : 0;
+    }
+    BruteForceDistances( occupied, size, expected );
+    check( field.GetDistances( ) == expected, "field must be the distance to the nodes with voxels" );
+    check( *std::max_element( expected.begin( ), expected.end( ) ) > 1, "room must have empty space" );
+
+    // cones: skipping gives the same colors with sparse and dense levels and saves lookups
+    field.Build( octree, height - 1, parallel );
+    std::vector<uint32_t> texels;
+    BrickBufferView bricks;
+    bricks.mSize = GetBrickBufferSizeFor( octree.GetNodeCount( ) );
+    octree.WriteBricks( bricks.mSize, texels );
+    bricks.mTexels = texels.data( );
+    check( GetBrickCapacity( bricks.mSize ) >= octree.GetNodeCount( ), "brick buffer must hold every node" );
+    DenseMipVolume dense;
+    dense.Build( octree.GetSlots( ), height, bricks, 2 );
+
+    ConeTraceParams params;
+    params.mFirstLevel = height - 1;
+    params.mLastLevel = 0;
+    float voxelSize = ( params.mMax[0] - params.mMin[0] ) / octree.GetResolution( );
+    params.mWorldConeOffset = voxelSize * 1.5f;
+
+    ConeTraceVolumes skip, hybrid, hybridSkip;
+    skip.mEmptySpace = &field;
+    hybrid.mDense = &dense;
+    hybridSkip.mDense = &dense;
+    hybridSkip.mEmptySpace = &field;
+    OctreeMarchStats baseStats, skipStats, rootStats, hybridStats, hybridSkipStats;
+    bool colorsMatch = true;
+    for ( size_t i = 0; i < surface.size( ); i += 7 )
+    {
+        float position[3], base[4], skipped[4], root[4], mixed[4], mixedSkipped[4];
+        for ( int a = 0; a < 3; a++ )
+            position[a] = params.mMin[a] + surface[i].mPosition[a] * voxelSize;
+        TraceCones( octree, params, position, surface[i].mNormal, CL_ROPES, base, baseStats );
+        TraceCones( octree, params, position, surface[i].mNormal, CL_ROPES, skipped, skipStats, skip );
+        TraceCones( octree, params, position, surface[i].mNormal, CL_ROOT, root, rootStats, skip );
+        TraceCones( octree, params, position, surface[i].mNormal, CL_ROPES, mixed, hybridStats, hybrid );
+        TraceCones( octree, params, position, surface[i].mNormal, CL_ROPES, mixedSkipped, hybridSkipStats, hybridSkip );
+        for ( int c = 0; c < 4; c++ )
+            colorsMatch = colorsMatch && base[c] == skipped[c] && base[c] == root[c] && mixed[c] == mixedSkipped[c];
+    }
+    check( colorsMatch, "skipped samples must not change the cone colors" );
+    check( skipStats.mSkippedSamples > 0 && skipStats.mLookups + skipStats.mSkippedSamples == baseStats.mLookups,
+        "every inside sample must be looked up or skipped" );
+    check( skipStats.mFetches < baseStats.mFetches && skipStats.mFieldFetches > 0, "skipping must save octree reads" );
+    check( hybridSkipStats.mLookups + hybridSkipStats.mDenseSamples + hybridSkipStats.mSkippedSamples == hybridStats.mLookups + hybridStats.mDenseSamples,
+        "every inside sample of hybrid cones must be looked up, sampled or skipped" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,81 @@
+#include <Core/FramePacer.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <chrono>
+#include <cmath>
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunFramePacerTest( std::string &failure )
+{
+    TestCheck check;
+    auto isNear = []( float a, float b ) { return std::fabs( a - b ) < 1e-5f; };
+
+    // ring of 4 keeps the last 4 intervals
+    FramePacer ring( 4 );
+    check( ring.GetStats( ).mCount == 0 && ring.GetStats( ).mMean == 0.0f, "empty history must give zero stats" );
+    ring.AddFrameTime( 0.010f );
+    ring.AddFrameTime( 0.030f );
+    FrameStats partial = ring.GetStats( );
+    check( partial.mCount == 2 && isNear( partial.mMean, 0.020f ) && isNear( partial.mStdDev, 0.010f ) &&
+        partial.mMin == 0.010f && partial.mMax == 0.030f, "partial history must only count recorded frames" );
+    for ( int i = 3; i <= 6; i++ )
+        ring.AddFrameTime( 0.010f * i );
+    FrameStats full = ring.GetStats( );
+    check( full.mCount == 4 && isNear( full.mMean, 0.045f ) && isNear( full.mMin, 0.030f ) && isNear( full.mMax, 0.060f ) &&
+        isNear( full.mStdDev, 0.010f * std::sqrt( 1.25f ) ), "full history must be the last frames of the ring" );
+    ring.Reset( );
+    check( ring.GetStats( ).mCount == 0, "reset must clear the history" );
+
+    // spin threshold above the frame time never sleeps, so there is no overshoot to account for
+    const float target = 0.01f;
+    const size_t frames = 20;
+    FramePacer spinning( frames );
+    spinning.SetTargetFrameTime( target );
+    spinning.SetSpinThreshold( 1.0f );
+    spinning.Wait( );
+    for ( size_t i = 0; i < frames; i++ )
+        spinning.Wait( );
+    FrameStats spun = spinning.GetStats( );
+    check( spinning.GetSleepOvershoot( ) == 0.0f, "spin only pacing must not measure sleep overshoot" );
+    check( spun.mCount == frames && spun.mMean >= target * 0.99f && spun.mMean < target * 1.2f, "spin pacing must hold the target" );
+
+    // no spin: every frame sleeps, the overshoot is measured and the deadline chain keeps the mean at the target
+    FramePacer sleeping( frames );
+    sleeping.SetTargetFrameTime( target );
+    sleeping.SetSpinThreshold( 0.0f );
+    sleeping.Wait( );
+    for ( size_t i = 0; i < frames; i++ )
+        sleeping.Wait( );
+    FrameStats slept = sleeping.GetStats( );
+    check( sleeping.GetSleepOvershoot( ) > 0.0f && sleeping.GetSleepOvershoot( ) < target,
+        "sleep overshoot must be measured and stay under a frame" );
+    check( slept.mCount == frames && slept.mMean >= target * 0.9f && slept.mMean < target * 1.5f,
+        "sleep pacing must hold the target on average" );
+
+    // a frame late by more than a frame restarts the deadline chain instead of a burst of short frames
+    typedef FramePacer::Clock Clock;
+    sleeping.Reset( );
+    sleeping.Wait( );
+    sleeping.Wait( );
+    Clock::time_point late = Clock::now( ) + std::chrono::milliseconds( 35 );
+    while ( Clock::now( ) < late );
+    sleeping.Wait( );
+    sleeping.Wait( );
+    FrameStats caughtUp = sleeping.GetStats( );
+    check( caughtUp.mCount == 3 && caughtUp.mMin >= target * 0.9f, "late frame must not be followed by a short one" );
+
+    // disabled pacing only records intervals
+    FramePacer unpaced( 8 );
+    Clock::time_point start = Clock::now( );
+    unpaced.Wait( );
+    for ( int i = 0; i < 8; i++ )
+        unpaced.Wait( );
+    float elapsed = std::chrono::duration< float >( Clock::now( ) - start ).count( );
+    check( unpaced.GetStats( ).mCount == 8 && elapsed < target, "target 0 must not wait" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,157 @@
+#include <Core/IrradianceCache.h>
+#include <Core/DistanceField.h>
+#include <Core/TaskScheduler.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunIrradianceCacheTest( std::string &failure )
+{
+    TestCheck check;
+
+    const uint32_t height = 5, regionLevel = 3;
+    std::vector<OctreeVoxel> voxels;
+    std::vector<ConeTracePoint> surface;
+    GenerateConeTestRoom( height, voxels, surface );
+    CpuOctree octree;
+    octree.Build( voxels, height );
+
+    ConeTraceParams params;
+    params.mFirstLevel = height - 1;
+    params.mLastLevel = 1;
+    float voxelSize = ( params.mMax[0] - params.mMin[0] ) / octree.GetResolution( );
+    params.mWorldConeOffset = voxelSize * 1.5f;
+
+    IrradianceCache cache;
+    cache.Reset( voxels, height, regionLevel );
+    check( cache.GetEntryCount( ) == voxels.size( ) && cache.GetValidCount( ) == 0 && cache.GetRegionCount( ) == 512,
+        "entries must start invalid" );
+
+    // fills are the cone result of the leaf, the second look at a point is served from the cache
+    float first[4], second[4];
+    const ConeTracePoint &point = surface[surface.size( ) / 3];
+    float position[3];
+    for ( int a = 0; a < 3; a++ )
+        position[a] = params.mMin[a] + point.mPosition[a] * voxelSize;
+    cache.Shade( octree, params, position, point.mNormal, first );
+    IrradianceCacheStats filled = cache.GetStats( );
+    cache.Shade( octree, params, position, point.mNormal, second );
+    const IrradianceCacheStats &stats = cache.GetStats( );
+    check( filled.mFills > 0 && filled.mHits == 0 && filled.mFallbacks == 0, "first look must trace the leaves" );
+    check( stats.mFills == filled.mFills && stats.mHits == stats.mLookups - filled.mLookups, "second look must hit every leaf" );
+    check( std::equal( first, first + 4, second ), "cached results must not change" );
+
+    // a point at a leaf center is that leaf alone, traced from the center along the voxel normal; duplicates of a
+    // leaf ( room edges ) lose against the last voxel
+    bool fillsMatch = true;
+    for ( size_t i = 0; i < voxels.size( ); i += 37 )
+    {
+        uint32_t x, y, z, nodeIndex, nodeCoords[3];
+        size_t fetches = 0;
+        UnpackOctreePosition( voxels[i].mPosition, x, y, z );
+        if ( !octree.Traverse( x, y, z, height, nodeIndex, nodeCoords, fetches ) || octree.Fetch( nodeIndex ) != i )
+            continue;
+
+        float center[3], normal[3], traced[4], shaded[4];
+        GetLeafCenter( params, octree.GetResolution( ), voxels[i].mPosition, center );
+        UnpackVoxelNormal( voxels[i].mNormal, normal );
+        OctreeMarchStats traceStats;
+        TraceCones( octree, params, center, normal, CL_ROPES, traced, traceStats );
+        cache.Shade( octree, params, center, normal, shaded );
+        fillsMatch = fillsMatch && cache.IsValid( static_cast< uint32_t >( i ) ) && std::equal( traced, traced + 4, shaded );
+    }
+    check( fillsMatch, "leaf center must give the cone result of its leaf" );
+
+    // invalidation: regions within reach of a lit leaf against brute force, the rest keeps its entries
+    for ( size_t i = 0; i < voxels.size( ); i++ )
+    {
+        float value[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        cache.Store( static_cast< uint32_t >( i ), value );
+    }
+    check( cache.GetValidCount( ) == voxels.size( ), "stored entries must be valid" );
+
+    std::vector<PhotonLeaf> lit;
+    std::mt19937 rng( 3 );
+    std::uniform_int_distribution<size_t> pickVoxel( 0, voxels.size( ) - 1 );
+    for ( int i = 0; i < 3; i++ )
+    {
+        uint32_t x, y, z;
+        UnpackOctreePosition( voxels[pickVoxel( rng )].mPosition, x, y, z );
+        PhotonLeaf leaf = { MortonEncode( x, y, z ), 1, { 1.0f, 1.0f, 1.0f } };
+        lit.push_back( leaf );
+    }
+
+    TaskScheduler scheduler( 2 );
+    const float reach = 5.0f;
+    size_t invalidated = cache.Invalidate( lit, reach, scheduler );
+
+    const uint32_t regionWidth = 1u << ( height - regionLevel ), regionRadius = 2; // ceil( 5 / 4 )
+    bool setMatches = true, conservative = true;
+    size_t expectedRegions = 0;
+    for ( uint32_t rz = 0; rz < 8; rz++ )
+    for ( uint32_t ry = 0; ry < 8; ry++ )
+    for ( uint32_t rx = 0; rx < 8; rx++ )
+    {
+        bool near = false;
+        for ( const PhotonLeaf &leaf : lit )
+        {
+            uint32_t x, y, z;
+            MortonDecode( leaf.mKey, x, y, z );
+            uint32_t r[3] = { rx, ry, rz }, l[3] = { x / regionWidth, y / regionWidth, z / regionWidth };
+            bool close = true;
+            for ( int a = 0; a < 3; a++ )
+                close = close && ( r[a] > l[a] ? r[a] - l[a] : l[a] - r[a] ) <= regionRadius;
+            near = near || close;
+        }
+        expectedRegions += near ? 1 : 0;
+    }
+    for ( size_t i = 0; i < voxels.size( ); i++ )
+    {
+        uint32_t v[3], region[3];
+        UnpackOctreePosition( voxels[i].mPosition, v[0], v[1], v[2] );
+        for ( int a = 0; a < 3; a++ )
+            region[a] = v[a] / regionWidth;
+
+        bool inRegion = false, inReach = false;
+        for ( const PhotonLeaf &leaf : lit )
+        {
+            uint32_t l[3];
+            MortonDecode( leaf.mKey, l[0], l[1], l[2] );
+            bool regionClose = true, leafClose = true;
+            for ( int a = 0; a < 3; a++ )
+            {
+                uint32_t lr = l[a] / regionWidth;
+                regionClose = regionClose && ( region[a] > lr ? region[a] - lr : lr - region[a] ) <= regionRadius;
+                leafClose = leafClose && std::fabs( static_cast< float >( v[a] ) - static_cast< float >( l[a] ) ) <= reach;
+            }
+            inRegion = inRegion || regionClose;
+            inReach = inReach || leafClose;
+        }
+        bool valid = cache.IsValid( static_cast< uint32_t >( i ) );
+        setMatches = setMatches && valid == !inRegion;
+        conservative = conservative && !( inReach && valid );
+    }
+    check( invalidated == expectedRegions && cache.GetStats( ).mInvalidatedRegions >= expectedRegions, "invalidated regions must match brute force" );
+    check( setMatches, "entries of invalidated regions must be invalid, the others valid" );
+    check( conservative, "entries within reach of a lit leaf must be invalid" );
+    check( cache.GetValidCount( ) > 0, "entries far from the light must stay valid" );
+
+    cache.InvalidateAll( );
+    check( cache.GetValidCount( ) == 0, "rebuild must invalidate everything" );
+
+    // reach covers the last sample and its node
+    ConeTraceParams defaults;
+    float expectedReach = ( defaults.mWorldConeOffset + defaults.mLocalConeOffset + 2048.0f / 16.0f * 1.4142f * defaults.mStepCorrection
+        + 1.5f * 2048.0f / 8.0f ) / voxelSize;
+    check( std::fabs( GetConeReach( octree, defaults ) - expectedReach ) < 1e-3f * expectedReach, "reach must end at the footprint of the last sample" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
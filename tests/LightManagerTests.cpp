@@ -0,0 +1,166 @@
+#include <Core/LightManager.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunLightManagerTest( std::string &failure )
+{
+    TestCheck check;
+
+    auto makeLight = []( LightKind type, float x, float z ) -> LightState
+    {
+        LightState light;
+        light.mType = type;
+        light.mPosition[0] = x; light.mPosition[1] = 10.0f; light.mPosition[2] = z;
+        light.mDirection[0] = 0.0f; light.mDirection[1] = -1.0f; light.mDirection[2] = 0.0f;
+        light.mColor[0] = light.mColor[1] = light.mColor[2] = 1.0f;
+        light.mRadius = 20.0f;
+        light.mSpotAngle = 0.5f;
+        return light;
+    };
+
+    auto localFaces = []( const LightSchedule &schedule )
+    {
+        int count = 0;
+        for ( const LightInjection &injection : schedule.mInjections )
+            count += injection.mState.mType == LIGHT_DIRECTIONAL ? 0 : GetLightFaceCount( injection.mState.mType );
+        return count;
+    };
+
+    // sun, 4 point and 2 spot lights, 12 faces per frame
+    std::vector<LightState> lights;
+    lights.push_back( makeLight( LIGHT_DIRECTIONAL, 0.0f, 0.0f ) );
+    for ( int i = 0; i < 4; i++ )
+        lights.push_back( makeLight( LIGHT_POINT, i * 5.0f, 0.0f ) );
+    for ( int i = 0; i < 2; i++ )
+        lights.push_back( makeLight( LIGHT_SPOT, i * 5.0f, 5.0f ) );
+
+    LightManager manager;
+    manager.SetBudget( 12 );
+    manager.Sync( lights );
+
+    LightSchedule schedule = manager.Schedule( );
+    check( schedule.mRebuild, "first schedule has to rebuild" );
+    check( !schedule.mInjections.empty( ) && schedule.mInjections[0].mLight == 0, "directional light goes first" );
+    check( localFaces( schedule ) <= 12, "budget exceeded" );
+
+    int frames = 1;
+    std::vector<int> injectedCount( lights.size( ), 0 );
+    for ( const LightInjection &injection : schedule.mInjections )
+        injectedCount[injection.mLight]++;
+
+    while ( manager.GetPendingCount( ) > 0 && frames < 10 )
+    {
+        manager.Sync( lights );
+        schedule = manager.Schedule( );
+        check( !schedule.mRebuild, "unexpected rebuild" );
+        check( localFaces( schedule ) <= 12, "budget exceeded" );
+        for ( const LightInjection &injection : schedule.mInjections )
+        {
+            check( injection.mSign > 0.0f, "nothing to remove during initial injection" );
+            injectedCount[injection.mLight]++;
+        }
+        frames++;
+    }
+    check( frames == 3, "4 point and 2 spot lights should take 3 frames with 12 faces" );
+    for ( size_t i = 0; i < injectedCount.size( ); i++ )
+        check( injectedCount[i] == 1, "every light has to be injected once" );
+
+    // nothing changed
+    manager.Sync( lights );
+    check( manager.Schedule( ).mInjections.empty( ), "unchanged lights were scheduled" );
+
+    // moved point light is removed and injected again, others stay
+    lights[2].mPosition[0] += 1.0f;
+    manager.Sync( lights );
+    schedule = manager.Schedule( );
+    check( !schedule.mRebuild && schedule.mInjections.size( ) == 2, "moved light has to be removed and injected" );
+    if ( schedule.mInjections.size( ) == 2 )
+    {
+        check( schedule.mInjections[0].mLight == 2 && schedule.mInjections[0].mSign < 0.0f &&
+            schedule.mInjections[0].mState.mPosition[0] == lights[2].mPosition[0] - 1.0f, "removal has to use the old state" );
+        check( schedule.mInjections[1].mLight == 2 && schedule.mInjections[1].mSign > 0.0f &&
+            schedule.mInjections[1].mState == lights[2], "injection has to use the new state" );
+    }
+
+    // budget below a point light update: the first light in line is still taken, the rest waits
+    manager.SetBudget( 2 );
+    lights[1].mColor[0] = 0.5f;
+    for ( int frame = 0; frame < 2; frame++ )
+    {
+        lights[5].mPosition[2] += 1.0f;
+        manager.Sync( lights );
+        schedule = manager.Schedule( );
+    }
+    check( manager.GetPendingCount( ) == 0, "low budget has to progress" );
+    manager.SetBudget( 12 );
+
+    // removed light is only taken out
+    lights.pop_back( );
+    manager.Sync( lights );
+    schedule = manager.Schedule( );
+    check( schedule.mInjections.size( ) == 1 && schedule.mInjections[0].mSign < 0.0f && schedule.mInjections[0].mLight == 6,
+        "removed light has to be taken out" );
+    check( manager.GetLightCount( ) == lights.size( ), "removed light entry has to be dropped" );
+
+    // sun change rebuilds everything
+    lights[0].mDirection[0] = 0.1f;
+    manager.Sync( lights );
+    schedule = manager.Schedule( );
+    check( schedule.mRebuild, "directional light change has to rebuild" );
+    for ( const LightInjection &injection : schedule.mInjections )
+        check( injection.mSign > 0.0f, "rebuild doesn't remove" );
+
+    // accumulated removals rebuild
+    LightManager drift;
+    drift.SetMaxDeltaUpdates( 3 );
+    std::vector<LightState> one( 1, makeLight( LIGHT_SPOT, 0.0f, 0.0f ) );
+    drift.Sync( one );
+    drift.Schedule( );
+    for ( int i = 0; i < 3; i++ )
+    {
+        one[0].mPosition[0] += 1.0f;
+        drift.Sync( one );
+        check( !drift.Schedule( ).mRebuild, "early drift rebuild" );
+    }
+    drift.Sync( one );
+    check( drift.Schedule( ).mRebuild, "drift limit has to rebuild" );
+
+    // cube faces cover every direction, spot frustum covers its cone
+    LightState point = makeLight( LIGHT_POINT, 1.0f, 2.0f );
+    LightState spot = makeLight( LIGHT_SPOT, 1.0f, 2.0f );
+    for ( int i = 0; i < 200; i++ )
+    {
+        float theta = std::acos( 1.0f - 2.0f * ( i + 0.5f ) / 200.0f ), phi = i * 2.39996f;
+        float dir[3] = { std::sin( theta ) * std::cos( phi ), std::cos( theta ), std::sin( theta ) * std::sin( phi ) };
+
+        auto inside = [&]( const LightState &light, int face ) -> bool
+        {
+            float view[16], proj[16];
+            GetLightFaceMatrices( light, face, view, proj );
+            float p[4] = { light.mPosition[0] + dir[0] * 5.0f, light.mPosition[1] + dir[1] * 5.0f, light.mPosition[2] + dir[2] * 5.0f, 1.0f };
+            float v[4], c[4];
+            for ( int col = 0; col < 4; col++ )
+                v[col] = p[0] * view[col] + p[1] * view[4 + col] + p[2] * view[8 + col] + p[3] * view[12 + col];
+            for ( int col = 0; col < 4; col++ )
+                c[col] = v[0] * proj[col] + v[1] * proj[4 + col] + v[2] * proj[8 + col] + v[3] * proj[12 + col];
+            return c[3] > 0.0f && std::fabs( c[0] ) <= c[3] * 1.0001f && std::fabs( c[1] ) <= c[3] * 1.0001f && c[2] >= 0.0f && c[2] <= c[3];
+        };
+
+        bool covered = false;
+        for ( int face = 0; face < 6; face++ )
+            covered |= inside( point, face );
+        check( covered, "cube faces leave a gap" );
+
+        if ( dir[1] < -std::cos( spot.mSpotAngle ) )
+            check( inside( spot, 0 ), "spot frustum misses its cone" );
+    }
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,121 @@
+#include <Core/MeshOptimizer.h>
+#include <Core/ObjLoader.h>
+#include <Core/SceneStream.h>
+#include <GeometryGenerator.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // triangles as rotation independent keys, to compare meshes before and after reordering
+    std::vector<uint64_t> GetTriangleKeys( const std::vector<uint32_t> &indices, const std::vector<uint32_t> *remap )
+    {
+        std::vector<uint64_t> keys;
+        for ( size_t i = 0; i + 2 < indices.size( ); i += 3 )
+        {
+            uint32_t t[3];
+            for ( int k = 0; k < 3; k++ )
+                t[k] = remap ? ( *remap )[indices[i + k]] : indices[i + k];
+            int first = t[0] < t[1] ? ( t[0] < t[2] ? 0 : 2 ) : ( t[1] < t[2] ? 1 : 2 );
+            keys.push_back( ( uint64_t )t[first] << 42 | ( uint64_t )t[( first + 1 ) % 3] << 21 | t[( first + 2 ) % 3] );
+        }
+        std::sort( keys.begin( ), keys.end( ) );
+        return keys;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunMeshOptimizerTest( std::string &failure )
+{
+    TestCheck check;
+
+    // fifo cache of 3: triangle strip reuses 2 vertices per triangle
+    uint32_t strip[] = { 0, 1, 2, 2, 1, 3, 2, 3, 4, 4, 3, 5 };
+    MeshCacheStats stripStats = AnalyzeVertexCache( strip, 12, 6, 3 );
+    check( stripStats.mTransforms == 6 && stripStats.mTriangles == 4 && stripStats.mVertices == 6, "strip must miss once per vertex" );
+    uint32_t revisit[] = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+    check( AnalyzeVertexCache( revisit, 9, 6, 3 ).mTransforms == 9, "fifo of 3 must forget first triangle" );
+    check( AnalyzeVertexCache( revisit, 9, 6, 16 ).GetATVR( ) == 1.0, "big cache must transform every vertex once" );
+
+    // grid with shuffled triangles and vertices
+    const uint32_t side = 64;
+    std::vector<GGVertex> grid;
+    std::vector<uint32_t> gridIndices;
+    for ( uint32_t z = 0; z < side; z++ )
+    {
+        for ( uint32_t x = 0; x < side; x++ )
+            grid.push_back( GGVertex( ( float )x, 0.0f, ( float )z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f ) );
+    }
+    for ( uint32_t z = 0; z + 1 < side; z++ )
+    {
+        for ( uint32_t x = 0; x + 1 < side; x++ )
+        {
+            uint32_t i0 = z * side + x, i1 = i0 + 1, i2 = i0 + side, i3 = i2 + 1;
+            uint32_t quad[] = { i0, i2, i1, i1, i2, i3 };
+            gridIndices.insert( gridIndices.end( ), quad, quad + 6 );
+        }
+    }
+    std::mt19937 rng( 7 );
+    std::vector<uint32_t> order( gridIndices.size( ) / 3 );
+    for ( size_t t = 0; t < order.size( ); t++ )
+        order[t] = static_cast< uint32_t >( t );
+    std::shuffle( order.begin( ), order.end( ), rng );
+    std::vector<uint32_t> shuffled;
+    for ( auto t : order )
+        shuffled.insert( shuffled.end( ), gridIndices.begin( ) + t * 3, gridIndices.begin( ) + t * 3 + 3 );
+
+    std::vector<uint32_t> tipsify( shuffled.size( ) ), clusters;
+    OptimizeVertexCache( tipsify.data( ), shuffled.data( ), shuffled.size( ), grid.size( ), MESH_CACHE_SIZE, &clusters );
+    check( GetTriangleKeys( tipsify, nullptr ) == GetTriangleKeys( shuffled, nullptr ), "tipsify must keep triangles and winding" );
+    check( !clusters.empty( ) && clusters[0] == 0 && std::is_sorted( clusters.begin( ), clusters.end( ) ), "clusters must start at 0 and grow" );
+    double shuffledACMR = AnalyzeVertexCache( shuffled.data( ), shuffled.size( ), grid.size( ) ).GetACMR( );
+    double tipsifyACMR = AnalyzeVertexCache( tipsify.data( ), tipsify.size( ), grid.size( ) ).GetACMR( );
+    check( shuffledACMR > 2.5 && tipsifyACMR < 0.8, "tipsify must bring shuffled grid close to 0.5 acmr" );
+
+    std::vector<uint32_t> overdraw( tipsify.size( ) );
+    OptimizeOverdraw( overdraw.data( ), tipsify.data( ), tipsify.size( ), grid.data( ), sizeof( GGVertex ), grid.size( ), clusters );
+    check( GetTriangleKeys( overdraw, nullptr ) == GetTriangleKeys( shuffled, nullptr ), "overdraw order must keep triangles" );
+    check( AnalyzeVertexCache( overdraw.data( ), overdraw.size( ), grid.size( ) ).GetACMR( ) <= tipsifyACMR * MESH_OVERDRAW_THRESHOLD + 0.05,
+        "overdraw order must keep acmr within threshold" );
+
+    std::vector<uint32_t> fetch = shuffled, remap;
+    OptimizeVertexFetch( fetch.data( ), fetch.size( ), grid.size( ), remap );
+    uint32_t maxSeen = 0;
+    bool firstUse = fetch[0] == 0;
+    for ( auto i : fetch )
+    {
+        firstUse &= i <= maxSeen + 1;
+        maxSeen = ( std::max )( maxSeen, i );
+    }
+    std::vector<uint32_t> sortedRemap = remap;
+    std::sort( sortedRemap.begin( ), sortedRemap.end( ) );
+    check( firstUse && sortedRemap[0] == 0 && sortedRemap.back( ) == grid.size( ) - 1 &&
+        std::adjacent_find( sortedRemap.begin( ), sortedRemap.end( ) ) == sortedRemap.end( ), "fetch remap must be a first use permutation" );
+
+    // whole pass on data: same triangles over moved vertices, better cache and no worse overdraw
+    std::vector<GGVertex> vertices;
+    std::vector<uint32_t> indices;
+    GenerateShuffledSpheres( vertices, indices );
+    std::vector<GGVertex> original = vertices;
+    std::vector<uint32_t> originalIndices = indices;
+    double overdrawBefore = AnalyzeOverdraw( indices.data( ), indices.size( ), vertices.data( ), sizeof( GGVertex ), vertices.size( ) );
+    MeshOptimizeResult result = OptimizeMesh( indices, vertices.data( ), sizeof( GGVertex ), vertices.size( ), remap );
+    RemapVertices( vertices, remap );
+    double overdrawAfter = AnalyzeOverdraw( indices.data( ), indices.size( ), vertices.data( ), sizeof( GGVertex ), vertices.size( ) );
+
+    bool samePositions = GetTriangleKeys( originalIndices, &remap ) == GetTriangleKeys( indices, nullptr );
+    for ( size_t v = 0; v < original.size( ); v++ )
+        samePositions &= vertices[remap[v]].position.x == original[v].position.x && vertices[remap[v]].UVW.y == original[v].UVW.y;
+    check( samePositions, "optimized mesh must have the same triangles" );
+    check( result.mBefore.GetACMR( ) > 2.0 && result.mAfter.GetACMR( ) < 0.8 && result.mAfter.GetATVR( ) < 1.5, "spheres must get cache friendly" );
+    check( overdrawAfter < overdrawBefore, "outer sphere must be drawn before the inner one" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
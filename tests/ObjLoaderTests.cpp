@@ -0,0 +1,83 @@
+#include <Core/ObjLoader.h>
+#include <Core/MeshOptimizer.h>
+#include <Core/TaskScheduler.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunObjLoaderTest( std::string &failure )
+{
+    TestCheck check;
+
+    // quad in two material parts, then a triangle object; quad is a single polygon
+    const char *text =
+        "mtllib scene.mtl\n"
+        "# object floor\n"
+        "v 0 0 0\nv 1 0 0\nv 1 0 1\nv 0 0 1\nv 0 1 0\n"
+        "vt 0 0 0\nvt 1 0 0\nvt 1 1 0\nvt 0 1 0\n"
+        "vn 0 1 0\nvn 0 0 1\n"
+        "usemtl stone\n"
+        "f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+        "usemtl wood\n"
+        "f 1/1/1 3/3/1 4/4/1\n"
+        "# object wall\n"
+        "f 1/1/2 2/2/2 5/4/2\n";
+
+    std::vector<std::string> libs;
+    std::vector<ObjMesh> meshes;
+    ObjCallbacks callbacks;
+    callbacks.mOnMaterialLib = [&]( const std::string &fn ) { libs.push_back( fn ); };
+    callbacks.mOnMesh = [&]( const ObjMesh &mesh ) { meshes.push_back( mesh ); };
+
+    std::istringstream in( text );
+    check( ParseObj( in, "media/", callbacks ), "scene must parse" );
+    check( libs.size( ) == 1 && libs[0] == "media/scene.mtl", "material lib must be relative to obj" );
+    if ( check( meshes.size( ) == 3, "every object and material part must be a mesh" ) )
+    {
+        check( meshes[0].mName == "floor0" && meshes[0].mMaterial == "stone", "first part keeps object name and material" );
+        check( meshes[1].mName == "floor0" && meshes[1].mMaterial == "wood", "parts of an object keep its name" );
+        check( meshes[2].mName == "wall0" && meshes[2].mMaterial.empty( ), "new object resets material" );
+
+        const GGMeshData &quad = meshes[0].mData;
+        check( quad.indicies.size( ) == 6 && quad.verticies.size( ) == 4, "polygon must be a fan with shared vertices" );
+        check( meshes[1].mData.verticies.size( ) == 3, "vertices are shared only inside a mesh" );
+        check( quad.verticies.size( ) == 4 && quad.verticies[2].UVW.y == 0.0f && quad.verticies[0].UVW.y == 1.0f,
+            "texture v must be flipped" );
+        check( quad.verticies.size( ) == 4 && std::fabs( Length( quad.verticies[1].normal ) - 1.0f ) < 1e-5f &&
+            std::fabs( Length( quad.verticies[1].binormal ) - 1.0f ) < 1e-5f, "tangent frame must be normalized" );
+    }
+
+    // workers build the same meshes in the same order
+    TaskScheduler scheduler( 2 );
+    std::vector<ObjMesh> parallelMeshes;
+    callbacks.mScheduler = &scheduler;
+    callbacks.mOnMesh = [&]( const ObjMesh &mesh ) { parallelMeshes.push_back( mesh ); };
+    std::istringstream parallelIn( text );
+    check( ParseObj( parallelIn, "media/", callbacks ) && parallelMeshes.size( ) == meshes.size( ), "scheduler must report every mesh" );
+    for ( size_t i = 0; i < parallelMeshes.size( ) && i < meshes.size( ); i++ )
+    {
+        const GGMeshData &a = meshes[i].mData, &b = parallelMeshes[i].mData;
+        check( parallelMeshes[i].mName == meshes[i].mName && parallelMeshes[i].mMaterial == meshes[i].mMaterial &&
+            a.indicies == b.indicies && a.verticies.size( ) == b.verticies.size( ) &&
+            ( a.verticies.empty( ) || a.verticies.back( ).position.x == b.verticies.back( ).position.x ), "scheduler must keep meshes and order" );
+    }
+
+    // same position with another normal is another vertex
+    std::vector<Vec3> positions( 1, Vec3( 1.0f, 2.0f, 3.0f ) ), normals( 2, Vec3( 0.0f, 1.0f, 0.0f ) ), uvw( 1 );
+    std::vector<ObjFace> faces( 1 );
+    ObjFace face = { { 0, 0, 0, 0, 0, 1, 0, 0, 0 } };
+    faces[0] = face;
+    GGMeshData data;
+    check( BuildObjMesh( positions, normals, uvw, faces, data ) && data.verticies.size( ) == 2 && data.indicies[2] == 0,
+        "vertex key must include normal" );
+    check( !BuildObjMesh( positions, std::vector<Vec3>( ), uvw, faces, data ), "missing normals must be reported" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
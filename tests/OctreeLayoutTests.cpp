@@ -0,0 +1,38 @@
+#include <Core/OctreeLayout.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunOctreeLayoutTest( std::string &failure )
+{
+    TestCheck check;
+
+    check( sizeof( OctreeVoxel ) == 16, "voxel must be 128 bits like the fx struct" );
+
+    uint32_t x, y, z;
+    UnpackOctreePosition( PackOctreePosition( 1023, 5, 700 ), x, y, z );
+    check( x == 1023 && y == 5 && z == 700, "position must round trip at 10 bits" );
+    check( PackOctreePosition( 1, 2, 3 ) == ( 1u | ( 2u << 10 ) | ( 3u << 20 ) ), "position must be PackUint3ToUint" );
+    check( PackColor( 1.0f, 0.5f, -1.0f, 2.0f ) == ( 255u | ( 127u << 8 ) | ( 0u << 16 ) | ( 255u << 24 ) ),
+        "color must be saturated and truncated like PackFloat4ToUint" );
+
+    check( GetChildSlot( 1, 0, 1 ) == 5 && GetChildSlot( 1, 1, 1 ) == 7, "child slot is x + 2y + 4z" );
+    check( GetNeighborSlot( 0, false ) == 8 && GetNeighborSlot( 0, true ) == 9 && GetNeighborSlot( 2, true ) == 13,
+        "neighbor slots must follow NeighborMaskToOffset" );
+    check( GetNeighborSlot( 2, true ) < ONS_PARENT && ONS_FLAGS == SIZE_OF_NODE_STRUCT - 1, "slots must fit the node struct" );
+
+    IndexToOctreeCoords( NodeIDToIndex( 300 ) + ONS_FLAGS, 4096, x, y );
+    check( x == ( 300 * 16 + 15 ) % 4096 && y == 1, "index must map to texture row and column" );
+    check( GetOctreeNodeCapacity( 4096 ) == 1048576, "4096^2 texture holds 1M nodes" );
+    check( GetFullOctreeNodeCount( 1 ) == 1 && GetFullOctreeNodeCount( 3 ) == 73, "full octree counts all node levels" );
+
+    BrickIDToTextureCoords( 85 * 85 + 86, 255, x, y, z );
+    check( x == 3 && y == 3 && z == 3, "brick id must map to 3x3x3 block origin" );
+    check( GetBrickCapacity( 255 ) == 85 * 85 * 85, "255^3 buffer holds 85^3 bricks" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
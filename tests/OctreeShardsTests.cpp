@@ -0,0 +1,180 @@
+#include <Core/OctreeShards.h>
+#include <Core/CpuOctree.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunOctreeShardsTest( std::string &failure )
+{
+    TestCheck check;
+
+    std::mt19937 rng( 11 );
+    auto bakeAndMerge = [&]( const std::vector<OctreeVoxel> &scene, uint32_t height, uint32_t shardLevel, CpuOctree &merged,
+        std::vector<OctreeVoxel> &mergedVoxels, std::vector<std::string> &files ) -> bool
+    {
+        files.clear( );
+        for ( uint32_t shard = 0; shard < GetShardCount( shardLevel ); shard++ )
+        {
+            OctreeShard built;
+            BuildOctreeShard( scene, height, shardLevel, shard, built );
+            std::ostringstream fn;
+            fn << "octree_shard_test_" << shard << ".bin";
+            files.push_back( fn.str( ) );
+            std::string error;
+            if ( !SaveOctreeShard( fn.str( ).c_str( ), built, error ) )
+                return false;
+        }
+        std::vector<std::string> shuffled( files );
+        std::shuffle( shuffled.begin( ), shuffled.end( ), rng );
+        std::string error;
+        return MergeOctreeShards( shuffled, merged, mergedVoxels, error );
+    };
+    auto removeFiles = []( const std::vector<std::string> &files )
+    {
+        for ( const std::string &fn : files )
+            std::remove( fn.c_str( ) );
+    };
+
+    // merged octrees against a single build: the same slots and values as a build of the voxels in shard order, the
+    // same nodes and leaf voxels as a build in input order; clusters, planes and duplicates over a few shard levels
+    struct Case
+    {
+        uint32_t mHeight;
+        uint32_t mShardLevel;
+    };
+    const Case cases[] = { { 3, 0 }, { 4, 1 }, { 5, 2 }, { 3, 2 }, { 6, 1 } };
+    for ( const Case &test : cases )
+    {
+        uint32_t resolution = 1u << test.mHeight;
+        std::uniform_int_distribution<uint32_t> corner( 0, resolution / 2 - 1 ), any( 0, resolution - 1 ), color( 0, 0xffffff );
+        std::vector<OctreeVoxel> scene;
+        for ( int i = 0; i < 200; i++ )
+            scene.push_back( { PackOctreePosition( corner( rng ), corner( rng ), corner( rng ) ), color( rng ), 0, 0 } );
+        for ( int i = 0; i < 150; i++ )
+            scene.push_back( { PackOctreePosition( any( rng ), resolution - 2, any( rng ) ), color( rng ), 0, 0 } );
+        for ( int i = 0; i < 50; i++ )
+            scene.push_back( { scene[any( rng ) % scene.size( )].mPosition, color( rng ), 0, 0 } );
+
+        CpuOctree merged, sharded, single;
+        std::vector<OctreeVoxel> mergedVoxels, inShardOrder;
+        std::vector<std::string> files;
+        if ( !check( bakeAndMerge( scene, test.mHeight, test.mShardLevel, merged, mergedVoxels, files ), "shards must merge" ) )
+        {
+            removeFiles( files );
+            continue;
+        }
+        removeFiles( files );
+
+        for ( uint32_t shard = 0; shard < GetShardCount( test.mShardLevel ); shard++ )
+        {
+            for ( const OctreeVoxel &voxel : scene )
+            {
+                if ( IsVoxelInShard( voxel, test.mHeight, test.mShardLevel, shard ) )
+                    inShardOrder.push_back( voxel );
+            }
+        }
+        sharded.Build( inShardOrder, test.mHeight );
+        single.Build( scene, test.mHeight );
+
+        check( mergedVoxels.size( ) == scene.size( ) && std::equal( mergedVoxels.begin( ), mergedVoxels.end( ), inShardOrder.begin( ),
+            []( const OctreeVoxel &a, const OctreeVoxel &b ) { return a.mPosition == b.mPosition && a.mColor == b.mColor; } ),
+            "merged voxels must be the shard voxels in shard order" );
+        check( merged.GetHeight( ) == test.mHeight && merged.GetSlots( ) == sharded.GetSlots( ), "merged slots must match a single build" );
+
+        bool levels = true, values = true;
+        for ( uint32_t level = 0; level <= test.mHeight; level++ )
+            levels &= merged.GetLevelOffset( level ) == single.GetLevelOffset( level );
+        for ( size_t id = 0; values && id < merged.GetNodeCount( ); id++ )
+        {
+            uint32_t index = NodeIDToIndex( static_cast< uint32_t >( id ) );
+            values = memcmp( &merged.GetValue( index ), &sharded.GetValue( index ), sizeof( OctreeNodeValue ) ) == 0;
+        }
+        check( levels, "level offsets must match a single build" );
+        check( values, "node values must match a single build" );
+
+        // against the input order only the voxel ids of the leaves differ
+        bool nodes = merged.GetNodeCount( ) == single.GetNodeCount( );
+        size_t lastLevel = merged.GetLevelOffset( test.mHeight - 1 );
+        for ( size_t slot = 0; nodes && slot < merged.GetSlots( ).size( ); slot++ )
+        {
+            uint32_t a = merged.Fetch( static_cast< uint32_t >( slot ) ), b = single.Fetch( static_cast< uint32_t >( slot ) );
+            bool leaf = slot / SIZE_OF_NODE_STRUCT >= lastLevel && slot % SIZE_OF_NODE_STRUCT < CHILDS_COUNT;
+            if ( leaf && a != NODE_UNDEFINED && b != NODE_UNDEFINED )
+                nodes = mergedVoxels[a].mPosition == scene[b].mPosition && mergedVoxels[a].mColor == scene[b].mColor;
+            else
+                nodes = a == b;
+        }
+        check( nodes, "merged nodes must match a build in input order" );
+    }
+
+    // voxel files give every shard its own voxels
+    const uint32_t height = 5, shardLevel = 1;
+    std::vector<OctreeVoxel> voxels;
+    std::vector<OctreeVoxel> loaded, all;
+    std::uniform_int_distribution<uint32_t> any( 0, ( 1u << height ) - 1 );
+    for ( int i = 0; i < 500; i++ )
+        voxels.push_back( { PackOctreePosition( any( rng ), any( rng ), any( rng ) ), static_cast< uint32_t >( i ), 0, 0 } );
+    std::string error;
+    const char *voxelFile = "octree_shard_test_voxels.bin";
+    check( SaveVoxelFile( voxelFile, voxels, error ) && LoadVoxelFile( voxelFile, height, 0, 0, all, error ) && all.size( ) == voxels.size( ),
+        "voxel file must round trip" );
+    size_t total = 0;
+    bool own = true;
+    for ( uint32_t shard = 0; shard < GetShardCount( shardLevel ); shard++ )
+    {
+        own &= LoadVoxelFile( voxelFile, height, shardLevel, shard, loaded, error );
+        for ( const OctreeVoxel &voxel : loaded )
+            own &= IsVoxelInShard( voxel, height, shardLevel, shard );
+        total += loaded.size( );
+    }
+    check( own && total == voxels.size( ), "every voxel must go to exactly one shard" );
+    std::remove( voxelFile );
+
+    // broken sets of shards fail
+    std::vector<std::string> files;
+    CpuOctree merged;
+    std::vector<OctreeVoxel> mergedVoxels;
+    check( bakeAndMerge( voxels, height, shardLevel, merged, mergedVoxels, files ), "voxels shards must merge" );
+    std::vector<std::string> missing( files.begin( ), files.end( ) - 1 );
+    check( !MergeOctreeShards( missing, merged, mergedVoxels, error ) && error == "shards are missing", "missing shard must fail" );
+    std::vector<std::string> twice( files );
+    twice.back( ) = twice.front( );
+    check( !MergeOctreeShards( twice, merged, mergedVoxels, error ), "shard twice must fail" );
+
+    OctreeShard other;
+    BuildOctreeShard( voxels, height, shardLevel + 1, 3, other );
+    SaveOctreeShard( files[3].c_str( ), other, error );
+    check( !MergeOctreeShards( files, merged, mergedVoxels, error ), "shards of another level must fail" );
+
+    BuildOctreeShard( voxels, height, shardLevel, 3, other );
+    SaveOctreeShard( files[3].c_str( ), other, error );
+    {
+        std::ifstream in( files[3].c_str( ), std::ifstream::binary );
+        std::string bytes( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>( ) );
+        in.close( );
+        std::ofstream out( files[3].c_str( ), std::ofstream::binary | std::ofstream::trunc );
+        out.write( bytes.data( ), bytes.size( ) - 4 );
+    }
+    check( !MergeOctreeShards( files, merged, mergedVoxels, error ) && error.find( "truncated" ) != std::string::npos,
+        "truncated shard must fail" );
+    {
+        std::ofstream out( files[3].c_str( ), std::ofstream::binary | std::ofstream::trunc );
+        out << "not a shard";
+    }
+    check( !MergeOctreeShards( files, merged, mergedVoxels, error ) && error.find( "not an octree shard" ) != std::string::npos,
+        "foreign file must fail" );
+    removeFiles( files );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
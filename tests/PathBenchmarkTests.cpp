@@ -0,0 +1,49 @@
+#include <Core/PathBenchmark.h>
+#include <Core/CameraPath.h>
+#include <Core/Culling.h>
+#include <Core/ShadowCascades.h>
+#include <Core/VMath.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunPathBenchmarkTest( std::string &failure )
+{
+    TestCheck check;
+
+    std::vector<double> ms;
+    for ( int i = 100; i >= 1; i-- )
+        ms.push_back( i );
+    FramePercentiles p = ComputeFramePercentiles( ms );
+    check( p.mCount == 100 && p.mMin == 1.0 && p.mMax == 100.0 && p.mMean == 50.5, "min, max and mean of 1..100" );
+    check( p.mP50 == 50.0 && p.mP90 == 90.0 && p.mP95 == 95.0 && p.mP99 == 99.0, "nearest rank percentiles of 1..100" );
+    check( ComputeFramePercentiles( std::vector<double>( 1, 7.0 ) ).mP99 == 7.0, "single frame is every percentile" );
+
+    // camera in front of the scene center looking at it sees something, looking away sees less
+    CameraPath orbit = MakeOrbitPath( 1500.0f, 600.0f, 10.0f );
+    PathBenchmarkReport a = RunCpuPathBenchmark( orbit, 40, 2000 );
+    PathBenchmarkReport b = RunCpuPathBenchmark( orbit, 40, 2000 );
+    check( a.mFrames.size( ) == 40, "every frame must be reported" );
+
+    bool same = a.mFrames.size( ) == b.mFrames.size( );
+    bool anyVisible = false;
+    for ( size_t i = 0; same && i < a.mFrames.size( ); i++ )
+    {
+        same &= a.mFrames[i].mVisible == b.mFrames[i].mVisible && a.mFrames[i].mShadowRedraws == b.mFrames[i].mShadowRedraws;
+        anyVisible |= a.mFrames[i].mVisible > 0;
+    }
+    check( same, "replay must be deterministic" );
+    check( anyVisible, "orbit must look at the scene" );
+    check( !a.mFrames.empty( ) && a.mFrames[0].mShadowRedraws == ShadowCascadeParams( ).mCount + 1, "first frame must draw all shadow maps" );
+
+    std::string json = a.ToJson( );
+    check( json.find( "\"frames\": 40" ) != std::string::npos && json.find( "\"p99\": " ) != std::string::npos &&
+        json.find( "\"frame_ms\": [" ) != std::string::npos, "json must hold summary and per frame data" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
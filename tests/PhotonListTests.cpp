@@ -0,0 +1,103 @@
+#include <Core/PhotonList.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    bool LeafIs( const PhotonLeaf &leaf, uint32_t key, uint32_t count, float r, float g, float b )
+    {
+        return leaf.mKey == key && leaf.mCount == count && std::fabs( leaf.mFlux[0] - r ) < 1e-6f &&
+            std::fabs( leaf.mFlux[1] - g ) < 1e-6f && std::fabs( leaf.mFlux[2] - b ) < 1e-6f;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunPhotonListTest( std::string &failure )
+{
+    TestCheck check;
+
+    // morton keys interleave x, y, z from bit 0: x = 011, y = 101, z = 110 gives bits 0 1 3 5 7 8
+    uint32_t x, y, z;
+    check( MortonEncode( 1, 0, 0 ) == 1 && MortonEncode( 0, 1, 0 ) == 2 && MortonEncode( 0, 0, 1 ) == 4 &&
+        MortonEncode( 3, 5, 6 ) == 427 && MortonEncode( 1023, 1023, 1023 ) == 0x3fffffff, "morton keys must interleave the coords" );
+    MortonDecode( 427, x, y, z );
+    check( x == 3 && y == 5 && z == 6, "morton decode must give the coords back" );
+
+    // 8^3 leaves over [0, 8]: points on the max side go to the last leaf, points outside are dropped
+    PhotonGrid grid = { { 0.0f, 0.0f, 0.0f }, { 8.0f, 8.0f, 8.0f }, 8 };
+    const float positions[] = {
+        0.5f, 0.5f, 0.5f,
+        -0.1f, 1.0f, 1.0f,
+        7.9f, 0.0f, 0.0f,
+        8.0f, 8.0f, 8.0f,
+        1.0f, 9.0f, 1.0f,
+        3.5f, 5.5f, 6.5f
+    };
+    const uint32_t flux[] = { 10, 11, 12, 13, 14, 15 };
+    std::vector<Photon> photons;
+    CompactPhotons( positions, flux, 6, grid, photons );
+    check( photons.size( ) == 4 && photons[0].mKey == 0 && photons[0].mFlux == 10 && photons[1].mKey == 73 && photons[1].mFlux == 12 &&
+        photons[2].mKey == 511 && photons[2].mFlux == 13 && photons[3].mKey == 427 && photons[3].mFlux == 15,
+        "compaction must keep the photons inside the grid in order with their leaf keys" );
+
+    // equal keys keep their order, a key above 16 bits needs the third radix pass; flux is the input index
+    const uint32_t keys[] = { 5, 1, 5, 0x10000, 1, 0, 0x10005 };
+    const uint32_t sortedIndices[] = { 5, 1, 4, 0, 2, 3, 6 };
+    photons.clear( );
+    for ( uint32_t i = 0; i < 7; i++ )
+    {
+        Photon photon = { keys[i], i };
+        photons.push_back( photon );
+    }
+    std::vector<Photon> scratch;
+    SortPhotons( photons, scratch );
+    bool sorted = photons.size( ) == 7;
+    for ( size_t i = 0; sorted && i < photons.size( ); i++ )
+        sorted = photons[i].mFlux == sortedIndices[i] && photons[i].mKey == keys[sortedIndices[i]];
+    check( sorted, "photons must sort by key and keep the order of equal keys" );
+
+    // leaf ranges: keys 0 0 3 7 7 7, flux channels are r | g << 8 | b << 16
+    const uint32_t leafKeys[] = { 0, 0, 3, 7, 7, 7 };
+    const uint32_t leafFlux[] = { 0xff, 0xff00, 0xff0000, 0x3300ff, 0x330000, 0x3300ff };
+    photons.clear( );
+    for ( int i = 0; i < 6; i++ )
+    {
+        Photon photon = { leafKeys[i], leafFlux[i] };
+        photons.push_back( photon );
+    }
+    std::vector<PhotonLeaf> leaves;
+    ReducePhotons( photons, leaves );
+    check( leaves.size( ) == 3 && LeafIs( leaves[0], 0, 2, 0.5f, 0.5f, 0.0f ) && LeafIs( leaves[1], 3, 1, 0.0f, 0.0f, 1.0f ) &&
+        LeafIs( leaves[2], 7, 3, 2.0f / 3.0f, 0.0f, 0.2f ), "reduce must give one leaf per key with its count and average" );
+
+    // every photon in one leaf, unsorted on purpose: sorting doesn't reorder equal keys
+    photons.assign( 1000, Photon( ) );
+    for ( size_t i = 0; i < photons.size( ); i++ )
+    {
+        photons[i].mKey = 427;
+        photons[i].mFlux = i % 2 == 0 ? 0xff : 0xff00;
+    }
+    SortPhotons( photons, scratch );
+    ReducePhotons( photons, leaves );
+    check( photons[0].mFlux == 0xff && photons[1].mFlux == 0xff00 && leaves.size( ) == 1 && LeafIs( leaves[0], 427, 1000, 0.5f, 0.5f, 0.0f ),
+        "photons of a single leaf must reduce to that leaf" );
+
+    // empty input
+    photons.clear( );
+    SortPhotons( photons, scratch );
+    ReducePhotons( photons, leaves );
+    CompactPhotons( positions, flux, 0, grid, photons );
+    check( photons.empty( ) && leaves.empty( ), "no photons must give no leaves" );
+
+    // compaction, radix sort and reduce of a synthetic height field against std::stable_sort and std::map
+    check( RunPhotonListBenchmark( 256, 128, 1 ).mMatchesReference, "photon list doesn't match reference sort/reduce" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,292 @@
+#include <Core/ProbeGrid.h>
+#include <Core/CompactVertex.h>
+#include <Core/TaskScheduler.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunProbeGridTest( std::string &failure )
+{
+    TestCheck check;
+
+    // the basis is orthonormal over the sphere
+    std::vector<float> directions, projection;
+    GetProbeDirections( 4096, directions );
+    bool orthonormal = true;
+    for ( uint32_t i = 0; i < SH_L2_COEFFICIENTS; i++ )
+    {
+        for ( uint32_t j = 0; j < SH_L2_COEFFICIENTS; j++ )
+        {
+            double sum = 0.0;
+            for ( size_t d = 0; d < directions.size( ) / 3; d++ )
+            {
+                float basis[SH_L2_COEFFICIENTS];
+                EvaluateSH( &directions[d * 3], basis );
+                sum += basis[i] * basis[j];
+            }
+            sum *= 4.0 * 3.14159265358979 / ( directions.size( ) / 3 );
+            orthonormal &= std::fabs( sum - ( i == j ? 1.0 : 0.0 ) ) < 0.01;
+        }
+    }
+    check( orthonormal, "sh basis must be orthonormal" );
+
+    // the fit gives back the coefficients of a band limited function
+    std::mt19937 rng( 9 );
+    std::uniform_real_distribution<float> coefficient( -1.0f, 1.0f );
+    GetProbeDirections( 2 * SH_L2_COEFFICIENTS, directions );
+    check( BuildSHProjection( directions, SH_L2_COEFFICIENTS, projection ), "fibonacci directions must determine L2" );
+    float expected[SH_L2_COEFFICIENTS];
+    for ( float &c : expected )
+        c = coefficient( rng );
+    std::vector<float> samples( directions.size( ) / 3, 0.0f );
+    for ( size_t j = 0; j < samples.size( ); j++ )
+    {
+        float basis[SH_L2_COEFFICIENTS];
+        EvaluateSH( &directions[j * 3], basis );
+        for ( uint32_t k = 0; k < SH_L2_COEFFICIENTS; k++ )
+            samples[j] += expected[k] * basis[k];
+    }
+    bool recovered = projection.size( ) == SH_L2_COEFFICIENTS * samples.size( );
+    for ( uint32_t k = 0; recovered && k < SH_L2_COEFFICIENTS; k++ )
+    {
+        float value = 0.0f;
+        for ( size_t j = 0; j < samples.size( ); j++ )
+            value += projection[k * samples.size( ) + j] * samples[j];
+        recovered = std::fabs( value - expected[k] ) < 1e-4f;
+    }
+    check( recovered, "projection must recover band limited coefficients" );
+    GetProbeDirections( 4, directions );
+    check( !BuildSHProjection( directions, SH_L2_COEFFICIENTS, projection ), "too few directions must fail" );
+
+    // room bake: thread count doesn't matter, probes follow TraceCones and L2 follows it closer than L1
+    const uint32_t height = 5;
+    std::vector<OctreeVoxel> voxels;
+    std::vector<ConeTracePoint> surface;
+    GenerateConeTestRoom( height, voxels, surface );
+    CpuOctree octree;
+    octree.Build( voxels, height );
+
+    ConeTraceParams params;
+    params.mFirstLevel = height - 1;
+    params.mLastLevel = 1;
+    float voxelSize = ( params.mMax[0] - params.mMin[0] ) / octree.GetResolution( );
+    params.mWorldConeOffset = voxelSize * 1.5f;
+
+    ProbeBakeParams bake;
+    bake.mResolution[0] = 3;
+    bake.mResolution[1] = 4;
+    bake.mResolution[2] = 5;
+    bake.mDirections = 24;
+
+    TaskScheduler serial( 0 );
+    TaskScheduler parallel( 3 );
+    ProbeGrid grid, other, l1;
+    grid.Bake( octree, params, bake, serial );
+    other.Bake( octree, params, bake, parallel );
+    bake.mCoefficients = SH_L1_COEFFICIENTS;
+    l1.Bake( octree, params, bake, parallel );
+
+    check( grid.GetProbeCount( ) == 60 && grid.GetStats( ).mProbes == 60 && grid.GetCoefficientCount( ) == SH_L2_COEFFICIENTS &&
+        l1.GetCoefficientCount( ) == SH_L1_COEFFICIENTS, "grid must have a probe per cell" );
+    check( grid.GetStats( ).mTraces == ( 60 - grid.GetStats( ).mInvalidProbes ) * 24 &&
+        grid.GetStats( ).mMarch.mFetches == other.GetStats( ).mMarch.mFetches, "bake stats must not depend on threads" );
+
+    bool same = true;
+    double errorL1 = 0.0, errorL2 = 0.0;
+    size_t fits = 0;
+    GetProbeDirections( 24, directions );
+    for ( uint32_t z = 0; z < 5; z++ )
+    {
+        for ( uint32_t y = 0; y < 4; y++ )
+        {
+            for ( uint32_t x = 0; x < 3; x++ )
+            {
+                same &= grid.IsValid( x, y, z ) == other.IsValid( x, y, z ) && std::equal( grid.GetCoefficients( x, y, z ),
+                    grid.GetCoefficients( x, y, z ) + 4 * SH_L2_COEFFICIENTS, other.GetCoefficients( x, y, z ) );
+                if ( !grid.IsValid( x, y, z ) )
+                    continue;
+
+                uint32_t cell[3] = { x, y, z };
+                float position[3];
+                for ( int a = 0; a < 3; a++ )
+                    position[a] = params.mMin[a] + ( cell[a] + 0.5f ) / bake.mResolution[a] * ( params.mMax[a] - params.mMin[a] );
+
+                // a lookup that the normal offset moves onto a probe center is that probe alone
+                float expectedResult[4], probed[4], behind[3];
+                for ( int a = 0; a < 3; a++ )
+                    behind[a] = position[a] - directions[a] * 0.25f * ( params.mMax[a] - params.mMin[a] ) / bake.mResolution[a];
+                EvaluateProbe( grid.GetCoefficients( x, y, z ), SH_L2_COEFFICIENTS, &directions[0], expectedResult );
+                bool centered = grid.Evaluate( behind, &directions[0], probed );
+                for ( int c = 0; c < 4; c++ )
+                    centered &= std::fabs( probed[c] - expectedResult[c] ) < 1e-4f;
+                check( centered, "probe center must evaluate its probe" );
+
+                for ( size_t j = 0; j < directions.size( ) / 3; j++ )
+                {
+                    OctreeMarchStats stats;
+                    float traced[4], fitL1[4], fitL2[4];
+                    TraceCones( octree, params, position, &directions[j * 3], CL_ROPES, traced, stats );
+                    EvaluateProbe( l1.GetCoefficients( x, y, z ), SH_L1_COEFFICIENTS, &directions[j * 3], fitL1 );
+                    EvaluateProbe( grid.GetCoefficients( x, y, z ), SH_L2_COEFFICIENTS, &directions[j * 3], fitL2 );
+                    for ( int c = 0; c < 4; c++ )
+                    {
+                        errorL1 += std::fabs( fitL1[c] - traced[c] );
+                        errorL2 += std::fabs( fitL2[c] - traced[c] );
+                    }
+                    fits += 4;
+                }
+            }
+        }
+    }
+    check( same, "serial and parallel bakes must be equal" );
+    check( fits > 0 && errorL2 <= errorL1 && errorL2 / fits < 0.05, "probe sh must follow the traced cones" );
+
+    // the grid in place of TraceCones at surface points; cones of a surface point pick up the voxels of the surface
+    // itself, which no probe sees, so this stays far above the fit error
+    double surfaceDifference = 0.0;
+    size_t surfacePoints = 0;
+    for ( size_t i = 0; i < surface.size( ); i += 7 )
+    {
+        float position[3], probed[4], traced[4];
+        for ( int a = 0; a < 3; a++ )
+            position[a] = params.mMin[a] + surface[i].mPosition[a] * voxelSize;
+        OctreeMarchStats stats;
+        if ( !grid.Evaluate( position, surface[i].mNormal, probed ) )
+            continue;
+        TraceCones( octree, params, position, surface[i].mNormal, CL_ROPES, traced, stats );
+        for ( int c = 0; c < 4; c++ )
+            surfaceDifference += std::fabs( probed[c] - traced[c] ) / 4.0;
+        surfacePoints++;
+    }
+    check( surfacePoints > 0 && surfaceDifference / surfacePoints < 0.12, "probes must follow the traced cones at the surface" );
+
+    // probes inside voxels are skipped and the others fill in for them
+    std::vector<OctreeVoxel> solid;
+    for ( uint32_t z = 0; z < 16; z++ )
+    {
+        for ( uint32_t y = 0; y < 16; y++ )
+        {
+            for ( uint32_t x = 0; x < 9; x++ )
+            {
+                OctreeVoxel voxel = { };
+                voxel.mPosition = PackOctreePosition( x, y, z );
+                voxel.mColor = 0xff4080c0;
+                solid.push_back( voxel );
+            }
+        }
+    }
+    CpuOctree half;
+    half.Build( solid, 4 );
+    ConeTraceParams solidParams;
+    solidParams.mFirstLevel = 3;
+    solidParams.mLastLevel = 0;
+
+    ProbeBakeParams solidBake;
+    solidBake.mResolution[0] = solidBake.mResolution[1] = solidBake.mResolution[2] = 2;
+    grid.Bake( half, solidParams, solidBake, parallel );
+    check( grid.GetStats( ).mInvalidProbes == 4 && !grid.IsValid( 0, 1, 1 ) && grid.IsValid( 1, 1, 1 ), "probes in voxels must be invalid" );
+
+    // the surface of the solid half between the probes of both halves
+    float cellSize = ( solidParams.mMax[0] - solidParams.mMin[0] ) / 2.0f, up[3] = { 0.0f, 1.0f, 0.0f }, right[3] = { 1.0f, 0.0f, 0.0f };
+    float inside[3] = { cellSize * 0.75f, cellSize * 0.5f, cellSize * 0.5f };
+    float probe[3] = { cellSize * 1.25f, cellSize * 0.5f, cellSize * 0.5f };
+    float blended[4], alone[4];
+    bool skipped = grid.Evaluate( inside, right, blended ) && grid.Evaluate( probe, right, alone );
+    for ( int c = 0; skipped && c < 4; c++ )
+        skipped = std::fabs( blended[c] - alone[c] ) < 1e-4f;
+    check( skipped, "invalid probes must not take part in the blend" );
+
+    // a thin white wall at x = 7 with a red floor left of it: the right face of the wall gets its probes from the right,
+    // the probes left of the wall see the red floor and mustn't leak it through
+    std::vector<OctreeVoxel> wall;
+    for ( uint32_t z = 0; z < 16; z++ )
+    {
+        for ( uint32_t y = 0; y < 16; y++ )
+        {
+            OctreeVoxel voxel = { };
+            voxel.mPosition = PackOctreePosition( 7, y, z );
+            voxel.mColor = PackColor( 0.8f, 0.8f, 0.8f, 1.0f );
+            wall.push_back( voxel );
+        }
+        for ( uint32_t x = 0; x < 7; x++ )
+        {
+            OctreeVoxel voxel = { };
+            voxel.mPosition = PackOctreePosition( x, 0, z );
+            voxel.mColor = PackColor( 1.0f, 0.0f, 0.0f, 1.0f );
+            wall.push_back( voxel );
+        }
+    }
+    CpuOctree walled;
+    walled.Build( wall, 4 );
+    ConeTraceParams wallParams;
+    wallParams.mFirstLevel = 3;
+    wallParams.mLastLevel = 0;
+    float wallVoxel = ( wallParams.mMax[0] - wallParams.mMin[0] ) / 16.0f;
+    wallParams.mWorldConeOffset = wallVoxel * 1.5f;
+
+    ProbeBakeParams wallBake;
+    wallBake.mResolution[0] = wallBake.mResolution[1] = wallBake.mResolution[2] = 4;
+    ProbeGrid wallGrid;
+    wallGrid.Bake( walled, wallParams, wallBake, parallel );
+
+    // between the probes of x = 6 and x = 10 at the height and depth of a probe
+    float face[3] = { wallVoxel * 7.5f, wallVoxel * 2.0f, wallVoxel * 10.0f }, wallResult[4], leftProbe[4], rightProbe[4];
+    EvaluateProbe( wallGrid.GetCoefficients( 1, 0, 2 ), SH_L2_COEFFICIENTS, right, leftProbe );
+    EvaluateProbe( wallGrid.GetCoefficients( 2, 0, 2 ), SH_L2_COEFFICIENTS, right, rightProbe );
+    check( wallGrid.Evaluate( face, right, wallResult ) && leftProbe[0] > rightProbe[0] + 0.2f &&
+        std::fabs( wallResult[0] - rightProbe[0] ) * 4.0f < std::fabs( wallResult[0] - leftProbe[0] ), "probes behind a wall must not leak through it" );
+
+    solidBake.mResolution[0] = solidBake.mResolution[1] = solidBake.mResolution[2] = 1;
+    other.Bake( half, solidParams, solidBake, parallel );
+    check( !other.IsValid( 0, 0, 0 ) && !other.Evaluate( probe, up, alone ), "grid without valid probes must not evaluate" );
+
+    // half float file round trip, truncated and foreign files fail
+    const char *fn = "probe_grid_test.bin";
+    std::string error;
+    check( grid.Save( fn, error ), "grid must save" );
+    std::ifstream written( fn, std::ifstream::binary | std::ifstream::ate );
+    check( written && static_cast< size_t >( written.tellg( ) ) == grid.GetFileSize( ), "file size must be GetFileSize" );
+    written.close( );
+
+    ProbeGrid loaded;
+    bool matches = loaded.Load( fn, error ) && loaded.GetCoefficientCount( ) == grid.GetCoefficientCount( ) &&
+        loaded.GetProbeCount( ) == grid.GetProbeCount( );
+    for ( uint32_t i = 0; matches && i < 8; i++ )
+    {
+        uint32_t x = i & 1, y = i >> 1 & 1, z = i >> 2;
+        matches = loaded.IsValid( x, y, z ) == grid.IsValid( x, y, z );
+        for ( uint32_t k = 0; matches && k < 4 * SH_L2_COEFFICIENTS; k++ )
+        {
+            float a = loaded.GetCoefficients( x, y, z )[k], b = grid.GetCoefficients( x, y, z )[k];
+            matches = std::fabs( a - b ) <= 1e-3f * std::fabs( b ) + 1e-6f;
+        }
+    }
+    check( matches, "loaded grid must match the baked one" );
+
+    {
+        std::ifstream in( fn, std::ifstream::binary );
+        std::string bytes( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>( ) );
+        in.close( );
+        std::ofstream out( fn, std::ofstream::binary | std::ofstream::trunc );
+        out.write( bytes.data( ), bytes.size( ) - 2 );
+    }
+    check( !loaded.Load( fn, error ) && error == "probes are truncated", "truncated file must fail" );
+    {
+        std::ofstream out( fn, std::ofstream::binary | std::ofstream::trunc );
+        out << "not a grid at all, just some text";
+    }
+    check( !loaded.Load( fn, error ) && error == "not a probe grid", "foreign file must fail" );
+    std::remove( fn );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,131 @@
+#include <Core/RangeAllocator.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunRangeAllocatorTest( std::string &failure )
+{
+    TestCheck check;
+
+    // alloc: ranges go back to back from the start, zero size and too big ranges fail
+    RangeAllocator allocator( 100 );
+    size_t a = allocator.Allocate( 10 ), b = allocator.Allocate( 20 ), c = allocator.Allocate( 30 );
+    check( a == 0 && b == 10 && c == 30, "ranges must be allocated back to back" );
+    check( allocator.GetUsed( ) == 60 && allocator.GetAllocationSize( b ) == 20 && allocator.GetAllocationSize( 5 ) == 0,
+        "used space and allocation sizes must be tracked" );
+    check( allocator.Allocate( 0 ) == RangeAllocator::INVALID_OFFSET, "zero size must fail" );
+    check( allocator.Allocate( 41 ) == RangeAllocator::INVALID_OFFSET, "range bigger than free space must fail" );
+    RangeAllocatorStats stats = allocator.GetStats( );
+    check( stats.mAllocationCount == 3 && stats.mFree == 40 && stats.mFreeBlockCount == 1 && stats.mLargestFreeBlock == 40 &&
+        stats.mFragmentation == 0.0f, "one free block must not be fragmented" );
+
+    // free: a hole in the middle fragments the free space
+    check( allocator.Free( b ), "known range must be freed" );
+    stats = allocator.GetStats( );
+    check( stats.mUsed == 40 && stats.mFreeBlockCount == 2 && stats.mLargestFreeBlock == 40 &&
+        std::fabs( stats.mFragmentation - ( 1.0f - 40.0f / 60.0f ) ) < 1e-6f, "hole must show as fragmentation" );
+
+    // best fit: the hole of 20 takes a range of 15 although the tail is bigger
+    size_t d = allocator.Allocate( 15 );
+    check( d == 10, "best fit must take the smallest block that holds the range" );
+    check( allocator.Allocate( 41 ) == RangeAllocator::INVALID_OFFSET, "fragmented space must not give a range of its sum" );
+
+    // coalesce: freeing the neighbours of a hole leaves one block again, left, right and both sides
+    allocator.Free( d );
+    allocator.Free( a );
+    stats = allocator.GetStats( );
+    check( stats.mFreeBlockCount == 2 && stats.mLargestFreeBlock == 40, "left neighbour must coalesce" );
+    allocator.Free( c );
+    stats = allocator.GetStats( );
+    check( stats.mFreeBlockCount == 1 && stats.mLargestFreeBlock == 100 && stats.mUsed == 0 && stats.mAllocationCount == 0,
+        "both neighbours must coalesce into the whole capacity" );
+    size_t left = allocator.Allocate( 50 ), right = allocator.Allocate( 50 );
+    allocator.Free( right );
+    allocator.Free( left );
+    check( allocator.GetStats( ).mFreeBlockCount == 1, "right neighbour must coalesce" );
+
+    // grow: new space merges with a free tail and keeps allocations
+    RangeAllocator growing( 64 );
+    size_t head = growing.Allocate( 32 );
+    growing.Grow( 128 );
+    stats = growing.GetStats( );
+    check( head == 0 && growing.GetAllocationSize( head ) == 32 && stats.mCapacity == 128 && stats.mFreeBlockCount == 1 &&
+        stats.mLargestFreeBlock == 96, "grow must extend the free tail" );
+    growing.Allocate( 96 );
+    growing.Grow( 160 );
+    check( growing.GetStats( ).mFreeBlockCount == 1 && growing.Allocate( 32 ) == 128, "grow of a full allocator must append a block" );
+    growing.Grow( 100 );
+    check( growing.GetCapacity( ) == 160, "grow must never shrink" );
+    growing.Reset( 10 );
+    check( growing.GetUsed( ) == 0 && growing.GetStats( ).mLargestFreeBlock == 10 && growing.GetAllocationSize( head ) == 0,
+        "reset must drop all allocations" );
+
+    // fragmentation: random alloc and free against a map of live ranges, ranges never overlap and free space adds up;
+    // freeing everything in any order ends with one block
+    const size_t capacity = 1 << 16;
+    RangeAllocator random( capacity );
+    std::map<size_t, size_t> live;
+    std::mt19937 rng( 11 );
+    std::uniform_int_distribution<size_t> sizeDist( 1, 700 );
+    bool disjoint = true, accounted = true, peakFragmented = false;
+    for ( int step = 0; step < 20000; step++ )
+    {
+        if ( live.empty( ) || rng( ) % 3 != 0 )
+        {
+            size_t size = sizeDist( rng );
+            size_t offset = random.Allocate( size );
+            if ( offset == RangeAllocator::INVALID_OFFSET )
+            {
+                accounted = accounted && random.GetStats( ).mLargestFreeBlock < size;
+                continue;
+            }
+            auto next = live.lower_bound( offset );
+            disjoint = disjoint && offset + size <= capacity && ( next == live.end( ) || offset + size <= next->first );
+            if ( next != live.begin( ) )
+            {
+                --next;
+                disjoint = disjoint && next->first + next->second <= offset;
+            }
+            live[offset] = size;
+        }
+        else
+        {
+            auto it = live.begin( );
+            std::advance( it, rng( ) % live.size( ) );
+            random.Free( it->first );
+            live.erase( it );
+        }
+
+        size_t used = 0;
+        for ( const auto &range : live )
+            used += range.second;
+        stats = random.GetStats( );
+        accounted = accounted && stats.mUsed == used && stats.mFree == capacity - used && stats.mAllocationCount == live.size( );
+        peakFragmented = peakFragmented || stats.mFragmentation > 0.5f;
+    }
+    check( disjoint, "allocations must not overlap" );
+    check( accounted, "used space, counts and failed allocations must match the live ranges" );
+    check( peakFragmented, "random churn must fragment the free space" );
+
+    std::vector<size_t> offsets;
+    for ( const auto &range : live )
+        offsets.push_back( range.first );
+    std::shuffle( offsets.begin( ), offsets.end( ), rng );
+    for ( size_t offset : offsets )
+        random.Free( offset );
+    stats = random.GetStats( );
+    check( stats.mUsed == 0 && stats.mFreeBlockCount == 1 && stats.mLargestFreeBlock == capacity && stats.mFragmentation == 0.0f,
+        "freeing everything must coalesce into one block" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,117 @@
+#include <Core/RenderQueue.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunRenderQueueTest( std::string &failure )
+{
+    TestCheck check;
+
+    // key packing: every field round trips at its limits and the technique outranks the material outranks the textures
+    uint64_t key = RenderQueue::PackKey( 0xff, 0xffffff, 0xffff, 0xffff );
+    check( key == ~uint64_t( 0 ), "full fields must fill the key" );
+    key = RenderQueue::PackKey( 0x12, 0x345678, 0x9abc, 0xdef0 );
+    check( RenderQueue::GetTechnique( key ) == 0x12 && RenderQueue::GetMaterial( key ) == 0x345678 &&
+        RenderQueue::GetAlbedoTexture( key ) == 0x9abc && RenderQueue::GetNormalTexture( key ) == 0xdef0, "key fields must round trip" );
+    check( RenderQueue::PackKey( 1, 0, 0, 0 ) > RenderQueue::PackKey( 0, 0xffffff, 0xffff, 0xffff ) &&
+        RenderQueue::PackKey( 0, 1, 0, 0 ) > RenderQueue::PackKey( 0, 0, 0xffff, 0xffff ) &&
+        RenderQueue::PackKey( 0, 0, 1, 0 ) > RenderQueue::PackKey( 0, 0, 0, 0xffff ), "key fields must sort in layout order" );
+
+    // merging: equal key, equal page and touching ranges only
+    const uint64_t keyA = RenderQueue::PackKey( 0, 1, 0, 0 ), keyB = RenderQueue::PackKey( 0, 2, 0, 0 );
+    RenderQueue queue;
+    queue.Push( keyA, 0, 0, 10, 10 );
+    queue.Push( keyB, 1, 0, 20, 5 ); // touches the A ranges but has another key
+    queue.Push( keyA, 2, 0, 0, 10 );
+    queue.Push( keyA, 3, 0, 30, 5 ); // gap after 20
+    queue.Push( keyA, 4, 1, 35, 5 ); // touches the last range on another page
+    queue.Push( keyB, 5, 0, 25, 5 );
+    queue.Build( );
+    const std::vector<RenderBatch> &batches = queue.GetBatches( );
+    check( batches.size( ) == 4, "only adjacent ranges of one key and page must merge" );
+    if ( batches.size( ) == 4 )
+    {
+        check( batches[0].mKey == keyA && batches[0].mPage == 0 && batches[0].mFirstIndex == 0 && batches[0].mIndexCount == 20 &&
+            batches[0].mItemCount == 2 && batches[0].mObject == 2, "touching ranges must merge from the lowest index" );
+        check( batches[1].mFirstIndex == 30 && batches[1].mItemCount == 1, "a gap must start a new batch" );
+        check( batches[2].mPage == 1 && batches[2].mItemCount == 1, "another page must start a new batch" );
+        check( batches[3].mKey == keyB && batches[3].mFirstIndex == 20 && batches[3].mIndexCount == 10 && batches[3].mItemCount == 2,
+            "ranges of the second key must merge" );
+    }
+    RenderQueueStats stats = queue.GetStats( );
+    check( stats.mItems == 6 && stats.mBatches == 4 && stats.mStateChanges == 2, "stats must count items, batches and keys" );
+    queue.Clear( );
+    queue.Build( );
+    check( queue.GetItems( ).empty( ) && queue.GetBatches( ).empty( ), "empty queue must give no batches" );
+
+    // sort: random draws in random order against std::sort by ( key, page, firstIndex ), keys spread over all digits
+    std::mt19937 rng( 5 );
+    std::vector<uint64_t> keys( 24 );
+    for ( size_t i = 0; i < keys.size( ); i++ )
+        keys[i] = RenderQueue::PackKey( rng( ) % 4, rng( ) % 0x1000000, rng( ) % 0x10000, rng( ) % 0x10000 );
+    std::vector<RenderItem> reference;
+    for ( uint32_t page = 0; page < 5; page++ )
+    {
+        uint32_t firstIndex = 0;
+        for ( uint32_t i = 0; i < 2000; i++ )
+        {
+            uint32_t indexCount = 3 * ( 1 + rng( ) % 100 );
+            RenderItem item = { keys[rng( ) % keys.size( )], static_cast< uint32_t >( reference.size( ) ), page, firstIndex, indexCount };
+            reference.push_back( item );
+            // a few ranges are left out, so not every neighbour touches
+            firstIndex += indexCount + ( rng( ) % 8 == 0 ? 3 : 0 );
+        }
+    }
+    std::shuffle( reference.begin( ), reference.end( ), rng );
+    for ( const RenderItem &item : reference )
+        queue.Push( item.mKey, item.mObject, item.mPage, item.mFirstIndex, item.mIndexCount );
+    queue.Build( );
+    std::sort( reference.begin( ), reference.end( ), []( const RenderItem &a, const RenderItem &b )
+    {
+        if ( a.mKey != b.mKey )
+            return a.mKey < b.mKey;
+        if ( a.mPage != b.mPage )
+            return a.mPage < b.mPage;
+        return a.mFirstIndex < b.mFirstIndex;
+    } );
+    const std::vector<RenderItem> &items = queue.GetItems( );
+    bool sorted = items.size( ) == reference.size( );
+    for ( size_t i = 0; sorted && i < items.size( ); i++ )
+        sorted = items[i].mObject == reference[i].mObject;
+    check( sorted, "radix sort must order by key, page and first index" );
+
+    // batches cover the items in order and no two neighbours could have merged
+    size_t item = 0;
+    bool covered = true, maximal = true;
+    for ( size_t i = 0; covered && i < batches.size( ); i++ )
+    {
+        const RenderBatch &batch = batches[i];
+        uint32_t indexCount = 0;
+        covered = batch.mObject == items[item].mObject;
+        for ( uint32_t j = 0; covered && j < batch.mItemCount; j++, item++ )
+        {
+            covered = item < items.size( ) && items[item].mKey == batch.mKey && items[item].mPage == batch.mPage &&
+                items[item].mFirstIndex == batch.mFirstIndex + indexCount;
+            indexCount += covered ? items[item].mIndexCount : 0;
+        }
+        covered = covered && indexCount == batch.mIndexCount;
+        if ( i > 0 )
+        {
+            const RenderBatch &previous = batches[i - 1];
+            maximal = maximal && !( previous.mKey == batch.mKey && previous.mPage == batch.mPage &&
+                previous.mFirstIndex + previous.mIndexCount == batch.mFirstIndex );
+        }
+    }
+    check( covered && item == items.size( ), "batches must cover the sorted items" );
+    check( maximal, "adjacent batches must have been merged" );
+    check( batches.size( ) < items.size( ), "random draws must merge" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
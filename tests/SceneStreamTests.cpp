@@ -0,0 +1,82 @@
+#include <Core/SceneStream.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunSceneStreamTest( std::string &failure )
+{
+    TestCheck check;
+
+    const char *fn = "scene_stream_test.bin";
+    const uint32_t trailer = 0x12345678;
+    std::vector<std::string> libs;
+    libs.push_back( "media/a.mtl" );
+    libs.push_back( "media/b.mtl" );
+
+    SceneBinObject first, second;
+    GenerateSyntheticObject( 0, 3, first.mVertices, first.mIndices );
+    GenerateSyntheticObject( 1, 4, second.mVertices, second.mIndices );
+
+    SceneBinWriter writer;
+    check( writer.Open( fn, libs ), "writer must open" );
+    check( writer.WriteObject( "floor", "stone", first.mVertices.data( ), first.mVertices.size( ), first.mIndices.data( ), first.mIndices.size( ) ),
+        "first object must be written" );
+    check( writer.WriteObject( std::string( 300, 'n' ), "", second.mVertices.data( ), second.mVertices.size( ),
+        second.mIndices.data( ), second.mIndices.size( ) ), "second object must be written" );
+    writer.GetStream( ).write( reinterpret_cast< const char* >( &trailer ), sizeof( trailer ) );
+    check( writer.Close( ), "writer must replace the file" );
+
+    SceneBinReader reader;
+    SceneBinObject object;
+    std::string error;
+    if ( check( reader.Open( fn, error ), "reader must open written file" ) )
+    {
+        check( reader.GetMaterialLibs( ) == libs && reader.GetObjectCount( ) == 2, "header must keep libs and patched object count" );
+        check( reader.ReadObject( object, error ) && object.mName == "floor" && object.mMaterial == "stone" &&
+            object.mVertices.size( ) == 9 && object.mIndices == first.mIndices &&
+            object.mVertices[4].mPosition[1] == first.mVertices[4].mPosition[1], "first object must round trip" );
+        check( reader.ReadObject( object, error ) && object.mName.size( ) == 300 && object.mMaterial.empty( ) &&
+            object.mVertices.size( ) == 16 && object.mIndices == second.mIndices, "long names and empty material must round trip" );
+        check( !reader.ReadObject( object, error ) && error.empty( ), "reading stops after the last object" );
+
+        uint32_t readTrailer = 0;
+        reader.GetStream( ).read( reinterpret_cast< char* >( &readTrailer ), sizeof( readTrailer ) );
+        check( readTrailer == trailer, "trailer must follow the last object" );
+    }
+
+    // copy into the file being read: replaced only on close
+    SceneBinWriter copy;
+    check( copy.Open( fn, reader.GetMaterialLibs( ) ) && copy.WriteObject( "floor", "stone", first.mVertices.data( ), first.mVertices.size( ),
+        first.mIndices.data( ), first.mIndices.size( ) ), "copy must be written next to the source" );
+    reader.Close( );
+    check( copy.Close( ) && reader.Open( fn, error ) && reader.GetObjectCount( ) == 1, "copy must replace the source on close" );
+    reader.Close( );
+
+    // cut the file inside of the vertex data
+    {
+        std::ifstream in( fn, std::ifstream::binary );
+        std::string data( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>( ) );
+        in.close( );
+        std::ofstream out( fn, std::ofstream::binary | std::ofstream::trunc );
+        out.write( data.data( ), data.size( ) - first.mIndices.size( ) * sizeof( uint32_t ) - 100 );
+    }
+    error.clear( );
+    check( reader.Open( fn, error ) && !reader.ReadObject( object, error ) && !error.empty( ), "truncated object must be reported" );
+    reader.Close( );
+    std::remove( fn );
+
+    check( !reader.Open( fn, error ), "missing file must be reported" );
+
+    SceneStreamBenchmarkResult benchmark = RunSceneStreamBenchmark( "scene_stream_benchmark.bin", 1 << 20, 1024 );
+    check( benchmark.mMatches && benchmark.mObjects > 1, "streamed synthetic scene must match written one" );
+    check( benchmark.mLargestObject < benchmark.mBytes, "memory must be bounded by an object" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
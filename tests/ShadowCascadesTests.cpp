@@ -0,0 +1,123 @@
+#include <Core/ShadowCascades.h>
+#include <Core/VMath.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <string>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunShadowCascadeTest( std::string &failure )
+{
+    TestCheck check;
+
+    // right handed look-to view and perspective fov 45, aspect 4:3, as D3DRenderer uses
+    auto makeView = []( const float eye[3], float yaw, float view[16] )
+    {
+        Mat4 m = Mat4LookToRH( Vec3( eye[0], eye[1], eye[2] ), Vec3( std::sin( yaw ), 0.0f, -std::cos( yaw ) ), Vec3( 0.0f, 1.0f, 0.0f ) );
+        memcpy( view, m.m, sizeof( m.m ) );
+    };
+    auto transform = []( const float p[3], const float m[16], float out[3] )
+    {
+        // w is 1 for ortho projections
+        Vec4 result = TransformPoint( Vec3( p[0], p[1], p[2] ), Mat4FromArray( m ) );
+        out[0] = result.x;
+        out[1] = result.y;
+        out[2] = result.z;
+    };
+
+    const float fovY = 0.25f * 3.14159265f, aspect = 4.0f / 3.0f;
+    float proj[16];
+    memset( proj, 0, sizeof( proj ) );
+    proj[5] = 1.0f / std::tan( fovY * 0.5f );
+    proj[0] = proj[5] / aspect;
+    proj[10] = -1.0f;
+    proj[11] = -1.0f;
+    proj[14] = -1.0f;
+
+    ShadowLightInput light;
+    Vec3 dir = Normalize( Vec3( 0.3f, -1.0f, 0.2f ) );
+    light.mDirection[0] = dir.x; light.mDirection[1] = dir.y; light.mDirection[2] = dir.z;
+    light.mSceneMin[0] = -1500.0f; light.mSceneMin[1] = 0.0f; light.mSceneMin[2] = -700.0f;
+    light.mSceneMax[0] = 1500.0f; light.mSceneMax[1] = 1200.0f; light.mSceneMax[2] = 700.0f;
+
+    ShadowCascadeParams params;
+
+    // splits
+    float splits[MAX_SHADOW_CASCADES + 1];
+    ComputeCascadeSplits( params.mNear, params.mFar, params.mCount, params.mLambda, splits );
+    check( splits[0] == params.mNear && splits[params.mCount] == params.mFar, "splits don't start at near or end at far" );
+    for ( int i = 0; i < params.mCount; i++ )
+        check( splits[i] < splits[i + 1], "splits aren't increasing" );
+
+    ShadowCascades cascades;
+    float eye[3] = { 100.0f, 300.0f, 50.0f };
+    float view[16];
+    makeView( eye, 0.3f, view );
+    cascades.Update( view, proj, light, params );
+    check( cascades.GetDirtyCount( ) == params.mCount + 1, "first update doesn't mark all cascades dirty" );
+
+    // every slice corner inside its cascade with margin for pcf, view columns are the camera axes
+    float right[3], up[3], forward[3];
+    for ( int a = 0; a < 3; a++ )
+    {
+        right[a] = view[a * 4 + 0];
+        up[a] = view[a * 4 + 1];
+        forward[a] = -view[a * 4 + 2];
+    }
+    for ( int i = 0; i < cascades.GetCount( ); i++ )
+    {
+        const ShadowCascade &cascade = cascades.GetCascade( i );
+        float tanY = 1.0f / proj[5], tanX = 1.0f / proj[0];
+        for ( int c = 0; c < 8; c++ )
+        {
+            float z = ( c & 4 ) ? cascade.mSplitFar : cascade.mSplitNear;
+            float x = ( ( c & 1 ) ? 1.0f : -1.0f ) * tanX * z;
+            float y = ( ( c & 2 ) ? 1.0f : -1.0f ) * tanY * z;
+            float p[3], clip[3];
+            for ( int a = 0; a < 3; a++ )
+                p[a] = eye[a] + right[a] * x + up[a] * y + forward[a] * z;
+            transform( p, cascade.mViewProj, clip );
+            check( std::fabs( clip[0] ) <= 1.0f && std::fabs( clip[1] ) <= 1.0f, "slice corner is outside of its cascade" );
+        }
+
+        float texels = cascade.mCenter[0] / cascade.mTexelSize;
+        check( std::fabs( texels - std::floor( texels + 0.5f ) ) < 1e-2f, "cascade center isn't snapped to texels" );
+    }
+
+    // scene cascade contains the whole scene
+    for ( int c = 0; c < 8; c++ )
+    {
+        float p[3] = { ( c & 1 ) ? light.mSceneMax[0] : light.mSceneMin[0], ( c & 2 ) ? light.mSceneMax[1] : light.mSceneMin[1],
+            ( c & 4 ) ? light.mSceneMax[2] : light.mSceneMin[2] };
+        float clip[3];
+        transform( p, cascades.GetSceneCascade( ).mViewProj, clip );
+        check( std::fabs( clip[0] ) <= 1.0001f && std::fabs( clip[1] ) <= 1.0001f && clip[2] >= 0.0f && clip[2] <= 1.0f,
+            "scene corner is outside of scene cascade" );
+    }
+
+    // small move and rotation are absorbed by guard band
+    cascades.ClearDirty( );
+    float eye2[3] = { eye[0] + 2.0f, eye[1], eye[2] - 1.0f };
+    makeView( eye2, 0.305f, view );
+    cascades.Update( view, proj, light, params );
+    check( cascades.GetDirtyCount( ) == 0, "small camera move redraws cascades" );
+
+    // big move redraws near cascade but never scene cascade
+    float eye3[3] = { eye[0] + 400.0f, eye[1], eye[2] };
+    makeView( eye3, 0.3f, view );
+    cascades.Update( view, proj, light, params );
+    check( cascades.GetCascade( 0 ).mDirty, "big camera move keeps near cascade" );
+    check( !cascades.GetSceneCascade( ).mDirty, "camera move redraws scene cascade" );
+
+    // light change redraws everything
+    cascades.ClearDirty( );
+    light.mDirection[0] += 0.01f;
+    cascades.Update( view, proj, light, params );
+    check( cascades.GetDirtyCount( ) == params.mCount + 1, "light change doesn't redraw all cascades" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
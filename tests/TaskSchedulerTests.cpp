@@ -0,0 +1,222 @@
+#include <Core/TaskScheduler.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunTaskDequeStressTest( size_t thieves, size_t tasks, std::string &failure )
+{
+    // fake tasks are never executed, every slot counts how many times it came out of the deque
+    std::vector<std::atomic<int>> taken( tasks );
+    for ( auto &count : taken )
+        count.store( 0 );
+    std::vector<uint32_t> slots( tasks );
+    auto toTask = [&]( size_t i ) { return reinterpret_cast< Task* >( &slots[i] ); };
+    auto toIndex = [&]( Task *task ) { return static_cast< size_t >( reinterpret_cast< uint32_t* >( task ) - slots.data( ) ); };
+
+    TaskDeque deque( 4 ); // small ring, so it grows while thieves read it
+    std::atomic<bool> done( false );
+    std::atomic<size_t> stolen( 0 );
+
+    std::vector<std::thread> threads;
+    for ( size_t t = 0; t < thieves; t++ )
+    {
+        threads.push_back( std::thread( [&]( )
+        {
+            while ( !done.load( ) )
+            {
+                if ( Task *task = deque.Steal( ) )
+                {
+                    taken[toIndex( task )]++;
+                    stolen++;
+                }
+            }
+        } ) );
+    }
+
+    // bursts of pushes with pops in between, the last item of a burst is the one both sides race for
+    std::mt19937 random( 12345 );
+    size_t pushed = 0;
+    while ( pushed < tasks )
+    {
+        size_t burst = ( std::min )( tasks - pushed, static_cast< size_t >( random( ) % 600 ) + 1 );
+        for ( size_t i = 0; i < burst; i++ )
+            deque.Push( toTask( pushed++ ) );
+
+        size_t pops = random( ) % ( burst + 1 );
+        for ( size_t i = 0; i < pops; i++ )
+        {
+            if ( Task *task = deque.Pop( ) )
+                taken[toIndex( task )]++;
+        }
+    }
+    while ( Task *task = deque.Pop( ) )
+        taken[toIndex( task )]++;
+
+    done.store( true );
+    for ( auto &thread : threads )
+        thread.join( );
+
+    size_t missing = 0, duplicates = 0;
+    for ( auto &count : taken )
+    {
+        missing += count.load( ) == 0;
+        duplicates += count.load( ) > 1;
+    }
+
+    TestCheck check;
+    std::ostringstream lost;
+    lost << "deque lost " << missing << " and duplicated " << duplicates << " of " << tasks << " tasks";
+    check( missing == 0 && duplicates == 0 && deque.GetSize( ) == 0, lost.str( ) );
+    check( thieves == 0 || stolen.load( ) > 0, "nothing was stolen" );
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunTaskSchedulerTest( std::string &failure )
+{
+    TestCheck check;
+
+    std::string dequeFailure;
+    bool dequePassed = RunTaskDequeStressTest( 3, 200000, dequeFailure );
+    check( dequePassed, dequeFailure );
+
+    TaskScheduler scheduler( 3 );
+    check( scheduler.GetThreadCount( ) == 4, "owner and 3 workers" );
+
+    // diamond: b and c after a, d after both
+    std::mutex orderLock;
+    std::string order;
+    auto mark = [&]( char c ) { std::lock_guard<std::mutex> lock( orderLock ); order += c; };
+    TaskHandle a = scheduler.Run( [&]( ) { std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) ); mark( 'a' ); } );
+    TaskHandle b = scheduler.Run( [&]( ) { mark( 'b' ); }, std::vector<TaskHandle>( 1, a ) );
+    TaskHandle c = scheduler.Run( [&]( ) { mark( 'c' ); }, std::vector<TaskHandle>( 1, a ) );
+    std::vector<TaskHandle> bc;
+    bc.push_back( b );
+    bc.push_back( c );
+    TaskHandle d = scheduler.Run( [&]( ) { mark( 'd' ); }, bc );
+    scheduler.Wait( d );
+    check( order.size( ) == 4 && order[0] == 'a' && order[3] == 'd', "dependencies must order the diamond" );
+    TaskHandle late = scheduler.Run( [&]( ) { mark( 'e' ); }, bc );
+    scheduler.Wait( late );
+    check( order.size( ) == 5, "finished dependencies must not block" );
+
+    // long chain, every link checks the previous one
+    std::vector<int> chain( 2000, 0 );
+    TaskHandle previous;
+    for ( size_t i = 0; i < chain.size( ); i++ )
+    {
+        previous = scheduler.Run( [&chain, i]( ) { chain[i] = i == 0 ? 1 : chain[i - 1] + 1; }, std::vector<TaskHandle>( 1, previous ) );
+    }
+    scheduler.Wait( previous );
+    check( chain.back( ) == 2000, "chain must run in order" );
+
+    // every index once, nested parallel for from worker tasks
+    const size_t items = 100003;
+    std::vector<std::atomic<int>> visits( items );
+    for ( auto &v : visits )
+        v.store( 0 );
+    scheduler.ParallelFor( 0, items, 97, [&]( size_t first, size_t last )
+    {
+        for ( size_t i = first; i < last; i++ )
+            visits[i]++;
+    } );
+    std::vector<TaskHandle> outer;
+    for ( int t = 0; t < 8; t++ )
+    {
+        outer.push_back( scheduler.Run( [&]( )
+        {
+            scheduler.ParallelFor( 0, items, 1000, [&]( size_t first, size_t last )
+            {
+                for ( size_t i = first; i < last; i++ )
+                    visits[i]++;
+            } );
+        } ) );
+    }
+    scheduler.Wait( outer );
+    bool once = true;
+    for ( auto &v : visits )
+        once = once && v.load( ) == 9;
+    check( once, "parallel for must visit every index once per call, nested too" );
+
+    // reduce is deterministic across thread counts
+    auto map = []( size_t first, size_t last ) -> float
+    {
+        float s = 0.0f;
+        for ( size_t i = first; i < last; i++ )
+            s += 1.0f / ( 1.0f + i );
+        return s;
+    };
+    auto add = []( float x, float y ) { return x + y; };
+    TaskScheduler single( 0 );
+    float parallelSum = scheduler.ParallelReduce( size_t( 0 ), size_t( 1 << 20 ), 1000, 0.0f, map, add );
+    float singleSum = single.ParallelReduce( size_t( 0 ), size_t( 1 << 20 ), 1000, 0.0f, map, add );
+    check( parallelSum == singleSum && parallelSum > 14.0f, "reduce must not depend on thread count" );
+    check( scheduler.ParallelReduce( size_t( 5 ), size_t( 5 ), 10, 7, map, add ) == 7, "empty reduce is identity" );
+
+    // tasks from a thread without a deque
+    std::atomic<int> foreign( 0 );
+    std::thread outsider( [&]( )
+    {
+        std::vector<TaskHandle> tasks;
+        for ( int i = 0; i < 100; i++ )
+            tasks.push_back( scheduler.Run( [&]( ) { foreign++; } ) );
+        scheduler.Wait( tasks );
+    } );
+    outsider.join( );
+    check( foreign.load( ) == 100, "tasks of foreign threads must run" );
+
+    // pipeline: serial stage in order, finish in order, bounded items
+    struct Item
+    {
+        size_t mIndex;
+        size_t mSerialOrder;
+        size_t mSquare;
+    };
+    size_t serialCount = 0, finished = 0, alive = 0, maxAlive = 0;
+    bool ordered = true;
+    {
+        TaskPipeline<Item> pipeline( scheduler, 4,
+            [&]( Item &item ) { item.mSerialOrder = serialCount++; },
+            [&]( Item &item ) { item.mSquare = item.mIndex * item.mIndex; },
+            [&]( Item &item )
+            {
+                ordered = ordered && item.mIndex == finished && item.mSerialOrder == finished && item.mSquare == finished * finished;
+                finished++;
+                alive--;
+            } );
+        for ( size_t i = 0; i < 100; i++ )
+        {
+            std::unique_ptr<Item> item = pipeline.Acquire( );
+            item->mIndex = i;
+            alive++;
+            maxAlive = ( std::max )( maxAlive, alive );
+            pipeline.Push( std::move( item ) );
+        }
+    }
+    check( finished == 100 && ordered, "pipeline must keep push order" );
+    check( maxAlive <= 5, "pipeline must bound items in flight" );
+
+    // owner only scheduler runs everything while waiting
+    TaskScheduler owner( 0 );
+    int ownerSum = 0;
+    std::vector<TaskHandle> ownerTasks;
+    for ( int i = 1; i <= 10; i++ )
+        ownerTasks.push_back( owner.Run( [&ownerSum, i]( ) { ownerSum += i; } ) );
+    owner.Wait( ownerTasks );
+    check( ownerSum == 55, "waiting must execute queued tasks" );
+    check( scheduler.GetStats( ).mExecuted > 0, "stats must count tasks" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,24 @@
+#include "TestCheck.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TestCheck::operator()( bool condition, const char *what )
+{
+    if ( !condition && !mFailed )
+    {
+        mFailure = what;
+        mFailed = true;
+    }
+    return condition;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TestCheck::operator()( bool condition, const std::string &what )
+{
+    return ( *this )( condition, what.c_str( ) );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TestCheck::Passed( std::string &failure ) const
+{
+    failure = mFailure;
+    return !mFailed;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,22 @@
+#ifndef __TEST_CHECK_H
+#define __TEST_CHECK_H
+
+#include <string>
+
+// condition checks of a test, keeps the description of the first one that failed
+class TestCheck
+{
+public:
+    // condition as it is, so checks can guard the rest of a test
+    bool operator()( bool condition, const char *what );
+    bool operator()( bool condition, const std::string &what );
+
+    // false and the first description if any check failed
+    bool Passed( std::string &failure ) const;
+
+private:
+    std::string mFailure;
+    bool mFailed = false;
+};
+
+#endif
@@ -0,0 +1,202 @@
+#include <Core/VMath.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // XMMatrixPerspectiveFovRH( XM_PIDIV4, 4 / 3, 1, 10000 )
+    const float kGoldenPerspective[16] = {
+        1.8106602f, 0.0f, 0.0f, 0.0f,
+        0.0f, 2.4142136f, 0.0f, 0.0f,
+        0.0f, 0.0f, -1.0001f, -1.0f,
+        0.0f, 0.0f, -1.0001f, 0.0f
+    };
+
+    // XMMatrixLookAtRH( ( 0.01511, 0.3311, 3.3732 ), ( 500, -120, -40 ), ( 0, 1, 0 ) ), default camera position
+    const float kGoldenView[16] = {
+        0.086424442f, 0.23228814f, -0.96879979f, 0.0f,
+        0.0f, 0.97243826f, 0.23316054f, 0.0f,
+        0.99625841f, -0.020150769f, 0.084042434f, 0.0f,
+        -3.3618847f, -0.25751161f, -0.34605283f, 1.0f
+    };
+
+    // XMMatrixOrthographicRH( 2048, 1024, -50, 3000 )
+    const float kGoldenOrtho[16] = {
+        0.0009765625f, 0.0f, 0.0f, 0.0f,
+        0.0f, 0.001953125f, 0.0f, 0.0f,
+        0.0f, 0.0f, -0.00032786885f, 0.0f,
+        0.0f, 0.0f, 0.016393443f, 1.0f
+    };
+
+    // XMMatrixOrthographicOffCenterRH( -300, 500, -120, 900, 10, 2500 )
+    const float kGoldenOffCenter[16] = {
+        0.0025f, 0.0f, 0.0f, 0.0f,
+        0.0f, 0.0019607843f, 0.0f, 0.0f,
+        0.0f, 0.0f, -0.00040160643f, 0.0f,
+        -0.25f, -0.76470588f, -0.0040160643f, 1.0f
+    };
+
+    // XMMatrixMultiply( view, perspective )
+    const float kGoldenViewProj[16] = {
+        0.1564853f, 0.56079319f, 0.96889668f, 0.96879979f,
+        0.0f, 2.3476736f, -0.23318385f, -0.23316054f,
+        1.8038854f, -0.04864826f, -0.084050839f, -0.084042434f,
+        -6.0872308f, -0.62168801f, -0.65401257f, 0.34605283f
+    };
+
+    // relative to the largest element, golden values have 8 significant digits
+    float MaxError( const Mat4 &a, const float b[16] )
+    {
+        float scale = 1.0f, error = 0.0f;
+        for ( int i = 0; i < 16; i++ )
+            scale = ( std::max )( scale, std::fabs( b[i] ) );
+        for ( int i = 0; i < 16; i++ )
+            error = ( std::max )( error, std::fabs( a.m[i] - b[i] ) );
+        return error / scale;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunMathTest( std::string &failure )
+{
+    TestCheck check;
+
+    // constructors against DirectXMath
+    const float tolerance = 2e-6f;
+    Mat4 proj = Mat4PerspectiveFovRH( 0.25f * 3.14159265f, 4.0f / 3.0f, 1.0f, 10000.0f );
+    Mat4 view = Mat4LookAtRH( Vec3( 0.01511f, 0.3311f, 3.3732f ), Vec3( 500.0f, -120.0f, -40.0f ), Vec3( 0.0f, 1.0f, 0.0f ) );
+    check( MaxError( proj, kGoldenPerspective ) < tolerance, "perspective must match XMMatrixPerspectiveFovRH" );
+    check( MaxError( view, kGoldenView ) < tolerance, "look-at must match XMMatrixLookAtRH" );
+    check( MaxError( Mat4OrthographicRH( 2048.0f, 1024.0f, -50.0f, 3000.0f ), kGoldenOrtho ) < tolerance,
+        "ortho must match XMMatrixOrthographicRH" );
+    check( MaxError( Mat4OrthographicOffCenterRH( -300.0f, 500.0f, -120.0f, 900.0f, 10.0f, 2500.0f ), kGoldenOffCenter ) < tolerance,
+        "off center ortho must match XMMatrixOrthographicOffCenterRH" );
+    Mat4 viewProj = Mat4Multiply( view, proj );
+    check( MaxError( viewProj, kGoldenViewProj ) < tolerance, "product must match XMMatrixMultiply" );
+
+    // inverse round trips, singular matrix is reported
+    Mat4 inv;
+    float det = 0.0f;
+    check( Mat4Inverse( viewProj, inv, &det ) && det != 0.0f, "view projection must be invertible" );
+    Mat4 identity = Mat4Identity( );
+    check( MaxError( Mat4Multiply( viewProj, inv ), identity.m ) < 1e-5f, "matrix times inverse must be identity" );
+    Mat4 singular = Mat4Scaling( Vec3( 1.0f, 0.0f, 1.0f ) );
+    check( !Mat4Inverse( singular, inv ) && MaxError( inv, identity.m ) == 0.0f, "singular matrix must be reported" );
+    check( MaxError( Mat4Transpose( Mat4Transpose( viewProj ) ), viewProj.m ) == 0.0f, "double transpose must be identity" );
+
+    // eye goes to view origin, focus onto -z, focus projects to screen center
+    Vec3 eye( 0.01511f, 0.3311f, 3.3732f ), focus( 500.0f, -120.0f, -40.0f );
+    Vec4 eyeView = TransformPoint( eye, view );
+    check( std::fabs( eyeView.x ) < 1e-5f && std::fabs( eyeView.y ) < 1e-5f && std::fabs( eyeView.z ) < 1e-5f, "eye must be view origin" );
+    Vec3 focusClip = TransformCoord( focus, viewProj );
+    check( std::fabs( focusClip.x ) < 1e-4f && std::fabs( focusClip.y ) < 1e-4f && focusClip.z > 0.0f && focusClip.z < 1.0f,
+        "focus must project to screen center inside depth range" );
+    Vec3 moved = TransformNormal( Vec3( 1.0f, 0.0f, 0.0f ), Mat4Translation( Vec3( 5.0f, 6.0f, 7.0f ) ) );
+    check( moved.x == 1.0f && moved.y == 0.0f && moved.z == 0.0f, "normals must ignore translation" );
+
+    // batched paths against single point transforms, odd count covers the scalar tail
+    const size_t count = 37;
+    float x[count], y[count], z[count];
+    for ( size_t i = 0; i < count; i++ )
+    {
+        x[i] = -600.0f + 37.0f * i;
+        y[i] = 200.0f - 11.0f * i;
+        z[i] = -900.0f + 13.0f * i;
+    }
+    for ( int path = 0; path < MP_COUNT; path++ )
+    {
+        if ( !IsMathPathSupported( static_cast< MathPath >( path ) ) )
+            continue;
+
+        float ox[count], oy[count], oz[count], ow[count], cx[count], cy[count], cz[count];
+        TransformPointsSoA( viewProj, x, y, z, count, ox, oy, oz, ow, static_cast< MathPath >( path ) );
+        TransformCoordsSoA( viewProj, x, y, z, count, cx, cy, cz, static_cast< MathPath >( path ) );
+        bool same = true;
+        for ( size_t i = 0; i < count; i++ )
+        {
+            Vec4 p = TransformPoint( Vec3( x[i], y[i], z[i] ), viewProj );
+            Vec3 c = TransformCoord( Vec3( x[i], y[i], z[i] ), viewProj );
+            float scale = 1.0f + std::fabs( p.w );
+            same &= std::fabs( ox[i] - p.x ) <= 1e-5f * scale && std::fabs( oy[i] - p.y ) <= 1e-5f * scale &&
+                std::fabs( oz[i] - p.z ) <= 1e-5f * scale && std::fabs( ow[i] - p.w ) <= 1e-5f * scale;
+            same &= std::fabs( cx[i] - c.x ) <= 1e-4f * ( 1.0f + std::fabs( c.x ) ) &&
+                std::fabs( cy[i] - c.y ) <= 1e-4f * ( 1.0f + std::fabs( c.y ) ) && std::fabs( cz[i] - c.z ) <= 1e-4f;
+        }
+        check( same, "batched transform must match single point transform on every path" );
+    }
+
+    // in place transform
+    float ix[count], iy[count], iz[count], iw[count];
+    for ( size_t i = 0; i < count; i++ )
+    {
+        ix[i] = x[i];
+        iy[i] = y[i];
+        iz[i] = z[i];
+    }
+    TransformPointsSoA( Mat4Translation( Vec3( 1.0f, 2.0f, 3.0f ) ), ix, iy, iz, count, ix, iy, iz, iw );
+    check( ix[count - 1] == x[count - 1] + 1.0f && iy[5] == y[5] + 2.0f && iz[0] == z[0] + 3.0f && iw[3] == 1.0f,
+        "outputs must be allowed to alias inputs" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunMathPathsTest( std::string &failure )
+{
+    TestCheck check;
+
+    // every simd path against the scalar one on all outputs, count isn't a multiple of 8 or 4 to cover the tails
+    Mat4 viewProj = Mat4Multiply( Mat4LookAtRH( Vec3( 0.0f, 300.0f, 1500.0f ), Vec3( ), Vec3( 0.0f, 1.0f, 0.0f ) ),
+        Mat4PerspectiveFovRH( 0.25f * 3.14159265f, 4.0f / 3.0f, 1.0f, 10000.0f ) );
+    const size_t count = 1003;
+    std::vector<float> x( count ), y( count ), z( count );
+    for ( size_t i = 0; i < count; i++ )
+    {
+        x[i] = -1200.0f + 2.3f * i;
+        y[i] = 800.0f - 1.7f * ( i % 700 );
+        z[i] = -900.0f + 1.9f * ( ( i * 7 ) % count );
+    }
+
+    std::vector<float> sx( count ), sy( count ), sz( count ), sw( count ), scx( count ), scy( count ), scz( count );
+    TransformPointsSoA( viewProj, &x[0], &y[0], &z[0], count, &sx[0], &sy[0], &sz[0], &sw[0], MP_SCALAR );
+    TransformCoordsSoA( viewProj, &x[0], &y[0], &z[0], count, &scx[0], &scy[0], &scz[0], MP_SCALAR );
+    for ( int path = MP_SCALAR + 1; path < MP_COUNT; path++ )
+    {
+        if ( !IsMathPathSupported( static_cast< MathPath >( path ) ) )
+            continue;
+
+        std::vector<float> ox( count ), oy( count ), oz( count ), ow( count ), cx( count ), cy( count ), cz( count );
+        TransformPointsSoA( viewProj, &x[0], &y[0], &z[0], count, &ox[0], &oy[0], &oz[0], &ow[0], static_cast< MathPath >( path ) );
+        TransformCoordsSoA( viewProj, &x[0], &y[0], &z[0], count, &cx[0], &cy[0], &cz[0], static_cast< MathPath >( path ) );
+        bool points = true, coords = true;
+        for ( size_t i = 0; i < count; i++ )
+        {
+            float scale = 1e-5f * ( 1.0f + std::fabs( sw[i] ) );
+            points &= std::fabs( ox[i] - sx[i] ) <= scale && std::fabs( oy[i] - sy[i] ) <= scale &&
+                std::fabs( oz[i] - sz[i] ) <= scale && std::fabs( ow[i] - sw[i] ) <= scale;
+            coords &= std::fabs( cx[i] - scx[i] ) <= 1e-5f * ( 1.0f + std::fabs( scx[i] ) ) &&
+                std::fabs( cy[i] - scy[i] ) <= 1e-5f * ( 1.0f + std::fabs( scy[i] ) ) && std::fabs( cz[i] - scz[i] ) <= 1e-5f;
+        }
+        check( points, "simd point transform must match scalar on every path" );
+        check( coords, "simd coord transform must match scalar on every path" );
+    }
+
+    // default overload runs the widest supported path
+    MathPath widest = IsMathPathSupported( MP_AVX ) ? MP_AVX : IsMathPathSupported( MP_SSE ) ? MP_SSE :
+        IsMathPathSupported( MP_NEON ) ? MP_NEON : MP_SCALAR;
+    std::vector<float> wx( count ), wy( count ), wz( count ), ww( count ), dx( count ), dy( count ), dz( count ), dw( count );
+    TransformPointsSoA( viewProj, &x[0], &y[0], &z[0], count, &wx[0], &wy[0], &wz[0], &ww[0], widest );
+    TransformPointsSoA( viewProj, &x[0], &y[0], &z[0], count, &dx[0], &dy[0], &dz[0], &dw[0] );
+    check( wx == dx && wy == dy && wz == dz && ww == dw, "default transform must use the widest supported path" );
+
+    MathBenchmarkResult result = RunMathBenchmark( 1024, 1 );
+    check( result.mPathsMatch, "simd transforms don't match scalar reference" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
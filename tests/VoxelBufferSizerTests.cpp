@@ -0,0 +1,63 @@
+#include <Core/VoxelBufferSizer.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <string>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunVoxelBufferSizerTest( std::string &failure )
+{
+    TestCheck check;
+
+    VoxelBufferPolicy policy;
+    policy.mMinCapacity = 1000;
+    policy.mMaxCapacity = 100000;
+    policy.mGranularity = 100;
+    policy.mGrowth = 2.0f;
+    policy.mShrinkBelow = 0.25f;
+    VoxelBufferSizer sizer( policy );
+
+    // exact first allocation, rounded to granularity and never under the minimum
+    VoxelBufferDecision d = sizer.Reserve( 12345 );
+    check( d.mAction == VBA_CREATE && d.mCapacity == 12400 && d.mDropped == 0, "first reserve must allocate the count exactly" );
+    VoxelBufferSizer small( policy );
+    check( small.Reserve( 0 ).mCapacity == 1000, "empty scene must get the minimum capacity" );
+
+    // rebuilds that fit keep the buffer, down to the shrink threshold
+    d = sizer.Reserve( 12400 );
+    check( d.mAction == VBA_KEEP && d.mCapacity == 12400, "count equal to capacity must keep the buffer" );
+    d = sizer.Reserve( 3100 );
+    check( d.mAction == VBA_KEEP, "count at the shrink threshold must keep the buffer" );
+
+    // growth is geometric for small overshoots and exact for big ones
+    d = sizer.Reserve( 12401 );
+    check( d.mAction == VBA_GROW && d.mCapacity == 24800, "small overshoot must grow by the growth factor" );
+    d = sizer.Reserve( 60050 );
+    check( d.mAction == VBA_GROW && d.mCapacity == 60100, "big overshoot must grow to the count" );
+
+    // sparse scene gives memory back, exact again
+    d = sizer.Reserve( 5000 );
+    check( d.mAction == VBA_SHRINK && d.mCapacity == 5000, "count under a quarter must shrink to the count" );
+
+    // over the device limit: clamped, the rest is reported as dropped, the next reserve doesn't reallocate
+    d = sizer.Reserve( 250000 );
+    check( d.mAction == VBA_GROW && d.mCapacity == 100000 && d.mDropped == 150000, "overflow must clamp to max and report drops" );
+    d = sizer.Reserve( 200000 );
+    check( d.mAction == VBA_KEEP && d.mDropped == 100000, "buffer at max must be kept on overflow" );
+
+    VoxelBufferStats stats = sizer.GetStats( );
+    check( stats.mOverflows == 2 && stats.mReallocations == 5 && stats.mPeakCount == 250000 && stats.mLastCount == 200000,
+        "stats must count reallocations and overflows" );
+
+    sizer.Reset( );
+    d = sizer.Reserve( 2000 );
+    check( d.mAction == VBA_CREATE && d.mCapacity == 2000, "reset must create the buffer again" );
+
+    // defaults: a million fragments fit into 16 MB exactly
+    VoxelBufferSizer defaults;
+    check( defaults.Reserve( 1 << 20 ).mCapacity == ( 1 << 20 ), "default policy must allocate 1M fragments exactly" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,87 @@
+#include <Core/VoxelMerge.h>
+#include <Core/TaskScheduler.h>
+
+#include "CoreTests.h"
+#include "TestCheck.h"
+
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RunVoxelMergeTest( std::string &failure )
+{
+    TestCheck check;
+
+    TaskScheduler serial( 0 );
+    TaskScheduler parallel( 3 );
+    std::vector<OctreeVoxel> fragments, scratch;
+
+    // empty and single fragment arrays pass through
+    check( MergeVoxelFragments( fragments, scratch, parallel ) == 0, "empty array must merge to nothing" );
+    OctreeVoxel single = { PackOctreePosition( 3, 4, 5 ), 0x80402010, 0x00ff8000, 0 };
+    fragments.assign( 1, single );
+    check( MergeVoxelFragments( fragments, scratch, parallel ) == 1 && fragments[0].mColor == single.mColor &&
+        fragments[0].mNormal == single.mNormal && fragments[0].mPad == 1, "single fragment must be kept as is with count 1" );
+
+    // hand computed averages: rounded color per channel, renormalized normal
+    OctreeVoxel a = { PackOctreePosition( 7, 7, 7 ), PackColor( 1.0f, 0.0f, 0.0f, 1.0f ), PackColor( 1.0f, 0.5f, 0.5f, 0.0f ), 0 };
+    OctreeVoxel b = { PackOctreePosition( 7, 7, 7 ), PackColor( 0.0f, 1.0f, 0.0f, 1.0f ), PackColor( 0.5f, 1.0f, 0.5f, 0.0f ), 0 };
+    OctreeVoxel c = { PackOctreePosition( 1, 0, 0 ), 0x01010101, PackColor( 0.5f, 0.5f, 1.0f, 0.0f ), 0 };
+    fragments.clear( );
+    fragments.push_back( a );
+    fragments.push_back( c );
+    fragments.push_back( b );
+    check( MergeVoxelFragments( fragments, scratch, serial ) == 2, "two positions must give two voxels" );
+    if ( fragments.size( ) == 2 )
+    {
+        check( fragments[0].mPosition == c.mPosition && fragments[1].mPosition == a.mPosition, "voxels must be sorted by position" );
+        check( fragments[1].mColor == ( 128u | ( 128u << 8 ) | ( 0u << 16 ) | ( 255u << 24 ) ), "color must be the rounded mean" );
+        // ( 1, 0, 0 ) and ( 0, 1, 0 ) average to 45 degrees, 0.7071 * 0.5 + 0.5 = 0.8536 -> 218; z of about 0 stays in the middle
+        uint32_t n = fragments[1].mNormal;
+        check( ( n & 0xff ) == 218 && ( ( n >> 8 ) & 0xff ) == 218 && ( ( n >> 16 ) & 0xff ) >= 127 && ( ( n >> 16 ) & 0xff ) <= 128,
+            "normal must be the renormalized mean" );
+        check( fragments[1].mPad == 2 && fragments[0].mPad == 1, "pad must hold fragment count" );
+    }
+
+    // opposite normals cancel out, the first fragment keeps its direction
+    OctreeVoxel up = { 9, 0, PackColor( 0.5f, 1.0f, 0.5f, 0.0f ), 0 };
+    OctreeVoxel down = { 9, 0, PackColor( 0.5f, 0.0f, 0.5f, 0.0f ), 0 };
+    fragments.clear( );
+    fragments.push_back( up );
+    fragments.push_back( down );
+    MergeVoxelFragments( fragments, scratch, serial );
+    check( fragments.size( ) == 1 && fragments[0].mNormal == up.mNormal, "canceled normal must fall back to the first fragment" );
+
+    // random shells: serial, parallel and the map reference give the same bytes; enough fragments for many ranges
+    std::vector<OctreeVoxel> input, reference, serialResult;
+    GenerateVoxelFragments( 300000, 7, input );
+    MergeVoxelFragmentsReference( input, reference );
+
+    serialResult = input;
+    MergeVoxelFragments( serialResult, scratch, serial );
+    check( AreVoxelsEqual( serialResult, reference ), "serial merge must match the map reference" );
+
+    fragments = input;
+    MergeVoxelFragments( fragments, scratch, parallel );
+    check( AreVoxelsEqual( fragments, reference ), "parallel merge must match the map reference" );
+
+    bool unique = true;
+    size_t total = 0;
+    for ( size_t i = 0; i < fragments.size( ); i++ )
+    {
+        unique &= i == 0 || fragments[i - 1].mPosition < fragments[i].mPosition;
+        total += fragments[i].mPad;
+    }
+    check( unique, "merged positions must be strictly increasing" );
+    check( total == input.size( ) && reference.size( ) < input.size( ), "fragment counts must add up to the input" );
+
+    // one long run crossing every range border
+    fragments.assign( 100000, single );
+    fragments.push_back( c );
+    MergeVoxelFragments( fragments, scratch, parallel );
+    check( fragments.size( ) == 2 && fragments[1].mPad == 100000 && fragments[1].mColor == single.mColor,
+        "run longer than a range must be reduced once" );
+
+    return check.Passed( failure );
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////